@@ -2,6 +2,7 @@
 #include <iostream>
 #include <algorithm>
 #include <filesystem>
+#include <utility>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -87,6 +88,103 @@ std::filesystem::path GetExecutablePath()
 #endif
 }
 
+namespace
+{
+// a reader waits this long for a checkpoint, a writer for another process holding the database
+constexpr int kBusyTimeoutMs = 5000;
+
+sqlite3_stmt* prepareStatement(sqlite3* db, const char* sql)
+{
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v3(db, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db) << std::endl;
+        return nullptr;
+    }
+    return stmt;
+}
+
+// a cached statement is reset before its next use, which also releases the read transaction it held
+void resetStatement(sqlite3_stmt* stmt)
+{
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+}
+
+const char* const kWriteSql  = "INSERT OR REPLACE INTO FileSystem (FileName, Data) VALUES (?, ?);";
+const char* const kReadSql   = "SELECT Data FROM FileSystem WHERE FileName = ?;";
+const char* const kExistsSql = "SELECT 1 FROM FileSystem WHERE FileName = ?;";
+} // namespace
+
+struct DataReadConnection
+{
+    sqlite3*      db         = nullptr;
+    sqlite3_stmt* readStmt   = nullptr;
+    sqlite3_stmt* existsStmt = nullptr;
+
+    ~DataReadConnection()
+    {
+        sqlite3_finalize(readStmt);
+        sqlite3_finalize(existsStmt);
+        sqlite3_close(db);
+    }
+};
+
+BlobView::BlobView(BlobView&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+BlobView& BlobView::operator=(BlobView&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        _owner      = std::exchange(other._owner, nullptr);
+        _connection = std::exchange(other._connection, nullptr);
+        _data       = std::exchange(other._data, nullptr);
+        _size       = std::exchange(other._size, 0);
+        _cursor     = std::exchange(other._cursor, 0);
+        _copy       = std::move(other._copy);
+    }
+    return *this;
+}
+
+BlobView::~BlobView()
+{
+    release();
+}
+
+void BlobView::release()
+{
+    if (_owner && _connection)
+    {
+        _owner->releaseReader(_connection);
+    }
+    _owner      = nullptr;
+    _connection = nullptr;
+    _data       = nullptr;
+    _size       = 0;
+    _cursor     = 0;
+    _copy.clear();
+}
+
+bool BlobView::read(void* dst, size_t size)
+{
+    const uint8_t* src = take(size);
+    if (!src) return size == 0;
+    std::memcpy(dst, src, size);
+    return true;
+}
+
+const uint8_t* BlobView::take(size_t size)
+{
+    if (size == 0 || _cursor + size > _size) return nullptr;
+    const uint8_t* src  = _data + _cursor;
+    _cursor            += size;
+    return src;
+}
+
 DataWriter::DataWriter()
 {
     _rootPath = GetExecutablePath();
@@ -120,19 +218,74 @@ bool DataWriter::open(const std::string& path)
         return false;
     }
 
+    // a commit appends to the log instead of rewriting pages, readers keep reading the last commit meanwhile. NORMAL
+    // syncs at checkpoints only, a crash may lose the last commits but never corrupts the database
+    sqlite3_busy_timeout(_db, kBusyTimeoutMs);
+    execute(_db, "PRAGMA journal_mode=WAL;");
+    execute(_db, "PRAGMA synchronous=NORMAL;");
     ensureTableExists();
+    _writeStmt  = prepareStatement(_db, kWriteSql);
+    _readStmt   = prepareStatement(_db, kReadSql);
+    _existsStmt = prepareStatement(_db, kExistsSql);
+    if (!_writeStmt || !_readStmt || !_existsStmt)
+    {
+        close();
+        return false;
+    }
+
+    std::lock_guard<std::mutex> readerLock(_readerLock);
+    _dbPath = fullPath;
     return true;
 }
 
 void DataWriter::close()
 {
+    {
+        std::lock_guard<std::mutex> readerLock(_readerLock);
+        // views still out close their connections when they are released
+        if (_readersInUse > 0)
+        {
+            std::cerr << "Closing the database with " << _readersInUse << " blob views still reading it" << std::endl;
+        }
+        _readers.clear();
+        _dbPath.clear();
+    }
     if (_db)
     {
+        if (_batchDepth > 0)
+        {
+            execute(_db, "COMMIT;");
+            _batchDepth = 0;
+        }
+        finalizeStatements();
         sqlite3_close(_db);
         _db = nullptr;
     }
 }
 
+void DataWriter::finalizeStatements()
+{
+    sqlite3_finalize(_writeStmt);
+    sqlite3_finalize(_readStmt);
+    sqlite3_finalize(_existsStmt);
+    _writeStmt  = nullptr;
+    _readStmt   = nullptr;
+    _existsStmt = nullptr;
+}
+
+bool DataWriter::execute(sqlite3* db, const char* sql)
+{
+    char* errMsg = 0;
+    int   rc     = sqlite3_exec(db, sql, 0, 0, &errMsg);
+    if (rc != SQLITE_OK)
+    {
+        std::cerr << "SQL error: " << errMsg << std::endl;
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
 void DataWriter::ensureTableExists()
 {
     // 创建一个简单的表：文件名 (主键) | 数据 (Blob)
@@ -142,12 +295,54 @@ void DataWriter::ensureTableExists()
         "FileName TEXT PRIMARY KEY NOT NULL,"
         "Data BLOB"
         ");";
-    char* errMsg = 0;
-    int   rc     = sqlite3_exec(_db, sql, 0, 0, &errMsg);
-    if (rc != SQLITE_OK)
+    execute(_db, sql);
+}
+
+DataReadConnection* DataWriter::acquireReader()
+{
+    std::filesystem::path dbPath;
     {
-        std::cerr << "SQL error: " << errMsg << std::endl;
-        sqlite3_free(errMsg);
+        std::lock_guard<std::mutex> lock(_readerLock);
+        if (_dbPath.empty()) return nullptr;
+        ++_readersInUse;
+        if (!_readers.empty())
+        {
+            DataReadConnection* connection = _readers.back().release();
+            _readers.pop_back();
+            return connection;
+        }
+        dbPath = _dbPath;
+    }
+
+    // one thread at a time uses a reader, it needs no mutex of its own
+    auto connection = std::make_unique<DataReadConnection>();
+    if (sqlite3_open_v2(dbPath.string().c_str(), &connection->db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr) == SQLITE_OK)
+    {
+        sqlite3_busy_timeout(connection->db, kBusyTimeoutMs);
+        connection->readStmt   = prepareStatement(connection->db, kReadSql);
+        connection->existsStmt = prepareStatement(connection->db, kExistsSql);
+    }
+    if (!connection->readStmt || !connection->existsStmt)
+    {
+        std::cerr << "Can't open a read connection: " << sqlite3_errmsg(connection->db) << std::endl;
+        std::lock_guard<std::mutex> lock(_readerLock);
+        --_readersInUse;
+        return nullptr;
+    }
+    return connection.release();
+}
+
+void DataWriter::releaseReader(DataReadConnection* connection)
+{
+    resetStatement(connection->readStmt);
+    resetStatement(connection->existsStmt);
+    std::unique_ptr<DataReadConnection> owned(connection);
+    std::lock_guard<std::mutex>         lock(_readerLock);
+    --_readersInUse;
+    // closed meanwhile, the connection goes with the view
+    if (!_dbPath.empty())
+    {
+        _readers.push_back(std::move(owned));
     }
 }
 
@@ -159,20 +354,11 @@ bool DataWriter::write(const std::string& virtualFileName, const void* data, siz
     std::string formattedName = formatPath(virtualFileName);
 
     // 使用 INSERT OR REPLACE 来处理新建或覆盖，无需用户关心 UPDATE 还是 INSERT
-    const char*   sql = "INSERT OR REPLACE INTO FileSystem (FileName, Data) VALUES (?, ?);";
-    sqlite3_stmt* stmt;
-
-    if (sqlite3_prepare_v2(_db, sql, -1, &stmt, 0) != SQLITE_OK)
-    {
-        std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(_db) << std::endl;
-        return false;
-    }
-
     // 绑定参数: ?1 -> FileName, ?2 -> Data
-    sqlite3_bind_text(stmt, 1, formattedName.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_blob(stmt, 2, data, (int) size, SQLITE_STATIC);
+    sqlite3_bind_text(_writeStmt, 1, formattedName.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_blob64(_writeStmt, 2, data, size, SQLITE_STATIC);
 
-    int  rc      = sqlite3_step(stmt);
+    int  rc      = sqlite3_step(_writeStmt);
     bool success = (rc == SQLITE_DONE);
 
     if (!success)
@@ -180,43 +366,56 @@ bool DataWriter::write(const std::string& virtualFileName, const void* data, siz
         std::cerr << "Execution failed: " << sqlite3_errmsg(_db) << std::endl;
     }
 
-    sqlite3_finalize(stmt);
+    resetStatement(_writeStmt);
     return success;
 }
 
-bool DataWriter::read(const std::string& virtualFileName, std::vector<uint8_t>& outData)
+BlobView DataWriter::readView(const std::string& virtualFileName)
 {
-    std::lock_guard<std::mutex> lock(_mutex);
-    if (!_db) return false;
-
     std::string formattedName = formatPath(virtualFileName);
-
-    const char*   sql = "SELECT Data FROM FileSystem WHERE FileName = ?;";
-    sqlite3_stmt* stmt;
-
-    if (sqlite3_prepare_v2(_db, sql, -1, &stmt, 0) != SQLITE_OK)
+    BlobView    view;
     {
-        return false;
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_db) return view;
+        if (_batchDepth > 0)
+        {
+            // the writer's statement is needed by the next write, the blob is copied out of it
+            sqlite3_bind_text(_readStmt, 1, formattedName.c_str(), -1, SQLITE_STATIC);
+            if (sqlite3_step(_readStmt) == SQLITE_ROW)
+            {
+                const uint8_t* blob = static_cast<const uint8_t*>(sqlite3_column_blob(_readStmt, 0));
+                view._copy.assign(blob, blob + sqlite3_column_bytes(_readStmt, 0));
+                view._owner = this;
+                view._data  = view._copy.data();
+                view._size  = view._copy.size();
+            }
+            resetStatement(_readStmt);
+            return view;
+        }
     }
 
-    sqlite3_bind_text(stmt, 1, formattedName.c_str(), -1, SQLITE_STATIC);
-
-    bool success = false;
-    if (sqlite3_step(stmt) == SQLITE_ROW)
+    DataReadConnection* connection = acquireReader();
+    if (!connection) return view;
+    view._owner      = this;
+    view._connection = connection;
+    sqlite3_bind_text(connection->readStmt, 1, formattedName.c_str(), -1, SQLITE_TRANSIENT);
+    if (sqlite3_step(connection->readStmt) != SQLITE_ROW)
     {
-        const void* blob  = sqlite3_column_blob(stmt, 0);
-        int         bytes = sqlite3_column_bytes(stmt, 0);
-
-        outData.resize(bytes);
-        if (bytes > 0)
-        {
-            memcpy(outData.data(), blob, bytes);
-        }
-        success = true;
+        view.release();
+        return view;
     }
+    // valid until the statement is reset, which releasing the view does
+    view._data = static_cast<const uint8_t*>(sqlite3_column_blob(connection->readStmt, 0));
+    view._size = static_cast<size_t>(sqlite3_column_bytes(connection->readStmt, 0));
+    return view;
+}
 
-    sqlite3_finalize(stmt);
-    return success;
+bool DataWriter::read(const std::string& virtualFileName, std::vector<uint8_t>& outData)
+{
+    BlobView view = readView(virtualFileName);
+    if (!view.valid()) return false;
+    outData.assign(view.data(), view.data() + view.size());
+    return true;
 }
 
 bool DataWriter::write(const std::string& virtualFileName, BufferStream& outStream)
@@ -240,21 +439,42 @@ bool DataWriter::read(const std::string& virtualFileName, BufferStream& outStrea
 
 bool DataWriter::exists(const std::string& virtualFileName)
 {
-    std::lock_guard<std::mutex> lock(_mutex);
-    if (!_db) return false;
-
     std::string formattedName = formatPath(virtualFileName);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_db) return false;
+        if (_batchDepth > 0)
+        {
+            sqlite3_bind_text(_existsStmt, 1, formattedName.c_str(), -1, SQLITE_STATIC);
+            bool found = (sqlite3_step(_existsStmt) == SQLITE_ROW);
+            resetStatement(_existsStmt);
+            return found;
+        }
+    }
 
-    const char*   sql = "SELECT 1 FROM FileSystem WHERE FileName = ?;";
-    sqlite3_stmt* stmt;
-
-    if (sqlite3_prepare_v2(_db, sql, -1, &stmt, 0) != SQLITE_OK) return false;
+    DataReadConnection* connection = acquireReader();
+    if (!connection) return false;
+    sqlite3_bind_text(connection->existsStmt, 1, formattedName.c_str(), -1, SQLITE_STATIC);
+    bool found = (sqlite3_step(connection->existsStmt) == SQLITE_ROW);
+    releaseReader(connection);
+    return found;
+}
 
-    sqlite3_bind_text(stmt, 1, formattedName.c_str(), -1, SQLITE_STATIC);
+bool DataWriter::beginBatch()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_db) return false;
+    // IMMEDIATE takes the write lock now, a later write in the batch cannot fail to upgrade
+    if (_batchDepth == 0 && !execute(_db, "BEGIN IMMEDIATE;")) return false;
+    ++_batchDepth;
+    return true;
+}
 
-    bool found = (sqlite3_step(stmt) == SQLITE_ROW);
-    sqlite3_finalize(stmt);
-    return found;
+bool DataWriter::commitBatch()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_db || _batchDepth == 0) return false;
+    return --_batchDepth > 0 || execute(_db, "COMMIT;");
 }
 
 std::string DataWriter::formatPath(const std::string& path)
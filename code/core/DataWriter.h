@@ -6,6 +6,7 @@
 #include <mutex>
 #include <cstring>
 #include <filesystem>
+#include <memory>
 
 namespace Play
 {
@@ -78,6 +79,61 @@ private:
     size_t               _cursor = 0;
 };
 
+class DataWriter;
+struct DataReadConnection;
+
+// a blob read in place from sqlite's page cache, no copy is made. The view holds a read connection until it is
+// destroyed, so keep it short lived and never past DataWriter::close
+class BlobView
+{
+public:
+    BlobView() = default;
+    BlobView(BlobView&& other) noexcept;
+    BlobView& operator=(BlobView&& other) noexcept;
+    BlobView(const BlobView&)            = delete;
+    BlobView& operator=(const BlobView&) = delete;
+    ~BlobView();
+
+    bool valid() const
+    {
+        return _owner != nullptr;
+    }
+
+    const uint8_t* data() const
+    {
+        return _data;
+    }
+
+    size_t size() const
+    {
+        return _size;
+    }
+
+    // sequential reads like BufferStream
+    bool read(void* dst, size_t size);
+
+    template <typename T>
+    bool read(T& outVal)
+    {
+        return read(&outVal, sizeof(T));
+    }
+
+    // the next size bytes in place, nullptr past the end
+    const uint8_t* take(size_t size);
+
+private:
+    friend class DataWriter;
+
+    void release();
+
+    DataWriter*          _owner      = nullptr;
+    DataReadConnection*  _connection = nullptr; // null when read through the writer's connection inside a batch
+    const uint8_t*       _data       = nullptr;
+    size_t               _size       = 0;
+    size_t               _cursor     = 0;
+    std::vector<uint8_t> _copy; // the blob of a read inside a batch
+};
+
 class DataWriter
 {
 public:
@@ -112,19 +168,66 @@ public:
     // 读取数据到 BufferStream
     bool read(const std::string& virtualFileName, BufferStream& outStream);
 
+    // 读取数据：不复制，视图有效期间占用一个读连接
+    BlobView readView(const std::string& virtualFileName);
+
     // 检查文件是否存在
     bool exists(const std::string& virtualFileName);
 
+    // writes between begin and commit land in one transaction, one sync instead of one per write. Batches nest, the
+    // outermost commit ends the transaction. Writes of other threads meanwhile join it
+    bool beginBatch();
+    bool commitBatch();
+
     // 获取根目录路径
     std::filesystem::path getRootPath() const;
 
 private:
+    friend class BlobView;
+
     sqlite3*              _db = nullptr;
     std::filesystem::path _rootPath;
-    std::mutex            _mutex;
+    std::filesystem::path _dbPath;
+    std::mutex            _mutex; // guards the writer connection, its statements and the batch depth
+    // prepared once per connection and reset after every use
+    sqlite3_stmt*         _writeStmt  = nullptr;
+    sqlite3_stmt*         _readStmt   = nullptr;
+    sqlite3_stmt*         _existsStmt = nullptr;
+    uint32_t              _batchDepth = 0;
+
+    // reads outside a batch go through read only connections of their own, WAL lets them run beside the writer and
+    // each other. Reads inside a batch use the writer's connection, the others do not see its writes before the commit
+    std::mutex                                       _readerLock;
+    std::vector<std::unique_ptr<DataReadConnection>> _readers; // idle ones
+    uint32_t                                         _readersInUse = 0;
+
+    void                ensureTableExists();
+    std::string         formatPath(const std::string& path);
+    bool                execute(sqlite3* db, const char* sql);
+    DataReadConnection* acquireReader();
+    void                releaseReader(DataReadConnection* connection);
+    void                finalizeStatements();
+};
 
-    void        ensureTableExists();
-    std::string formatPath(const std::string& path);
+// keeps a batch open for its scope
+class DataWriterBatch
+{
+public:
+    explicit DataWriterBatch(DataWriter& writer) : _writer(writer)
+    {
+        _writer.beginBatch();
+    }
+
+    ~DataWriterBatch()
+    {
+        _writer.commitBatch();
+    }
+
+    DataWriterBatch(const DataWriterBatch&)            = delete;
+    DataWriterBatch& operator=(const DataWriterBatch&) = delete;
+
+private:
+    DataWriter& _writer;
 };
 
 } // namespace Play
@@ -1,6 +1,7 @@
 #include "PlayCamera.h"
 
 #include "core/runtime/SdlWindow.h"
+#include "TemporalJitter.h"
 
 namespace Play
 {
@@ -101,4 +102,15 @@ void PlayCamera::onResize(const VkExtent2D& size)
 {
     _cameraManip->setWindowSize({size.width, size.height});
 }
+
+void PlayCamera::setJitter(const glm::vec2& jitter, const VkExtent2D& renderExtent)
+{
+    _jitter       = jitter;
+    _jitterExtent = renderExtent;
+}
+
+glm::mat4 PlayCamera::getJitteredPerspectiveMatrix() const
+{
+    return jitterProjection(_cameraManip->getPerspectiveMatrix(), _jitter, {_jitterExtent.width, _jitterExtent.height});
+}
 } // namespace Play
@@ -24,8 +24,18 @@ public:
         return _cameraManip;
     }
 
+    // sub pixel offset of the projected image in render target pixels, the temporal upscaler cycles it every frame
+    void      setJitter(const glm::vec2& jitter, const VkExtent2D& renderExtent);
+    glm::mat4 getJitteredPerspectiveMatrix() const;
+    glm::vec2 getJitter() const
+    {
+        return _jitter;
+    }
+
 private:
     std::shared_ptr<nvutils::CameraManipulator> _cameraManip;
+    glm::vec2                                   _jitter{0.0f};
+    VkExtent2D                                  _jitterExtent{1, 1};
 };
 } // namespace Play
 #endif // PLAYCAMERA_H
@@ -0,0 +1,49 @@
+#include "TemporalJitter.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Play
+{
+
+namespace
+{
+constexpr uint32_t kMinJitterPhaseCount = 8;
+constexpr uint32_t kMaxJitterPhaseCount = 128;
+} // namespace
+
+float haltonSequence(uint32_t index, uint32_t base)
+{
+    float result   = 0.0f;
+    float fraction = 1.0f;
+    while (index > 0)
+    {
+        fraction /= float(base);
+        result += fraction * float(index % base);
+        index /= base;
+    }
+    return result;
+}
+
+uint32_t temporalJitterPhaseCount(float renderScale)
+{
+    const float scale = std::clamp(renderScale, 0.01f, 1.0f);
+    return std::clamp(uint32_t(std::ceil(float(kMinJitterPhaseCount) / (scale * scale))), kMinJitterPhaseCount, kMaxJitterPhaseCount);
+}
+
+glm::vec2 temporalJitterOffset(uint32_t frameIndex, uint32_t phaseCount)
+{
+    // index 0 of the sequence is the pixel corner, start at 1 so no phase samples it
+    const uint32_t index = frameIndex % std::max(phaseCount, 1u) + 1;
+    return glm::vec2(haltonSequence(index, 2), haltonSequence(index, 3)) - 0.5f;
+}
+
+glm::mat4 jitterProjection(const glm::mat4& proj, const glm::vec2& jitter, const glm::uvec2& renderExtent)
+{
+    const glm::vec2 ndcOffset = 2.0f * jitter / glm::vec2(glm::max(renderExtent, glm::uvec2(1)));
+    glm::mat4       ndcShift(1.0f);
+    ndcShift[3][0] = ndcOffset.x;
+    ndcShift[3][1] = ndcOffset.y;
+    return ndcShift * proj;
+}
+
+} // namespace Play
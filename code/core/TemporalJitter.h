@@ -0,0 +1,28 @@
+#ifndef TEMPORAL_JITTER_H
+#define TEMPORAL_JITTER_H
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace Play
+{
+
+// the sub pixel camera jitter of the temporal upscaler, the camera applies it to its projection and the renderer picks
+// the offset of every frame
+
+// radical inverse of index in base, index 0 maps to 0
+float haltonSequence(uint32_t index, uint32_t base);
+
+// enough halton(2, 3) phases that every output pixel sees about eight distinct render samples
+uint32_t temporalJitterPhaseCount(float renderScale);
+
+// sub pixel camera offset of a frame in render target pixels, every offset lies in (-0.5, 0.5)
+glm::vec2 temporalJitterOffset(uint32_t frameIndex, uint32_t phaseCount);
+
+// shifts the projected image by jitter render pixels, the offset is applied after the perspective divide so it is the
+// same at every depth
+glm::mat4 jitterProjection(const glm::mat4& proj, const glm::vec2& jitter, const glm::uvec2& renderExtent);
+
+} // namespace Play
+
+#endif // TEMPORAL_JITTER_H
@@ -2,6 +2,7 @@
 
 #include "DeferRendering.h"
 #include "GaussianRenderer.h"
+#include "MaterialParameterBuffer.h"
 #include "VolumeRenderer.h"
 #include "core/runtime/VulkanRuntime.h"
 
@@ -10,6 +11,11 @@
 namespace Play
 {
 
+namespace
+{
+constexpr float kMinRenderScale = 0.25f;
+} // namespace
+
 RenderSession::RenderSession(Info info) : _info(info)
 {
     const std::string& mode = _info.renderMode;
@@ -37,6 +43,21 @@ RenderSession::RenderSession(Info info) : _info(info)
     {
         _renderMode = eGaussianRendering;
     }
+
+    if (_info.gaussianBackend == "tile")
+    {
+        _gaussianBackend = GaussianBackend::eTileCompute;
+    }
+    else if (_info.gaussianBackend != "mesh")
+    {
+        LOGW("Unknown gaussian backend %s, using the mesh shader backend\n", _info.gaussianBackend.c_str());
+    }
+
+    if (!(_info.renderScale >= kMinRenderScale && _info.renderScale <= 1.0f))
+    {
+        LOGW("Render scale %f is outside [%f, 1], clamping\n", _info.renderScale, kMinRenderScale);
+        _info.renderScale = _info.renderScale > 1.0f ? 1.0f : kMinRenderScale;
+    }
 }
 
 RenderSession::~RenderSession()
@@ -139,6 +160,8 @@ void RenderSession::renderFrame()
         return;
     }
 
+    // the parameters set while preparing the frame reach the GPU before anything is drawn with them
+    MaterialParameterBuffer::Instance().upload();
     _renderer->RenderFrame();
     _renderer->OnPostRender();
 }
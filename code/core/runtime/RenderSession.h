@@ -18,7 +18,10 @@ class RenderSession
 public:
     struct Info
     {
-        std::string renderMode = "defer";
+        std::string renderMode      = "defer";
+        std::string gaussianBackend = "mesh";
+        std::string volumeDataPath;
+        float       renderScale = 1.0f;
     };
     RenderSession(Info info);
     ~RenderSession();
@@ -46,6 +49,27 @@ public:
         return _renderMode;
     }
 
+    enum class GaussianBackend
+    {
+        eMeshShader,
+        eTileCompute
+    } _gaussianBackend = GaussianBackend::eMeshShader;
+
+    GaussianBackend getGaussianBackend() const
+    {
+        return _gaussianBackend;
+    }
+
+    const std::string& getVolumeDataPath() const
+    {
+        return _info.volumeDataPath;
+    }
+
+    float getRenderScale() const
+    {
+        return _info.renderScale;
+    }
+
 protected:
     // SceneManager
     // RenderPassCache
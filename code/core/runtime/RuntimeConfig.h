@@ -16,6 +16,12 @@ struct RuntimeConfig
     bool        validation  = false;
     bool        verbose     = false;
     std::string renderMode  = "defer";
+    // "mesh" draws splats with VK_EXT_mesh_shader, "tile" uses the compute tile rasterizer
+    std::string gaussianBackend = "mesh";
+    // .dat or name_WxHxD[_uint8].raw volume for the volume renderer, empty loads the bundled manix dataset
+    std::string volumeDataPath;
+    // internal resolution of the deferred scene passes relative to the window, the temporal upscaler restores the rest
+    float renderScale = 1.0f;
 };
 
 } // namespace Play::runtime
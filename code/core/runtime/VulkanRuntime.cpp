@@ -8,6 +8,7 @@
 
 #include "DescriptorManager.h"
 #include "FrameBufferCache.h"
+#include "MaterialParameterBuffer.h"
 #include "PipelineCacheManager.h"
 #include "RenderSession.h"
 #include "PlayAllocator.h"
@@ -193,13 +194,26 @@ bool VulkanRuntime::init(const RuntimeConfig& config, const nvvk::ContextInitInf
         return false;
     }
 
-    _renderSession = std::make_unique<Play::RenderSession>(Play::RenderSession::Info{.renderMode = _config.renderMode});
+    _renderSession = std::make_unique<Play::RenderSession>(Play::RenderSession::Info{.renderMode      = _config.renderMode,
+                                                                                     .gaussianBackend = _config.gaussianBackend,
+                                                                                     .volumeDataPath  = _config.volumeDataPath,
+                                                                                     .renderScale     = _config.renderScale});
     getEditorRegistry().clear();
+    getEditorRegistry().registerWritable<Play::DescriptorSetCacheSettings>("Descriptor Set Cache", _descriptorSetCache->getSettings());
+    getEditorRegistry().registerReadOnly<Play::DescriptorSetCacheStats>("Descriptor Set Cache Stats", _descriptorSetCache->getStats());
+    getEditorRegistry().registerWritable<Play::PipelineCacheSettings>("Pipeline Cache", _pipelineCacheManager->getSettings());
+    getEditorRegistry().registerReadOnly<Play::PipelineCacheStats>("Pipeline Cache Stats", _pipelineCacheManager->getStats());
+    getEditorRegistry().registerWritable<Play::ShaderCacheSettings>("Shader Cache", Play::ShaderManager::Instance().getSettings());
+    getEditorRegistry().registerReadOnly<Play::ShaderCacheStats>("Shader Cache Stats", Play::ShaderManager::Instance().getStats());
+    getEditorRegistry().registerReadOnly<Play::MaterialParameterStats>("Material Parameter Stats",
+                                                                       Play::MaterialParameterBuffer::Instance().getStats());
     if (!_renderSession->init())
     {
         destroy();
         return false;
     }
+    // the passes loaded their shaders, the pipelines recorded by earlier runs compile in the background from here
+    _pipelineCacheManager->precompileRecordedPipelines();
 
     _initialized = true;
 
@@ -364,6 +378,7 @@ bool VulkanRuntime::initRenderServices()
 
     Play::PlayResourceManager::Instance().initialize();
     Play::ShaderManager::Instance().init();
+    _descriptorSetCache->initDescriptorBuffer();
 
     if (!_enableDynamicRendering)
     {
@@ -384,6 +399,12 @@ void VulkanRuntime::deinitRenderServices()
         return;
     }
 
+    Play::MaterialParameterBuffer::Instance().deInit();
+    if (_descriptorSetCache)
+    {
+        _descriptorSetCache->deInit();
+    }
+
     std::vector<Play::RefCounted*> leakedObjects = _registeredObjects;
     _registeredObjects.clear();
     for (Play::RefCounted* obj : leakedObjects)
@@ -609,6 +630,9 @@ bool VulkanRuntime::prepareFrame()
     _frames[_frameIndex].reset();
     _pendingFrameWaitSemaphores.clear();
     tryCleanupDeferredTasks();
+    _descriptorSetCache->beginFrame(_frameCounter, static_cast<uint32_t>(_frames.size()));
+    _pipelineCacheManager->beginFrame(_frameCounter);
+    Play::ShaderManager::Instance().beginFrame();
 
     const VkResult result = _swapchain.acquireNextImage(_context.getDevice());
     if (result == VK_ERROR_OUT_OF_DATE_KHR)
@@ -897,7 +921,7 @@ void VulkanRuntime::updateGlobalDescriptorSet()
     writeSet[1].descriptorType  = VK_DESCRIPTOR_TYPE_SAMPLER;
     writeSet[1].pImageInfo      = &imageInfoList[1];
 
-    vkUpdateDescriptorSets(getDevice(), static_cast<uint32_t>(writeSet.size()), writeSet.data(), 0, nullptr);
+    _descriptorSetCache->updateCommonDescriptorSets(writeSet.data(), static_cast<uint32_t>(writeSet.size()));
 }
 
 void VulkanRuntime::updateGlobalTonemapperBuffer(Play::Buffer* buffer)
@@ -910,7 +934,7 @@ void VulkanRuntime::updateGlobalTonemapperBuffer(Play::Buffer* buffer)
     VkDescriptorBufferInfo toneMappingBufferInfo{};
     toneMappingBufferInfo.buffer = buffer->buffer;
     toneMappingBufferInfo.offset = 0;
-    toneMappingBufferInfo.range  = VK_WHOLE_SIZE;
+    toneMappingBufferInfo.range  = buffer->bufferSize;
 
     VkWriteDescriptorSet writeSet{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
     writeSet.dstSet          = _descriptorSetCache->getEngineDescriptorSet().set;
@@ -919,7 +943,7 @@ void VulkanRuntime::updateGlobalTonemapperBuffer(Play::Buffer* buffer)
     writeSet.descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     writeSet.pBufferInfo     = &toneMappingBufferInfo;
 
-    vkUpdateDescriptorSets(getDevice(), 1, &writeSet, 0, nullptr);
+    _descriptorSetCache->updateCommonDescriptorSets(&writeSet, 1);
 }
 
 void VulkanRuntime::prepareFrameDescriptorSet()
@@ -81,6 +81,8 @@ struct EditorUiScene
     bool              available = false;
     std::string       emptyText;
     EditorUiSceneNode root;
+    std::string       pickedNodeKey;  // of the last viewport pick, empty when it hit nothing
+    uint64_t          pickSerial = 0; // changes with every pick
 };
 
 struct EditorUiRenderMode
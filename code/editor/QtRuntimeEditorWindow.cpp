@@ -71,6 +71,26 @@ const EditorUiSceneNode* findSceneNode(const EditorUiSceneNode& node, const std:
     return nullptr;
 }
 
+// the keys of the nodes above the one with the key, root first. False when no node has it
+bool findSceneNodeAncestors(const EditorUiSceneNode& node, const std::string& key, std::vector<std::string>& ancestors)
+{
+    if (node.key == key)
+    {
+        return true;
+    }
+
+    ancestors.push_back(node.key);
+    for (const EditorUiSceneNode& child : node.children)
+    {
+        if (findSceneNodeAncestors(child, key, ancestors))
+        {
+            return true;
+        }
+    }
+    ancestors.pop_back();
+    return false;
+}
+
 QLabel* makeMutedLabel(const QString& text)
 {
     QLabel* label = new QLabel(text);
@@ -595,6 +615,19 @@ void QtRuntimeEditorWindow::updateScenePanel(RenderModePage& page, const EditorU
     page.sceneEmptyLabel->hide();
     page.sceneTree->show();
 
+    // a node picked in the viewport since the last refresh takes the selection, its ancestors are expanded to show it
+    uint64_t& pickSerial = _pickSerialByMode[renderMode.id];
+    if (renderMode.scene.pickSerial != pickSerial)
+    {
+        pickSerial                         = renderMode.scene.pickSerial;
+        _selectedNodeByMode[renderMode.id] = renderMode.scene.pickedNodeKey;
+        std::vector<std::string> ancestors;
+        if (findSceneNodeAncestors(renderMode.scene.root, renderMode.scene.pickedNodeKey, ancestors))
+        {
+            _expandedNodesByMode[renderMode.id].insert(ancestors.begin(), ancestors.end());
+        }
+    }
+
     page.updatingSceneTree = true;
     const QSignalBlocker blocker(page.sceneTree);
     syncSceneTreeNode(page, renderMode.scene.root, nullptr, 0);
@@ -65,6 +65,7 @@ private:
     std::string                                  _currentRenderMode;
     std::map<std::string, std::string>           _selectedNodeByMode;
     std::map<std::string, std::set<std::string>> _expandedNodesByMode;
+    std::map<std::string, uint64_t>              _pickSerialByMode; // of the last viewport pick taken into the selection
     std::map<std::string, RenderModePage*>       _pagesByMode;
 };
 
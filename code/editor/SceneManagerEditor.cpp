@@ -207,6 +207,10 @@ void SceneManagerEditor::buildSnapshot(EditorUiRenderMode& renderMode) const
             renderMode.scene.available = true;
             renderMode.scene.emptyText.clear();
             renderMode.scene.root = buildSceneNodeSnapshotRecursive(scene, scene.rootNode());
+
+            const SceneNodePick& pick       = _sceneManager->getLastPick();
+            renderMode.scene.pickedNodeKey = scene.isValid(pick.node) ? makeNodeKey(pick.node) : std::string();
+            renderMode.scene.pickSerial    = pick.serial;
         });
 }
 
@@ -28,21 +28,33 @@ int main(int argc, char** argv)
         // std::string renderMode = "volume";
         // std::string renderMode = "gaussian";
         parameterRegistry.add({"rendermode", "rm"}, &renderMode);
+        std::string gaussianBackend = "mesh";
+        parameterRegistry.add({"gaussianbackend", "gb"}, &gaussianBackend);
+        std::string volumeDataPath;
+        parameterRegistry.add({"volumedata", "vd"}, &volumeDataPath);
+        float renderScale = 1.0f;
+        parameterRegistry.add({"renderscale", "rs"}, &renderScale);
         parameterParser.add(parameterRegistry);
         parameterParser.parse(argc, argv);
 
         Play::runtime::RuntimeConfig runtimeConfig{
-            .windowTitle = "VulkanPlayGround SDL Runtime",
-            .width       = 1280,
-            .height      = 720,
-            .vSync       = false,
-            .validation  = validation,
-            .verbose     = verbose,
-            .renderMode  = renderMode,
+            .windowTitle     = "VulkanPlayGround SDL Runtime",
+            .width           = 1280,
+            .height          = 720,
+            .vSync           = false,
+            .validation      = validation,
+            .verbose         = verbose,
+            .renderMode      = renderMode,
+            .gaussianBackend = gaussianBackend,
+            .volumeDataPath  = volumeDataPath,
+            .renderScale     = renderScale,
         };
 
         auto afterMathExtList = Play::NsightDebugger::initInjection();
 
+        // only the gaussian mesh backend needs mesh shaders, the tile backend runs on plain compute
+        const bool useGaussianTileBackend = renderMode == "gaussian" && gaussianBackend == "tile";
+
         VkPhysicalDeviceRayQueryFeaturesKHR         rayQueryFeatures = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_QUERY_FEATURES_KHR, nullptr, VK_TRUE};
         VkPhysicalDeviceDescriptorBufferFeaturesEXT descriptorBufferFeatures = {
             VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT, nullptr, VK_TRUE, VK_TRUE, VK_TRUE, VK_TRUE};
@@ -59,6 +71,11 @@ int main(int argc, char** argv)
             .primitiveFragmentShadingRate  = VK_TRUE,
             .attachmentFragmentShadingRate = VK_TRUE,
         };
+        VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT graphicsPipelineLibraryFeatures = {
+            .sType                   = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT,
+            .pNext                   = nullptr,
+            .graphicsPipelineLibrary = VK_TRUE,
+        };
         VkPhysicalDeviceFragmentShaderBarycentricFeaturesKHR barycentricFeatures = {
             .sType                     = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_SHADER_BARYCENTRIC_FEATURES_KHR,
             .pNext                     = nullptr,
@@ -69,22 +86,29 @@ int main(int argc, char** argv)
             .instanceExtensions = {VK_EXT_DEBUG_UTILS_EXTENSION_NAME},
             .deviceExtensions =
                 {
-                    {VK_EXT_MESH_SHADER_EXTENSION_NAME, &meshShaderFeatures, true},
-                    {VK_KHR_FRAGMENT_SHADING_RATE_EXTENSION_NAME, &fsrFeatures, true},
+                    {VK_EXT_MESH_SHADER_EXTENSION_NAME, &meshShaderFeatures, !useGaussianTileBackend},
+                    // the deferred passes shade at full rate where it is missing
+                    {VK_KHR_FRAGMENT_SHADING_RATE_EXTENSION_NAME, &fsrFeatures, false},
                     {VK_KHR_SWAPCHAIN_EXTENSION_NAME},
                     {VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME},
                     {VK_KHR_RAY_QUERY_EXTENSION_NAME, &rayQueryFeatures},
                     {VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME},
                     {VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME},
                     {VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME, &descriptorBufferFeatures},
+                    // pipelines are created whole where these are missing
+                    {VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME, nullptr, false},
+                    {VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME, &graphicsPipelineLibraryFeatures, false},
                 },
             .queues                 = {VK_QUEUE_GRAPHICS_BIT, VK_QUEUE_COMPUTE_BIT, VK_QUEUE_TRANSFER_BIT},
             .applicationName        = runtimeConfig.windowTitle,
             .enableValidationLayers = runtimeConfig.validation,
             .verbose                = runtimeConfig.verbose,
         };
+        // the core features the device supports are enabled with it, the render graph's pass statistics need
+        // pipelineStatisticsQuery among them
+        vkSetup.enableAllFeatures = VK_TRUE;
         vkSetup.deviceExtensions.insert(vkSetup.deviceExtensions.end(), afterMathExtList.begin(), afterMathExtList.end());
-        if (renderMode == "gaussian")
+        if (renderMode == "gaussian" && !useGaussianTileBackend)
         {
             vkSetup.deviceExtensions.push_back({VK_KHR_FRAGMENT_SHADER_BARYCENTRIC_EXTENSION_NAME, &barycentricFeatures});
         }
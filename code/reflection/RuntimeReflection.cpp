@@ -10,6 +10,8 @@
 #include "renderer/DeferRendering.h"
 #include "renderer/GaussianPass/GaussianDrawMeshPass.h"
 #include "renderer/GaussianPass/GaussianSortPass.h"
+#include "renderer/GaussianPass/GaussianShCachePass.h"
+#include "renderer/GaussianPass/GaussianTileRasterPass.h"
 #include "renderer/GaussianRenderer.h"
 #include "renderer/GBufferConfig.h"
 #include "renderer/Renderer.h"
@@ -19,9 +21,15 @@
 #include "renderer/renderPasses/PostProcessPass.h"
 #include "renderer/renderPasses/PresentPass.h"
 #include "renderer/renderPasses/RenderPass.h"
+#include "renderer/renderPasses/ShadingRatePass.h"
+#include "renderer/renderPasses/PreDepthPass.h"
+#include "renderer/renderPasses/TemporalUpscalePass.h"
 #include "renderer/renderPasses/VolumeSkyPass.h"
 #include "renderer/renderPasses/VolumeRenderPass.h"
+#include "resourceManagement/DescriptorManager.h"
 #include "resourceManagement/Material.h"
+#include "resourceManagement/MaterialParameterBuffer.h"
+#include "resourceManagement/PipelineCacheManager.h"
 #include "resourceManagement/PlayScene.h"
 #include "resourceManagement/Resource.h"
 #include "resourceManagement/SceneManager.h"
@@ -32,7 +40,11 @@ RTTR_REGISTRATION
     rttr::registration::class_<Play::runtime::RuntimeConfig>("Play::runtime::RuntimeConfig");
     rttr::registration::class_<Play::runtime::SdlInputState>("Play::runtime::SdlInputState");
     rttr::registration::class_<Play::runtime::VulkanRuntime>("Play::runtime::VulkanRuntime");
-    rttr::registration::class_<Play::RenderSession>("Play::RenderSession");
+    rttr::registration::enumeration<Play::RenderSession::GaussianBackend>("Play::RenderSession::GaussianBackend")(
+        rttr::value("Mesh", Play::RenderSession::GaussianBackend::eMeshShader),
+        rttr::value("Tile", Play::RenderSession::GaussianBackend::eTileCompute));
+    rttr::registration::class_<Play::RenderSession>("Play::RenderSession")
+        .property_readonly("gaussianBackend", &Play::RenderSession::getGaussianBackend);
 
     rttr::registration::class_<Play::PlayCamera>("Play::PlayCamera");
     rttr::registration::class_<Play::RefCounted>("Play::RefCounted");
@@ -50,7 +62,9 @@ RTTR_REGISTRATION
     rttr::registration::class_<Play::VolumeSkyPass>("Play::VolumeSkyPass");
     rttr::registration::class_<Play::VolumeRenderPass>("Play::VolumeRenderPass");
     rttr::registration::class_<Play::GaussianSortPass>("Play::GaussianSortPass");
+    rttr::registration::class_<Play::GaussianShCachePass>("Play::GaussianShCachePass");
     rttr::registration::class_<Play::GaussianDrawMeshPass>("Play::GaussianDrawMeshPass");
+    rttr::registration::class_<Play::GaussianTileRasterPass>("Play::GaussianTileRasterPass");
 
     rttr::registration::class_<AtmosphereParameters>("AtmosphereParameters")
         .property("BottomRadius", &AtmosphereParameters::BottomRadius)(rttr::metadata("ui.label", "Bottom Radius"))
@@ -79,6 +93,249 @@ RTTR_REGISTRATION
         .property("sun_angular_radius", &AtmosphereParameters::sun_angular_radius)
         .property("mu_s_min", &AtmosphereParameters::mu_s_min);
 
+    rttr::registration::class_<Play::AtmosphereLutSettings>("Play::AtmosphereLutSettings")
+        .property("CacheLuts", &Play::AtmosphereLutSettings::CacheLuts)
+        .property("SkyViewAltitudeTolerance", &Play::AtmosphereLutSettings::SkyViewAltitudeTolerance)(
+            rttr::metadata("ui.widget", "slider"), rttr::metadata("ui.min", 0.0f), rttr::metadata("ui.max", 1.0f),
+            rttr::metadata("ui.step", 0.001f))
+        .property("PersistLuts", &Play::AtmosphereLutSettings::PersistLuts);
+
+    rttr::registration::class_<Play::AtmosphereLutStats>("Play::AtmosphereLutStats")
+        .property("TransmittanceDispatches", &Play::AtmosphereLutStats::TransmittanceDispatches)
+        .property("MultiScatteringDispatches", &Play::AtmosphereLutStats::MultiScatteringDispatches)
+        .property("SkyViewDispatches", &Play::AtmosphereLutStats::SkyViewDispatches)
+        .property("SkippedLutPasses", &Play::AtmosphereLutStats::SkippedLutPasses)
+        .property("LoadedFromDisk", &Play::AtmosphereLutStats::LoadedFromDisk);
+
+    rttr::registration::class_<Play::LightClusterSettings>("Play::LightClusterSettings")
+        .property("ClusteredShading", &Play::LightClusterSettings::ClusteredShading)
+        .property("ShowClusterHeatmap", &Play::LightClusterSettings::ShowClusterHeatmap)
+        .property("ClusterCountX", &Play::LightClusterSettings::ClusterCountX)
+        .property("ClusterCountY", &Play::LightClusterSettings::ClusterCountY)
+        .property("ClusterCountZ", &Play::LightClusterSettings::ClusterCountZ)
+        .property("MaxLightsPerCluster", &Play::LightClusterSettings::MaxLightsPerCluster)
+        .property("ClusterNearDepth", &Play::LightClusterSettings::ClusterNearDepth)(
+            rttr::metadata("ui.widget", "slider"), rttr::metadata("ui.min", 0.01f), rttr::metadata("ui.max", 10.0f),
+            rttr::metadata("ui.step", 0.01f))
+        .property("ClusterFarDepth", &Play::LightClusterSettings::ClusterFarDepth)(
+            rttr::metadata("ui.widget", "slider"), rttr::metadata("ui.min", 10.0f), rttr::metadata("ui.max", 10000.0f),
+            rttr::metadata("ui.step", 1.0f));
+
+    rttr::registration::class_<Play::LightClusterStats>("Play::LightClusterStats")
+        .property("DirectionalLights", &Play::LightClusterStats::DirectionalLights)
+        .property("LocalLights", &Play::LightClusterStats::LocalLights)
+        .property("Clusters", &Play::LightClusterStats::Clusters);
+
+    rttr::registration::class_<Play::TemporalUpscaleSettings>("Play::TemporalUpscaleSettings")
+        .property("TemporalAccumulation", &Play::TemporalUpscaleSettings::TemporalAccumulation)
+        .property("CurrentFrameWeight", &Play::TemporalUpscaleSettings::CurrentFrameWeight)(
+            rttr::metadata("ui.widget", "slider"), rttr::metadata("ui.min", 0.01f), rttr::metadata("ui.max", 1.0f),
+            rttr::metadata("ui.step", 0.01f))
+        .property("VarianceClipGamma", &Play::TemporalUpscaleSettings::VarianceClipGamma)(
+            rttr::metadata("ui.widget", "slider"), rttr::metadata("ui.min", 0.5f), rttr::metadata("ui.max", 3.0f),
+            rttr::metadata("ui.step", 0.05f))
+        .property("ShowVelocity", &Play::TemporalUpscaleSettings::ShowVelocity);
+
+    rttr::registration::class_<Play::TemporalUpscaleStats>("Play::TemporalUpscaleStats")
+        .property("RenderWidth", &Play::TemporalUpscaleStats::RenderWidth)
+        .property("RenderHeight", &Play::TemporalUpscaleStats::RenderHeight)
+        .property("OutputWidth", &Play::TemporalUpscaleStats::OutputWidth)
+        .property("OutputHeight", &Play::TemporalUpscaleStats::OutputHeight)
+        .property("JitterPhases", &Play::TemporalUpscaleStats::JitterPhases);
+
+    rttr::registration::class_<Play::ShadingRateSettings>("Play::ShadingRateSettings")
+        .property("VariableRateShading", &Play::ShadingRateSettings::VariableRateShading)
+        .property("Coarse2xGradient", &Play::ShadingRateSettings::Coarse2xGradient)(
+            rttr::metadata("ui.widget", "slider"), rttr::metadata("ui.min", 0.0f), rttr::metadata("ui.max", 0.2f),
+            rttr::metadata("ui.step", 0.001f))
+        .property("Coarse4xGradient", &Play::ShadingRateSettings::Coarse4xGradient)(
+            rttr::metadata("ui.widget", "slider"), rttr::metadata("ui.min", 0.0f), rttr::metadata("ui.max", 0.1f),
+            rttr::metadata("ui.step", 0.001f))
+        .property("MotionSensitivity", &Play::ShadingRateSettings::MotionSensitivity)(
+            rttr::metadata("ui.widget", "slider"), rttr::metadata("ui.min", 0.0f), rttr::metadata("ui.max", 2.0f),
+            rttr::metadata("ui.step", 0.01f))
+        .property("MaxShadingRate", &Play::ShadingRateSettings::MaxShadingRate);
+
+    rttr::registration::class_<Play::ShadingRateStats>("Play::ShadingRateStats")
+        .property("Supported", &Play::ShadingRateStats::Supported)
+        .property("TexelWidth", &Play::ShadingRateStats::TexelWidth)
+        .property("TexelHeight", &Play::ShadingRateStats::TexelHeight)
+        .property("RateImageWidth", &Play::ShadingRateStats::RateImageWidth)
+        .property("RateImageHeight", &Play::ShadingRateStats::RateImageHeight)
+        .property("SupportedRateMask", &Play::ShadingRateStats::SupportedRateMask);
+
+    rttr::registration::class_<Play::PreDepthSettings>("Play::PreDepthSettings")
+        .property("DepthPrepass", &Play::PreDepthSettings::DepthPrepass);
+
+    rttr::registration::class_<Play::PreDepthStats>("Play::PreDepthStats")
+        .property("StatisticsSupported", &Play::PreDepthStats::StatisticsSupported)
+        .property("PrepassDraws", &Play::PreDepthStats::PrepassDraws)
+        .property("GBufferOnlyDraws", &Play::PreDepthStats::GBufferOnlyDraws)
+        .property("GBufferFragmentInvocations", &Play::PreDepthStats::GBufferFragmentInvocations)
+        .property("GBufferOverdraw", &Play::PreDepthStats::GBufferOverdraw)
+        .property("InvocationsWithPrepass", &Play::PreDepthStats::InvocationsWithPrepass)
+        .property("InvocationsWithoutPrepass", &Play::PreDepthStats::InvocationsWithoutPrepass)
+        .property("InvocationSaving", &Play::PreDepthStats::InvocationSaving)
+        .property("HiZWidth", &Play::PreDepthStats::HiZWidth)
+        .property("HiZHeight", &Play::PreDepthStats::HiZHeight)
+        .property("HiZMipCount", &Play::PreDepthStats::HiZMipCount);
+
+    rttr::registration::class_<Play::DescriptorSetCacheSettings>("Play::DescriptorSetCacheSettings")
+        .property("MaxSetsPerLayout", &Play::DescriptorSetCacheSettings::MaxSetsPerLayout)
+        .property("StaleFrames", &Play::DescriptorSetCacheSettings::StaleFrames)
+        .property("LogLayouts", &Play::DescriptorSetCacheSettings::LogLayouts)
+        .property("DescriptorBuffer", &Play::DescriptorSetCacheSettings::DescriptorBuffer)
+        .property("UpdateTemplates", &Play::DescriptorSetCacheSettings::UpdateTemplates)
+        .property("RunUpdateBenchmark", &Play::DescriptorSetCacheSettings::RunUpdateBenchmark);
+
+    rttr::registration::class_<Play::DescriptorSetCacheStats>("Play::DescriptorSetCacheStats")
+        .property("Layouts", &Play::DescriptorSetCacheStats::Layouts)
+        .property("LiveSets", &Play::DescriptorSetCacheStats::LiveSets)
+        .property("Pools", &Play::DescriptorSetCacheStats::Pools)
+        .property("MaxPoolsPerLayout", &Play::DescriptorSetCacheStats::MaxPoolsPerLayout)
+        .property("HitRate", &Play::DescriptorSetCacheStats::HitRate)
+        .property("FrameMisses", &Play::DescriptorSetCacheStats::FrameMisses)
+        .property("EvictedSets", &Play::DescriptorSetCacheStats::EvictedSets)
+        .property("RecycledSets", &Play::DescriptorSetCacheStats::RecycledSets)
+        .property("ResetPools", &Play::DescriptorSetCacheStats::ResetPools)
+        .property("DescriptorBuffer", &Play::DescriptorSetCacheStats::DescriptorBuffer)
+        .property("BufferKB", &Play::DescriptorSetCacheStats::BufferKB)
+        .property("PersistentKB", &Play::DescriptorSetCacheStats::PersistentKB)
+        .property("RingKB", &Play::DescriptorSetCacheStats::RingKB)
+        .property("RingPeakKB", &Play::DescriptorSetCacheStats::RingPeakKB)
+        .property("RingWrites", &Play::DescriptorSetCacheStats::RingWrites)
+        .property("RingFailures", &Play::DescriptorSetCacheStats::RingFailures)
+        .property("BenchmarkSets", &Play::DescriptorSetCacheStats::BenchmarkSets)
+        .property("WriteArrayMicroseconds", &Play::DescriptorSetCacheStats::WriteArrayMicroseconds)
+        .property("TemplateMicroseconds", &Play::DescriptorSetCacheStats::TemplateMicroseconds);
+
+    rttr::registration::class_<Play::PipelineCacheSettings>("Play::PipelineCacheSettings")
+        .property("BudgetKB", &Play::PipelineCacheSettings::BudgetKB)
+        .property("MinIdleFrames", &Play::PipelineCacheSettings::MinIdleFrames)
+        .property("RecordPipelines", &Play::PipelineCacheSettings::RecordPipelines)
+        .property("PrecompileThreads", &Play::PipelineCacheSettings::PrecompileThreads)
+        .property("UseLibraries", &Play::PipelineCacheSettings::UseLibraries);
+
+    rttr::registration::class_<Play::PipelineCacheStats>("Play::PipelineCacheStats")
+        .property("Blocks", &Play::PipelineCacheStats::Blocks)
+        .property("ResidentBlocks", &Play::PipelineCacheStats::ResidentBlocks)
+        .property("ResidentKB", &Play::PipelineCacheStats::ResidentKB)
+        .property("PeakResidentKB", &Play::PipelineCacheStats::PeakResidentKB)
+        .property("Evictions", &Play::PipelineCacheStats::Evictions)
+        .property("Reloads", &Play::PipelineCacheStats::Reloads)
+        .property("RecordedPipelines", &Play::PipelineCacheStats::RecordedPipelines)
+        .property("PrecompileQueued", &Play::PipelineCacheStats::PrecompileQueued)
+        .property("PrecompiledPipelines", &Play::PipelineCacheStats::PrecompiledPipelines)
+        .property("PrecompileSkipped", &Play::PipelineCacheStats::PrecompileSkipped)
+        .property("PrecompileWaits", &Play::PipelineCacheStats::PrecompileWaits)
+        .property("PrecompileMs", &Play::PipelineCacheStats::PrecompileMs)
+        .property("InvalidatedPipelines", &Play::PipelineCacheStats::InvalidatedPipelines)
+        .property("RebuiltPipelines", &Play::PipelineCacheStats::RebuiltPipelines)
+        .property("LibrariesSupported", &Play::PipelineCacheStats::LibrariesSupported)
+        .property("LibraryParts", &Play::PipelineCacheStats::LibraryParts)
+        .property("FastLinkedPipelines", &Play::PipelineCacheStats::FastLinkedPipelines)
+        .property("OptimizedPipelines", &Play::PipelineCacheStats::OptimizedPipelines)
+        .property("LastFastLinkMs", &Play::PipelineCacheStats::LastFastLinkMs);
+
+    rttr::registration::class_<Play::ShaderCacheSettings>("Play::ShaderCacheSettings")
+        .property("CompileThreads", &Play::ShaderCacheSettings::CompileThreads)
+        .property("RunStartupBenchmark", &Play::ShaderCacheSettings::RunStartupBenchmark)
+        .property("HotReload", &Play::ShaderCacheSettings::HotReload);
+
+    rttr::registration::class_<Play::ShaderCacheStats>("Play::ShaderCacheStats")
+        .property("Shaders", &Play::ShaderCacheStats::Shaders)
+        .property("CacheHits", &Play::ShaderCacheStats::CacheHits)
+        .property("ContentHits", &Play::ShaderCacheStats::ContentHits)
+        .property("Compiled", &Play::ShaderCacheStats::Compiled)
+        .property("Failures", &Play::ShaderCacheStats::Failures)
+        .property("LoadMs", &Play::ShaderCacheStats::LoadMs)
+        .property("BenchmarkShaders", &Play::ShaderCacheStats::BenchmarkShaders)
+        .property("BenchmarkColdMs", &Play::ShaderCacheStats::BenchmarkColdMs)
+        .property("BenchmarkWarmMs", &Play::ShaderCacheStats::BenchmarkWarmMs)
+        .property("BenchmarkWarmHits", &Play::ShaderCacheStats::BenchmarkWarmHits)
+        .property("HotReloads", &Play::ShaderCacheStats::HotReloads)
+        .property("HotReloadFailures", &Play::ShaderCacheStats::HotReloadFailures)
+        .property("LastReloadMs", &Play::ShaderCacheStats::LastReloadMs)
+        .property("Permutations", &Play::ShaderCacheStats::Permutations)
+        .property("Variants", &Play::ShaderCacheStats::Variants)
+        .property("SpecializedVariants", &Play::ShaderCacheStats::SpecializedVariants);
+
+    rttr::registration::class_<Play::MaterialParameterStats>("Play::MaterialParameterStats")
+        .property("Instances", &Play::MaterialParameterStats::Instances)
+        .property("BufferBytes", &Play::MaterialParameterStats::BufferBytes)
+        .property("UploadedBytes", &Play::MaterialParameterStats::UploadedBytes)
+        .property("UploadedRanges", &Play::MaterialParameterStats::UploadedRanges);
+
+    // the component properties a scene snapshot saves, runtime state like the load request stays out
+    rttr::registration::enumeration<Play::ModelFileFormat>("Play::ModelFileFormat")(
+        rttr::value("Auto", Play::ModelFileFormat::eAuto), rttr::value("Gltf", Play::ModelFileFormat::eGltf),
+        rttr::value("Obj", Play::ModelFileFormat::eObj));
+
+    rttr::registration::class_<Play::ModelLoadingConfig>("Play::ModelLoadingConfig")
+        .property("format", &Play::ModelLoadingConfig::format)
+        .property("assimpPostProcessFlags", &Play::ModelLoadingConfig::assimpPostProcessFlags)
+        .property("extraAssimpProcessFlags", &Play::ModelLoadingConfig::extraAssimpProcessFlags)
+        .property("globalScale", &Play::ModelLoadingConfig::globalScale)
+        .property("loadMaterials", &Play::ModelLoadingConfig::loadMaterials)
+        .property("loadTextures", &Play::ModelLoadingConfig::loadTextures)
+        .property("loadLights", &Play::ModelLoadingConfig::loadLights)
+        .property("registerEmbeddedTexturePlaceholders", &Play::ModelLoadingConfig::registerEmbeddedTexturePlaceholders)
+        .property("srgbBaseColorTextures", &Play::ModelLoadingConfig::srgbBaseColorTextures)
+        .property("srgbEmissiveTextures", &Play::ModelLoadingConfig::srgbEmissiveTextures)
+        .property("textureMipLevels", &Play::ModelLoadingConfig::textureMipLevels);
+
+    rttr::registration::class_<Play::CpuSceneComponent>("Play::CpuSceneComponent").property("visible", &Play::CpuSceneComponent::visible);
+
+    rttr::registration::class_<Play::CpuModelComponent>("Play::CpuModelComponent")
+        .property("sourcePath", &Play::CpuModelComponent::sourcePath)
+        .property("loadingConfig", &Play::CpuModelComponent::loadingConfig)
+        .property("firstRenderable", &Play::CpuModelComponent::firstRenderable)
+        .property("renderableCount", &Play::CpuModelComponent::renderableCount);
+
+    rttr::registration::class_<Play::SceneGraphSettings>("Play::SceneGraphSettings")
+        .property("SnapshotPath", &Play::SceneGraphSettings::SnapshotPath)
+        .property("SaveSnapshot", &Play::SceneGraphSettings::SaveSnapshot)
+        .property("LoadSnapshot", &Play::SceneGraphSettings::LoadSnapshot)
+        .property("BVHCulling", &Play::SceneGraphSettings::BVHCulling)
+        .property("BVHRebuildCostRatio", &Play::SceneGraphSettings::BVHRebuildCostRatio);
+
+    rttr::registration::class_<Play::SceneGraphStats>("Play::SceneGraphStats")
+        .property("ModelComponents", &Play::SceneGraphStats::ModelComponents)
+        .property("SnapshotSaving", &Play::SceneGraphStats::SnapshotSaving)
+        .property("SnapshotNodes", &Play::SceneGraphStats::SnapshotNodes)
+        .property("SnapshotComponents", &Play::SceneGraphStats::SnapshotComponents)
+        .property("SnapshotMB", &Play::SceneGraphStats::SnapshotMB)
+        .property("SnapshotCaptureMs", &Play::SceneGraphStats::SnapshotCaptureMs)
+        .property("SnapshotWriteMs", &Play::SceneGraphStats::SnapshotWriteMs)
+        .property("SnapshotLoadMs", &Play::SceneGraphStats::SnapshotLoadMs)
+        .property("BVHInstances", &Play::SceneGraphStats::BVHInstances)
+        .property("BVHNodes", &Play::SceneGraphStats::BVHNodes)
+        .property("BVHCost", &Play::SceneGraphStats::BVHCost)
+        .property("BVHBuiltCost", &Play::SceneGraphStats::BVHBuiltCost)
+        .property("BVHBuilds", &Play::SceneGraphStats::BVHBuilds)
+        .property("BVHRefits", &Play::SceneGraphStats::BVHRefits)
+        .property("BVHBuildMs", &Play::SceneGraphStats::BVHBuildMs)
+        .property("BVHRefitMs", &Play::SceneGraphStats::BVHRefitMs)
+        .property("PickMs", &Play::SceneGraphStats::PickMs);
+
+    rttr::registration::class_<Play::TextureStreamingSettings>("Play::TextureStreamingSettings")
+        .property("Streaming", &Play::TextureStreamingSettings::Streaming)
+        .property("BudgetMB", &Play::TextureStreamingSettings::BudgetMB)
+        .property("MaxLoadsInFlight", &Play::TextureStreamingSettings::MaxLoadsInFlight)
+        .property("MipBias", &Play::TextureStreamingSettings::MipBias);
+
+    rttr::registration::class_<Play::TextureStreamingStats>("Play::TextureStreamingStats")
+        .property("StreamedTextures", &Play::TextureStreamingStats::StreamedTextures)
+        .property("LoadsInFlight", &Play::TextureStreamingStats::LoadsInFlight)
+        .property("FeedbackTextures", &Play::TextureStreamingStats::FeedbackTextures)
+        .property("Bias", &Play::TextureStreamingStats::Bias)
+        .property("ResidentMB", &Play::TextureStreamingStats::ResidentMB)
+        .property("WantedMB", &Play::TextureStreamingStats::WantedMB)
+        .property("StreamedIn", &Play::TextureStreamingStats::StreamedIn)
+        .property("Evicted", &Play::TextureStreamingStats::Evicted)
+        .property("FailedLoads", &Play::TextureStreamingStats::FailedLoads)
+        .property("UpdateMs", &Play::TextureStreamingStats::UpdateMs);
+
     rttr::registration::class_<Play::VolumeRenderParameters>("Play::VolumeRenderParameters")
         .property("Density", &Play::VolumeRenderParameters::Density)(
             rttr::metadata("ui.widget", "slider"), rttr::metadata("ui.min", 0.0f), rttr::metadata("ui.max", 500.0f),
@@ -88,7 +345,69 @@ RTTR_REGISTRATION
             rttr::metadata("ui.step", 0.01f))
         .property("StepCount", &Play::VolumeRenderParameters::StepCount)
         .property("BBoxMin", &Play::VolumeRenderParameters::BBoxMin)
-        .property("BBoxMax", &Play::VolumeRenderParameters::BBoxMax);
+        .property("BBoxMax", &Play::VolumeRenderParameters::BBoxMax)
+        .property("EmptySpaceSkipping", &Play::VolumeRenderParameters::EmptySpaceSkipping);
+
+    rttr::registration::class_<Play::VolumeRenderStats>("Play::VolumeRenderStats")
+        .property("EmptyBrickRatio", &Play::VolumeRenderStats::EmptyBrickRatio)
+        .property("GenRaySamplesPerPixel", &Play::VolumeRenderStats::GenRaySamplesPerPixel)
+        .property("RadianceSamplesPerPixel", &Play::VolumeRenderStats::RadianceSamplesPerPixel)
+        .property("FullMarchSamplesPerPixel", &Play::VolumeRenderStats::FullMarchSamplesPerPixel)
+        .property("SkippingSamplesPerPixel", &Play::VolumeRenderStats::SkippingSamplesPerPixel)
+        .property("VolumeLoadMs", &Play::VolumeRenderStats::VolumeLoadMs)
+        .property("VolumeLoadPeakRssMB", &Play::VolumeRenderStats::VolumeLoadPeakRssMB);
+
+    rttr::registration::class_<Play::GaussianSortSettings>("Play::GaussianSortSettings")
+        .property("EnableSortReuse", &Play::GaussianSortSettings::EnableSortReuse)
+        .property("ViewAngleThreshold", &Play::GaussianSortSettings::ViewAngleThreshold)(
+            rttr::metadata("ui.widget", "slider"), rttr::metadata("ui.min", 0.0f), rttr::metadata("ui.max", 30.0f),
+            rttr::metadata("ui.step", 0.1f))
+        .property("ViewTranslationThreshold", &Play::GaussianSortSettings::ViewTranslationThreshold)(
+            rttr::metadata("ui.widget", "slider"), rttr::metadata("ui.min", 0.0f), rttr::metadata("ui.max", 1.0f),
+            rttr::metadata("ui.step", 0.005f))
+        .property("MaxSortAge", &Play::GaussianSortSettings::MaxSortAge)
+        .property("RefinePassCount", &Play::GaussianSortSettings::RefinePassCount)
+        .property("RecordCameraPath", &Play::GaussianSortSettings::RecordCameraPath)
+        .property("RunSimulation", &Play::GaussianSortSettings::RunSimulation);
+
+    rttr::registration::class_<Play::GaussianSortStats>("Play::GaussianSortStats")
+        .property("SortAge", &Play::GaussianSortStats::SortAge)
+        .property("FullSortCount", &Play::GaussianSortStats::FullSortCount)
+        .property("ReusedFrameCount", &Play::GaussianSortStats::ReusedFrameCount)
+        .property("FullSortMs", &Play::GaussianSortStats::FullSortMs)
+        .property("RefineMs", &Play::GaussianSortStats::RefineMs)
+        .property("RecordedFrames", &Play::GaussianSortStats::RecordedFrames);
+
+    rttr::registration::class_<Play::GaussianShCacheSettings>("Play::GaussianShCacheSettings")
+        .property("EnableCache", &Play::GaussianShCacheSettings::EnableCache)
+        .property("AngleThreshold", &Play::GaussianShCacheSettings::AngleThreshold)(
+            rttr::metadata("ui.widget", "slider"), rttr::metadata("ui.min", 0.0f), rttr::metadata("ui.max", 15.0f),
+            rttr::metadata("ui.step", 0.1f))
+        .property("MaxCacheAge", &Play::GaussianShCacheSettings::MaxCacheAge)
+        .property("RunValidation", &Play::GaussianShCacheSettings::RunValidation);
+
+    rttr::registration::class_<Play::GaussianShCacheStats>("Play::GaussianShCacheStats")
+        .property("ChunkCount", &Play::GaussianShCacheStats::ChunkCount)
+        .property("CacheBytes", &Play::GaussianShCacheStats::CacheBytes)
+        .property("ValidatedSplats", &Play::GaussianShCacheStats::ValidatedSplats)
+        .property("ValidationMaxError", &Play::GaussianShCacheStats::ValidationMaxError)
+        .property("ValidationMeanError", &Play::GaussianShCacheStats::ValidationMeanError);
+
+    rttr::registration::class_<Play::GaussianTileSettings>("Play::GaussianTileSettings")
+        .property("MaxEntriesPerSplat", &Play::GaussianTileSettings::MaxEntriesPerSplat)
+        .property("RunReferenceDiff", &Play::GaussianTileSettings::RunReferenceDiff)
+        .property("DiffTolerance", &Play::GaussianTileSettings::DiffTolerance)(
+            rttr::metadata("ui.widget", "slider"), rttr::metadata("ui.min", 0.0f), rttr::metadata("ui.max", 0.5f),
+            rttr::metadata("ui.step", 0.001f));
+
+    rttr::registration::class_<Play::GaussianTileStats>("Play::GaussianTileStats")
+        .property("VisibleSplats", &Play::GaussianTileStats::VisibleSplats)
+        .property("TileEntries", &Play::GaussianTileStats::TileEntries)
+        .property("OverflowSplats", &Play::GaussianTileStats::OverflowSplats)
+        .property("DiffMaxError", &Play::GaussianTileStats::DiffMaxError)
+        .property("DiffMeanError", &Play::GaussianTileStats::DiffMeanError)
+        .property("DiffPsnr", &Play::GaussianTileStats::DiffPsnr)
+        .property("DiffMismatchedPixels", &Play::GaussianTileStats::DiffMismatchedPixels);
 
     rttr::registration::class_<shaderio::TonemapperData>("shaderio::TonemapperData")
         .property("isActive", &shaderio::TonemapperData::isActive)
@@ -5,6 +5,9 @@
 #include "renderPasses/VolumeSkyPass.h"
 #include "renderPasses/GBufferPass.h"
 #include "renderPasses/LightPass.h"
+#include "renderPasses/ShadingRatePass.h"
+#include "renderPasses/PreDepthPass.h"
+#include "renderPasses/TemporalUpscalePass.h"
 #include "SceneManager.h"
 #include "core/runtime/VulkanRuntime.h"
 namespace Play
@@ -27,11 +30,29 @@ DeferRenderer::~DeferRenderer()
 
 void DeferRenderer::setupPasses()
 {
+    // classifies from last frame's lighting, so it runs before anything of this frame is drawn
+    auto shadingRatePass = std::make_unique<ShadingRatePass>(this);
+    _shadingRatePass     = shadingRatePass.get();
+    _passes.push_back(std::move(shadingRatePass));
+    // lays down the depth of the gbuffer's opaque items and reduces it into the depth pyramid
+    auto gbufferPass = std::make_unique<GBufferPass>(this);
+    _passes.push_back(std::make_unique<PreDepthPass>(this, gbufferPass.get()));
     _passes.push_back(std::make_unique<VolumeSkyPass>(this));
-    _passes.push_back(std::make_unique<GBufferPass>(this));
+    _passes.push_back(std::move(gbufferPass));
     _passes.push_back(std::make_unique<LightPass>(this));
+    _passes.push_back(std::make_unique<TemporalUpscalePass>(this));
     _passes.push_back(std::make_unique<PostProcessPass>(this));
     _passes.push_back(std::make_unique<PresentPass>(this));
 }
 
+VkExtent2D DeferRenderer::getShadingRateTexelSize() const
+{
+    return _shadingRatePass ? _shadingRatePass->getTexelSize() : VkExtent2D{0, 0};
+}
+
+float DeferRenderer::getRenderScale() const
+{
+    return _view ? _view->getRenderScale() : 1.0f;
+}
+
 } // namespace Play
@@ -17,19 +17,26 @@ enum class DeferPasses
     eCount
 };
 
+class ShadingRatePass;
+
 class DeferRenderer : public Renderer
 {
 public:
     explicit DeferRenderer(RenderSession& session);
     ~DeferRenderer() override;
 
+    // texel size of the shading rate image the scene passes attach, zero without attachment shading rate support
+    VkExtent2D getShadingRateTexelSize() const;
+
     RTTR_ENABLE(Renderer)
 
 protected:
-    void setupPasses() override;
+    void  setupPasses() override;
+    float getRenderScale() const override;
 
 private:
     std::bitset<size_t(DeferPasses::eCount)> _renderPasses;
+    ShadingRatePass*                         _shadingRatePass = nullptr;
 };
 } // namespace Play
 #endif // DEFERRENDERING_H
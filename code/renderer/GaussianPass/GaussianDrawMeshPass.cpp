@@ -67,6 +67,7 @@ void GaussianDrawMeshPass::build(RDG::RDGBuilder* rdgBuilder)
                                               .finish();
 
     RDG::RDGBufferRef                       sceneUniformBuffer = rdgBuilder->getBuffer("sceneUniformBuffer");
+    RDG::RDGBufferRef                       colorCacheBuffer   = rdgBuilder->getBuffer("shColorCache");
     [[maybe_unused]] RDG::RenderPassNodeRef meshDrawPass =
         rdgBuilder->createRenderPass("MeshDrawPass")
             .color(0, colorAttachment, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE)
@@ -75,6 +76,7 @@ void GaussianDrawMeshPass::build(RDG::RDGBuilder* rdgBuilder)
             .storageRead(1, indicesBuffer, VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT)
             .read(2, sceneUniformBuffer, VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT)
             .storageWrite(3, testStorageBuffer, VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT)
+            .storageRead(4, colorCacheBuffer, VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT)
             .execute(
                 [this, indirectBuffer](RDG::PassNode* node, RDG::RenderContext& context)
                 {
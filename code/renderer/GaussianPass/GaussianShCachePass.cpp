@@ -0,0 +1,200 @@
+#include "GaussianShCachePass.h"
+#include "GaussianShEvaluator.h"
+#include "renderer/GaussianRenderer.h"
+#include "Resource.h"
+#include "SceneManager.h"
+#include "ShaderManager.hpp"
+#include "editor/EditorRegistry.h"
+#include "newShaders/gaussian/gaussianLib.h.slang"
+#include <glm/gtc/packing.hpp>
+
+namespace Play
+{
+namespace
+{
+// splats checked by one validation run, spread evenly over the scene
+constexpr uint32_t kMaxValidationSamples = 16384;
+} // namespace
+
+GaussianShCachePass::GaussianShCachePass(GaussianRenderer* renderer) : _ownedRenderer(renderer) {}
+
+GaussianShCachePass::~GaussianShCachePass() = default;
+
+void GaussianShCachePass::createChunkBounds()
+{
+    const GaussianScene&       scene      = _ownedRenderer->getSceneManager()->getGaussianScene();
+    const std::vector<float3>& positions  = scene.getPositions();
+    const uint32_t             splatCount = scene.getVertexCount();
+    _chunkCount                           = (splatCount + kGaussianShChunkSize - 1) / kGaussianShChunkSize;
+
+    _chunkBoundsBuffer = RefPtr<Buffer>(new Buffer("GaussianShChunkBounds", VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT,
+                                                   sizeof(float4) * std::max(_chunkCount, 1u),
+                                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+    float4* bounds = reinterpret_cast<float4*>(_chunkBoundsBuffer->mapping);
+    for (uint32_t chunk = 0; chunk < _chunkCount; ++chunk)
+    {
+        const uint32_t first = chunk * kGaussianShChunkSize;
+        const uint32_t last  = std::min(first + kGaussianShChunkSize, splatCount);
+        glm::vec3      center(0.0f);
+        for (uint32_t splat = first; splat < last; ++splat)
+        {
+            center += positions[splat];
+        }
+        center /= float(last - first);
+        float radius = 0.0f;
+        for (uint32_t splat = first; splat < last; ++splat)
+        {
+            radius = std::max(radius, glm::length(positions[splat] - center));
+        }
+        bounds[chunk] = float4(center, radius);
+    }
+}
+
+void GaussianShCachePass::init()
+{
+    createChunkBounds();
+
+    auto cacheComp = ShaderManager::Instance().loadShaderFromFile("gaussianShCache", "./gaussian/gaussianShCache.comp.slang", ShaderStage::eCompute);
+    _cachePipeline.setShader(cacheComp);
+    _cachePipeline.setPushConstant<GaussianShCacheConstant>();
+
+    _stats.ChunkCount = _chunkCount;
+    _stats.CacheBytes = uint32_t(sizeof(uint32_t) * 2 * _ownedRenderer->getSceneManager()->getGaussianScene().getVertexCount() +
+                                 sizeof(GaussianShChunkState) * _chunkCount);
+
+    vkDriver->getEditorRegistry().registerWritable<GaussianShCacheSettings>("Gaussian SH Cache", _settings, editor::EditorRenderMode::Gaussian);
+    vkDriver->getEditorRegistry().registerReadOnly<GaussianShCacheStats>("Gaussian SH Cache Stats", _stats, editor::EditorRenderMode::Gaussian);
+}
+
+void GaussianShCachePass::resolveValidation(uint32_t frameSlot)
+{
+    if (_pendingValidationSlot != int32_t(frameSlot))
+    {
+        return;
+    }
+    _pendingValidationSlot = -1;
+
+    const GaussianScene&       scene      = _ownedRenderer->getSceneManager()->getGaussianScene();
+    const std::vector<float3>& positions  = scene.getPositions();
+    const std::vector<float4>& colors     = scene.getColors();
+    const std::vector<float>&  shRest     = scene.getShRestCoefficients();
+    const uint32_t             splatCount = scene.getVertexCount();
+    const uint32_t             shStride   = splatCount > 0 ? uint32_t(shRest.size() / splatCount) : 0;
+
+    // the cached color was evaluated from the camera position stored with its chunk, so that is the oracle's view point
+    const uint32_t*             cache  = reinterpret_cast<const uint32_t*>(_validationBuffer->mapping);
+    const GaussianShChunkState* states = reinterpret_cast<const GaussianShChunkState*>(cache + size_t(splatCount) * 2);
+    const uint32_t              stride = std::max(splatCount / kMaxValidationSamples, 1u);
+
+    double   errorSum = 0.0;
+    float    maxError = 0.0f;
+    uint32_t samples  = 0;
+    for (uint32_t splatIndex = 0; splatIndex < splatCount; splatIndex += stride)
+    {
+        const GaussianShChunkState& state = states[splatIndex / kGaussianShChunkSize];
+        if (state.cameraPosition.w == 0.0f)
+        {
+            continue;
+        }
+        const glm::vec3 viewDirection = glm::normalize(positions[splatIndex] - glm::vec3(state.cameraPosition));
+        const glm::vec4 expected      = colors[splatIndex] + glm::vec4(evaluateGaussianShRadiance(shRest, shStride, splatIndex, viewDirection), 0.0f);
+        const glm::vec4 cached(glm::unpackHalf2x16(cache[size_t(splatIndex) * 2]), glm::unpackHalf2x16(cache[size_t(splatIndex) * 2 + 1]));
+        const glm::vec4 delta = glm::abs(expected - cached);
+        const float     error = std::max(std::max(delta.x, delta.y), std::max(delta.z, delta.w));
+        maxError              = std::max(maxError, error);
+        errorSum += error;
+        ++samples;
+    }
+    _stats.ValidatedSplats     = samples;
+    _stats.ValidationMaxError  = maxError;
+    _stats.ValidationMeanError = samples > 0 ? float(errorSum / samples) : 0.0f;
+    LOGI("Gaussian sh cache vs cpu evaluator: max %.5f mean %.6f over %u splats\n", maxError, _stats.ValidationMeanError, samples);
+}
+
+void GaussianShCachePass::build(RDG::RDGBuilder* rdgBuilder)
+{
+    const uint32_t splatCount = _ownedRenderer->getSceneManager()->getGaussianScene().getVertexCount();
+    const size_t   cacheSize  = sizeof(uint32_t) * 2 * std::max(splatCount, 1u);
+    const size_t   stateSize  = sizeof(GaussianShChunkState) * std::max(_chunkCount, 1u);
+    // the rdg recreates its transient buffers on resize, start over from invalid chunks
+    _resetStates           = true;
+    _pendingValidationSlot = -1;
+
+    _validationBuffer = RefPtr<Buffer>(new Buffer("GaussianShCacheReadback", VK_BUFFER_USAGE_2_TRANSFER_DST_BIT, cacheSize + stateSize,
+                                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+
+    RDG::RDGBufferRef chunkBoundsBuffer = rdgBuilder->createBuffer("shChunkBounds").Import(_chunkBoundsBuffer.get()).finish();
+    RDG::RDGBufferRef chunkStatesBuffer = rdgBuilder->createBuffer("shChunkStates")
+                                              .Location(true)
+                                              .Range(VK_WHOLE_SIZE)
+                                              .Size(stateSize)
+                                              .UsageFlags(VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT)
+                                              .finish();
+    RDG::RDGBufferRef colorCacheBuffer = rdgBuilder->createBuffer("shColorCache")
+                                             .Location(true)
+                                             .Range(VK_WHOLE_SIZE)
+                                             .Size(cacheSize)
+                                             .UsageFlags(VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT)
+                                             .finish();
+    RDG::RDGBufferRef sceneUniformBuffer = rdgBuilder->getBuffer("sceneUniformBuffer");
+
+    [[maybe_unused]] RDG::ComputePassNodeRef cachePass =
+        rdgBuilder->createComputePass("GaussianShCachePass")
+            .storageRead(0, chunkBoundsBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .storageWrite(1, chunkStatesBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .storageWrite(2, colorCacheBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .read(3, sceneUniformBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .execute(
+                [this, chunkStatesBuffer, colorCacheBuffer, cacheSize, stateSize](RDG::PassNode* node, RDG::RenderContext& context)
+                {
+                    const uint32_t frameSlot = vkDriver->getFrameCycleIndex();
+                    resolveValidation(frameSlot);
+                    const bool validate = _settings.RunValidation && _pendingValidationSlot < 0;
+                    if (validate)
+                    {
+                        _settings.RunValidation = false;
+                        _pendingValidationSlot  = int32_t(frameSlot);
+                    }
+
+                    if (_resetStates)
+                    {
+                        _resetStates = false;
+                        vkCmdFillBuffer(context._currCmdBuffer, chunkStatesBuffer->getRHI()->buffer, 0, VK_WHOLE_SIZE, 0);
+                        VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+                        barrier.srcAccessMask   = VK_ACCESS_TRANSFER_WRITE_BIT;
+                        barrier.dstAccessMask   = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+                        vkCmdPipelineBarrier(context._currCmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                                             &barrier, 0, NULL, 0, NULL);
+                    }
+
+                    GaussianShCacheConstant constant{};
+                    constant.cameraBufferDeviceAddress = _ownedRenderer->getCurrentCameraBuffer()->address;
+                    constant.frameIndex                = _frameIndex++;
+                    constant.cosAngleThreshold         = std::cos(glm::radians(std::max(_settings.AngleThreshold, 0.0f)));
+                    constant.maxCacheAge               = _settings.MaxCacheAge;
+                    constant.chunkCount                = _chunkCount;
+                    constant.forceRefresh              = _settings.EnableCache ? 0u : 1u;
+                    context.bindPipeline(_cachePipeline);
+                    context.bindPushConstant(constant);
+                    vkCmdDispatch(context._currCmdBuffer, _chunkCount, 1, 1);
+
+                    if (validate)
+                    {
+                        VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+                        barrier.srcAccessMask   = VK_ACCESS_SHADER_WRITE_BIT;
+                        barrier.dstAccessMask   = VK_ACCESS_TRANSFER_READ_BIT;
+                        vkCmdPipelineBarrier(context._currCmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1,
+                                             &barrier, 0, NULL, 0, NULL);
+                        VkBufferCopy regions[2] = {{0, 0, cacheSize}, {0, cacheSize, stateSize}};
+                        vkCmdCopyBuffer(context._currCmdBuffer, colorCacheBuffer->getRHI()->buffer, _validationBuffer->buffer, 1, &regions[0]);
+                        vkCmdCopyBuffer(context._currCmdBuffer, chunkStatesBuffer->getRHI()->buffer, _validationBuffer->buffer, 1, &regions[1]);
+                        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                        barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+                        vkCmdPipelineBarrier(context._currCmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0,
+                                             NULL, 0, NULL);
+                    }
+                })
+            .finish();
+}
+
+} // namespace Play
@@ -0,0 +1,61 @@
+#ifndef GAUSSIAN_SH_CACHE_PASS_H
+#define GAUSSIAN_SH_CACHE_PASS_H
+#include "renderpasses/RenderPass.h"
+#include "RDG/RDG.h"
+#include "core/RefCounted.h"
+#include <rttr/rttr_enable.h>
+
+namespace Play
+{
+class GaussianRenderer;
+
+struct GaussianShCacheSettings
+{
+    bool     EnableCache    = true;
+    float    AngleThreshold = 1.0f;  // degrees the chunk view direction may drift before its colors are re-evaluated
+    uint32_t MaxCacheAge    = 0;     // frames before a visible chunk is refreshed anyway, 0 disables
+    bool     RunValidation  = false; // one-shot trigger, checks the cache against the cpu sh evaluator
+};
+
+struct GaussianShCacheStats
+{
+    uint32_t ChunkCount          = 0;
+    uint32_t CacheBytes          = 0;
+    uint32_t ValidatedSplats     = 0;
+    float    ValidationMaxError  = 0.0f;
+    float    ValidationMeanError = 0.0f;
+};
+
+// evaluates the sh color of every splat into a compact rgba16f cache that the mesh draw reads instead of the
+// full coefficient set. Chunks of consecutive splats are only refreshed when their view direction changed.
+class GaussianShCachePass : public BasePass
+{
+public:
+    GaussianShCachePass(GaussianRenderer* renderer);
+    ~GaussianShCachePass();
+    void init() override;
+    void build(RDG::RDGBuilder* rdgBuilder) override;
+
+    RTTR_ENABLE(BasePass)
+
+private:
+    void createChunkBounds();
+    void resolveValidation(uint32_t frameSlot);
+
+    GaussianRenderer*               _ownedRenderer = nullptr;
+    ComputePipelineStateInitializer _cachePipeline;
+    GaussianShCacheSettings         _settings;
+    GaussianShCacheStats            _stats;
+    RefPtr<Buffer>                  _chunkBoundsBuffer;
+    uint32_t                        _chunkCount  = 0;
+    uint32_t                        _frameIndex  = 0;
+    bool                            _resetStates = true;
+
+    // host visible copy of the cache and chunk states for the cpu oracle
+    RefPtr<Buffer> _validationBuffer;
+    int32_t        _pendingValidationSlot = -1;
+};
+
+} // namespace Play
+
+#endif // GAUSSIAN_SH_CACHE_PASS_H
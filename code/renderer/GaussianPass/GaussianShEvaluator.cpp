@@ -0,0 +1,61 @@
+#include "GaussianShEvaluator.h"
+#include "newShaders/gaussian/gaussianLib.h.slang"
+
+namespace Play
+{
+
+uint32_t getGaussianShDegree(uint32_t shRestCoefficientCount)
+{
+    const uint32_t coefficientsPerChannel = shRestCoefficientCount / 3;
+    uint32_t       shDegree               = 0;
+    uint32_t       accumulated            = 0;
+    while (accumulated < coefficientsPerChannel)
+    {
+        ++shDegree;
+        accumulated += 2 * shDegree + 1;
+    }
+    return shDegree;
+}
+
+glm::vec3 evaluateGaussianShRadiance(std::span<const float> shRestCoefficients, uint32_t shStride, uint32_t splatIndex,
+                                     const glm::vec3& viewDirection)
+{
+    if (shStride == 0)
+    {
+        return glm::vec3(0.0f);
+    }
+    const uint32_t shDegree         = getGaussianShDegree(shStride);
+    const uint32_t coeffsPerChannel = shStride / 3;
+    const float*   base             = shRestCoefficients.data() + size_t(splatIndex) * shStride;
+
+    // channel-major: [R0..Rn, G0..Gn, B0..Bn]
+    auto sh = [&](uint32_t index)
+    {
+        return glm::vec3(base[index], base[coeffsPerChannel + index], base[coeffsPerChannel * 2 + index]);
+    };
+
+    const float x = viewDirection.x;
+    const float y = viewDirection.y;
+    const float z = viewDirection.z;
+
+    glm::vec3 rgb(0.0f);
+    if (shDegree >= 1)
+    {
+        rgb += SH_C1 * (-sh(0) * y + sh(1) * z - sh(2) * x);
+    }
+    if (shDegree >= 2)
+    {
+        rgb += (SH_C2[0] * x * y) * sh(3) + (SH_C2[1] * y * z) * sh(4) + (SH_C2[2] * (2.0f * z * z - x * x - y * y)) * sh(5) +
+               (SH_C2[3] * x * z) * sh(6) + (SH_C2[4] * (x * x - y * y)) * sh(7);
+    }
+    if (shDegree >= 3)
+    {
+        rgb += SH_C3[0] * sh(8) * (3.0f * x * x - y * y) * y + SH_C3[1] * sh(9) * x * y * z +
+               SH_C3[2] * sh(10) * (4.0f * z * z - x * x - y * y) * y + SH_C3[3] * sh(11) * z * (2.0f * z * z - 3.0f * x * x - 3.0f * y * y) +
+               SH_C3[4] * sh(12) * x * (4.0f * z * z - x * x - y * y) + SH_C3[5] * sh(13) * (x * x - y * y) * z +
+               SH_C3[6] * sh(14) * x * (x * x - 3.0f * y * y);
+    }
+    return rgb;
+}
+
+} // namespace Play
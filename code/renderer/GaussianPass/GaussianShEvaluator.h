@@ -0,0 +1,20 @@
+#ifndef GAUSSIAN_SH_EVALUATOR_H
+#define GAUSSIAN_SH_EVALUATOR_H
+#include <cstdint>
+#include <span>
+#include <glm/glm.hpp>
+
+namespace Play
+{
+
+// sh degree implied by the per splat rest coefficient count (all three channels), mirrors getShDegree in gaussianSplatLib
+uint32_t getGaussianShDegree(uint32_t shRestCoefficientCount);
+
+// cpu oracle of fetchViewDependentRadiance: evaluates the view dependent part of the sh color, coefficients are
+// channel-major per splat like the gpu buffer
+glm::vec3 evaluateGaussianShRadiance(std::span<const float> shRestCoefficients, uint32_t shStride, uint32_t splatIndex,
+                                     const glm::vec3& viewDirection);
+
+} // namespace Play
+
+#endif // GAUSSIAN_SH_EVALUATOR_H
@@ -7,9 +7,17 @@
 #include "RDG/RDG.h"
 #include "newShaders/gaussian/gaussianLib.h.slang"
 #include "PConstantType.h.slang"
+#include "editor/EditorRegistry.h"
+#include <algorithm>
 
 namespace Play
 {
+namespace
+{
+constexpr uint32_t kMaxRecordedCameraFrames = 4096;
+constexpr size_t   kSimulationSplatBudget   = 65536;
+} // namespace
+
 GaussianSortPass::GaussianSortPass(GaussianRenderer* renderer)
 {
     _ownedRenderer = renderer;
@@ -17,6 +25,10 @@ GaussianSortPass::GaussianSortPass(GaussianRenderer* renderer)
 GaussianSortPass::~GaussianSortPass()
 {
     vrdxDestroySorter(_sorter);
+    if (_timestampPool != VK_NULL_HANDLE)
+    {
+        vkDestroyQueryPool(vkDriver->getDevice(), _timestampPool, nullptr);
+    }
 }
 
 void GaussianSortPass::init()
@@ -28,10 +40,88 @@ void GaussianSortPass::init()
     auto distanceComp = ShaderManager::Instance().loadShaderFromFile("DistanceComp", "./gaussian/gaussianCulling.comp.slang", ShaderStage::eCompute);
     _distancePipeline.setShader(distanceComp);
     _distancePipeline.setPushConstant<PerFrameConstant>();
+
+    auto refreshComp =
+        ShaderManager::Instance().loadShaderFromFile("SortRefreshComp", "./gaussian/gaussianSortRefresh.comp.slang", ShaderStage::eCompute);
+    _refreshPipeline.setShader(refreshComp);
+    _refreshPipeline.setPushConstant<PerFrameConstant>();
+
+    auto refineComp =
+        ShaderManager::Instance().loadShaderFromFile("SortRefineComp", "./gaussian/gaussianSortRefine.comp.slang", ShaderStage::eCompute);
+    _refinePipeline.setShader(refineComp);
+    _refinePipeline.setPushConstant<GaussianSortRefineConstant>();
+
+    const uint32_t        frameCycleSize = vkDriver->getFrameCycleSize();
+    VkQueryPoolCreateInfo queryInfo      = {VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+    queryInfo.queryType                  = VK_QUERY_TYPE_TIMESTAMP;
+    queryInfo.queryCount                 = frameCycleSize * 2;
+    if (vkCreateQueryPool(vkDriver->getDevice(), &queryInfo, nullptr, &_timestampPool) != VK_SUCCESS)
+    {
+        LOGW("Failed to create gaussian sort timestamp pool, sort timings disabled\n");
+        _timestampPool = VK_NULL_HANDLE;
+    }
+    _slotHasTimestamps.assign(frameCycleSize, false);
+    _slotWasFullSort.assign(frameCycleSize, false);
+
+    vkDriver->getEditorRegistry().registerWritable<GaussianSortSettings>("Gaussian Sort", _settings, editor::EditorRenderMode::Gaussian);
+    vkDriver->getEditorRegistry().registerReadOnly<GaussianSortStats>("Gaussian Sort Stats", _stats, editor::EditorRenderMode::Gaussian);
+}
+
+void GaussianSortPass::readSortTimestamps(uint32_t frameSlot)
+{
+    if (_timestampPool == VK_NULL_HANDLE || !_slotHasTimestamps[frameSlot])
+    {
+        return;
+    }
+    // the frame slot was fenced in prepareFrame, so its queries are complete by now
+    uint64_t timestamps[2] = {};
+    VkResult result        = vkGetQueryPoolResults(vkDriver->getDevice(), _timestampPool, frameSlot * 2, 2, sizeof(timestamps), timestamps,
+                                                   sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS)
+    {
+        return;
+    }
+    const double period = vkDriver->_physicalDeviceProperties2.properties.limits.timestampPeriod;
+    const float  ms     = float(double(timestamps[1] - timestamps[0]) * period * 1e-6);
+    if (_slotWasFullSort[frameSlot])
+    {
+        _stats.FullSortMs = ms;
+    }
+    else
+    {
+        _stats.RefineMs = ms;
+    }
+}
+
+void GaussianSortPass::runSortSimulation()
+{
+    const std::vector<float3>& positions = _ownedRenderer->getSceneManager()->getGaussianScene().getPositions();
+    if (_recordedPath.empty() || positions.empty())
+    {
+        LOGW("Gaussian sort simulation needs a recorded camera path and a loaded scene\n");
+        return;
+    }
+    // the cpu replay does a reference sort per frame, keep it to a strided subset of the splats
+    const size_t           stride = (positions.size() + kSimulationSplatBudget - 1) / kSimulationSplatBudget;
+    std::vector<glm::vec3> sampled;
+    sampled.reserve(positions.size() / stride + 1);
+    for (size_t index = 0; index < positions.size(); index += stride)
+    {
+        sampled.push_back(positions[index]);
+    }
+
+    GaussianSortSimulationReport report = simulateGaussianSortReuse(sampled, _recordedPath, _settings);
+    LOGI("Gaussian sort simulation: %zu frames, %zu splats, %u full sorts\n", report.frames.size(), sampled.size(), report.fullSortCount);
+    LOGI("  adjacent inversions mean %.5f max %.5f, rank displacement mean %.5f max %.5f\n", report.meanInversionRatio,
+         report.maxInversionRatio, report.meanRankDisplacement, report.maxRankDisplacement);
 }
 
 void GaussianSortPass::build(RDG::RDGBuilder* rdgBuilder)
 {
+    // transient buffers are recreated with the builder, the previous order is gone
+    _tracker.invalidate();
+    std::fill(_slotHasTimestamps.begin(), _slotHasTimestamps.end(), false);
+
     RDG::RDGBufferRef distanceBuffer =
         rdgBuilder->createBuffer("distanceBuffer")
             .Location(true)
@@ -74,6 +164,71 @@ void GaussianSortPass::build(RDG::RDGBuilder* rdgBuilder)
             .execute(
                 [this, indirectBuffer](RDG::PassNode* node, RDG::RenderContext& context)
                 {
+                    const uint32_t frameSlot = vkDriver->getFrameCycleIndex();
+                    readSortTimestamps(frameSlot);
+                    if (_timestampPool != VK_NULL_HANDLE)
+                    {
+                        vkCmdResetQueryPool(context._currCmdBuffer, _timestampPool, frameSlot * 2, 2);
+                        vkCmdWriteTimestamp(context._currCmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _timestampPool, frameSlot * 2);
+                    }
+
+                    const glm::mat4& viewMatrix = _ownedRenderer->getCurrentCameraData().viewMatrix;
+                    if (_settings.RecordCameraPath && _recordedPath.size() < kMaxRecordedCameraFrames)
+                    {
+                        _recordedPath.push_back(viewMatrix);
+                    }
+                    if (_settings.RunSimulation)
+                    {
+                        _settings.RunSimulation = false;
+                        runSortSimulation();
+                    }
+
+                    const uint32_t splatCount     = _ownedRenderer->getSceneManager()->getGaussianScene().getVertexCount();
+                    _fullSortThisFrame            = _tracker.update(viewMatrix, splatCount, _settings);
+                    _slotWasFullSort[frameSlot]   = _fullSortThisFrame;
+                    _slotHasTimestamps[frameSlot] = _timestampPool != VK_NULL_HANDLE;
+                    _stats.SortAge                = _tracker.getSortAge();
+                    _stats.RecordedFrames         = static_cast<uint32_t>(_recordedPath.size());
+                    if (_fullSortThisFrame)
+                    {
+                        ++_stats.FullSortCount;
+                    }
+                    else
+                    {
+                        ++_stats.ReusedFrameCount;
+                    }
+
+                    PerFrameConstant pushConstant{};
+                    pushConstant.cameraBufferDeviceAddress = _ownedRenderer->getCurrentCameraBuffer()->address;
+                    if (!_fullSortThisFrame)
+                    {
+                        // keep last frame's order and instance count, refresh the keys and repair the order locally. The
+                        // distance pass lists every splat and the mesh shader culls them, so with an unchanged splat count
+                        // the kept list still holds every splat that can become visible
+                        VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+                        barrier.srcAccessMask   = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+                        barrier.dstAccessMask   = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+                        context.bindPipeline(_refreshPipeline);
+                        context.bindPushConstant(pushConstant);
+                        vkCmdDispatch(context._currCmdBuffer, nvvk::getGroupCounts(splatCount, 256), 1, 1);
+                        context.bindPipeline(_refinePipeline);
+                        for (uint32_t pass = 0; pass < _settings.RefinePassCount; ++pass)
+                        {
+                            vkCmdPipelineBarrier(context._currCmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                                 0, 1, &barrier, 0, NULL, 0, NULL);
+                            GaussianSortRefineConstant refineConstant{};
+                            refineConstant.parity = pass & 1u;
+                            context.bindPushConstant(refineConstant);
+                            vkCmdDispatch(context._currCmdBuffer, nvvk::getGroupCounts((splatCount + 1) / 2, 256), 1, 1);
+                        }
+                        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+                        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+                        vkCmdPipelineBarrier(
+                            context._currCmdBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+                            0, 1, &barrier, 0, NULL, 0, NULL);
+                        return;
+                    }
                     {
                         IndrectBuffer ibuffer;
                         vkCmdUpdateBuffer(context._currCmdBuffer, indirectBuffer->getRHI()->buffer, 0, sizeof(ibuffer), (void*) &ibuffer);
@@ -86,11 +241,8 @@ void GaussianSortPass::build(RDG::RDGBuilder* rdgBuilder)
                             VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
                             0, 1, &barrier, 0, NULL, 0, NULL);
                     }
-                    PerFrameConstant pushConstant{};
-                    pushConstant.cameraBufferDeviceAddress = _ownedRenderer->getCurrentCameraBuffer()->address;
                     context.bindPipeline(_distancePipeline);
                     context.bindPushConstant(pushConstant);
-                    size_t splatCount = _ownedRenderer->getSceneManager()->getGaussianScene().getVertexCount();
                     vkCmdDispatch(context._currCmdBuffer, nvvk::getGroupCounts(splatCount, 256), 1, 1);
                     VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
                     barrier.srcAccessMask   = VK_ACCESS_SHADER_WRITE_BIT;
@@ -113,14 +265,22 @@ void GaussianSortPass::build(RDG::RDGBuilder* rdgBuilder)
                     VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
                     barrier.srcAccessMask   = VK_ACCESS_SHADER_WRITE_BIT;
                     barrier.dstAccessMask   = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
-                    vrdxCmdSortKeyValueIndirect(
-                        context._currCmdBuffer, _sorter, _ownedRenderer->getSceneManager()->getGaussianScene().getVertexCount(),
-                        indirectBuffer->getRHI()->buffer, offsetof(IndrectBuffer, instanceCount), distanceBuffer->getRHI()->buffer, 0,
-                        indicesBuffer->getRHI()->buffer, 0, sortStorageBuffer->getRHI()->buffer, 0, VK_NULL_HANDLE, 0);
+                    if (_fullSortThisFrame)
+                    {
+                        vrdxCmdSortKeyValueIndirect(
+                            context._currCmdBuffer, _sorter, _ownedRenderer->getSceneManager()->getGaussianScene().getVertexCount(),
+                            indirectBuffer->getRHI()->buffer, offsetof(IndrectBuffer, instanceCount), distanceBuffer->getRHI()->buffer, 0,
+                            indicesBuffer->getRHI()->buffer, 0, sortStorageBuffer->getRHI()->buffer, 0, VK_NULL_HANDLE, 0);
+                    }
                     vkCmdPipelineBarrier(
                         context._currCmdBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT,
                         VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, 0, 1,
                         &barrier, 0, NULL, 0, NULL);
+                    if (_timestampPool != VK_NULL_HANDLE)
+                    {
+                        vkCmdWriteTimestamp(context._currCmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _timestampPool,
+                                            vkDriver->getFrameCycleIndex() * 2 + 1);
+                    }
                 })
             .finish();
 }
@@ -4,6 +4,7 @@
 #include "RDG/RDG.h"
 #include "vk_radix_sort.h"
 #include "core/RefCounted.h"
+#include "GaussianSortReuse.h"
 #include <rttr/rttr_enable.h>
 namespace Play
 {
@@ -13,17 +14,32 @@ class GaussianSortPass : public BasePass
 public:
     GaussianSortPass(GaussianRenderer* renderer);
     ~GaussianSortPass();
-    void RenderFrame();
     void init() override;
     void build(RDG::RDGBuilder* rdgBuilder) override;
 
     RTTR_ENABLE(BasePass)
 
 private:
-    VrdxSorter                     _sorter = VK_NULL_HANDLE;
-    VrdxSorterStorageRequirements  _sortRequirements;
-    GaussianRenderer*              _ownedRenderer = nullptr;
+    void readSortTimestamps(uint32_t frameSlot);
+    void runSortSimulation();
+
+    VrdxSorter                      _sorter = VK_NULL_HANDLE;
+    VrdxSorterStorageRequirements   _sortRequirements;
+    GaussianRenderer*               _ownedRenderer = nullptr;
     ComputePipelineStateInitializer _distancePipeline;
+    ComputePipelineStateInitializer _refreshPipeline;
+    ComputePipelineStateInitializer _refinePipeline;
+
+    GaussianSortSettings     _settings;
+    GaussianSortStats        _stats;
+    GaussianSortReuseTracker _tracker;
+    bool                     _fullSortThisFrame = true;
+    std::vector<glm::mat4>   _recordedPath;
+
+    // two timestamps per frame cycle slot, bracketing the key generation and the sort
+    VkQueryPool       _timestampPool = VK_NULL_HANDLE;
+    std::vector<bool> _slotHasTimestamps;
+    std::vector<bool> _slotWasFullSort;
 };
 
 } // namespace Play
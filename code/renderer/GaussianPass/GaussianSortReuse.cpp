@@ -0,0 +1,164 @@
+#include "GaussianSortReuse.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace Play
+{
+
+namespace
+{
+glm::vec3 eyeFromView(const glm::mat4& viewMatrix)
+{
+    return glm::vec3(glm::inverse(viewMatrix)[3]);
+}
+
+glm::vec3 forwardFromView(const glm::mat4& viewMatrix)
+{
+    return -glm::normalize(glm::vec3(glm::inverse(viewMatrix)[2]));
+}
+
+// matches the gpu ordering: ascending key means back to front
+float viewDepthKey(const glm::vec3& position, const glm::mat4& viewMatrix)
+{
+    return (viewMatrix * glm::vec4(position, 1.0f)).z;
+}
+} // namespace
+
+bool GaussianSortReuseTracker::update(const glm::mat4& viewMatrix, uint32_t splatCount, const GaussianSortSettings& settings)
+{
+    const glm::vec3 eye     = eyeFromView(viewMatrix);
+    const glm::vec3 forward = forwardFromView(viewMatrix);
+
+    bool needFullSort = !settings.EnableSortReuse || !_hasReference || _sortAge >= settings.MaxSortAge || splatCount != _referenceSplatCount;
+    if (!needFullSort)
+    {
+        const float cosAngle = std::clamp(glm::dot(forward, _referenceForward), -1.0f, 1.0f);
+        const float angle    = glm::degrees(std::acos(cosAngle));
+        needFullSort         = angle > settings.ViewAngleThreshold || glm::distance(eye, _referenceEye) > settings.ViewTranslationThreshold;
+    }
+
+    if (needFullSort)
+    {
+        _referenceEye        = eye;
+        _referenceForward    = forward;
+        _referenceSplatCount = splatCount;
+        _hasReference        = true;
+        _sortAge             = 0;
+        return true;
+    }
+
+    ++_sortAge;
+    return false;
+}
+
+void GaussianSortReuseTracker::invalidate()
+{
+    _hasReference = false;
+    _sortAge      = 0;
+}
+
+void computeGaussianSortKeys(std::span<const glm::vec3> positions, const glm::mat4& viewMatrix, std::span<const uint32_t> order,
+                             std::vector<float>& keys)
+{
+    keys.resize(order.size());
+    for (size_t slot = 0; slot < order.size(); ++slot)
+    {
+        keys[slot] = viewDepthKey(positions[order[slot]], viewMatrix);
+    }
+}
+
+void fullGaussianSort(std::span<const glm::vec3> positions, const glm::mat4& viewMatrix, std::vector<uint32_t>& order)
+{
+    std::vector<float> keys(positions.size());
+    for (size_t index = 0; index < positions.size(); ++index)
+    {
+        keys[index] = viewDepthKey(positions[index], viewMatrix);
+    }
+    order.resize(positions.size());
+    std::iota(order.begin(), order.end(), 0u);
+    // the gpu radix sort is stable as well, keep ties in index order
+    std::stable_sort(order.begin(), order.end(), [&keys](uint32_t lhs, uint32_t rhs) { return keys[lhs] < keys[rhs]; });
+}
+
+void refineGaussianSortOddEven(std::vector<float>& keys, std::vector<uint32_t>& order, uint32_t passCount)
+{
+    const size_t count = keys.size();
+    for (uint32_t pass = 0; pass < passCount; ++pass)
+    {
+        for (size_t left = pass & 1u; left + 1 < count; left += 2)
+        {
+            if (keys[left] > keys[left + 1])
+            {
+                std::swap(keys[left], keys[left + 1]);
+                std::swap(order[left], order[left + 1]);
+            }
+        }
+    }
+}
+
+GaussianSortSimulationReport simulateGaussianSortReuse(std::span<const glm::vec3> positions, std::span<const glm::mat4> viewPath,
+                                                       const GaussianSortSettings& settings)
+{
+    GaussianSortSimulationReport report;
+    if (positions.empty() || viewPath.empty())
+    {
+        return report;
+    }
+
+    GaussianSortReuseTracker tracker;
+    std::vector<uint32_t>    order;
+    std::vector<uint32_t>    reference;
+    std::vector<uint32_t>    referenceRank(positions.size());
+    std::vector<float>       keys;
+    report.frames.reserve(viewPath.size());
+
+    for (const glm::mat4& viewMatrix : viewPath)
+    {
+        GaussianSortSimulationFrame frame;
+        frame.fullSort = tracker.update(viewMatrix, static_cast<uint32_t>(positions.size()), settings);
+        frame.sortAge  = tracker.getSortAge();
+        if (frame.fullSort)
+        {
+            fullGaussianSort(positions, viewMatrix, order);
+            ++report.fullSortCount;
+        }
+        else
+        {
+            computeGaussianSortKeys(positions, viewMatrix, order, keys);
+            refineGaussianSortOddEven(keys, order, settings.RefinePassCount);
+        }
+
+        computeGaussianSortKeys(positions, viewMatrix, order, keys);
+        size_t inversions = 0;
+        for (size_t slot = 0; slot + 1 < keys.size(); ++slot)
+        {
+            inversions += keys[slot] > keys[slot + 1] ? 1 : 0;
+        }
+        frame.adjacentInversionRatio = keys.size() > 1 ? float(inversions) / float(keys.size() - 1) : 0.0f;
+
+        fullGaussianSort(positions, viewMatrix, reference);
+        for (size_t rank = 0; rank < reference.size(); ++rank)
+        {
+            referenceRank[reference[rank]] = static_cast<uint32_t>(rank);
+        }
+        double displacement = 0.0;
+        for (size_t slot = 0; slot < order.size(); ++slot)
+        {
+            displacement += std::abs(double(referenceRank[order[slot]]) - double(slot));
+        }
+        frame.meanRankDisplacement = float(displacement / double(order.size()) / double(order.size()));
+
+        report.meanInversionRatio += frame.adjacentInversionRatio;
+        report.meanRankDisplacement += frame.meanRankDisplacement;
+        report.maxInversionRatio   = std::max(report.maxInversionRatio, frame.adjacentInversionRatio);
+        report.maxRankDisplacement = std::max(report.maxRankDisplacement, frame.meanRankDisplacement);
+        report.frames.push_back(frame);
+    }
+
+    report.meanInversionRatio /= float(report.frames.size());
+    report.meanRankDisplacement /= float(report.frames.size());
+    return report;
+}
+
+} // namespace Play
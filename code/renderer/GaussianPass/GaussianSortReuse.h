@@ -0,0 +1,84 @@
+#ifndef GAUSSIAN_SORT_REUSE_H
+#define GAUSSIAN_SORT_REUSE_H
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Play
+{
+
+// tuning knobs of the temporal sort reuse, exposed to the editor through RTTR
+struct GaussianSortSettings
+{
+    bool     EnableSortReuse          = true;
+    float    ViewAngleThreshold       = 2.0f;  // degrees of view direction drift since the last full sort
+    float    ViewTranslationThreshold = 0.05f; // world units of eye drift since the last full sort
+    uint32_t MaxSortAge               = 30;    // force a full sort after this many reused frames
+    uint32_t RefinePassCount          = 8;     // odd-even transposition passes applied to the stale order
+    bool     RecordCameraPath         = false;
+    bool     RunSimulation            = false; // one-shot trigger, replays the recorded path on the cpu
+};
+
+struct GaussianSortStats
+{
+    uint32_t SortAge          = 0;
+    uint32_t FullSortCount    = 0;
+    uint32_t ReusedFrameCount = 0;
+    float    FullSortMs       = 0.0f;
+    float    RefineMs         = 0.0f;
+    uint32_t RecordedFrames   = 0;
+};
+
+// decides per frame whether the splat order has to be rebuilt from scratch or whether the previous order can be
+// refined in place. The reference view is the one of the last full sort, so small per-frame moves accumulate. The
+// reused order only holds the splats listed by that sort, a different splat count forces a full sort.
+class GaussianSortReuseTracker
+{
+public:
+    bool     update(const glm::mat4& viewMatrix, uint32_t splatCount, const GaussianSortSettings& settings);
+    void     invalidate();
+    uint32_t getSortAge() const
+    {
+        return _sortAge;
+    }
+
+private:
+    glm::vec3 _referenceEye        = glm::vec3(0.0f);
+    glm::vec3 _referenceForward    = glm::vec3(0.0f, 0.0f, -1.0f);
+    uint32_t  _referenceSplatCount = 0;
+    uint32_t  _sortAge             = 0;
+    bool      _hasReference        = false;
+};
+
+// cpu mirror of the gpu key/refine kernels, used by the simulation harness below
+void computeGaussianSortKeys(std::span<const glm::vec3> positions, const glm::mat4& viewMatrix, std::span<const uint32_t> order,
+                             std::vector<float>& keys);
+void fullGaussianSort(std::span<const glm::vec3> positions, const glm::mat4& viewMatrix, std::vector<uint32_t>& order);
+void refineGaussianSortOddEven(std::vector<float>& keys, std::vector<uint32_t>& order, uint32_t passCount);
+
+struct GaussianSortSimulationFrame
+{
+    bool     fullSort               = false;
+    uint32_t sortAge                = 0;
+    float    adjacentInversionRatio = 0.0f; // fraction of neighbouring pairs out of order
+    float    meanRankDisplacement   = 0.0f; // mean |rank - slot| against a full sort, normalized by splat count
+};
+
+struct GaussianSortSimulationReport
+{
+    std::vector<GaussianSortSimulationFrame> frames;
+    uint32_t                                 fullSortCount        = 0;
+    float                                    meanInversionRatio   = 0.0f;
+    float                                    maxInversionRatio    = 0.0f;
+    float                                    meanRankDisplacement = 0.0f;
+    float                                    maxRankDisplacement  = 0.0f;
+};
+
+// replays a recorded camera path and measures the ordering error of the reuse strategy against a full sort per frame
+GaussianSortSimulationReport simulateGaussianSortReuse(std::span<const glm::vec3> positions, std::span<const glm::mat4> viewPath,
+                                                       const GaussianSortSettings& settings);
+
+} // namespace Play
+
+#endif // GAUSSIAN_SORT_REUSE_H
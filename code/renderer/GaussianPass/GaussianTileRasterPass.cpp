@@ -0,0 +1,311 @@
+#include "GaussianTileRasterPass.h"
+#include "GaussianTileReference.h"
+#include "renderer/GaussianRenderer.h"
+#include "renderer/renderPasses/PresentPass.h"
+#include "Resource.h"
+#include "SceneManager.h"
+#include "ShaderManager.hpp"
+#include "editor/EditorRegistry.h"
+#include "newShaders/gaussian/gaussianLib.h.slang"
+#include "nvutils/alignment.hpp"
+#include <bit>
+
+namespace Play
+{
+namespace
+{
+constexpr uint32_t              kMaxTileEntries      = 1u << 26;
+constexpr VkBufferUsageFlags2   kImageReadbackUsage  = VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_SHADER_DEVICE_ADDRESS_BIT;
+constexpr VkMemoryPropertyFlags kImageReadbackMemory = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+} // namespace
+
+GaussianTileRasterPass::GaussianTileRasterPass(GaussianRenderer* renderer) : _ownedRenderer(renderer) {}
+
+GaussianTileRasterPass::~GaussianTileRasterPass()
+{
+    vrdxDestroySorter(_sorter);
+}
+
+void GaussianTileRasterPass::init()
+{
+    VrdxSorterCreateInfo sorterInfo{vkDriver->getPhysicalDevice(), vkDriver->getDevice()};
+    vrdxCreateSorter(&sorterInfo, &_sorter);
+
+    const std::vector<uint32_t> shaderIds = ShaderManager::Instance().loadShadersFromFiles({
+        {"gaussianTilePreprocess", "./gaussian/gaussianTilePreprocess.comp.slang", ShaderStage::eCompute},
+        {"gaussianTileRanges", "./gaussian/gaussianTileRanges.comp.slang", ShaderStage::eCompute},
+        {"gaussianTileRaster", "./gaussian/gaussianTileRaster.comp.slang", ShaderStage::eCompute},
+    });
+    auto preprocessComp = shaderIds[0];
+    auto rangesComp     = shaderIds[1];
+    auto rasterComp     = shaderIds[2];
+    _preprocessPipeline.setShader(preprocessComp);
+    _preprocessPipeline.setPushConstant<GaussianTileConstant>();
+    _rangesPipeline.setShader(rangesComp);
+    _rangesPipeline.setPushConstant<GaussianTileConstant>();
+    _rasterPipeline.setShader(rasterComp);
+    _rasterPipeline.setPushConstant<GaussianTileConstant>();
+
+    const uint32_t presentVertId = ShaderManager::Instance().getShaderIdByName(BuiltinShaders::BUILTIN_FULL_SCREEN_QUAD_VERT_SHADER_NAME);
+    const uint32_t presentFragId =
+        ShaderManager::Instance().loadShaderFromFile("gaussianPresentF", "newShaders/deferRenderer/postprocess/present.frag.slang",
+                                                     ShaderStage::eFragment, ShaderType::eSLANG, "main");
+    _presentPipeline.setShader(presentVertId, presentFragId);
+    _presentPipeline.psoState.rasterizationState.cullMode = VK_CULL_MODE_NONE;
+
+    const uint32_t frameCycleSize = vkDriver->getFrameCycleSize();
+
+    _counterReadbackBuffer = RefPtr<Buffer>(new Buffer("GaussianTileCounterReadback", VK_BUFFER_USAGE_2_TRANSFER_DST_BIT,
+                                                       sizeof(GaussianTileCounters) * frameCycleSize,
+                                                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+    _slotHasCounters.assign(frameCycleSize, false);
+
+    vkDriver->getEditorRegistry().registerWritable<GaussianTileSettings>("Gaussian Tile Raster", _settings, editor::EditorRenderMode::Gaussian);
+    vkDriver->getEditorRegistry().registerReadOnly<GaussianTileStats>("Gaussian Tile Stats", _stats, editor::EditorRenderMode::Gaussian);
+}
+
+void GaussianTileRasterPass::readTileCounters(uint32_t frameSlot)
+{
+    if (!_slotHasCounters[frameSlot])
+    {
+        return;
+    }
+    // the frame slot was fenced in prepareFrame, the copy recorded by its last use is complete
+    const GaussianTileCounters* counters = reinterpret_cast<const GaussianTileCounters*>(_counterReadbackBuffer->mapping) + frameSlot;
+    _stats.VisibleSplats                 = counters->visibleCount;
+    _stats.TileEntries                   = counters->entryCount;
+    _stats.OverflowSplats                = counters->overflowCount;
+}
+
+void GaussianTileRasterPass::resolveReferenceDiff(uint32_t frameSlot)
+{
+    if (_pendingDiffSlot != int32_t(frameSlot))
+    {
+        return;
+    }
+    _pendingDiffSlot = -1;
+
+    const uint32_t width  = uint32_t(_pendingDiffCamera.viewPortSize.x);
+    const uint32_t height = uint32_t(_pendingDiffCamera.viewPortSize.y);
+    const float4*  gpu    = reinterpret_cast<const float4*>(_imageReadbackBuffer->mapping);
+    std::vector<glm::vec4> gpuPixels(gpu, gpu + size_t(width) * height);
+
+    const GaussianScene&                    scene  = _ownedRenderer->getSceneManager()->getGaussianScene();
+    std::vector<GaussianTileReferenceSplat> splats = projectGaussianSplats(scene, _pendingDiffCamera);
+    std::vector<glm::vec4>                  cpuPixels;
+    rasterizeGaussianTilesReference(splats, width, height, _depthBits, cpuPixels);
+
+    const GaussianImageDiff diff = compareGaussianImages(cpuPixels, gpuPixels, _settings.DiffTolerance);
+    _stats.DiffMaxError          = diff.maxError;
+    _stats.DiffMeanError         = diff.meanError;
+    _stats.DiffPsnr              = diff.psnr;
+    _stats.DiffMismatchedPixels  = diff.mismatchedPixels;
+    LOGI("Gaussian tile raster vs cpu reference: max %.5f mean %.6f psnr %.2f dB, %u/%u pixels above %.3f\n", diff.maxError, diff.meanError,
+         diff.psnr, diff.mismatchedPixels, width * height, _settings.DiffTolerance);
+    _imageReadbackBuffer = nullptr;
+}
+
+void GaussianTileRasterPass::build(RDG::RDGBuilder* rdgBuilder)
+{
+    const VkExtent2D viewportSize = vkDriver->getViewportSize();
+    const uint32_t   splatCount   = _ownedRenderer->getSceneManager()->getGaussianScene().getVertexCount();
+    _tileCountX                   = (viewportSize.width + kGaussianTileSize - 1) / kGaussianTileSize;
+    _tileCountY                   = (viewportSize.height + kGaussianTileSize - 1) / kGaussianTileSize;
+    _depthBits                    = std::min(32u - uint32_t(std::bit_width(_tileCountX * _tileCountY - 1)), 24u);
+    _maxEntries                   = uint32_t(std::min<uint64_t>(uint64_t(splatCount) * std::max(_settings.MaxEntriesPerSplat, 1u), kMaxTileEntries));
+    _pendingDiffSlot              = -1;
+    _imageReadbackBuffer          = nullptr;
+    std::fill(_slotHasCounters.begin(), _slotHasCounters.end(), false);
+
+    VrdxSorterStorageRequirements sortRequirements;
+    vrdxGetSorterKeyValueStorageRequirements(_sorter, _maxEntries, &sortRequirements);
+
+    RDG::RDGBufferRef countersBuffer = rdgBuilder->createBuffer("gaussianTileCounters")
+                                           .Location(true)
+                                           .Range(VK_WHOLE_SIZE)
+                                           .Size(sizeof(GaussianTileCounters))
+                                           .UsageFlags(VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_INDIRECT_BUFFER_BIT)
+                                           .finish();
+    RDG::RDGBufferRef splatsBuffer = rdgBuilder->createBuffer("gaussianTileSplats")
+                                         .Location(true)
+                                         .Range(VK_WHOLE_SIZE)
+                                         .Size(sizeof(GaussianTileSplat) * std::max(splatCount, 1u))
+                                         .UsageFlags(VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT)
+                                         .finish();
+    RDG::RDGBufferRef keysBuffer = rdgBuilder->createBuffer("gaussianTileKeys")
+                                       .Location(true)
+                                       .Range(VK_WHOLE_SIZE)
+                                       .Size(nvutils::align_up(sizeof(uint32_t) * _maxEntries, 16))
+                                       .UsageFlags(VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT)
+                                       .finish();
+    RDG::RDGBufferRef valuesBuffer = rdgBuilder->createBuffer("gaussianTileValues")
+                                         .Location(true)
+                                         .Range(VK_WHOLE_SIZE)
+                                         .Size(nvutils::align_up(sizeof(uint32_t) * _maxEntries, 16))
+                                         .UsageFlags(VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT)
+                                         .finish();
+    RDG::RDGBufferRef rangesBuffer = rdgBuilder->createBuffer("gaussianTileRanges")
+                                         .Location(true)
+                                         .Range(VK_WHOLE_SIZE)
+                                         .Size(sizeof(uint32_t) * 2 * _tileCountX * _tileCountY)
+                                         .UsageFlags(VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT)
+                                         .finish();
+    RDG::RDGBufferRef sortStorageBuffer = rdgBuilder->createBuffer("gaussianTileSortStorage")
+                                              .Location(true)
+                                              .Range(VK_WHOLE_SIZE)
+                                              .Size(sortRequirements.size)
+                                              .UsageFlags(sortRequirements.usage)
+                                              .finish();
+    RDG::RDGBufferRef sceneUniformBuffer =
+        rdgBuilder->createBuffer("sceneUniformBuffer").Import(_ownedRenderer->getSceneManager()->getGaussianScene().getSceneUniformBuffer()).finish();
+    RDG::RDGTextureRef colorTexture = rdgBuilder->createTexture("gaussianTileColor")
+                                          .Extent({viewportSize.width, viewportSize.height, 1})
+                                          .AspectFlags(VK_IMAGE_ASPECT_COLOR_BIT)
+                                          .Format(VK_FORMAT_R16G16B16A16_SFLOAT)
+                                          .UsageFlags(VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)
+                                          .MipmapLevel(1)
+                                          .finish();
+
+    auto makeTileConstant = [this]()
+    {
+        GaussianTileConstant constant{};
+        constant.cameraBufferDeviceAddress = _ownedRenderer->getCurrentCameraBuffer()->address;
+        constant.tileCountX                = _tileCountX;
+        constant.tileCountY                = _tileCountY;
+        constant.depthBits                 = _depthBits;
+        constant.maxEntries                = _maxEntries;
+        constant.readbackAddress           = _pendingDiffSlot == int32_t(vkDriver->getFrameCycleIndex()) ? _imageReadbackBuffer->address : 0;
+        return constant;
+    };
+
+    [[maybe_unused]] RDG::ComputePassNodeRef preprocessPass =
+        rdgBuilder->createComputePass("GaussianTilePreprocessPass")
+            .storageWrite(0, countersBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .storageWrite(1, splatsBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .storageWrite(2, keysBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .storageWrite(3, valuesBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .read(4, sceneUniformBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .execute(
+                [this, countersBuffer, rangesBuffer, makeTileConstant](RDG::PassNode* node, RDG::RenderContext& context)
+                {
+                    const uint32_t frameSlot = vkDriver->getFrameCycleIndex();
+                    readTileCounters(frameSlot);
+                    resolveReferenceDiff(frameSlot);
+                    if (_settings.RunReferenceDiff && _pendingDiffSlot < 0)
+                    {
+                        _settings.RunReferenceDiff = false;
+                        _pendingDiffSlot           = int32_t(frameSlot);
+                        _pendingDiffCamera         = _ownedRenderer->getCurrentCameraData();
+                        // released once the diff read it back, or by the next resize
+                        const VkExtent2D extent    = vkDriver->getViewportSize();
+                        _imageReadbackBuffer       = RefPtr<Buffer>(new Buffer("GaussianTileImageReadback", kImageReadbackUsage,
+                                                                               sizeof(float4) * extent.width * extent.height, kImageReadbackMemory));
+                    }
+
+                    {
+                        GaussianTileCounters counters;
+                        vkCmdUpdateBuffer(context._currCmdBuffer, countersBuffer->getRHI()->buffer, 0, sizeof(counters), (void*) &counters);
+                        vkCmdFillBuffer(context._currCmdBuffer, rangesBuffer->getRHI()->buffer, 0, VK_WHOLE_SIZE, 0);
+                        VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+                        barrier.srcAccessMask   = VK_ACCESS_TRANSFER_WRITE_BIT;
+                        barrier.dstAccessMask   = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+                        vkCmdPipelineBarrier(context._currCmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                                             &barrier, 0, NULL, 0, NULL);
+                    }
+                    context.bindPipeline(_preprocessPipeline);
+                    context.bindPushConstant(makeTileConstant());
+                    const uint32_t splatCount = _ownedRenderer->getSceneManager()->getGaussianScene().getVertexCount();
+                    vkCmdDispatch(context._currCmdBuffer, nvvk::getGroupCounts(splatCount, 256), 1, 1);
+                })
+            .finish();
+
+    [[maybe_unused]] RDG::ComputePassNodeRef sortPass =
+        rdgBuilder->createComputePass("GaussianTileSortPass")
+            .storageRead(0, countersBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .storageWrite(1, keysBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .storageWrite(2, valuesBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .storageWrite(3, sortStorageBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .execute(
+                [this, countersBuffer, keysBuffer, valuesBuffer, sortStorageBuffer](RDG::PassNode* node, RDG::RenderContext& context)
+                {
+                    vrdxCmdSortKeyValueIndirect(context._currCmdBuffer, _sorter, _maxEntries, countersBuffer->getRHI()->buffer,
+                                                offsetof(GaussianTileCounters, sortCount), keysBuffer->getRHI()->buffer, 0,
+                                                valuesBuffer->getRHI()->buffer, 0, sortStorageBuffer->getRHI()->buffer, 0, VK_NULL_HANDLE, 0);
+                    VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+                    barrier.srcAccessMask   = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+                    barrier.dstAccessMask   = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+                    vkCmdPipelineBarrier(context._currCmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &barrier, 0, NULL, 0,
+                                         NULL);
+                })
+            .finish();
+
+    [[maybe_unused]] RDG::ComputePassNodeRef rangesPass =
+        rdgBuilder->createComputePass("GaussianTileRangesPass")
+            .storageRead(0, countersBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .storageRead(1, keysBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .storageWrite(2, rangesBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .execute(
+                [this, countersBuffer, makeTileConstant](RDG::PassNode* node, RDG::RenderContext& context)
+                {
+                    context.bindPipeline(_rangesPipeline);
+                    context.bindPushConstant(makeTileConstant());
+                    vkCmdDispatchIndirect(context._currCmdBuffer, countersBuffer->getRHI()->buffer, offsetof(GaussianTileCounters, groupCountX));
+                })
+            .finish();
+
+    [[maybe_unused]] RDG::ComputePassNodeRef rasterPass =
+        rdgBuilder->createComputePass("GaussianTileRasterPass")
+            .storageRead(0, rangesBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .storageRead(1, valuesBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .storageRead(2, splatsBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .storageWrite(3, colorTexture, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .execute(
+                [this, countersBuffer, makeTileConstant](RDG::PassNode* node, RDG::RenderContext& context)
+                {
+                    context.bindPipeline(_rasterPipeline);
+                    context.bindPushConstant(makeTileConstant());
+                    vkCmdDispatch(context._currCmdBuffer, _tileCountX, _tileCountY, 1);
+
+                    // snapshot the counters for the stats, read back when this frame slot comes around again
+                    VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+                    barrier.srcAccessMask   = VK_ACCESS_SHADER_WRITE_BIT;
+                    barrier.dstAccessMask   = VK_ACCESS_TRANSFER_READ_BIT;
+                    vkCmdPipelineBarrier(context._currCmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier,
+                                         0, NULL, 0, NULL);
+                    const uint32_t frameSlot = vkDriver->getFrameCycleIndex();
+                    VkBufferCopy   region    = {0, sizeof(GaussianTileCounters) * frameSlot, sizeof(GaussianTileCounters)};
+                    vkCmdCopyBuffer(context._currCmdBuffer, countersBuffer->getRHI()->buffer, _counterReadbackBuffer->buffer, 1, &region);
+                    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+                    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+                    vkCmdPipelineBarrier(context._currCmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                         VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+                    _slotHasCounters[frameSlot] = true;
+                })
+            .finish();
+
+    auto outputTexRef = rdgBuilder->createTexture(PresentPass::PRESENT_TEXTURE_NAME).finish();
+    [[maybe_unused]] RDG::RenderPassNodeRef presentPass =
+        rdgBuilder->createRenderPass("PresentPass")
+            .color(0, outputTexRef, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                   VK_IMAGE_LAYOUT_PRESENT_SRC_KHR)
+            .read(0, colorTexture, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT)
+            .execute(
+                [this](RDG::PassNode* node, RDG::RenderContext& context)
+                {
+                    VkCommandBuffer cmd = context._currCmdBuffer;
+                    context.bindPipeline(_presentPipeline);
+
+                    VkViewport viewport = {
+                        0,    0,    static_cast<float>(vkDriver->getViewportSize().width), static_cast<float>(vkDriver->getViewportSize().height),
+                        0.0f, 1.0f,
+                    };
+                    VkRect2D scissor = {{0, 0}, {vkDriver->getViewportSize().width, vkDriver->getViewportSize().height}};
+                    vkCmdSetViewportWithCount(cmd, 1, &viewport);
+                    vkCmdSetScissorWithCount(cmd, 1, &scissor);
+                    vkCmdDraw(cmd, 3, 1, 0, 0);
+                })
+            .finish();
+}
+
+} // namespace Play
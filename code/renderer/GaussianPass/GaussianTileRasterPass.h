@@ -0,0 +1,73 @@
+#ifndef GAUSSIAN_TILE_RASTER_PASS_H
+#define GAUSSIAN_TILE_RASTER_PASS_H
+#include "renderpasses/RenderPass.h"
+#include "RDG/RDG.h"
+#include "vk_radix_sort.h"
+#include "core/RefCounted.h"
+#include "Hdevice.h"
+#include <rttr/rttr_enable.h>
+
+namespace Play
+{
+class GaussianRenderer;
+
+struct GaussianTileSettings
+{
+    uint32_t MaxEntriesPerSplat = 8;     // tile entry capacity per splat, applied on the next resize
+    bool     RunReferenceDiff   = false; // one-shot trigger, compares the next frame against the cpu reference
+    float    DiffTolerance      = 0.02f;
+};
+
+struct GaussianTileStats
+{
+    uint32_t VisibleSplats        = 0;
+    uint32_t TileEntries          = 0;
+    uint32_t OverflowSplats       = 0;
+    float    DiffMaxError         = 0.0f;
+    float    DiffMeanError        = 0.0f;
+    float    DiffPsnr             = 0.0f;
+    uint32_t DiffMismatchedPixels = 0;
+};
+
+// compute backend of the gaussian renderer: per splat preprocess and tile binning, one key-value sort over
+// (tile, depth), then a front-to-back blend per 16x16 tile. Does not need VK_EXT_mesh_shader.
+class GaussianTileRasterPass : public BasePass
+{
+public:
+    GaussianTileRasterPass(GaussianRenderer* renderer);
+    ~GaussianTileRasterPass();
+    void init() override;
+    void build(RDG::RDGBuilder* rdgBuilder) override;
+
+    RTTR_ENABLE(BasePass)
+
+private:
+    void readTileCounters(uint32_t frameSlot);
+    void resolveReferenceDiff(uint32_t frameSlot);
+
+    GaussianRenderer*                _ownedRenderer = nullptr;
+    VrdxSorter                       _sorter        = VK_NULL_HANDLE;
+    ComputePipelineStateInitializer  _preprocessPipeline;
+    ComputePipelineStateInitializer  _rangesPipeline;
+    ComputePipelineStateInitializer  _rasterPipeline;
+    GraphicsPipelineStateInitializer _presentPipeline;
+
+    GaussianTileSettings _settings;
+    GaussianTileStats    _stats;
+    uint32_t             _tileCountX = 0;
+    uint32_t             _tileCountY = 0;
+    uint32_t             _depthBits  = 0;
+    uint32_t             _maxEntries = 0;
+
+    // host visible copies of the per frame counters (one slot per frame cycle) and of the blended image, the image one
+    // only while a reference diff is pending
+    RefPtr<Buffer>    _counterReadbackBuffer;
+    RefPtr<Buffer>    _imageReadbackBuffer;
+    std::vector<bool> _slotHasCounters;
+    int32_t           _pendingDiffSlot = -1;
+    CameraData        _pendingDiffCamera{};
+};
+
+} // namespace Play
+
+#endif // GAUSSIAN_TILE_RASTER_PASS_H
@@ -0,0 +1,193 @@
+#include "GaussianTileReference.h"
+#include "GaussianShEvaluator.h"
+#include "PlayScene.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Play
+{
+
+namespace
+{
+// matches threedgsCovarianceProjection, glm matrices are the math matrices the shader sees through mul(v, M)
+glm::vec3 projectCovariance(const float* covariance, const glm::vec4& viewCenter, const glm::vec2& focal, const glm::mat4& viewMatrix)
+{
+    const glm::mat3 cov3D(covariance[0], covariance[1], covariance[2], covariance[1], covariance[3], covariance[4], covariance[2], covariance[4],
+                          covariance[5]);
+    const float     s     = 1.0f / (viewCenter.z * viewCenter.z);
+    const glm::mat3 J     = glm::transpose(glm::mat3(focal.x / viewCenter.z, 0.0f, -(focal.x * viewCenter.x) * s, 0.0f, focal.y / viewCenter.z,
+                                                 -(focal.y * viewCenter.y) * s, 0.0f, 0.0f, 0.0f));
+    const glm::mat3 W     = glm::mat3(viewMatrix);
+    const glm::mat3 T     = J * W;
+    const glm::mat3 cov2D = T * cov3D * glm::transpose(T);
+    return glm::vec3(cov2D[0][0], cov2D[1][0], cov2D[1][1]);
+}
+} // namespace
+
+std::vector<GaussianTileReferenceSplat> projectGaussianSplats(const GaussianScene& scene, const CameraData& camera)
+{
+    const std::vector<float3>& positions   = scene.getPositions();
+    const std::vector<float4>& colors      = scene.getColors();
+    const std::vector<float>&  covariances = scene.getCovariances();
+    const std::vector<float>&  shRest      = scene.getShRestCoefficients();
+    const uint32_t             splatCount  = scene.getVertexCount();
+    const uint32_t             shStride    = splatCount > 0 ? uint32_t(shRest.size() / splatCount) : 0;
+
+    const glm::vec2 focal = glm::vec2(camera.projMatrix[0][0] * camera.viewPortSize.x, camera.projMatrix[1][1] * camera.viewPortSize.y) * 0.5f;
+
+    std::vector<GaussianTileReferenceSplat> splats;
+    for (uint32_t splatIndex = 0; splatIndex < splatCount; ++splatIndex)
+    {
+        const glm::vec4 viewCenter = camera.viewMatrix * glm::vec4(positions[splatIndex], 1.0f);
+        const glm::vec4 clipCenter = camera.projMatrix * viewCenter;
+        const glm::vec3 ndcCenter  = glm::vec3(clipCenter) / clipCenter.w;
+        if (std::abs(ndcCenter.x) > 1.0f || std::abs(ndcCenter.y) > 1.0f || std::abs(ndcCenter.z) > 1.0f)
+        {
+            continue;
+        }
+
+        glm::vec3 cov2D = projectCovariance(&covariances[size_t(splatIndex) * 6], viewCenter, focal, camera.viewMatrix);
+        cov2D.x += 0.3f;
+        cov2D.z += 0.3f;
+        const float det = cov2D.x * cov2D.z - cov2D.y * cov2D.y;
+        if (det <= 0.0f)
+        {
+            continue;
+        }
+        const float mid        = 0.5f * (cov2D.x + cov2D.z);
+        const float eigenValue = mid + std::sqrt(std::max(0.1f, mid * mid - det));
+
+        GaussianTileReferenceSplat splat;
+        splat.splatIndex = splatIndex;
+        splat.center     = (glm::vec2(ndcCenter) * 0.5f + 0.5f) * camera.viewPortSize;
+        splat.depth      = ndcCenter.z;
+        splat.radius     = std::ceil(sqrt8 * std::sqrt(eigenValue));
+        splat.conic      = glm::vec3(cov2D.z / det, -cov2D.y / det, cov2D.x / det);
+        splat.color      = colors[splatIndex];
+
+        const glm::vec3 viewDirection = glm::normalize(positions[splatIndex] - camera.cameraPosition);
+        splat.color += glm::vec4(evaluateGaussianShRadiance(shRest, shStride, splatIndex, viewDirection), 0.0f);
+        splats.push_back(splat);
+    }
+    return splats;
+}
+
+std::vector<GaussianTileEntry> binGaussianTiles(std::span<const GaussianTileReferenceSplat> splats, uint32_t width, uint32_t height,
+                                                uint32_t depthBits)
+{
+    const uint32_t tileCountX = (width + kGaussianTileSize - 1) / kGaussianTileSize;
+    const uint32_t tileCountY = (height + kGaussianTileSize - 1) / kGaussianTileSize;
+    const uint32_t depthMask  = (1u << depthBits) - 1u;
+
+    std::vector<GaussianTileEntry> entries;
+    for (uint32_t splatSlot = 0; splatSlot < splats.size(); ++splatSlot)
+    {
+        const GaussianTileReferenceSplat& splat = splats[splatSlot];
+
+        auto tileCoord = [](float pixel, uint32_t tileCount)
+        {
+            return std::clamp(int(std::floor(pixel / float(kGaussianTileSize))), 0, int(tileCount) - 1);
+        };
+        const int      minX     = tileCoord(splat.center.x - splat.radius, tileCountX);
+        const int      maxX     = tileCoord(splat.center.x + splat.radius, tileCountX);
+        const int      minY     = tileCoord(splat.center.y - splat.radius, tileCountY);
+        const int      maxY     = tileCoord(splat.center.y + splat.radius, tileCountY);
+        const uint32_t depthKey = uint32_t(std::clamp(splat.depth, 0.0f, 1.0f) * float(depthMask));
+        for (int y = minY; y <= maxY; ++y)
+        {
+            for (int x = minX; x <= maxX; ++x)
+            {
+                entries.push_back({((uint32_t(y) * tileCountX + uint32_t(x)) << depthBits) | depthKey, splatSlot});
+            }
+        }
+    }
+    // the gpu breaks key ties by append order, which is not deterministic; use the splat index here
+    std::sort(entries.begin(), entries.end(),
+              [&splats](const GaussianTileEntry& lhs, const GaussianTileEntry& rhs)
+              {
+                  return lhs.key != rhs.key ? lhs.key < rhs.key : splats[lhs.splat].splatIndex < splats[rhs.splat].splatIndex;
+              });
+    return entries;
+}
+
+void rasterizeGaussianTilesReference(std::span<const GaussianTileReferenceSplat> splats, uint32_t width, uint32_t height, uint32_t depthBits,
+                                     std::vector<glm::vec4>& pixels)
+{
+    const uint32_t                       tileCountX = (width + kGaussianTileSize - 1) / kGaussianTileSize;
+    const std::vector<GaussianTileEntry> entries    = binGaussianTiles(splats, width, height, depthBits);
+
+    pixels.assign(size_t(width) * height, glm::vec4(0.0f));
+    size_t rangeStart = 0;
+    while (rangeStart < entries.size())
+    {
+        const uint32_t tileIndex = entries[rangeStart].key >> depthBits;
+        size_t         rangeEnd  = rangeStart;
+        while (rangeEnd < entries.size() && (entries[rangeEnd].key >> depthBits) == tileIndex)
+        {
+            ++rangeEnd;
+        }
+
+        const uint32_t tileX = tileIndex % tileCountX;
+        const uint32_t tileY = tileIndex / tileCountX;
+        for (uint32_t py = tileY * kGaussianTileSize; py < std::min(height, (tileY + 1) * kGaussianTileSize); ++py)
+        {
+            for (uint32_t px = tileX * kGaussianTileSize; px < std::min(width, (tileX + 1) * kGaussianTileSize); ++px)
+            {
+                const glm::vec2 pixelCenter   = glm::vec2(float(px), float(py)) + 0.5f;
+                glm::vec3       radiance      = glm::vec3(0.0f);
+                float           transmittance = 1.0f;
+                for (size_t entry = rangeStart; entry < rangeEnd; ++entry)
+                {
+                    const GaussianTileReferenceSplat& splat = splats[entries[entry].splat];
+                    const glm::vec2                   d     = splat.center - pixelCenter;
+                    const float power = -0.5f * (splat.conic.x * d.x * d.x + splat.conic.z * d.y * d.y) - splat.conic.y * d.x * d.y;
+                    if (power > 0.0f)
+                    {
+                        continue;
+                    }
+                    const float alpha = std::min(kGaussianTileMaxAlpha, splat.color.a * std::exp(power));
+                    if (alpha < kGaussianTileMinAlpha)
+                    {
+                        continue;
+                    }
+                    const float nextTransmittance = transmittance * (1.0f - alpha);
+                    if (nextTransmittance < kGaussianTileTransmittanceCutoff)
+                    {
+                        break;
+                    }
+                    radiance += glm::vec3(splat.color) * alpha * transmittance;
+                    transmittance = nextTransmittance;
+                }
+                pixels[size_t(py) * width + px] = glm::vec4(radiance, 1.0f - transmittance);
+            }
+        }
+        rangeStart = rangeEnd;
+    }
+}
+
+GaussianImageDiff compareGaussianImages(std::span<const glm::vec4> reference, std::span<const glm::vec4> image, float tolerance)
+{
+    GaussianImageDiff diff;
+    const size_t      pixelCount = std::min(reference.size(), image.size());
+    if (pixelCount == 0)
+    {
+        return diff;
+    }
+    double errorSum   = 0.0;
+    double squaredSum = 0.0;
+    for (size_t pixel = 0; pixel < pixelCount; ++pixel)
+    {
+        const glm::vec4 delta    = glm::abs(reference[pixel] - image[pixel]);
+        const float     maxDelta = std::max(std::max(delta.x, delta.y), std::max(delta.z, delta.w));
+        diff.maxError            = std::max(diff.maxError, maxDelta);
+        diff.mismatchedPixels += maxDelta > tolerance ? 1 : 0;
+        errorSum += delta.x + delta.y + delta.z + delta.w;
+        squaredSum += glm::dot(delta, delta);
+    }
+    diff.meanError   = float(errorSum / double(pixelCount * 4));
+    const double mse = squaredSum / double(pixelCount * 4);
+    diff.psnr        = mse > 0.0 ? float(10.0 * std::log10(1.0 / mse)) : 99.0f;
+    return diff;
+}
+
+} // namespace Play
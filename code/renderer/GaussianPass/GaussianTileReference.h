@@ -0,0 +1,54 @@
+#ifndef GAUSSIAN_TILE_REFERENCE_H
+#define GAUSSIAN_TILE_REFERENCE_H
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Hdevice.h"
+
+namespace Play
+{
+class GaussianScene;
+
+// cpu mirror of GaussianTileSplat, produced by the same projection as gaussianTilePreprocess.comp.slang
+struct GaussianTileReferenceSplat
+{
+    uint32_t  splatIndex = 0;
+    glm::vec2 center     = glm::vec2(0.0f);
+    float     depth      = 0.0f;
+    float     radius     = 0.0f;
+    glm::vec3 conic      = glm::vec3(0.0f);
+    glm::vec4 color      = glm::vec4(0.0f);
+};
+
+// one splat in one tile, keyed (tile, quantized depth) like the gpu sort keys. splat indexes the projected splats
+struct GaussianTileEntry
+{
+    uint32_t key   = 0;
+    uint32_t splat = 0;
+};
+
+struct GaussianImageDiff
+{
+    float    maxError         = 0.0f;
+    float    meanError        = 0.0f;
+    float    psnr             = 0.0f;
+    uint32_t mismatchedPixels = 0;
+};
+
+std::vector<GaussianTileReferenceSplat> projectGaussianSplats(const GaussianScene& scene, const CameraData& camera);
+
+// duplicates every splat into the tiles its radius square touches and sorts the entries by key, ties by splat index
+std::vector<GaussianTileEntry> binGaussianTiles(std::span<const GaussianTileReferenceSplat> splats, uint32_t width, uint32_t height,
+                                                uint32_t depthBits);
+
+// bins, sorts and blends exactly like the compute tile rasterizer, output is rgb + coverage in row-major order
+void rasterizeGaussianTilesReference(std::span<const GaussianTileReferenceSplat> splats, uint32_t width, uint32_t height, uint32_t depthBits,
+                                     std::vector<glm::vec4>& pixels);
+
+// per channel absolute difference, a pixel counts as mismatched when any channel exceeds the tolerance
+GaussianImageDiff compareGaussianImages(std::span<const glm::vec4> reference, std::span<const glm::vec4> image, float tolerance);
+
+} // namespace Play
+
+#endif // GAUSSIAN_TILE_REFERENCE_H
@@ -1,6 +1,9 @@
 #include "GaussianRenderer.h"
 #include "GaussianPass/GaussianSortPass.h"
+#include "GaussianPass/GaussianShCachePass.h"
 #include "GaussianPass/GaussianDrawMeshPass.h"
+#include "GaussianPass/GaussianTileRasterPass.h"
+#include "core/runtime/RenderSession.h"
 #include "SceneManager.h"
 namespace Play
 {
@@ -17,7 +20,13 @@ GaussianRenderer::~GaussianRenderer() {}
 
 void GaussianRenderer::setupPasses()
 {
+    if (_view->getGaussianBackend() == RenderSession::GaussianBackend::eTileCompute)
+    {
+        _passes.emplace_back(std::make_unique<GaussianTileRasterPass>(this));
+        return;
+    }
     _passes.emplace_back(std::make_unique<GaussianSortPass>(this));
+    _passes.emplace_back(std::make_unique<GaussianShCachePass>(this));
     _passes.emplace_back(std::make_unique<GaussianDrawMeshPass>(this));
 }
 
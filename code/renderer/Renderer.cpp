@@ -6,6 +6,7 @@
 #include "RDG/RDG.h"
 #include "renderPasses/RenderPass.h"
 #include "renderPasses/PresentPass.h"
+#include "renderPasses/TemporalReprojection.h"
 #include <algorithm>
 namespace Play
 {
@@ -73,15 +74,25 @@ void Renderer::updateCameraBuffer()
     // update curr activated camera into camera buffer
     PlayCamera* camera = getActiveCamera();
     camera->update(vkDriver->getInputState(), static_cast<float>(vkDriver->getDeltaTime()));
+
+    const uint32_t  jitterPhases = temporalJitterPhaseCount(getRenderScale());
+    const glm::vec2 jitter       = _temporalJitter ? temporalJitterOffset(_jitterFrameIndex++, jitterPhases) : glm::vec2(0.0f);
+    camera->setJitter(jitter, _renderExtent);
+
     CameraData data{};
-    data.cameraPosition    = camera->getCameraManipulator()->getEye();
-    data.projMatrix        = camera->getCameraManipulator()->getPerspectiveMatrix();
-    data.viewMatrix        = camera->getCameraManipulator()->getViewMatrix();
-    data.viewPortSize      = {vkDriver->getViewportSize().width, vkDriver->getViewportSize().height};
-    data.viewProjMatrix    = data.projMatrix * data.viewMatrix;
-    data.invViewMatrix     = glm::inverse(data.viewMatrix);
-    data.invProjMatrix     = glm::inverse(data.projMatrix);
-    data.invViewProjMatrix = glm::inverse(data.viewProjMatrix);
+    data.cameraPosition           = camera->getCameraManipulator()->getEye();
+    data.projMatrix               = camera->getJitteredPerspectiveMatrix();
+    data.viewMatrix               = camera->getCameraManipulator()->getViewMatrix();
+    data.viewPortSize             = {_renderExtent.width, _renderExtent.height};
+    data.viewProjMatrix           = data.projMatrix * data.viewMatrix;
+    data.invViewMatrix            = glm::inverse(data.viewMatrix);
+    data.invProjMatrix            = glm::inverse(data.projMatrix);
+    data.invViewProjMatrix        = glm::inverse(data.viewProjMatrix);
+    data.unjitteredViewProjMatrix = camera->getCameraManipulator()->getPerspectiveMatrix() * data.viewMatrix;
+    data.prevViewProjMatrix       = _hasPrevViewProj ? _prevViewProjMatrix : data.unjitteredViewProjMatrix;
+    data.jitter                   = camera->getJitter();
+    _prevViewProjMatrix           = data.unjitteredViewProjMatrix;
+    _hasPrevViewProj              = true;
 
     _cameraDatas[vkDriver->getFrameCycleIndex()] = data;
     memcpy(getCurrentCameraBuffer()->mapping, &data, sizeof(CameraData));
@@ -93,6 +104,42 @@ void Renderer::OnPreRender()
     updatePresentTexture();
     updateCameraBuffer();
     _scene->update();
+    for (auto& pass : _passes)
+    {
+        pass->update();
+    }
+
+    // ctrl and a right click pick the model under the cursor, the editor selects its node
+    const runtime::SdlInputState& input = vkDriver->getInputState();
+    if (input.mouseInWindow && input.ctrl && input.rmbPressed)
+    {
+        pickSceneNode(input.mouseX, input.mouseY);
+    }
+}
+
+void Renderer::pickSceneNode(float mouseX, float mouseY)
+{
+    const VkExtent2D& windowSize = vkDriver->getWindowSize();
+    if (windowSize.width == 0 || windowSize.height == 0)
+    {
+        return;
+    }
+
+    // the cursor unprojected onto the near and far planes, without the jitter of this frame
+    const CameraData& cameraData  = _cameraDatas[vkDriver->getFrameCycleIndex()];
+    const glm::mat4   invViewProj = glm::inverse(cameraData.unjitteredViewProjMatrix);
+    const glm::vec2   ndc(mouseX / static_cast<float>(windowSize.width) * 2.0f - 1.0f, mouseY / static_cast<float>(windowSize.height) * 2.0f - 1.0f);
+    const glm::vec4   nearPoint = invViewProj * glm::vec4(ndc, 0.0f, 1.0f);
+    const glm::vec4   farPoint  = invViewProj * glm::vec4(ndc, 1.0f, 1.0f);
+    const glm::vec3   origin    = glm::vec3(nearPoint) / nearPoint.w;
+    const glm::vec3   ray       = glm::vec3(farPoint) / farPoint.w - origin;
+    const float       length    = glm::length(ray);
+    if (length <= 0.0f)
+    {
+        return;
+    }
+
+    _scene->pickNode(origin, ray / length, length);
 }
 
 void Renderer::RenderFrame()
@@ -109,6 +156,9 @@ void Renderer::OnResize(int width, int height)
     width  = std::max(width, 1);
     height = std::max(height, 1);
 
+    const glm::uvec2 renderExtent = computeRenderExtent({uint32_t(width), uint32_t(height)}, getRenderScale());
+    _renderExtent                 = {renderExtent.x, renderExtent.y};
+
     for (auto& camera : _cameras)
     {
         camera->onResize({(uint32_t)width, (uint32_t)height});
@@ -47,6 +47,16 @@ public:
 
     Buffer*       getCurrentCameraBuffer() const;
     const CameraData& getCurrentCameraData() const;
+    // internal resolution of the scene passes, the viewport scaled by getRenderScale()
+    const VkExtent2D& getRenderExtent() const
+    {
+        return _renderExtent;
+    }
+    // cycles a sub pixel jitter through the camera projection for the temporal upscaler
+    void setTemporalJitter(bool enable)
+    {
+        _temporalJitter = enable;
+    }
     SceneManager* getSceneManager()
     {
         return _scene.get();
@@ -57,6 +67,11 @@ public:
 protected:
     virtual void setupPasses() = 0;
 
+    virtual float getRenderScale() const
+    {
+        return 1.0f;
+    }
+
     void                                     updateCameraBuffer();
     std::unique_ptr<SceneManager>            _scene;
     std::vector<std::unique_ptr<PlayCamera>> _cameras;
@@ -67,9 +82,17 @@ protected:
     std::unique_ptr<RDG::RDGBuilder>         _rdgBuilder;
     std::vector<std::unique_ptr<BasePass>>   _passes;
     RenderSession*                           _view = nullptr;
+    VkExtent2D                               _renderExtent = {1, 1};
+
+    // jitter phase and the previous frame's unjittered viewProj, the reference of the velocity target
+    bool      _temporalJitter     = false;
+    uint32_t  _jitterFrameIndex   = 0;
+    bool      _hasPrevViewProj    = false;
+    glm::mat4 _prevViewProjMatrix = glm::mat4(1.0f);
 
 private:
     void updatePresentTexture();
+    void pickSceneNode(float mouseX, float mouseY);
 };
 
 } // namespace Play
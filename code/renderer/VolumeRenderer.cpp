@@ -2,6 +2,7 @@
 
 #include "renderPasses/PresentPass.h"
 #include "renderPasses/VolumeRenderPass.h"
+#include "core/runtime/RenderSession.h"
 
 namespace Play
 {
@@ -31,6 +32,11 @@ void VolumeRenderer::OnResize(int width, int height)
     Renderer::OnResize(width, height);
 }
 
+const std::string& VolumeRenderer::getVolumeDataPath() const
+{
+    return _view->getVolumeDataPath();
+}
+
 void VolumeRenderer::setupPasses()
 {
     auto volumePass = std::make_unique<VolumeRenderPass>(this);
@@ -16,6 +16,7 @@ public:
 
     void OnPreRender() override;
     void OnResize(int width, int height) override;
+    const std::string& getVolumeDataPath() const;
 
     RTTR_ENABLE(Renderer)
 
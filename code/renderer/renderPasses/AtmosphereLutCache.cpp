@@ -0,0 +1,82 @@
+#include "AtmosphereLutCache.h"
+#include <cmath>
+#include <cstring>
+
+namespace Play
+{
+namespace
+{
+// every field is hashed by name below, a new one has to be added there and to this count
+static_assert(sizeof(AtmosphereParameters) == 35 * sizeof(float), "AtmosphereParameters changed, update the lut hashes");
+
+// fnv-1a over the bits of each float, stable across runs and builds
+uint64_t hashFloat(uint64_t hash, float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        hash = (hash ^ ((bits >> (i * 8)) & 0xffu)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t hashFloat(uint64_t hash, const glm::vec2& value)
+{
+    return hashFloat(hashFloat(hash, value.x), value.y);
+}
+
+uint64_t hashFloat(uint64_t hash, const glm::vec3& value)
+{
+    return hashFloat(hashFloat(hashFloat(hash, value.x), value.y), value.z);
+}
+} // namespace
+
+uint64_t hashAtmosphereMedium(const AtmosphereParameters& atmosphere)
+{
+    uint64_t hash = 14695981039346656037ull;
+    hash          = hashFloat(hash, atmosphere.BottomRadius);
+    hash          = hashFloat(hash, atmosphere.TopRadius);
+    hash          = hashFloat(hash, atmosphere.RayleighDensityExpScale);
+    hash          = hashFloat(hash, atmosphere.RayleighScattering);
+    hash          = hashFloat(hash, atmosphere.MieDensityExpScale);
+    hash          = hashFloat(hash, atmosphere.MieScattering);
+    hash          = hashFloat(hash, atmosphere.MieExtinction);
+    hash          = hashFloat(hash, atmosphere.MieAbsorption);
+    hash          = hashFloat(hash, atmosphere.MiePhaseG);
+    hash          = hashFloat(hash, atmosphere.AbsorptionDensity0LayerWidth);
+    hash          = hashFloat(hash, atmosphere.AbsorptionDensity0ConstantTerm);
+    hash          = hashFloat(hash, atmosphere.AbsorptionDensity0LinearTerm);
+    hash          = hashFloat(hash, atmosphere.AbsorptionDensity1ConstantTerm);
+    hash          = hashFloat(hash, atmosphere.AbsorptionDensity1LinearTerm);
+    hash          = hashFloat(hash, atmosphere.AbsorptionExtinction);
+    hash          = hashFloat(hash, atmosphere.GroundAlbedo);
+    return hash;
+}
+
+// solar_irradiance, sun_angular_radius and mu_s_min are not part of the shader side struct, no lut reads them
+uint64_t hashAtmosphereSkyView(const AtmosphereParameters& atmosphere, uint64_t mediumHash)
+{
+    return hashFloat(mediumHash, atmosphere.sun_dir);
+}
+
+void AtmosphereLutTracker::update(const AtmosphereParameters& atmosphere, float viewHeight, const AtmosphereLutSettings& settings)
+{
+    _mediumHash                = hashAtmosphereMedium(atmosphere);
+    const uint64_t skyViewHash = hashAtmosphereSkyView(atmosphere, _mediumHash);
+
+    _bakeAtmosphereLuts = !settings.CacheLuts || _mediumHash != _bakedMediumHash;
+    _bakeSkyViewLut     = _bakeAtmosphereLuts || skyViewHash != _bakedSkyViewHash ||
+                      std::abs(viewHeight - _bakedViewHeight) > settings.SkyViewAltitudeTolerance;
+    if (_bakeAtmosphereLuts)
+    {
+        _bakedMediumHash = _mediumHash;
+    }
+    if (_bakeSkyViewLut)
+    {
+        _bakedSkyViewHash = skyViewHash;
+        _bakedViewHeight  = viewHeight;
+    }
+}
+
+} // namespace Play
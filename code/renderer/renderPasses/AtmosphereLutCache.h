@@ -0,0 +1,91 @@
+#ifndef ATMOSPHERE_LUT_CACHE_H
+#define ATMOSPHERE_LUT_CACHE_H
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "Hdevice.h"
+
+// Keep explicit padding so the CPU-side layout matches the shader constant-buffer packing.
+struct AtmosphereParameters
+{
+    float BottomRadius            DEFAULT(6360.0f);
+    float TopRadius               DEFAULT(6460.0f);
+    float RayleighDensityExpScale DEFAULT(-0.125);
+
+    float3 RayleighScattering DEFAULT(float3(0.005802f, 0.013558f, 0.033100f));
+    float MieDensityExpScale  DEFAULT(-0.8333333);
+
+    float3 MieScattering DEFAULT(float3(0.003996, 0.003996, 0.003996));
+
+    float3 MieExtinction DEFAULT(float3(0.004440, 0.004440, 0.004440));
+
+    float3 MieAbsorption DEFAULT(float3(0.000444, 0.000444, 0.000444));
+    float MiePhaseG      DEFAULT(0.8f);
+
+    float AbsorptionDensity0LayerWidth   DEFAULT(25.0f);
+    float AbsorptionDensity0ConstantTerm DEFAULT(-2.0f / 3.0f);
+    float AbsorptionDensity0LinearTerm   DEFAULT(1.0f / 15.0f);
+    float AbsorptionDensity1ConstantTerm DEFAULT(8.0f / 3.0f);
+
+    float AbsorptionDensity1LinearTerm DEFAULT(-1.0f / 15.0f);
+    float3 AbsorptionExtinction        DEFAULT(float3(0.000650, 0.001881, 0.000085));
+
+    float3 GroundAlbedo DEFAULT(float3(0.0f, 0.0f, 0.0f));
+
+    float2 sun_dir           DEFAULT(float2(0.0f, 0.45f));
+    float3 solar_irradiance  DEFAULT(float3(1.0f));
+    float sun_angular_radius DEFAULT(0.004675);
+    float mu_s_min           DEFAULT(-0.5);
+};
+
+namespace Play
+{
+
+struct AtmosphereLutSettings
+{
+    bool  CacheLuts                = true;
+    float SkyViewAltitudeTolerance = 0.001f; // km the camera may climb or sink before the sky-view lut is baked again
+    bool  PersistLuts              = true;   // keeps baked transmittance and multi-scattering luts under cache/atmosphere
+};
+
+// hash of the fields the transmittance and multi-scattering luts read, stable across runs so it can key them on disk
+uint64_t hashAtmosphereMedium(const AtmosphereParameters& atmosphere);
+// extends the medium hash by the sun direction, which together with the altitude is all the sky-view lut adds
+uint64_t hashAtmosphereSkyView(const AtmosphereParameters& atmosphere, uint64_t mediumHash);
+
+// decides once per frame which atmosphere luts have to be baked again. The transmittance and multi-scattering luts only
+// depend on the medium, the sky-view lut also on the sun direction and the camera altitude
+class AtmosphereLutTracker
+{
+public:
+    void update(const AtmosphereParameters& atmosphere, float viewHeight, const AtmosphereLutSettings& settings);
+    // the medium luts were loaded from disk, they count as baked
+    void markMediumBaked(uint64_t mediumHash)
+    {
+        _bakedMediumHash = mediumHash;
+    }
+    uint64_t getMediumHash() const
+    {
+        return _mediumHash;
+    }
+    bool bakeAtmosphereLuts() const
+    {
+        return _bakeAtmosphereLuts;
+    }
+    bool bakeSkyViewLut() const
+    {
+        return _bakeSkyViewLut;
+    }
+
+private:
+    uint64_t _mediumHash         = 0;
+    uint64_t _bakedMediumHash    = 0;
+    uint64_t _bakedSkyViewHash   = 0;
+    float    _bakedViewHeight    = 0.0f;
+    bool     _bakeAtmosphereLuts = true;
+    bool     _bakeSkyViewLut     = true;
+};
+
+} // namespace Play
+
+#endif // ATMOSPHERE_LUT_CACHE_H
@@ -2,6 +2,7 @@
 
 #include "DeferRendering.h"
 #include "ShaderManager.hpp"
+#include "ShaderPermutation.h"
 #include "PConstantType.h.slang"
 #include "PlayAllocator.h"
 #include "RDG/RDG.h"
@@ -120,6 +121,43 @@ uint64_t textureInfoAddressForModel(const ModelAsset& model, const GpuModelRange
     return model.textureInfoBuffer->address;
 }
 
+bool usesDepthPrepass(const GpuSceneCommonData& common, uint32_t materialIndex)
+{
+    if (materialIndex >= common.materials.size())
+    {
+        return false;
+    }
+    switch (materialIndex < common.materialDepthPrepass.size() ? common.materialDepthPrepass[materialIndex] : MaterialDepthPrepass::eAuto)
+    {
+        case MaterialDepthPrepass::eEnabled:
+            return true;
+        case MaterialDepthPrepass::eDisabled:
+            return false;
+        case MaterialDepthPrepass::eAuto:
+        default:
+            return common.materials[materialIndex].alphaMode == shaderio::eAlphaModeOpaque;
+    }
+}
+
+// keeps the paths the material reads. A texture it does not have is never sampled and a black emissive factor adds
+// nothing, so every variant shades its materials like the unspecialized shader
+ShaderVariantKey getMaterialShaderVariant(const ShaderPermutation& permutation, const shaderio::GltfShadeMaterial& material)
+{
+    const std::pair<std::string, bool> keywords[] = {
+        {BuiltinShaders::GBUFFER_KEYWORD_METALLIC_ROUGHNESS_TEXTURE, material.pbrMetallicRoughnessTexture != 0},
+        {BuiltinShaders::GBUFFER_KEYWORD_SPECULAR_TEXTURE, material.specularTexture != 0},
+        {BuiltinShaders::GBUFFER_KEYWORD_OCCLUSION_TEXTURE, material.occlusionTexture != 0},
+        {BuiltinShaders::GBUFFER_KEYWORD_EMISSIVE, material.emissiveFactor != glm::vec3(0.0f)},
+        {BuiltinShaders::GBUFFER_KEYWORD_NORMAL_TEXTURE, material.normalTexture != 0},
+    };
+    ShaderVariantKey variant = 0;
+    for (const auto& [keyword, enabled] : keywords)
+    {
+        variant = permutation.setKeyword(variant, keyword, enabled);
+    }
+    return variant;
+}
+
 } // namespace
 
 void GBufferPass::init()
@@ -135,6 +173,39 @@ void GBufferPass::init()
                                                          VK_COLOR_COMPONENT_A_BIT);
     const VkColorBlendEquationEXT defaultBlendEquation = _gbufferPipeline.psoState.colorBlendEquations.front();
     _gbufferPipeline.psoState.colorBlendEquations.resize(kGBufferColorAttachmentCount, defaultBlendEquation);
+
+    // the prepass already wrote the nearest depth, only the visible fragment of every pixel passes
+    _gbufferEqualPipeline                                             = _gbufferPipeline;
+    _gbufferEqualPipeline.psoState.depthStencilState.depthCompareOp   = VK_COMPARE_OP_EQUAL;
+    _gbufferEqualPipeline.psoState.depthStencilState.depthWriteEnable = VK_FALSE;
+    _variantPipelines.clear();
+}
+
+GBufferPass::VariantPipelines& GBufferPass::getVariantPipelines(ShaderVariantKey variant)
+{
+    auto found = _variantPipelines.find(variant);
+    if (found != _variantPipelines.end())
+    {
+        return found->second;
+    }
+
+    VariantPipelines pipelines = {_gbufferPipeline, _gbufferEqualPipeline};
+    if (variant != kGBufferDefaultShaderVariant)
+    {
+        // a variant that does not load keeps drawing with the unspecialized shader
+        const uint32_t fragShaderID = ShaderManager::Instance().getOrLoadVariant(BuiltinShaders::BUILTIN_DEFAULT_GBUFFER_FRAG_SHADER_NAME, variant);
+        if (fragShaderID != ~0U)
+        {
+            pipelines.pipeline.shaderSet.fragModuleID      = fragShaderID;
+            pipelines.equalPipeline.shaderSet.fragModuleID = fragShaderID;
+        }
+    }
+    return _variantPipelines.emplace(variant, std::move(pipelines)).first->second;
+}
+
+void GBufferPass::update()
+{
+    prepareRenderList();
 }
 
 void GBufferPass::prepareRenderList()
@@ -142,6 +213,7 @@ void GBufferPass::prepareRenderList()
     _visibleInstances.clear();
     _renderItems.clear();
     _gpuInstanceData.clear();
+    _frameVariants.clear();
 
     if (!_ownedRender || !_ownedRender->getSceneManager())
     {
@@ -156,98 +228,71 @@ void GBufferPass::prepareRenderList()
     }
 
     const CameraData& cameraData = _ownedRender->getCurrentCameraData();
-    sceneManager->readSceneGraph([&](const CpuScene& scene) { collectVisibleInstances(scene, *gpuScene, cameraData); });
+    const SceneBVH*   sceneBVH   = sceneManager->getSettings().BVHCulling ? &sceneManager->getSceneBVH() : nullptr;
+    sceneManager->readSceneGraph([&](const CpuScene& scene) { collectVisibleInstances(scene, *gpuScene, sceneBVH, cameraData); });
 
     buildRenderList(*gpuScene);
     sortRenderList();
     uploadGPUInstanceData();
 }
 
-void GBufferPass::collectVisibleInstances(const CpuScene& scene, const GpuScene& gpuScene, const CameraData& cameraData)
+void GBufferPass::collectVisibleInstances(const CpuScene& scene, const GpuScene& gpuScene, const SceneBVH* sceneBVH, const CameraData& cameraData)
 {
     const std::vector<ModelAsset>& models = gpuScene.getModels();
 
     const std::vector<CpuSceneNode>& nodes = scene.getNodes();
-    for (uint32_t nodeIndex = 0; nodeIndex < nodes.size(); ++nodeIndex)
+    _prevNodeTransforms.swap(_currNodeTransforms);
+    _currNodeTransforms.assign(nodes.size(), std::nullopt);
+    if (sceneBVH)
     {
-        const CpuSceneNode& node = nodes[nodeIndex];
-        if (!node.alive || !node.worldVisible)
+        // the tree hands out the instances whose bounds reach into the frustum, the others are never visited
+        _frustumInstances.clear();
+        sceneBVH->queryFrustum(cameraData.viewProjMatrix, _frustumInstances);
+        for (uint32_t instance : _frustumInstances)
         {
-            continue;
+            const CpuSceneNodeID nodeID = sceneBVH->getInstances()[instance].node;
+            addVisibleInstance(scene.getNode(nodeID), scene.getComponent<CpuModelComponent>(nodeID), models, cameraData, false);
         }
+        return;
+    }
 
-        for (CpuSceneComponentID componentID : node.components)
-        {
-            const CpuModelComponent* modelComponent = scene.getComponent<CpuModelComponent>(componentID);
-            if (!modelComponent || !modelComponent->visible || !modelComponent->hasModel())
-            {
-                continue;
-            }
-
-            if (modelComponent->model.index >= models.size())
-            {
-                continue;
-            }
-
-            const ModelAsset& model = models[modelComponent->model.index];
-            if (model.generation != modelComponent->model.generation || model.renderables.empty())
-            {
-                continue;
-            }
-
-            const uint32_t firstRenderable = modelComponent->firstRenderable;
-            if (firstRenderable >= model.renderables.size())
-            {
-                continue;
-            }
+    // model components sit densely in their pool, nodes without one are never visited
+    for (const CpuModelComponent& modelComponent : scene.view<CpuModelComponent>())
+    {
+        addVisibleInstance(scene.getNode(modelComponent.ownerNode), &modelComponent, models, cameraData, true);
+    }
+}
 
-            const uint32_t availableRenderables = static_cast<uint32_t>(model.renderables.size()) - firstRenderable;
-            uint32_t       renderableCount      = modelComponent->usesAllRenderables() ? availableRenderables : modelComponent->renderableCount;
-            if (renderableCount > availableRenderables)
-            {
-                renderableCount = availableRenderables;
-            }
-            if (renderableCount == 0)
-            {
-                continue;
-            }
+void GBufferPass::addVisibleInstance(const CpuSceneNode* node, const CpuModelComponent* modelComponent, const std::vector<ModelAsset>& models,
+                                     const CameraData& cameraData, bool testFrustum)
+{
+    ModelInstanceRange range;
+    if (!node || !modelComponent || !node->worldVisible || !modelComponent->visible ||
+        !resolveModelInstance(*modelComponent, models, range))
+    {
+        return;
+    }
 
-            AABB localBounds;
-            bool hasBounds = false;
-            for (uint32_t renderableOffset = 0; renderableOffset < renderableCount; ++renderableOffset)
-            {
-                const ModelRenderableTemplate& renderable = model.renderables[firstRenderable + renderableOffset];
-                if (hasBounds)
-                {
-                    expandAABB(localBounds, renderable.modelBounds);
-                }
-                else
-                {
-                    localBounds = renderable.modelBounds;
-                    hasBounds   = true;
-                }
-            }
-            if (!hasBounds)
-            {
-                continue;
-            }
+    GBufferVisibleInstance visibleInstance;
+    visibleInstance.modelIndex      = modelComponent->model.index;
+    visibleInstance.firstRenderable = range.firstRenderable;
+    visibleInstance.renderableCount = range.renderableCount;
+    visibleInstance.objectToWorld   = node->worldTransform;
+    visibleInstance.worldBounds     = transformAABB(range.localBounds, node->worldTransform);
+    visibleInstance.depthKey        = computeDepthKey(visibleInstance.worldBounds, cameraData);
 
-            GBufferVisibleInstance visibleInstance;
-            visibleInstance.modelIndex      = modelComponent->model.index;
-            visibleInstance.firstRenderable = firstRenderable;
-            visibleInstance.renderableCount = renderableCount;
-            visibleInstance.objectToWorld   = node.worldTransform;
-            visibleInstance.worldBounds     = transformAABB(localBounds, node.worldTransform);
-            visibleInstance.depthKey        = computeDepthKey(visibleInstance.worldBounds, cameraData);
+    if (testFrustum && !isBoundsInFrustum(visibleInstance.worldBounds, cameraData.viewProjMatrix))
+    {
+        return;
+    }
 
-            if (!isBoundsInFrustum(visibleInstance.worldBounds, cameraData.viewProjMatrix))
-            {
-                continue;
-            }
+    // nodes that were not drawn last frame only move with the camera
+    const uint32_t nodeIndex          = modelComponent->ownerNode.index;
+    const bool     hasPrevTransform   = nodeIndex < _prevNodeTransforms.size() && _prevNodeTransforms[nodeIndex].has_value();
+    visibleInstance.prevObjectToWorld = hasPrevTransform ? *_prevNodeTransforms[nodeIndex] : node->worldTransform;
+    _currNodeTransforms[nodeIndex]    = node->worldTransform;
 
-            _visibleInstances.push_back(visibleInstance);
-        }
-    }
+    _visibleInstances.push_back(visibleInstance);
 }
 
 void GBufferPass::buildRenderList(const GpuScene& gpuScene)
@@ -256,6 +301,14 @@ void GBufferPass::buildRenderList(const GpuScene& gpuScene)
     const std::vector<ModelAsset>&    models      = gpuScene.getModels();
     const std::vector<GpuModelRange>& modelRanges = gpuScene.getModelRanges();
 
+    // once per material rather than per item, the keywords are looked up by name
+    const ShaderPermutation*      permutation = ShaderManager::Instance().getPermutation(BuiltinShaders::BUILTIN_DEFAULT_GBUFFER_FRAG_SHADER_NAME);
+    std::vector<ShaderVariantKey> materialVariants(common.materials.size(), kGBufferDefaultShaderVariant);
+    for (size_t materialIndex = 0; permutation && materialIndex < common.materials.size(); ++materialIndex)
+    {
+        materialVariants[materialIndex] = getMaterialShaderVariant(*permutation, common.materials[materialIndex]);
+    }
+
     for (uint32_t visibleIndex = 0; visibleIndex < _visibleInstances.size(); ++visibleIndex)
     {
         const GBufferVisibleInstance& visibleInstance = _visibleInstances[visibleIndex];
@@ -297,6 +350,7 @@ void GBufferPass::buildRenderList(const GpuScene& gpuScene)
             GBufferGPUInstanceData gpuInstanceData;
             gpuInstanceData.objectToWorld      = visibleInstance.objectToWorld * renderable.localToModel;
             gpuInstanceData.worldToObject      = glm::inverse(gpuInstanceData.objectToWorld);
+            gpuInstanceData.prevObjectToWorld  = visibleInstance.prevObjectToWorld * renderable.localToModel;
             gpuInstanceData.meshInfoAddress    = meshInfoAddressForModel(model, range, meshInfoIndex);
             gpuInstanceData.materialAddress    = materialAddressForModel(model, range, meshInfo.materialIdx);
             gpuInstanceData.textureInfoAddress = textureInfoAddressForModel(model, range);
@@ -318,6 +372,17 @@ void GBufferPass::buildRenderList(const GpuScene& gpuScene)
             renderItem.depthKey             = visibleInstance.depthKey;
             renderItem.sortKey              = makeSortKey(renderItem.depthKey, renderItem.materialIndex, renderItem.meshInfoIndex);
             renderItem.gpuInstanceIndex     = static_cast<uint32_t>(_gpuInstanceData.size());
+            renderItem.depthPrepass         = usesDepthPrepass(common, meshInfo.materialIdx);
+            if (meshInfo.materialIdx < materialVariants.size())
+            {
+                renderItem.shaderVariant = materialVariants[meshInfo.materialIdx];
+            }
+            // the pipelines of a new variant are set up here, outside the recording
+            if (std::find(_frameVariants.begin(), _frameVariants.end(), renderItem.shaderVariant) == _frameVariants.end())
+            {
+                getVariantPipelines(renderItem.shaderVariant);
+                _frameVariants.push_back(renderItem.shaderVariant);
+            }
 
             _gpuInstanceData.push_back(gpuInstanceData);
             _renderItems.push_back(renderItem);
@@ -380,12 +445,20 @@ void GBufferPass::uploadGPUInstanceData()
     }
 }
 
+TextureStreamer* GBufferPass::getTextureStreamer() const
+{
+    SceneManager* sceneManager = _ownedRender ? _ownedRender->getSceneManager() : nullptr;
+    GpuScene*     gpuScene     = sceneManager ? sceneManager->getGpuScene() : nullptr;
+    return gpuScene ? &gpuScene->getTextureStreamer() : nullptr;
+}
+
 void GBufferPass::build(RDG::RDGBuilder* rdgBuilder)
 {
-    RDG::RDGTextureRef BaseColorRT = rdgBuilder->getTexture("SkyBoxRT");
+    const VkExtent2D   renderExtent = _ownedRender->getRenderExtent();
+    RDG::RDGTextureRef BaseColorRT  = rdgBuilder->getTexture("SkyBoxRT");
 
     RDG::RDGTextureRef WorldNormalRT = rdgBuilder->createTexture(GBufferConfig::Get(GBufferType::GNormal).debugName)
-                                           .Extent({vkDriver->getViewportSize().width, vkDriver->getViewportSize().height, 1})
+                                           .Extent({renderExtent.width, renderExtent.height, 1})
                                            .AspectFlags(VK_IMAGE_ASPECT_COLOR_BIT)
                                            .Format(GBufferConfig::Get(GBufferType::GNormal).format)
                                            .UsageFlags(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)
@@ -393,7 +466,7 @@ void GBufferPass::build(RDG::RDGBuilder* rdgBuilder)
                                            .finish();
 
     RDG::RDGTextureRef PBRRT = rdgBuilder->createTexture(GBufferConfig::Get(GBufferType::GPBR).debugName)
-                                   .Extent({vkDriver->getViewportSize().width, vkDriver->getViewportSize().height, 1})
+                                   .Extent({renderExtent.width, renderExtent.height, 1})
                                    .AspectFlags(VK_IMAGE_ASPECT_COLOR_BIT)
                                    .Format(GBufferConfig::Get(GBufferType::GPBR).format)
                                    .UsageFlags(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)
@@ -401,7 +474,7 @@ void GBufferPass::build(RDG::RDGBuilder* rdgBuilder)
                                    .finish();
 
     RDG::RDGTextureRef EmissiveRT = rdgBuilder->createTexture(GBufferConfig::Get(GBufferType::GEmissive).debugName)
-                                        .Extent({vkDriver->getViewportSize().width, vkDriver->getViewportSize().height, 1})
+                                        .Extent({renderExtent.width, renderExtent.height, 1})
                                         .AspectFlags(VK_IMAGE_ASPECT_COLOR_BIT)
                                         .Format(GBufferConfig::Get(GBufferType::GEmissive).format)
                                         .UsageFlags(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)
@@ -409,7 +482,7 @@ void GBufferPass::build(RDG::RDGBuilder* rdgBuilder)
                                         .finish();
 
     RDG::RDGTextureRef Custom1RT = rdgBuilder->createTexture(GBufferConfig::Get(GBufferType::GCustomData).debugName)
-                                       .Extent({vkDriver->getViewportSize().width, vkDriver->getViewportSize().height, 1})
+                                       .Extent({renderExtent.width, renderExtent.height, 1})
                                        .AspectFlags(VK_IMAGE_ASPECT_COLOR_BIT)
                                        .Format(GBufferConfig::Get(GBufferType::GCustomData).format)
                                        .UsageFlags(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)
@@ -417,24 +490,18 @@ void GBufferPass::build(RDG::RDGBuilder* rdgBuilder)
                                        .finish();
 
     RDG::RDGTextureRef VelocityRT = rdgBuilder->createTexture(GBufferConfig::Get(GBufferType::GVelocity).debugName)
-                                        .Extent({vkDriver->getViewportSize().width, vkDriver->getViewportSize().height, 1})
+                                        .Extent({renderExtent.width, renderExtent.height, 1})
                                         .AspectFlags(VK_IMAGE_ASPECT_COLOR_BIT)
                                         .Format(GBufferConfig::Get(GBufferType::GVelocity).format)
                                         .UsageFlags(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)
                                         .MipmapLevel(1)
                                         .finish();
 
-    const auto         depthFormat = GBufferConfig::Get(GBufferType::GSceneDepth).format;
-    RDG::RDGTextureRef DepthRT     = rdgBuilder->createTexture(GBufferConfig::Get(GBufferType::GSceneDepth).debugName)
-                                     .Extent({vkDriver->getViewportSize().width, vkDriver->getViewportSize().height, 1})
-                                     .AspectFlags(inferImageAspectFlags(depthFormat, false))
-                                     .Format(depthFormat)
-                                     .UsageFlags(VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)
-                                     .MipmapLevel(1)
-                                     .finish();
+    // created and laid down by the depth prepass
+    RDG::RDGTextureRef DepthRT = rdgBuilder->getTexture(GBufferConfig::Get(GBufferType::GSceneDepth).debugName);
 
     auto pass =
-        rdgBuilder->createRenderPass("GBufferPass")
+        rdgBuilder->createRenderPass(PASS_NAME)
             .color(0, BaseColorRT, VK_ATTACHMENT_LOAD_OP_LOAD, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
             .color(1, WorldNormalRT, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
@@ -447,45 +514,78 @@ void GBufferPass::build(RDG::RDGBuilder* rdgBuilder)
                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
             .color(5, VelocityRT, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-            .depth(DepthRT, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+            .depth(DepthRT, VK_ATTACHMENT_LOAD_OP_LOAD, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+            .shadingRate(rdgBuilder->getTexture("ShadingRateImage"), _ownedRender->getShadingRateTexelSize())
+            .queryStatistics()
             .execute(
-                [this](RDG::PassNode* node, RDG::RenderContext& context)
+                [this, renderExtent](RDG::PassNode* node, RDG::RenderContext& context)
                 {
-                    prepareRenderList();
-
+                    // the render list was prepared by the depth prepass
                     if (_renderItems.empty())
                     {
                         return;
                     }
-                    VkCommandBuffer cmd = context._currCmdBuffer;
+                    VkCommandBuffer  cmd             = context._currCmdBuffer;
+                    TextureStreamer* textureStreamer = getTextureStreamer();
 
                     GBufferPushConstant pushConstant{};
                     pushConstant.perFrameConstant.cameraBufferDeviceAddress = _ownedRender->getCurrentCameraBuffer()->address;
-                    pushConstant.sceneConstant.instanceBufferAddress        = _gpuInstanceDataBuffer ? _gpuInstanceDataBuffer->address : 0;
-
-                    context.bindPipeline(_gbufferPipeline);
+                    pushConstant.sceneConstant.instanceBufferAddress        = getInstanceBufferAddress();
+                    pushConstant.sceneConstant.textureFeedbackAddress       = textureStreamer ? textureStreamer->getFeedbackAddress() : 0;
 
-                    VkViewport viewport = {
-                        0,    0,   static_cast<float>(vkDriver->getViewportSize().width), static_cast<float>(vkDriver->getViewportSize().height),
-                        0.0f, 1.0f};
-                    VkRect2D scissor = {{0, 0}, {vkDriver->getViewportSize().width, vkDriver->getViewportSize().height}};
+                    VkViewport viewport = {0, 0, static_cast<float>(renderExtent.width), static_cast<float>(renderExtent.height), 0.0f, 1.0f};
+                    VkRect2D   scissor  = {{0, 0}, renderExtent};
                     vkCmdSetViewportWithCount(cmd, 1, &viewport);
                     vkCmdSetScissorWithCount(cmd, 1, &scissor);
 
-                    for (const GBufferRenderItem& item : _renderItems)
+                    // prepassed items first, the rest still gets its early depth test against them. Every variant binds its
+                    // pipeline once and draws its items in depth order
+                    auto drawItems = [&](ShaderVariantKey variant, GraphicsPipelineStateInitializer& pipeline, bool prepassedItems)
                     {
-                        if (item.indexCount == 0)
+                        bool pipelineBound = false;
+                        for (const GBufferRenderItem& item : _renderItems)
                         {
-                            continue;
+                            if (item.indexCount == 0 || item.shaderVariant != variant ||
+                                (item.depthPrepass && _depthPrepassDrawn) != prepassedItems)
+                            {
+                                continue;
+                            }
+                            if (!pipelineBound)
+                            {
+                                context.bindPipeline(pipeline);
+                                pipelineBound = true;
+                            }
+
+                            pushConstant.sceneConstant.instanceIndex = item.gpuInstanceIndex;
+                            context.bindPushConstant(pushConstant);
+                            vkCmdDraw(cmd, item.indexCount, 1, 0, 0);
                         }
-
-                        pushConstant.sceneConstant.instanceIndex = item.gpuInstanceIndex;
-                        context.bindPushConstant(pushConstant);
-                        vkCmdDraw(cmd, item.indexCount, 1, 0, 0);
+                    };
+                    for (ShaderVariantKey variant : _frameVariants)
+                    {
+                        drawItems(variant, getVariantPipelines(variant).equalPipeline, true);
+                    }
+                    for (ShaderVariantKey variant : _frameVariants)
+                    {
+                        drawItems(variant, getVariantPipelines(variant).pipeline, false);
                     }
                 })
             .finish();
+
+    // outside the render pass for its copies, the streamer reads the lods back and swaps in the uploaded textures when this
+    // frame cycle comes around again
+    [[maybe_unused]] auto streamingPass = rdgBuilder->createComputePass("Texture Streaming Pass")
+                                              .execute(
+                                                  [this](RDG::PassNode* node, RDG::RenderContext& context)
+                                                  {
+                                                      if (TextureStreamer* textureStreamer = getTextureStreamer())
+                                                      {
+                                                          textureStreamer->cmdResolveFeedback(context._currCmdBuffer);
+                                                          textureStreamer->cmdStreamTextures(context._currCmdBuffer);
+                                                      }
+                                                  })
+                                              .finish();
 }
 
 } // namespace Play
@@ -3,42 +3,54 @@
 #include "RenderPass.h"
 #include "GBufferConfig.h"
 #include "SceneAssets.h"
+#include "SceneBVH.h"
 #include "Resource.h"
 #include "PipelineCacheManager.h"
 #include "Hdevice.h"
+#include <optional>
+#include <unordered_map>
 #include <rttr/rttr_enable.h>
 namespace Play
 {
 class DeferRenderer;
 class GpuScene;
+class TextureStreamer;
 class CpuScene;
 
 struct GBufferVisibleInstance
 {
-    uint32_t  modelIndex      = INVALID_SCENE_ID;
-    uint32_t  firstRenderable = 0;
-    uint32_t  renderableCount = 0;
-    glm::mat4 objectToWorld   = glm::mat4(1.0f);
+    uint32_t  modelIndex        = INVALID_SCENE_ID;
+    uint32_t  firstRenderable   = 0;
+    uint32_t  renderableCount   = 0;
+    glm::mat4 objectToWorld     = glm::mat4(1.0f);
+    glm::mat4 prevObjectToWorld = glm::mat4(1.0f);
     AABB      worldBounds;
-    float     depthKey        = 0.0f;
+    float     depthKey          = 0.0f;
 };
 
+// an item's shaderVariant keeps the fragment paths its material reads and specializes the others away. This one draws
+// with the unspecialized shader, when the gbuffer permutation is not registered or its variant failed to load
+constexpr ShaderVariantKey kGBufferDefaultShaderVariant = ~0ULL;
+
 struct GBufferRenderItem
 {
-    uint64_t sortKey              = 0;
-    float    depthKey             = 0.0f;
-    uint32_t visibleInstanceIndex = INVALID_SCENE_ID;
-    uint32_t renderableIndex      = INVALID_SCENE_ID;
-    uint32_t meshInfoIndex        = INVALID_SCENE_ID;
-    uint32_t materialIndex        = INVALID_SCENE_ID;
-    uint32_t indexCount           = 0;
-    uint32_t gpuInstanceIndex     = INVALID_SCENE_ID;
+    uint64_t         sortKey              = 0;
+    float            depthKey             = 0.0f;
+    uint32_t         visibleInstanceIndex = INVALID_SCENE_ID;
+    uint32_t         renderableIndex      = INVALID_SCENE_ID;
+    uint32_t         meshInfoIndex        = INVALID_SCENE_ID;
+    uint32_t         materialIndex        = INVALID_SCENE_ID;
+    uint32_t         indexCount           = 0;
+    uint32_t         gpuInstanceIndex     = INVALID_SCENE_ID;
+    bool             depthPrepass         = false; // opaque materials, laid down by PreDepthPass and shaded with an equal depth test
+    ShaderVariantKey shaderVariant        = kGBufferDefaultShaderVariant;
 };
 
 struct GBufferGPUInstanceData
 {
     glm::mat4 objectToWorld      = glm::mat4(1.0f);
     glm::mat4 worldToObject      = glm::mat4(1.0f);
+    glm::mat4 prevObjectToWorld  = glm::mat4(1.0f);
     uint64_t  meshInfoAddress    = 0;
     uint64_t  materialAddress    = 0;
     uint64_t  textureInfoAddress = 0;
@@ -51,27 +63,70 @@ struct GBufferGPUInstanceData
 class GBufferPass : public BasePass
 {
 public:
+    static constexpr const char* PASS_NAME = "GBufferPass";
+
     GBufferPass() = default;
     GBufferPass(DeferRenderer* ownedRender) : _ownedRender(ownedRender) {}
     virtual ~GBufferPass() = default;
     virtual void init() override;
     virtual void build(RDG::RDGBuilder* rdgBuilder) override;
+    // builds the render list of the frame, the depth prepass draws from it too
+    virtual void update() override;
+
+    const std::vector<GBufferRenderItem>& getRenderItems() const
+    {
+        return _renderItems;
+    }
+
+    uint64_t getInstanceBufferAddress() const
+    {
+        return _gpuInstanceDataBuffer ? _gpuInstanceDataBuffer->address : 0;
+    }
+
+    // whether this frame's prepass drew the depth prepass items
+    void setDepthPrepassDrawn(bool drawn)
+    {
+        _depthPrepassDrawn = drawn;
+    }
 
     RTTR_ENABLE(BasePass)
 
 private:
+    // the two pipelines of a fragment shader variant, created on the first frame drawing a material that selects it
+    struct VariantPipelines
+    {
+        GraphicsPipelineStateInitializer pipeline;
+        GraphicsPipelineStateInitializer equalPipeline;
+    };
+
     void prepareRenderList();
-    void collectVisibleInstances(const CpuScene& scene, const GpuScene& gpuScene, const CameraData& cameraData);
+    // through the scene BVH when one is given, over every model component otherwise
+    void collectVisibleInstances(const CpuScene& scene, const GpuScene& gpuScene, const SceneBVH* sceneBVH, const CameraData& cameraData);
+    void addVisibleInstance(const CpuSceneNode* node, const CpuModelComponent* modelComponent, const std::vector<ModelAsset>& models,
+                            const CameraData& cameraData, bool testFrustum);
     void buildRenderList(const GpuScene& gpuScene);
     void sortRenderList();
     void uploadGPUInstanceData();
+    VariantPipelines& getVariantPipelines(ShaderVariantKey variant);
+    // of the scene drawn, null without one
+    TextureStreamer* getTextureStreamer() const;
 
     DeferRenderer*                   _ownedRender = nullptr;
     std::vector<GBufferVisibleInstance> _visibleInstances;
+    std::vector<uint32_t>               _frustumInstances; // scene BVH instances, reused every frame
     std::vector<GBufferRenderItem>      _renderItems;
     std::vector<GBufferGPUInstanceData> _gpuInstanceData;
     RefPtr<Buffer>                      _gpuInstanceDataBuffer = nullptr;
     GraphicsPipelineStateInitializer    _gbufferPipeline;
+    GraphicsPipelineStateInitializer    _gbufferEqualPipeline;
+    bool                                _depthPrepassDrawn = false;
+
+    std::unordered_map<ShaderVariantKey, VariantPipelines> _variantPipelines;
+    std::vector<ShaderVariantKey>                          _frameVariants; // selected by this frame's items, in first use order
+
+    // world transforms of the drawn scene nodes by node index, last frame's feed the velocity target
+    std::vector<std::optional<glm::mat4>> _prevNodeTransforms;
+    std::vector<std::optional<glm::mat4>> _currNodeTransforms;
 };
 } // namespace Play
 
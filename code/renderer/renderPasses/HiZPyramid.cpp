@@ -0,0 +1,92 @@
+#include "HiZPyramid.h"
+#include <algorithm>
+
+namespace Play
+{
+
+namespace
+{
+const glm::vec2 kEmptyDepthRange = glm::vec2(1.0f, 0.0f);
+
+uint32_t nextPowerOfTwo(uint32_t value)
+{
+    uint32_t power = 1;
+    while (power < value)
+    {
+        power <<= 1;
+    }
+    return power;
+}
+
+glm::vec2 reduceDepthRange(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c, const glm::vec2& d)
+{
+    return glm::vec2(std::min(std::min(a.x, b.x), std::min(c.x, d.x)), std::max(std::max(a.y, b.y), std::max(c.y, d.y)));
+}
+
+glm::vec2 loadDepthRange(const std::vector<glm::vec2>& texels, const glm::uvec2& size, const glm::uvec2& texel)
+{
+    return texel.x < size.x && texel.y < size.y ? texels[texel.y * size.x + texel.x] : kEmptyDepthRange;
+}
+} // namespace
+
+HiZPyramidLayout computeHiZPyramidLayout(const glm::uvec2& depthSize)
+{
+    HiZPyramidLayout layout;
+    layout.depthSize = depthSize;
+    if (depthSize.x == 0 || depthSize.y == 0)
+    {
+        return layout;
+    }
+
+    const glm::uvec2 halfSize = (depthSize + 1u) / 2u;
+    const glm::uvec2 baseSize = glm::uvec2(nextPowerOfTwo(halfSize.x), nextPowerOfTwo(halfSize.y));
+    uint32_t         mipCount = 1;
+    while ((std::max(baseSize.x, baseSize.y) >> (mipCount - 1)) > 1)
+    {
+        ++mipCount;
+    }
+    // mip 5 has to fit the 64x64 source of the last workgroup
+    if (mipCount > kHiZMaxMipCount)
+    {
+        return layout;
+    }
+
+    layout.baseSize   = baseSize;
+    layout.mipCount   = mipCount;
+    layout.groupCount = (baseSize + kHiZTileSize - 1u) / kHiZTileSize;
+    layout.uvScale    = glm::vec2(depthSize) / glm::vec2(baseSize * 2u);
+    return layout;
+}
+
+glm::uvec2 hiZMipSize(const HiZPyramidLayout& layout, uint32_t mip)
+{
+    return glm::max(layout.baseSize >> mip, glm::uvec2(1));
+}
+
+HiZPyramidLevels buildHiZPyramid(const std::vector<float>& depth, const HiZPyramidLayout& layout)
+{
+    std::vector<glm::vec2> depthTexels(depth.size());
+    std::transform(depth.begin(), depth.end(), depthTexels.begin(), [](float value) { return glm::vec2(value); });
+
+    HiZPyramidLevels levels(layout.mipCount);
+    for (uint32_t mip = 0; mip < layout.mipCount; ++mip)
+    {
+        const std::vector<glm::vec2>& source     = mip == 0 ? depthTexels : levels[mip - 1];
+        const glm::uvec2              sourceSize = mip == 0 ? layout.depthSize : hiZMipSize(layout, mip - 1);
+        const glm::uvec2              size       = hiZMipSize(layout, mip);
+        levels[mip].resize(size.x * size.y);
+        for (uint32_t y = 0; y < size.y; ++y)
+        {
+            for (uint32_t x = 0; x < size.x; ++x)
+            {
+                const glm::uvec2 origin     = glm::uvec2(x, y) * 2u;
+                levels[mip][y * size.x + x] = reduceDepthRange(
+                    loadDepthRange(source, sourceSize, origin), loadDepthRange(source, sourceSize, origin + glm::uvec2(1, 0)),
+                    loadDepthRange(source, sourceSize, origin + glm::uvec2(0, 1)), loadDepthRange(source, sourceSize, origin + glm::uvec2(1, 1)));
+            }
+        }
+    }
+    return levels;
+}
+
+} // namespace Play
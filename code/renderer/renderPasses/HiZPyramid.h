@@ -0,0 +1,41 @@
+#ifndef HIZ_PYRAMID_H
+#define HIZ_PYRAMID_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Play
+{
+
+// min and max depth pyramid over the scene depth. Mip 0 halves the depth buffer into a power of two sized grid, so every
+// texel covers exactly two by two texels of the mip below. Texels past the depth buffer hold min 1 and max 0 and drop out
+// of every reduction, consumers clamp their lookups to uvScale. preDepth/HiZPyramid.comp.slang builds the same pyramid
+
+// every workgroup reduces a 64x64 depth tile into the first six mips, the last group to finish reduces mip 5 into the rest
+constexpr uint32_t kHiZTileMipCount = 6;
+constexpr uint32_t kHiZMaxMipCount  = 2 * kHiZTileMipCount;
+constexpr uint32_t kHiZTileSize     = 32; // mip 0 texels per workgroup and axis
+
+struct HiZPyramidLayout
+{
+    glm::uvec2 depthSize  = glm::uvec2(0);
+    glm::uvec2 baseSize   = glm::uvec2(0); // mip 0
+    uint32_t   mipCount   = 0;             // zero when the depth buffer is too large for a single dispatch
+    glm::uvec2 groupCount = glm::uvec2(0);
+    glm::vec2  uvScale    = glm::vec2(0.0f); // the part of the pyramid the depth buffer covers
+};
+
+HiZPyramidLayout computeHiZPyramidLayout(const glm::uvec2& depthSize);
+
+glm::uvec2 hiZMipSize(const HiZPyramidLayout& layout, uint32_t mip);
+
+// row major min and max depth of every mip
+using HiZPyramidLevels = std::vector<std::vector<glm::vec2>>;
+
+// reference of the pyramid shader over a row major depth buffer of layout.depthSize
+HiZPyramidLevels buildHiZPyramid(const std::vector<float>& depth, const HiZPyramidLayout& layout);
+
+} // namespace Play
+
+#endif // HIZ_PYRAMID_H
@@ -0,0 +1,194 @@
+#include "LightClusterGrid.h"
+#include <algorithm>
+#include <cmath>
+#include <nvutils/parallel_work.hpp>
+
+namespace Play
+{
+
+namespace
+{
+// inclusive depth slice range a light can touch, found from its depth interval
+struct LightClusterRange
+{
+    uint32_t firstSlice = 0;
+    uint32_t lastSlice  = 0;
+    bool     visible    = false;
+};
+
+// unprojects an ndc position on the near plane and scales it to view depth 1, points at other depths are multiples of it
+glm::vec3 unprojectUnitDepth(const glm::mat4& invProj, const glm::vec2& ndc)
+{
+    const glm::vec4 view  = invProj * glm::vec4(ndc, 0.0f, 1.0f);
+    const glm::vec3 point = glm::vec3(view) / view.w;
+    return point / -point.z;
+}
+
+LightClusterRange computeLightClusterRange(const LightClusterGridDesc& desc, const LightClusterSphere& sphere)
+{
+    LightClusterRange range;
+    const float       depth = -sphere.center.z;
+    if (depth + sphere.radius < desc.nearDepth || depth - sphere.radius > desc.farDepth)
+    {
+        return range;
+    }
+    // the log of the slice lookup and the pow of the slice depths can round apart, the box test settles the border slices
+    range.firstSlice = lightClusterSlice(desc, depth - sphere.radius);
+    range.firstSlice = range.firstSlice > 0 ? range.firstSlice - 1 : 0;
+    range.lastSlice  = std::min(lightClusterSlice(desc, depth + sphere.radius) + 1, desc.clusterCount.z - 1);
+    range.visible    = true;
+    return range;
+}
+
+// half open range of the tiles in one row or column of a slice whose boxes reach [low, high] along axis. The box edges
+// move the same way with every tile, against the tile order under a y flipped projection, and without a skewed
+// projection every row of a slice has the same edges
+glm::uvec2 overlappingTiles(std::span<const LightClusterBounds> bounds, size_t start, size_t stride, uint32_t tileCount, int axis, float low,
+                            float high)
+{
+    const bool reversed = bounds[start].min[axis] > bounds[start + (tileCount - 1) * stride].min[axis];
+    auto       box      = [&](uint32_t step) -> const LightClusterBounds&
+    {
+        return bounds[start + (reversed ? tileCount - 1 - step : step) * stride];
+    };
+    auto firstStep = [&](auto&& reaches)
+    {
+        uint32_t first = 0;
+        uint32_t last  = tileCount;
+        while (first < last)
+        {
+            const uint32_t middle = (first + last) / 2;
+            if (reaches(box(middle)))
+            {
+                last = middle;
+            }
+            else
+            {
+                first = middle + 1;
+            }
+        }
+        return first;
+    };
+    // steps run along growing edges
+    const uint32_t first = firstStep([&](const LightClusterBounds& tile) { return tile.max[axis] >= low; });
+    const uint32_t end   = std::max(firstStep([&](const LightClusterBounds& tile) { return tile.min[axis] > high; }), first);
+    return reversed ? glm::uvec2(tileCount - end, tileCount - first) : glm::uvec2(first, end);
+}
+} // namespace
+
+float lightClusterSliceDepth(const LightClusterGridDesc& desc, uint32_t slice)
+{
+    return desc.nearDepth * std::pow(desc.farDepth / desc.nearDepth, float(slice) / float(desc.clusterCount.z));
+}
+
+uint32_t lightClusterSlice(const LightClusterGridDesc& desc, float viewDepth)
+{
+    if (viewDepth <= desc.nearDepth)
+    {
+        return 0;
+    }
+    const float slice = std::floor(std::log(viewDepth / desc.nearDepth) * float(desc.clusterCount.z) / std::log(desc.farDepth / desc.nearDepth));
+    return uint32_t(std::min(slice, float(desc.clusterCount.z - 1)));
+}
+
+LightClusterBounds computeLightClusterBounds(const LightClusterGridDesc& desc, const glm::mat4& invProj, const glm::uvec3& cluster)
+{
+    const glm::vec2 tileSize = 2.0f / glm::vec2(desc.clusterCount.x, desc.clusterCount.y);
+    const glm::vec2 ndcMin   = glm::vec2(-1.0f) + glm::vec2(cluster.x, cluster.y) * tileSize;
+    const glm::vec3 minRay   = unprojectUnitDepth(invProj, ndcMin);
+    const glm::vec3 maxRay   = unprojectUnitDepth(invProj, ndcMin + tileSize);
+    const float     nearZ    = lightClusterSliceDepth(desc, cluster.z);
+    const float     farZ     = lightClusterSliceDepth(desc, cluster.z + 1);
+
+    // view space x and y scale linearly with depth, so the four corner rays at both slice depths span the box
+    LightClusterBounds bounds;
+    bounds.min = glm::min(glm::min(minRay * nearZ, minRay * farZ), glm::min(maxRay * nearZ, maxRay * farZ));
+    bounds.max = glm::max(glm::max(minRay * nearZ, minRay * farZ), glm::max(maxRay * nearZ, maxRay * farZ));
+    return bounds;
+}
+
+std::vector<LightClusterBounds> computeLightClusterBoundsGrid(const LightClusterGridDesc& desc, const glm::mat4& invProj)
+{
+    std::vector<LightClusterBounds> grid(desc.clusterTotal());
+    for (uint32_t z = 0; z < desc.clusterCount.z; ++z)
+    {
+        for (uint32_t y = 0; y < desc.clusterCount.y; ++y)
+        {
+            for (uint32_t x = 0; x < desc.clusterCount.x; ++x)
+            {
+                grid[desc.clusterIndex(x, y, z)] = computeLightClusterBounds(desc, invProj, glm::uvec3(x, y, z));
+            }
+        }
+    }
+    return grid;
+}
+
+bool sphereIntersectsClusterBounds(const LightClusterSphere& sphere, const LightClusterBounds& bounds)
+{
+    const glm::vec3 closest = glm::clamp(sphere.center, bounds.min, bounds.max);
+    const glm::vec3 delta   = closest - sphere.center;
+    return glm::dot(delta, delta) <= sphere.radius * sphere.radius;
+}
+
+void assignLightsToClusters(const LightClusterGridDesc& desc, std::span<const LightClusterBounds> clusterBounds,
+                            std::span<const LightClusterSphere> lights, LightClusterAssignment& assignment)
+{
+    const uint32_t clusterTotal = desc.clusterTotal();
+    assignment.counts.assign(clusterTotal, 0);
+    assignment.lightIndices.resize(size_t(clusterTotal) * desc.maxLightsPerCluster);
+    assignment.overflowClusters = 0;
+    assignment.maxClusterLights = 0;
+    assignment.totalEntries     = 0;
+    if (clusterBounds.size() < clusterTotal)
+    {
+        return;
+    }
+
+    std::vector<LightClusterRange> ranges(lights.size());
+    nvutils::parallel_batches<256>(lights.size(), [&](uint64_t light) { ranges[light] = computeLightClusterRange(desc, lights[light]); });
+
+    // one work item per depth slice keeps the writes disjoint and the light order stable
+    const glm::uvec3 count = desc.clusterCount;
+    nvutils::parallel_batches<1>(count.z,
+                                 [&](uint64_t slice)
+                                 {
+                                     const size_t sliceStart = desc.clusterIndex(0, 0, uint32_t(slice));
+                                     for (uint32_t light = 0; light < lights.size(); ++light)
+                                     {
+                                         const LightClusterRange& range = ranges[light];
+                                         if (!range.visible || slice < range.firstSlice || slice > range.lastSlice)
+                                         {
+                                             continue;
+                                         }
+                                         const glm::vec3  low     = lights[light].center - lights[light].radius;
+                                         const glm::vec3  high    = lights[light].center + lights[light].radius;
+                                         const glm::uvec2 columns = overlappingTiles(clusterBounds, sliceStart, 1, count.x, 0, low.x, high.x);
+                                         const glm::uvec2 rows    = overlappingTiles(clusterBounds, sliceStart, count.x, count.y, 1, low.y, high.y);
+                                         for (uint32_t y = rows.x; y < rows.y; ++y)
+                                         {
+                                             for (uint32_t x = columns.x; x < columns.y; ++x)
+                                             {
+                                                 const uint32_t cluster = desc.clusterIndex(x, y, uint32_t(slice));
+                                                 if (!sphereIntersectsClusterBounds(lights[light], clusterBounds[cluster]))
+                                                 {
+                                                     continue;
+                                                 }
+                                                 const uint32_t slot = assignment.counts[cluster]++;
+                                                 if (slot < desc.maxLightsPerCluster)
+                                                 {
+                                                     assignment.lightIndices[size_t(cluster) * desc.maxLightsPerCluster + slot] = light;
+                                                 }
+                                             }
+                                         }
+                                     }
+                                 });
+
+    for (uint32_t count : assignment.counts)
+    {
+        assignment.overflowClusters += count > desc.maxLightsPerCluster ? 1 : 0;
+        assignment.maxClusterLights = std::max(assignment.maxClusterLights, count);
+        assignment.totalEntries += std::min(count, desc.maxLightsPerCluster);
+    }
+}
+
+} // namespace Play
@@ -0,0 +1,73 @@
+#ifndef LIGHT_CLUSTER_GRID_H
+#define LIGHT_CLUSTER_GRID_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Play
+{
+
+// froxel grid over the view frustum: clusterCount.x * clusterCount.y screen tiles split into clusterCount.z depth
+// slices spaced exponentially between nearDepth and farDepth (positive view space distances). The light cluster
+// compute shader mirrors this math in lighting/LightClusterLib.h.slang
+struct LightClusterGridDesc
+{
+    glm::uvec3 clusterCount        = {16, 9, 24};
+    float      nearDepth           = 0.1f;
+    float      farDepth            = 1000.0f;
+    uint32_t   maxLightsPerCluster = 128;
+
+    uint32_t clusterTotal() const
+    {
+        return clusterCount.x * clusterCount.y * clusterCount.z;
+    }
+    uint32_t clusterIndex(uint32_t x, uint32_t y, uint32_t z) const
+    {
+        return (z * clusterCount.y + y) * clusterCount.x + x;
+    }
+};
+
+// view space bounding box of one cluster
+struct LightClusterBounds
+{
+    glm::vec3 min{0.0f};
+    glm::vec3 max{0.0f};
+};
+
+// local light as seen by the binning, a view space sphere around its position with the light range as radius
+struct LightClusterSphere
+{
+    glm::vec3 center{0.0f};
+    float     radius = 0.0f;
+};
+
+// fixed capacity light list per cluster with the same layout as the gpu buffers, counts keep the number of overlapping
+// lights before clamping so overflow stays visible
+struct LightClusterAssignment
+{
+    std::vector<uint32_t> counts;
+    std::vector<uint32_t> lightIndices; // clusterTotal * maxLightsPerCluster
+    uint32_t              overflowClusters = 0;
+    uint32_t              maxClusterLights = 0;
+    uint64_t              totalEntries     = 0;
+};
+
+// view depth where slice starts, slice == clusterCount.z gives the far depth
+float    lightClusterSliceDepth(const LightClusterGridDesc& desc, uint32_t slice);
+uint32_t lightClusterSlice(const LightClusterGridDesc& desc, float viewDepth);
+
+LightClusterBounds              computeLightClusterBounds(const LightClusterGridDesc& desc, const glm::mat4& invProj, const glm::uvec3& cluster);
+std::vector<LightClusterBounds> computeLightClusterBoundsGrid(const LightClusterGridDesc& desc, const glm::mat4& invProj);
+bool                            sphereIntersectsClusterBounds(const LightClusterSphere& sphere, const LightClusterBounds& bounds);
+
+// bins the lights into the clusters whose box they overlap, the lists the gpu builds by testing every light against every
+// box. A light is only tested against the boxes in the rows, columns and depth slices it reaches. Lights keep their
+// index order inside a cluster like on the gpu
+void assignLightsToClusters(const LightClusterGridDesc& desc, std::span<const LightClusterBounds> clusterBounds,
+                            std::span<const LightClusterSphere> lights, LightClusterAssignment& assignment);
+
+} // namespace Play
+
+#endif // LIGHT_CLUSTER_GRID_H
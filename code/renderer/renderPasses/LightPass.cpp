@@ -2,11 +2,39 @@
 #include "ShaderManager.hpp"
 #include "PConstantType.h.slang"
 #include "GBufferConfig.h"
+#include "PlayAllocator.h"
+#include "SceneManager.h"
 #include "core/runtime/VulkanRuntime.h"
+#include "editor/EditorRegistry.h"
 #include "DeferRendering.h"
+#include <algorithm>
+#include <bit>
 namespace Play
 {
 
+namespace
+{
+constexpr VkBufferUsageFlags2 kSceneLightBufferUsage         = VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_SHADER_DEVICE_ADDRESS_BIT;
+constexpr uint32_t            kLightClusterThreadCount       = 64;
+constexpr uint32_t            kLightClusterShadingClustered  = 1 << 0; // mirrors kLightShadingClustered in LightClusterLib.h.slang
+constexpr uint32_t            kLightClusterShadingHeatmap    = 1 << 1;
+constexpr uint32_t            kLightPassColorAttachmentCount = 2;
+
+LightInfo transformLight(const LightInfo& light, const glm::mat4& modelToWorld)
+{
+    const glm::mat3 basis = glm::mat3(modelToWorld);
+    const float     scale = std::max(glm::length(basis[0]), std::max(glm::length(basis[1]), glm::length(basis[2])));
+
+    LightInfo worldLight = light;
+    worldLight.position  = glm::vec3(modelToWorld * glm::vec4(light.position, 1.0f));
+    worldLight.direction = glm::normalize(basis * light.direction);
+    worldLight.tangent   = glm::normalize(basis * light.tangent);
+    worldLight.range     = light.range * scale;
+    worldLight.areaSize  = light.areaSize * scale;
+    return worldLight;
+}
+} // namespace
+
 LightPass::~LightPass() = default;
 
 void LightPass::init()
@@ -16,13 +44,140 @@ void LightPass::init()
                                                      ShaderStage::eFragment);
     auto fullScreenVertID = ShaderManager::Instance().getShaderIdByName(BuiltinShaders::BUILTIN_FULL_SCREEN_QUAD_VERT_SHADER_NAME);
     _lightPassPipeline.setShader(fullScreenVertID, lightPassFragID);
-    _lightPassPipeline.setPushConstant<PerFrameConstant>();
+    _lightPassPipeline.setPushConstant<LightClusterConstant>();
     _lightPassPipeline.psoState.rasterizationState.frontFace = VK_FRONT_FACE_CLOCKWISE;
     _lightPassPipeline.psoState.rasterizationState.cullMode  = VK_CULL_MODE_NONE;
+    // lighting and the shading rate source of the next frame
+    _lightPassPipeline.psoState.colorBlendEnables.resize(kLightPassColorAttachmentCount, VK_FALSE);
+    _lightPassPipeline.psoState.colorWriteMasks.resize(kLightPassColorAttachmentCount,
+                                                       VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
+                                                           VK_COLOR_COMPONENT_A_BIT);
+    const VkColorBlendEquationEXT defaultBlendEquation = _lightPassPipeline.psoState.colorBlendEquations.front();
+    _lightPassPipeline.psoState.colorBlendEquations.resize(kLightPassColorAttachmentCount, defaultBlendEquation);
+
+    auto lightClusterCompID = ShaderManager::Instance().loadShaderFromFile(
+        "lightClusterComp", "newShaders/deferRenderer/lighting/LightCluster.comp.slang", ShaderStage::eCompute);
+    _lightClusterPipeline.setShader(lightClusterCompID);
+    _lightClusterPipeline.setPushConstant<LightClusterConstant>();
+
+    _lightBuffers.resize(vkDriver->getFrameCycleSize());
+
+    vkDriver->getEditorRegistry().registerWritable<LightClusterSettings>("Clustered Lighting", _settings, editor::EditorRenderMode::Defer);
+    vkDriver->getEditorRegistry().registerReadOnly<LightClusterStats>("Clustered Lighting Stats", _stats, editor::EditorRenderMode::Defer);
+}
+
+void LightPass::update()
+{
+    gatherSceneLights();
+}
+
+void LightPass::gatherSceneLights()
+{
+    _directionalLights.clear();
+    _localLights.clear();
+
+    SceneManager* sceneManager = _ownedRender ? _ownedRender->getSceneManager() : nullptr;
+    if (sceneManager && sceneManager->getGpuScene())
+    {
+        const GpuScene* gpuScene = sceneManager->getGpuScene();
+        sceneManager->readSceneGraph([&](const CpuScene& scene) { collectSceneLights(scene, *gpuScene); });
+    }
+    uploadSceneLights();
+
+    _stats.DirectionalLights = static_cast<uint32_t>(_directionalLights.size());
+    _stats.LocalLights       = static_cast<uint32_t>(_localLights.size());
+}
+
+void LightPass::collectSceneLights(const CpuScene& scene, const GpuScene& gpuScene)
+{
+    const std::vector<ModelAsset>& models = gpuScene.getModels();
+    for (const CpuModelComponent& modelComponent : scene.view<CpuModelComponent>())
+    {
+        const CpuSceneNode* node = scene.getNode(modelComponent.ownerNode);
+        if (!node || !node->worldVisible || !modelComponent.visible || !modelComponent.hasModel() || modelComponent.model.index >= models.size())
+        {
+            continue;
+        }
+
+        const ModelAsset& model = models[modelComponent.model.index];
+        if (model.generation != modelComponent.model.generation)
+        {
+            continue;
+        }
+
+        for (const LightInfo& light : model.lights)
+        {
+            const LightInfo worldLight = transformLight(light, node->worldTransform);
+            if (worldLight.type == static_cast<uint32_t>(LightType::eDirectional))
+            {
+                _directionalLights.push_back(worldLight);
+            }
+            else
+            {
+                _localLights.push_back(worldLight);
+            }
+        }
+    }
+}
+
+void LightPass::uploadSceneLights()
+{
+    const size_t lightCount = _directionalLights.size() + _localLights.size();
+    if (lightCount == 0)
+    {
+        return;
+    }
+
+    // the slot was fenced before this frame started recording, so its buffer can be rewritten or replaced
+    RefPtr<Buffer>&    lightBuffer = _lightBuffers[vkDriver->getFrameCycleIndex()];
+    const VkDeviceSize dataSize    = static_cast<VkDeviceSize>(lightCount * sizeof(LightInfo));
+    if (!lightBuffer || lightBuffer->BufferSize() < dataSize)
+    {
+        lightBuffer = RefPtr<Buffer>(new Buffer("SceneLightBuffer", kSceneLightBufferUsage, std::bit_ceil(lightCount) * sizeof(LightInfo),
+                                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+    }
+
+    if (lightBuffer && lightBuffer->mapping)
+    {
+        LightInfo* mappedLights = static_cast<LightInfo*>(lightBuffer->mapping);
+        std::copy(_directionalLights.begin(), _directionalLights.end(), mappedLights);
+        std::copy(_localLights.begin(), _localLights.end(), mappedLights + _directionalLights.size());
+        PlayResourceManager::Instance().flushBuffer(*lightBuffer, 0, dataSize);
+    }
+}
+
+LightClusterConstant LightPass::makeLightClusterConstant() const
+{
+    const RefPtr<Buffer>& lightBuffer = _lightBuffers[vkDriver->getFrameCycleIndex()];
+    const bool            clustered   = _settings.ClusteredShading && !_localLights.empty();
+
+    LightClusterConstant constant{};
+    constant.cameraBufferDeviceAddress = _ownedRender->getCurrentCameraBuffer()->address;
+    constant.lightBufferAddress        = lightBuffer ? lightBuffer->address : 0;
+    constant.clusterCountX             = _clusterCount.x;
+    constant.clusterCountY             = _clusterCount.y;
+    constant.clusterCountZ             = _clusterCount.z;
+    constant.maxLightsPerCluster       = _maxLightsPerCluster;
+    constant.directionalLightCount     = static_cast<uint32_t>(_directionalLights.size());
+    constant.localLightCount           = static_cast<uint32_t>(_localLights.size());
+    constant.clusterNearDepth          = _settings.ClusterNearDepth;
+    constant.clusterFarDepth           = std::max(_settings.ClusterFarDepth, _settings.ClusterNearDepth * 2.0f);
+    constant.shadingFlags              = clustered ? kLightClusterShadingClustered : 0;
+    if (clustered && _settings.ShowClusterHeatmap)
+    {
+        constant.shadingFlags |= kLightClusterShadingHeatmap;
+    }
+    return constant;
 }
 
 void LightPass::build(RDG::RDGBuilder* rdgBuilder)
 {
+    _clusterCount               = glm::max(glm::uvec3(_settings.ClusterCountX, _settings.ClusterCountY, _settings.ClusterCountZ), glm::uvec3(1));
+    _maxLightsPerCluster        = std::max(_settings.MaxLightsPerCluster, 1u);
+    const uint32_t clusterTotal = _clusterCount.x * _clusterCount.y * _clusterCount.z;
+    _stats.Clusters             = clusterTotal;
+
+    const VkExtent2D   renderExtent  = _ownedRender->getRenderExtent();
     RDG::RDGTextureRef inputAlbedo   = rdgBuilder->getTexture("SkyBoxRT");
     RDG::RDGTextureRef inputNormal   = rdgBuilder->getTexture(GBufferConfig::Get(GBufferType::GNormal).debugName);
     RDG::RDGTextureRef inputPBR      = rdgBuilder->getTexture(GBufferConfig::Get(GBufferType::GPBR).debugName);
@@ -30,14 +185,43 @@ void LightPass::build(RDG::RDGBuilder* rdgBuilder)
     RDG::RDGTextureRef inputCustom1  = rdgBuilder->getTexture(GBufferConfig::Get(GBufferType::GCustomData).debugName);
     RDG::RDGTextureRef velocityRT    = rdgBuilder->getTexture(GBufferConfig::Get(GBufferType::GVelocity).debugName);
     RDG::RDGTextureRef depthRT       = rdgBuilder->getTexture(GBufferConfig::Get(GBufferType::GSceneDepth).debugName);
+    RDG::RDGTextureRef rateSource    = rdgBuilder->getTexture("ShadingRateSource");
     RDG::RDGTextureRef outputLight   = rdgBuilder->createTexture("LightPassOutput")
-                                         .Extent({vkDriver->getViewportSize().width, vkDriver->getViewportSize().height, 1})
+                                         .Extent({renderExtent.width, renderExtent.height, 1})
                                          .AspectFlags(VK_IMAGE_ASPECT_COLOR_BIT)
                                          .Format(VK_FORMAT_R16G16B16A16_SFLOAT)
                                          .UsageFlags(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)
                                          .MipmapLevel(1)
                                          .finish();
 
+    RDG::RDGBufferRef clusterLightCounts  = rdgBuilder->createBuffer("LightClusterCounts")
+                                                .Location(true)
+                                                .Range(VK_WHOLE_SIZE)
+                                                .Size(sizeof(uint32_t) * clusterTotal)
+                                                .UsageFlags(VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT)
+                                                .finish();
+    RDG::RDGBufferRef clusterLightIndices = rdgBuilder->createBuffer("LightClusterIndices")
+                                                .Location(true)
+                                                .Range(VK_WHOLE_SIZE)
+                                                .Size(sizeof(uint32_t) * clusterTotal * _maxLightsPerCluster)
+                                                .UsageFlags(VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT)
+                                                .finish();
+
+    // the lights of the frame were gathered in update, before either pass records
+    [[maybe_unused]] RDG::ComputePassNodeRef clusterPass =
+        rdgBuilder->createComputePass("Light Cluster Pass")
+            .storageWrite(0, clusterLightCounts, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .storageWrite(1, clusterLightIndices, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .skipIf([this]() { return !_settings.ClusteredShading || _localLights.empty(); })
+            .execute(
+                [this, clusterTotal](RDG::PassNode* node, RDG::RenderContext& context)
+                {
+                    context.bindPipeline(_lightClusterPipeline);
+                    context.bindPushConstant(makeLightClusterConstant());
+                    vkCmdDispatch(context._currCmdBuffer, nvvk::getGroupCounts(clusterTotal, kLightClusterThreadCount), 1, 1);
+                })
+            .finish();
+
     RDG::RenderPassNodeRef lightPass =
         rdgBuilder->createRenderPass("Lighting Pass")
             .read(0, inputAlbedo, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT)
@@ -47,18 +231,21 @@ void LightPass::build(RDG::RDGBuilder* rdgBuilder)
             .read(4, inputCustom1, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT)
             .read(5, velocityRT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT)
             .read(6, depthRT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT)
+            .storageRead(7, clusterLightCounts, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT)
+            .storageRead(8, clusterLightIndices, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT)
             .color(0, outputLight, VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+            .color(1, rateSource, VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+            .shadingRate(rdgBuilder->getTexture("ShadingRateImage"), _ownedRender->getShadingRateTexelSize())
             .execute(
-                [this](RDG::PassNode* node, RDG::RenderContext& context)
+                [this, renderExtent](RDG::PassNode* node, RDG::RenderContext& context)
                 {
-                    VkCommandBuffer  cmd = context._currCmdBuffer;
-                    PerFrameConstant perFrameConstant{};
-                    perFrameConstant.cameraBufferDeviceAddress = _ownedRender->getCurrentCameraBuffer()->address;
+                    VkCommandBuffer cmd = context._currCmdBuffer;
                     context.bindPipeline(this->_lightPassPipeline);
-                    context.bindPushConstant(perFrameConstant);
-                    VkViewport viewport = {0, 0, (float) vkDriver->getViewportSize().width, (float) vkDriver->getViewportSize().height, 0.0f, 1.0f};
-                    VkRect2D   scissor  = {{0, 0}, {vkDriver->getViewportSize().width, vkDriver->getViewportSize().height}};
+                    context.bindPushConstant(makeLightClusterConstant());
+                    VkViewport viewport = {0, 0, (float) renderExtent.width, (float) renderExtent.height, 0.0f, 1.0f};
+                    VkRect2D   scissor  = {{0, 0}, renderExtent};
                     vkCmdSetViewportWithCount(cmd, 1, &viewport);
                     vkCmdSetScissorWithCount(cmd, 1, &scissor);
                     vkCmdDraw(cmd, 3, 1, 0, 0);
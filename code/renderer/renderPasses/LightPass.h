@@ -2,12 +2,37 @@
 #define LIGHTPASS_H
 #include "RDG/RDG.h"
 #include "RenderPass.h"
+#include "SceneAssets.h"
+#include "Hdevice.h"
 #include "core/RefCounted.h"
 #include <rttr/rttr_enable.h>
 namespace Play
 {
 class DeferRenderer;
+class CpuScene;
+class GpuScene;
 
+struct LightClusterSettings
+{
+    bool     ClusteredShading    = true; // off shades every pixel against all lights, the reference path
+    bool     ShowClusterHeatmap  = false;
+    uint32_t ClusterCountX       = 16; // grid size and list capacity apply on the next resize
+    uint32_t ClusterCountY       = 9;
+    uint32_t ClusterCountZ       = 24;
+    uint32_t MaxLightsPerCluster = 128;
+    float    ClusterNearDepth    = 0.1f;
+    float    ClusterFarDepth     = 1000.0f;
+};
+
+struct LightClusterStats
+{
+    uint32_t DirectionalLights = 0;
+    uint32_t LocalLights       = 0;
+    uint32_t Clusters          = 0;
+};
+
+// clustered deferred lighting: scene lights are gathered into a per frame buffer, a compute pass bins the local
+// lights into a froxel grid and the full screen pass shades every pixel against its cluster's light list
 class LightPass : public BasePass
 {
 public:
@@ -16,12 +41,29 @@ public:
     virtual ~LightPass() override;
     virtual void init() override;
     virtual void build(RDG::RDGBuilder* rdgBuilder) override;
+    virtual void update() override;
 
     RTTR_ENABLE(BasePass)
 
 private:
-    DeferRenderer*                  _ownedRender = nullptr;
+    void                 gatherSceneLights();
+    void                 collectSceneLights(const CpuScene& scene, const GpuScene& gpuScene);
+    void                 uploadSceneLights();
+    LightClusterConstant makeLightClusterConstant() const;
+
+    DeferRenderer*                   _ownedRender = nullptr;
     GraphicsPipelineStateInitializer _lightPassPipeline;
+    ComputePipelineStateInitializer  _lightClusterPipeline;
+
+    LightClusterSettings _settings;
+    LightClusterStats    _stats;
+    glm::uvec3           _clusterCount{0};
+    uint32_t             _maxLightsPerCluster = 0;
+
+    // world space lights of the current frame, directional lights first. One host visible buffer per frame slot
+    std::vector<LightInfo>      _directionalLights;
+    std::vector<LightInfo>      _localLights;
+    std::vector<RefPtr<Buffer>> _lightBuffers;
 };
 
 } // namespace Play
@@ -23,7 +23,8 @@ void PostProcessPass::init()
 
 void PostProcessPass::build(RDG::RDGBuilder* rdgBuilder)
 {
-    auto inputTextureRef = rdgBuilder->getTexture("LightPassOutput");
+    // the temporal upscaler already brought the lighting back to the viewport resolution
+    auto inputTextureRef = rdgBuilder->getTexture("TemporalUpscaleOutput");
     auto outputTexRef    = rdgBuilder->createTexture("outputTexture")
                             .Extent({vkDriver->getViewportSize().width, vkDriver->getViewportSize().height, 1})
                             .AspectFlags(VK_IMAGE_ASPECT_COLOR_BIT)
@@ -33,7 +34,7 @@ void PostProcessPass::build(RDG::RDGBuilder* rdgBuilder)
                             .finish();
 
     auto pass = rdgBuilder->createComputePass("postProcessPass")
-                    .read(0, inputTextureRef, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT)
+                    .read(0, inputTextureRef, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
                     .storageWrite(1, outputTexRef, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
                     .execute(
                         [inputTextureRef, outputTexRef, this](RDG::PassNode* passNode, RDG::RenderContext& context)
@@ -1,6 +1,182 @@
 #include "PreDepthPass.h"
-
+#include "GBufferPass.h"
+#include "ShaderManager.hpp"
+#include "core/runtime/VulkanRuntime.h"
+#include "editor/EditorRegistry.h"
+#include "DeferRendering.h"
+#include "utils.hpp"
+#include <algorithm>
 namespace Play
 {
 
-} // namespace Play
\ No newline at end of file
+void PreDepthPass::init()
+{
+    // the gbuffer vertex shader without a fragment stage, the equal test in the gbuffer needs bit identical positions
+    const uint32_t vertexShaderID = ShaderManager::Instance().getShaderIdByName(BuiltinShaders::BUILTIN_DEFAULT_GBUFFER_VERT_SHADER_NAME);
+    _depthPipeline.setShader(vertexShaderID, ~0U);
+    _depthPipeline.setPushConstant<GBufferPushConstant>();
+    _depthPipeline.psoState.colorBlendEnables.clear();
+    _depthPipeline.psoState.colorWriteMasks.clear();
+    _depthPipeline.psoState.colorBlendEquations.clear();
+
+    auto hiZCompID = ShaderManager::Instance().loadShaderFromFile("hiZPyramidComp", "newShaders/deferRenderer/preDepth/HiZPyramid.comp.slang",
+                                                                  ShaderStage::eCompute);
+    _hiZPipeline.setShader(hiZCompID);
+    _hiZPipeline.setPushConstant<HiZConstant>();
+
+    _slotUsedPrepass.assign(vkDriver->getFrameCycleSize(), false);
+
+    vkDriver->getEditorRegistry().registerWritable<PreDepthSettings>("Depth Prepass", _settings, editor::EditorRenderMode::Defer);
+    vkDriver->getEditorRegistry().registerReadOnly<PreDepthStats>("Depth Prepass Stats", _stats, editor::EditorRenderMode::Defer);
+}
+
+void PreDepthPass::updateInvocationStats(RDG::RDGBuilder* rdgBuilder)
+{
+    const std::optional<uint64_t> invocations = rdgBuilder->getFragmentInvocations(GBufferPass::PASS_NAME);
+    _stats.StatisticsSupported                = _stats.StatisticsSupported || invocations.has_value();
+    if (!invocations)
+    {
+        return;
+    }
+
+    const VkExtent2D renderExtent     = _ownedRender->getRenderExtent();
+    const uint32_t   pixelCount       = std::max(renderExtent.width * renderExtent.height, 1u);
+    _stats.GBufferFragmentInvocations = static_cast<uint32_t>(std::min<uint64_t>(*invocations, UINT32_MAX));
+    _stats.GBufferOverdraw            = static_cast<float>(*invocations) / static_cast<float>(pixelCount);
+    if (_slotUsedPrepass[vkDriver->getFrameCycleIndex()])
+    {
+        _stats.InvocationsWithPrepass = _stats.GBufferFragmentInvocations;
+    }
+    else
+    {
+        _stats.InvocationsWithoutPrepass = _stats.GBufferFragmentInvocations;
+    }
+    const bool measuredBoth = _stats.InvocationsWithPrepass != 0 && _stats.InvocationsWithoutPrepass != 0;
+    _stats.InvocationSaving = measuredBoth && _stats.InvocationsWithoutPrepass > _stats.InvocationsWithPrepass
+                                  ? _stats.InvocationsWithoutPrepass - _stats.InvocationsWithPrepass
+                                  : 0;
+}
+
+HiZConstant PreDepthPass::makeHiZConstant() const
+{
+    HiZConstant constant{};
+    constant.depthWidth  = _hiZLayout.depthSize.x;
+    constant.depthHeight = _hiZLayout.depthSize.y;
+    constant.baseWidth   = _hiZLayout.baseSize.x;
+    constant.baseHeight  = _hiZLayout.baseSize.y;
+    constant.mipCount    = _hiZLayout.mipCount;
+    constant.groupCount  = _hiZLayout.groupCount.x * _hiZLayout.groupCount.y;
+    return constant;
+}
+
+void PreDepthPass::build(RDG::RDGBuilder* rdgBuilder)
+{
+    const VkExtent2D   renderExtent = _ownedRender->getRenderExtent();
+    const auto         depthFormat  = GBufferConfig::Get(GBufferType::GSceneDepth).format;
+    RDG::RDGTextureRef DepthRT      = rdgBuilder->createTexture(GBufferConfig::Get(GBufferType::GSceneDepth).debugName)
+                                     .Extent({renderExtent.width, renderExtent.height, 1})
+                                     .AspectFlags(inferImageAspectFlags(depthFormat, false))
+                                     .Format(depthFormat)
+                                     .UsageFlags(VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)
+                                     .MipmapLevel(1)
+                                     .finish();
+
+    [[maybe_unused]] RDG::RenderPassNodeRef depthPass =
+        rdgBuilder->createRenderPass("PreDepthPass")
+            .depth(DepthRT, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                   VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
+            .execute(
+                [this, rdgBuilder, renderExtent](RDG::PassNode* node, RDG::RenderContext& context)
+                {
+                    updateInvocationStats(rdgBuilder);
+
+                    // the gbuffer pass built the list in its update, it draws from it after this pass
+                    _gbufferPass->setDepthPrepassDrawn(_settings.DepthPrepass);
+                    _slotUsedPrepass[vkDriver->getFrameCycleIndex()] = _settings.DepthPrepass;
+
+                    const std::vector<GBufferRenderItem>& renderItems = _gbufferPass->getRenderItems();
+                    _stats.PrepassDraws                               = 0;
+                    for (const GBufferRenderItem& item : renderItems)
+                    {
+                        _stats.PrepassDraws += item.depthPrepass && item.indexCount != 0 ? 1 : 0;
+                    }
+                    _stats.GBufferOnlyDraws = static_cast<uint32_t>(renderItems.size()) - _stats.PrepassDraws;
+                    if (!_settings.DepthPrepass || _stats.PrepassDraws == 0)
+                    {
+                        return;
+                    }
+                    VkCommandBuffer cmd = context._currCmdBuffer;
+
+                    GBufferPushConstant pushConstant{};
+                    pushConstant.perFrameConstant.cameraBufferDeviceAddress = _ownedRender->getCurrentCameraBuffer()->address;
+                    pushConstant.sceneConstant.instanceBufferAddress        = _gbufferPass->getInstanceBufferAddress();
+
+                    VkViewport viewport = {0, 0, static_cast<float>(renderExtent.width), static_cast<float>(renderExtent.height), 0.0f, 1.0f};
+                    VkRect2D   scissor  = {{0, 0}, renderExtent};
+                    vkCmdSetViewportWithCount(cmd, 1, &viewport);
+                    vkCmdSetScissorWithCount(cmd, 1, &scissor);
+
+                    context.bindPipeline(_depthPipeline);
+                    for (const GBufferRenderItem& item : renderItems)
+                    {
+                        if (!item.depthPrepass || item.indexCount == 0)
+                        {
+                            continue;
+                        }
+                        pushConstant.sceneConstant.instanceIndex = item.gpuInstanceIndex;
+                        context.bindPushConstant(pushConstant);
+                        vkCmdDraw(cmd, item.indexCount, 1, 0, 0);
+                    }
+                })
+            .finish();
+
+    _hiZLayout         = computeHiZPyramidLayout({renderExtent.width, renderExtent.height});
+    _stats.HiZWidth    = _hiZLayout.baseSize.x;
+    _stats.HiZHeight   = _hiZLayout.baseSize.y;
+    _stats.HiZMipCount = _hiZLayout.mipCount;
+    if (_hiZLayout.mipCount == 0)
+    {
+        LOGW("Render extent %ux%u is too large for a single dispatch depth pyramid, HiZPyramid is not built\n", renderExtent.width,
+             renderExtent.height);
+        return;
+    }
+
+    RDG::RDGTextureRef hiZPyramid = rdgBuilder->createTexture("HiZPyramid")
+                                        .Extent({_hiZLayout.baseSize.x, _hiZLayout.baseSize.y, 1})
+                                        .AspectFlags(VK_IMAGE_ASPECT_COLOR_BIT)
+                                        .Format(VK_FORMAT_R32G32_SFLOAT)
+                                        .UsageFlags(VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)
+                                        .MipmapLevel(_hiZLayout.mipCount)
+                                        .finish();
+    // counts finished workgroups so the last one knows it can reduce the remaining mips
+    RDG::RDGBufferRef finishedGroups = rdgBuilder->createBuffer("HiZFinishedGroups")
+                                           .Location(true)
+                                           .Range(VK_WHOLE_SIZE)
+                                           .Size(sizeof(uint32_t))
+                                           .UsageFlags(VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT)
+                                           .finish();
+
+    [[maybe_unused]] RDG::ComputePassNodeRef hiZPass =
+        rdgBuilder->createComputePass("HiZ Pass")
+            .read(0, DepthRT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .storageReadWriteMips(1, hiZPyramid, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .storageWrite(2, finishedGroups, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .execute(
+                [this, finishedGroups](RDG::PassNode* node, RDG::RenderContext& context)
+                {
+                    VkCommandBuffer cmd = context._currCmdBuffer;
+                    vkCmdFillBuffer(cmd, finishedGroups->getRHI()->buffer, 0, sizeof(uint32_t), 0);
+                    VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+                    barrier.srcAccessMask   = VK_ACCESS_TRANSFER_WRITE_BIT;
+                    barrier.dstAccessMask   = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+                    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0,
+                                         nullptr);
+
+                    context.bindPipeline(_hiZPipeline);
+                    context.bindPushConstant(makeHiZConstant());
+                    vkCmdDispatch(cmd, _hiZLayout.groupCount.x, _hiZLayout.groupCount.y, 1);
+                })
+            .finish();
+}
+
+} // namespace Play
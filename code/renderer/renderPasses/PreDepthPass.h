@@ -1,9 +1,72 @@
 #ifndef PREDEPTHPASS_H
 #define PREDEPTHPASS_H
-
+#include "RDG/RDG.h"
+#include "RenderPass.h"
+#include "PipelineCacheManager.h"
+#include "PConstantType.h.slang"
+#include "HiZPyramid.h"
+#include <rttr/rttr_enable.h>
 namespace Play
 {
+class DeferRenderer;
+class GBufferPass;
+
+struct PreDepthSettings
+{
+    bool DepthPrepass = true; // off leaves every item to the gbuffer depth test, the pyramid is built from a cleared depth
+};
+
+struct PreDepthStats
+{
+    bool     StatisticsSupported        = false;
+    uint32_t PrepassDraws               = 0;
+    uint32_t GBufferOnlyDraws           = 0; // blended and alpha tested materials
+    uint32_t GBufferFragmentInvocations = 0;
+    float    GBufferOverdraw            = 0.0f; // fragment invocations per render pixel
+    uint32_t InvocationsWithPrepass     = 0;    // last count measured in each mode
+    uint32_t InvocationsWithoutPrepass  = 0;
+    uint32_t InvocationSaving           = 0;
+    uint32_t HiZWidth                   = 0;
+    uint32_t HiZHeight                  = 0;
+    uint32_t HiZMipCount                = 0;
+};
+
+// depth only pass over the opaque items of the gbuffer render list, so the gbuffer shades them with an equal depth test
+// and pays for one fragment per pixel. The min max depth pyramid "HiZPyramid" is reduced from the result in a single
+// dispatch for the culling passes that follow
+class PreDepthPass : public BasePass
+{
+public:
+    PreDepthPass() = default;
+    PreDepthPass(DeferRenderer* ownedRender, GBufferPass* gbufferPass) : _ownedRender(ownedRender), _gbufferPass(gbufferPass) {}
+    ~PreDepthPass() override = default;
+    void init() override;
+    void build(RDG::RDGBuilder* rdgBuilder) override;
+
+    // scales a render uv onto the pyramid, zero when no pyramid was built
+    glm::vec2 getHiZUVScale() const
+    {
+        return _hiZLayout.uvScale;
+    }
+
+    RTTR_ENABLE(BasePass)
+
+private:
+    void        updateInvocationStats(RDG::RDGBuilder* rdgBuilder);
+    HiZConstant makeHiZConstant() const;
+
+    DeferRenderer*                   _ownedRender = nullptr;
+    GBufferPass*                     _gbufferPass = nullptr;
+    GraphicsPipelineStateInitializer _depthPipeline;
+    ComputePipelineStateInitializer  _hiZPipeline;
+    HiZPyramidLayout                 _hiZLayout;
+
+    PreDepthSettings _settings;
+    PreDepthStats    _stats;
+    // the statistics of a frame slot come back frames later, they count for the mode that slot drew with
+    std::vector<bool> _slotUsedPrepass;
+};
 
 } // namespace Play
 
-#endif // PREDEPTHPASS_H
\ No newline at end of file
+#endif // PREDEPTHPASS_H
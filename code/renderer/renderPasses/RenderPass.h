@@ -17,6 +17,8 @@ public:
     virtual ~BasePass()                             = default;
     virtual void init()                             = 0;
     virtual void build(RDG::RDGBuilder* rdgBuilder) = 0;
+    // every frame before the graph executes, the state skip conditions and execute lambdas read is updated here
+    virtual void update() {}
     std::string  _name;
 
     RTTR_ENABLE()
@@ -0,0 +1,93 @@
+#include "ShadingRateClassifier.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Play
+{
+
+namespace
+{
+float perceivedLuminance(float luminance)
+{
+    const float value = std::max(luminance, 0.0f);
+    return value / (1.0f + value);
+}
+
+uint32_t rateLog2(uint32_t rate)
+{
+    return rate >= 4 ? 2 : rate >= 2 ? 1 : 0;
+}
+
+uint32_t axisRate(float gradient, const ShadingRateThresholds& thresholds)
+{
+    const uint32_t rate = gradient < thresholds.coarse4xGradient ? 4 : gradient < thresholds.coarse2xGradient ? 2 : 1;
+    return std::min(rate, 1u << rateLog2(thresholds.maxRate));
+}
+
+} // namespace
+
+uint32_t shadingRateMaskBit(const glm::uvec2& rate)
+{
+    return 1u << (rateLog2(rate.x) * 3 + rateLog2(rate.y));
+}
+
+glm::vec2 measureShadingRateTileGradient(const ShadingRateTile& tile)
+{
+    glm::vec2  squaredSum(0.0f);
+    glm::uvec2 pairCount(0);
+    for (uint32_t y = 0; y < tile.height; ++y)
+    {
+        for (uint32_t x = 0; x < tile.width; ++x)
+        {
+            const float center = perceivedLuminance(tile.luminance[y * tile.width + x]);
+            if (x + 1 < tile.width)
+            {
+                const float difference = perceivedLuminance(tile.luminance[y * tile.width + x + 1]) - center;
+                squaredSum.x += difference * difference;
+                ++pairCount.x;
+            }
+            if (y + 1 < tile.height)
+            {
+                const float difference = perceivedLuminance(tile.luminance[(y + 1) * tile.width + x]) - center;
+                squaredSum.y += difference * difference;
+                ++pairCount.y;
+            }
+        }
+    }
+    return glm::sqrt(squaredSum / glm::vec2(glm::max(pairCount, glm::uvec2(1))));
+}
+
+glm::uvec2 classifyShadingRateTile(const ShadingRateTile& tile, const ShadingRateThresholds& thresholds)
+{
+    float motion = 0.0f;
+    for (float pixels : tile.motionPixels)
+    {
+        motion = std::max(motion, pixels);
+    }
+    const glm::vec2 gradient = measureShadingRateTileGradient(tile) / (1.0f + motion * std::max(thresholds.motionSensitivity, 0.0f));
+    return glm::uvec2(axisRate(gradient.x, thresholds), axisRate(gradient.y, thresholds));
+}
+
+glm::uvec2 selectSupportedShadingRate(const glm::uvec2& desired, uint32_t supportedMask)
+{
+    glm::uvec2 selected(1);
+    for (uint32_t width = 1; width <= 4; width *= 2)
+    {
+        for (uint32_t height = 1; height <= 4; height *= 2)
+        {
+            const bool supported = (supportedMask & shadingRateMaskBit({width, height})) != 0;
+            if (supported && width <= desired.x && height <= desired.y && width * height > selected.x * selected.y)
+            {
+                selected = {width, height};
+            }
+        }
+    }
+    return selected;
+}
+
+uint32_t encodeShadingRate(const glm::uvec2& rate)
+{
+    return (rateLog2(rate.x) << 2) | rateLog2(rate.y);
+}
+
+} // namespace Play
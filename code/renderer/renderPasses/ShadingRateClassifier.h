@@ -0,0 +1,51 @@
+#ifndef SHADING_RATE_CLASSIFIER_H
+#define SHADING_RATE_CLASSIFIER_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Play
+{
+
+// picks a fragment shading rate per shading rate image texel from the previous frame's lighting. Luminance is compared
+// after a reinhard curve so highlights do not dominate, and motion in render pixels per frame hides detail the same way
+// a lower rate would. The classification shader mirrors this in shadingRate/ShadingRateClassify.comp.slang
+
+// supported rates as a bit mask, bit log2(width) * 3 + log2(height) for widths and heights of 1, 2 and 4
+constexpr uint32_t kShadingRateAllRatesMask = 0x1ff;
+
+struct ShadingRateThresholds
+{
+    float    coarse2xGradient  = 0.02f;  // rms neighbor difference along an axis below which it shades every second pixel
+    float    coarse4xGradient  = 0.006f; // same for every fourth pixel
+    float    motionSensitivity = 0.25f;  // the gradient is divided by 1 + motion * sensitivity
+    uint32_t maxRate           = 4;
+};
+
+// one shading rate image texel of recorded lighting, row major
+struct ShadingRateTile
+{
+    uint32_t           width  = 0;
+    uint32_t           height = 0;
+    std::vector<float> luminance;
+    std::vector<float> motionPixels;
+};
+
+uint32_t shadingRateMaskBit(const glm::uvec2& rate);
+
+// rms difference of horizontal and vertical neighbors of the tile, zero along an axis without neighbors
+glm::vec2 measureShadingRateTileGradient(const ShadingRateTile& tile);
+
+// coarsest rate per axis the content of the tile allows, not yet restricted to what the device supports
+glm::uvec2 classifyShadingRateTile(const ShadingRateTile& tile, const ShadingRateThresholds& thresholds);
+
+// largest supported rate that is nowhere coarser than the desired one, 1x1 is always supported
+glm::uvec2 selectSupportedShadingRate(const glm::uvec2& desired, uint32_t supportedMask);
+
+// VK_KHR_fragment_shading_rate attachment texel value of a rate
+uint32_t encodeShadingRate(const glm::uvec2& rate);
+
+} // namespace Play
+
+#endif // SHADING_RATE_CLASSIFIER_H
@@ -0,0 +1,140 @@
+#include "ShadingRatePass.h"
+#include "ShaderManager.hpp"
+#include "ShadingRateClassifier.h"
+#include "core/runtime/VulkanRuntime.h"
+#include "editor/EditorRegistry.h"
+#include "DeferRendering.h"
+#include <algorithm>
+namespace Play
+{
+
+namespace
+{
+constexpr uint32_t kShadingRateGroupSize       = 8;
+constexpr uint32_t kPreferredShadingRateTexel  = 16;
+constexpr uint32_t kShadingRateEnabled         = 1 << 0; // mirrors the flags in ShadingRateClassify.comp.slang
+constexpr uint32_t kShadingRateSourceValid     = 1 << 1;
+constexpr uint32_t kShadingRateMaxFragmentSize = 4;
+} // namespace
+
+void ShadingRatePass::init()
+{
+    queryShadingRateSupport();
+
+    auto classifyCompID = ShaderManager::Instance().loadShaderFromFile(
+        "shadingRateClassifyComp", "newShaders/deferRenderer/shadingRate/ShadingRateClassify.comp.slang", ShaderStage::eCompute);
+    _classifyPipeline.setShader(classifyCompID);
+    _classifyPipeline.setPushConstant<ShadingRateConstant>();
+
+    vkDriver->getEditorRegistry().registerWritable<ShadingRateSettings>("Variable Rate Shading", _settings, editor::EditorRenderMode::Defer);
+    vkDriver->getEditorRegistry().registerReadOnly<ShadingRateStats>("Variable Rate Shading Stats", _stats, editor::EditorRenderMode::Defer);
+}
+
+void ShadingRatePass::queryShadingRateSupport()
+{
+    // the extension is optional at device creation, the feature query reports false when it is missing
+    VkPhysicalDeviceFragmentShadingRateFeaturesKHR shadingRateFeatures{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_SHADING_RATE_FEATURES_KHR};
+    VkPhysicalDeviceFeatures2                      features2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+    features2.pNext = &shadingRateFeatures;
+    vkGetPhysicalDeviceFeatures2(vkDriver->getPhysicalDevice(), &features2);
+    if (!shadingRateFeatures.attachmentFragmentShadingRate)
+    {
+        LOGW("Attachment fragment shading rate is not supported, the deferred passes shade at full rate\n");
+        return;
+    }
+
+    VkPhysicalDeviceFragmentShadingRatePropertiesKHR shadingRateProperties{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_SHADING_RATE_PROPERTIES_KHR};
+    VkPhysicalDeviceProperties2                      properties2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2};
+    properties2.pNext = &shadingRateProperties;
+    vkGetPhysicalDeviceProperties2(vkDriver->getPhysicalDevice(), &properties2);
+    const VkExtent2D minTexelSize = shadingRateProperties.minFragmentShadingRateAttachmentTexelSize;
+    const VkExtent2D maxTexelSize = shadingRateProperties.maxFragmentShadingRateAttachmentTexelSize;
+    _texelSize.width              = std::clamp(kPreferredShadingRateTexel, minTexelSize.width, maxTexelSize.width);
+    _texelSize.height             = std::clamp(kPreferredShadingRateTexel, minTexelSize.height, maxTexelSize.height);
+
+    uint32_t rateCount = 0;
+    vkGetPhysicalDeviceFragmentShadingRatesKHR(vkDriver->getPhysicalDevice(), &rateCount, nullptr);
+    std::vector<VkPhysicalDeviceFragmentShadingRateKHR> rates(rateCount, {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_SHADING_RATE_KHR});
+    vkGetPhysicalDeviceFragmentShadingRatesKHR(vkDriver->getPhysicalDevice(), &rateCount, rates.data());
+    for (const VkPhysicalDeviceFragmentShadingRateKHR& rate : rates)
+    {
+        const bool singleSampled = (rate.sampleCounts & VK_SAMPLE_COUNT_1_BIT) != 0;
+        if (singleSampled && rate.fragmentSize.width <= kShadingRateMaxFragmentSize && rate.fragmentSize.height <= kShadingRateMaxFragmentSize)
+        {
+            _supportedRateMask |= shadingRateMaskBit({rate.fragmentSize.width, rate.fragmentSize.height});
+        }
+    }
+
+    _stats.Supported         = true;
+    _stats.TexelWidth        = _texelSize.width;
+    _stats.TexelHeight       = _texelSize.height;
+    _stats.SupportedRateMask = _supportedRateMask;
+}
+
+ShadingRateConstant ShadingRatePass::makeShadingRateConstant() const
+{
+    const VkExtent2D    renderExtent = _ownedRender->getRenderExtent();
+    ShadingRateConstant constant{};
+    constant.sourceWidth       = renderExtent.width;
+    constant.sourceHeight      = renderExtent.height;
+    constant.texelWidth        = _texelSize.width;
+    constant.texelHeight       = _texelSize.height;
+    constant.rateWidth         = _stats.RateImageWidth;
+    constant.rateHeight        = _stats.RateImageHeight;
+    constant.supportedRateMask = _supportedRateMask;
+    constant.maxRate           = _settings.MaxShadingRate;
+    constant.coarse2xGradient  = _settings.Coarse2xGradient;
+    constant.coarse4xGradient  = std::min(_settings.Coarse4xGradient, _settings.Coarse2xGradient);
+    constant.motionSensitivity = _settings.MotionSensitivity;
+    constant.shadingRateFlags  = (_settings.VariableRateShading ? kShadingRateEnabled : 0) | (_sourceValid ? kShadingRateSourceValid : 0);
+    return constant;
+}
+
+void ShadingRatePass::build(RDG::RDGBuilder* rdgBuilder)
+{
+    const VkExtent2D renderExtent = _ownedRender->getRenderExtent();
+    // the source is recreated with the graph
+    _sourceValid = false;
+
+    // written by the lighting pass, read back by the next frame's classification
+    RDG::RDGTextureRef shadingRateSource = rdgBuilder->createTexture("ShadingRateSource")
+                                               .Extent({renderExtent.width, renderExtent.height, 1})
+                                               .AspectFlags(VK_IMAGE_ASPECT_COLOR_BIT)
+                                               .Format(VK_FORMAT_R16G16_SFLOAT)
+                                               .UsageFlags(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)
+                                               .MipmapLevel(1)
+                                               .finish();
+    // without device support there is no rate image, the gbuffer and lighting passes then draw without an attachment
+    if (_texelSize.width == 0 || _texelSize.height == 0)
+    {
+        return;
+    }
+
+    _stats.RateImageWidth               = (renderExtent.width + _texelSize.width - 1) / _texelSize.width;
+    _stats.RateImageHeight              = (renderExtent.height + _texelSize.height - 1) / _texelSize.height;
+    RDG::RDGTextureRef shadingRateImage = rdgBuilder->createTexture("ShadingRateImage")
+                                              .Extent({_stats.RateImageWidth, _stats.RateImageHeight, 1})
+                                              .AspectFlags(VK_IMAGE_ASPECT_COLOR_BIT)
+                                              .Format(VK_FORMAT_R8_UINT)
+                                              .UsageFlags(VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_FRAGMENT_SHADING_RATE_ATTACHMENT_BIT_KHR)
+                                              .MipmapLevel(1)
+                                              .finish();
+
+    [[maybe_unused]] RDG::ComputePassNodeRef classifyPass =
+        rdgBuilder->createComputePass("Shading Rate Pass")
+            .read(0, shadingRateSource, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .storageWrite(1, shadingRateImage, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .execute(
+                [this](RDG::PassNode* node, RDG::RenderContext& context)
+                {
+                    context.bindPipeline(_classifyPipeline);
+                    context.bindPushConstant(makeShadingRateConstant());
+                    vkCmdDispatch(context._currCmdBuffer, nvvk::getGroupCounts(_stats.RateImageWidth, kShadingRateGroupSize),
+                                  nvvk::getGroupCounts(_stats.RateImageHeight, kShadingRateGroupSize), 1);
+                    // from the next frame on the source holds a lit frame
+                    _sourceValid = true;
+                })
+            .finish();
+}
+
+} // namespace Play
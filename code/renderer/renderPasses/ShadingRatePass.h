@@ -0,0 +1,67 @@
+#ifndef SHADINGRATEPASS_H
+#define SHADINGRATEPASS_H
+#include "RDG/RDG.h"
+#include "RenderPass.h"
+#include "PipelineCacheManager.h"
+#include "PConstantType.h.slang"
+#include <rttr/rttr_enable.h>
+namespace Play
+{
+class DeferRenderer;
+
+struct ShadingRateSettings
+{
+    bool     VariableRateShading = true; // off keeps the shading rate attachment at 1x1
+    float    Coarse2xGradient    = 0.02f;
+    float    Coarse4xGradient    = 0.006f;
+    float    MotionSensitivity   = 0.25f; // gradients are divided by 1 + motion in pixels per frame times this
+    uint32_t MaxShadingRate      = 4;
+};
+
+struct ShadingRateStats
+{
+    bool     Supported         = false;
+    uint32_t TexelWidth        = 0;
+    uint32_t TexelHeight       = 0;
+    uint32_t RateImageWidth    = 0;
+    uint32_t RateImageHeight   = 0;
+    uint32_t SupportedRateMask = 0;
+};
+
+// content adaptive shading rate for the gbuffer and lighting passes. The lighting pass leaves its luminance and motion
+// in ShadingRateSource, the next frame classifies every shading rate image texel from it before the gbuffer draws.
+// Without attachment shading rate support only the source is created and the passes run at full rate
+class ShadingRatePass : public BasePass
+{
+public:
+    ShadingRatePass() = default;
+    ShadingRatePass(DeferRenderer* ownedRender) : _ownedRender(ownedRender) {}
+    ~ShadingRatePass() override = default;
+    void init() override;
+    void build(RDG::RDGBuilder* rdgBuilder) override;
+
+    // zero when the device has no attachment shading rate
+    VkExtent2D getTexelSize() const
+    {
+        return _texelSize;
+    }
+
+    RTTR_ENABLE(BasePass)
+
+private:
+    void                queryShadingRateSupport();
+    ShadingRateConstant makeShadingRateConstant() const;
+
+    DeferRenderer*                  _ownedRender = nullptr;
+    ComputePipelineStateInitializer _classifyPipeline;
+    VkExtent2D                      _texelSize         = {0, 0};
+    uint32_t                        _supportedRateMask = 0;
+
+    ShadingRateSettings _settings;
+    ShadingRateStats    _stats;
+    bool                _sourceValid = false;
+};
+
+} // namespace Play
+
+#endif // SHADINGRATEPASS_H
@@ -0,0 +1,30 @@
+#include "TemporalReprojection.h"
+#include <algorithm>
+
+namespace Play
+{
+
+glm::uvec2 computeRenderExtent(const glm::uvec2& outputExtent, float renderScale)
+{
+    const glm::vec2 scaled = glm::round(glm::vec2(outputExtent) * std::clamp(renderScale, 0.01f, 1.0f));
+    return glm::max(glm::uvec2(scaled), glm::uvec2(1));
+}
+
+glm::vec2 projectToScreenUv(const glm::vec3& worldPos, const glm::mat4& viewProj)
+{
+    const glm::vec4 clip = viewProj * glm::vec4(worldPos, 1.0f);
+    return glm::vec2(clip) / clip.w * 0.5f + 0.5f;
+}
+
+glm::vec2 computeScreenVelocity(const glm::vec3& worldPos, const glm::vec3& prevWorldPos, const glm::mat4& viewProj, const glm::mat4& prevViewProj)
+{
+    return projectToScreenUv(worldPos, viewProj) - projectToScreenUv(prevWorldPos, prevViewProj);
+}
+
+glm::vec2 reprojectScreenUv(const glm::vec2& uv, float depth, const glm::mat4& invViewProj, const glm::mat4& prevViewProj)
+{
+    const glm::vec4 world = invViewProj * glm::vec4(uv * 2.0f - 1.0f, depth, 1.0f);
+    return projectToScreenUv(glm::vec3(world) / world.w, prevViewProj);
+}
+
+} // namespace Play
@@ -0,0 +1,27 @@
+#ifndef TEMPORAL_REPROJECTION_H
+#define TEMPORAL_REPROJECTION_H
+
+#include "core/TemporalJitter.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace Play
+{
+
+// screen positions are uv = ndc * 0.5 + 0.5 like the full screen passes, velocities are the current minus the previous
+// uv of a surface point. The temporal upscale shader mirrors this math in postprocess/TemporalUpscale.comp.slang
+
+// internal resolution of the scene passes, never smaller than one pixel
+glm::uvec2 computeRenderExtent(const glm::uvec2& outputExtent, float renderScale);
+
+glm::vec2 projectToScreenUv(const glm::vec3& worldPos, const glm::mat4& viewProj);
+
+// what the gbuffer writes into its velocity target for a world point that moved from prevWorldPos to worldPos
+glm::vec2 computeScreenVelocity(const glm::vec3& worldPos, const glm::vec3& prevWorldPos, const glm::mat4& viewProj, const glm::mat4& prevViewProj);
+
+// previous frame uv of a static surface from its depth alone, used where the gbuffer wrote no velocity
+glm::vec2 reprojectScreenUv(const glm::vec2& uv, float depth, const glm::mat4& invViewProj, const glm::mat4& prevViewProj);
+
+} // namespace Play
+
+#endif // TEMPORAL_REPROJECTION_H
@@ -0,0 +1,126 @@
+#include "TemporalUpscalePass.h"
+#include "ShaderManager.hpp"
+#include "GBufferConfig.h"
+#include "TemporalReprojection.h"
+#include "core/runtime/VulkanRuntime.h"
+#include "editor/EditorRegistry.h"
+#include "DeferRendering.h"
+#include <algorithm>
+namespace Play
+{
+
+namespace
+{
+constexpr uint32_t kTemporalUpscaleGroupSize    = 8;
+constexpr uint32_t kTemporalUpscaleHistoryValid = 1 << 0; // mirrors the flags in TemporalUpscale.comp.slang
+constexpr uint32_t kTemporalUpscaleShowVelocity = 1 << 1;
+} // namespace
+
+void TemporalUpscalePass::init()
+{
+    auto resolveCompID = ShaderManager::Instance().loadShaderFromFile(
+        "temporalUpscaleComp", "newShaders/deferRenderer/postprocess/TemporalUpscale.comp.slang", ShaderStage::eCompute);
+    _resolvePipeline.setShader(resolveCompID);
+    _resolvePipeline.setPushConstant<TemporalUpscaleConstant>();
+
+    auto historyCopyCompID = ShaderManager::Instance().loadShaderFromFile(
+        "temporalHistoryCopyComp", "newShaders/deferRenderer/postprocess/TemporalHistoryCopy.comp.slang", ShaderStage::eCompute);
+    _historyCopyPipeline.setShader(historyCopyCompID);
+    _historyCopyPipeline.setPushConstant<TemporalUpscaleConstant>();
+
+    vkDriver->getEditorRegistry().registerWritable<TemporalUpscaleSettings>("Temporal Upscaling", _settings, editor::EditorRenderMode::Defer);
+    vkDriver->getEditorRegistry().registerReadOnly<TemporalUpscaleStats>("Temporal Upscaling Stats", _stats, editor::EditorRenderMode::Defer);
+}
+
+TemporalUpscaleConstant TemporalUpscalePass::makeTemporalUpscaleConstant() const
+{
+    TemporalUpscaleConstant constant{};
+    constant.cameraBufferDeviceAddress = _ownedRender->getCurrentCameraBuffer()->address;
+    constant.renderWidth               = _stats.RenderWidth;
+    constant.renderHeight              = _stats.RenderHeight;
+    constant.outputWidth               = _stats.OutputWidth;
+    constant.outputHeight              = _stats.OutputHeight;
+    constant.currentFrameWeight        = std::clamp(_settings.CurrentFrameWeight, 0.01f, 1.0f);
+    constant.varianceClipGamma         = std::max(_settings.VarianceClipGamma, 0.0f);
+    constant.upscaleFlags              = _settings.TemporalAccumulation && _historyValid ? kTemporalUpscaleHistoryValid : 0;
+    if (_settings.ShowVelocity)
+    {
+        constant.upscaleFlags |= kTemporalUpscaleShowVelocity;
+    }
+    return constant;
+}
+
+void TemporalUpscalePass::update()
+{
+    // the history pass is skipped while accumulation is off, a history kept then would be stale once it is turned back on
+    _historyValid  = _historyCopied;
+    _historyCopied = _settings.TemporalAccumulation;
+    // the camera of the next frame follows the accumulation toggle
+    _ownedRender->setTemporalJitter(_settings.TemporalAccumulation);
+}
+
+void TemporalUpscalePass::build(RDG::RDGBuilder* rdgBuilder)
+{
+    const VkExtent2D renderExtent = _ownedRender->getRenderExtent();
+    const VkExtent2D outputExtent = vkDriver->getViewportSize();
+    _stats.RenderWidth            = renderExtent.width;
+    _stats.RenderHeight           = renderExtent.height;
+    _stats.OutputWidth            = outputExtent.width;
+    _stats.OutputHeight           = outputExtent.height;
+    _stats.JitterPhases           = temporalJitterPhaseCount(float(renderExtent.width) / float(std::max(outputExtent.width, 1u)));
+    // the history textures are recreated with the graph
+    _historyValid  = false;
+    _historyCopied = false;
+
+    RDG::RDGTextureRef inputLight    = rdgBuilder->getTexture("LightPassOutput");
+    RDG::RDGTextureRef velocityRT    = rdgBuilder->getTexture(GBufferConfig::Get(GBufferType::GVelocity).debugName);
+    RDG::RDGTextureRef depthRT       = rdgBuilder->getTexture(GBufferConfig::Get(GBufferType::GSceneDepth).debugName);
+    RDG::RDGTextureRef resolvedColor = rdgBuilder->createTexture("TemporalUpscaleOutput")
+                                           .Extent({outputExtent.width, outputExtent.height, 1})
+                                           .AspectFlags(VK_IMAGE_ASPECT_COLOR_BIT)
+                                           .Format(VK_FORMAT_R16G16B16A16_SFLOAT)
+                                           .UsageFlags(VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)
+                                           .MipmapLevel(1)
+                                           .finish();
+    RDG::RDGTextureRef historyColor  = rdgBuilder->createTexture("TemporalUpscaleHistory")
+                                          .Extent({outputExtent.width, outputExtent.height, 1})
+                                          .AspectFlags(VK_IMAGE_ASPECT_COLOR_BIT)
+                                          .Format(VK_FORMAT_R16G16B16A16_SFLOAT)
+                                          .UsageFlags(VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)
+                                          .MipmapLevel(1)
+                                          .finish();
+
+    [[maybe_unused]] RDG::ComputePassNodeRef resolvePass =
+        rdgBuilder->createComputePass("Temporal Upscale Pass")
+            .read(0, inputLight, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .read(1, velocityRT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .read(2, depthRT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .read(3, historyColor, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .storageWrite(4, resolvedColor, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .execute(
+                [this](RDG::PassNode* node, RDG::RenderContext& context)
+                {
+                    context.bindPipeline(_resolvePipeline);
+                    context.bindPushConstant(makeTemporalUpscaleConstant());
+                    vkCmdDispatch(context._currCmdBuffer, nvvk::getGroupCounts(_stats.OutputWidth, kTemporalUpscaleGroupSize),
+                                  nvvk::getGroupCounts(_stats.OutputHeight, kTemporalUpscaleGroupSize), 1);
+                })
+            .finish();
+
+    [[maybe_unused]] RDG::ComputePassNodeRef historyCopyPass =
+        rdgBuilder->createComputePass("Temporal History Pass")
+            .storageRead(0, resolvedColor, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .storageWrite(1, historyColor, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .skipIf([this]() { return !_settings.TemporalAccumulation; })
+            .execute(
+                [this](RDG::PassNode* node, RDG::RenderContext& context)
+                {
+                    context.bindPipeline(_historyCopyPipeline);
+                    context.bindPushConstant(makeTemporalUpscaleConstant());
+                    vkCmdDispatch(context._currCmdBuffer, nvvk::getGroupCounts(_stats.OutputWidth, kTemporalUpscaleGroupSize),
+                                  nvvk::getGroupCounts(_stats.OutputHeight, kTemporalUpscaleGroupSize), 1);
+                })
+            .finish();
+}
+
+} // namespace Play
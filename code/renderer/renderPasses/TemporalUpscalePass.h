@@ -0,0 +1,58 @@
+#ifndef TEMPORALUPSCALEPASS_H
+#define TEMPORALUPSCALEPASS_H
+#include "RDG/RDG.h"
+#include "RenderPass.h"
+#include "PipelineCacheManager.h"
+#include "PConstantType.h.slang"
+#include <rttr/rttr_enable.h>
+namespace Play
+{
+class DeferRenderer;
+
+struct TemporalUpscaleSettings
+{
+    bool  TemporalAccumulation = true; // off upscales the current frame alone and stops the camera jitter
+    float CurrentFrameWeight   = 0.1f;
+    float VarianceClipGamma    = 1.25f; // width of the history acceptance box in standard deviations
+    bool  ShowVelocity         = false;
+};
+
+struct TemporalUpscaleStats
+{
+    uint32_t RenderWidth  = 0;
+    uint32_t RenderHeight = 0;
+    uint32_t OutputWidth  = 0;
+    uint32_t OutputHeight = 0;
+    uint32_t JitterPhases = 0;
+};
+
+// resolves the lighting, rendered below the viewport resolution with a per frame camera jitter, into a full resolution
+// history the post process reads. The resolve output is copied into the history at the end of the frame
+class TemporalUpscalePass : public BasePass
+{
+public:
+    TemporalUpscalePass() = default;
+    TemporalUpscalePass(DeferRenderer* ownedRender) : _ownedRender(ownedRender) {}
+    ~TemporalUpscalePass() override = default;
+    void init() override;
+    void build(RDG::RDGBuilder* rdgBuilder) override;
+    void update() override;
+
+    RTTR_ENABLE(BasePass)
+
+private:
+    TemporalUpscaleConstant makeTemporalUpscaleConstant() const;
+
+    DeferRenderer*                  _ownedRender = nullptr;
+    ComputePipelineStateInitializer _resolvePipeline;
+    ComputePipelineStateInitializer _historyCopyPipeline;
+
+    TemporalUpscaleSettings _settings;
+    TemporalUpscaleStats    _stats;
+    bool                    _historyValid  = false;
+    bool                    _historyCopied = false; // the last frame copied its resolve into the history
+};
+
+} // namespace Play
+
+#endif // TEMPORALUPSCALEPASS_H
@@ -0,0 +1,135 @@
+#include "VolumeBrickGrid.h"
+#include <algorithm>
+#include <cmath>
+#include <nvutils/parallel_work.hpp>
+
+namespace Play
+{
+
+namespace
+{
+// voxel range of a brick along one axis, widened by the trilinear filter footprint
+glm::uvec2 brickVoxelRange(uint32_t brick, uint32_t brickSize, uint32_t axisExtent)
+{
+    const int64_t first = int64_t(brick) * brickSize - 1;
+    const int64_t last  = int64_t(brick + 1) * brickSize;
+    return glm::uvec2(uint32_t(std::max<int64_t>(first, 0)), uint32_t(std::min<int64_t>(last, int64_t(axisExtent) - 1)));
+}
+} // namespace
+
+VolumeBrickGrid createVolumeBrickGrid(const glm::uvec3& extent, uint32_t brickSize)
+{
+    VolumeBrickGrid grid;
+    grid.brickSize    = std::max(brickSize, 1u);
+    grid.volumeExtent = extent;
+    grid.brickCount   = (extent + grid.brickSize - 1u) / grid.brickSize;
+
+    const size_t brickTotal = size_t(grid.brickCount.x) * grid.brickCount.y * grid.brickCount.z;
+    grid.minIntensity.assign(brickTotal, UINT16_MAX);
+    grid.maxIntensity.assign(brickTotal, 0);
+    return grid;
+}
+
+void accumulateVolumeBrickSlices(VolumeBrickGrid& grid, std::span<const uint16_t> slices, uint32_t firstSlice)
+{
+    const glm::uvec3& extent     = grid.volumeExtent;
+    const size_t      sliceSize  = size_t(extent.x) * extent.y;
+    const uint32_t    sliceCount = sliceSize > 0 ? uint32_t(slices.size() / sliceSize) : 0;
+    if (sliceCount == 0 || grid.minIntensity.empty())
+    {
+        return;
+    }
+    const uint32_t lastSlice = std::min(firstSlice + sliceCount, extent.z) - 1;
+
+    // a voxel feeds its own brick and the neighbour whose apron it lies in, one work item per brick row keeps the
+    // parallel updates disjoint
+    const uint32_t firstBrickZ = firstSlice == 0 ? 0 : (firstSlice - 1) / grid.brickSize;
+    const uint32_t lastBrickZ  = std::min((lastSlice + 1) / grid.brickSize, grid.brickCount.z - 1);
+    const uint32_t rowCount    = (lastBrickZ - firstBrickZ + 1) * grid.brickCount.y;
+    nvutils::parallel_batches<1>(rowCount,
+                                 [&](uint64_t row)
+                                 {
+                                     const uint32_t   bz     = firstBrickZ + uint32_t(row / grid.brickCount.y);
+                                     const uint32_t   by     = uint32_t(row % grid.brickCount.y);
+                                     const glm::uvec2 rangeY = brickVoxelRange(by, grid.brickSize, extent.y);
+                                     glm::uvec2       rangeZ = brickVoxelRange(bz, grid.brickSize, extent.z);
+                                     rangeZ                  = glm::uvec2(std::max(rangeZ.x, firstSlice), std::min(rangeZ.y, lastSlice));
+                                     for (uint32_t bx = 0; bx < grid.brickCount.x; ++bx)
+                                     {
+                                         const glm::uvec2 rangeX   = brickVoxelRange(bx, grid.brickSize, extent.x);
+                                         const uint32_t   brick    = grid.brickIndex(bx, by, bz);
+                                         uint16_t         minValue = grid.minIntensity[brick];
+                                         uint16_t         maxValue = grid.maxIntensity[brick];
+                                         for (uint32_t z = rangeZ.x; z <= rangeZ.y; ++z)
+                                         {
+                                             for (uint32_t y = rangeY.x; y <= rangeY.y; ++y)
+                                             {
+                                                 const uint16_t* voxels = slices.data() + (size_t(z - firstSlice) * extent.y + y) * extent.x;
+                                                 for (uint32_t x = rangeX.x; x <= rangeX.y; ++x)
+                                                 {
+                                                     minValue = std::min(minValue, voxels[x]);
+                                                     maxValue = std::max(maxValue, voxels[x]);
+                                                 }
+                                             }
+                                         }
+                                         grid.minIntensity[brick] = minValue;
+                                         grid.maxIntensity[brick] = maxValue;
+                                     }
+                                 });
+}
+
+VolumeBrickGrid buildVolumeBrickGrid(std::span<const uint16_t> intensity, const glm::uvec3& extent, uint32_t brickSize)
+{
+    VolumeBrickGrid grid = createVolumeBrickGrid(extent, brickSize);
+    if (intensity.size() >= size_t(extent.x) * extent.y * extent.z)
+    {
+        accumulateVolumeBrickSlices(grid, intensity, 0);
+    }
+    return grid;
+}
+
+std::vector<float> buildVolumeMajorantGrid(const VolumeBrickGrid& grid, std::span<const uint8_t> opacityLookup)
+{
+    std::vector<float> majorants(grid.minIntensity.size(), 0.0f);
+    if (opacityLookup.empty())
+    {
+        return majorants;
+    }
+
+    // a linear 1d lookup at u blends the texels around u * size - 0.5, so widen the range to both neighbours
+    const int32_t lookupSize  = int32_t(opacityLookup.size());
+    auto          lookupTexel = [lookupSize](uint16_t value, bool upper)
+    {
+        const float texel = float(value) / float(UINT16_MAX) * float(lookupSize) - 0.5f;
+        return std::clamp(int32_t(upper ? std::ceil(texel) : std::floor(texel)), 0, lookupSize - 1);
+    };
+
+    for (size_t brick = 0; brick < majorants.size(); ++brick)
+    {
+        if (grid.minIntensity[brick] > grid.maxIntensity[brick])
+        {
+            continue;
+        }
+        const int32_t first   = lookupTexel(grid.minIntensity[brick], false);
+        const int32_t last    = lookupTexel(grid.maxIntensity[brick], true);
+        uint8_t       opacity = 0;
+        for (int32_t texel = first; texel <= last; ++texel)
+        {
+            opacity = std::max(opacity, opacityLookup[texel]);
+        }
+        majorants[brick] = float(opacity) / 255.0f;
+    }
+    return majorants;
+}
+
+float computeEmptyBrickRatio(std::span<const float> majorants)
+{
+    if (majorants.empty())
+    {
+        return 0.0f;
+    }
+    const size_t emptyBricks = std::count(majorants.begin(), majorants.end(), 0.0f);
+    return float(emptyBricks) / float(majorants.size());
+}
+
+} // namespace Play
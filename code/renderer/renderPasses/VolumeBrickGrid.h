@@ -0,0 +1,50 @@
+#ifndef VOLUME_BRICK_GRID_H
+#define VOLUME_BRICK_GRID_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Play
+{
+
+// coarse min/max grid over the normalized 16 bit volume, each brick also covers the one voxel apron that trilinear
+// filtering can reach from inside it
+struct VolumeBrickGrid
+{
+    uint32_t              brickSize  = 8;
+    glm::uvec3            volumeExtent{0};
+    glm::uvec3            brickCount{0};
+    std::vector<uint16_t> minIntensity;
+    std::vector<uint16_t> maxIntensity;
+
+    uint32_t brickIndex(uint32_t x, uint32_t y, uint32_t z) const
+    {
+        return (z * brickCount.y + y) * brickCount.x + x;
+    }
+    // maps a normalized volume texture coordinate to brick grid units, the shader uses the same scale
+    glm::vec3 brickScale() const
+    {
+        return glm::vec3(volumeExtent) / float(brickSize);
+    }
+};
+
+// empty grid, every brick starts with an inverted min/max range
+VolumeBrickGrid createVolumeBrickGrid(const glm::uvec3& extent, uint32_t brickSize);
+
+// folds whole normalized slices starting at firstSlice into the bricks whose filter footprint reaches them, so the grid
+// can be built while a volume streams in slice by slice. Voxels are x-major then y then z like the 3d volume texture
+void accumulateVolumeBrickSlices(VolumeBrickGrid& grid, std::span<const uint16_t> slices, uint32_t firstSlice);
+
+VolumeBrickGrid buildVolumeBrickGrid(std::span<const uint16_t> intensity, const glm::uvec3& extent, uint32_t brickSize);
+
+// highest opacity the linearly filtered lookup can return for any intensity inside each brick, 0 marks a brick
+// that never contributes to the optical depth under this transfer function
+std::vector<float> buildVolumeMajorantGrid(const VolumeBrickGrid& grid, std::span<const uint8_t> opacityLookup);
+
+float computeEmptyBrickRatio(std::span<const float> majorants);
+
+} // namespace Play
+
+#endif // VOLUME_BRICK_GRID_H
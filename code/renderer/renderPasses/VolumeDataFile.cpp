@@ -0,0 +1,189 @@
+#include "VolumeDataFile.h"
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <regex>
+#include <vector>
+#include <nvutils/file_operations.hpp>
+#include <nvutils/logger.hpp>
+#include <nvutils/parallel_work.hpp>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace Play
+{
+namespace
+{
+static_assert(std::endian::native == std::endian::little, "volume files are read in place as little endian");
+
+// voxels normalized per parallel work item, large enough to amortize the dispatch and keep the loop vectorized
+constexpr uint64_t kNormalizeChunkVoxels = 1u << 16;
+
+template <typename T>
+void normalizeChunks(const T* source, uint16_t* destination, uint64_t voxelCount, float scale)
+{
+    const uint64_t chunkCount = (voxelCount + kNormalizeChunkVoxels - 1) / kNormalizeChunkVoxels;
+    nvutils::parallel_batches<1>(chunkCount,
+                                 [&](uint64_t chunk)
+                                 {
+                                     const uint64_t first = chunk * kNormalizeChunkVoxels;
+                                     const uint64_t last  = std::min(first + kNormalizeChunkVoxels, voxelCount);
+                                     for (uint64_t voxel = first; voxel < last; ++voxel)
+                                     {
+                                         destination[voxel] = uint16_t(std::min(float(source[voxel]) * scale + 0.5f, 65535.0f));
+                                     }
+                                 });
+}
+
+bool parseRawFileName(const std::string& fileName, VolumeDataInfo& info)
+{
+    std::smatch      match;
+    const std::regex extentPattern("(\\d+)x(\\d+)x(\\d+)");
+    if (!std::regex_search(fileName, match, extentPattern))
+    {
+        return false;
+    }
+    info.extent         = glm::uvec3(std::stoul(match[1]), std::stoul(match[2]), std::stoul(match[3]));
+    info.bytesPerVoxel  = fileName.find("uint8") != std::string::npos ? 1 : 2;
+    info.intensityRange = info.bytesPerVoxel == 1 ? 255 : 65535;
+    info.dataOffset     = 0;
+    return true;
+}
+} // namespace
+
+bool VolumeDataFile::open(const std::filesystem::path& path)
+{
+    close();
+    if (!_mapping.open(path))
+    {
+        LOGE("Failed to map volume data file: %s\n", nvutils::utf8FromPath(path).c_str());
+        return false;
+    }
+
+    std::string extension = nvutils::utf8FromPath(path.extension());
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+    const uint8_t* bytes = static_cast<const uint8_t*>(_mapping.data());
+    if (extension == ".dat")
+    {
+        if (_mapping.size() < sizeof(uint16_t) * 3)
+        {
+            LOGE("Volume data file is missing dimensions: %s\n", nvutils::utf8FromPath(path).c_str());
+            close();
+            return false;
+        }
+        uint16_t dimensions[3];
+        std::memcpy(dimensions, bytes, sizeof(dimensions));
+        _info.extent         = glm::uvec3(dimensions[0], dimensions[1], dimensions[2]);
+        _info.bytesPerVoxel  = 2;
+        _info.intensityRange = 1 << 12;
+        _info.dataOffset     = sizeof(dimensions);
+    }
+    else if (!parseRawFileName(nvutils::utf8FromPath(path.filename()), _info))
+    {
+        LOGE("Raw volume file name does not carry its extent (name_WxHxD[_uint8|_uint16].raw): %s\n", nvutils::utf8FromPath(path).c_str());
+        close();
+        return false;
+    }
+
+    const size_t voxelCount = getSliceVoxelCount() * _info.extent.z;
+    if (voxelCount == 0 || _mapping.size() < _info.dataOffset + voxelCount * _info.bytesPerVoxel)
+    {
+        LOGE("Volume data file is truncated: %s\n", nvutils::utf8FromPath(path).c_str());
+        close();
+        return false;
+    }
+    return true;
+}
+
+void VolumeDataFile::close()
+{
+    _mapping.close();
+    _info = {};
+}
+
+void VolumeDataFile::normalizeSlices(uint32_t firstSlice, uint32_t sliceCount, uint16_t* destination) const
+{
+    const uint64_t voxelCount = uint64_t(getSliceVoxelCount()) * sliceCount;
+    const uint64_t firstVoxel = uint64_t(getSliceVoxelCount()) * firstSlice;
+    const uint8_t* sliceBytes = static_cast<const uint8_t*>(_mapping.data()) + _info.dataOffset + firstVoxel * _info.bytesPerVoxel;
+    const float    scale      = 65535.0f / float(_info.intensityRange);
+    if (_info.bytesPerVoxel == 1)
+    {
+        normalizeChunks(sliceBytes, destination, voxelCount, scale);
+    }
+    else
+    {
+        normalizeChunks(reinterpret_cast<const uint16_t*>(sliceBytes), destination, voxelCount, scale);
+    }
+}
+
+bool writeSyntheticVolumeFile(const std::filesystem::path& path, uint32_t size)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file || size == 0 || size > UINT16_MAX)
+    {
+        LOGE("Failed to create synthetic volume: %s\n", nvutils::utf8FromPath(path).c_str());
+        return false;
+    }
+    const uint16_t dimensions[3] = {uint16_t(size), uint16_t(size), uint16_t(size)};
+    file.write(reinterpret_cast<const char*>(dimensions), sizeof(dimensions));
+
+    // air, a soft tissue shell and a dense core, so the transfer function leaves large empty regions
+    std::vector<uint16_t> slice(size_t(size) * size);
+    const float           center = 0.5f * float(size);
+    for (uint32_t z = 0; z < size; ++z)
+    {
+        nvutils::parallel_batches<64>(size,
+                                      [&](uint64_t y)
+                                      {
+                                          for (uint32_t x = 0; x < size; ++x)
+                                          {
+                                              const glm::vec3 position = (glm::vec3(float(x), float(y), float(z)) + 0.5f - center) / center;
+                                              const float     radius   = glm::length(position);
+                                              uint16_t        value    = 0;
+                                              if (radius < 0.3f)
+                                              {
+                                                  value = 3000;
+                                              }
+                                              else if (radius > 0.55f && radius < 0.7f)
+                                              {
+                                                  value = 1100;
+                                              }
+                                              slice[y * size + x] = value;
+                                          }
+                                      });
+        file.write(reinterpret_cast<const char*>(slice.data()), std::streamsize(slice.size() * sizeof(uint16_t)));
+    }
+    return bool(file);
+}
+
+size_t getPeakResidentBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+        return size_t(usage.ru_maxrss) * 1024;
+    }
+    return 0;
+#endif
+}
+
+} // namespace Play
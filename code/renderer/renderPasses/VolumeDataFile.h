@@ -0,0 +1,54 @@
+#ifndef VOLUME_DATA_FILE_H
+#define VOLUME_DATA_FILE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <glm/glm.hpp>
+#include <nvutils/file_mapping.hpp>
+
+namespace Play
+{
+
+struct VolumeDataInfo
+{
+    glm::uvec3 extent{0};
+    uint32_t   bytesPerVoxel  = 2;
+    uint32_t   intensityRange = 1 << 12; // raw value mapped to 1.0, 12 bit ct for the .dat files
+    size_t     dataOffset     = 0;
+};
+
+// read-only memory mapping of a volume dataset, voxels are x-major then y then z little endian.
+// .dat files start with three uint16 dimensions followed by 12 bit intensities in uint16.
+// .raw files carry the extent and voxel type in their name, e.g. "bonsai_256x256x256_uint8.raw".
+class VolumeDataFile
+{
+public:
+    bool open(const std::filesystem::path& path);
+    void close();
+
+    const VolumeDataInfo& getInfo() const
+    {
+        return _info;
+    }
+    size_t getSliceVoxelCount() const
+    {
+        return size_t(_info.extent.x) * _info.extent.y;
+    }
+
+    // normalizes the slices [firstSlice, firstSlice + sliceCount) to 16 bit unorm, split in parallel chunks
+    void normalizeSlices(uint32_t firstSlice, uint32_t sliceCount, uint16_t* destination) const;
+
+private:
+    nvutils::FileReadMapping _mapping;
+    VolumeDataInfo           _info;
+};
+
+// writes a .dat volume with a few nested shells of different density, used to measure large dataset loading
+bool writeSyntheticVolumeFile(const std::filesystem::path& path, uint32_t size);
+
+// peak resident set size of the process so far, 0 when the platform query is not available
+size_t getPeakResidentBytes();
+
+} // namespace Play
+
+#endif // VOLUME_DATA_FILE_H
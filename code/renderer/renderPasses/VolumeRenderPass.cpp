@@ -7,14 +7,20 @@
 #include "PlayAllocator.h"
 #include "utils.hpp"
 #include "editor/EditorRegistry.h"
+#include "VolumeDataFile.h"
 #include "tinygltf/json.hpp"
 #include <nvutils/file_operations.hpp>
 #include <nvutils/logger.hpp>
+#include <charconv>
+#include <chrono>
 
 namespace
 {
 constexpr uint32_t kLookupTextureSize = 512;
 constexpr uint32_t kVolumeGroupSize   = 8;
+constexpr uint32_t kVolumeBrickSize   = 8;
+// host memory for one batch of normalized slices, large volumes are uploaded slice batch by slice batch
+constexpr size_t kVolumeUploadBatchBytes = 64ull << 20;
 
 template <uint32_t N>
 struct PiecewiseFunction
@@ -175,12 +181,6 @@ VkImageViewCreateInfo makeImageViewCreateInfo(VkImageViewType type, VkFormat for
     return viewInfo;
 }
 
-uint16_t readUint16(const std::string& data, size_t index)
-{
-    const auto* bytes = reinterpret_cast<const unsigned char*>(data.data() + index * sizeof(uint16_t));
-    return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
-}
-
 glm::vec3 vec3FromJson(const nlohmann::json& value)
 {
     return glm::vec3(value[0].get<float>(), value[1].get<float>(), value[2].get<float>());
@@ -201,16 +201,18 @@ void VolumeRenderPass::init()
     createEnvTexture();
     createUniformBuffer();
 
-    const uint32_t gradientId = ShaderManager::Instance().loadShaderFromFile("volumeGradient", "volumeRender/gradiant.comp", ShaderStage::eCompute,
-                                                                              ShaderType::eGLSL, "main");
-    const uint32_t genRayId   = ShaderManager::Instance().loadShaderFromFile("volumeRenderGenRay", "volumeRender/volumeGenRay.comp", ShaderStage::eCompute,
-                                                                            ShaderType::eGLSL, "main");
-    const uint32_t radianceId = ShaderManager::Instance().loadShaderFromFile("volumeRadiance", "volumeRender/volumeRadiance.comp", ShaderStage::eCompute,
-                                                                              ShaderType::eGLSL, "main");
-    const uint32_t accumulateId = ShaderManager::Instance().loadShaderFromFile("volumeAccumulate", "volumeRender/volumeAccumulate.comp",
-                                                                                ShaderStage::eCompute, ShaderType::eGLSL, "main");
-    const uint32_t postProcessId = ShaderManager::Instance().loadShaderFromFile("volumePostProcess", "volumeRender/volumePostProcess.comp",
-                                                                                 ShaderStage::eCompute, ShaderType::eGLSL, "main");
+    const std::vector<uint32_t> shaderIds = ShaderManager::Instance().loadShadersFromFiles({
+        {"volumeGradient", "volumeRender/gradiant.comp", ShaderStage::eCompute, ShaderType::eGLSL, "main"},
+        {"volumeRenderGenRay", "volumeRender/volumeGenRay.comp", ShaderStage::eCompute, ShaderType::eGLSL, "main"},
+        {"volumeRadiance", "volumeRender/volumeRadiance.comp", ShaderStage::eCompute, ShaderType::eGLSL, "main"},
+        {"volumeAccumulate", "volumeRender/volumeAccumulate.comp", ShaderStage::eCompute, ShaderType::eGLSL, "main"},
+        {"volumePostProcess", "volumeRender/volumePostProcess.comp", ShaderStage::eCompute, ShaderType::eGLSL, "main"},
+    });
+    const uint32_t gradientId    = shaderIds[0];
+    const uint32_t genRayId      = shaderIds[1];
+    const uint32_t radianceId    = shaderIds[2];
+    const uint32_t accumulateId  = shaderIds[3];
+    const uint32_t postProcessId = shaderIds[4];
 
     _gradientPipeline.setShader(gradientId);
     _generateRaysPipeline.setShader(genRayId);
@@ -218,12 +220,44 @@ void VolumeRenderPass::init()
     _accumulatePipeline.setShader(accumulateId);
     _postProcessPipeline.setShader(postProcessId);
 
+    const uint32_t frameCycleSize = vkDriver->getFrameCycleSize();
+    _sampleReadbackBuffer         = RefPtr<Buffer>(new Buffer("VolumeSampleReadback", VK_BUFFER_USAGE_2_TRANSFER_DST_BIT,
+                                                              sizeof(uint32_t) * 2 * frameCycleSize,
+                                                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+    _slotSkipMode.assign(frameCycleSize, -1);
+
     _lastParameters = _parameters;
     vkDriver->getEditorRegistry().registerWritable<VolumeRenderParameters>("Volume", _parameters, editor::EditorRenderMode::Volume);
+    vkDriver->getEditorRegistry().registerReadOnly<VolumeRenderStats>("Volume Stats", _stats, editor::EditorRenderMode::Volume);
+}
+
+void VolumeRenderPass::readSampleCounters(uint32_t frameSlot)
+{
+    if (_slotSkipMode[frameSlot] < 0)
+    {
+        return;
+    }
+    // the frame slot was fenced in prepareFrame, the copy recorded by its last use is complete
+    const uint32_t* counters   = reinterpret_cast<const uint32_t*>(_sampleReadbackBuffer->mapping) + frameSlot * 2;
+    const float     pixelCount = float(std::max(vkDriver->getViewportSize().width * vkDriver->getViewportSize().height, 1u));
+
+    _stats.GenRaySamplesPerPixel   = float(counters[0]) / pixelCount;
+    _stats.RadianceSamplesPerPixel = float(counters[1]) / pixelCount;
+    const float samplesPerPixel    = _stats.GenRaySamplesPerPixel + _stats.RadianceSamplesPerPixel;
+    if (_slotSkipMode[frameSlot] != 0)
+    {
+        _stats.SkippingSamplesPerPixel = samplesPerPixel;
+    }
+    else
+    {
+        _stats.FullMarchSamplesPerPixel = samplesPerPixel;
+    }
 }
 
 void VolumeRenderPass::build(RDG::RDGBuilder* rdgBuilder)
 {
+    std::fill(_slotSkipMode.begin(), _slotSkipMode.end(), -1);
+
     auto volumeTextureRef      = rdgBuilder->createTexture("VolumeTexture").Import(_textures[eVolumeTexture].get()).finish();
     auto gradientTextureRef    = rdgBuilder->createTexture("VolumeGradientTexture").Import(_textures[eGradientTexture].get()).finish();
     auto diffuseLookupRef      = rdgBuilder->createTexture("VolumeDiffuseLookupTexture").Import(_textures[eDiffuseLookUpTexture].get()).finish();
@@ -232,6 +266,13 @@ void VolumeRenderPass::build(RDG::RDGBuilder* rdgBuilder)
     auto opacityLookupRef      = rdgBuilder->createTexture("VolumeOpacityLookupTexture").Import(_textures[eOpacityLookUpTexture].get()).finish();
     auto envTextureRef         = rdgBuilder->createTexture("VolumeEnvTexture").Import(_textures[eEnvTexture].get()).finish();
     auto uniformBufferRef      = rdgBuilder->createBuffer("VolumeUniformBuffer").Import(_uniformBuffer.get()).finish();
+    auto majorantBufferRef     = rdgBuilder->createBuffer("VolumeBrickMajorants").Import(_majorantBuffer.get()).finish();
+    auto sampleCountersRef     = rdgBuilder->createBuffer("VolumeSampleCounters")
+                                 .Location(true)
+                                 .Range(VK_WHOLE_SIZE)
+                                 .Size(sizeof(uint32_t) * 2)
+                                 .UsageFlags(VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT)
+                                 .finish();
     auto diffuseRTRef          = rdgBuilder->createTexture("VolumeDiffuseRT")
                             .Extent({vkDriver->getViewportSize().width, vkDriver->getViewportSize().height, 1})
                             .AspectFlags(VK_IMAGE_ASPECT_COLOR_BIT)
@@ -311,9 +352,19 @@ void VolumeRenderPass::build(RDG::RDGBuilder* rdgBuilder)
         .storageWrite(8, specularRTRef, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
         .storageWrite(9, normalRTRef, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
         .storageWrite(10, depthRTRef, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+        .storageRead(11, majorantBufferRef, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+        .storageWrite(12, sampleCountersRef, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
         .execute(
-            [this](RDG::PassNode* passNode, RDG::RenderContext& context)
+            [this, sampleCountersRef](RDG::PassNode* passNode, RDG::RenderContext& context)
             {
+                readSampleCounters(vkDriver->getFrameCycleIndex());
+                vkCmdFillBuffer(context._currCmdBuffer, sampleCountersRef->getRHI()->buffer, 0, VK_WHOLE_SIZE, 0);
+                VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+                barrier.srcAccessMask   = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barrier.dstAccessMask   = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+                vkCmdPipelineBarrier(context._currCmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0,
+                                     NULL, 0, NULL);
+
                 context.bindPipeline(_generateRaysPipeline);
                 vkCmdDispatch(context._currCmdBuffer, divRoundUp(vkDriver->getViewportSize().width, kVolumeGroupSize),
                               divRoundUp(vkDriver->getViewportSize().height, kVolumeGroupSize), 1);
@@ -330,12 +381,29 @@ void VolumeRenderPass::build(RDG::RDGBuilder* rdgBuilder)
         .sampledRead(6, envTextureRef, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
         .read(7, uniformBufferRef, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
         .storageWrite(8, radianceRTRef, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+        .storageRead(9, majorantBufferRef, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+        .storageWrite(10, sampleCountersRef, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
         .execute(
-            [this](RDG::PassNode* passNode, RDG::RenderContext& context)
+            [this, sampleCountersRef](RDG::PassNode* passNode, RDG::RenderContext& context)
             {
                 context.bindPipeline(_radiancePipeline);
                 vkCmdDispatch(context._currCmdBuffer, divRoundUp(vkDriver->getViewportSize().width, kVolumeGroupSize),
                               divRoundUp(vkDriver->getViewportSize().height, kVolumeGroupSize), 1);
+
+                // snapshot the sample counters, read back when this frame slot comes around again
+                VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+                barrier.srcAccessMask   = VK_ACCESS_SHADER_WRITE_BIT;
+                barrier.dstAccessMask   = VK_ACCESS_TRANSFER_READ_BIT;
+                vkCmdPipelineBarrier(context._currCmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0,
+                                     NULL, 0, NULL);
+                const uint32_t frameSlot = vkDriver->getFrameCycleIndex();
+                VkBufferCopy   region    = {0, sizeof(uint32_t) * 2 * frameSlot, sizeof(uint32_t) * 2};
+                vkCmdCopyBuffer(context._currCmdBuffer, sampleCountersRef->getRHI()->buffer, _sampleReadbackBuffer->buffer, 1, &region);
+                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+                vkCmdPipelineBarrier(context._currCmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, NULL, 0,
+                                     NULL);
+                _slotSkipMode[frameSlot] = _parameters.EmptySpaceSkipping ? 1 : 0;
             })
         .finish();
 
@@ -401,6 +469,9 @@ void VolumeRenderPass::updateUniform()
     data.Density          = _parameters.Density;
     data.Exposure         = _parameters.Exposure;
     data.CameraPos        = cameraData.cameraPosition;
+    data.BrickScale       = _brickGrid.brickScale();
+    data.BrickCount       = _brickGrid.brickCount;
+    data.SkipEmptySpace   = _parameters.EmptySpaceSkipping && !_brickGrid.minIntensity.empty() ? 1u : 0u;
 
     memcpy(_uniformBuffer->mapping, &data, sizeof(VolumeUniformData));
     PlayResourceManager::Instance().flushBuffer(*_uniformBuffer, 0, VK_WHOLE_SIZE);
@@ -411,54 +482,88 @@ void VolumeRenderPass::resetFrameCount()
     _frameCount = 0;
 }
 
-void VolumeRenderPass::loadVolumeTexture()
+std::filesystem::path VolumeRenderPass::resolveVolumePath() const
 {
-    const std::filesystem::path volumePath = getBaseFilePath() / "content/volumeData/Textures/manix.dat";
-    const std::string           fileContents = nvutils::loadFile(volumePath);
-    if (fileContents.empty())
+    const std::string& requested = _ownedRenderer ? _ownedRenderer->getVolumeDataPath() : std::string();
+    if (requested.empty())
     {
-        LOGE("Failed to open volume data file: %s", nvutils::utf8FromPath(volumePath).c_str());
-        return;
+        return getBaseFilePath() / "content/volumeData/Textures/manix.dat";
     }
 
-    if (fileContents.size() < sizeof(uint16_t) * 3)
+    // "synthetic:<size>" writes a cubic test volume once and then loads it like any other dataset
+    constexpr std::string_view syntheticPrefix = "synthetic:";
+    if (requested.starts_with(syntheticPrefix))
     {
-        LOGE("Volume data file is missing dimensions: %s", nvutils::utf8FromPath(volumePath).c_str());
-        return;
+        uint32_t    size = 0;
+        const char* last = requested.data() + requested.size();
+        if (std::from_chars(requested.data() + syntheticPrefix.size(), last, size).ec != std::errc() || size == 0)
+        {
+            LOGE("Invalid synthetic volume size: %s\n", requested.c_str());
+            return {};
+        }
+        const std::filesystem::path path = getBaseFilePath() / ("content/volumeData/synthetic_" + std::to_string(size) + ".dat");
+        if (!std::filesystem::exists(path) && !writeSyntheticVolumeFile(path, size))
+        {
+            return {};
+        }
+        return path;
     }
 
-    uint16_t width  = readUint16(fileContents, 0);
-    uint16_t height = readUint16(fileContents, 1);
-    uint16_t depth  = readUint16(fileContents, 2);
-    _volumeExtent   = {width, height, depth};
-
-    const size_t voxelCount = size_t(_volumeExtent.width) * size_t(_volumeExtent.height) * size_t(_volumeExtent.depth);
-    if (fileContents.size() < sizeof(uint16_t) * (voxelCount + 3))
+    std::filesystem::path path = nvutils::pathFromUtf8(requested);
+    if (path.is_relative() && !std::filesystem::exists(path))
     {
-        LOGE("Volume data file is truncated: %s", nvutils::utf8FromPath(volumePath).c_str());
-        return;
+        path = getBaseFilePath() / path;
     }
-    std::vector<uint16_t> intensityData(voxelCount);
-    for (size_t index = 0; index < voxelCount; ++index)
+    return path;
+}
+
+void VolumeRenderPass::loadVolumeTexture()
+{
+    const auto                  loadStart  = std::chrono::steady_clock::now();
+    const std::filesystem::path volumePath = resolveVolumePath();
+    VolumeDataFile              volumeFile;
+    if (volumePath.empty() || !volumeFile.open(volumePath))
     {
-        intensityData[index] = readUint16(fileContents, index + 3);
+        return;
     }
-
-    const uint16_t tmin = 0 << 12;
-    const uint16_t tmax = 1 << 12;
-    for (uint16_t& intensity : intensityData)
+    const VolumeDataInfo& info = volumeFile.getInfo();
+    _volumeExtent              = {info.extent.x, info.extent.y, info.extent.z};
+    _brickGrid                 = createVolumeBrickGrid(info.extent, kVolumeBrickSize);
+
+    _textures[eVolumeTexture]             = RefPtr<Texture>(new Texture());
+    VkImageCreateInfo     volumeImageInfo = makeImageCreateInfo(VK_IMAGE_TYPE_3D, VK_FORMAT_R16_UNORM, _volumeExtent,
+                                                                VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+    VkImageViewCreateInfo volumeViewInfo  = makeImageViewCreateInfo(VK_IMAGE_VIEW_TYPE_3D, VK_FORMAT_R16_UNORM);
+    PlayResourceManager::Instance().createImage(*_textures[eVolumeTexture], volumeImageInfo, volumeViewInfo);
+
+    // the file stays mapped, only one batch of normalized slices and its staging copy are resident at a time
+    const size_t          sliceVoxels    = volumeFile.getSliceVoxelCount();
+    const size_t          sliceBytes     = sliceVoxels * sizeof(uint16_t);
+    const uint32_t        slicesPerBatch = uint32_t(std::clamp<size_t>(kVolumeUploadBatchBytes / sliceBytes, 1, _volumeExtent.depth));
+    std::vector<uint16_t> sliceBatch(sliceVoxels * slicesPerBatch);
+    for (uint32_t firstSlice = 0; firstSlice < _volumeExtent.depth; firstSlice += slicesPerBatch)
     {
-        intensity = static_cast<uint16_t>(65535.0f * ((intensity - tmin) / static_cast<float>(tmax - tmin)) + 0.5f);
+        const uint32_t sliceCount = std::min(slicesPerBatch, _volumeExtent.depth - firstSlice);
+        const size_t   batchBytes = sliceBytes * sliceCount;
+        volumeFile.normalizeSlices(firstSlice, sliceCount, sliceBatch.data());
+        accumulateVolumeBrickSlices(_brickGrid, std::span(sliceBatch.data(), sliceVoxels * sliceCount), firstSlice);
+
+        auto cmd = PlayResourceManager::Instance().getTempCommandBuffer();
+        PlayResourceManager::Instance().appendImageSub(*_textures[eVolumeTexture], {0, 0, int32_t(firstSlice)},
+                                                       {_volumeExtent.width, _volumeExtent.height, sliceCount}, {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+                                                       batchBytes, sliceBatch.data(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        PlayResourceManager::Instance().cmdUploadAppended(cmd);
+        PlayResourceManager::Instance().submitAndWaitTempCmdBuffer(cmd);
+        PlayResourceManager::Instance().releaseStaging(true);
     }
-
-    _textures[eVolumeTexture] = RefPtr<Texture>(new Texture());
-    VkImageCreateInfo volumeImageInfo = makeImageCreateInfo(VK_IMAGE_TYPE_3D, VK_FORMAT_R16_UNORM, _volumeExtent,
-                                                             VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
-    VkImageViewCreateInfo volumeViewInfo = makeImageViewCreateInfo(VK_IMAGE_VIEW_TYPE_3D, VK_FORMAT_R16_UNORM);
-    uploadTexture(*_textures[eVolumeTexture], intensityData.data(), intensityData.size() * sizeof(uint16_t), volumeImageInfo, volumeViewInfo,
-                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    describeTexture(*_textures[eVolumeTexture], volumeImageInfo, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
     _textures[eVolumeTexture]->DebugName() = "VolumeTexture";
 
+    _stats.VolumeLoadMs        = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+    _stats.VolumeLoadPeakRssMB = float(double(getPeakResidentBytes()) / (1024.0 * 1024.0));
+    LOGI("Loaded volume %s (%ux%ux%u) in %.1f ms, peak rss %.1f MB\n", nvutils::utf8FromPath(volumePath).c_str(), _volumeExtent.width,
+         _volumeExtent.height, _volumeExtent.depth, _stats.VolumeLoadMs, _stats.VolumeLoadPeakRssMB);
+
     _textures[eGradientTexture] = RefPtr<Texture>(new Texture(_volumeExtent.width, _volumeExtent.height, _volumeExtent.depth,
                                                               VK_FORMAT_R16G16B16A16_SFLOAT,
                                                               VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
@@ -525,6 +630,30 @@ void VolumeRenderPass::createTransferFunctionTextures()
     uploadTexture(*_textures[eOpacityLookUpTexture], opacityData.data(), opacityData.size() * sizeof(uint8_t), scalarLookupImageInfo,
                   scalarLookupViewInfo, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
     _textures[eOpacityLookUpTexture]->DebugName() = "VolumeOpacityLookupTexture";
+
+    _opacityLookup = opacityData;
+    rebuildMajorantGrid();
+}
+
+void VolumeRenderPass::rebuildMajorantGrid()
+{
+    const std::vector<float> majorants = buildVolumeMajorantGrid(_brickGrid, _opacityLookup);
+    const VkDeviceSize       size      = sizeof(float) * std::max<size_t>(majorants.size(), 1);
+    if (!_majorantBuffer || _majorantBuffer->bufferSize < size)
+    {
+        _majorantBuffer = RefPtr<Buffer>(new Buffer("VolumeBrickMajorants", VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT, size,
+                                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+    }
+    else
+    {
+        // the graph imports this buffer, rewrite it in place once no frame in flight reads the old majorants
+        vkDeviceWaitIdle(vkDriver->getDevice());
+    }
+    memset(_majorantBuffer->mapping, 0, size);
+    memcpy(_majorantBuffer->mapping, majorants.data(), sizeof(float) * majorants.size());
+    _stats.EmptyBrickRatio = computeEmptyBrickRatio(majorants);
+    LOGI("Volume brick grid %ux%ux%u, %.1f%% of the bricks are empty under the opacity transfer function\n", _brickGrid.brickCount.x,
+         _brickGrid.brickCount.y, _brickGrid.brickCount.z, _stats.EmptyBrickRatio * 100.0f);
 }
 
 void VolumeRenderPass::createEnvTexture()
@@ -548,7 +677,11 @@ void VolumeRenderPass::uploadTexture(Texture& texture, const void* data, VkDevic
     PlayResourceManager::Instance().appendImage(texture, dataSize, data, finalLayout);
     PlayResourceManager::Instance().cmdUploadAppended(cmd);
     PlayResourceManager::Instance().submitAndWaitTempCmdBuffer(cmd);
+    describeTexture(texture, imageInfo, finalLayout);
+}
 
+void VolumeRenderPass::describeTexture(Texture& texture, const VkImageCreateInfo& imageInfo, VkImageLayout finalLayout)
+{
     texture.Layout()      = finalLayout;
     texture.Format()      = imageInfo.format;
     texture.Type()        = imageInfo.imageType;
@@ -1,11 +1,13 @@
 #ifndef VOLUME_RENDER_PASS_H
 #define VOLUME_RENDER_PASS_H
 
+#include <filesystem>
 #include <glm/glm.hpp>
 #include <vulkan/vulkan_core.h>
 #include "RenderPass.h"
 #include "core/RefCounted.h"
 #include "PipelineCacheManager.h"
+#include "VolumeBrickGrid.h"
 
 namespace Play
 {
@@ -20,6 +22,20 @@ struct VolumeRenderParameters
     uint32_t  StepCount = 180;
     glm::vec3 BBoxMin   = glm::vec3(-0.5f, -0.5f, -0.65f);
     glm::vec3 BBoxMax   = glm::vec3(0.5f, 0.5f, 0.65f);
+    // skips bricks the opacity transfer function makes fully transparent, the image does not change
+    bool EmptySpaceSkipping = true;
+};
+
+struct VolumeRenderStats
+{
+    float EmptyBrickRatio         = 0.0f;
+    float GenRaySamplesPerPixel   = 0.0f;
+    float RadianceSamplesPerPixel = 0.0f;
+    // total samples per pixel of the last frame rendered with and without skipping
+    float FullMarchSamplesPerPixel = 0.0f;
+    float SkippingSamplesPerPixel  = 0.0f;
+    float VolumeLoadMs             = 0.0f;
+    float VolumeLoadPeakRssMB      = 0.0f;
 };
 
 struct VolumeUniformData
@@ -44,6 +60,10 @@ struct VolumeUniformData
     glm::vec3 CameraPos;
     glm::vec3 BBoxMin;
     glm::vec3 BBoxMax;
+
+    glm::vec3  BrickScale;
+    glm::uvec3 BrickCount;
+    uint32_t   SkipEmptySpace;
 };
 
 class VolumeRenderPass : public BasePass
@@ -79,9 +99,14 @@ private:
     void createUniformBuffer();
     void uploadTexture(Texture& texture, const void* data, VkDeviceSize dataSize, VkImageCreateInfo imageInfo, VkImageViewCreateInfo viewInfo,
                        VkImageLayout finalLayout);
+    void describeTexture(Texture& texture, const VkImageCreateInfo& imageInfo, VkImageLayout finalLayout);
     void acquireLinearSampler(Texture& texture);
+    void rebuildMajorantGrid();
+    void readSampleCounters(uint32_t frameSlot);
     bool parametersChanged() const;
 
+    std::filesystem::path resolveVolumePath() const;
+
     VolumeRenderer* _ownedRenderer = nullptr;
 
     ComputePipelineStateInitializer _gradientPipeline;
@@ -94,6 +119,14 @@ private:
     RefPtr<Buffer>  _uniformBuffer;
     VkExtent3D      _volumeExtent = {1, 1, 1};
 
+    // brick min/max is fixed after load, the majorants follow the opacity transfer function
+    VolumeBrickGrid      _brickGrid;
+    std::vector<uint8_t> _opacityLookup;
+    RefPtr<Buffer>       _majorantBuffer;
+    RefPtr<Buffer>       _sampleReadbackBuffer;
+    std::vector<int8_t>  _slotSkipMode; // skipping state of the counters recorded in each frame slot, -1 when none
+    VolumeRenderStats    _stats;
+
     VolumeRenderParameters         _parameters;
     mutable VolumeRenderParameters _lastParameters;
     glm::mat4                      _lastViewMatrix    = glm::mat4(0.0f);
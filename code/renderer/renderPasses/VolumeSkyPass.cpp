@@ -5,6 +5,14 @@
 #include "DeferRendering.h"
 #include "editor/EditorRegistry.h"
 #include "PConstantType.h.slang"
+#include "PlayAllocator.h"
+#include "utils.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include <nvutils/file_operations.hpp>
+#include <nvutils/logger.hpp>
 
 namespace
 {
@@ -16,6 +24,62 @@ constexpr uint32_t         kMultiScatteringLutHeight  = 32;
 constexpr uint32_t         kSkyViewLutWidth           = 192;
 constexpr uint32_t         kSkyViewLutHeight          = 108;
 constexpr uint32_t         kSkyViewGroupSize          = 8;
+constexpr VkDeviceSize     kLutTexelBytes             = 8; // R16G16B16A16_SFLOAT
+constexpr VkDeviceSize     kTransmittanceLutBytes     = kTransmittanceLutWidth * kTransmittanceLutHeight * kLutTexelBytes;
+constexpr VkDeviceSize     kMultiScatteringLutBytes   = kMultiScatteringLutWidth * kMultiScatteringLutHeight * kLutTexelBytes;
+constexpr uint32_t         kLutCacheMagic             = 0x54554C41; // "ALUT"
+constexpr uint32_t         kLutCacheVersion           = 1;
+
+struct LutCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t atmosphereHash;
+    uint32_t transmittanceExtent[2];
+    uint32_t multiScatteringExtent[2];
+};
+
+std::filesystem::path getLutCachePath(uint64_t atmosphereHash)
+{
+    char fileName[32];
+    std::snprintf(fileName, sizeof(fileName), "%016llx.lut", static_cast<unsigned long long>(atmosphereHash));
+    return getBaseFilePath() / "cache/atmosphere" / fileName;
+}
+
+void cmdCopyLutToBuffer(VkCommandBuffer cmd, Play::Texture& lut, uint32_t width, uint32_t height, VkBuffer buffer, VkDeviceSize offset)
+{
+    const VkImageLayout   layout = lut.descriptor.imageLayout;
+    VkImageMemoryBarrier2 imageBarrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+    imageBarrier.image               = lut.image;
+    imageBarrier.oldLayout           = layout;
+    imageBarrier.newLayout           = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    imageBarrier.srcAccessMask       = VK_ACCESS_2_MEMORY_WRITE_BIT;
+    imageBarrier.dstAccessMask       = VK_ACCESS_2_TRANSFER_READ_BIT;
+    imageBarrier.srcStageMask        = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    imageBarrier.dstStageMask        = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.subresourceRange    = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    VkDependencyInfo info{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    info.imageMemoryBarrierCount = 1;
+    info.pImageMemoryBarriers    = &imageBarrier;
+    vkCmdPipelineBarrier2(cmd, &info);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset     = offset;
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent      = {width, height, 1};
+    vkCmdCopyImageToBuffer(cmd, lut.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
+
+    // back to the layout the render graph tracks for the lut
+    imageBarrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    imageBarrier.newLayout     = layout;
+    imageBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+    imageBarrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+    imageBarrier.srcStageMask  = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+    imageBarrier.dstStageMask  = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    vkCmdPipelineBarrier2(cmd, &info);
+}
 } // namespace
 
 namespace Play
@@ -26,14 +90,16 @@ VolumeSkyPass::~VolumeSkyPass() = default;
 void VolumeSkyPass::init()
 {
     auto skyBoxvId = ShaderManager::Instance().getShaderIdByName(BuiltinShaders::BUILTIN_FULL_SCREEN_QUAD_VERT_SHADER_NAME);
-    auto skyBoxfId = ShaderManager::Instance().loadShaderFromFile("skyBoxFragment", "newShaders/deferRenderer/atmosphere/skyBoxProgram.frag.slang",
-                                                                  ShaderStage::eFragment);
-    auto transmittanceComp = ShaderManager::Instance().loadShaderFromFile(
-        "transmittanceLutComp", "newShaders/deferRenderer/atmosphere/transmittanceLut.comp.slang", ShaderStage::eCompute);
-    auto multiScatteringComp = ShaderManager::Instance().loadShaderFromFile(
-        "multiScatteringLutComp", "newShaders/deferRenderer/atmosphere/multiScatteringLut.comp.slang", ShaderStage::eCompute);
-    auto skyViewComp = ShaderManager::Instance().loadShaderFromFile("skyViewLutComp", "newShaders/deferRenderer/atmosphere/skyViewLut.comp.slang",
-                                                                    ShaderStage::eCompute);
+    const std::vector<uint32_t> shaderIds = ShaderManager::Instance().loadShadersFromFiles({
+        {"skyBoxFragment", "newShaders/deferRenderer/atmosphere/skyBoxProgram.frag.slang", ShaderStage::eFragment},
+        {"transmittanceLutComp", "newShaders/deferRenderer/atmosphere/transmittanceLut.comp.slang", ShaderStage::eCompute},
+        {"multiScatteringLutComp", "newShaders/deferRenderer/atmosphere/multiScatteringLut.comp.slang", ShaderStage::eCompute},
+        {"skyViewLutComp", "newShaders/deferRenderer/atmosphere/skyViewLut.comp.slang", ShaderStage::eCompute},
+    });
+    auto skyBoxfId           = shaderIds[0];
+    auto transmittanceComp   = shaderIds[1];
+    auto multiScatteringComp = shaderIds[2];
+    auto skyViewComp         = shaderIds[3];
 
     _transmittanceLutPipeline.setShader(transmittanceComp);
     _transmittanceLutPipeline.setPushConstant<PerFrameConstant>();
@@ -60,19 +126,126 @@ void VolumeSkyPass::init()
     _skyViewLut                      = RefPtr<Texture>(new Texture(kSkyViewLutWidth, kSkyViewLutHeight, VK_FORMAT_R16G16B16A16_SFLOAT,
                                                                    VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_GENERAL));
     _skyViewLut->DebugName()         = "SkyViewLut";
+    _lutReadback                     = RefPtr<Buffer>(new Buffer("AtmosphereLutReadback", VK_BUFFER_USAGE_2_TRANSFER_DST_BIT,
+                                                                 kTransmittanceLutBytes + kMultiScatteringLutBytes,
+                                                                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
 
     _skyAtmosControler.flushToGPU();
     vkDriver->getEditorRegistry().registerWritable<AtmosphereParameters>("Atmosphere", _skyAtmosControler, editor::EditorRenderMode::Defer);
+    vkDriver->getEditorRegistry().registerWritable<AtmosphereLutSettings>("Atmosphere LUT", _lutSettings, editor::EditorRenderMode::Defer);
+    vkDriver->getEditorRegistry().registerReadOnly<AtmosphereLutStats>("Atmosphere LUT Stats", _lutStats, editor::EditorRenderMode::Defer);
+
+    const uint64_t atmosphereHash = hashAtmosphereMedium(_skyAtmosControler.getCPUHandle());
+    if (_lutSettings.PersistLuts && loadPersistedLuts(atmosphereHash))
+    {
+        _lutTracker.markMediumBaked(atmosphereHash);
+        _lutStats.LoadedFromDisk = true;
+    }
+}
+
+void VolumeSkyPass::refreshLutState()
+{
+    const AtmosphereParameters& atmosphere = _skyAtmosControler.getCPUHandle();
+    // same altitude the sky-view shader derives from the camera position
+    const glm::vec3 cameraPosition = _ownedRender->getCurrentCameraData().cameraPosition;
+    const float     viewHeight     = glm::length(cameraPosition + glm::vec3(0.0f, atmosphere.BottomRadius, 0.0f));
+
+    _lutTracker.update(atmosphere, viewHeight, _lutSettings);
+    const uint64_t atmosphereHash = _lutTracker.getMediumHash();
+    if (_lutTracker.bakeAtmosphereLuts())
+    {
+        // wait until the parameters settle, dragging a slider would otherwise write a file every frame
+        _persistCountdown = _lutSettings.PersistLuts ? vkDriver->getFrameCycleSize() + 1 : 0;
+    }
+    else if (_persistCountdown > 0 && --_persistCountdown == 0)
+    {
+        std::error_code error;
+        _persistCopy = !std::filesystem::exists(getLutCachePath(atmosphereHash), error);
+        _persistHash = atmosphereHash;
+    }
+    _persistCopy = _persistCopy && !_lutTracker.bakeAtmosphereLuts();
+}
+
+void VolumeSkyPass::update()
+{
+    if (_persistCycle == vkDriver->getFrameCycleIndex())
+    {
+        persistLuts();
+        _persistCycle = ~0U;
+    }
+
+    if (_rdgBuilder)
+    {
+        const std::vector<RDG::PassNode*>& skipped = _rdgBuilder->getSkippedPasses();
+        _lutStats.SkippedLutPasses                 = static_cast<uint32_t>(std::count_if(
+            skipped.begin(), skipped.end(),
+            [this](RDG::PassNode* pass) { return std::find(std::begin(_lutPasses), std::end(_lutPasses), pass) != std::end(_lutPasses); }));
+    }
+    refreshLutState();
+}
+
+bool VolumeSkyPass::loadPersistedLuts(uint64_t atmosphereHash)
+{
+    const std::filesystem::path path = getLutCachePath(atmosphereHash);
+    std::ifstream               file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    LutCacheHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    std::vector<uint8_t> texels(kTransmittanceLutBytes + kMultiScatteringLutBytes);
+    file.read(reinterpret_cast<char*>(texels.data()), std::streamsize(texels.size()));
+    if (!file || header.magic != kLutCacheMagic || header.version != kLutCacheVersion || header.atmosphereHash != atmosphereHash ||
+        header.transmittanceExtent[0] != kTransmittanceLutWidth || header.transmittanceExtent[1] != kTransmittanceLutHeight ||
+        header.multiScatteringExtent[0] != kMultiScatteringLutWidth || header.multiScatteringExtent[1] != kMultiScatteringLutHeight)
+    {
+        LOGW("Ignoring stale atmosphere lut cache: %s\n", nvutils::utf8FromPath(path).c_str());
+        return false;
+    }
+
+    auto cmd = PlayResourceManager::Instance().getTempCommandBuffer();
+    PlayResourceManager::Instance().appendImage(*_transmittanceLut, kTransmittanceLutBytes, texels.data(), _transmittanceLut->descriptor.imageLayout);
+    PlayResourceManager::Instance().appendImage(*_multiScatteringLut, kMultiScatteringLutBytes, texels.data() + kTransmittanceLutBytes,
+                                                _multiScatteringLut->descriptor.imageLayout);
+    PlayResourceManager::Instance().cmdUploadAppended(cmd);
+    PlayResourceManager::Instance().submitAndWaitTempCmdBuffer(cmd);
+    PlayResourceManager::Instance().releaseStaging(true);
+    LOGI("Loaded atmosphere luts from %s\n", nvutils::utf8FromPath(path).c_str());
+    return true;
+}
+
+void VolumeSkyPass::persistLuts()
+{
+    const std::filesystem::path path = getLutCachePath(_persistHash);
+    std::error_code             error;
+    std::filesystem::create_directories(path.parent_path(), error);
+
+    // the frame slot was fenced in prepareFrame, the copy recorded by its last use is complete
+    const LutCacheHeader header{kLutCacheMagic,
+                                kLutCacheVersion,
+                                _persistHash,
+                                {kTransmittanceLutWidth, kTransmittanceLutHeight},
+                                {kMultiScatteringLutWidth, kMultiScatteringLutHeight}};
+    std::ofstream        file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(static_cast<const char*>(_lutReadback->mapping), std::streamsize(kTransmittanceLutBytes + kMultiScatteringLutBytes));
+    if (!file)
+    {
+        LOGW("Failed to write atmosphere lut cache: %s\n", nvutils::utf8FromPath(path).c_str());
+    }
 }
 
 void VolumeSkyPass::build(RDG::RDGBuilder* rdgBuilder)
 {
     DeferRenderer* ownedRender           = static_cast<DeferRenderer*>(_ownedRender);
+    VkExtent2D     renderExtent          = ownedRender->getRenderExtent();
     auto           transmittanceLutRef   = rdgBuilder->createTexture("TransmittanceLut").Import(_transmittanceLut.get()).finish();
     auto           multiScatteringLutRef = rdgBuilder->createTexture("MultiScatteringLut").Import(_multiScatteringLut.get()).finish();
     auto           skyViewLutRef         = rdgBuilder->createTexture("SkyViewLut").Import(_skyViewLut.get()).finish();
     auto           SkyBoxRT              = rdgBuilder->createTexture("SkyBoxRT")
-                        .Extent({vkDriver->getViewportSize().width, vkDriver->getViewportSize().height, 1})
+                        .Extent({renderExtent.width, renderExtent.height, 1})
                         .AspectFlags(VK_IMAGE_ASPECT_COLOR_BIT)
                         .Format(VK_FORMAT_R16G16B16A16_SFLOAT)
                         .UsageFlags(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)
@@ -84,9 +257,11 @@ void VolumeSkyPass::build(RDG::RDGBuilder* rdgBuilder)
         rdgBuilder->createComputePass("TransmittanceLutPass")
             .storageWrite(0, transmittanceLutRef, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
             .read(1, atmosBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .skipIf([this]() { return !_lutTracker.bakeAtmosphereLuts(); })
             .execute(
                 [this, ownedRender](RDG::PassNode* passNode, RDG::RenderContext& context)
                 {
+                    ++_lutStats.TransmittanceDispatches;
                     PerFrameConstant perFrameConstant{};
                     perFrameConstant.cameraBufferDeviceAddress = ownedRender->getCurrentCameraBuffer()->address;
                     context.bindPipeline(_transmittanceLutPipeline);
@@ -101,9 +276,11 @@ void VolumeSkyPass::build(RDG::RDGBuilder* rdgBuilder)
             .storageWrite(0, multiScatteringLutRef, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
             .read(1, transmittanceLutRef, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
             .read(2, atmosBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .skipIf([this]() { return !_lutTracker.bakeAtmosphereLuts(); })
             .execute(
                 [this, ownedRender](RDG::PassNode* passNode, RDG::RenderContext& context)
                 {
+                    ++_lutStats.MultiScatteringDispatches;
                     PerFrameConstant perFrameConstant{};
                     perFrameConstant.cameraBufferDeviceAddress = ownedRender->getCurrentCameraBuffer()->address;
                     context.bindPipeline(_multiScatteringLutPipeline);
@@ -118,9 +295,11 @@ void VolumeSkyPass::build(RDG::RDGBuilder* rdgBuilder)
             .read(1, transmittanceLutRef, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
             .read(2, multiScatteringLutRef, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
             .read(3, atmosBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+            .skipIf([this]() { return !_lutTracker.bakeSkyViewLut(); })
             .execute(
                 [this, ownedRender](RDG::PassNode* passNode, RDG::RenderContext& context)
                 {
+                    ++_lutStats.SkyViewDispatches;
                     PerFrameConstant perFrameConstant{};
                     perFrameConstant.cameraBufferDeviceAddress = ownedRender->getCurrentCameraBuffer()->address;
                     context.bindPipeline(_skyViewLutPipeline);
@@ -130,6 +309,32 @@ void VolumeSkyPass::build(RDG::RDGBuilder* rdgBuilder)
                 })
             .finish();
 
+    // the luts were baked at least a full frame cycle ago, the copy is read once this frame slot was fenced again
+    [[maybe_unused]] auto lutReadbackPass = rdgBuilder->createComputePass("AtmosphereLutReadbackPass")
+                                                .skipIf([this]() { return !_persistCopy; })
+                                                .execute(
+                                                    [this](RDG::PassNode* passNode, RDG::RenderContext& context)
+                                                    {
+                                                        VkCommandBuffer cmd = context._currCmdBuffer;
+                                                        cmdCopyLutToBuffer(cmd, *_transmittanceLut, kTransmittanceLutWidth, kTransmittanceLutHeight,
+                                                                           _lutReadback->buffer, 0);
+                                                        cmdCopyLutToBuffer(cmd, *_multiScatteringLut, kMultiScatteringLutWidth,
+                                                                           kMultiScatteringLutHeight, _lutReadback->buffer, kTransmittanceLutBytes);
+                                                        VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+                                                        barrier.srcAccessMask   = VK_ACCESS_TRANSFER_WRITE_BIT;
+                                                        barrier.dstAccessMask   = VK_ACCESS_HOST_READ_BIT;
+                                                        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1,
+                                                                             &barrier, 0, NULL, 0, NULL);
+                                                        _persistCopy  = false;
+                                                        _persistCycle = vkDriver->getFrameCycleIndex();
+                                                    })
+                                                .finish();
+
+    _rdgBuilder   = rdgBuilder;
+    _lutPasses[0] = transmisstanceLutPass;
+    _lutPasses[1] = multiScatteringLutPass;
+    _lutPasses[2] = skyViewLutPass;
+
     auto skyBoxPass =
         rdgBuilder->createRenderPass("skyBoxPass")
             .color(0, SkyBoxRT, VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
@@ -137,15 +342,15 @@ void VolumeSkyPass::build(RDG::RDGBuilder* rdgBuilder)
             .read(0, skyViewLutRef, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT)
             .read(1, atmosBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT)
             .execute(
-                [this, ownedRender](RDG::PassNode* passNode, RDG::RenderContext& context)
+                [this, ownedRender, renderExtent](RDG::PassNode* passNode, RDG::RenderContext& context)
                 {
                     VkCommandBuffer  cmd              = context._currCmdBuffer;
                     PerFrameConstant perFrameConstant{};
                     perFrameConstant.cameraBufferDeviceAddress = ownedRender->getCurrentCameraBuffer()->address;
                     context.bindPipeline(this->_skyBoxPipeline);
                     context.bindPushConstant(perFrameConstant);
-                    VkViewport viewport = {0, 0, (float) vkDriver->getViewportSize().width, (float) vkDriver->getViewportSize().height, 0.0f, 1.0f};
-                    VkRect2D   scissor  = {{0, 0}, {vkDriver->getViewportSize().width, vkDriver->getViewportSize().height}};
+                    VkViewport viewport = {0, 0, (float) renderExtent.width, (float) renderExtent.height, 0.0f, 1.0f};
+                    VkRect2D   scissor  = {{0, 0}, renderExtent};
                     vkCmdSetViewportWithCount(cmd, 1, &viewport);
                     vkCmdSetScissorWithCount(cmd, 1, &scissor);
                     vkCmdDraw(cmd, 3, 1, 0, 0);
@@ -7,41 +7,23 @@
 #include "controlComponent/controlComponent.h"
 #include <glm/glm.hpp>
 #include "Hdevice.h"
+#include "AtmosphereLutCache.h"
 #include <rttr/rttr_enable.h>
-// Keep explicit padding so the CPU-side layout matches the shader constant-buffer packing.
-struct AtmosphereParameters
+namespace Play
 {
-    float BottomRadius            DEFAULT(6360.0f);
-    float TopRadius               DEFAULT(6460.0f);
-    float RayleighDensityExpScale DEFAULT(-0.125);
-
-    float3 RayleighScattering DEFAULT(float3(0.005802f, 0.013558f, 0.033100f));
-    float MieDensityExpScale  DEFAULT(-0.8333333);
-
-    float3 MieScattering DEFAULT(float3(0.003996, 0.003996, 0.003996));
-
-    float3 MieExtinction DEFAULT(float3(0.004440, 0.004440, 0.004440));
-
-    float3 MieAbsorption DEFAULT(float3(0.000444, 0.000444, 0.000444));
-    float MiePhaseG      DEFAULT(0.8f);
-
-    float AbsorptionDensity0LayerWidth   DEFAULT(25.0f);
-    float AbsorptionDensity0ConstantTerm DEFAULT(-2.0f / 3.0f);
-    float AbsorptionDensity0LinearTerm   DEFAULT(1.0f / 15.0f);
-    float AbsorptionDensity1ConstantTerm DEFAULT(8.0f / 3.0f);
-
-    float AbsorptionDensity1LinearTerm DEFAULT(-1.0f / 15.0f);
-    float3 AbsorptionExtinction        DEFAULT(float3(0.000650, 0.001881, 0.000085));
-
-    float3 GroundAlbedo DEFAULT(float3(0.0f, 0.0f, 0.0f));
+namespace RDG
+{
+class PassNode;
+}
 
-    float2 sun_dir           DEFAULT(float2(0.0f, 0.45f));
-    float3 solar_irradiance  DEFAULT(float3(1.0f));
-    float sun_angular_radius DEFAULT(0.004675);
-    float mu_s_min           DEFAULT(-0.5);
-};
-namespace Play
+struct AtmosphereLutStats
 {
+    uint32_t TransmittanceDispatches   = 0;
+    uint32_t MultiScatteringDispatches = 0;
+    uint32_t SkyViewDispatches         = 0;
+    uint32_t SkippedLutPasses          = 0; // lut passes the render graph skipped in the last frame
+    bool     LoadedFromDisk            = false;
+};
 
 class DeferRenderer;
 class VolumeSkyPass : public BasePass
@@ -52,10 +34,17 @@ public:
     virtual ~VolumeSkyPass() override;
     virtual void init() override;
     virtual void build(RDG::RDGBuilder* rdgBuilder) override;
+    virtual void update() override;
 
     RTTR_ENABLE(BasePass)
 
 private:
+    // asks the lut tracker what to bake this frame and schedules persisting the medium luts once they settled
+    void refreshLutState();
+    bool loadPersistedLuts(uint64_t atmosphereHash);
+    // writes the luts the readback holds, once the frame that copied them was fenced
+    void persistLuts();
+
     struct AtmosControler : public ControlComponent<AtmosphereParameters>
     {
         RTTR_ENABLE(ControlComponent<AtmosphereParameters>)
@@ -70,6 +59,18 @@ private:
     RefPtr<Texture> _transmittanceLut;
     RefPtr<Texture> _multiScatteringLut;
     RefPtr<Texture> _skyViewLut;
+
+    AtmosphereLutSettings _lutSettings;
+    AtmosphereLutStats    _lutStats;
+    AtmosphereLutTracker  _lutTracker;
+    uint32_t              _persistCountdown = 0;     // frames until the last atmosphere bake has surely retired
+    bool                  _persistCopy      = false; // the frame copies the luts to the readback
+    uint32_t              _persistCycle     = ~0U;   // frame cycle that copied them, ~0 while no copy is in flight
+    uint64_t              _persistHash      = 0;
+    RefPtr<Buffer>        _lutReadback;
+
+    RDG::RDGBuilder* _rdgBuilder   = nullptr;
+    RDG::PassNode*   _lutPasses[3] = {};
 };
 
 } // namespace Play
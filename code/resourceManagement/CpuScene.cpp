@@ -72,19 +72,16 @@ ModelLoadRequestID CpuModelComponent::requestLoadFromFile(CpuScene& scene, Asset
     return request;
 }
 
-ComponentStore::~ComponentStore()
-{
-    clear();
-}
-
 void ComponentStore::clear()
 {
-    for (PoolEntry& entry : _pools)
+    // model loads still in flight name their components by id, a cleared scene must not hand those ids out again
+    for (std::unique_ptr<IComponentPool>& pool : _pools)
     {
-        delete entry.pool;
-        entry.pool = nullptr;
+        if (pool)
+        {
+            pool->clear();
+        }
     }
-    _pools.clear();
 }
 
 void ComponentStore::remove(CpuSceneComponentID componentID)
@@ -123,30 +120,6 @@ uint32_t ComponentStore::allocateComponentTypeID()
     return nextTypeID++;
 }
 
-ComponentStore::IComponentPool* ComponentStore::findPool(uint32_t typeID)
-{
-    for (PoolEntry& entry : _pools)
-    {
-        if (entry.typeID == typeID)
-        {
-            return entry.pool;
-        }
-    }
-    return nullptr;
-}
-
-const ComponentStore::IComponentPool* ComponentStore::findPool(uint32_t typeID) const
-{
-    for (const PoolEntry& entry : _pools)
-    {
-        if (entry.typeID == typeID)
-        {
-            return entry.pool;
-        }
-    }
-    return nullptr;
-}
-
 CpuScene::CpuScene()
 {
     clear();
@@ -161,9 +134,11 @@ void CpuScene::clear()
     rootNode.name       = "Scene";
     rootNode.generation = 1;
     _nodes.push_back(rootNode);
+    _movedNodes.clear();
     _rootNode       = makeNodeID(0);
     _revision       = 1;
     _transformDirty = true;
+    ++_componentRevision;
 }
 
 CpuSceneNodeID CpuScene::create2DNode(const std::string& name, CpuSceneNodeID parent)
@@ -370,10 +345,46 @@ bool CpuScene::removeNode(CpuSceneNodeID nodeID)
     }
 
     removeNodeRecursive(nodeID);
-    markDirty();
+    markComponentsDirty();
     return true;
 }
 
+void CpuScene::replaceNodes(std::vector<CpuSceneNode> nodes)
+{
+    if (nodes.empty())
+    {
+        clear();
+        return;
+    }
+
+    _nodes = std::move(nodes);
+    _freeNodeSlots.clear();
+    _components.clear();
+    for (uint32_t nodeIndex = 0; nodeIndex < _nodes.size(); ++nodeIndex)
+    {
+        CpuSceneNode&  node   = _nodes[nodeIndex];
+        const uint32_t parent = nodeIndex > 0 ? node.parent.index : INVALID_SCENE_ID;
+        node.components.clear();
+        node.generation          = 1;
+        node.alive               = true;
+        node.worldTransformDirty = true;
+        node.worldTransformMoved = false;
+        node.parent              = {};
+        node.firstChild          = {};
+        node.nextSibling         = {};
+        if (parent < nodeIndex)
+        {
+            CpuSceneNode& parentNode = _nodes[parent];
+            node.parent              = {parent, 1};
+            node.nextSibling         = parentNode.firstChild;
+            parentNode.firstChild    = {nodeIndex, 1};
+        }
+    }
+    _movedNodes.clear();
+    _rootNode = makeNodeID(0);
+    markComponentsDirty();
+}
+
 void CpuScene::updateWorldTransforms()
 {
     if (!_transformDirty)
@@ -387,7 +398,17 @@ void CpuScene::updateWorldTransforms()
 
 void CpuScene::notifyComponentChanged()
 {
-    markDirty();
+    markComponentsDirty();
+}
+
+void CpuScene::takeMovedNodes(std::vector<uint32_t>& nodeIndices)
+{
+    nodeIndices.clear();
+    nodeIndices.swap(_movedNodes);
+    for (uint32_t nodeIndex : nodeIndices)
+    {
+        _nodes[nodeIndex].worldTransformMoved = false;
+    }
 }
 
 CpuSceneNodeID CpuScene::makeNodeID(uint32_t index) const
@@ -521,6 +542,11 @@ void CpuScene::updateWorldRecursive(CpuSceneNodeID nodeID, const glm::mat4& pare
     node->worldTransform = parentTransform * node->localTransform;
     const bool visible   = parentVisible && node->visible;
     node->worldVisible   = visible;
+    if (node->worldTransformDirty && !node->worldTransformMoved)
+    {
+        node->worldTransformMoved = true;
+        _movedNodes.push_back(nodeID.index);
+    }
     node->worldTransformDirty = false;
 
     CpuSceneNodeID childID = node->firstChild;
@@ -538,4 +564,10 @@ void CpuScene::markDirty()
     ++_revision;
 }
 
+void CpuScene::markComponentsDirty()
+{
+    markDirty();
+    ++_componentRevision;
+}
+
 } // namespace Play
@@ -4,8 +4,11 @@
 #include "ModelLoadingConfig.h"
 #include "pch.h"
 #include <glm/glm.hpp>
+#include <memory>
 #include <rttr/rttr_enable.h>
 #include <string>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
 namespace Play
@@ -67,7 +70,13 @@ struct CpuSceneNodeTransform
 class CpuSceneComponent
 {
 public:
-    virtual ~CpuSceneComponent() = default;
+    // the virtual destructor would leave components without moves, pools move them when one is removed
+    CpuSceneComponent()                                    = default;
+    CpuSceneComponent(const CpuSceneComponent&)            = default;
+    CpuSceneComponent(CpuSceneComponent&&)                 = default;
+    CpuSceneComponent& operator=(const CpuSceneComponent&) = default;
+    CpuSceneComponent& operator=(CpuSceneComponent&&)      = default;
+    virtual ~CpuSceneComponent()                           = default;
 
     CpuSceneComponentID self;
     CpuSceneNodeID      ownerNode;
@@ -114,28 +123,81 @@ public:
     RTTR_ENABLE(CpuSceneComponent)
 };
 
+// components of one type sit densely in their pool, indexed through a sparse array by component id and by owner node.
+// A node owns at most one component of a type, removing one moves the last of its pool into its place
 class ComponentStore
 {
     class IComponentPool;
     template <typename T>
     class ComponentPool;
-    struct PoolEntry;
 
 public:
+    // the components of First in pool order, joined with those of Rest on the same owner node. Creating or removing
+    // components of a viewed type invalidates the view
+    template <typename First, typename... Rest>
+    class View
+    {
+        template <typename T>
+        using PoolOf = ComponentPool<std::remove_const_t<T>>;
+
+    public:
+        explicit View(PoolOf<First>* first, PoolOf<Rest>*... rest) : _first(first), _rest(rest...) {}
+
+        // a single type view iterates its pool directly
+        First* begin() const
+            requires(sizeof...(Rest) == 0)
+        {
+            return _first ? _first->data() : nullptr;
+        }
+
+        First* end() const
+            requires(sizeof...(Rest) == 0)
+        {
+            return _first ? _first->data() + _first->size() : nullptr;
+        }
+
+        // the components of First, an upper bound of what each visits
+        size_t size() const
+        {
+            return _first ? _first->size() : 0;
+        }
+
+        // calls func(First&, Rest&...) for every owner node with all of the types
+        template <typename Func>
+        void each(Func&& func) const
+        {
+            if (!_first || !std::apply([](auto*... pools) { return (true && ... && (pools != nullptr)); }, _rest)) return;
+
+            First* components = _first->data();
+            for (size_t index = 0; index < _first->size(); ++index)
+            {
+                First&                     component = components[index];
+                const std::tuple<Rest*...> others    = std::apply(
+                    [&component](auto*... pools) { return std::tuple<Rest*...>(pools->find(component.ownerNode)...); }, _rest);
+                if (!std::apply([](auto*... matches) { return (true && ... && (matches != nullptr)); }, others)) continue;
+                std::apply([&](auto*... matches) { func(component, *matches...); }, others);
+            }
+        }
+
+    private:
+        PoolOf<First>*               _first = nullptr;
+        std::tuple<PoolOf<Rest>*...> _rest;
+    };
+
     ComponentStore() = default;
     ComponentStore(const ComponentStore&) = delete;
     ComponentStore& operator=(const ComponentStore&) = delete;
-    ~ComponentStore();
 
     void clear();
     void remove(CpuSceneComponentID componentID);
 
-    template <typename T>
-    CpuSceneComponentID create()
+    // constructs the component in place from args, owned by ownerNode
+    template <typename T, typename... Args>
+    CpuSceneComponentID create(CpuSceneNodeID ownerNode = {}, Args&&... args)
     {
         const uint32_t typeID = getComponentTypeID<T>();
         ComponentPool<T>* pool = getOrCreatePool<T>(typeID);
-        return pool->create(typeID);
+        return pool->create(typeID, ownerNode, std::forward<Args>(args)...);
     }
 
     template <typename T>
@@ -175,6 +237,40 @@ public:
     CpuSceneComponent*       get(CpuSceneComponentID componentID);
     const CpuSceneComponent* get(CpuSceneComponentID componentID) const;
 
+    // the component of the type ownerNode owns
+    template <typename T>
+    T* find(CpuSceneNodeID ownerNode)
+    {
+        ComponentPool<T>* pool = findTypedPool<T>();
+        return pool ? pool->find(ownerNode) : nullptr;
+    }
+
+    template <typename T>
+    const T* find(CpuSceneNodeID ownerNode) const
+    {
+        const ComponentPool<T>* pool = findTypedPool<T>();
+        return pool ? pool->find(ownerNode) : nullptr;
+    }
+
+    template <typename T>
+    void reserve(size_t count)
+    {
+        getOrCreatePool<T>(getComponentTypeID<T>())->reserve(count);
+    }
+
+    template <typename... T>
+    View<T...> view()
+    {
+        return View<T...>(findTypedPool<T>()...);
+    }
+
+    template <typename... T>
+    View<const T...> view() const
+    {
+        ComponentStore& store = const_cast<ComponentStore&>(*this);
+        return View<const T...>(store.findTypedPool<T>()...);
+    }
+
     template <typename T>
     static uint32_t getComponentTypeID()
     {
@@ -190,57 +286,50 @@ private:
         virtual CpuSceneComponent*       get(uint32_t index, uint32_t generation)       = 0;
         virtual const CpuSceneComponent* get(uint32_t index, uint32_t generation) const = 0;
         virtual void                     remove(uint32_t index, uint32_t generation)    = 0;
+        virtual void                     clear()                                        = 0;
     };
 
     template <typename T>
     class ComponentPool : public IComponentPool
     {
     public:
-        CpuSceneComponentID create(uint32_t typeID)
+        template <typename... Args>
+        CpuSceneComponentID create(uint32_t typeID, CpuSceneNodeID ownerNode, Args&&... args)
         {
-            uint32_t generation = 1;
-            uint32_t index      = INVALID_SCENE_ID;
-
-            T component;
+            uint32_t index = INVALID_SCENE_ID;
             if (!_freeSlots.empty())
             {
                 index = _freeSlots.back();
                 _freeSlots.pop_back();
-                generation = _items[index].generation;
             }
             else
             {
-                index = static_cast<uint32_t>(_items.size());
-                _items.push_back(component);
+                index = static_cast<uint32_t>(_slots.size());
+                _slots.emplace_back();
             }
 
-            component.generation = generation;
-            _items[index]        = component;
+            Slot& slot = _slots[index];
+            slot.dense = static_cast<uint32_t>(_dense.size());
+            _denseSlots.push_back(index);
 
-            CpuSceneComponentID componentID;
-            componentID.typeID     = typeID;
-            componentID.index      = index;
-            componentID.generation = _items[index].generation;
-            _items[index].self     = componentID;
-            return componentID;
+            T& component         = _dense.emplace_back(std::forward<Args>(args)...);
+            component.generation = slot.generation;
+            component.self       = {typeID, index, slot.generation};
+            component.ownerNode  = ownerNode;
+            linkOwner(slot.dense);
+            return component.self;
         }
 
         T* getTyped(uint32_t index, uint32_t generation)
         {
-            if (index >= _items.size() || _items[index].generation != generation)
-            {
-                return nullptr;
-            }
-            return &_items[index];
+            const uint32_t dense = findDense(index, generation);
+            return dense != INVALID_SCENE_ID ? &_dense[dense] : nullptr;
         }
 
         const T* getTyped(uint32_t index, uint32_t generation) const
         {
-            if (index >= _items.size() || _items[index].generation != generation)
-            {
-                return nullptr;
-            }
-            return &_items[index];
+            const uint32_t dense = findDense(index, generation);
+            return dense != INVALID_SCENE_ID ? &_dense[dense] : nullptr;
         }
 
         CpuSceneComponent* get(uint32_t index, uint32_t generation) override
@@ -255,51 +344,171 @@ private:
 
         void remove(uint32_t index, uint32_t generation) override
         {
-            if (index >= _items.size() || _items[index].generation != generation)
+            const uint32_t dense = findDense(index, generation);
+            if (dense == INVALID_SCENE_ID)
             {
                 return;
             }
 
-            _items[index].visible = false;
-            _items[index].self      = {};
-            _items[index].ownerNode = {};
-            ++_items[index].generation;
+            unlinkOwner(dense);
+            const uint32_t last = static_cast<uint32_t>(_dense.size() - 1);
+            if (dense != last)
+            {
+                _dense[dense]                    = std::move(_dense[last]);
+                _denseSlots[dense]               = _denseSlots[last];
+                _slots[_denseSlots[dense]].dense = dense;
+                linkOwner(dense);
+            }
+            _dense.pop_back();
+            _denseSlots.pop_back();
+
+            _slots[index].dense = INVALID_SCENE_ID;
+            ++_slots[index].generation;
             _freeSlots.push_back(index);
         }
 
+        // the slots stay, ids of the removed components never match a later one
+        void clear() override
+        {
+            for (uint32_t index : _denseSlots)
+            {
+                _slots[index].dense = INVALID_SCENE_ID;
+                ++_slots[index].generation;
+                _freeSlots.push_back(index);
+            }
+            _dense.clear();
+            _denseSlots.clear();
+            _ownerDense.clear();
+        }
+
+        T* find(CpuSceneNodeID ownerNode)
+        {
+            const uint32_t dense = findOwnerDense(ownerNode);
+            return dense != INVALID_SCENE_ID ? &_dense[dense] : nullptr;
+        }
+
+        const T* find(CpuSceneNodeID ownerNode) const
+        {
+            const uint32_t dense = findOwnerDense(ownerNode);
+            return dense != INVALID_SCENE_ID ? &_dense[dense] : nullptr;
+        }
+
+        T* data()
+        {
+            return _dense.data();
+        }
+
+        void reserve(size_t count)
+        {
+            _dense.reserve(count);
+            _denseSlots.reserve(count);
+            _slots.reserve(count);
+        }
+
+        size_t size() const
+        {
+            return _dense.size();
+        }
+
     private:
-        std::vector<T> _items;
+        struct Slot
+        {
+            uint32_t dense      = INVALID_SCENE_ID;
+            uint32_t generation = 1;
+        };
+
+        uint32_t findDense(uint32_t index, uint32_t generation) const
+        {
+            if (index >= _slots.size() || _slots[index].generation != generation)
+            {
+                return INVALID_SCENE_ID;
+            }
+            return _slots[index].dense;
+        }
+
+        uint32_t findOwnerDense(CpuSceneNodeID ownerNode) const
+        {
+            if (ownerNode.index >= _ownerDense.size())
+            {
+                return INVALID_SCENE_ID;
+            }
+            const uint32_t dense = _ownerDense[ownerNode.index];
+            if (dense == INVALID_SCENE_ID || _dense[dense].ownerNode.generation != ownerNode.generation)
+            {
+                return INVALID_SCENE_ID;
+            }
+            return dense;
+        }
+
+        void linkOwner(uint32_t dense)
+        {
+            const CpuSceneNodeID ownerNode = _dense[dense].ownerNode;
+            if (!ownerNode.isValid())
+            {
+                return;
+            }
+            if (ownerNode.index >= _ownerDense.size())
+            {
+                _ownerDense.resize(ownerNode.index + 1, INVALID_SCENE_ID);
+            }
+            _ownerDense[ownerNode.index] = dense;
+        }
+
+        void unlinkOwner(uint32_t dense)
+        {
+            const CpuSceneNodeID ownerNode = _dense[dense].ownerNode;
+            if (ownerNode.index < _ownerDense.size() && _ownerDense[ownerNode.index] == dense)
+            {
+                _ownerDense[ownerNode.index] = INVALID_SCENE_ID;
+            }
+        }
+
+        std::vector<T>        _dense;
+        std::vector<uint32_t> _denseSlots; // the slot of each dense component
+        std::vector<Slot>     _slots;      // by component id index
         std::vector<uint32_t> _freeSlots;
+        std::vector<uint32_t> _ownerDense; // by owner node index
     };
 
-    struct PoolEntry
+    static uint32_t allocateComponentTypeID();
+
+    IComponentPool* findPool(uint32_t typeID)
     {
-        uint32_t        typeID = INVALID_SCENE_ID;
-        IComponentPool* pool   = nullptr;
-    };
+        return typeID < _pools.size() ? _pools[typeID].get() : nullptr;
+    }
 
-    static uint32_t allocateComponentTypeID();
+    const IComponentPool* findPool(uint32_t typeID) const
+    {
+        return typeID < _pools.size() ? _pools[typeID].get() : nullptr;
+    }
 
-    IComponentPool*       findPool(uint32_t typeID);
-    const IComponentPool* findPool(uint32_t typeID) const;
+    template <typename T>
+    ComponentPool<T>* findTypedPool()
+    {
+        return static_cast<ComponentPool<T>*>(findPool(getComponentTypeID<T>()));
+    }
+
+    template <typename T>
+    const ComponentPool<T>* findTypedPool() const
+    {
+        return static_cast<const ComponentPool<T>*>(findPool(getComponentTypeID<T>()));
+    }
 
     template <typename T>
     ComponentPool<T>* getOrCreatePool(uint32_t typeID)
     {
-        IComponentPool* pool = findPool(typeID);
-        if (pool)
+        if (typeID >= _pools.size())
         {
-            return static_cast<ComponentPool<T>*>(pool);
+            _pools.resize(typeID + 1);
         }
-
-        PoolEntry entry;
-        entry.typeID = typeID;
-        entry.pool   = new ComponentPool<T>();
-        _pools.push_back(entry);
-        return static_cast<ComponentPool<T>*>(entry.pool);
+        if (!_pools[typeID])
+        {
+            _pools[typeID] = std::make_unique<ComponentPool<T>>();
+        }
+        return static_cast<ComponentPool<T>*>(_pools[typeID].get());
     }
 
-    std::vector<PoolEntry> _pools;
+    std::vector<std::unique_ptr<IComponentPool>> _pools; // by component type id
 };
 
 struct CpuSceneNode
@@ -321,17 +530,18 @@ struct CpuSceneNode
     bool                             visible      = true;
     bool                             worldVisible = true;
     bool                             worldTransformDirty = true;
+    bool                             worldTransformMoved = false; // recomputed since the moved nodes were last taken
 
     template <typename T>
-    T* addComponent(ComponentStore& componentStore)
+    T* addComponent(ComponentStore& componentStore, CpuSceneNodeID self)
     {
-        T* component = getComponent<T>(componentStore);
+        T* component = componentStore.find<T>(self);
         if (component)
         {
             return component;
         }
 
-        CpuSceneComponentID componentID = componentStore.create<T>();
+        CpuSceneComponentID componentID = componentStore.create<T>(self);
         components.push_back(componentID);
         return componentStore.get<T>(componentID);
     }
@@ -409,6 +619,15 @@ public:
     void setVisible(CpuSceneNodeID nodeID, bool visible);
     bool reparentNode(CpuSceneNodeID nodeID, CpuSceneNodeID newParent);
     bool removeNode(CpuSceneNodeID nodeID);
+    // replaces every node and drops every component. The root comes first and parents before their children, whose
+    // links are rebuilt from their parent indices by prepending in order
+    void replaceNodes(std::vector<CpuSceneNode> nodes);
+
+    template <typename T>
+    void reserveComponents(size_t count)
+    {
+        _components.reserve<T>(count);
+    }
 
     template <typename T>
     T* addComponent(CpuSceneNodeID nodeID)
@@ -419,35 +638,29 @@ public:
             return nullptr;
         }
 
-        T* component = node->addComponent<T>(_components);
-        if (component)
-        {
-            component->ownerNode = nodeID;
-        }
-        markDirty();
+        T* component = node->addComponent<T>(_components, nodeID);
+        markComponentsDirty();
         return component;
     }
 
     template <typename T>
     T* getComponent(CpuSceneNodeID nodeID)
     {
-        CpuSceneNode* node = getNode(nodeID);
-        if (!node)
+        if (!isValid(nodeID))
         {
             return nullptr;
         }
-        return node->getComponent<T>(_components);
+        return _components.find<T>(nodeID);
     }
 
     template <typename T>
     const T* getComponent(CpuSceneNodeID nodeID) const
     {
-        const CpuSceneNode* node = getNode(nodeID);
-        if (!node)
+        if (!isValid(nodeID))
         {
             return nullptr;
         }
-        return node->getComponent<T>(_components);
+        return _components.find<T>(nodeID);
     }
 
     template <typename T>
@@ -462,7 +675,7 @@ public:
         const bool removed = node->removeComponent<T>(_components);
         if (removed)
         {
-            markDirty();
+            markComponentsDirty();
         }
         return removed;
     }
@@ -479,6 +692,19 @@ public:
         return _components.get<T>(componentID);
     }
 
+    // the components of the first type whose owner nodes have all the others, in pool order
+    template <typename... T>
+    ComponentStore::View<T...> view()
+    {
+        return _components.view<T...>();
+    }
+
+    template <typename... T>
+    ComponentStore::View<const T...> view() const
+    {
+        return _components.view<T...>();
+    }
+
     void updateWorldTransforms();
     void notifyComponentChanged();
 
@@ -487,6 +713,17 @@ public:
         return _revision;
     }
 
+    // changes when components are added, removed or report a change, and when nodes holding them go away. Unlike the
+    // revision it never starts over, moving nodes leaves it alone
+    uint64_t getComponentRevision() const
+    {
+        return _componentRevision;
+    }
+
+    // swaps out the indices of the nodes whose world transform was recomputed by updateWorldTransforms since the last
+    // call, each once. A removed node may be among them
+    void takeMovedNodes(std::vector<uint32_t>& nodeIndices);
+
     const std::vector<CpuSceneNode>& getNodes() const
     {
         return _nodes;
@@ -505,13 +742,16 @@ private:
     void           markWorldTransformDirty(CpuSceneNodeID nodeID);
     void           updateWorldRecursive(CpuSceneNodeID nodeID, const glm::mat4& parentTransform, bool parentVisible);
     void           markDirty();
+    void           markComponentsDirty();
 
     std::vector<CpuSceneNode> _nodes;
     std::vector<uint32_t>     _freeNodeSlots;
     ComponentStore            _components;
     CpuSceneNodeID           _rootNode;
-    uint64_t                 _revision       = 0;
-    bool                     _transformDirty = true;
+    std::vector<uint32_t>     _movedNodes; // by index, see takeMovedNodes
+    uint64_t                 _revision          = 0;
+    uint64_t                 _componentRevision = 0;
+    bool                     _transformDirty    = true;
 };
 
 } // namespace Play
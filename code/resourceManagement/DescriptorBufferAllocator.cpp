@@ -0,0 +1,170 @@
+#include "DescriptorBufferAllocator.h"
+#include <algorithm>
+#include <iterator>
+
+namespace Play
+{
+namespace
+{
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+}
+} // namespace
+
+void DescriptorRingAllocator::init(VkDeviceSize capacity)
+{
+    _capacity = capacity;
+    _head     = 0;
+    _tail     = 0;
+    _frames.clear();
+    _stats = DescriptorRingStats{};
+}
+
+void DescriptorRingAllocator::beginFrame(uint64_t frame, uint32_t framesInFlight)
+{
+    // the frames before inFlightFrom completed, their ranges are free again
+    const uint64_t inFlightFrom = frame + 1 > framesInFlight ? frame + 1 - framesInFlight : 0;
+    while (!_frames.empty() && _frames.front().frame < inFlightFrom)
+    {
+        _tail             = _frames.front().end;
+        _stats.usedBytes -= _frames.front().bytes;
+        _frames.pop_front();
+    }
+    if (_frames.empty() || _frames.back().frame != frame)
+    {
+        _frames.push_back({frame, _head, 0});
+    }
+}
+
+std::optional<VkDeviceSize> DescriptorRingAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+    if (size == 0 || size > _capacity)
+    {
+        ++_stats.failedAllocations;
+        return std::nullopt;
+    }
+    if (_frames.empty())
+    {
+        _frames.push_back({0, _head, 0});
+    }
+    if (_stats.usedBytes == 0)
+    {
+        _head = 0;
+        _tail = 0;
+    }
+
+    // with the head behind the tail the free range is [head, tail), otherwise [head, capacity) and [0, tail)
+    const bool   wrapped  = _head < _tail || (_head == _tail && _stats.usedBytes > 0);
+    VkDeviceSize offset   = alignUp(_head, alignment);
+    VkDeviceSize consumed = 0;
+    if (wrapped)
+    {
+        if (offset + size > _tail)
+        {
+            ++_stats.failedAllocations;
+            return std::nullopt;
+        }
+        consumed = offset + size - _head;
+    }
+    else if (offset + size <= _capacity)
+    {
+        consumed = offset + size - _head;
+    }
+    else
+    {
+        if (size > _tail)
+        {
+            ++_stats.failedAllocations;
+            return std::nullopt;
+        }
+        offset   = 0;
+        consumed = _capacity - _head + size;
+    }
+
+    _head                   = offset + size;
+    _frames.back().end      = _head;
+    _frames.back().bytes   += consumed;
+    _stats.usedBytes       += consumed;
+    _stats.peakUsedBytes    = std::max(_stats.peakUsedBytes, _stats.usedBytes);
+    ++_stats.allocations;
+    return offset;
+}
+
+void DescriptorOffsetAllocator::init(VkDeviceSize capacity)
+{
+    _freeRanges.clear();
+    _allocations.clear();
+    _usedBytes = 0;
+    if (capacity > 0)
+    {
+        _freeRanges[0] = capacity;
+    }
+}
+
+std::optional<VkDeviceSize> DescriptorOffsetAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+    if (size == 0)
+    {
+        return std::nullopt;
+    }
+    for (auto it = _freeRanges.begin(); it != _freeRanges.end(); ++it)
+    {
+        const VkDeviceSize rangeOffset = it->first;
+        const VkDeviceSize rangeEnd    = it->first + it->second;
+        const VkDeviceSize offset      = alignUp(rangeOffset, alignment);
+        if (offset + size > rangeEnd)
+        {
+            continue;
+        }
+
+        _freeRanges.erase(it);
+        if (offset > rangeOffset)
+        {
+            _freeRanges[rangeOffset] = offset - rangeOffset;
+        }
+        if (offset + size < rangeEnd)
+        {
+            _freeRanges[offset + size] = rangeEnd - offset - size;
+        }
+        _allocations[offset]  = size;
+        _usedBytes           += size;
+        return offset;
+    }
+    return std::nullopt;
+}
+
+void DescriptorOffsetAllocator::free(VkDeviceSize offset)
+{
+    auto allocation = _allocations.find(offset);
+    if (allocation == _allocations.end())
+    {
+        return;
+    }
+    const VkDeviceSize size  = allocation->second;
+    _usedBytes              -= size;
+    _allocations.erase(allocation);
+    insertFreeRange(offset, size);
+}
+
+void DescriptorOffsetAllocator::insertFreeRange(VkDeviceSize offset, VkDeviceSize size)
+{
+    auto next = _freeRanges.lower_bound(offset);
+    if (next != _freeRanges.end() && offset + size == next->first)
+    {
+        size += next->second;
+        next  = _freeRanges.erase(next);
+    }
+    if (next != _freeRanges.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset)
+        {
+            previous->second += size;
+            return;
+        }
+    }
+    _freeRanges[offset] = size;
+}
+
+} // namespace Play
@@ -0,0 +1,83 @@
+#ifndef DESCRIPTOR_BUFFER_ALLOCATOR_H
+#define DESCRIPTOR_BUFFER_ALLOCATOR_H
+#include <vulkan/vulkan_core.h>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <optional>
+namespace Play
+{
+
+struct DescriptorRingStats
+{
+    VkDeviceSize usedBytes         = 0;
+    VkDeviceSize peakUsedBytes     = 0;
+    uint64_t     allocations       = 0;
+    uint64_t     failedAllocations = 0;
+};
+
+// offsets into [0, capacity) handed out in submission order. Everything allocated in a frame stays reserved until
+// beginFrame() is called for a frame at least framesInFlight later, so the gpu is done reading it. Allocations that do
+// not fit before the end wrap to offset 0 and give up the tail
+class DescriptorRingAllocator
+{
+public:
+    void init(VkDeviceSize capacity);
+    // called once the fence of the frame slot was waited
+    void                        beginFrame(uint64_t frame, uint32_t framesInFlight);
+    std::optional<VkDeviceSize> allocate(VkDeviceSize size, VkDeviceSize alignment);
+
+    VkDeviceSize getCapacity() const
+    {
+        return _capacity;
+    }
+
+    const DescriptorRingStats& getStats() const
+    {
+        return _stats;
+    }
+
+private:
+    struct FrameRange
+    {
+        uint64_t     frame = 0;
+        VkDeviceSize end   = 0; // head after the last allocation of the frame
+        VkDeviceSize bytes = 0; // allocated and skipped bytes of the frame
+    };
+
+    VkDeviceSize           _capacity = 0;
+    VkDeviceSize           _head     = 0;
+    VkDeviceSize           _tail     = 0;
+    std::deque<FrameRange> _frames; // oldest first, the back is the frame being recorded
+    DescriptorRingStats    _stats;
+};
+
+// first fit allocator for the long lived regions of a descriptor buffer, freed ranges merge with their neighbours
+class DescriptorOffsetAllocator
+{
+public:
+    void                        init(VkDeviceSize capacity);
+    std::optional<VkDeviceSize> allocate(VkDeviceSize size, VkDeviceSize alignment);
+    void                        free(VkDeviceSize offset);
+
+    VkDeviceSize getUsedBytes() const
+    {
+        return _usedBytes;
+    }
+
+    uint32_t getFreeRangeCount() const
+    {
+        return static_cast<uint32_t>(_freeRanges.size());
+    }
+
+private:
+    void insertFreeRange(VkDeviceSize offset, VkDeviceSize size);
+
+    std::map<VkDeviceSize, VkDeviceSize> _freeRanges;  // offset to size
+    std::map<VkDeviceSize, VkDeviceSize> _allocations; // offset to size
+    VkDeviceSize                         _usedBytes = 0;
+};
+
+} // namespace Play
+
+#endif // DESCRIPTOR_BUFFER_ALLOCATOR_H
@@ -1,15 +1,63 @@
 #include "DescriptorManager.h"
 #include "nvvk/check_error.hpp"
+#include <nvutils/hash_operations.hpp>
 #include "core/runtime/VulkanRuntime.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
 
 namespace Play
 {
-std::unordered_map<DescriptorEnum, size_t> DescriptorSetOffsetMap = {
-    {DescriptorEnum::eGlobalDescriptorSet, GLOBAL_DESCRIPTOR_SET_OFFSET},
-    {DescriptorEnum::eSceneDescriptorSet, PER_SCENE_DESCRIPTOR_SET_OFFSET},
-    {DescriptorEnum::eFrameDescriptorSet, PER_FRAME_DESCRIPTOR_SET_OFFSET},
-    {DescriptorEnum::ePerPassDescriptorSet, PER_PASS_DESCRIPTOR_SET_OFFSET},
-    {DescriptorEnum::eDrawObjectDescriptorSet, PER_DRAW_OBJECT_DESCRIPTOR_SET_OFFSET}};
+namespace
+{
+// the per pass and per object pools, sets are freed one by one when a layout runs over its cap
+class VulkanDescriptorPoolAllocator : public DescriptorPoolAllocator
+{
+public:
+    explicit VulkanDescriptorPoolAllocator(std::vector<VkDescriptorPoolSize> poolSizes) : _poolSizes(std::move(poolSizes)) {}
+
+    VkDescriptorPool createPool(uint32_t maxSets) override
+    {
+        VkDescriptorPoolCreateInfo poolCreateInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+        poolCreateInfo.flags         = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+        poolCreateInfo.maxSets       = maxSets;
+        poolCreateInfo.poolSizeCount = static_cast<uint32_t>(_poolSizes.size());
+        poolCreateInfo.pPoolSizes    = _poolSizes.data();
+        VkDescriptorPool pool        = VK_NULL_HANDLE;
+        NVVK_CHECK(vkCreateDescriptorPool(vkDriver->getDevice(), &poolCreateInfo, nullptr, &pool));
+        return pool;
+    }
+
+    void destroyPool(VkDescriptorPool pool) override
+    {
+        vkDestroyDescriptorPool(vkDriver->getDevice(), pool, nullptr);
+    }
+
+    void resetPool(VkDescriptorPool pool) override
+    {
+        NVVK_CHECK(vkResetDescriptorPool(vkDriver->getDevice(), pool, 0));
+    }
+
+    VkDescriptorSet allocateSet(VkDescriptorPool pool, VkDescriptorSetLayout layout) override
+    {
+        VkDescriptorSetAllocateInfo allocInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+        allocInfo.descriptorPool      = pool;
+        allocInfo.descriptorSetCount  = 1;
+        allocInfo.pSetLayouts         = &layout;
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        NVVK_CHECK(vkAllocateDescriptorSets(vkDriver->getDevice(), &allocInfo, &descriptorSet));
+        return descriptorSet;
+    }
+
+    void freeSet(VkDescriptorPool pool, VkDescriptorSet set) override
+    {
+        NVVK_CHECK(vkFreeDescriptorSets(vkDriver->getDevice(), pool, 1, &set));
+    }
+
+private:
+    std::vector<VkDescriptorPoolSize> _poolSizes;
+};
+} // namespace
 
 DescriptorSetBindings::DescriptorSetBindings() {}
 DescriptorSetBindings::DescriptorSetBindings(DescriptorEnum setSlot) : _setSlot(setSlot) {}
@@ -17,15 +65,27 @@ DescriptorSetBindings::~DescriptorSetBindings() {}
 
 void DescriptorSetBindings::reset(DescriptorEnum setSlot)
 {
+    DescriptorSetCache* descriptorCache = vkDriver->getDescriptorSetCache();
     if (_layout != VK_NULL_HANDLE)
     {
+        // sets reset during shutdown may outlive the cache
+        if (descriptorCache) descriptorCache->unregisterSetLayout(_layout);
         vkDestroyDescriptorSetLayout(vkDriver->getDevice(), _layout, nullptr);
         _layout = VK_NULL_HANDLE;
     }
+    if (_bufferLayout != VK_NULL_HANDLE)
+    {
+        descriptorCache->unregisterSetLayout(_bufferLayout);
+        descriptorCache->getDescriptorBuffer().destroySetLayout(_bufferLayout);
+        _bufferLayout = VK_NULL_HANDLE;
+    }
+    destroyUpdateTemplate();
 
     nvvk::DescriptorBindings::clear();
     _bindingInfos.clear();
     _descInfos.clear();
+    _bindingHashes.clear();
+    _dirtyBindings.clear();
     _setBindingHash = 0;
     if (setSlot != DescriptorEnum::eCount)
     {
@@ -35,6 +95,7 @@ void DescriptorSetBindings::reset(DescriptorEnum setSlot)
     _descInfoDirty      |= 1 << 0;
     _descriptorSetDirty  = true;
     _cachedDescriptorSet = VK_NULL_HANDLE;
+    _bufferOffsetFrame   = ~0ULL;
 }
 
 void DescriptorSetBindings::markLayoutDirty()
@@ -43,12 +104,22 @@ void DescriptorSetBindings::markLayoutDirty()
     _descInfoDirty      |= 1 << 0;
     _descriptorSetDirty  = true;
     _cachedDescriptorSet = VK_NULL_HANDLE;
+    _bufferOffsetFrame   = ~0ULL;
 }
 
-void DescriptorSetBindings::markDescriptorInfoDirty()
+void DescriptorSetBindings::markDescriptorInfoDirty(uint32_t bindingIdx)
 {
     _descInfoDirty      |= 1 << 0;
     _descriptorSetDirty = true;
+    _bufferOffsetFrame  = ~0ULL;
+    for (size_t i = 0; i < _bindingInfos.size() && i < _dirtyBindings.size(); ++i)
+    {
+        if (_bindingInfos[i].bindingIdx == bindingIdx)
+        {
+            _dirtyBindings[i] = true;
+            break;
+        }
+    }
 }
 
 DescriptorSetBindings& DescriptorSetBindings::addBinding(const BindInfo& bindingInfo)
@@ -98,11 +169,18 @@ DescriptorSetBindings& DescriptorSetBindings::addBinding(uint32_t bindingIdx, ui
 VkDescriptorSetLayout DescriptorSetBindings::finalizeLayout()
 {
     if (!_setLayoutDirty) return _layout;
+    destroyUpdateTemplate();
+    DescriptorSetCache* descriptorCache = vkDriver->getDescriptorSetCache();
     if (_layout != VK_NULL_HANDLE)
     {
+        descriptorCache->unregisterSetLayout(_layout);
         vkDestroyDescriptorSetLayout(vkDriver->getDevice(), _layout, nullptr);
         _layout = VK_NULL_HANDLE;
     }
+    DescriptorBufferManagerExt& descriptorBuffer = descriptorCache->getDescriptorBuffer();
+    descriptorCache->unregisterSetLayout(_bufferLayout);
+    descriptorBuffer.destroySetLayout(_bufferLayout);
+    _bufferLayout = VK_NULL_HANDLE;
 
     nvvk::DescriptorBindings::clear();
     uint32_t descriptorCount = 0;
@@ -112,24 +190,70 @@ VkDescriptorSetLayout DescriptorSetBindings::finalizeLayout()
         nvvk::DescriptorBindings::addBinding(binding.bindingIdx, binding.descriptorType, binding.descriptorCount, binding.shaderStageFlags);
     }
     _descInfos.resize(descriptorCount);
+    _bindingHashes.assign(_bindingInfos.size(), 0);
+    _dirtyBindings.assign(_bindingInfos.size(), true);
+    _descInfoDirty |= 1 << 0;
     createDescriptorSetLayout(vkDriver->getDevice(), 0, &_layout);
+    descriptorCache->registerSetLayout(_layout, 0, getBindings());
+    createUpdateTemplate();
+    if (descriptorBuffer.isSupported())
+    {
+        _bufferLayout = descriptorBuffer.createSetLayout(getBindings());
+        descriptorCache->registerSetLayout(_bufferLayout, VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT, getBindings());
+    }
     _setLayoutDirty      = false;
     _descriptorSetDirty  = true;
     _cachedDescriptorSet = VK_NULL_HANDLE;
+    _bufferOffsetFrame   = ~0ULL;
     return _layout;
 }
 
+void DescriptorSetBindings::createUpdateTemplate()
+{
+    // every binding reads descriptorCount consecutive DescriptorInfo, the union member matching its type
+    std::vector<VkDescriptorUpdateTemplateEntry> entries;
+    entries.reserve(_bindingInfos.size());
+    for (const BindInfo& binding : _bindingInfos)
+    {
+        VkDescriptorUpdateTemplateEntry entry{};
+        entry.dstBinding      = binding.bindingIdx;
+        entry.dstArrayElement = 0;
+        entry.descriptorCount = binding.descriptorCount;
+        entry.descriptorType  = binding.descriptorType;
+        entry.offset          = descriptorOffset(binding.bindingIdx) * sizeof(DescriptorInfo);
+        entry.stride          = sizeof(DescriptorInfo);
+        entries.push_back(entry);
+    }
+    if (entries.empty()) return;
+
+    VkDescriptorUpdateTemplateCreateInfo createInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO};
+    createInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+    createInfo.pDescriptorUpdateEntries   = entries.data();
+    createInfo.templateType               = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+    createInfo.descriptorSetLayout        = _layout;
+    NVVK_CHECK(vkCreateDescriptorUpdateTemplate(vkDriver->getDevice(), &createInfo, nullptr, &_updateTemplate));
+}
+
+void DescriptorSetBindings::destroyUpdateTemplate()
+{
+    if (_updateTemplate == VK_NULL_HANDLE) return;
+    vkDestroyDescriptorUpdateTemplate(vkDriver->getDevice(), _updateTemplate, nullptr);
+    _updateTemplate = VK_NULL_HANDLE;
+}
+
 void DescriptorSetBindings::setDescInfo(uint32_t bindingIdx, const nvvk::Buffer& buffer, VkDeviceSize offset, VkDeviceSize range)
 {
-    auto& bufferInfo = _descInfos[descriptorOffset(bindingIdx)].buffer;
-    if (bufferInfo.buffer == buffer.buffer && bufferInfo.offset == offset && bufferInfo.range == range)
+    // the size is known here, descriptor buffers have no whole size range
+    const VkDeviceSize bufferRange = range == VK_WHOLE_SIZE ? buffer.bufferSize - offset : range;
+    auto&              bufferInfo  = _descInfos[descriptorOffset(bindingIdx)].buffer;
+    if (bufferInfo.buffer == buffer.buffer && bufferInfo.offset == offset && bufferInfo.range == bufferRange)
     {
         return;
     }
-    markDescriptorInfoDirty();
+    markDescriptorInfoDirty(bindingIdx);
     bufferInfo.buffer = buffer.buffer;
     bufferInfo.offset = offset;
-    bufferInfo.range  = range;
+    bufferInfo.range  = bufferRange;
 }
 
 void DescriptorSetBindings::setDescInfo(uint32_t bindingIdx, const nvvk::Image& image)
@@ -140,7 +264,7 @@ void DescriptorSetBindings::setDescInfo(uint32_t bindingIdx, const nvvk::Image&
     {
         return;
     }
-    markDescriptorInfoDirty();
+    markDescriptorInfoDirty(bindingIdx);
     imageInfo.image = image.descriptor;
 }
 
@@ -151,7 +275,7 @@ void DescriptorSetBindings::setDescInfo(uint32_t bindingIdx, VkBuffer buffer, Vk
     {
         return;
     }
-    markDescriptorInfoDirty();
+    markDescriptorInfoDirty(bindingIdx);
     bufferInfo.buffer = buffer;
     bufferInfo.offset = offset;
     bufferInfo.range  = range;
@@ -164,7 +288,7 @@ void DescriptorSetBindings::setDescInfo(uint32_t bindingIdx, const VkDescriptorB
     {
         return;
     }
-    markDescriptorInfoDirty();
+    markDescriptorInfoDirty(bindingIdx);
     destBufferInfo = bufferInfo;
 }
 
@@ -175,7 +299,7 @@ void DescriptorSetBindings::setDescInfo(uint32_t bindingIdx, VkImageView imageVi
     {
         return;
     }
-    markDescriptorInfoDirty();
+    markDescriptorInfoDirty(bindingIdx);
     imageInfo.imageLayout = imageLayout;
     imageInfo.imageView   = imageView;
     imageInfo.sampler     = sampler;
@@ -189,7 +313,7 @@ void DescriptorSetBindings::setDescInfo(uint32_t bindingIdx, const VkDescriptorI
     {
         return;
     }
-    markDescriptorInfoDirty();
+    markDescriptorInfoDirty(bindingIdx);
     destImageInfo = imageInfo;
 }
 
@@ -200,7 +324,7 @@ void DescriptorSetBindings::setDescInfo(uint32_t bindingIdx, VkAccelerationStruc
     {
         return;
     }
-    markDescriptorInfoDirty();
+    markDescriptorInfoDirty(bindingIdx);
     accelInfo = accel;
 }
 
@@ -209,12 +333,14 @@ void DescriptorSetBindings::setDescInfo(uint32_t bindingIdx, const nvvk::Buffer*
     for (uint32_t i = 0; i < count; ++i)
     {
         auto& bufferInfo = _descInfos[descriptorOffset(bindingIdx) + i].buffer;
-        if (bufferInfo.buffer == buffers[i].buffer)
+        if (bufferInfo.buffer == buffers[i].buffer && bufferInfo.offset == 0 && bufferInfo.range == buffers[i].bufferSize)
         {
             continue;
         }
-        markDescriptorInfoDirty();
+        markDescriptorInfoDirty(bindingIdx);
         bufferInfo.buffer = buffers[i].buffer;
+        bufferInfo.offset = 0;
+        bufferInfo.range  = buffers[i].bufferSize;
     }
 }
 
@@ -228,7 +354,7 @@ void DescriptorSetBindings::setDescInfo(uint32_t bindingIdx, const nvvk::Image*
         {
             continue;
         }
-        markDescriptorInfoDirty();
+        markDescriptorInfoDirty(bindingIdx);
         imageInfo = images[i].descriptor;
     }
 }
@@ -243,7 +369,7 @@ void DescriptorSetBindings::setDescInfo(uint32_t bindingIdx, const VkDescriptorB
         {
             continue;
         }
-        markDescriptorInfoDirty();
+        markDescriptorInfoDirty(bindingIdx);
         destBufferInfo = bufferInfos[i];
     }
 }
@@ -258,7 +384,7 @@ void DescriptorSetBindings::setDescInfo(uint32_t bindingIdx, const VkDescriptorI
         {
             continue;
         }
-        markDescriptorInfoDirty();
+        markDescriptorInfoDirty(bindingIdx);
         imageInfo = imageInfos[i];
     }
 }
@@ -272,7 +398,7 @@ void DescriptorSetBindings::setDescInfo(uint32_t bindingIdx, const VkAcceleratio
         {
             continue;
         }
-        markDescriptorInfoDirty();
+        markDescriptorInfoDirty(bindingIdx);
         accelInfo = accels[i];
     }
 }
@@ -297,12 +423,19 @@ int DescriptorSetBindings::descriptorOffset(uint32_t bindingIdx)
 
 uint64_t DescriptorSetBindings::getBindingsHash()
 {
-    if (_descInfoDirty)
+    if (!_descInfoDirty)
     {
-        _setBindingHash = memoryHash(_descInfos);
-
-        _descInfoDirty = 0;
+        return _setBindingHash;
     }
+    for (size_t i = 0; i < _bindingInfos.size() && i < _dirtyBindings.size(); ++i)
+    {
+        if (!_dirtyBindings[i]) continue;
+        const int offset  = descriptorOffset(_bindingInfos[i].bindingIdx);
+        _bindingHashes[i] = memoryHash(_descInfos.data() + offset, _bindingInfos[i].descriptorCount * sizeof(DescriptorInfo));
+        _dirtyBindings[i] = false;
+    }
+    _setBindingHash = memoryHash(_bindingHashes);
+    _descInfoDirty  = 0;
     return _setBindingHash;
 }
 
@@ -324,187 +457,328 @@ VkDescriptorSet DescriptorSetBindings::getOrAcquireDescriptorSet(DescriptorEnum
     }
 
     finalizeLayout();
-    if (!_descriptorSetDirty && _cachedDescriptorSet != VK_NULL_HANDLE)
+    DescriptorSetCache* descriptorCache = vkDriver->getDescriptorSetCache();
+    if (!_descriptorSetDirty && _cachedDescriptorSet != VK_NULL_HANDLE && _cachedSetFrame == descriptorCache->getCurrentFrame())
     {
         return _cachedDescriptorSet;
     }
 
-    _cachedDescriptorSet = vkDriver->getDescriptorSetCache()->requestDescriptorSet(this, static_cast<uint32_t>(_setSlot));
+    _cachedDescriptorSet = descriptorCache->requestDescriptorSet(this, static_cast<uint32_t>(_setSlot));
+    _cachedSetFrame      = descriptorCache->getCurrentFrame();
     _descriptorSetDirty  = false;
     return _cachedDescriptorSet;
 }
 
+std::optional<VkDeviceSize> DescriptorSetBindings::acquireDescriptorBufferOffset()
+{
+    finalizeLayout();
+    DescriptorSetCache* descriptorCache = vkDriver->getDescriptorSetCache();
+    if (_bufferOffsetFrame == descriptorCache->getCurrentFrame())
+    {
+        return _bufferOffset;
+    }
+
+    std::optional<VkDeviceSize> offset = descriptorCache->getDescriptorBuffer().writeTransientSet(*this);
+    if (!offset)
+    {
+        LOGE("Descriptor buffer ring is full, the set is not bound\n");
+        return std::nullopt;
+    }
+    _bufferOffset      = *offset;
+    _bufferOffsetFrame = descriptorCache->getCurrentFrame();
+    return offset;
+}
 
 
-DescriptorBufferManagerExt::~DescriptorBufferManagerExt() {}
+
+DescriptorBufferManagerExt::~DescriptorBufferManagerExt()
+{
+    deinit();
+}
 
 void DescriptorBufferManagerExt::init(VkPhysicalDevice physicalDevice, VkDevice device)
 {
     _device         = device;
     _physicalDevice = physicalDevice;
-    VkPhysicalDeviceDescriptorBufferPropertiesEXT descriptorBufferProperties{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT};
 
-    VkPhysicalDeviceProperties2 deviceProperties2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2};
-    deviceProperties2.pNext = &descriptorBufferProperties;
+    VkPhysicalDeviceDescriptorBufferFeaturesEXT descriptorBufferFeatures{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT};
+    VkPhysicalDeviceFeatures2                   deviceFeatures2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+    deviceFeatures2.pNext = &descriptorBufferFeatures;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &deviceFeatures2);
+    if (!descriptorBufferFeatures.descriptorBuffer)
+    {
+        LOGW("Descriptor buffers are not supported, descriptors are bound as sets\n");
+        return;
+    }
 
+    _descriptorBufferProperties = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT};
+    VkPhysicalDeviceProperties2 deviceProperties2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2};
+    deviceProperties2.pNext = &_descriptorBufferProperties;
     vkGetPhysicalDeviceProperties2(physicalDevice, &deviceProperties2);
 
-    _descriptorBufferProperties = descriptorBufferProperties;
+    // every set is bound from this buffer, so all of it has to be in reach of sampler and resource sets
+    const VkDeviceSize alignment  = std::max<VkDeviceSize>(_descriptorBufferProperties.descriptorBufferOffsetAlignment, 1);
+    const VkDeviceSize bufferSize = std::min({kPersistentBytes + kRingBytes, _descriptorBufferProperties.maxSamplerDescriptorBufferRange,
+                                              _descriptorBufferProperties.maxResourceDescriptorBufferRange});
+    _persistentBytes = std::min(kPersistentBytes, bufferSize / 2) / alignment * alignment;
 
     _descBuffer = RefPtr<Buffer>(new Buffer("DescBuffer",
                                             VK_BUFFER_USAGE_2_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_2_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT |
                                                 VK_BUFFER_USAGE_2_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT,
-                                            4096 * 32, (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)));
-}
-
-void DescriptorBufferManagerExt::deinit() {}
-
-// void DescriptorBufferManagerExt::updateDescSetBindingOffset(DescriptorSetManager* manager)
-// {
-//     // a series of descriptor sets' binding info
-//     const auto& setBindingInfo = manager->getSetBindingInfo();
-//     // for each set
-//     for (int setIdx = 0; setIdx < setBindingInfo.size(); ++setIdx)
-//     {
-//         const auto& setBinding = setBindingInfo[setIdx];
-//         // for each binding in the set
-//         for (auto& binding : setBinding.getBindings())
-//         {
-//             vkGetDescriptorSetLayoutBindingOffsetEXT(_device, manager->getDescriptorSetLayouts()[setIdx], binding.binding,
-//                                                      &_descriptorOffsetInfo[setIdx][binding.binding]);
-//         }
-//     }
-// }
-
-// void DescriptorBufferManagerExt::updateDescriptor(uint32_t setIdx, uint32_t bindingIdx, VkDescriptorType descriptorType, uint32_t descriptorCount,
-//                                                   Buffer* buffers)
-// {
-//     assert(_descriptorOffsetInfo[setIdx].find(bindingIdx) != _descriptorOffsetInfo[setIdx].end()); // ensure the binding exists
-//     uint8_t* descBufferPtr =
-//         _descBuffer->mapping + DescriptorSetOffsetMap[static_cast<DescriptorEnum>(setIdx)] + _descriptorOffsetInfo[setIdx][bindingIdx];
-//     size_t descSize = getDescriptorSize(descriptorType);
-//     for (int i = 0; i < descriptorCount; ++i)
-//     {
-//         VkDescriptorAddressInfoEXT addrInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT};
-//         addrInfo.address = buffers[i].address;
-//         addrInfo.format  = VK_FORMAT_UNDEFINED;
-//         addrInfo.range   = buffers[i].BufferRange();
-//         VkDescriptorGetInfoEXT bufferDescrptorInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT};
-//         bufferDescrptorInfo.type                = descriptorType;
-//         bufferDescrptorInfo.data.pUniformBuffer = &addrInfo;
-//         vkGetDescriptorEXT(_device, &bufferDescrptorInfo, _descriptorBufferProperties.uniformBufferDescriptorSize, descBufferPtr + i * descSize);
-//     }
-// }
-
-// void DescriptorBufferManagerExt::updateDescriptor(uint32_t setEnum, uint32_t bindingIdx, VkDescriptorType descriptorType, uint32_t descriptorCount,
-//                                                   nvvk::Image* images)
-// {
-//     assert(_descriptorOffsetInfo[setEnum].find(bindingIdx) == _descriptorOffsetInfo[setEnum].end()); // ensure the binding exists
-//     uint8_t* descBufferPtr =
-//         _descBuffer->mapping + DescriptorSetOffsetMap[static_cast<DescriptorEnum>(setEnum)] + _descriptorOffsetInfo[setEnum][bindingIdx];
-//     size_t descSize = getDescriptorSize(descriptorType);
-//     for (uint32_t i = 0; i < descriptorCount; ++i)
-//     {
-//         VkDescriptorImageInfo  imgInfo = images[i].descriptor;
-//         VkDescriptorGetInfoEXT imageDescrptorInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT};
-//         imageDescrptorInfo.type = descriptorType;
-//         if (descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
-//         {
-//             imageDescrptorInfo.data.pCombinedImageSampler = &imgInfo;
-//         }
-//         else if (descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
-//         {
-//             imageDescrptorInfo.data.pStorageImage = &imgInfo;
-//         }
-//         else if (descriptorType == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE)
-//         {
-//             imageDescrptorInfo.data.pSampledImage = &imgInfo;
-//         }
-//         else
-//         {
-//             LOGE("Unsupported descriptor type for image\n");
-//         }
-//         vkGetDescriptorEXT(_device, &imageDescrptorInfo, _descriptorBufferProperties.combinedImageSamplerDescriptorSize,
-//                            descBufferPtr + i * descSize);
-//     }
-// }
-
-// void DescriptorBufferManagerExt::updateDescriptor(uint32_t setEnum, uint32_t bindingIdx, VkDescriptorType descriptorType, uint32_t descriptorCount,
-//                                                   const VkBufferView* bufferViews)
-// {
-//     LOGW("Not implemented yet\n");
-// }
-
-// void DescriptorBufferManagerExt::updateDescriptor(uint32_t setEnum, uint32_t bindingIdx, VkDescriptorType descriptorType, uint32_t descriptorCount,
-//                                                   nvvk::AccelerationStructure* accels)
-// {
-//     assert(_descriptorOffsetInfo[setEnum].find(bindingIdx) != _descriptorOffsetInfo[setEnum].end()); // ensure the binding exists
-//     uint8_t* descBufferPtr =
-//         _descBuffer->mapping + DescriptorSetOffsetMap[static_cast<DescriptorEnum>(setEnum)] + _descriptorOffsetInfo[setEnum][bindingIdx];
-//     size_t descSize = getDescriptorSize(descriptorType);
-//     for (uint32_t i = 0; i < descriptorCount; ++i)
-//     {
-//         VkDescriptorGetInfoEXT accelDescrptorInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT};
-//         accelDescrptorInfo.type                       = descriptorType;
-//         accelDescrptorInfo.data.accelerationStructure = accels->address;
-//         vkGetDescriptorEXT(_device, &accelDescrptorInfo, _descriptorBufferProperties.accelerationStructureDescriptorSize,
-//                            descBufferPtr + i * descSize);
-//     }
-// }
-
-size_t DescriptorBufferManagerExt::getDescriptorSize(VkDescriptorType descriptorType)
-{
-    if (descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
-    {
-        return _descriptorBufferProperties.uniformBufferDescriptorSize;
-    }
-    else if (descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
-    {
-        return _descriptorBufferProperties.storageBufferDescriptorSize;
-    }
-    else if (descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
-    {
-        return _descriptorBufferProperties.combinedImageSamplerDescriptorSize;
-    }
-    else if (descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER)
-    {
-        return _descriptorBufferProperties.samplerDescriptorSize;
-    }
-    else if (descriptorType == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE)
-    {
-        return _descriptorBufferProperties.sampledImageDescriptorSize;
-    }
-    else if (descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
-    {
-        return _descriptorBufferProperties.storageImageDescriptorSize;
-    }
-    else if (descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER)
-    {
-        return _descriptorBufferProperties.uniformTexelBufferDescriptorSize;
-    }
-    else if (descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER)
-    {
-        return _descriptorBufferProperties.storageTexelBufferDescriptorSize;
-    }
-    else if (descriptorType == VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR)
-    {
-        return _descriptorBufferProperties.accelerationStructureDescriptorSize;
+                                            bufferSize, (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)));
+    _persistent.init(_persistentBytes);
+    _ring.init(bufferSize - _persistentBytes);
+    LOGI("Descriptor buffer of %llu KB, set offsets aligned to %llu bytes\n", static_cast<unsigned long long>(bufferSize / 1024),
+         static_cast<unsigned long long>(alignment));
+}
+
+void DescriptorBufferManagerExt::deinit()
+{
+    _descBuffer = nullptr;
+}
+
+void DescriptorBufferManagerExt::beginFrame(uint64_t frame, uint32_t framesInFlight)
+{
+    if (!isSupported()) return;
+    _ring.beginFrame(frame, framesInFlight);
+}
+
+VkDescriptorSetLayout DescriptorBufferManagerExt::createSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+    std::vector<VkDescriptorBindingFlags> bindingFlags(bindings.size(), 0);
+    for (size_t i = 0; i < bindings.size(); ++i)
+    {
+        bindingFlags[i] = bindings[i].descriptorCount > 1 ? VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT : 0;
     }
-    else
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO};
+    bindingFlagsInfo.bindingCount  = static_cast<uint32_t>(bindingFlags.size());
+    bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+    layoutInfo.pNext                = &bindingFlagsInfo;
+    layoutInfo.flags                = VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+    layoutInfo.bindingCount         = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings            = bindings.data();
+    VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+    NVVK_CHECK(vkCreateDescriptorSetLayout(_device, &layoutInfo, nullptr, &setLayout));
+
+    SetLayoutInfo& setLayoutInfo = _layoutInfos[setLayout];
+    vkGetDescriptorSetLayoutSizeEXT(_device, setLayout, &setLayoutInfo.size);
+    for (const VkDescriptorSetLayoutBinding& binding : bindings)
     {
-        throw std::runtime_error("Unsupported descriptor type");
+        vkGetDescriptorSetLayoutBindingOffsetEXT(_device, setLayout, binding.binding, &setLayoutInfo.bindingOffsets[binding.binding]);
     }
+    return setLayout;
 }
 
-DescriptorSetCache::~DescriptorSetCache()
+void DescriptorBufferManagerExt::destroySetLayout(VkDescriptorSetLayout layout)
+{
+    if (layout == VK_NULL_HANDLE) return;
+    _layoutInfos.erase(layout);
+    vkDestroyDescriptorSetLayout(_device, layout, nullptr);
+}
+
+const DescriptorBufferManagerExt::SetLayoutInfo& DescriptorBufferManagerExt::getLayoutInfo(VkDescriptorSetLayout layout)
+{
+    static const SetLayoutInfo emptyInfo;
+    auto                       res = _layoutInfos.find(layout);
+    if (res == _layoutInfos.end())
+    {
+        LOGE("Descriptor set layout was not created for the descriptor buffer\n");
+        return emptyInfo;
+    }
+    return res->second;
+}
+
+std::optional<VkDeviceSize> DescriptorBufferManagerExt::allocatePersistentSet(VkDescriptorSetLayout layout)
+{
+    const SetLayoutInfo&        layoutInfo = getLayoutInfo(layout);
+    std::optional<VkDeviceSize> offset     = _persistent.allocate(std::max<VkDeviceSize>(layoutInfo.size, 1),
+                                                                  _descriptorBufferProperties.descriptorBufferOffsetAlignment);
+    if (!offset)
+    {
+        LOGE("Descriptor buffer has no room left for a %llu byte set\n", static_cast<unsigned long long>(layoutInfo.size));
+    }
+    return offset;
+}
+
+void DescriptorBufferManagerExt::freePersistentSet(VkDeviceSize offset)
+{
+    _persistent.free(offset);
+}
+
+void DescriptorBufferManagerExt::writePersistentSet(VkDescriptorSetLayout layout, VkDeviceSize setOffset, const VkWriteDescriptorSet& write)
 {
-    for (auto& [layoutHash, cacheNode] : _descriptorPoolMap)
+    const SetLayoutInfo& layoutInfo    = getLayoutInfo(layout);
+    auto                 bindingOffset = layoutInfo.bindingOffsets.find(write.dstBinding);
+    if (!isSupported() || bindingOffset == layoutInfo.bindingOffsets.end()) return;
+
+    const size_t descriptorSize = getDescriptorSize(write.descriptorType);
+    uint8_t*     dst            = _descBuffer->mapping + setOffset + bindingOffset->second + write.dstArrayElement * descriptorSize;
+    const auto*  accelWrite     = write.descriptorType == VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR
+                                      ? static_cast<const VkWriteDescriptorSetAccelerationStructureKHR*>(write.pNext)
+                                      : nullptr;
+    for (uint32_t i = 0; i < write.descriptorCount; ++i)
     {
-        for (auto& poolNode : cacheNode->pools)
+        DescriptorInfo descriptorInfo{};
+        if (write.pImageInfo)
+        {
+            descriptorInfo.image = write.pImageInfo[i];
+        }
+        else if (write.pBufferInfo)
+        {
+            descriptorInfo.buffer = write.pBufferInfo[i];
+        }
+        else if (accelWrite)
+        {
+            descriptorInfo.accel = accelWrite->pAccelerationStructures[i];
+        }
+        writeDescriptor(write.descriptorType, descriptorInfo, dst + i * descriptorSize);
+    }
+}
+
+std::optional<VkDeviceSize> DescriptorBufferManagerExt::writeTransientSet(DescriptorSetBindings& setBindings)
+{
+    const VkDescriptorSetLayout layout = setBindings.getBufferSetLayout();
+    if (!isSupported() || layout == VK_NULL_HANDLE) return std::nullopt;
+
+    const SetLayoutInfo&        layoutInfo = getLayoutInfo(layout);
+    std::optional<VkDeviceSize> ringOffset =
+        _ring.allocate(std::max<VkDeviceSize>(layoutInfo.size, 1), _descriptorBufferProperties.descriptorBufferOffsetAlignment);
+    if (!ringOffset) return std::nullopt;
+
+    const VkDeviceSize                 setOffset       = _persistentBytes + *ringOffset;
+    const std::vector<DescriptorInfo>& descriptorInfos = setBindings.getDescriptorInfos();
+    for (const VkDescriptorSetLayoutBinding& binding : setBindings.getBindings())
+    {
+        auto bindingOffset = layoutInfo.bindingOffsets.find(binding.binding);
+        if (bindingOffset == layoutInfo.bindingOffsets.end()) continue;
+
+        const size_t descriptorSize  = getDescriptorSize(binding.descriptorType);
+        const int    firstDescriptor = setBindings.descriptorOffset(binding.binding);
+        uint8_t*     dst             = _descBuffer->mapping + setOffset + bindingOffset->second;
+        for (uint32_t i = 0; i < binding.descriptorCount; ++i)
+        {
+            writeDescriptor(binding.descriptorType, descriptorInfos[firstDescriptor + i], dst + i * descriptorSize);
+        }
+    }
+    return setOffset;
+}
+
+void DescriptorBufferManagerExt::writeDescriptor(VkDescriptorType descriptorType, const DescriptorInfo& descriptorInfo, uint8_t* dst) const
+{
+    // descriptors that were never set keep whatever the range held, the layouts bind arrays partially
+    VkDescriptorGetInfoEXT getInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT};
+    getInfo.type = descriptorType;
+    VkDescriptorAddressInfoEXT addressInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT};
+    switch (descriptorType)
+    {
+        case VK_DESCRIPTOR_TYPE_SAMPLER:
+            if (descriptorInfo.image.sampler == VK_NULL_HANDLE) return;
+            getInfo.data.pSampler = &descriptorInfo.image.sampler;
+            break;
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+            if (descriptorInfo.image.imageView == VK_NULL_HANDLE) return;
+            getInfo.data.pCombinedImageSampler = &descriptorInfo.image;
+            break;
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+            if (descriptorInfo.image.imageView == VK_NULL_HANDLE) return;
+            getInfo.data.pSampledImage = &descriptorInfo.image;
+            break;
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+            if (descriptorInfo.image.imageView == VK_NULL_HANDLE) return;
+            getInfo.data.pStorageImage = &descriptorInfo.image;
+            break;
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+        {
+            if (descriptorInfo.buffer.buffer == VK_NULL_HANDLE) return;
+            if (descriptorInfo.buffer.range == VK_WHOLE_SIZE)
+            {
+                LOGE("Descriptor buffers need an explicit buffer range\n");
+                return;
+            }
+            VkBufferDeviceAddressInfo bufferAddressInfo{VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO};
+            bufferAddressInfo.buffer = descriptorInfo.buffer.buffer;
+            addressInfo.address      = vkGetBufferDeviceAddress(_device, &bufferAddressInfo) + descriptorInfo.buffer.offset;
+            addressInfo.range        = descriptorInfo.buffer.range;
+            addressInfo.format       = VK_FORMAT_UNDEFINED;
+            if (descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+            {
+                getInfo.data.pUniformBuffer = &addressInfo;
+            }
+            else
+            {
+                getInfo.data.pStorageBuffer = &addressInfo;
+            }
+            break;
+        }
+        case VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR:
         {
-            vkDestroyDescriptorPool(vkDriver->getDevice(), poolNode.pool, nullptr);
+            if (descriptorInfo.accel == VK_NULL_HANDLE) return;
+            VkAccelerationStructureDeviceAddressInfoKHR accelAddressInfo{VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR};
+            accelAddressInfo.accelerationStructure = descriptorInfo.accel;
+            getInfo.data.accelerationStructure     = vkGetAccelerationStructureDeviceAddressKHR(_device, &accelAddressInfo);
+            break;
         }
+        default:
+            LOGE("Unsupported descriptor type in descriptor buffer\n");
+            return;
+    }
+    vkGetDescriptorEXT(_device, &getInfo, getDescriptorSize(descriptorType), dst);
+}
+
+void DescriptorBufferManagerExt::bindBuffer(VkCommandBuffer cmd)
+{
+    VkDescriptorBufferBindingInfoEXT bindingInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT};
+    bindingInfo.address = _descBuffer->address;
+    bindingInfo.usage   = VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT |
+                          VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT;
+    vkCmdBindDescriptorBuffersEXT(cmd, 1, &bindingInfo);
+}
+
+void DescriptorBufferManagerExt::bindSets(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t firstSet,
+                                          uint32_t setCount, const VkDeviceSize* offsets)
+{
+    // every set comes from the buffer bound at index 0
+    const std::array<uint32_t, static_cast<size_t>(DescriptorEnum::eCount)> bufferIndices = {};
+    vkCmdSetDescriptorBufferOffsetsEXT(cmd, bindPoint, layout, firstSet, setCount, bufferIndices.data(), offsets);
+}
+
+size_t DescriptorBufferManagerExt::getDescriptorSize(VkDescriptorType descriptorType) const
+{
+    switch (descriptorType)
+    {
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+            return _descriptorBufferProperties.uniformBufferDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+            return _descriptorBufferProperties.storageBufferDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+            return _descriptorBufferProperties.combinedImageSamplerDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_SAMPLER:
+            return _descriptorBufferProperties.samplerDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+            return _descriptorBufferProperties.sampledImageDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+            return _descriptorBufferProperties.storageImageDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+            return _descriptorBufferProperties.uniformTexelBufferDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+            return _descriptorBufferProperties.storageTexelBufferDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR:
+            return _descriptorBufferProperties.accelerationStructureDescriptorSize;
+        default:
+            LOGE("Unsupported descriptor type in descriptor buffer\n");
+            return 0;
     }
+}
+
+DescriptorSetCache::~DescriptorSetCache()
+{
+    _descriptorPoolMap.clear();
+    releaseCommonDescriptorBuffer(_globalDescriptorSet);
+    releaseCommonDescriptorBuffer(_sceneDescriptorSet);
+    releaseCommonDescriptorBuffer(_frameDescriptorSet);
     vkDestroyDescriptorPool(vkDriver->getDevice(), _globalDescriptorPool, nullptr);
     vkDestroyDescriptorPool(vkDriver->getDevice(), _sceneDescriptorPool, nullptr);
     vkDestroyDescriptorPool(vkDriver->getDevice(), _frameDescriptorPool, nullptr);
@@ -516,6 +790,81 @@ DescriptorSetCache::~DescriptorSetCache()
     _frameDescriptorSet.layout = VK_NULL_HANDLE;
 }
 
+uint64_t DescriptorSetCache::hashSetLayoutContent(VkDescriptorSetLayoutCreateFlags flags, const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+    uint64_t hash = 0;
+    nvutils::hashCombine(hash, flags);
+    for (const VkDescriptorSetLayoutBinding& binding : bindings)
+    {
+        nvutils::hashCombine(hash, binding.binding);
+        nvutils::hashCombine(hash, binding.descriptorType);
+        nvutils::hashCombine(hash, binding.descriptorCount);
+        nvutils::hashCombine(hash, binding.stageFlags);
+    }
+    return hash;
+}
+
+void DescriptorSetCache::registerSetLayout(VkDescriptorSetLayout layout, VkDescriptorSetLayoutCreateFlags flags,
+                                           const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+    if (layout == VK_NULL_HANDLE) return;
+    SetLayoutContent& content = _setLayoutContents[layout];
+    content.flags             = flags;
+    content.bindings          = bindings;
+    for (VkDescriptorSetLayoutBinding& binding : content.bindings)
+    {
+        binding.pImmutableSamplers = nullptr;
+    }
+    content.hash = hashSetLayoutContent(flags, content.bindings);
+    _setLayoutsByContent.try_emplace(content.hash, layout);
+}
+
+void DescriptorSetCache::unregisterSetLayout(VkDescriptorSetLayout layout)
+{
+    auto content = _setLayoutContents.find(layout);
+    if (content == _setLayoutContents.end()) return;
+    const uint64_t hash = content->second.hash;
+    _setLayoutContents.erase(content);
+
+    auto byContent = _setLayoutsByContent.find(hash);
+    if (byContent == _setLayoutsByContent.end() || byContent->second != layout) return;
+    _setLayoutsByContent.erase(byContent);
+    // another live layout with the same content takes over
+    for (const auto& [otherLayout, otherContent] : _setLayoutContents)
+    {
+        if (otherContent.hash == hash)
+        {
+            _setLayoutsByContent[hash] = otherLayout;
+            break;
+        }
+    }
+}
+
+const SetLayoutContent* DescriptorSetCache::getSetLayoutContent(VkDescriptorSetLayout layout) const
+{
+    auto content = _setLayoutContents.find(layout);
+    return content != _setLayoutContents.end() ? &content->second : nullptr;
+}
+
+uint64_t DescriptorSetCache::getSetLayoutKey(VkDescriptorSetLayout layout) const
+{
+    const SetLayoutContent* content = getSetLayoutContent(layout);
+    return content ? content->hash : reinterpret_cast<uint64_t>(layout);
+}
+
+VkDescriptorSetLayout DescriptorSetCache::findSetLayout(uint64_t contentHash) const
+{
+    auto layout = _setLayoutsByContent.find(contentHash);
+    return layout != _setLayoutsByContent.end() ? layout->second : VK_NULL_HANDLE;
+}
+
+void DescriptorSetCache::deInit()
+{
+    // the buffer goes before the resource manager shuts down, the layouts stay until the cache is destroyed
+    _useDescriptorBuffer = false;
+    _descriptorBuffer.deinit();
+}
+
 VkDescriptorSet DescriptorSetCache::requestDescriptorSet(DescriptorSetBindings* setManager, uint32_t setIdx)
 {
     if (setManager && setIdx >= static_cast<uint32_t>(DescriptorEnum::ePerPassDescriptorSet))
@@ -535,91 +884,224 @@ VkDescriptorSet DescriptorSetCache::requestDescriptorSet(DescriptorSetBindings*
                 return _frameDescriptorSet.set;
         }
     }
-    // if (setIdx >= static_cast<uint32_t>(DescriptorEnum::ePerPassDescriptorSet))
-    // {
     uint64_t BindingsHash = setManager->getBindingsHash();
     uint64_t layoutHash   = setManager->getDescsetLayoutHash();
     auto     res          = _descriptorPoolMap.find(layoutHash);
     // for perpass/perobject sets, we cache them , one layout one poolArray
-    if (res != _descriptorPoolMap.end())
+    if (res == _descriptorPoolMap.end())
+    { // damn new layout, create new pool array
+        LOGD("descriptorSet layout with hash {} is not founded, it's a never meeted descriptor layout", layoutHash);
+        auto allocator = std::make_unique<VulkanDescriptorPoolAllocator>(setManager->calculatePoolSizes(DescriptorSetLRU::kSetsPerPool));
+        res            = _descriptorPoolMap.emplace(layoutHash, std::make_unique<DescriptorSetLRU>(std::move(allocator))).first;
+    }
+
+    DescriptorSetLRU& layoutCache = *res->second;
+    // we find the descriptor with the same descriptor info
+    VkDescriptorSet descriptorSet = layoutCache.find(BindingsHash, _currentFrame);
+    if (descriptorSet != VK_NULL_HANDLE)
+    {
+        return descriptorSet;
+    }
+    // if same layout but different binding info, create new set from pool
+    LOGD("descriptorSet layout with hash {} got a new descriptor info, new descriptor set allocated", layoutHash);
+    descriptorSet = layoutCache.allocate(BindingsHash, _currentFrame, setManager->getSetLayout());
+    if (_benchmarkSetsLeft > 0)
+    {
+        benchmarkDescriptorSetWrite(descriptorSet, setManager);
+    }
+    writeDescriptorSet(descriptorSet, setManager);
+    return descriptorSet;
+}
+
+void DescriptorSetCache::beginFrame(uint64_t frame, uint32_t framesInFlight)
+{
+    _currentFrame = frame;
+    if (_settings.RunUpdateBenchmark)
+    {
+        _settings.RunUpdateBenchmark = false;
+        _benchmarkSetsLeft           = kBenchmarkSets;
+        _benchmarkArraysUs           = 0.0;
+        _benchmarkTemplateUs         = 0.0;
+        _stats.BenchmarkSets         = 0;
+    }
+    if (_settings.DescriptorBuffer && !_descriptorBuffer.isSupported())
     {
-        auto& cacheNode = *(res->second);
-        auto  setRes    = cacheNode.descriptorSetMap.find(BindingsHash);
-        // we find the descriptor with the same descriptor info
-        if (setRes != cacheNode.descriptorSetMap.end())
+        LOGW("Descriptor buffers are not supported, staying on descriptor sets\n");
+        _settings.DescriptorBuffer = false;
+    }
+    _useDescriptorBuffer = _settings.DescriptorBuffer;
+    _descriptorBuffer.beginFrame(frame, framesInFlight);
+
+    DescriptorSetLRUStats totals;
+    uint32_t              maxPools = 0;
+    for (auto& [layoutHash, layoutCache] : _descriptorPoolMap)
+    {
+        layoutCache->evict(frame, framesInFlight, _settings.StaleFrames, _settings.MaxSetsPerLayout);
+        const DescriptorSetLRUStats& layoutStats = layoutCache->getStats();
+        totals.liveSets     += layoutStats.liveSets;
+        totals.pools        += layoutStats.pools;
+        totals.hits         += layoutStats.hits;
+        totals.misses       += layoutStats.misses;
+        totals.evictedSets  += layoutStats.evictedSets;
+        totals.recycledSets += layoutStats.recycledSets;
+        totals.resetPools   += layoutStats.resetPools;
+        maxPools             = std::max(maxPools, layoutStats.pools);
+        if (_settings.LogLayouts)
         {
-            return setRes->second.descriptorSet;
-        }
-        else
-        { // if same layout but different binding info, create new set from pool
-            LOGD("descriptorSet layout with hash {} got a new descriptor info, new descriptor set allocated", layoutHash);
-            return createDescriptorSet(cacheNode, setManager);
+            LOGI("Descriptor set layout %016llx: %u live sets in %u pools, %llu hits, %llu misses, %llu evicted, %llu recycled\n",
+                 static_cast<unsigned long long>(layoutHash), layoutStats.liveSets, layoutStats.pools,
+                 static_cast<unsigned long long>(layoutStats.hits), static_cast<unsigned long long>(layoutStats.misses),
+                 static_cast<unsigned long long>(layoutStats.evictedSets), static_cast<unsigned long long>(layoutStats.recycledSets));
         }
     }
-    else
-    { // damn new layout, create new pool array
-        LOGD("descriptorSet layout with hash {} is not founded, it's a never meeted descriptor layout", layoutHash);
-        auto cacheNode                 = std::make_shared<DescriptorSetCache::CacheNode>();
-        _descriptorPoolMap[layoutHash] = cacheNode;
-        return createDescriptorSet(*cacheNode, setManager);
-    }
-    return VK_NULL_HANDLE;
+    _settings.LogLayouts = false;
+
+    const uint64_t requests  = totals.hits + totals.misses;
+    _stats.Layouts           = static_cast<uint32_t>(_descriptorPoolMap.size());
+    _stats.LiveSets          = totals.liveSets;
+    _stats.Pools             = totals.pools;
+    _stats.MaxPoolsPerLayout = maxPools;
+    _stats.HitRate           = requests > 0 ? static_cast<float>(totals.hits) / static_cast<float>(requests) : 0.0f;
+    _stats.FrameMisses       = static_cast<uint32_t>(totals.misses - std::min(_lastMisses, totals.misses));
+    _stats.EvictedSets       = static_cast<uint32_t>(totals.evictedSets);
+    _stats.RecycledSets      = static_cast<uint32_t>(totals.recycledSets);
+    _stats.ResetPools        = static_cast<uint32_t>(totals.resetPools);
+    _lastMisses              = totals.misses;
+
+    const DescriptorRingStats& ringStats = _descriptorBuffer.getRingStats();
+    _stats.DescriptorBuffer              = _useDescriptorBuffer;
+    _stats.BufferKB                      = static_cast<uint32_t>(_descriptorBuffer.getBufferSize() / 1024);
+    _stats.PersistentKB                  = static_cast<uint32_t>(_descriptorBuffer.getPersistentUsedBytes() / 1024);
+    _stats.RingKB                        = static_cast<uint32_t>(ringStats.usedBytes / 1024);
+    _stats.RingPeakKB                    = static_cast<uint32_t>(ringStats.peakUsedBytes / 1024);
+    _stats.RingWrites                    = static_cast<uint32_t>(ringStats.allocations - std::min(_lastRingWrites, ringStats.allocations));
+    _stats.RingFailures                  = static_cast<uint32_t>(ringStats.failedAllocations);
+    _lastRingWrites                      = ringStats.allocations;
+}
+
+void DescriptorSetCache::initDescriptorBuffer()
+{
+    _descriptorBuffer.init(vkDriver->getPhysicalDevice(), vkDriver->getDevice());
+}
+
+void DescriptorSetCache::initCommonDescriptorBuffer(nvvk::DescriptorBindings& setBindings, CommonDescriptorSet& commonSet)
+{
+    if (!_descriptorBuffer.isSupported()) return;
+    releaseCommonDescriptorBuffer(commonSet);
+    commonSet.bufferLayout                = _descriptorBuffer.createSetLayout(setBindings.getBindings());
+    registerSetLayout(commonSet.bufferLayout, VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT, setBindings.getBindings());
+    std::optional<VkDeviceSize> setOffset = _descriptorBuffer.allocatePersistentSet(commonSet.bufferLayout);
+    commonSet.bufferOffset                = setOffset.value_or(0);
+}
+
+void DescriptorSetCache::releaseCommonDescriptorBuffer(CommonDescriptorSet& commonSet)
+{
+    if (commonSet.bufferLayout == VK_NULL_HANDLE) return;
+    _descriptorBuffer.freePersistentSet(commonSet.bufferOffset);
+    unregisterSetLayout(commonSet.bufferLayout);
+    _descriptorBuffer.destroySetLayout(commonSet.bufferLayout);
+    commonSet.bufferLayout = VK_NULL_HANDLE;
+    commonSet.bufferOffset = 0;
 }
 
-VkDescriptorSet DescriptorSetCache::createDescriptorSet(DescriptorSetCache::CacheNode& cacheNode, DescriptorSetBindings* setManager)
+void DescriptorSetCache::updateCommonDescriptorSets(const VkWriteDescriptorSet* writes, uint32_t writeCount)
 {
-    // without free native vulkan pool, we create new pool
-    [[unlikely]]
-    if (cacheNode.pools.empty() || cacheNode.pools.back().availableCount == 0)
+    vkUpdateDescriptorSets(vkDriver->getDevice(), writeCount, writes, 0, nullptr);
+    if (!_descriptorBuffer.isSupported()) return;
+
+    // the scene set is update after bind, its mirror is rewritten in place the same way
+    for (uint32_t i = 0; i < writeCount; ++i)
     {
-        // create new pool;
-        std::vector<VkDescriptorPoolSize> poolSizes = setManager->calculatePoolSizes(CacheNode::PoolNode::maxSetPerPool);
-        VkDescriptorPoolCreateInfo        poolCreateInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
-        poolCreateInfo.maxSets       = CacheNode::PoolNode::maxSetPerPool;
-        poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-        poolCreateInfo.pPoolSizes    = poolSizes.data();
-        CacheNode::PoolNode newPoolNode;
-        NVVK_CHECK(vkCreateDescriptorPool(vkDriver->getDevice(), &poolCreateInfo, nullptr, &newPoolNode.pool));
-        cacheNode.pools.push_back(newPoolNode);
-        CacheNode::CachedSet newSet = createDescriptorSetImplement(cacheNode, setManager);
-        return newSet.descriptorSet;
+        const VkDescriptorSet dstSet    = writes[i].dstSet;
+        CommonDescriptorSet*  commonSet = dstSet == _globalDescriptorSet.set  ? &_globalDescriptorSet
+                                          : dstSet == _sceneDescriptorSet.set ? &_sceneDescriptorSet
+                                          : dstSet == _frameDescriptorSet.set ? &_frameDescriptorSet
+                                                                              : nullptr;
+        if (!commonSet || commonSet->bufferLayout == VK_NULL_HANDLE) continue;
+        _descriptorBuffer.writePersistentSet(commonSet->bufferLayout, commonSet->bufferOffset, writes[i]);
     }
-    else
+}
+
+void DescriptorSetCache::writeDescriptorSet(VkDescriptorSet descriptorSet, DescriptorSetBindings* setManager)
+{
+    // the template reads the descriptor infos in place, no write arrays to build
+    if (_settings.UpdateTemplates && setManager->getUpdateTemplate() != VK_NULL_HANDLE)
     {
-        CacheNode::CachedSet newSet = createDescriptorSetImplement(cacheNode, setManager);
-        return newSet.descriptorSet;
+        vkUpdateDescriptorSetWithTemplate(vkDriver->getDevice(), descriptorSet, setManager->getUpdateTemplate(),
+                                          setManager->getDescriptorInfos().data());
+        return;
     }
+    writeDescriptorSetWithArrays(descriptorSet, setManager);
 }
 
-DescriptorSetCache::CacheNode::CachedSet DescriptorSetCache::createDescriptorSetImplement(CacheNode& cacheNode, DescriptorSetBindings* setManager)
+void DescriptorSetCache::benchmarkDescriptorSetWrite(VkDescriptorSet descriptorSet, DescriptorSetBindings* setManager)
 {
-    auto                        newSet = cacheNode.createCachedSet();
-    VkDescriptorSetAllocateInfo allocInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
-    allocInfo.descriptorPool     = cacheNode.pools.back().pool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts        = &setManager->getSetLayout();
+    // the set was just allocated and is not bound anywhere, so writing it repeatedly is fine
+    if (setManager->getUpdateTemplate() == VK_NULL_HANDLE) return;
+    using Clock = std::chrono::steady_clock;
 
-    NVVK_CHECK(vkAllocateDescriptorSets(vkDriver->getDevice(), &allocInfo, &newSet.descriptorSet));
-    uint64_t BindingsHash                    = setManager->getBindingsHash();
-    cacheNode.descriptorSetMap[BindingsHash] = newSet;
-    // currently new descriptor set allocated success, decrease the available count
-    cacheNode.pools.back().availableCount--;
+    auto timeArrays = [&]()
+    {
+        const Clock::time_point start = Clock::now();
+        for (uint32_t i = 0; i < kBenchmarkIterations; ++i)
+        {
+            writeDescriptorSetWithArrays(descriptorSet, setManager);
+        }
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / kBenchmarkIterations;
+    };
+    auto timeTemplate = [&]()
+    {
+        const Clock::time_point start = Clock::now();
+        for (uint32_t i = 0; i < kBenchmarkIterations; ++i)
+        {
+            vkUpdateDescriptorSetWithTemplate(vkDriver->getDevice(), descriptorSet, setManager->getUpdateTemplate(),
+                                              setManager->getDescriptorInfos().data());
+        }
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / kBenchmarkIterations;
+    };
 
-    auto                                                 nativeBindings = setManager->getBindings();
+    // the first way to touch a new set pays for the cold caches, so every other set starts with the template
+    if (_stats.BenchmarkSets % 2 == 0)
+    {
+        _benchmarkArraysUs   += timeArrays();
+        _benchmarkTemplateUs += timeTemplate();
+    }
+    else
+    {
+        _benchmarkTemplateUs += timeTemplate();
+        _benchmarkArraysUs   += timeArrays();
+    }
+    --_benchmarkSetsLeft;
+    ++_stats.BenchmarkSets;
+    _stats.WriteArrayMicroseconds = static_cast<float>(_benchmarkArraysUs / _stats.BenchmarkSets);
+    _stats.TemplateMicroseconds   = static_cast<float>(_benchmarkTemplateUs / _stats.BenchmarkSets);
+    if (_benchmarkSetsLeft == 0)
+    {
+        LOGI("Descriptor set writes over %u sets: %.2f us with write arrays, %.2f us with update templates\n", _stats.BenchmarkSets,
+             _stats.WriteArrayMicroseconds, _stats.TemplateMicroseconds);
+    }
+}
+
+void DescriptorSetCache::writeDescriptorSetWithArrays(VkDescriptorSet descriptorSet, DescriptorSetBindings* setManager)
+{
+    const auto&                                          nativeBindings = setManager->getBindings();
+    const std::vector<DescriptorInfo>&                   descriptorInfo = setManager->getDescriptorInfos();
     std::vector<VkWriteDescriptorSet>                    writeSets;
     std::vector<std::vector<VkDescriptorImageInfo>>      imageInfosArray;
     std::vector<std::vector<VkDescriptorBufferInfo>>     bufferInfosArray;
     std::vector<std::vector<VkAccelerationStructureKHR>> accelInfosArray;
+    // pNext of the writes points in here, so it must not reallocate
+    std::vector<VkWriteDescriptorSetAccelerationStructureKHR> accelWrites;
+    accelWrites.reserve(nativeBindings.size());
     for (auto& binding : nativeBindings)
     {
         // binding info is general, easy to fill
         VkWriteDescriptorSet writeSet{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
-        writeSet.dstSet          = newSet.descriptorSet;
+        writeSet.dstSet          = descriptorSet;
         writeSet.dstBinding      = binding.binding;
         writeSet.descriptorCount = binding.descriptorCount;
         writeSet.descriptorType  = binding.descriptorType;
         writeSet.dstArrayElement = 0;
-        auto descriptorInfo      = setManager->getDescriptorInfos();
         switch (binding.descriptorType)
         {
             // if the resource is image type, we give image info
@@ -660,16 +1142,17 @@ DescriptorSetCache::CacheNode::CachedSet DescriptorSetCache::createDescriptorSet
             // if the resource is acceleration structure type, we give accel info
             case VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR:
             {
-                uint32_t                                offset = setManager->descriptorOffset(binding.binding);
-                std::vector<VkAccelerationStructureKHR> accelInfos(binding.descriptorCount);
-                for (int i = offset; i < binding.descriptorCount; ++i)
+                uint32_t                                 offset     = setManager->descriptorOffset(binding.binding);
+                std::vector<VkAccelerationStructureKHR>& accelInfos = accelInfosArray.emplace_back(binding.descriptorCount);
+                for (int i = 0; i < binding.descriptorCount; ++i)
                 {
-                    accelInfos[i] = descriptorInfo[i].accel;
+                    accelInfos[i] = descriptorInfo[i + offset].accel;
                 }
-                VkWriteDescriptorSetAccelerationStructureKHR accelInfo{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR};
-                accelInfo.accelerationStructureCount = binding.descriptorCount;
-                accelInfo.pAccelerationStructures    = accelInfos.data();
-                writeSet.pNext                       = &accelInfo;
+                VkWriteDescriptorSetAccelerationStructureKHR& accelInfo = accelWrites.emplace_back();
+                accelInfo.sType                                         = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR;
+                accelInfo.accelerationStructureCount                    = binding.descriptorCount;
+                accelInfo.pAccelerationStructures                       = accelInfos.data();
+                writeSet.pNext                                          = &accelInfo;
                 break;
             }
             default:
@@ -680,7 +1163,6 @@ DescriptorSetCache::CacheNode::CachedSet DescriptorSetCache::createDescriptorSet
     }
     // Update the descriptor set with the new binding information
     vkUpdateDescriptorSets(vkDriver->getDevice(), static_cast<uint32_t>(writeSets.size()), writeSets.data(), 0, nullptr);
-    return newSet;
 }
 
 void DescriptorSetCache::initGlobalDescriptorSets(nvvk::DescriptorBindings& setBindings)
@@ -692,11 +1174,13 @@ void DescriptorSetCache::initGlobalDescriptorSets(nvvk::DescriptorBindings& setB
     poolInfo.maxSets                            = 1;
     NVVK_CHECK(vkCreateDescriptorPool(vkDriver->getDevice(), &poolInfo, nullptr, &_globalDescriptorPool));
     setBindings.createDescriptorSetLayout(vkDriver->getDevice(), 0, &_globalDescriptorSet.layout);
+    registerSetLayout(_globalDescriptorSet.layout, 0, setBindings.getBindings());
     VkDescriptorSetAllocateInfo allocInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
     allocInfo.descriptorPool     = _globalDescriptorPool;
     allocInfo.descriptorSetCount = 1;
     allocInfo.pSetLayouts        = &_globalDescriptorSet.layout;
     NVVK_CHECK(vkAllocateDescriptorSets(vkDriver->getDevice(), &allocInfo, &_globalDescriptorSet.set));
+    initCommonDescriptorBuffer(setBindings, _globalDescriptorSet);
 }
 void DescriptorSetCache::initFrameDescriptorSets(nvvk::DescriptorBindings& setBindings)
 {
@@ -707,11 +1191,13 @@ void DescriptorSetCache::initFrameDescriptorSets(nvvk::DescriptorBindings& setBi
     poolInfo.maxSets                            = 1;
     NVVK_CHECK(vkCreateDescriptorPool(vkDriver->getDevice(), &poolInfo, nullptr, &_frameDescriptorPool));
     setBindings.createDescriptorSetLayout(vkDriver->getDevice(), 0, &_frameDescriptorSet.layout);
+    registerSetLayout(_frameDescriptorSet.layout, 0, setBindings.getBindings());
     VkDescriptorSetAllocateInfo allocInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
     allocInfo.descriptorPool     = _frameDescriptorPool;
     allocInfo.descriptorSetCount = 1;
     allocInfo.pSetLayouts        = &_frameDescriptorSet.layout;
     NVVK_CHECK(vkAllocateDescriptorSets(vkDriver->getDevice(), &allocInfo, &_frameDescriptorSet.set));
+    initCommonDescriptorBuffer(setBindings, _frameDescriptorSet);
 }
 void DescriptorSetCache::initSceneDescriptorSets(nvvk::DescriptorBindings& setBindings)
 {
@@ -724,11 +1210,13 @@ void DescriptorSetCache::initSceneDescriptorSets(nvvk::DescriptorBindings& setBi
     NVVK_CHECK(vkCreateDescriptorPool(vkDriver->getDevice(), &poolInfo, nullptr, &_sceneDescriptorPool));
     setBindings.createDescriptorSetLayout(vkDriver->getDevice(), VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
                                           &_sceneDescriptorSet.layout);
+    registerSetLayout(_sceneDescriptorSet.layout, VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT, setBindings.getBindings());
     VkDescriptorSetAllocateInfo allocInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
     allocInfo.descriptorPool     = _sceneDescriptorPool;
     allocInfo.descriptorSetCount = 1;
     allocInfo.pSetLayouts        = &_sceneDescriptorSet.layout;
     NVVK_CHECK(vkAllocateDescriptorSets(vkDriver->getDevice(), &allocInfo, &_sceneDescriptorSet.set));
+    initCommonDescriptorBuffer(setBindings, _sceneDescriptorSet);
 }
 
 } // namespace Play
\ No newline at end of file
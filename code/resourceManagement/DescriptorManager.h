@@ -3,6 +3,8 @@
 #include "Resource.h"
 #include "utils.hpp"
 #include "core/RefCounted.h"
+#include "DescriptorSetLRU.h"
+#include "DescriptorBufferAllocator.h"
 #include <nvvk/descriptors.hpp>
 namespace Play
 {
@@ -61,17 +63,19 @@ public:
     void setDescInfo(uint32_t bindingIdx, VkAccelerationStructureKHR accel);
 
     // writeSet.descriptorCount many elements
-    void setDescInfo(uint32_t bindingIdx, const nvvk::Buffer* buffers, uint32_t count); // offset 0 and VK_WHOLE_SIZE
+    void setDescInfo(uint32_t bindingIdx, const nvvk::Buffer* buffers, uint32_t count); // offset 0 and the whole buffer
     void setDescInfo(uint32_t bindingIdx, const nvvk::Image* images, uint32_t count);
     void setDescInfo(uint32_t bindingIdx, const VkDescriptorBufferInfo* bufferInfos, uint32_t count);
     void setDescInfo(uint32_t bindingIdx, const VkDescriptorImageInfo* imageInfos, uint32_t count);
     void setDescInfo(uint32_t bindingIdx, const VkAccelerationStructureKHR* accels, uint32_t count);
 
     int                   descriptorOffset(uint32_t bindingIdx);
-    uint64_t              getBindingsHash(); // flush dirty flag
+    uint64_t              getBindingsHash(); // flush dirty flag, only bindings written since the last call are hashed again
     uint64_t              getDescsetLayoutHash();
     VkDescriptorSetLayout finalizeLayout(); // flush recorded flag
     VkDescriptorSet       getOrAcquireDescriptorSet(DescriptorEnum setSlot = DescriptorEnum::eCount);
+    // descriptor buffer backend, the ring offset of the current descriptor infos
+    std::optional<VkDeviceSize> acquireDescriptorBufferOffset();
 
     bool isLayoutDirty() const
     {
@@ -93,11 +97,23 @@ public:
         return _layout;
     }
 
+    // null unless the device supports descriptor buffers
+    VkDescriptorSetLayout getBufferSetLayout() const
+    {
+        return _bufferLayout;
+    }
+
     VkDescriptorSet getCachedDescriptorSet() const
     {
         return _cachedDescriptorSet;
     }
 
+    // reads the descriptor infos straight from getDescriptorInfos(), one entry per binding
+    VkDescriptorUpdateTemplate getUpdateTemplate() const
+    {
+        return _updateTemplate;
+    }
+
     const std::vector<DescriptorInfo>& getDescriptorInfos()
     {
         return _descInfos;
@@ -107,64 +123,150 @@ protected:
     std::vector<BindInfo>       _bindingInfos;
     uint64_t                    _setBindingHash = 0;
     VkDescriptorSetLayout       _layout         = VK_NULL_HANDLE;
+    VkDescriptorSetLayout       _bufferLayout   = VK_NULL_HANDLE;
     std::vector<DescriptorInfo> _descInfos;
+    VkDescriptorUpdateTemplate  _updateTemplate = VK_NULL_HANDLE;
 
 private:
     void markLayoutDirty();
-    void markDescriptorInfoDirty();
+    void markDescriptorInfoDirty(uint32_t bindingIdx);
+    void createUpdateTemplate();
+    void destroyUpdateTemplate();
 
     DescriptorEnum  _setSlot             = DescriptorEnum::eCount;
     VkDescriptorSet _cachedDescriptorSet = VK_NULL_HANDLE;
+    uint64_t        _cachedSetFrame      = ~0ULL; // the cache may evict between frames, so the handle is only reused within one
+    VkDeviceSize    _bufferOffset        = 0;
+    uint64_t        _bufferOffsetFrame   = ~0ULL; // ring ranges are reused once their frame completed
     bool            _setLayoutDirty      = true; // layout changing state
     uint8_t         _descInfoDirty       = 0;    // descinfo changing state | bit0: binding changed, bit1: constant range changed
     bool            _descriptorSetDirty  = true;
-};
-// 256 descriptor slot for global
-const size_t GLOBAL_DESCRIPTOR_SET_OFFSET = 0;
-// 2048 descriptor slot for scene
-const size_t PER_SCENE_DESCRIPTOR_SET_OFFSET = 256 * 32;
-// 512 descriptor slot for frame
-const size_t PER_FRAME_DESCRIPTOR_SET_OFFSET = (256 + 2048) * 32;
-// 256 descriptor slot for pass
-const size_t PER_PASS_DESCRIPTOR_SET_OFFSET = (256 + 2048 + 512) * 32;
-// 1024 descriptor slot for draw object
-const size_t PER_DRAW_OBJECT_DESCRIPTOR_SET_OFFSET = 3072 * 32;
 
+    // indexed like _bindingInfos
+    std::vector<uint64_t> _bindingHashes;
+    std::vector<bool>     _dirtyBindings;
+};
+// writes descriptors straight into one host visible buffer through VK_EXT_descriptor_buffer. The global, scene and frame
+// sets live in long lived regions, the per pass and per object sets are rewritten into a ring every time they change
+// and bound by offset, so neither side allocates sets or hashes bindings
 class DescriptorBufferManagerExt
 {
 public:
+    static constexpr VkDeviceSize kPersistentBytes = 256 * 1024;
+    static constexpr VkDeviceSize kRingBytes       = 4 * 1024 * 1024;
+
     DescriptorBufferManagerExt() = default;
     ~DescriptorBufferManagerExt();
     void init(VkPhysicalDevice physicalDevice, VkDevice device);
     void deinit();
-    // void updateDescSetBindingOffset(DescriptorSetManager* manager);
 
-    void updateDescriptor(uint32_t setIdx, uint32_t bindingIdx, VkDescriptorType descriptorType, uint32_t descriptorCount, Buffer* buffers);
+    bool isSupported() const
+    {
+        return _descBuffer.get() != nullptr;
+    }
+
+    void beginFrame(uint64_t frame, uint32_t framesInFlight);
+
+    // a layout with the descriptor buffer flag, arrays are partially bound like the bindless scene textures
+    VkDescriptorSetLayout createSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+    void                  destroySetLayout(VkDescriptorSetLayout layout);
+
+    std::optional<VkDeviceSize> allocatePersistentSet(VkDescriptorSetLayout layout);
+    void                        freePersistentSet(VkDeviceSize offset);
+    // mirrors a descriptor set write into the persistent set at setOffset
+    void writePersistentSet(VkDescriptorSetLayout layout, VkDeviceSize setOffset, const VkWriteDescriptorSet& write);
+    // the current descriptor infos of setBindings in a fresh ring range, nullopt when the ring is full
+    std::optional<VkDeviceSize> writeTransientSet(DescriptorSetBindings& setBindings);
 
-    void updateDescriptor(uint32_t setIdx, uint32_t bindingIdx, VkDescriptorType descriptorType, uint32_t descriptorCount, nvvk::Image* imageInfos);
+    void bindBuffer(VkCommandBuffer cmd);
+    void bindSets(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t firstSet, uint32_t setCount,
+                  const VkDeviceSize* offsets);
 
-    void updateDescriptor(uint32_t setIdx, uint32_t bindingIdx, VkDescriptorType descriptorType, uint32_t descriptorCount,
-                          const VkBufferView* bufferViews);
+    const DescriptorRingStats& getRingStats() const
+    {
+        return _ring.getStats();
+    }
 
-    void updateDescriptor(uint32_t setIdx, uint32_t bindingIdx, VkDescriptorType descriptorType, uint32_t descriptorCount,
-                          nvvk::AccelerationStructure* accels);
+    VkDeviceSize getPersistentUsedBytes() const
+    {
+        return _persistent.getUsedBytes();
+    }
 
+    VkDeviceSize getBufferSize() const
+    {
+        return _persistentBytes + _ring.getCapacity();
+    }
 
 protected:
-    size_t getDescriptorSize(VkDescriptorType descriptorType);
+    size_t getDescriptorSize(VkDescriptorType descriptorType) const;
 
 private:
-    RefPtr<Buffer>                                                                                      _descBuffer;
-    VkDevice                                                                                            _device;
-    VkPhysicalDevice                                                                                    _physicalDevice;
-    VkPhysicalDeviceDescriptorBufferPropertiesEXT                                                   _descriptorBufferProperties;
-    std::array<std::unordered_map<uint32_t, size_t>, static_cast<uint32_t>(DescriptorEnum::eCount)> _descriptorOffsetInfo;
+    struct SetLayoutInfo
+    {
+        VkDeviceSize                               size = 0;
+        std::unordered_map<uint32_t, VkDeviceSize> bindingOffsets;
+    };
+
+    const SetLayoutInfo& getLayoutInfo(VkDescriptorSetLayout layout);
+    void                 writeDescriptor(VkDescriptorType descriptorType, const DescriptorInfo& descriptorInfo, uint8_t* dst) const;
+
+    RefPtr<Buffer>                                           _descBuffer;
+    VkDevice                                                 _device          = VK_NULL_HANDLE;
+    VkPhysicalDevice                                         _physicalDevice  = VK_NULL_HANDLE;
+    VkPhysicalDeviceDescriptorBufferPropertiesEXT            _descriptorBufferProperties{};
+    std::unordered_map<VkDescriptorSetLayout, SetLayoutInfo> _layoutInfos;
+    VkDeviceSize                                             _persistentBytes = 0; // the ring follows the persistent sets
+    DescriptorOffsetAllocator                                _persistent;
+    DescriptorRingAllocator                                  _ring;
 };
 
 struct CommonDescriptorSet
 {
     VkDescriptorSet       set;
     VkDescriptorSetLayout layout;
+    VkDescriptorSetLayout bufferLayout = VK_NULL_HANDLE; // descriptor buffer backend
+    VkDeviceSize          bufferOffset = 0;
+};
+
+// what a set layout was created from. Pipeline layouts key on it instead of the handle, so their keys hold across runs
+struct SetLayoutContent
+{
+    VkDescriptorSetLayoutCreateFlags          flags = 0;
+    std::vector<VkDescriptorSetLayoutBinding> bindings; // without immutable samplers
+    uint64_t                                  hash  = 0;
+};
+
+struct DescriptorSetCacheSettings
+{
+    uint32_t MaxSetsPerLayout   = 256;   // least recently used sets past this are freed once no frame in flight reads them
+    uint32_t StaleFrames        = 120;   // pools whose sets all went unused this long are reset
+    bool     LogLayouts         = false; // one-shot, logs the sets and pools of every layout
+    bool     DescriptorBuffer   = false; // binds through VK_EXT_descriptor_buffer from the next frame on
+    bool     UpdateTemplates    = true;  // writes new sets with vkUpdateDescriptorSetWithTemplate instead of write arrays
+    bool     RunUpdateBenchmark = false; // one-shot, writes the next new sets both ways and times them
+};
+
+struct DescriptorSetCacheStats
+{
+    uint32_t Layouts                = 0;
+    uint32_t LiveSets               = 0;
+    uint32_t Pools                  = 0;
+    uint32_t MaxPoolsPerLayout      = 0;
+    float    HitRate                = 0.0f; // since startup
+    uint32_t FrameMisses            = 0;    // sets allocated in the last frame
+    uint32_t EvictedSets            = 0;
+    uint32_t RecycledSets           = 0;
+    uint32_t ResetPools             = 0;
+    bool     DescriptorBuffer       = false; // the backend of the current frame
+    uint32_t BufferKB               = 0;
+    uint32_t PersistentKB           = 0; // global, scene and frame sets
+    uint32_t RingKB                 = 0; // per pass and per object sets of the frames in flight
+    uint32_t RingPeakKB             = 0;
+    uint32_t RingWrites             = 0; // sets written in the last frame
+    uint32_t RingFailures           = 0;
+    uint32_t BenchmarkSets          = 0;
+    float    WriteArrayMicroseconds = 0.0f; // per set, building the write arrays included
+    float    TemplateMicroseconds   = 0.0f; // per set
 };
 
 class DescriptorSetCache
@@ -190,41 +292,82 @@ public:
     void initGlobalDescriptorSets(nvvk::DescriptorBindings& setBindings);
     void initFrameDescriptorSets(nvvk::DescriptorBindings& setBindings);
     void initSceneDescriptorSets(nvvk::DescriptorBindings& setBindings);
+    void initDescriptorBuffer();
+    // writes of the global, scene and frame sets, mirrored into the descriptor buffer
+    void updateCommonDescriptorSets(const VkWriteDescriptorSet* writes, uint32_t writeCount);
+
+    // called once the fence of the frame slot was waited, evicts the per pass and per object sets no frame in flight reads
+    void beginFrame(uint64_t frame, uint32_t framesInFlight);
+
+    uint64_t getCurrentFrame() const
+    {
+        return _currentFrame;
+    }
+
+    bool useDescriptorBuffer() const
+    {
+        return _useDescriptorBuffer;
+    }
+
+    DescriptorBufferManagerExt& getDescriptorBuffer()
+    {
+        return _descriptorBuffer;
+    }
+
+    DescriptorSetCacheSettings& getSettings()
+    {
+        return _settings;
+    }
+
+    DescriptorSetCacheStats& getStats()
+    {
+        return _stats;
+    }
+
+    // every set layout handed to a pipeline layout is registered from its creation until it is destroyed
+    void                    registerSetLayout(VkDescriptorSetLayout layout, VkDescriptorSetLayoutCreateFlags flags,
+                                              const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+    void                    unregisterSetLayout(VkDescriptorSetLayout layout);
+    const SetLayoutContent* getSetLayoutContent(VkDescriptorSetLayout layout) const;
+    // the content hash of a registered layout, the handle itself otherwise
+    uint64_t getSetLayoutKey(VkDescriptorSetLayout layout) const;
+    // a live layout with this content hash, VK_NULL_HANDLE if there is none
+    VkDescriptorSetLayout findSetLayout(uint64_t contentHash) const;
+
+    static uint64_t hashSetLayoutContent(VkDescriptorSetLayoutCreateFlags flags, const std::vector<VkDescriptorSetLayoutBinding>& bindings);
 
 private:
-    struct CacheNode
-    {
-        struct PoolNode
-        {
-            static const uint32_t maxSetPerPool = 32;
-            VkDescriptorPool      pool;
-            uint32_t              availableCount = maxSetPerPool;
-            uint64_t              lastUsedFrame  = 0;
-        };
-        struct CachedSet
-        {
-            uint32_t        parentPoolIndex;
-            VkDescriptorSet descriptorSet;
-        };
-        CachedSet createCachedSet()
-        {
-            CachedSet newSet;
-            newSet.parentPoolIndex = pools.size() - 1;
-            newSet.descriptorSet   = VK_NULL_HANDLE;
-            return newSet;
-        }
-        std::unordered_map<size_t, CachedSet> descriptorSetMap;
-        std::vector<PoolNode>                 pools;
-    };
-    VkDescriptorSet                                          createDescriptorSet(CacheNode& cacheNode, DescriptorSetBindings* setManager);
-    CacheNode::CachedSet                                     createDescriptorSetImplement(CacheNode& cacheNode, DescriptorSetBindings* setManager);
-    std::unordered_map<uint64_t, std::shared_ptr<CacheNode>> _descriptorPoolMap;
-    CommonDescriptorSet                                      _globalDescriptorSet  = {VK_NULL_HANDLE, VK_NULL_HANDLE};
-    VkDescriptorPool                                         _globalDescriptorPool = VK_NULL_HANDLE;
-    CommonDescriptorSet                                      _sceneDescriptorSet   = {VK_NULL_HANDLE, VK_NULL_HANDLE};
-    VkDescriptorPool                                         _sceneDescriptorPool  = VK_NULL_HANDLE;
-    CommonDescriptorSet                                      _frameDescriptorSet   = {VK_NULL_HANDLE, VK_NULL_HANDLE};
-    VkDescriptorPool                                         _frameDescriptorPool  = VK_NULL_HANDLE;
+    static constexpr uint32_t kBenchmarkSets       = 64;
+    static constexpr uint32_t kBenchmarkIterations = 16;
+
+    void writeDescriptorSet(VkDescriptorSet descriptorSet, DescriptorSetBindings* setManager);
+    void writeDescriptorSetWithArrays(VkDescriptorSet descriptorSet, DescriptorSetBindings* setManager);
+    void benchmarkDescriptorSetWrite(VkDescriptorSet descriptorSet, DescriptorSetBindings* setManager);
+    void initCommonDescriptorBuffer(nvvk::DescriptorBindings& setBindings, CommonDescriptorSet& commonSet);
+    void releaseCommonDescriptorBuffer(CommonDescriptorSet& commonSet);
+
+    // per pass and per object sets, one cache per layout
+    std::unordered_map<uint64_t, std::unique_ptr<DescriptorSetLRU>> _descriptorPoolMap;
+    CommonDescriptorSet _globalDescriptorSet  = {VK_NULL_HANDLE, VK_NULL_HANDLE};
+    VkDescriptorPool    _globalDescriptorPool = VK_NULL_HANDLE;
+    CommonDescriptorSet _sceneDescriptorSet   = {VK_NULL_HANDLE, VK_NULL_HANDLE};
+    VkDescriptorPool    _sceneDescriptorPool  = VK_NULL_HANDLE;
+    CommonDescriptorSet _frameDescriptorSet   = {VK_NULL_HANDLE, VK_NULL_HANDLE};
+    VkDescriptorPool    _frameDescriptorPool  = VK_NULL_HANDLE;
+
+    std::unordered_map<VkDescriptorSetLayout, SetLayoutContent> _setLayoutContents;
+    std::unordered_map<uint64_t, VkDescriptorSetLayout>         _setLayoutsByContent;
+
+    DescriptorBufferManagerExt _descriptorBuffer;
+    bool                       _useDescriptorBuffer = false; // latched per frame, passes of one frame share a backend
+    uint64_t                   _currentFrame        = 0;
+    uint64_t                   _lastMisses          = 0;
+    uint64_t                   _lastRingWrites      = 0;
+    uint32_t                   _benchmarkSetsLeft   = 0;
+    double                     _benchmarkArraysUs   = 0.0;
+    double                     _benchmarkTemplateUs = 0.0;
+    DescriptorSetCacheSettings _settings;
+    DescriptorSetCacheStats    _stats;
 };
 
 } // namespace Play
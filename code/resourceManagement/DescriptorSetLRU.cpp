@@ -0,0 +1,175 @@
+#include "DescriptorSetLRU.h"
+#include <algorithm>
+
+namespace Play
+{
+
+DescriptorSetLRU::~DescriptorSetLRU()
+{
+    // destroying a pool frees its sets
+    for (Pool& pool : _pools)
+    {
+        if (pool.pool != VK_NULL_HANDLE)
+        {
+            _allocator->destroyPool(pool.pool);
+        }
+    }
+}
+
+VkDescriptorSet DescriptorSetLRU::find(uint64_t bindingsHash, uint64_t frame)
+{
+    auto res = _sets.find(bindingsHash);
+    if (res == _sets.end())
+    {
+        ++_stats.misses;
+        return VK_NULL_HANDLE;
+    }
+    ++_stats.hits;
+    touch(res->second, frame);
+    return res->second.set;
+}
+
+VkDescriptorSet DescriptorSetLRU::allocate(uint64_t bindingsHash, uint64_t frame, VkDescriptorSetLayout layout)
+{
+    auto res = _sets.find(bindingsHash);
+    if (res != _sets.end())
+    {
+        touch(res->second, frame);
+        return res->second.set;
+    }
+
+    const uint32_t poolIndex = acquirePool();
+    Pool&          pool      = _pools[poolIndex];
+    CachedSet      cachedSet;
+    cachedSet.set         = _allocator->allocateSet(pool.pool, layout);
+    cachedSet.poolIndex   = poolIndex;
+    cachedSet.lruPosition = _lru.insert(_lru.end(), bindingsHash);
+    ++pool.liveSets;
+
+    CachedSet& inserted = _sets.emplace(bindingsHash, cachedSet).first->second;
+    touch(inserted, frame);
+    _stats.liveSets = static_cast<uint32_t>(_sets.size());
+    return inserted.set;
+}
+
+void DescriptorSetLRU::touch(CachedSet& cachedSet, uint64_t frame)
+{
+    cachedSet.lastUsedFrame = frame;
+    Pool& pool              = _pools[cachedSet.poolIndex];
+    pool.lastUsedFrame      = std::max(pool.lastUsedFrame, frame);
+    _lru.splice(_lru.end(), _lru, cachedSet.lruPosition);
+}
+
+uint32_t DescriptorSetLRU::acquirePool()
+{
+    uint32_t freeSlot = static_cast<uint32_t>(_pools.size());
+    for (uint32_t poolIndex = 0; poolIndex < _pools.size(); ++poolIndex)
+    {
+        const Pool& pool = _pools[poolIndex];
+        if (pool.pool != VK_NULL_HANDLE && pool.liveSets < kSetsPerPool)
+        {
+            return poolIndex;
+        }
+        if (pool.pool == VK_NULL_HANDLE)
+        {
+            freeSlot = std::min(freeSlot, poolIndex);
+        }
+    }
+
+    if (freeSlot == _pools.size())
+    {
+        _pools.emplace_back();
+    }
+    _pools[freeSlot]      = Pool{};
+    _pools[freeSlot].pool = _allocator->createPool(kSetsPerPool);
+    return freeSlot;
+}
+
+void DescriptorSetLRU::evict(uint64_t frame, uint32_t framesInFlight, uint32_t staleFrames, uint32_t maxLiveSets)
+{
+    // the frames before inFlightFrom completed, sets last used by them are free to go
+    const uint64_t inFlightFrom = frame + 1 > framesInFlight ? frame + 1 - framesInFlight : 0;
+    const uint64_t staleBefore  = std::min(inFlightFrom, frame > staleFrames ? frame - staleFrames : 0);
+    recyclePools(staleBefore);
+
+    while (_sets.size() > maxLiveSets && !_lru.empty())
+    {
+        auto res = _sets.find(_lru.front());
+        if (res->second.lastUsedFrame >= inFlightFrom)
+        {
+            break;
+        }
+        Pool& pool = _pools[res->second.poolIndex];
+        _allocator->freeSet(pool.pool, res->second.set);
+        --pool.liveSets;
+        _lru.pop_front();
+        _sets.erase(res);
+        ++_stats.evictedSets;
+    }
+
+    releaseEmptyPools();
+    _stats.liveSets = static_cast<uint32_t>(_sets.size());
+    _stats.pools    = static_cast<uint32_t>(
+        std::count_if(_pools.begin(), _pools.end(), [](const Pool& pool) { return pool.pool != VK_NULL_HANDLE; }));
+}
+
+void DescriptorSetLRU::recyclePools(uint64_t staleBefore)
+{
+    std::vector<bool> stalePools(_pools.size(), false);
+    bool              anyStale = false;
+    for (uint32_t poolIndex = 0; poolIndex < _pools.size(); ++poolIndex)
+    {
+        const Pool& pool      = _pools[poolIndex];
+        stalePools[poolIndex] = pool.pool != VK_NULL_HANDLE && pool.liveSets > 0 && pool.lastUsedFrame < staleBefore;
+        anyStale              = anyStale || stalePools[poolIndex];
+    }
+    if (!anyStale)
+    {
+        return;
+    }
+
+    for (auto it = _lru.begin(); it != _lru.end();)
+    {
+        auto res = _sets.find(*it);
+        if (!stalePools[res->second.poolIndex])
+        {
+            ++it;
+            continue;
+        }
+        _sets.erase(res);
+        it = _lru.erase(it);
+        ++_stats.recycledSets;
+    }
+
+    for (uint32_t poolIndex = 0; poolIndex < _pools.size(); ++poolIndex)
+    {
+        if (stalePools[poolIndex])
+        {
+            _allocator->resetPool(_pools[poolIndex].pool);
+            _pools[poolIndex].liveSets = 0;
+            ++_stats.resetPools;
+        }
+    }
+}
+
+void DescriptorSetLRU::releaseEmptyPools()
+{
+    // one empty pool stays around for the next misses
+    bool keptSpare = false;
+    for (Pool& pool : _pools)
+    {
+        if (pool.pool == VK_NULL_HANDLE || pool.liveSets > 0)
+        {
+            continue;
+        }
+        if (!keptSpare)
+        {
+            keptSpare = true;
+            continue;
+        }
+        _allocator->destroyPool(pool.pool);
+        pool = Pool{};
+    }
+}
+
+} // namespace Play
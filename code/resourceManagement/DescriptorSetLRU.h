@@ -0,0 +1,88 @@
+#ifndef DESCRIPTOR_SET_LRU_H
+#define DESCRIPTOR_SET_LRU_H
+#include <vulkan/vulkan_core.h>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+namespace Play
+{
+
+// the pool side of DescriptorSetLRU, the descriptor set cache creates real pools with the free descriptor set flag
+class DescriptorPoolAllocator
+{
+public:
+    virtual ~DescriptorPoolAllocator() = default;
+    virtual VkDescriptorPool createPool(uint32_t maxSets) = 0;
+    virtual void             destroyPool(VkDescriptorPool pool) = 0;
+    virtual void             resetPool(VkDescriptorPool pool) = 0;
+    virtual VkDescriptorSet  allocateSet(VkDescriptorPool pool, VkDescriptorSetLayout layout) = 0;
+    virtual void             freeSet(VkDescriptorPool pool, VkDescriptorSet set) = 0;
+};
+
+struct DescriptorSetLRUStats
+{
+    uint32_t liveSets     = 0;
+    uint32_t pools        = 0;
+    uint64_t hits         = 0;
+    uint64_t misses       = 0;
+    uint64_t evictedSets  = 0; // freed one by one to stay under the cap
+    uint64_t recycledSets = 0; // dropped with their pool
+    uint64_t resetPools   = 0;
+};
+
+// descriptor sets of one layout by bindings hash, in pools of kSetsPerPool sets. Every request stamps its set with the
+// frame, sets stamped before the oldest frame in flight are no longer read by the gpu. evict() resets pools whose sets all
+// went unused for staleFrames and frees the least recently used sets while more than maxLiveSets are alive
+class DescriptorSetLRU
+{
+public:
+    static constexpr uint32_t kSetsPerPool = 32;
+
+    explicit DescriptorSetLRU(std::unique_ptr<DescriptorPoolAllocator> allocator) : _allocator(std::move(allocator)) {}
+    ~DescriptorSetLRU();
+    DescriptorSetLRU(const DescriptorSetLRU&)            = delete;
+    DescriptorSetLRU& operator=(const DescriptorSetLRU&) = delete;
+
+    // cached set of bindingsHash, VK_NULL_HANDLE on a miss
+    VkDescriptorSet find(uint64_t bindingsHash, uint64_t frame);
+    // set for a missed bindingsHash, the caller writes its descriptors
+    VkDescriptorSet allocate(uint64_t bindingsHash, uint64_t frame, VkDescriptorSetLayout layout);
+    void            evict(uint64_t frame, uint32_t framesInFlight, uint32_t staleFrames, uint32_t maxLiveSets);
+
+    const DescriptorSetLRUStats& getStats() const
+    {
+        return _stats;
+    }
+
+private:
+    struct Pool
+    {
+        VkDescriptorPool pool          = VK_NULL_HANDLE; // null once destroyed, the slot is reused by the next pool
+        uint32_t         liveSets      = 0;
+        uint64_t         lastUsedFrame = 0;
+    };
+    struct CachedSet
+    {
+        VkDescriptorSet               set           = VK_NULL_HANDLE;
+        uint32_t                      poolIndex     = 0;
+        uint64_t                      lastUsedFrame = 0;
+        std::list<uint64_t>::iterator lruPosition;
+    };
+
+    void     touch(CachedSet& cachedSet, uint64_t frame);
+    uint32_t acquirePool();
+    void     recyclePools(uint64_t staleBefore);
+    void     releaseEmptyPools();
+
+    std::unique_ptr<DescriptorPoolAllocator> _allocator;
+    std::unordered_map<uint64_t, CachedSet>  _sets;
+    std::list<uint64_t>                      _lru; // bindings hashes, least recently used first
+    std::vector<Pool>                        _pools;
+    DescriptorSetLRUStats                    _stats;
+};
+
+} // namespace Play
+
+#endif // DESCRIPTOR_SET_LRU_H
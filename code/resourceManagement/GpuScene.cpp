@@ -66,6 +66,31 @@ uint16_t remapTextureInfoIndex(uint16_t localIndex, const std::vector<uint16_t>&
     return textureInfoRemap[localIndex];
 }
 
+// what the textures of the package show while they stream in, white unless a material samples one as normals or emission
+std::vector<TexturePlaceholder> getTexturePlaceholders(const ModelAssetPackage& package)
+{
+    std::vector<TexturePlaceholder> placeholders(package.textures.size(), TexturePlaceholder::eWhite);
+    auto                            setPlaceholder = [&](uint16_t textureInfoIndex, TexturePlaceholder placeholder)
+    {
+        if (textureInfoIndex == 0 || textureInfoIndex >= package.textureInfos.size())
+        {
+            return;
+        }
+        const int textureIndex = package.textureInfos[textureInfoIndex].index;
+        if (textureIndex >= 0 && static_cast<size_t>(textureIndex) < placeholders.size())
+        {
+            placeholders[textureIndex] = placeholder;
+        }
+    };
+    for (const shaderio::GltfShadeMaterial& material : package.materials)
+    {
+        setPlaceholder(material.normalTexture, TexturePlaceholder::eFlatNormal);
+        setPlaceholder(material.clearcoatNormalTexture, TexturePlaceholder::eFlatNormal);
+        setPlaceholder(material.emissiveTexture, TexturePlaceholder::eBlack);
+    }
+    return placeholders;
+}
+
 void remapMaterialTextureInfos(shaderio::GltfShadeMaterial& material, const std::vector<uint16_t>& textureInfoRemap)
 {
     material.pbrBaseColorTexture             = remapTextureInfoIndex(material.pbrBaseColorTexture, textureInfoRemap);
@@ -294,6 +319,7 @@ void GpuScene::clear()
     _sceneTextures.clear();
     _sceneTextureSources.clear();
     _ownedBuffers.clear();
+    _textureStreamer.clear();
     _common.textureInfos.push_back(shaderio::defaultGltfTextureInfo());
     _sourceSceneRevision = 0;
 }
@@ -304,11 +330,12 @@ ModelAssetID GpuScene::registerModel(ModelAssetPackage&& package)
     const uint32_t materialBase    = static_cast<uint32_t>(_common.materials.size());
     const uint32_t meshInfoBase    = static_cast<uint32_t>(_common.meshInfos.size());
 
-    std::vector<uint32_t> textureRemap;
+    const std::vector<TexturePlaceholder> placeholders = getTexturePlaceholders(package);
+    std::vector<uint32_t>                 textureRemap;
     textureRemap.resize(package.textures.size(), INVALID_SCENE_ID);
     for (uint32_t textureIndex = 0; textureIndex < package.textures.size(); ++textureIndex)
     {
-        textureRemap[textureIndex] = ensureSceneTexture(std::move(package.textures[textureIndex]));
+        textureRemap[textureIndex] = ensureSceneTexture(std::move(package.textures[textureIndex]), placeholders[textureIndex]);
     }
 
     std::vector<uint16_t> textureInfoRemap;
@@ -363,11 +390,14 @@ ModelAssetID GpuScene::registerModel(ModelAssetPackage&& package)
     package.asset.materialBuffer    = createAndAppendBuffer(package.asset.name + "_MaterialBuffer", uploadedMaterials, hasPendingUpload);
     package.asset.textureInfoBuffer = createAndAppendBuffer(package.asset.name + "_TextureInfoBuffer", uploadedTextureInfos, hasPendingUpload);
     package.asset.meshInfoBuffer    = createAndAppendBuffer(package.asset.name + "_MeshInfoBuffer", uploadedMeshInfos, hasPendingUpload);
+    package.asset.lightInfoBuffer   = createAndAppendBuffer(package.asset.name + "_LightInfoBuffer", package.asset.lights, hasPendingUpload);
     submitPendingUploads(hasPendingUpload);
 
-    for (const shaderio::GltfShadeMaterial& material : uploadedMaterials)
+    for (uint32_t materialIndex = 0; materialIndex < uploadedMaterials.size(); ++materialIndex)
     {
-        _common.materials.push_back(material);
+        _common.materials.push_back(uploadedMaterials[materialIndex]);
+        _common.materialDepthPrepass.push_back(materialIndex < package.materialDepthPrepass.size() ? package.materialDepthPrepass[materialIndex]
+                                                                                                   : MaterialDepthPrepass::eAuto);
     }
 
     for (const MeshInfo& meshInfo : uploadedMeshInfos)
@@ -412,32 +442,37 @@ void GpuScene::updateTransforms(const CpuScene& scene)
     _sourceSceneRevision = scene.getRevision();
 }
 
-uint32_t GpuScene::ensureSceneTexture(ModelTextureResource&& texture)
+uint32_t GpuScene::ensureSceneTexture(ModelTextureResource&& texture, TexturePlaceholder placeholder)
 {
-    if (!texture.texture && !texture.sourcePath.empty())
-    {
-        texture.texture =
-            RefPtr<Texture>(new Texture(texture.sourcePath, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, texture.mipLevels, texture.isSrgb));
-    }
-
-    if (!texture.isResident())
-    {
-        return INVALID_SCENE_ID;
-    }
-
     for (uint32_t sceneTextureIndex = 0; sceneTextureIndex < _sceneTextures.size(); ++sceneTextureIndex)
     {
         if (!texture.sourcePath.empty() && _sceneTextureSources[sceneTextureIndex] == texture.sourcePath)
         {
             return sceneTextureIndex;
         }
-        if (_sceneTextures[sceneTextureIndex].get() == texture.texture.get())
+        if (texture.texture && _sceneTextures[sceneTextureIndex].get() == texture.texture.get())
         {
             return sceneTextureIndex;
         }
     }
 
     const uint32_t sceneTextureIndex = static_cast<uint32_t>(_sceneTextures.size());
+    // only the GBuffer feeds back the mips it samples, the other scenes load their textures whole
+    if (!texture.texture && !texture.sourcePath.empty() && _rasterData.enabled && _textureStreamer.getSettings().Streaming)
+    {
+        texture.texture = _textureStreamer.addTexture(sceneTextureIndex, texture.sourcePath, texture.mipLevels, texture.isSrgb, placeholder);
+    }
+    if (!texture.texture && !texture.sourcePath.empty())
+    {
+        texture.texture =
+            RefPtr<Texture>(new Texture(texture.sourcePath, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, texture.mipLevels, texture.isSrgb));
+    }
+
+    if (!texture.isResident())
+    {
+        return INVALID_SCENE_ID;
+    }
+
     _sceneTextureSources.push_back(texture.sourcePath);
     _sceneTextures.push_back(texture.texture);
     return sceneTextureIndex;
@@ -2,6 +2,7 @@
 #define GPU_SCENE_H
 
 #include "SceneAssets.h"
+#include "TextureStreamer.h"
 
 namespace Play
 {
@@ -23,6 +24,7 @@ struct GpuSceneCommonData
     std::vector<glm::mat4>                  transforms;
     std::vector<MeshInfo>                   meshInfos;
     std::vector<shaderio::GltfShadeMaterial> materials;
+    std::vector<MaterialDepthPrepass>        materialDepthPrepass; // by material
     std::vector<shaderio::GltfTextureInfo>   textureInfos;
 };
 
@@ -68,6 +70,15 @@ public:
         return _common;
     }
 
+    // overrides whether the depth prepass draws a scene material, takes effect with the next render list
+    void setMaterialDepthPrepass(uint32_t materialIndex, MaterialDepthPrepass mode)
+    {
+        if (materialIndex < _common.materialDepthPrepass.size())
+        {
+            _common.materialDepthPrepass[materialIndex] = mode;
+        }
+    }
+
     const std::vector<ModelAsset>& getModels() const
     {
         return _models;
@@ -83,8 +94,19 @@ public:
         return _sceneTextures;
     }
 
+    TextureStreamer& getTextureStreamer()
+    {
+        return _textureStreamer;
+    }
+
+    // once per frame, true when a streamed scene texture was replaced and the descriptors need rewriting
+    bool updateTextureStreaming()
+    {
+        return _textureStreamer.update(_sceneTextures);
+    }
+
 protected:
-    uint32_t ensureSceneTexture(ModelTextureResource&& texture);
+    uint32_t ensureSceneTexture(ModelTextureResource&& texture, TexturePlaceholder placeholder);
     void     registerRasterData(const ModelAsset& model, const GpuModelRange& range);
     void     registerRayTracingData(const ModelAsset& model, const GpuModelRange& range);
 
@@ -96,6 +118,7 @@ protected:
     std::vector<RefPtr<Texture>>   _sceneTextures;
     std::vector<std::filesystem::path> _sceneTextureSources;
     std::vector<RefPtr<Buffer>>    _ownedBuffers;
+    TextureStreamer                _textureStreamer;
     uint64_t                       _sourceSceneRevision = 0;
 };
 
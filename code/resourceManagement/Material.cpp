@@ -1,4 +1,9 @@
 #include "Material.h"
+#include "MaterialParameterBuffer.h"
+#include "core/runtime/VulkanRuntime.h"
+#include <algorithm>
+#include <cstring>
+#include <nvutils/logger.hpp>
 
 namespace Play
 {
@@ -68,6 +73,27 @@ MaterialParameterKind getParameterKind(const SpvReflectBlockVariable& variable)
     return MaterialParameterKind::eUnknown;
 }
 
+MaterialScalarType getParameterScalarType(const SpvReflectBlockVariable& variable)
+{
+    const SpvReflectTypeFlags typeFlags = variable.type_description ? variable.type_description->type_flags : 0;
+    if (typeFlags & SPV_REFLECT_TYPE_FLAG_BOOL) return MaterialScalarType::eBool;
+    if (typeFlags & SPV_REFLECT_TYPE_FLAG_INT)
+    {
+        return variable.numeric.scalar.signedness ? MaterialScalarType::eInt : MaterialScalarType::eUint;
+    }
+    return MaterialScalarType::eFloat;
+}
+
+uint32_t getParameterArrayCount(const SpvReflectBlockVariable& variable)
+{
+    uint32_t count = 1;
+    for (uint32_t index = 0; index < variable.array.dims_count; ++index)
+    {
+        count *= variable.array.dims[index];
+    }
+    return count;
+}
+
 void collectBlockParameters(MaterialParameterDeclarationMap& declarations, MaterialParamMap& defaultParams,
                             const MaterialDescriptorDeclaration& descriptor, const SpvReflectBlockVariable& variable,
                             const std::string& prefix)
@@ -90,6 +116,13 @@ void collectBlockParameters(MaterialParameterDeclarationMap& declarations, Mater
         declaration.descriptorName = descriptor.name;
         declaration.byteOffset     = member.absolute_offset;
         declaration.byteSize       = member.size;
+        declaration.scalarType     = getParameterScalarType(member);
+        declaration.scalarBytes    = std::max(member.numeric.scalar.width / 8, 4u);
+        declaration.componentCount = std::max(declaration.kind == MaterialParameterKind::eMatrix ? member.numeric.matrix.row_count
+                                                                                                 : member.numeric.vector.component_count,
+                                              1u);
+        declaration.columnCount    = declaration.kind == MaterialParameterKind::eMatrix ? member.numeric.matrix.column_count : 1;
+        declaration.arrayCount     = getParameterArrayCount(member);
         declarations[declaration.name] = declaration;
 
         if (defaultParams.find(declaration.name) == defaultParams.end())
@@ -163,6 +196,144 @@ bool isParameterValueCompatible(const MaterialParameterDeclaration& declaration,
     }
 }
 
+bool isPackedParameter(const MaterialParameterDeclaration& declaration)
+{
+    return declaration.packedOffset != MATERIAL_UNPACKED_PARAMETER;
+}
+
+bool isBlockMemberKind(MaterialParameterKind kind)
+{
+    return kind == MaterialParameterKind::eScalar || kind == MaterialParameterKind::eVector || kind == MaterialParameterKind::eMatrix;
+}
+
+uint32_t alignUp(uint32_t value, uint32_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// the storage blocks are bound at their offset in the parameter buffer
+uint32_t getParameterBlockAlignment()
+{
+    const VkDeviceSize deviceAlignment = vkDriver ? vkDriver->_physicalDeviceProperties2.properties.limits.minStorageBufferOffsetAlignment : 0;
+    return std::max(MATERIAL_PARAMETER_BLOCK_ALIGNMENT, static_cast<uint32_t>(deviceAlignment));
+}
+
+// std430 aligns a vector of two components to twice its scalar and one of three or four to four times, a matrix column
+// like its vector and an array element to its own alignment
+uint32_t getStd430VectorAlignment(const MaterialParameterDeclaration& declaration)
+{
+    return declaration.scalarBytes * (declaration.componentCount == 3 ? 4 : declaration.componentCount);
+}
+
+uint32_t getStd430ElementStride(const MaterialParameterDeclaration& declaration)
+{
+    const uint32_t alignment = getStd430VectorAlignment(declaration);
+    if (declaration.columnCount > 1) return alignment * declaration.columnCount;
+    return alignUp(declaration.scalarBytes * declaration.componentCount, alignment);
+}
+
+uint32_t getStd430Size(const MaterialParameterDeclaration& declaration)
+{
+    if (declaration.arrayCount > 1) return getStd430ElementStride(declaration) * declaration.arrayCount;
+    if (declaration.columnCount > 1) return getStd430VectorAlignment(declaration) * declaration.columnCount;
+    return declaration.scalarBytes * declaration.componentCount;
+}
+
+template <typename Stored, typename T>
+void storeComponent(uint8_t* dst, T value)
+{
+    const Stored stored = static_cast<Stored>(value);
+    std::memcpy(dst, &stored, sizeof(Stored));
+}
+
+template <typename T>
+void writeComponent(const MaterialParameterDeclaration& declaration, T value, uint8_t* dst)
+{
+    const bool wide = declaration.scalarBytes == 8;
+    switch (declaration.scalarType)
+    {
+        case MaterialScalarType::eFloat:
+            wide ? storeComponent<double>(dst, value) : storeComponent<float>(dst, value);
+            break;
+        case MaterialScalarType::eInt:
+            wide ? storeComponent<int64_t>(dst, value) : storeComponent<int32_t>(dst, value);
+            break;
+        case MaterialScalarType::eUint:
+            wide ? storeComponent<uint64_t>(dst, value) : storeComponent<uint32_t>(dst, value);
+            break;
+        case MaterialScalarType::eBool:
+            storeComponent<uint32_t>(dst, value != T(0) ? 1u : 0u);
+            break;
+    }
+}
+
+// the values fill the components in order, columns of a matrix and elements of an array one after the other
+template <typename T>
+bool writeComponents(const MaterialParameterDeclaration& declaration, const T* values, size_t count, uint8_t* dst)
+{
+    if (count != static_cast<size_t>(declaration.componentCount) * declaration.columnCount * declaration.arrayCount) return false;
+
+    const uint32_t columnStride  = getStd430VectorAlignment(declaration);
+    const uint32_t elementStride = getStd430ElementStride(declaration);
+    size_t         index         = 0;
+    for (uint32_t element = 0; element < declaration.arrayCount; ++element)
+    {
+        for (uint32_t column = 0; column < declaration.columnCount; ++column)
+        {
+            for (uint32_t component = 0; component < declaration.componentCount; ++component)
+            {
+                const uint32_t offset = element * elementStride + column * columnStride + component * declaration.scalarBytes;
+                writeComponent(declaration, values[index++], dst + offset);
+            }
+        }
+    }
+    return true;
+}
+
+template <typename T>
+bool writeScalarValue(const MaterialParameterDeclaration& declaration, const rttr::variant& value, uint8_t* dst)
+{
+    const T scalar = value.get_value<T>();
+    return writeComponents(declaration, &scalar, 1, dst);
+}
+
+template <typename T>
+bool writeVectorValue(const MaterialParameterDeclaration& declaration, const rttr::variant& value, uint8_t* dst)
+{
+    const std::vector<T>& values = value.get_value<std::vector<T>>();
+    return writeComponents(declaration, values.data(), values.size(), dst);
+}
+
+// scalars and vectors of float, int and uint, converted to the declared type. False for other values
+bool writeParameterValue(const MaterialParameterDeclaration& declaration, const rttr::variant& value, uint8_t* block)
+{
+    if (!isPackedParameter(declaration)) return false;
+
+    uint8_t* dst = block + declaration.packedOffset;
+    if (value.is_type<bool>()) return writeScalarValue<bool>(declaration, value, dst);
+    if (value.is_type<int>()) return writeScalarValue<int>(declaration, value, dst);
+    if (value.is_type<uint32_t>()) return writeScalarValue<uint32_t>(declaration, value, dst);
+    if (value.is_type<int64_t>()) return writeScalarValue<int64_t>(declaration, value, dst);
+    if (value.is_type<uint64_t>()) return writeScalarValue<uint64_t>(declaration, value, dst);
+    if (value.is_type<float>()) return writeScalarValue<float>(declaration, value, dst);
+    if (value.is_type<double>()) return writeScalarValue<double>(declaration, value, dst);
+    if (value.is_type<std::vector<float>>()) return writeVectorValue<float>(declaration, value, dst);
+    if (value.is_type<std::vector<int32_t>>()) return writeVectorValue<int32_t>(declaration, value, dst);
+    if (value.is_type<std::vector<uint32_t>>()) return writeVectorValue<uint32_t>(declaration, value, dst);
+    return false;
+}
+
+MaterialParameterHandle makeParameterHandle(const MaterialParameterDeclaration* declaration, uint64_t layoutKey)
+{
+    if (!declaration || !isPackedParameter(*declaration)) return {};
+    return {declaration->packedOffset, declaration->packedSize, layoutKey};
+}
+
+uint64_t hashCombine(uint64_t seed, uint64_t value)
+{
+    return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
 bool applyBufferResource(DescriptorSetBindings& descriptorBindings, const MaterialDescriptorDeclaration& declaration, const rttr::variant& resource)
 {
     if (resource.is_type<Buffer*>())
@@ -238,7 +409,16 @@ bool applyDescriptorResource(DescriptorSetBindings& descriptorBindings, const Ma
 }
 } // namespace
 
-MaterialInstance::MaterialInstance(Material* material) : _material(material)
+bool MaterialShaderSet::setShaderVariant(ShaderStage stage, const std::string& permutationName, ShaderVariantKey key)
+{
+    const ShaderID shaderID = ShaderManager::Instance().getOrLoadVariant(permutationName, key);
+    if (shaderID == ~0U || static_cast<uint32_t>(stage) >= MATERIAL_SHADER_STAGE_COUNT) return false;
+    setShader(stage, shaderID);
+    return true;
+}
+
+MaterialInstance::MaterialInstance(Material* material, MaterialParameterBuffer* parameterBuffer)
+    : _material(material), _parameterBuffer(parameterBuffer ? parameterBuffer : &MaterialParameterBuffer::Instance())
 {
     if (_material)
     {
@@ -253,6 +433,97 @@ MaterialInstance::~MaterialInstance()
     {
         _material->unregisterInstance(this);
     }
+    if (_parameterBuffer)
+    {
+        _parameterBuffer->release(this);
+    }
+}
+
+MaterialInstance& MaterialInstance::setParam(const std::string& name, const rttr::variant& value)
+{
+    const MaterialParameterDeclaration* declaration = getParameterDeclaration(name);
+    if (!declaration || !isPackedParameter(*declaration))
+    {
+        _overrideParamMap[name] = value;
+        return *this;
+    }
+    if (writeParameterValue(*declaration, value, _parameterBlock.data()))
+    {
+        markParametersDirty(declaration->packedOffset, declaration->packedOffset + declaration->packedSize);
+    }
+    else
+    {
+        LOGW("Material parameter %s does not take a value of type %s\n", name.c_str(), value.get_type().get_name().to_string().c_str());
+    }
+    return *this;
+}
+
+MaterialParameterHandle MaterialInstance::findParameter(const std::string& name) const
+{
+    return makeParameterHandle(getParameterDeclaration(name), _parameterLayoutKey);
+}
+
+bool MaterialInstance::setParamBytes(MaterialParameterHandle handle, const void* data, uint32_t size)
+{
+    if (!handle.isValid() || handle.layoutKey != _parameterLayoutKey || size != handle.size) return false;
+
+    std::memcpy(_parameterBlock.data() + handle.offset, data, size);
+    markParametersDirty(handle.offset, handle.offset + size);
+    return true;
+}
+
+void MaterialInstance::markParametersDirty(uint32_t begin, uint32_t end)
+{
+    _dirtyBegin = std::min(_dirtyBegin, begin);
+    _dirtyEnd   = std::max(_dirtyEnd, end);
+    if (!_uploadQueued && _parameterBuffer)
+    {
+        _uploadQueued = true;
+        _parameterBuffer->queue(this);
+    }
+}
+
+void MaterialInstance::resetPackedParam(const std::string& name)
+{
+    const MaterialParameterDeclaration* declaration = getParameterDeclaration(name);
+    if (!_material || !declaration || !isPackedParameter(*declaration) || _material->_parameterLayoutKey != _parameterLayoutKey) return;
+
+    std::memcpy(_parameterBlock.data() + declaration->packedOffset, _material->_defaultParameterBlock.data() + declaration->packedOffset,
+                declaration->packedSize);
+    markParametersDirty(declaration->packedOffset, declaration->packedOffset + declaration->packedSize);
+}
+
+void MaterialInstance::syncParameterBlock(const MaterialParameterDeclarationMap& oldDeclarations, const std::vector<uint8_t>& oldBlock,
+                                          bool preserveValues)
+{
+    _parameterBlock     = _material->_defaultParameterBlock;
+    _parameterLayoutKey = _material->_parameterLayoutKey;
+
+    if (preserveValues)
+    {
+        // values move to the new place of their parameter, one whose type or size changed starts from the default
+        for (const auto& pair : _parameterDeclarations)
+        {
+            const MaterialParameterDeclaration& declaration = pair.second;
+            if (!isPackedParameter(declaration)) continue;
+
+            auto oldDeclaration = oldDeclarations.find(pair.first);
+            if (oldDeclaration != oldDeclarations.end() && isPackedParameter(oldDeclaration->second) &&
+                oldDeclaration->second.packedSize == declaration.packedSize && oldDeclaration->second.scalarType == declaration.scalarType &&
+                oldDeclaration->second.packedOffset + declaration.packedSize <= oldBlock.size())
+            {
+                std::memcpy(_parameterBlock.data() + declaration.packedOffset, oldBlock.data() + oldDeclaration->second.packedOffset,
+                            declaration.packedSize);
+            }
+        }
+    }
+
+    _dirtyBegin = ~0U;
+    _dirtyEnd   = 0;
+    if (!_parameterBlock.empty() || _parameterSlot != MATERIAL_UNPACKED_PARAMETER)
+    {
+        markParametersDirty(0, static_cast<uint32_t>(_parameterBlock.size()));
+    }
 }
 
 const rttr::variant* MaterialInstance::getParam(const std::string& name) const
@@ -275,12 +546,14 @@ bool MaterialInstance::hasParamOverride(const std::string& name) const
 
 bool MaterialInstance::clearParamOverride(const std::string& name)
 {
+    resetPackedParam(name);
     return _overrideParamMap.erase(name) > 0;
 }
 
 bool MaterialInstance::resetParamToDefault(const std::string& name)
 {
     if (!_material || !_material->getParam(name)) return false;
+    resetPackedParam(name);
     _overrideParamMap.erase(name);
     return true;
 }
@@ -299,7 +572,9 @@ MaterialInstance& MaterialInstance::syncFromMaterial(bool preserveOverrides)
 {
     if (!_material) return *this;
 
-    const MaterialDescriptorBindingMap oldDescriptorBindings = _descriptorBindings;
+    const MaterialDescriptorBindingMap    oldDescriptorBindings = _descriptorBindings;
+    const MaterialParameterDeclarationMap oldDeclarations       = std::move(_parameterDeclarations);
+    const std::vector<uint8_t>            oldBlock              = std::move(_parameterBlock);
 
     _sourceMaterialVersion = _material->getVersion();
     if (!preserveOverrides)
@@ -307,6 +582,7 @@ MaterialInstance& MaterialInstance::syncFromMaterial(bool preserveOverrides)
         _overrideParamMap.clear();
     }
     _parameterDeclarations = _material->_parameterDeclarations;
+    syncParameterBlock(oldDeclarations, oldBlock, preserveOverrides);
     _descriptorBindings.clear();
 
     for (const auto& pair : _material->_descriptorDeclarations)
@@ -408,6 +684,19 @@ bool MaterialInstance::buildDrawObjectDescriptorBindings(DescriptorSetBindings&
         {
             resource = &binding.resource;
         }
+        // a parameter block reads the instance's block from the parameter buffer, unless a buffer was set for it
+        if ((!resource || !resource->is_valid()) && declaration.packedSize > 0)
+        {
+            const Buffer* parameterBuffer = _parameterBuffer ? _parameterBuffer->getBuffer() : nullptr;
+            if (!parameterBuffer || _parameterSlot == MATERIAL_UNPACKED_PARAMETER)
+            {
+                resourcesComplete = false;
+                continue;
+            }
+            descriptorBindings.setDescInfo(declaration.bindingIdx, *parameterBuffer, _parameterSlot + declaration.packedOffset,
+                                           declaration.packedSize);
+            continue;
+        }
 
         if (!resource || !resource->is_valid())
         {
@@ -478,9 +767,87 @@ void Material::syncMaterialInstances()
     }
 }
 
+MaterialParameterHandle Material::findParameter(const std::string& name) const
+{
+    return makeParameterHandle(getParameterDeclaration(name), _parameterLayoutKey);
+}
+
+void Material::compileParameterLayout()
+{
+    std::vector<MaterialParameterDeclaration*> packed;
+    for (auto& [name, descriptor] : _descriptorDeclarations)
+    {
+        descriptor.packedOffset = MATERIAL_UNPACKED_PARAMETER;
+        descriptor.packedSize   = 0;
+    }
+    // a storage block is std430 like the parameter block, a uniform block is not
+    auto getStorageBlock = [this](const MaterialParameterDeclaration& declaration) -> MaterialDescriptorDeclaration*
+    {
+        auto iter = _descriptorDeclarations.find(declaration.descriptorName);
+        if (iter == _descriptorDeclarations.end() || iter->second.descriptorType != VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) return nullptr;
+        return &iter->second;
+    };
+    for (auto& pair : _parameterDeclarations)
+    {
+        MaterialParameterDeclaration& declaration = pair.second;
+        declaration.packedOffset                  = MATERIAL_UNPACKED_PARAMETER;
+        declaration.packedSize                    = 0;
+        if (isBlockMemberKind(declaration.kind) && declaration.scalarBytes > 0 && declaration.arrayCount > 0 &&
+            getStorageBlock(declaration) && getStd430Size(declaration) == declaration.byteSize)
+        {
+            packed.push_back(&declaration);
+        }
+    }
+
+    auto getBinding = [&getStorageBlock](const MaterialParameterDeclaration& declaration) { return getStorageBlock(declaration)->bindingIdx; };
+    std::sort(packed.begin(), packed.end(),
+              [&getBinding](const MaterialParameterDeclaration* lhs, const MaterialParameterDeclaration* rhs)
+              {
+                  const uint32_t lhsBinding = getBinding(*lhs);
+                  const uint32_t rhsBinding = getBinding(*rhs);
+                  if (lhsBinding != rhsBinding) return lhsBinding < rhsBinding;
+                  if (lhs->byteOffset != rhs->byteOffset) return lhs->byteOffset < rhs->byteOffset;
+                  return lhs->name < rhs->name;
+              });
+
+    const uint32_t                 blockAlignment = getParameterBlockAlignment();
+    uint32_t                       offset         = 0;
+    MaterialDescriptorDeclaration* block          = nullptr;
+    uint64_t                       layoutKey      = packed.empty() ? 0 : 1;
+    for (MaterialParameterDeclaration* declaration : packed)
+    {
+        // every block starts where it can be bound, its members keep the offsets the shader reads them at
+        if (getStorageBlock(*declaration) != block)
+        {
+            block               = getStorageBlock(*declaration);
+            block->packedOffset = alignUp(offset, blockAlignment);
+        }
+        declaration->packedOffset = block->packedOffset + declaration->byteOffset;
+        declaration->packedSize   = declaration->byteSize;
+        offset                    = std::max(offset, declaration->packedOffset + declaration->packedSize);
+        block->packedSize         = offset - block->packedOffset;
+
+        layoutKey = hashCombine(layoutKey, std::hash<std::string>{}(declaration->name));
+        layoutKey = hashCombine(layoutKey, (static_cast<uint64_t>(declaration->packedOffset) << 32) | declaration->packedSize);
+        layoutKey = hashCombine(layoutKey, (static_cast<uint64_t>(declaration->scalarType) << 32) | declaration->scalarBytes);
+    }
+
+    _parameterLayoutKey = layoutKey;
+    _defaultParameterBlock.assign(alignUp(offset, blockAlignment), 0);
+    for (const MaterialParameterDeclaration* declaration : packed)
+    {
+        auto value = _paramMap.find(declaration->name);
+        if (value != _paramMap.end() && value->second.is_valid())
+        {
+            writeParameterValue(*declaration, value->second, _defaultParameterBlock.data());
+        }
+    }
+}
+
 bool Material::refreshShaderReflection()
 {
     const bool reflectedAnyBinding = reflectDrawObjectDescriptorSet();
+    compileParameterLayout();
     ++_version;
     syncMaterialInstances();
     return reflectedAnyBinding;
@@ -9,6 +9,7 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <rttr/rttr_enable.h>
 #include <rttr/variant.h>
@@ -17,9 +18,13 @@ namespace Play
 {
 
 class MaterialInstance;
+class MaterialParameterBuffer;
+struct MaterialTestAccess;
 
-constexpr ShaderID       MATERIAL_INVALID_SHADER_ID  = ~0U;
-constexpr uint32_t       MATERIAL_SHADER_STAGE_COUNT = static_cast<uint32_t>(ShaderStage::eCount);
+constexpr ShaderID       MATERIAL_INVALID_SHADER_ID         = ~0U;
+constexpr uint32_t       MATERIAL_SHADER_STAGE_COUNT        = static_cast<uint32_t>(ShaderStage::eCount);
+constexpr uint32_t       MATERIAL_UNPACKED_PARAMETER        = ~0U;
+constexpr uint32_t       MATERIAL_PARAMETER_BLOCK_ALIGNMENT = 16;
 
 enum class MaterialParameterKind : uint32_t
 {
@@ -32,6 +37,14 @@ enum class MaterialParameterKind : uint32_t
     eBuffer
 };
 
+enum class MaterialScalarType : uint32_t
+{
+    eFloat,
+    eInt,
+    eUint,
+    eBool // four bytes in a block, like a uint
+};
+
 enum class MaterialRasterMode : uint32_t
 {
     eTriangle,
@@ -118,6 +131,9 @@ struct MaterialShaderSet
         return getShader(stage) != MATERIAL_INVALID_SHADER_ID;
     }
 
+    // a variant of a registered permutation, the stage keeps its shader when the variant does not load
+    bool setShaderVariant(ShaderStage stage, const std::string& permutationName, ShaderVariantKey key);
+
     std::array<ShaderID, MATERIAL_SHADER_STAGE_COUNT> shaderIDs;
 };
 
@@ -128,6 +144,9 @@ struct MaterialDescriptorDeclaration
     uint32_t           descriptorCount  = 1;
     VkDescriptorType   descriptorType   = VK_DESCRIPTOR_TYPE_MAX_ENUM;
     VkShaderStageFlags shaderStageFlags = VK_SHADER_STAGE_ALL;
+    // a storage block of packed parameters, bound to its place in the instance's block in the parameter buffer
+    uint32_t packedOffset = MATERIAL_UNPACKED_PARAMETER;
+    uint32_t packedSize   = 0;
 };
 
 struct MaterialParameterDeclaration
@@ -138,6 +157,30 @@ struct MaterialParameterDeclaration
     std::string           descriptorName;
     uint32_t              byteOffset = 0;
     uint32_t              byteSize   = 0;
+    // the type of a scalar, vector or matrix member of a block. Matrices are column major, componentCount is their rows
+    MaterialScalarType scalarType     = MaterialScalarType::eFloat;
+    uint32_t           scalarBytes    = 0;
+    uint32_t           componentCount = 1;
+    uint32_t           columnCount    = 1;
+    uint32_t           arrayCount     = 1; // 0 for runtime arrays, they are not packed
+    // place in the parameter block of an instance, the members of every storage block of the material share the one
+    // block at their std430 offsets. Members of uniform blocks are not packed
+    uint32_t packedOffset = MATERIAL_UNPACKED_PARAMETER;
+    uint32_t packedSize   = 0;
+};
+
+// the packed place of a parameter, resolved once by name. Handles of another layout are ignored, resolve them again
+// after the shaders of the material changed
+struct MaterialParameterHandle
+{
+    uint32_t offset    = MATERIAL_UNPACKED_PARAMETER;
+    uint32_t size      = 0;
+    uint64_t layoutKey = 0;
+
+    bool isValid() const
+    {
+        return offset != MATERIAL_UNPACKED_PARAMETER;
+    }
 };
 
 struct MaterialDescriptorBinding
@@ -209,6 +252,15 @@ public:
         return *this;
     }
 
+    Material& setShaderVariant(ShaderStage stage, const std::string& permutationName, ShaderVariantKey key)
+    {
+        if (_shaderSet.setShaderVariant(stage, permutationName, key))
+        {
+            refreshShaderReflection();
+        }
+        return *this;
+    }
+
     Material& setShaders(const MaterialShaderSet& shaderSet)
     {
         _shaderSet = shaderSet;
@@ -255,6 +307,21 @@ public:
         return _parameterDeclarations;
     }
 
+    // invalid for parameters outside the packed block, textures and buffers among them
+    MaterialParameterHandle findParameter(const std::string& name) const;
+
+    uint64_t getParameterLayoutKey() const
+    {
+        return _parameterLayoutKey;
+    }
+
+    // the block every instance starts from, its storage blocks start and its size ends on the device's storage buffer
+    // offset alignment, at least MATERIAL_PARAMETER_BLOCK_ALIGNMENT
+    const std::vector<uint8_t>& getDefaultParameterBlock() const
+    {
+        return _defaultParameterBlock;
+    }
+
     std::shared_ptr<MaterialInstance> createMaterialInstance();
 
     bool refreshShaderReflection();
@@ -263,11 +330,15 @@ public:
 
 private:
     friend class MaterialInstance;
+    friend struct MaterialTestAccess;
 
     void registerInstance(MaterialInstance* instance);
     void unregisterInstance(MaterialInstance* instance);
     void syncMaterialInstances();
     bool reflectDrawObjectDescriptorSet();
+    // packs the scalar, vector and matrix members of the storage blocks, blocks in binding order and their members at the
+    // offsets the shader declares
+    void compileParameterLayout();
 
     std::string                      _name = "Default Material";
     MaterialShaderSet                _shaderSet;
@@ -276,13 +347,18 @@ private:
     MaterialParameterDeclarationMap  _parameterDeclarations;
     std::vector<MaterialInstance*>   _instances;
     uint32_t                         _version = 0;
+    std::vector<uint8_t>             _defaultParameterBlock;
+    uint64_t                         _parameterLayoutKey = 0;
 };
 
 class MaterialInstance
 {
 public:
     MaterialInstance() = default;
-    explicit MaterialInstance(Material* material);
+    // the instance uploads its parameters into the shared MaterialParameterBuffer unless it is given one of its own
+    explicit MaterialInstance(Material* material, MaterialParameterBuffer* parameterBuffer = nullptr);
+    MaterialInstance(const MaterialInstance&)            = delete;
+    MaterialInstance& operator=(const MaterialInstance&) = delete;
     ~MaterialInstance();
 
     Material* getMaterial()
@@ -340,11 +416,8 @@ public:
         return _overrideParamMap;
     }
 
-    MaterialInstance& setParam(const std::string& name, const rttr::variant& value)
-    {
-        _overrideParamMap[name] = value;
-        return *this;
-    }
+    // a packed parameter takes the value into the block only, converted to the declared type
+    MaterialInstance& setParam(const std::string& name, const rttr::variant& value);
 
     template <typename T>
     MaterialInstance& setParam(const std::string& name, const T& value)
@@ -352,6 +425,48 @@ public:
         return setParam(name, rttr::variant(value));
     }
 
+    MaterialParameterHandle findParameter(const std::string& name) const;
+
+    // writes the bytes as they are, false when the handle is of another layout or the size is not the packed size
+    bool setParamBytes(MaterialParameterHandle handle, const void* data, uint32_t size);
+
+    // T is laid out like the std430 member, a vec3 is 12 bytes and a mat3 takes three 16 byte columns
+    template <typename T>
+    MaterialInstance& setParam(MaterialParameterHandle handle, const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        setParamBytes(handle, &value, sizeof(T));
+        return *this;
+    }
+
+    MaterialInstance& setParam(MaterialParameterHandle handle, bool value)
+    {
+        return setParam(handle, static_cast<uint32_t>(value ? 1 : 0));
+    }
+
+    // packed parameters live only in the block, getParam sees the material's default of them
+    const uint8_t* getParamData(MaterialParameterHandle handle) const
+    {
+        if (!handle.isValid() || handle.layoutKey != _parameterLayoutKey) return nullptr;
+        return _parameterBlock.data() + handle.offset;
+    }
+
+    const std::vector<uint8_t>& getParameterBlock() const
+    {
+        return _parameterBlock;
+    }
+
+    bool hasDirtyParameters() const
+    {
+        return _dirtyBegin < _dirtyEnd;
+    }
+
+    // the byte offset of the block in the parameter buffer, MATERIAL_UNPACKED_PARAMETER until its first upload
+    uint32_t getParameterOffset() const
+    {
+        return _parameterSlot;
+    }
+
     MaterialInstance& setTexture(const std::string& name, Texture* texture)
     {
         _overrideParamMap[name] = texture;
@@ -527,6 +642,11 @@ public:
 
 private:
     friend class Material;
+    friend class MaterialParameterBuffer;
+
+    void markParametersDirty(uint32_t begin, uint32_t end);
+    void resetPackedParam(const std::string& name);
+    void syncParameterBlock(const MaterialParameterDeclarationMap& oldDeclarations, const std::vector<uint8_t>& oldBlock, bool preserveValues);
 
     static VkCompareOp toVkCompareOp(MaterialDepthCompareMode mode)
     {
@@ -666,6 +786,15 @@ private:
     MaterialRenderState             _renderState;
     DescriptorSetBindings           _descriptorSetState{DescriptorEnum::eDrawObjectDescriptorSet};
     uint32_t                        _descriptorSetStateVersion = 0;
+    // the packed parameters and the bytes changed since the last upload
+    std::vector<uint8_t>     _parameterBlock;
+    uint64_t                 _parameterLayoutKey = 0;
+    uint32_t                 _dirtyBegin         = ~0U;
+    uint32_t                 _dirtyEnd           = 0;
+    MaterialParameterBuffer* _parameterBuffer    = nullptr;
+    uint32_t                 _parameterSlot      = MATERIAL_UNPACKED_PARAMETER;
+    uint32_t                 _parameterSlotSize  = 0;
+    bool                     _uploadQueued       = false;
 };
 
 inline std::shared_ptr<MaterialInstance> Material::createMaterialInstance()
@@ -0,0 +1,168 @@
+#include "MaterialParameterBuffer.h"
+#include "PlayAllocator.h"
+#include "core/runtime/VulkanRuntime.h"
+#include <algorithm>
+#include <cstring>
+#include <nvutils/logger.hpp>
+
+namespace Play
+{
+namespace
+{
+constexpr VkDeviceSize kMinParameterBufferBytes = 64 * 1024;
+} // namespace
+
+MaterialParameterBuffer& MaterialParameterBuffer::Instance()
+{
+    static MaterialParameterBuffer buffer;
+    return buffer;
+}
+
+void MaterialParameterBuffer::queue(MaterialInstance* instance)
+{
+    _queued.push_back(instance);
+}
+
+void MaterialParameterBuffer::release(MaterialInstance* instance)
+{
+    if (instance->_uploadQueued)
+    {
+        _queued.erase(std::find(_queued.begin(), _queued.end(), instance));
+        instance->_uploadQueued = false;
+    }
+    freeSlot(*instance);
+}
+
+uint32_t MaterialParameterBuffer::allocateSlot(uint32_t size)
+{
+    ++_stats.Instances;
+    // blocks of one material have one size, a freed one fits the next instance of it
+    for (size_t index = 0; index < _freeSlots.size(); ++index)
+    {
+        if (_freeSlots[index].size != size) continue;
+        const uint32_t offset = _freeSlots[index].offset;
+        _freeSlots[index]     = _freeSlots.back();
+        _freeSlots.pop_back();
+        return offset;
+    }
+
+    const uint32_t offset = static_cast<uint32_t>(_shadow.size());
+    _shadow.resize(_shadow.size() + size);
+    return offset;
+}
+
+void MaterialParameterBuffer::freeSlot(MaterialInstance& instance)
+{
+    if (instance._parameterSlot == MATERIAL_UNPACKED_PARAMETER) return;
+    _freeSlots.push_back({instance._parameterSlot, instance._parameterSlotSize});
+    instance._parameterSlot     = MATERIAL_UNPACKED_PARAMETER;
+    instance._parameterSlotSize = 0;
+    --_stats.Instances;
+}
+
+void MaterialParameterBuffer::gather()
+{
+    for (MaterialInstance* instance : _queued)
+    {
+        instance->_uploadQueued = false;
+
+        const uint32_t size = static_cast<uint32_t>(instance->_parameterBlock.size());
+        if (size == 0)
+        {
+            freeSlot(*instance);
+            continue;
+        }
+        // a new layout moves the block, all of it is written at its new place
+        if (instance->_parameterSlot == MATERIAL_UNPACKED_PARAMETER || instance->_parameterSlotSize != size)
+        {
+            freeSlot(*instance);
+            instance->_parameterSlot     = allocateSlot(size);
+            instance->_parameterSlotSize = size;
+            instance->_dirtyBegin        = 0;
+            instance->_dirtyEnd          = size;
+        }
+
+        if (instance->hasDirtyParameters())
+        {
+            const Range range{instance->_parameterSlot + instance->_dirtyBegin, instance->_dirtyEnd - instance->_dirtyBegin};
+            std::memcpy(_shadow.data() + range.offset, instance->_parameterBlock.data() + instance->_dirtyBegin, range.size);
+            for (std::vector<Range>& pending : _pendingRanges)
+            {
+                pending.push_back(range);
+            }
+        }
+        instance->_dirtyBegin = ~0U;
+        instance->_dirtyEnd   = 0;
+    }
+    _queued.clear();
+}
+
+void MaterialParameterBuffer::upload()
+{
+    gather();
+    if (!vkDriver || _shadow.empty()) return;
+
+    const uint32_t cycleCount = vkDriver->getFrameCycleSize();
+    if (_buffers.size() != cycleCount)
+    {
+        _buffers.assign(cycleCount, nullptr);
+        _pendingRanges.assign(cycleCount, {});
+    }
+    _cycleIndex = vkDriver->getFrameCycleIndex();
+
+    RefPtr<Buffer>&     buffer  = _buffers[_cycleIndex];
+    std::vector<Range>& pending = _pendingRanges[_cycleIndex];
+    if (!buffer || buffer->BufferSize() < _shadow.size())
+    {
+        VkDeviceSize capacity = std::max(kMinParameterBufferBytes, buffer ? buffer->BufferSize() * 2 : 0);
+        while (capacity < _shadow.size())
+        {
+            capacity *= 2;
+        }
+        // the previous buffer may still be read by the frame in flight, it is released through the deferred queue
+        buffer = RefPtr<Buffer>(new Buffer("MaterialParameters", VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT, capacity,
+                                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+        pending.assign(1, Range{0, static_cast<uint32_t>(_shadow.size())});
+    }
+    if (!buffer->mapping) return;
+
+    // ranges written on several frames since this cycle's buffer was last current overlap, each byte is copied once
+    std::sort(pending.begin(), pending.end(), [](const Range& lhs, const Range& rhs) { return lhs.offset < rhs.offset; });
+    uint32_t uploadedBytes  = 0;
+    uint32_t uploadedRanges = 0;
+    for (size_t index = 0; index < pending.size();)
+    {
+        const uint32_t begin = pending[index].offset;
+        uint32_t       end   = begin + pending[index].size;
+        for (++index; index < pending.size() && pending[index].offset <= end; ++index)
+        {
+            end = std::max(end, pending[index].offset + pending[index].size);
+        }
+        std::memcpy(static_cast<uint8_t*>(buffer->mapping) + begin, _shadow.data() + begin, end - begin);
+        uploadedBytes += end - begin;
+        ++uploadedRanges;
+    }
+    if (uploadedRanges > 0)
+    {
+        PlayResourceManager::Instance().flushBuffer(*buffer, 0, VK_WHOLE_SIZE);
+    }
+    pending.clear();
+
+    _stats.BufferBytes    = static_cast<uint32_t>(buffer->BufferSize());
+    _stats.UploadedBytes  = uploadedBytes;
+    _stats.UploadedRanges = uploadedRanges;
+}
+
+void MaterialParameterBuffer::deInit()
+{
+    _buffers.clear();
+    _pendingRanges.clear();
+    _cycleIndex = 0;
+}
+
+Buffer* MaterialParameterBuffer::getBuffer() const
+{
+    return _cycleIndex < _buffers.size() ? _buffers[_cycleIndex].get() : nullptr;
+}
+
+} // namespace Play
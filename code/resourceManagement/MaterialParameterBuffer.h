@@ -0,0 +1,65 @@
+#ifndef MATERIAL_PARAMETER_BUFFER_H
+#define MATERIAL_PARAMETER_BUFFER_H
+#include "Material.h"
+#include "core/RefCounted.h"
+namespace Play
+{
+struct MaterialParameterStats
+{
+    uint32_t Instances      = 0; // holding a block in the buffer
+    uint32_t BufferBytes    = 0;
+    uint32_t UploadedBytes  = 0; // by the last upload
+    uint32_t UploadedRanges = 0;
+};
+
+// the packed parameters of every instance in one storage buffer, an instance's block starts at getParameterOffset() and
+// its descriptor set binds the material's storage blocks to their places in it. Changed bytes reach a CPU copy of the
+// buffer as instances are gathered, and each frame cycle's buffer catches up on the ranges written since it was last
+// current
+class MaterialParameterBuffer
+{
+public:
+    static MaterialParameterBuffer& Instance();
+    MaterialParameterBuffer() = default;
+
+    // gathers the dirty instances and writes the current frame cycle's buffer, once per frame before drawing
+    void upload();
+    void deInit();
+
+    // the current frame cycle's, null before the first upload
+    Buffer* getBuffer() const;
+
+    MaterialParameterStats& getStats()
+    {
+        return _stats;
+    }
+
+private:
+    friend class MaterialInstance;
+    friend struct MaterialTestAccess;
+
+    struct Range
+    {
+        uint32_t offset = 0;
+        uint32_t size   = 0;
+    };
+
+    void     queue(MaterialInstance* instance);
+    void     release(MaterialInstance* instance);
+    uint32_t allocateSlot(uint32_t size);
+    void     freeSlot(MaterialInstance& instance);
+    // copies the dirty bytes of the queued instances into the CPU copy and records them for every frame cycle
+    void     gather();
+
+    std::vector<MaterialInstance*>  _queued;
+    std::vector<uint8_t>            _shadow;
+    std::vector<Range>              _freeSlots;
+    std::vector<std::vector<Range>> _pendingRanges; // by frame cycle
+    std::vector<RefPtr<Buffer>>     _buffers;       // by frame cycle
+    uint32_t                        _cycleIndex = 0;
+    MaterialParameterStats          _stats;
+};
+
+} // namespace Play
+
+#endif // MATERIAL_PARAMETER_BUFFER_H
@@ -1,6 +1,8 @@
 #include "ModelLoading.h"
 
 #include "nvutils/file_operations.hpp"
+#include <algorithm>
+#include <cmath>
 #include <assimp/GltfMaterial.h>
 #include <assimp/Importer.hpp>
 #include <assimp/config.h>
@@ -561,6 +563,100 @@ uint32_t appendAssimpNode(const aiNode* assimpNode, uint32_t parentNodeIndex, As
     return nodeIndex;
 }
 
+glm::mat4 computeNodeToModel(const aiNode* assimpNode)
+{
+    glm::mat4 nodeToModel = glm::mat4(1.0f);
+    for (const aiNode* node = assimpNode; node; node = node->mParent)
+    {
+        nodeToModel = toGlm(node->mTransformation) * nodeToModel;
+    }
+    return nodeToModel;
+}
+
+// KHR_lights_punctual leaves the range undefined for an infinite light, cut it where the inverse square falloff
+// drops below kLightRangeCutoff so the light still fits in a bounded set of clusters
+constexpr float kLightRangeCutoff = 0.01f;
+
+float computeLightRange(const aiLight* light, const glm::vec3& color, const aiNode* lightNode)
+{
+    float range = 0.0f;
+    if (lightNode && lightNode->mMetaData)
+    {
+        lightNode->mMetaData->Get("PBR_LightRange", range);
+    }
+    if (range > 0.0f)
+    {
+        return range;
+    }
+
+    const float peak = std::max(color.r, std::max(color.g, color.b));
+    if (light->mAttenuationQuadratic > 0.0f)
+    {
+        return std::sqrt(peak / (kLightRangeCutoff * light->mAttenuationQuadratic));
+    }
+    if (light->mAttenuationLinear > 0.0f)
+    {
+        return peak / (kLightRangeCutoff * light->mAttenuationLinear);
+    }
+    return std::sqrt(peak / kLightRangeCutoff);
+}
+
+bool importLight(const aiLight* light, const aiScene* assimpScene, LightInfo& importedLight)
+{
+    if (!light)
+    {
+        return false;
+    }
+
+    switch (light->mType)
+    {
+    case aiLightSource_POINT:
+        importedLight.type = static_cast<uint32_t>(LightType::ePoint);
+        break;
+    case aiLightSource_SPOT:
+        importedLight.type = static_cast<uint32_t>(LightType::eSpot);
+        break;
+    case aiLightSource_DIRECTIONAL:
+        importedLight.type = static_cast<uint32_t>(LightType::eDirectional);
+        break;
+    case aiLightSource_AREA:
+        importedLight.type = static_cast<uint32_t>(LightType::eArea);
+        break;
+    default:
+        return false;
+    }
+
+    // lights are attached to the node of the same name, its model space transform places them
+    const aiNode*   lightNode   = assimpScene->mRootNode->FindNode(light->mName);
+    const glm::mat4 nodeToModel = lightNode ? computeNodeToModel(lightNode) : glm::mat4(1.0f);
+
+    const glm::vec3 position(light->mPosition.x, light->mPosition.y, light->mPosition.z);
+    const glm::vec3 direction(light->mDirection.x, light->mDirection.y, light->mDirection.z);
+    const glm::vec3 up(light->mUp.x, light->mUp.y, light->mUp.z);
+
+    importedLight.position  = glm::vec3(nodeToModel * glm::vec4(position, 1.0f));
+    importedLight.direction = glm::length(direction) > 0.0f ? glm::normalize(glm::mat3(nodeToModel) * direction) : glm::vec3(0.0f, 0.0f, -1.0f);
+    importedLight.color     = glm::vec3(light->mColorDiffuse.r, light->mColorDiffuse.g, light->mColorDiffuse.b);
+    importedLight.range     = computeLightRange(light, importedLight.color, lightNode);
+
+    if (importedLight.type == static_cast<uint32_t>(LightType::eSpot))
+    {
+        // assimp stores full cone angles
+        const float cosOuter     = std::cos(0.5f * light->mAngleOuterCone);
+        const float cosInner     = std::cos(0.5f * std::min(light->mAngleInnerCone, light->mAngleOuterCone));
+        importedLight.spotScale  = 1.0f / std::max(cosInner - cosOuter, 1e-4f);
+        importedLight.spotOffset = -cosOuter * importedLight.spotScale;
+    }
+    else if (importedLight.type == static_cast<uint32_t>(LightType::eArea))
+    {
+        const glm::vec3 tangent = glm::cross(up, direction);
+        importedLight.tangent   = glm::length(tangent) > 0.0f ? glm::normalize(glm::mat3(nodeToModel) * tangent) : glm::vec3(1.0f, 0.0f, 0.0f);
+        importedLight.areaSize  = glm::vec2(light->mSize.x, light->mSize.y);
+        importedLight.range += 0.5f * glm::length(importedLight.areaSize);
+    }
+    return true;
+}
+
 class ModelFormatImporter
 {
 public:
@@ -675,6 +771,19 @@ public:
             return result;
         }
 
+        if (loadingCfg.loadLights && assimpScene->mNumLights > 0)
+        {
+            package.asset.lights.reserve(assimpScene->mNumLights);
+            for (uint32_t lightIndex = 0; lightIndex < assimpScene->mNumLights; ++lightIndex)
+            {
+                LightInfo importedLight;
+                if (importLight(assimpScene->mLights[lightIndex], assimpScene, importedLight))
+                {
+                    package.asset.lights.push_back(importedLight);
+                }
+            }
+        }
+
         result.success = true;
         return result;
     }
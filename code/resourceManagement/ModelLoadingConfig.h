@@ -24,6 +24,7 @@ struct ModelLoadingConfig
     float           globalScale                     = 1.0f;
     bool            loadMaterials                   = true;
     bool            loadTextures                    = true;
+    bool            loadLights                      = true;
     bool            registerEmbeddedTexturePlaceholders = true;
     bool            srgbBaseColorTextures           = true;
     bool            srgbEmissiveTextures            = true;
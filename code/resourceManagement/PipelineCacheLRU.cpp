@@ -0,0 +1,74 @@
+#include "PipelineCacheLRU.h"
+#include <algorithm>
+
+namespace Play
+{
+
+void PipelineCacheLRU::touch(BlockKey block, uint64_t frame)
+{
+    auto res = _entries.find(block);
+    if (res == _entries.end())
+    {
+        Entry entry;
+        entry.lruPosition = _lru.insert(_lru.end(), block);
+        res               = _entries.emplace(block, entry).first;
+    }
+    else
+    {
+        _lru.splice(_lru.end(), _lru, res->second.lruPosition);
+    }
+    res->second.lastUsedFrame = std::max(res->second.lastUsedFrame, frame);
+}
+
+void PipelineCacheLRU::setResidentBytes(BlockKey block, uint64_t bytes)
+{
+    auto res = _entries.find(block);
+    if (res == _entries.end())
+    {
+        return;
+    }
+    _residentBytes    = _residentBytes - res->second.bytes + bytes;
+    res->second.bytes = bytes;
+}
+
+void PipelineCacheLRU::remove(BlockKey block)
+{
+    auto res = _entries.find(block);
+    if (res == _entries.end())
+    {
+        return;
+    }
+    _residentBytes -= res->second.bytes;
+    _lru.erase(res->second.lruPosition);
+    _entries.erase(res);
+}
+
+bool PipelineCacheLRU::isResident(BlockKey block) const
+{
+    return _entries.contains(block);
+}
+
+std::vector<BlockKey> PipelineCacheLRU::collectEvictions(uint64_t budgetBytes, uint64_t frame, uint32_t minIdleFrames,
+                                                         const std::function<bool(BlockKey)>& canUnload) const
+{
+    std::vector<BlockKey> evictions;
+    uint64_t              residentBytes = _residentBytes;
+    for (auto it = _lru.begin(); it != _lru.end() && residentBytes > budgetBytes; ++it)
+    {
+        const Entry& entry = _entries.at(*it);
+        // the list is ordered by use, everything after this block was used at least as recently
+        if (frame < entry.lastUsedFrame + minIdleFrames)
+        {
+            break;
+        }
+        if (canUnload && !canUnload(*it))
+        {
+            continue;
+        }
+        evictions.push_back(*it);
+        residentBytes -= entry.bytes;
+    }
+    return evictions;
+}
+
+} // namespace Play
@@ -0,0 +1,54 @@
+#ifndef PIPELINE_CACHE_LRU_H
+#define PIPELINE_CACHE_LRU_H
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <vector>
+namespace Play
+{
+using BlockKey = std::uint32_t;
+
+// resident pipeline cache blocks in least recently used order with their VkPipelineCache data size. Blocks that are
+// unloaded to disk leave the list and come back on their next touch
+class PipelineCacheLRU
+{
+public:
+    // the block is used this frame, resident from now on
+    void touch(BlockKey block, uint64_t frame);
+    void setResidentBytes(BlockKey block, uint64_t bytes);
+    // the block was unloaded or dropped
+    void remove(BlockKey block);
+    bool isResident(BlockKey block) const;
+
+    // least recently used blocks to unload until the rest fits into budgetBytes. Blocks used within the last
+    // minIdleFrames and blocks canUnload refuses stay, so the result may leave the budget exceeded
+    std::vector<BlockKey> collectEvictions(uint64_t budgetBytes, uint64_t frame, uint32_t minIdleFrames,
+                                           const std::function<bool(BlockKey)>& canUnload) const;
+
+    uint64_t getResidentBytes() const
+    {
+        return _residentBytes;
+    }
+
+    uint32_t getResidentBlocks() const
+    {
+        return static_cast<uint32_t>(_entries.size());
+    }
+
+private:
+    struct Entry
+    {
+        uint64_t                      bytes         = 0;
+        uint64_t                      lastUsedFrame = 0;
+        std::list<BlockKey>::iterator lruPosition;
+    };
+
+    std::unordered_map<BlockKey, Entry> _entries;
+    std::list<BlockKey>                 _lru; // least recently used first
+    uint64_t                            _residentBytes = 0;
+};
+
+} // namespace Play
+
+#endif // PIPELINE_CACHE_LRU_H
@@ -1,4 +1,6 @@
 #include "PipelineCacheManager.h"
+#include "PipelinePrecompiler.h"
+#include "PipelineLibrary.h"
 #include <nvutils/hash_operations.hpp>
 #include <nvutils/parallel_work.hpp>
 #include <nvvk/check_error.hpp>
@@ -10,10 +12,47 @@ namespace Play
 {
 DataWriter* sqliteWriter = nullptr;
 
+namespace
+{
+// the caches of the render device, which also names the identity the database is kept for
+class VulkanPipelineCacheDevice : public PipelineCacheDevice
+{
+public:
+    void getIdentity(uint32_t& deviceID, uint32_t& vendorID, uint8_t* pipelineCacheUUID) override
+    {
+        const VkPhysicalDeviceProperties& properties = vkDriver->_physicalDeviceProperties2.properties;
+        deviceID                                     = properties.deviceID;
+        vendorID                                     = properties.vendorID;
+        memcpy(pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    }
+
+    VkPipelineCache createCache(const void* initialData, size_t initialSize) override
+    {
+        VkPipelineCacheCreateInfo pipelineCacheCreateInfo{VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+        pipelineCacheCreateInfo.initialDataSize = initialSize;
+        pipelineCacheCreateInfo.pInitialData    = initialData;
+        VkPipelineCache cache                   = VK_NULL_HANDLE;
+        NVVK_CHECK(vkCreatePipelineCache(vkDriver->getDevice(), &pipelineCacheCreateInfo, nullptr, &cache));
+        return cache;
+    }
+
+    void getCacheData(VkPipelineCache cache, size_t* size, void* data) override
+    {
+        vkGetPipelineCacheData(vkDriver->getDevice(), cache, size, data);
+    }
+
+    void destroyCache(VkPipelineCache cache) override
+    {
+        vkDestroyPipelineCache(vkDriver->getDevice(), cache, nullptr);
+    }
+};
+} // namespace
+
 bool PplCacheBlock::loadFromDisk(bool fullLoading)
 {
-    BufferStream res{};
-    if (!sqliteWriter->read(getBlockPath(), res))
+    // read in place, the cache data goes to the driver without a copy
+    BlobView res = sqliteWriter->readView(getBlockPath());
+    if (!res.valid())
     {
         return false;
     }
@@ -21,54 +60,49 @@ bool PplCacheBlock::loadFromDisk(bool fullLoading)
     res.read(&_currentPipelineCount, sizeof(uint32_t));
     _pipelineKeys.resize(_currentPipelineCount);
     res.read(_pipelineKeys.data(), sizeof(uint64_t) * _currentPipelineCount);
+    res.read(&_currPsoCacheSize, sizeof(size_t));
 
-    std::unique_lock<std::mutex> lock(_stateLock);
+    // the caller holds _stateLock, without the cache data the block stays evicted until it is used
     _state = _currentPipelineCount < MAX_BLOCK_PIPELINE_COUNT ? BLOCK_STATE_BUILDING : BLOCK_STATE_FINALIZED;
-    if (fullLoading)
+    if (!fullLoading)
     {
-        std::vector<uint8_t> cacheData;
-        res.read(&_currPsoCacheSize, sizeof(size_t));
-        cacheData.resize(_currPsoCacheSize);
-        res.read(cacheData.data(), _currPsoCacheSize);
-        VkPipelineCacheCreateInfo pipelineCacheCreateInfo{VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
-        pipelineCacheCreateInfo.initialDataSize = _currPsoCacheSize;
-        pipelineCacheCreateInfo.pInitialData    = cacheData.data();
-        NVVK_CHECK(vkCreatePipelineCache(vkDriver->getDevice(), &pipelineCacheCreateInfo, nullptr, &_vkHandle));
-        {
-            _state &= ~BLOCK_STATE_EVICTED;
-        }
+        _state |= BLOCK_STATE_EVICTED;
+        return true;
     }
+    // a truncated block starts an empty cache
+    const uint8_t* cacheData = res.take(_currPsoCacheSize);
+    _vkHandle                = _device->createCache(cacheData, cacheData ? _currPsoCacheSize : 0);
     return true;
 }
 
 void PplCacheBlock::saveToDisk()
 {
     std::unique_lock<std::mutex> lock(_cacheLock);
-    BufferStream                 stream;
+    // an unloaded block was saved when it went out
+    if (_vkHandle == VK_NULL_HANDLE) return;
+    _device->getCacheData(_vkHandle, reinterpret_cast<size_t*>(&_currPsoCacheSize), nullptr);
+    std::vector<uint8_t> cacheData(_currPsoCacheSize);
+    _device->getCacheData(_vkHandle, reinterpret_cast<size_t*>(&_currPsoCacheSize), cacheData.data());
+
+    BufferStream stream;
     stream.write(&_blockKey, sizeof(BlockKey));
     stream.write(&_currentPipelineCount, sizeof(uint32_t));
     stream.write(_pipelineKeys.data(), sizeof(uint64_t) * _currentPipelineCount);
     stream.write(&_currPsoCacheSize, sizeof(size_t));
-    vkGetPipelineCacheData(vkDriver->getDevice(), _vkHandle, reinterpret_cast<size_t*>(&_currPsoCacheSize), nullptr);
-    std::vector<uint8_t> cacheData(_currPsoCacheSize);
-    vkGetPipelineCacheData(vkDriver->getDevice(), _vkHandle, reinterpret_cast<size_t*>(&_currPsoCacheSize), cacheData.data());
     stream.write(cacheData.data(), _currPsoCacheSize);
     sqliteWriter->write(getBlockPath(), stream);
 }
 
 void PplCacheBlock::init()
 {
-    _state = BLOCK_STATE_BUILDING;
-    VkPipelineCacheCreateInfo pipelineCacheCreateInfo{VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
-    pipelineCacheCreateInfo.initialDataSize = 0;
-    pipelineCacheCreateInfo.pInitialData    = nullptr;
-    NVVK_CHECK(vkCreatePipelineCache(vkDriver->getDevice(), &pipelineCacheCreateInfo, nullptr, &_vkHandle));
+    _state    = BLOCK_STATE_BUILDING;
+    _vkHandle = _device->createCache(nullptr, 0);
 }
 
 bool PplCacheBlock::tryAdd(PipelineKey& key)
 {
     std::unique_lock<std::mutex> lock(_stateLock);
-    if (_state >= BLOCK_STATE_CLOSING)
+    if ((_state & ~BLOCK_STATE_EVICTED) >= BLOCK_STATE_CLOSING)
     {
         return false;
     }
@@ -76,24 +110,31 @@ bool PplCacheBlock::tryAdd(PipelineKey& key)
     ++_pendingPipelineCount;
     if (_currentPipelineCount + _pendingPipelineCount >= MAX_BLOCK_PIPELINE_COUNT)
     {
-        _state = BLOCK_STATE_CLOSING;
+        _state = BLOCK_STATE_CLOSING | (_state & BLOCK_STATE_EVICTED);
     }
     return true;
 }
 
+void PplCacheBlock::addPending()
+{
+    std::unique_lock<std::mutex> lock(_stateLock);
+    ++_pendingPipelineCount;
+}
+
 void PplCacheBlock::unLoad()
 {
     std::unique_lock<std::mutex> lock(_stateLock);
-    saveToDisk();
-    if (!isEvicted() && _vkHandle != VK_NULL_HANDLE)
+    if (isEvicted() || _vkHandle == VK_NULL_HANDLE)
     {
-        vkDestroyPipelineCache(vkDriver->getDevice(), _vkHandle, nullptr);
-        _vkHandle = VK_NULL_HANDLE;
-        _state |= BLOCK_STATE_EVICTED;
+        return;
     }
+    saveToDisk();
+    _device->destroyCache(_vkHandle);
+    _vkHandle  = VK_NULL_HANDLE;
+    _state    |= BLOCK_STATE_EVICTED;
 }
 
-void PplCacheBlock::createPipeline(std::function<VkPipeline(PplCacheBlock*)>&& createFunc)
+void PplCacheBlock::createPipeline(std::function<VkPipeline(PplCacheBlock*)>&& createFunc, bool newPipeline)
 {
     { // load data from disk if evicted
         std::unique_lock<std::mutex> lock(_stateLock);
@@ -105,10 +146,12 @@ void PplCacheBlock::createPipeline(std::function<VkPipeline(PplCacheBlock*)>&& c
     { // create pipeline maybe modify the vkHandle, so need lock
         std::unique_lock<std::mutex> lock(_cacheLock);
         createFunc(this);
+        // the manager budgets resident blocks by their cache data
+        _device->getCacheData(_vkHandle, reinterpret_cast<size_t*>(&_currPsoCacheSize), nullptr);
     }
     { // update state
         std::unique_lock<std::mutex> lock(_stateLock);
-        ++_currentPipelineCount;
+        _currentPipelineCount += newPipeline ? 1 : 0;
         --_pendingPipelineCount;
         if (_state == BLOCK_STATE_CLOSING && _pendingPipelineCount == 0)
         {
@@ -189,7 +232,8 @@ PipelineKey PSOState::getPipelineKey()
     {
         nvutils::hashCombine(key, ds);
     }
-    dirtyFlag = false;
+    dirtyFlag   = false;
+    pipelineKey = key;
     return key;
 }
 
@@ -214,6 +258,7 @@ PipelineKey RenderTargetState::getPipelineKey() const
     nvutils::hashCombine(key, depthAttachmentFormat);
     nvutils::hashCombine(key, stencilAttachmentFormat);
     nvutils::hashCombine(key, sampleCount);
+    nvutils::hashCombine(key, shadingRateAttachment);
     return key;
 }
 
@@ -227,7 +272,8 @@ PipelineLayoutDesc& PipelineLayoutDesc::setDescriptorSetLayout(DescriptorEnum se
 PipelineLayoutDesc& PipelineLayoutDesc::setDescriptorSet(DescriptorEnum setSlot, DescriptorSetBindings& descriptorSet)
 {
     descriptorSet.setDescriptorSetSlot(setSlot);
-    return setDescriptorSetLayout(setSlot, descriptorSet.finalizeLayout());
+    VkDescriptorSetLayout layout = descriptorSet.finalizeLayout();
+    return setDescriptorSetLayout(setSlot, _descriptorBuffer ? descriptorSet.getBufferSetLayout() : layout);
 }
 
 PipelineLayoutDesc& PipelineLayoutDesc::setMaterialDescriptorSet(DescriptorSetBindings& descriptorSet)
@@ -242,6 +288,12 @@ PipelineLayoutDesc& PipelineLayoutDesc::setPushConstantRange(const VkPushConstan
     return *this;
 }
 
+PipelineLayoutDesc& PipelineLayoutDesc::setDescriptorBuffer(bool descriptorBuffer)
+{
+    _descriptorBuffer = descriptorBuffer;
+    return *this;
+}
+
 uint32_t PipelineLayoutDesc::getSetLayoutCount() const
 {
     uint32_t count = 0;
@@ -260,9 +312,11 @@ PipelineKey PipelineLayoutDesc::getPipelineKey() const
     PipelineKey key = 0;
     const uint32_t setCount = getSetLayoutCount();
     nvutils::hashCombine(key, setCount);
+    // set layouts with the same bindings are compatible, the content keeps the key stable across runs
+    const DescriptorSetCache* descriptorCache = vkDriver->getDescriptorSetCache();
     for (uint32_t index = 0; index < setCount; ++index)
     {
-        nvutils::hashCombine(key, _setLayouts[index]);
+        nvutils::hashCombine(key, descriptorCache->getSetLayoutKey(_setLayouts[index]));
     }
     nvutils::hashCombine(key, _hasPushConstantRange);
     if (_hasPushConstantRange)
@@ -271,6 +325,7 @@ PipelineKey PipelineLayoutDesc::getPipelineKey() const
         nvutils::hashCombine(key, _pushConstantRange.offset);
         nvutils::hashCombine(key, _pushConstantRange.size);
     }
+    nvutils::hashCombine(key, _descriptorBuffer);
     return key;
 }
 
@@ -284,22 +339,27 @@ PipelineLayoutCache::~PipelineLayoutCache()
             layout->vkHandle = VK_NULL_HANDLE;
         }
     }
-    if (_emptyDescriptorSetLayout != VK_NULL_HANDLE)
+    for (VkDescriptorSetLayout* emptyLayout : {&_emptyDescriptorSetLayout, &_emptyBufferDescriptorSetLayout})
     {
-        vkDestroyDescriptorSetLayout(vkDriver->getDevice(), _emptyDescriptorSetLayout, nullptr);
-        _emptyDescriptorSetLayout = VK_NULL_HANDLE;
+        if (*emptyLayout != VK_NULL_HANDLE)
+        {
+            vkDestroyDescriptorSetLayout(vkDriver->getDevice(), *emptyLayout, nullptr);
+            *emptyLayout = VK_NULL_HANDLE;
+        }
     }
 }
 
-VkDescriptorSetLayout PipelineLayoutCache::getEmptyDescriptorSetLayout()
+VkDescriptorSetLayout PipelineLayoutCache::getEmptyDescriptorSetLayout(bool descriptorBuffer)
 {
-    if (_emptyDescriptorSetLayout != VK_NULL_HANDLE) return _emptyDescriptorSetLayout;
+    VkDescriptorSetLayout& emptyLayout = descriptorBuffer ? _emptyBufferDescriptorSetLayout : _emptyDescriptorSetLayout;
+    if (emptyLayout != VK_NULL_HANDLE) return emptyLayout;
 
     VkDescriptorSetLayoutCreateInfo layoutInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+    layoutInfo.flags        = descriptorBuffer ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT : 0;
     layoutInfo.bindingCount = 0;
     layoutInfo.pBindings    = nullptr;
-    NVVK_CHECK(vkCreateDescriptorSetLayout(vkDriver->getDevice(), &layoutInfo, nullptr, &_emptyDescriptorSetLayout));
-    return _emptyDescriptorSetLayout;
+    NVVK_CHECK(vkCreateDescriptorSetLayout(vkDriver->getDevice(), &layoutInfo, nullptr, &emptyLayout));
+    return emptyLayout;
 }
 
 PipelineLayout* PipelineLayoutCache::getOrCreatePipelineLayout(const PipelineLayoutDesc& desc)
@@ -308,6 +368,8 @@ PipelineLayout* PipelineLayoutCache::getOrCreatePipelineLayout(const PipelineLay
     auto        iter = _pipelineLayoutMap.find(key);
     if (iter != _pipelineLayoutMap.end())
     {
+        // layouts of the same content may have been destroyed and created again, the live handles are the ones to record
+        iter->second->setLayouts = desc.getSetLayouts();
         return iter->second.get();
     }
 
@@ -317,11 +379,13 @@ PipelineLayout* PipelineLayoutCache::getOrCreatePipelineLayout(const PipelineLay
     layout->setLayouts = desc.getSetLayouts();
     layout->hasPushConstant = desc.hasPushConstantRange();
     layout->pushConstantRange = desc.getPushConstantRange();
+    layout->descriptorBuffer = desc.isDescriptorBuffer();
 
     std::vector<VkDescriptorSetLayout> setLayouts(layout->setCount);
     for (uint32_t index = 0; index < layout->setCount; ++index)
     {
-        setLayouts[index] = layout->setLayouts[index] != VK_NULL_HANDLE ? layout->setLayouts[index] : getEmptyDescriptorSetLayout();
+        setLayouts[index] =
+            layout->setLayouts[index] != VK_NULL_HANDLE ? layout->setLayouts[index] : getEmptyDescriptorSetLayout(layout->descriptorBuffer);
     }
 
     VkPipelineLayoutCreateInfo createInfo{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
@@ -376,7 +440,8 @@ PipelineKey GraphicsPipelineStateInitializer::getPipelineKey()
     nvutils::hashCombine(key, pipelineLayout ? pipelineLayout->hash : 0);
     return key;
 }
-PplCacheBlockManager::PplCacheBlockManager()
+PplCacheBlockManager::PplCacheBlockManager(std::unique_ptr<PipelineCacheDevice> device, std::filesystem::path cachePath)
+    : _device(std::move(device)), _cachePath(std::move(cachePath))
 {
     loadAllBlockFromDisk();
 }
@@ -410,154 +475,239 @@ void PplCacheBlockManager::HeaderInfo::initFromLoadRes(BufferStream& res)
 
 void PplCacheBlockManager::loadAllBlockFromDisk()
 {
-    if (!std::filesystem::exists(sqliteWriter->getRootPath() / PIPELINE_CACHE_PATH / PIPELINE_CACHE_FILE_NAME))
+    if (!std::filesystem::exists(sqliteWriter->getRootPath() / _cachePath))
     {
-        sqliteWriter->open((PIPELINE_CACHE_PATH / PIPELINE_CACHE_FILE_NAME).string());
-        memcpy(_HeaderInfo.pipelineCacheUUID, vkDriver->_physicalDeviceProperties2.properties.pipelineCacheUUID, VK_UUID_SIZE);
-        _HeaderInfo.deviceID = vkDriver->_physicalDeviceProperties2.properties.deviceID;
-        _HeaderInfo.vendorID = vkDriver->_physicalDeviceProperties2.properties.vendorID;
+        sqliteWriter->open(_cachePath.string());
+        _device->getIdentity(_HeaderInfo.deviceID, _HeaderInfo.vendorID, _HeaderInfo.pipelineCacheUUID);
         saveHeaderInfo();
     }
     else
     {
         // 首先验证头信息,然后判断cache是否过多,执行一定的删除逻辑
-        VkPhysicalDeviceProperties2 prop2 = vkDriver->_physicalDeviceProperties2;
-        BufferStream                res{};
-        sqliteWriter->open((PIPELINE_CACHE_PATH / PIPELINE_CACHE_FILE_NAME).string());
+        uint32_t     deviceID = 0;
+        uint32_t     vendorID = 0;
+        uint8_t      pipelineCacheUUID[VK_UUID_SIZE];
+        BufferStream res{};
+        _device->getIdentity(deviceID, vendorID, pipelineCacheUUID);
+        sqliteWriter->open(_cachePath.string());
         sqliteWriter->read(getRootInfoPath().string(), res);
 
         _HeaderInfo.initFromLoadRes(res);
-        if (prop2.properties.deviceID != _HeaderInfo.deviceID || prop2.properties.vendorID != _HeaderInfo.vendorID ||
-            memcmp(prop2.properties.pipelineCacheUUID, _HeaderInfo.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+        if (deviceID != _HeaderInfo.deviceID || vendorID != _HeaderInfo.vendorID ||
+            memcmp(pipelineCacheUUID, _HeaderInfo.pipelineCacheUUID, VK_UUID_SIZE) != 0)
         {
             // 设备信息不匹配,删除所有cache文件
             sqliteWriter->close();
-            std::filesystem::remove(PIPELINE_CACHE_PATH / PIPELINE_CACHE_FILE_NAME);
+            std::filesystem::remove(sqliteWriter->getRootPath() / _cachePath);
             loadAllBlockFromDisk(); // 重新创建新的文件
         }
         else
         {
-            auto forPerBlock = [&](uint64_t index)
+            for (BlockKey currBlockKey : _HeaderInfo.blockKeys)
             {
-                BlockKey currBlockKey = static_cast<BlockKey>(index);
-                auto     block        = std::make_unique<PplCacheBlock>(currBlockKey);
+                // only the pipeline keys are read, the cache data loads when the block is first used
+                auto block = std::make_unique<PplCacheBlock>(currBlockKey, *_device);
                 if (!block->loadFromDisk())
                 {
-                    return;
+                    continue;
                 }
-
-                std::unique_lock<std::mutex> lk(_lock);
-                _blockMap[currBlockKey] = std::move(block);
                 for (auto& pipelineKey : block->_pipelineKeys)
                 {
                     _pipelineToBlockMap[pipelineKey] = currBlockKey;
                 }
-                _lru.push_front(currBlockKey);
-                _nextBlockKey = std::max(_nextBlockKey, currBlockKey + 1);
-            };
-            for (size_t i = 0; i < _HeaderInfo.blockKeys.size(); ++i)
-            {
-                forPerBlock(i);
+                _nextBlockKey           = std::max(_nextBlockKey, currBlockKey);
+                _blockMap[currBlockKey] = std::move(block);
             }
         }
     }
 }
 
-PplCacheBlock* PplCacheBlockManager::getOrCreateBlock(PipelineKey key)
+bool PplCacheBlockManager::makeResident(PplCacheBlock* block)
 {
-    // Check if the key already exists in the map
-    if (_pipelineToBlockMap.find(key) != _pipelineToBlockMap.end())
     {
-        // Found existing block
-        BlockKey targetBlock = _pipelineToBlockMap[key];
-        if (!_blockMap.contains(targetBlock))
+        std::unique_lock<std::mutex> lock(block->_stateLock);
+        if (block->isEvicted())
         {
-            _pipelineToBlockMap.erase(key);
-            return getOrCreateBlock(key);
-        }
-        // if the block is not loaded, we need to load it
-        {
-            std::unique_lock<std::mutex> lock(_blockMap[targetBlock]->_stateLock);
-            if (_blockMap[targetBlock]->isEvicted())
+            if (!block->loadFromDisk(true))
             {
-                if (!_blockMap[targetBlock]->loadFromDisk(true))
-                {
-                    // if load failed, remove it from map
-                    _blockMap.erase(targetBlock);
-                    _pipelineToBlockMap.erase(key);
-                    return getOrCreateBlock(key);
-                }
+                return false;
             }
+            ++_stats.Reloads;
+        }
+    }
+    block->_lastAccessFrame = _currentFrame;
+    _lru.touch(block->_blockKey, _currentFrame);
+    _lru.setResidentBytes(block->_blockKey, block->_currPsoCacheSize);
+    return true;
+}
+
+PplCacheBlock* PplCacheBlockManager::getOrCreateBlock(PipelineKey key, bool& newPipeline)
+{
+    std::unique_lock<std::mutex> lock(_lock);
+    // Check if the key already exists in the map
+    newPipeline     = false;
+    auto knownBlock = _pipelineToBlockMap.find(key);
+    if (knownBlock != _pipelineToBlockMap.end())
+    {
+        auto res = _blockMap.find(knownBlock->second);
+        if (res != _blockMap.end() && makeResident(res->second.get()))
+        {
+            // pending until createPipeline ran, so the block is not unloaded in between
+            res->second->addPending();
+            return res->second.get();
         }
-        for (auto it = _lru.begin(); it != _lru.end(); ++it)
+        // the block is gone or its data could not be read back, the pipeline goes into another block
+        if (res != _blockMap.end())
         {
-            if (*it == targetBlock)
-            {
-                // Move this element to the front
-                _lru.splice(_lru.begin(), _lru, it);
-                break;
-            }
+            _lru.remove(res->first);
+            _blockMap.erase(res);
         }
-        return _blockMap[targetBlock].get();
+        _pipelineToBlockMap.erase(knownBlock);
     }
+
     // Check if current block can be used
-    else if (_blockMap.find(_nextBlockKey) != _blockMap.end() && _blockMap[_nextBlockKey]->tryAdd(key))
+    newPipeline       = true;
+    auto currentBlock = _blockMap.find(_nextBlockKey);
+    if (currentBlock != _blockMap.end())
     {
-        // 如果当前block可以添加,则添加到当前block
-        _pipelineToBlockMap[key] = _nextBlockKey;
-        if (_blockMap[_nextBlockKey]->isEvicted())
+        if (!makeResident(currentBlock->second.get()))
         {
-            if (!_blockMap[_nextBlockKey]->loadFromDisk(true))
-            {
-                // if load failed, remove it from map
-                _blockMap.erase(_nextBlockKey);
-                _pipelineToBlockMap.erase(key);
-                return getOrCreateBlock(key);
-            }
+            _lru.remove(currentBlock->first);
+            _blockMap.erase(currentBlock);
         }
-        // Move to head
-        for (auto it = _lru.begin(); it != _lru.end(); ++it)
+        else if (currentBlock->second->tryAdd(key))
         {
-            if (*it == _nextBlockKey)
-            {
-                _lru.splice(_lru.begin(), _lru, it);
-                break;
-            }
+            _pipelineToBlockMap[key] = _nextBlockKey;
+            return currentBlock->second.get();
         }
-        return _blockMap[_nextBlockKey].get();
     }
-    // Create a new block
-    else
+
+    // 如果没有可用的block,则创建一个新的block
+    ++_nextBlockKey;
+    auto newBlock = std::make_unique<PplCacheBlock>(_nextBlockKey, *_device);
+    newBlock->init();
+    newBlock->tryAdd(key);
+    PplCacheBlock* block     = newBlock.get();
+    _blockMap[_nextBlockKey] = std::move(newBlock);
+    _pipelineToBlockMap[key] = _nextBlockKey;
+    makeResident(block);
+    return block;
+}
+
+void PplCacheBlockManager::createPipeline(BlockKey blockKey, bool newPipeline, const std::function<VkPipeline(VkPipelineCache)>& createFunc)
+{
+    PplCacheBlock* block = nullptr;
     {
-        // 如果没有可用的block,则创建一个新的block
-        ++_nextBlockKey;
-        auto newBlock = std::make_unique<PplCacheBlock>(_nextBlockKey);
-        newBlock->init();
-        _blockMap[_nextBlockKey] = std::move(newBlock);
-        _pipelineToBlockMap[key] = _nextBlockKey;
-        _lru.push_front(_nextBlockKey);
-        _blockMap[_nextBlockKey]->tryAdd(key);
-        return _blockMap[_nextBlockKey].get();
+        std::unique_lock<std::mutex> lock(_lock);
+        auto                         found = _blockMap.find(blockKey);
+        block                              = found != _blockMap.end() ? found->second.get() : nullptr;
     }
+    if (!block)
+    {
+        LOGW("Pipeline cache block %u went out while a compile was queued, the pipeline is created without it\n", blockKey);
+        createFunc(VK_NULL_HANDLE);
+        return;
+    }
+    // the pending count getOrCreateBlock added keeps it resident, it is not erased until createPipeline ran
+    block->createPipeline([&](PplCacheBlock* cacheBlock) { return createFunc(cacheBlock->_vkHandle); }, newPipeline);
 }
 
-PplCacheBlockManager::~PplCacheBlockManager()
+void PplCacheBlockManager::Tick(uint64_t frame)
 {
+    std::unique_lock<std::mutex> lock(_lock);
+    _currentFrame = frame;
+
+    // the cache data of a block grows with every pipeline created through it
+    for (auto& [blockKey, block] : _blockMap)
+    {
+        if (_lru.isResident(blockKey))
+        {
+            _lru.setResidentBytes(blockKey, block->_currPsoCacheSize);
+        }
+    }
+    tryToUnloadBlock();
+
+    _stats.Blocks         = static_cast<uint32_t>(_blockMap.size());
+    _stats.ResidentBlocks = _lru.getResidentBlocks();
+    _stats.ResidentKB     = static_cast<uint32_t>(_lru.getResidentBytes() / 1024);
+    _stats.PeakResidentKB = std::max(_stats.PeakResidentKB, _stats.ResidentKB);
+}
+
+void PplCacheBlockManager::tryToUnloadBlock()
+{
+    auto canUnload = [this](BlockKey blockKey)
+    {
+        PplCacheBlock&               block = *_blockMap[blockKey];
+        std::unique_lock<std::mutex> lock(block._stateLock);
+        // pipelines still being created read the cache
+        return block._pendingPipelineCount == 0;
+    };
+    const uint64_t              budgetBytes = static_cast<uint64_t>(_settings.BudgetKB) * 1024;
+    const std::vector<BlockKey> evictions   = _lru.collectEvictions(budgetBytes, _currentFrame, _settings.MinIdleFrames, canUnload);
+    if (evictions.empty()) return;
+
+    // the blocks going out this frame are saved in one transaction
+    DataWriterBatch batch(*sqliteWriter);
+    for (BlockKey blockKey : evictions)
+    {
+        // saveToDisk then unLoad, the next getOrCreateBlock of one of its pipelines reloads it
+        _blockMap[blockKey]->unLoad();
+        _lru.remove(blockKey);
+        ++_stats.Evictions;
+    }
+}
+
+void PplCacheBlockManager::deinit()
+{
+    std::unique_lock<std::mutex> lock(_lock);
+    DataWriterBatch              batch(*sqliteWriter);
     saveHeaderInfo();
     for (auto& [key, block] : _blockMap)
     {
         block->unLoad();
+        _lru.remove(key);
     }
 }
 
+PplCacheBlockManager::~PplCacheBlockManager()
+{
+    deinit();
+}
+
 PipelineCacheManager::PipelineCacheManager()
 {
     sqliteWriter       = new DataWriter();
-    _cacheBlockManager = std::make_unique<PplCacheBlockManager>();
+    _cacheBlockManager = std::make_unique<PplCacheBlockManager>(std::make_unique<VulkanPipelineCacheDevice>());
+    loadPipelineRecords();
+    queryLibrarySupport();
 }
 PipelineCacheManager::~PipelineCacheManager()
 {
-    _cacheBlockManager.reset();
+    // rebuilds collected below then land in the pipeline map like any other pipeline
+    for (auto& [key, ppl] : _stalePipelines)
+    {
+        vkDestroyPipeline(vkDriver->getDevice(), ppl, nullptr);
+    }
+    _stalePipelines.clear();
+    if (_compileQueue)
+    {
+        // the pipelines finished by now are collected below and destroyed with the others
+        _compileQueue->stop();
+        collectPrecompiledPipelines();
+        _compileQueue.reset();
+    }
+    // the optimized links reading them are done
+    for (auto& [key, library] : _libraryParts)
+    {
+        vkDestroyPipeline(vkDriver->getDevice(), library, nullptr);
+    }
+    _libraryParts.clear();
+    {
+        // the records, the header and every resident block in one transaction
+        DataWriterBatch batch(*sqliteWriter);
+        savePipelineRecords();
+        _cacheBlockManager.reset();
+    }
     if (sqliteWriter)
     {
         sqliteWriter->close();
@@ -571,6 +721,119 @@ PipelineCacheManager::~PipelineCacheManager()
 }
 
 
+void PipelineCacheManager::beginFrame(uint64_t frame)
+{
+    collectPrecompiledPipelines();
+    _cacheBlockManager->Tick(frame);
+}
+
+void PipelineCacheManager::loadPipelineRecords()
+{
+    BufferStream stream;
+    uint32_t     recordCount = 0;
+    if (!sqliteWriter->read(PIPELINE_RECORDS_FILE_NAME, stream) || !stream.read(recordCount)) return;
+    for (uint32_t i = 0; i < recordCount; ++i)
+    {
+        std::vector<uint8_t> bytes;
+        uint32_t             byteCount = 0;
+        if (!stream.read(byteCount) || !stream.read(bytes, byteCount))
+        {
+            LOGW("Pipeline records are truncated after %u of %u\n", i, recordCount);
+            break;
+        }
+        const uint64_t recordHash    = memoryHash(bytes);
+        _pipelineRecords[recordHash] = std::move(bytes);
+    }
+    _cacheBlockManager->getStats().RecordedPipelines = static_cast<uint32_t>(_pipelineRecords.size());
+}
+
+void PipelineCacheManager::savePipelineRecords()
+{
+    if (_pipelineRecords.empty()) return;
+    // records of other render modes are kept, their shaders are loaded when that mode runs
+    BufferStream stream;
+    stream.write(static_cast<uint32_t>(_pipelineRecords.size()));
+    for (const auto& [recordHash, bytes] : _pipelineRecords)
+    {
+        stream.write(static_cast<uint32_t>(bytes.size()));
+        stream.write(bytes);
+    }
+    sqliteWriter->write(PIPELINE_RECORDS_FILE_NAME, stream);
+}
+
+void PipelineCacheManager::recordPipeline(const PipelineRecord& record)
+{
+    BufferStream stream;
+    record.write(stream);
+    std::vector<uint8_t>& bytes      = stream.getRawData();
+    const uint64_t        recordHash = memoryHash(bytes);
+    if (_pipelineRecords.try_emplace(recordHash, std::move(bytes)).second)
+    {
+        _cacheBlockManager->getStats().RecordedPipelines = static_cast<uint32_t>(_pipelineRecords.size());
+    }
+}
+
+PipelineLayout* PipelineCacheManager::getOrCreateRecordedPipelineLayout(const PipelineRecord& record)
+{
+    DescriptorSetCache*                                 descriptorCache = vkDriver->getDescriptorSetCache();
+    PipelineLayoutDesc                                  layoutDesc;
+    std::vector<std::pair<VkDescriptorSetLayout, bool>> createdLayouts; // with the descriptor buffer flag
+    bool                                                resolved = true;
+    layoutDesc.setDescriptorBuffer(record.descriptorBuffer);
+    for (uint32_t slot = 0; slot < static_cast<uint32_t>(DescriptorEnum::eCount) && resolved; ++slot)
+    {
+        const PipelineSetLayoutRecord& setLayout = record.setLayouts[slot];
+        if (!setLayout.used) continue;
+        VkDescriptorSetLayout layout = descriptorCache->findSetLayout(DescriptorSetCache::hashSetLayoutContent(setLayout.flags, setLayout.bindings));
+        // the engine, scene and frame layouts carry binding flags the record does not keep, they have to be live
+        if (layout == VK_NULL_HANDLE && slot >= static_cast<uint32_t>(DescriptorEnum::ePerPassDescriptorSet))
+        {
+            const bool bufferLayout = setLayout.flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+            if (bufferLayout)
+            {
+                layout = descriptorCache->getDescriptorBuffer().isSupported()
+                             ? descriptorCache->getDescriptorBuffer().createSetLayout(setLayout.bindings)
+                             : VK_NULL_HANDLE;
+            }
+            else
+            {
+                VkDescriptorSetLayoutCreateInfo layoutInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+                layoutInfo.flags        = setLayout.flags;
+                layoutInfo.bindingCount = static_cast<uint32_t>(setLayout.bindings.size());
+                layoutInfo.pBindings    = setLayout.bindings.data();
+                NVVK_CHECK(vkCreateDescriptorSetLayout(vkDriver->getDevice(), &layoutInfo, nullptr, &layout));
+            }
+            if (layout != VK_NULL_HANDLE)
+            {
+                descriptorCache->registerSetLayout(layout, setLayout.flags, setLayout.bindings);
+                createdLayouts.emplace_back(layout, bufferLayout);
+            }
+        }
+        resolved = layout != VK_NULL_HANDLE;
+        layoutDesc.setDescriptorSetLayout(static_cast<DescriptorEnum>(slot), layout);
+    }
+    if (record.hasPushConstantRange)
+    {
+        layoutDesc.setPushConstantRange(record.pushConstantRange);
+    }
+
+    PipelineLayout* pipelineLayout = resolved ? _pipelineLayoutCache.getOrCreatePipelineLayout(layoutDesc) : nullptr;
+    // a pipeline layout does not reference its set layouts once created, the pass creates its own when it runs
+    for (const auto& [layout, bufferLayout] : createdLayouts)
+    {
+        descriptorCache->unregisterSetLayout(layout);
+        if (bufferLayout)
+        {
+            descriptorCache->getDescriptorBuffer().destroySetLayout(layout);
+        }
+        else
+        {
+            vkDestroyDescriptorSetLayout(vkDriver->getDevice(), layout, nullptr);
+        }
+    }
+    return pipelineLayout;
+}
+
 PipelineLayout* PipelineCacheManager::getOrCreatePipelineLayout(const PipelineLayoutDesc& desc)
 {
     return _pipelineLayoutCache.getOrCreatePipelineLayout(desc);
@@ -603,6 +866,68 @@ PipelineKey ComputePipelineStateInitializer::getPipelineKey()
     nvutils::hashCombine(key, pipelineLayout ? pipelineLayout->hash : 0);
     return key;
 }
+bool PipelineCacheManager::collectShaderStages(const GraphicsShaderSet& shaderSet, std::vector<ShaderStage>& stages)
+{
+    auto addStage = [&stages](VkShaderStageFlagBits stage, ShaderID shaderID)
+    {
+        const ShaderModule* shaderModule = ShaderManager::Instance().getShaderById(shaderID);
+        if (!shaderModule) return false;
+        stages.push_back({stage, shaderModule->_shaderModule, shaderModule->_entryPoint, shaderModule->_specialization});
+        return true;
+    };
+    stages.clear();
+    if (shaderSet.isMeshPipeline())
+    {
+        return (shaderSet.taskModuleID == ~0U || addStage(VK_SHADER_STAGE_TASK_BIT_EXT, shaderSet.taskModuleID)) &&
+               addStage(VK_SHADER_STAGE_MESH_BIT_EXT, shaderSet.meshModuleID) && addStage(VK_SHADER_STAGE_FRAGMENT_BIT, shaderSet.fragModuleID);
+    }
+    // depth only pipelines leave the fragment stage out
+    return addStage(VK_SHADER_STAGE_VERTEX_BIT, shaderSet.vertexModuleID) &&
+           (shaderSet.fragModuleID == ~0U || addStage(VK_SHADER_STAGE_FRAGMENT_BIT, shaderSet.fragModuleID));
+}
+
+void PipelineCacheManager::setupGraphicsPipelineCreator(nvvk::GraphicsPipelineCreator& creator, const GraphicsPipelineStateInitializer& initializer,
+                                                        const std::vector<ShaderStage>& stages)
+{
+    creator.clearShaders();
+    for (const ShaderStage& stage : stages)
+    {
+        creator.addShader(stage.stage, stage.entryPoint.c_str(), stage.module).pSpecializationInfo = stage.getSpecializationInfo();
+    }
+
+    creator.pipelineInfo.layout                    = initializer.pipelineLayout->vkHandle;
+    creator.renderingState.depthAttachmentFormat   = initializer.renderTargetState.depthAttachmentFormat;
+    creator.renderingState.stencilAttachmentFormat = initializer.renderTargetState.stencilAttachmentFormat;
+    creator.colorFormats                           = initializer.renderTargetState.colorFormats;
+    // passes drawing with a shading rate attachment set the combiner ops when the pipeline is bound
+    creator.dynamicStateValues = initializer.psoState.dynamicStates;
+    creator.flags2             = initializer.psoState.flags2;
+    if (initializer.renderTargetState.shadingRateAttachment)
+    {
+        creator.dynamicStateValues.push_back(VK_DYNAMIC_STATE_FRAGMENT_SHADING_RATE_KHR);
+        creator.flags2 |= VK_PIPELINE_CREATE_2_RENDERING_FRAGMENT_SHADING_RATE_ATTACHMENT_BIT_KHR;
+    }
+    if (initializer.pipelineLayout->descriptorBuffer)
+    {
+        creator.flags2 |= VK_PIPELINE_CREATE_2_DESCRIPTOR_BUFFER_BIT_EXT;
+    }
+}
+
+VkComputePipelineCreateInfo PipelineCacheManager::getComputePipelineCreateInfo(const ComputePipelineStateInitializer& initializer,
+                                                                               const ShaderStage&                     stage)
+{
+    VkComputePipelineCreateInfo createInfo{VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+    createInfo.stage                     = {};
+    createInfo.stage.sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    createInfo.stage.module              = stage.module;
+    createInfo.stage.pName               = stage.entryPoint.c_str();
+    createInfo.stage.stage               = VK_SHADER_STAGE_COMPUTE_BIT;
+    createInfo.stage.pSpecializationInfo = stage.getSpecializationInfo();
+    createInfo.layout                    = initializer.pipelineLayout->vkHandle;
+    createInfo.flags                     = initializer.pipelineLayout->descriptorBuffer ? VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT : 0;
+    return createInfo;
+}
+
 VkPipeline PipelineCacheManager::getOrCreateGraphicsPipeline(GraphicsPipelineStateInitializer& initializer)
 {
     if (!initializer.pipelineLayout || initializer.pipelineLayout->vkHandle == VK_NULL_HANDLE)
@@ -612,46 +937,55 @@ VkPipeline PipelineCacheManager::getOrCreateGraphicsPipeline(GraphicsPipelineSta
     }
 
     uint64_t key = initializer.getPipelineKey();
-    if (_pipelineMap.find(key) != _pipelineMap.end())
-    {
-        return _pipelineMap[key];
-    }
-
-    _gfxPipelineCreator.clearShaders();
-    if (initializer.shaderSet.isMeshPipeline())
+    if (VkPipeline stale = getStalePipeline(key); stale != VK_NULL_HANDLE)
     {
-        if (initializer.shaderSet.taskModuleID != ~0U)
+        std::vector<ShaderStage> stages;
+        if (!isPipelineCompiling(key) && collectShaderStages(initializer.shaderSet, stages))
         {
-            auto taskShaderModule = ShaderManager::Instance().getShaderById(initializer.shaderSet.taskModuleID);
-            _gfxPipelineCreator.addShader(VK_SHADER_STAGE_TASK_BIT_EXT, taskShaderModule->_entryPoint.c_str(), taskShaderModule->_shaderModule);
+            queuePipeline(key, getGraphicsCompileFunc(key, initializer, stages));
         }
-        auto meshShaderModule = ShaderManager::Instance().getShaderById(initializer.shaderSet.meshModuleID);
-        auto fragShaderModule = ShaderManager::Instance().getShaderById(initializer.shaderSet.fragModuleID);
-        _gfxPipelineCreator.addShader(VK_SHADER_STAGE_MESH_BIT_EXT, meshShaderModule->_entryPoint.c_str(), meshShaderModule->_shaderModule);
-        _gfxPipelineCreator.addShader(VK_SHADER_STAGE_FRAGMENT_BIT, fragShaderModule->_entryPoint.c_str(), fragShaderModule->_shaderModule);
+        return stale;
     }
-    else
+    VkPipeline existing = waitForPipeline(key);
+    if (existing != VK_NULL_HANDLE)
     {
-        auto vertexShaderModule = ShaderManager::Instance().getShaderById(initializer.shaderSet.vertexModuleID);
-        auto fragShaderModule   = ShaderManager::Instance().getShaderById(initializer.shaderSet.fragModuleID);
-        _gfxPipelineCreator.addShader(VK_SHADER_STAGE_VERTEX_BIT, vertexShaderModule->_entryPoint.c_str(), vertexShaderModule->_shaderModule);
-        _gfxPipelineCreator.addShader(VK_SHADER_STAGE_FRAGMENT_BIT, fragShaderModule->_entryPoint.c_str(), fragShaderModule->_shaderModule);
+        return existing;
     }
 
-    _gfxPipelineCreator.pipelineInfo.layout                 = initializer.pipelineLayout->vkHandle;
-    _gfxPipelineCreator.renderingState.depthAttachmentFormat = initializer.renderTargetState.depthAttachmentFormat;
-    _gfxPipelineCreator.renderingState.stencilAttachmentFormat = initializer.renderTargetState.stencilAttachmentFormat;
-    _gfxPipelineCreator.colorFormats = initializer.renderTargetState.colorFormats;
+    std::vector<ShaderStage> stages;
+    if (!collectShaderStages(initializer.shaderSet, stages))
+    {
+        LOGE("Graphics pipeline uses a shader that is not loaded");
+        return VK_NULL_HANDLE;
+    }
 
-    auto       block = _cacheBlockManager->getOrCreateBlock(key);
-    VkPipeline pipeline;
-    block->createPipeline(
-        [pipelineCreatorPtr = &_gfxPipelineCreator, initializerPtr = &initializer, pipelinePtr = &pipeline](PplCacheBlock* block)
-        {
-            pipelineCreatorPtr->createGraphicsPipeline(vkDriver->getDevice(), block->_vkHandle, initializerPtr->psoState, pipelinePtr);
-            return *pipelinePtr;
-        });
-    _pipelineMap[key] = pipeline;
+    const bool useLibraries = _librariesSupported && getSettings().UseLibraries && canUsePipelineLibraries(initializer);
+    VkPipeline pipeline     = useLibraries ? linkGraphicsPipeline(key, initializer, stages) : VK_NULL_HANDLE;
+    if (pipeline == VK_NULL_HANDLE)
+    {
+        setupGraphicsPipelineCreator(_gfxPipelineCreator, initializer, stages);
+        bool newPipeline = false;
+        auto block       = _cacheBlockManager->getOrCreateBlock(key, newPipeline);
+        block->createPipeline(
+            [pipelineCreatorPtr = &_gfxPipelineCreator, initializerPtr = &initializer, pipelinePtr = &pipeline](PplCacheBlock* block)
+            {
+                pipelineCreatorPtr->createGraphicsPipeline(vkDriver->getDevice(), block->_vkHandle, initializerPtr->psoState, pipelinePtr);
+                return *pipelinePtr;
+            },
+            newPipeline);
+        _pipelineMap[key] = pipeline;
+    }
+    for (ShaderID shaderID : {initializer.shaderSet.vertexModuleID, initializer.shaderSet.fragModuleID, initializer.shaderSet.taskModuleID,
+                              initializer.shaderSet.meshModuleID})
+    {
+        addShaderPipeline(shaderID, key);
+    }
+
+    PipelineRecord record;
+    if (getSettings().RecordPipelines && record.fromInitializer(initializer))
+    {
+        recordPipeline(record);
+    }
     return pipeline;
 }
 VkPipeline PipelineCacheManager::getOrCreateComputePipeline(ComputePipelineStateInitializer& initializer)
@@ -662,33 +996,430 @@ VkPipeline PipelineCacheManager::getOrCreateComputePipeline(ComputePipelineState
         return VK_NULL_HANDLE;
     }
 
-    uint64_t key = initializer.getPipelineKey();
-    if (_pipelineMap.find(key) != _pipelineMap.end())
+    uint64_t key           = initializer.getPipelineKey();
+    auto     cShaderModule = ShaderManager::Instance().getShaderById(initializer.computeModuleID);
+    if (VkPipeline stale = getStalePipeline(key); stale != VK_NULL_HANDLE)
+    {
+        if (!isPipelineCompiling(key) && cShaderModule)
+        {
+            const ShaderStage stage = {VK_SHADER_STAGE_COMPUTE_BIT, cShaderModule->_shaderModule, cShaderModule->_entryPoint,
+                                       cShaderModule->_specialization};
+            queuePipeline(key, getComputeCompileFunc(key, initializer, stage));
+        }
+        return stale;
+    }
+    VkPipeline existing = waitForPipeline(key);
+    if (existing != VK_NULL_HANDLE)
     {
-        return _pipelineMap[key];
+        return existing;
     }
 
-    auto                        cShaderModule = ShaderManager::Instance().getShaderById(initializer.computeModuleID);
-    VkComputePipelineCreateInfo createInfo{VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
-    createInfo.stage        = {};
-    createInfo.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    createInfo.stage.module = cShaderModule->_shaderModule;
-    createInfo.stage.pName  = cShaderModule->_entryPoint.c_str();
-    createInfo.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
-    createInfo.layout       = initializer.pipelineLayout->vkHandle;
-    createInfo.flags        = 0;
-
-    auto       block = _cacheBlockManager->getOrCreateBlock(key);
+    if (!cShaderModule)
+    {
+        LOGE("Compute pipeline uses a shader that is not loaded");
+        return VK_NULL_HANDLE;
+    }
+    const ShaderStage           stage      = {VK_SHADER_STAGE_COMPUTE_BIT, cShaderModule->_shaderModule, cShaderModule->_entryPoint,
+                                              cShaderModule->_specialization};
+    VkComputePipelineCreateInfo createInfo = getComputePipelineCreateInfo(initializer, stage);
+
+    bool       newPipeline = false;
+    auto       block       = _cacheBlockManager->getOrCreateBlock(key, newPipeline);
     VkPipeline pipeline;
     block->createPipeline(
         [pipelineCreatorPtr = &createInfo, pipelinePtr = &pipeline](PplCacheBlock* block)
         {
             vkCreateComputePipelines(vkDriver->getDevice(), block->_vkHandle, 1, pipelineCreatorPtr, nullptr, pipelinePtr);
             return *pipelinePtr;
-        });
+        },
+        newPipeline);
     _pipelineMap[key] = pipeline;
+    addShaderPipeline(initializer.computeModuleID, key);
+
+    PipelineRecord record;
+    if (getSettings().RecordPipelines && record.fromInitializer(initializer))
+    {
+        recordPipeline(record);
+    }
+    return pipeline;
+}
+
+void PipelineCacheManager::precompileRecordedPipelines()
+{
+    const uint32_t threadCount = getSettings().PrecompileThreads;
+    if (threadCount == 0 || _pipelineRecords.empty()) return;
+
+    _compileQueue    = std::make_unique<PipelineCompileQueue>(threadCount);
+    _precompileStart = std::chrono::steady_clock::now();
+    _precompiling    = true;
+    PipelineCacheStats& stats = getStats();
+    for (const auto& [recordHash, bytes] : _pipelineRecords)
+    {
+        PipelineRecord record;
+        BufferStream   stream(bytes);
+        if (!record.read(stream) || !queueRecordedPipeline(record))
+        {
+            ++stats.PrecompileSkipped;
+        }
+    }
+    LOGI("Precompiling %u of %u recorded pipelines on %u threads\n", stats.PrecompileQueued, stats.RecordedPipelines, threadCount);
+}
+
+bool PipelineCacheManager::queueRecordedPipeline(const PipelineRecord& record)
+{
+    ShaderManager&          shaderManager = ShaderManager::Instance();
+    std::array<ShaderID, 4> shaderIDs;
+    for (size_t i = 0; i < shaderIDs.size(); ++i)
+    {
+        shaderIDs[i] = record.shaderNames[i].empty() ? ~0U : shaderManager.getShaderIdByName(record.shaderNames[i]);
+        // permutation variants load on first use, a recorded one is loaded ahead of it
+        if (!record.shaderNames[i].empty() && shaderIDs[i] == ~0U) shaderIDs[i] = shaderManager.loadVariantByName(record.shaderNames[i]);
+        // the shaders of other render modes are not loaded in this run
+        if (!record.shaderNames[i].empty() && shaderIDs[i] == ~0U) return false;
+    }
+    PipelineLayout* pipelineLayout = getOrCreateRecordedPipelineLayout(record);
+    if (!pipelineLayout) return false;
+
+    PipelineKey                       key = 0;
+    PipelineCompileQueue::CompileFunc compile;
+    if (record.type == PipelineRecordType::eGraphics)
+    {
+        GraphicsPipelineStateInitializer initializer;
+        initializer.shaderSet         = {shaderIDs[0], shaderIDs[1], shaderIDs[2], shaderIDs[3]};
+        initializer.psoState          = record.psoState;
+        initializer.renderTargetState = record.renderTargetState;
+        initializer.pipelineLayout    = pipelineLayout;
+        key                           = initializer.getPipelineKey();
+        std::vector<ShaderStage> stages;
+        if (_pipelineMap.contains(key) || _compileQueue->isPending(key) || !collectShaderStages(initializer.shaderSet, stages)) return false;
+        compile = getGraphicsCompileFunc(key, initializer, stages);
+        for (ShaderID shaderID : shaderIDs)
+        {
+            addShaderPipeline(shaderID, key);
+        }
+    }
+    else
+    {
+        ComputePipelineStateInitializer initializer;
+        initializer.computeModuleID = shaderIDs[0];
+        initializer.pipelineLayout  = pipelineLayout;
+        key                         = initializer.getPipelineKey();
+        const ShaderModule* shaderModule = shaderManager.getShaderById(shaderIDs[0]);
+        if (_pipelineMap.contains(key) || _compileQueue->isPending(key) || !shaderModule) return false;
+        compile = getComputeCompileFunc(
+            key, initializer, {VK_SHADER_STAGE_COMPUTE_BIT, shaderModule->_shaderModule, shaderModule->_entryPoint, shaderModule->_specialization});
+        addShaderPipeline(shaderIDs[0], key);
+    }
+    _compileQueue->submit(key, std::move(compile));
+    ++getStats().PrecompileQueued;
+    return true;
+}
+
+std::function<VkPipeline()> PipelineCacheManager::getGraphicsCompileFunc(PipelineKey key, const GraphicsPipelineStateInitializer& initializer,
+                                                                         const std::vector<ShaderStage>& stages)
+{
+    bool           newPipeline = false;
+    const BlockKey blockKey    = _cacheBlockManager->getOrCreateBlock(key, newPipeline)->_blockKey;
+    // everything the worker reads is copied, the block by its key. A hot reload waits for the jobs using the module it retires
+    return [blockManager = _cacheBlockManager.get(), blockKey, newPipeline, initializer, stages]() mutable
+    {
+        nvvk::GraphicsPipelineCreator creator;
+        setupGraphicsPipelineCreator(creator, initializer, stages);
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        blockManager->createPipeline(blockKey, newPipeline,
+                                     [&](VkPipelineCache cache)
+                                     {
+                                         creator.createGraphicsPipeline(vkDriver->getDevice(), cache, initializer.psoState, &pipeline);
+                                         return pipeline;
+                                     });
+        return pipeline;
+    };
+}
+
+std::function<VkPipeline()> PipelineCacheManager::getComputeCompileFunc(PipelineKey key, const ComputePipelineStateInitializer& initializer,
+                                                                        const ShaderStage& stage)
+{
+    bool           newPipeline = false;
+    const BlockKey blockKey    = _cacheBlockManager->getOrCreateBlock(key, newPipeline)->_blockKey;
+    return [blockManager = _cacheBlockManager.get(), blockKey, newPipeline, initializer, stage]() mutable
+    {
+        VkComputePipelineCreateInfo createInfo = getComputePipelineCreateInfo(initializer, stage);
+        VkPipeline                  pipeline   = VK_NULL_HANDLE;
+        blockManager->createPipeline(blockKey, newPipeline,
+                                     [&](VkPipelineCache cache)
+                                     {
+                                         vkCreateComputePipelines(vkDriver->getDevice(), cache, 1, &createInfo, nullptr, &pipeline);
+                                         return pipeline;
+                                     });
+        return pipeline;
+    };
+}
+
+void PipelineCacheManager::queuePipeline(PipelineKey key, std::function<VkPipeline()>&& compile)
+{
+    if (!_compileQueue)
+    {
+        _compileQueue = std::make_unique<PipelineCompileQueue>(std::max(getSettings().PrecompileThreads, 1u));
+    }
+    _compileQueue->submit(key, std::move(compile));
+}
+
+void PipelineCacheManager::addShaderPipeline(ShaderID shaderID, PipelineKey key)
+{
+    if (shaderID == ~0U) return;
+    _shaderPipelines[shaderID].insert(key);
+}
+
+void PipelineCacheManager::queryLibrarySupport()
+{
+    // the extension is optional at device creation, the feature query reports false when it is missing
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT libraryFeatures{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT};
+    VkPhysicalDeviceFeatures2                          features2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+    features2.pNext = &libraryFeatures;
+    vkGetPhysicalDeviceFeatures2(vkDriver->getPhysicalDevice(), &features2);
+
+    VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT libraryProperties{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT};
+    VkPhysicalDeviceProperties2 properties2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2};
+    properties2.pNext = &libraryProperties;
+    vkGetPhysicalDeviceProperties2(vkDriver->getPhysicalDevice(), &properties2);
+    // without fast linking a link costs as much as a whole pipeline
+    _librariesSupported           = libraryFeatures.graphicsPipelineLibrary && libraryProperties.graphicsPipelineLibraryFastLinking;
+    getStats().LibrariesSupported = _librariesSupported;
+    if (!_librariesSupported)
+    {
+        LOGW("Graphics pipeline libraries with fast linking are not supported, graphics pipelines are created whole\n");
+    }
+}
+
+VkPipeline PipelineCacheManager::getOrCreateLibraryPart(PipelineKey partKey, PipelineLibraryPart part, const PipelineLibraryState& state,
+                                                        const std::vector<ShaderStage>& stages)
+{
+    auto found = _libraryParts.find(partKey);
+    if (found != _libraryParts.end())
+    {
+        return found->second;
+    }
+
+    std::vector<VkPipelineShaderStageCreateInfo> partStages;
+    for (const ShaderStage& stage : stages)
+    {
+        if ((getPipelineLibraryStages(part) & stage.stage) == 0) continue;
+        VkPipelineShaderStageCreateInfo stageInfo{VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO};
+        stageInfo.stage               = stage.stage;
+        stageInfo.module              = stage.module;
+        stageInfo.pName               = stage.entryPoint.c_str();
+        stageInfo.pSpecializationInfo = stage.getSpecializationInfo();
+        partStages.push_back(stageInfo);
+    }
+
+    // the parts go through the cache blocks like whole pipelines, the next run finds their shaders compiled
+    bool       newPipeline = false;
+    auto       block       = _cacheBlockManager->getOrCreateBlock(partKey, newPipeline);
+    VkPipeline library     = VK_NULL_HANDLE;
+    block->createPipeline(
+        [&](PplCacheBlock* cacheBlock)
+        {
+            state.createPart(cacheBlock->_vkHandle, part, partStages, &library);
+            return library;
+        },
+        newPipeline);
+    if (library == VK_NULL_HANDLE)
+    {
+        return VK_NULL_HANDLE;
+    }
+    _libraryParts[partKey] = library;
+    ++getStats().LibraryParts;
+    return library;
+}
+
+VkPipeline PipelineCacheManager::linkGraphicsPipeline(PipelineKey key, const GraphicsPipelineStateInitializer& initializer,
+                                                      const std::vector<ShaderStage>& stages)
+{
+    const auto                 start = std::chrono::steady_clock::now();
+    const PipelineLibraryKeys  keys  = getPipelineLibraryKeys(initializer);
+    const PipelineLibraryState state(initializer);
+    std::vector<VkPipeline>    libraries;
+    for (uint32_t index = 0; index < kPipelineLibraryPartCount; ++index)
+    {
+        const PipelineLibraryPart part = static_cast<PipelineLibraryPart>(index);
+        if (!keys.hasPart(part)) continue;
+        VkPipeline library = getOrCreateLibraryPart(keys.getPartKey(part), part, state, stages);
+        if (library == VK_NULL_HANDLE)
+        {
+            LOGW("Creating a graphics pipeline library part failed, the pipeline is created whole\n");
+            return VK_NULL_HANDLE;
+        }
+        libraries.push_back(library);
+    }
+    // a hot reload of one of these shaders retires the parts compiled from it
+    const GraphicsShaderSet& shaderSet = initializer.shaderSet;
+    for (ShaderID shaderID : {shaderSet.vertexModuleID, shaderSet.taskModuleID, shaderSet.meshModuleID})
+    {
+        if (shaderID != ~0U) _shaderLibraryParts[shaderID].insert(keys.getPartKey(PipelineLibraryPart::ePreRasterization));
+    }
+    if (shaderSet.fragModuleID != ~0U)
+    {
+        _shaderLibraryParts[shaderSet.fragModuleID].insert(keys.getPartKey(PipelineLibraryPart::eFragmentShader));
+    }
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (state.link(VK_NULL_HANDLE, libraries, false, &pipeline) != VK_SUCCESS)
+    {
+        LOGW("Fast linking a graphics pipeline failed, the pipeline is created whole\n");
+        return VK_NULL_HANDLE;
+    }
+    // the fast link draws like a stale pipeline until its optimized link is collected in its place
+    _stalePipelines[key] = pipeline;
+    _fastLinkedPipelines.insert(key);
+    queuePipeline(key, getOptimizedLinkFunc(key, initializer, libraries));
+
+    PipelineCacheStats& stats = getStats();
+    ++stats.FastLinkedPipelines;
+    stats.LastFastLinkMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
     return pipeline;
 }
+
+std::function<VkPipeline()> PipelineCacheManager::getOptimizedLinkFunc(PipelineKey key, const GraphicsPipelineStateInitializer& initializer,
+                                                                       const std::vector<VkPipeline>& libraries)
+{
+    bool           newPipeline = false;
+    const BlockKey blockKey    = _cacheBlockManager->getOrCreateBlock(key, newPipeline)->_blockKey;
+    // the parts stay until the job finished, a hot reload waits for it before retiring them
+    return [blockManager = _cacheBlockManager.get(), blockKey, newPipeline, initializer, libraries]()
+    {
+        const PipelineLibraryState state(initializer);
+        VkPipeline                 pipeline = VK_NULL_HANDLE;
+        blockManager->createPipeline(blockKey, newPipeline,
+                                     [&](VkPipelineCache cache)
+                                     {
+                                         state.link(cache, libraries, true, &pipeline);
+                                         return pipeline;
+                                     });
+        return pipeline;
+    };
+}
+
+VkPipeline PipelineCacheManager::getStalePipeline(PipelineKey key)
+{
+    if (_stalePipelines.empty()) return VK_NULL_HANDLE;
+    collectPrecompiledPipelines();
+    auto stale = _stalePipelines.find(key);
+    return stale != _stalePipelines.end() ? stale->second : VK_NULL_HANDLE;
+}
+
+void PipelineCacheManager::waitShaderPipelines(ShaderID shaderID)
+{
+    auto keys = _shaderPipelines.find(shaderID);
+    if (keys == _shaderPipelines.end()) return;
+
+    // a queued job runs here instead, with the module it copied still alive
+    for (PipelineKey key : keys->second)
+    {
+        if (isPipelineCompiling(key))
+        {
+            _compileQueue->wait(key);
+        }
+    }
+}
+
+void PipelineCacheManager::invalidateShaderPipelines(ShaderID shaderID)
+{
+    auto keys = _shaderPipelines.find(shaderID);
+    if (keys == _shaderPipelines.end()) return;
+
+    // a job still compiling with the retired module finishes first, then turns stale like the rest
+    waitShaderPipelines(shaderID);
+    collectPrecompiledPipelines();
+
+    for (PipelineKey key : keys->second)
+    {
+        auto pipeline = _pipelineMap.find(key);
+        if (pipeline == _pipelineMap.end()) continue;
+        _stalePipelines[key] = pipeline->second;
+        _pipelineMap.erase(pipeline);
+        ++getStats().InvalidatedPipelines;
+    }
+
+    // only pipelines of this shader linked them, their jobs finished above
+    auto parts = _shaderLibraryParts.find(shaderID);
+    if (parts == _shaderLibraryParts.end()) return;
+    for (PipelineKey partKey : parts->second)
+    {
+        auto library = _libraryParts.find(partKey);
+        if (library == _libraryParts.end()) continue;
+        VkPipeline retired = library->second;
+        vkDriver->deferDestroy([retired]() { vkDestroyPipeline(vkDriver->getDevice(), retired, nullptr); });
+        _libraryParts.erase(library);
+    }
+    _shaderLibraryParts.erase(parts);
+}
+
+void PipelineCacheManager::collectPrecompiledPipelines()
+{
+    if (!_compileQueue) return;
+    // idle is checked first, a job finishing in between is collected with the next call
+    const bool                                      idle = _compileQueue->isIdle();
+    std::vector<std::pair<PipelineKey, VkPipeline>> finished;
+    _compileQueue->collect(finished);
+    for (const auto& [key, pipeline] : finished)
+    {
+        auto stale = _stalePipelines.find(key);
+        if (stale != _stalePipelines.end())
+        {
+            // a rebuild or optimized link that failed leaves the old pipeline drawing
+            const bool fastLinked = _fastLinkedPipelines.erase(key) > 0;
+            VkPipeline retired    = pipeline != VK_NULL_HANDLE ? stale->second : VK_NULL_HANDLE;
+            _pipelineMap[key]     = pipeline != VK_NULL_HANDLE ? pipeline : stale->second;
+            _stalePipelines.erase(stale);
+            if (retired == VK_NULL_HANDLE)
+            {
+                LOGW(fastLinked ? "Optimizing a linked pipeline failed, the fast linked one stays\n"
+                                : "Rebuilding a pipeline after a shader reload failed, the previous one stays\n");
+                continue;
+            }
+            vkDriver->deferDestroy([retired]() { vkDestroyPipeline(vkDriver->getDevice(), retired, nullptr); });
+            ++(fastLinked ? getStats().OptimizedPipelines : getStats().RebuiltPipelines);
+            continue;
+        }
+        if (pipeline == VK_NULL_HANDLE) continue;
+        _pipelineMap[key] = pipeline;
+        ++getStats().PrecompiledPipelines;
+    }
+    if (!idle) return;
+    if (_precompiling)
+    {
+        _precompiling           = false;
+        getStats().PrecompileMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - _precompileStart).count();
+        LOGI("Precompiled %u pipelines in %.1f ms\n", getStats().PrecompiledPipelines, getStats().PrecompileMs);
+    }
+    // the workers go once the queue ran dry, binds no longer touch it until a shader reload queues rebuilds
+    _compileQueue.reset();
+}
+
+bool PipelineCacheManager::isPipelineReady(PipelineKey key)
+{
+    collectPrecompiledPipelines();
+    // a stale pipeline draws while its rebuild compiles
+    return _pipelineMap.contains(key) || _stalePipelines.contains(key);
+}
+
+bool PipelineCacheManager::isPipelineCompiling(PipelineKey key)
+{
+    return _compileQueue && _compileQueue->isPending(key);
+}
+
+VkPipeline PipelineCacheManager::waitForPipeline(PipelineKey key)
+{
+    if (isPipelineCompiling(key))
+    {
+        ++getStats().PrecompileWaits;
+        _compileQueue->wait(key);
+    }
+    collectPrecompiledPipelines();
+    auto pipeline = _pipelineMap.find(key);
+    return pipeline != _pipelineMap.end() ? pipeline->second : VK_NULL_HANDLE;
+}
 VkPipeline PipelineCacheManager::getOrCreateRTPipeline(RTPipelineState& rtState)
 {
     return VK_NULL_HANDLE;
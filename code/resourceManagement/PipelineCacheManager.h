@@ -8,12 +8,13 @@
 #include "ShaderManager.hpp"
 #include "RenderPass.h"
 #include "core/DataWriter.h"
+#include "PipelineCacheLRU.h"
+#include <chrono>
+#include <unordered_set>
 namespace Play
 {
-using BlockKey    = std::uint32_t;
 using PipelineKey = std::size_t;
 
-using CacheLRU                                       = std::list<BlockKey>;
 const uint32_t              MAX_BLOCK_PIPELINE_COUNT = 30;
 const std::filesystem::path PIPELINE_CACHE_PATH      = "pipelineCache";
 const std::filesystem::path PIPELINE_CACHE_FILE_NAME = "pipelineCache.db";
@@ -24,12 +25,28 @@ const uint32_t BLOCK_STATE_CLOSING   = 1 << 2;
 const uint32_t BLOCK_STATE_FINALIZED = 1 << 3;
 const uint32_t BLOCK_STATE_EVICTED   = 1 << 4;
 
+// the database the cache blocks and the pipeline records are kept in
+extern DataWriter* sqliteWriter;
+
+// the driver side of the cache blocks, the blocks create, read back and destroy their VkPipelineCache through it
+class PipelineCacheDevice
+{
+public:
+    virtual ~PipelineCacheDevice() = default;
+    // keys the database, the blocks of another device or driver are dropped
+    virtual void            getIdentity(uint32_t& deviceID, uint32_t& vendorID, uint8_t* pipelineCacheUUID) = 0;
+    virtual VkPipelineCache createCache(const void* initialData, size_t initialSize) = 0;
+    // like vkGetPipelineCacheData, only the size is written without data
+    virtual void            getCacheData(VkPipelineCache cache, size_t* size, void* data) = 0;
+    virtual void            destroyCache(VkPipelineCache cache) = 0;
+};
+
 class PplCacheBlockManager;
 class PplCacheBlock
 {
 public:
-    uint32_t _state;
-    PplCacheBlock(BlockKey key) : _blockKey(key) {}
+    uint32_t _state = 0;
+    PplCacheBlock(BlockKey key, PipelineCacheDevice& device) : _blockKey(key), _device(&device) {}
     inline bool isInited() const
     {
         return _state == BLOCK_STATE_INITED;
@@ -57,8 +74,11 @@ public:
     void init();
 
     bool tryAdd(PipelineKey& key);
+    // a key the block already holds is created again, the block stays resident until createPipeline ran
+    void addPending();
 
-    void createPipeline(std::function<VkPipeline(PplCacheBlock*)>&& createFunc);
+    // newPipeline counts the pipeline into the block, false for keys it held already
+    void createPipeline(std::function<VkPipeline(PplCacheBlock*)>&& createFunc, bool newPipeline = true);
 
     void unLoad();
 
@@ -71,29 +91,81 @@ public:
     uint32_t              _pendingPipelineCount = 0;
     uint64_t              _currPsoCacheSize     = 0;
     std::vector<uint64_t> _pipelineKeys;
-    VkPipelineCache       _vkHandle;
+    VkPipelineCache       _vkHandle = VK_NULL_HANDLE;
     std::mutex            _cacheLock;
     std::mutex            _stateLock;
     uint64_t              _lastAccessFrame = 0;
     PplCacheBlockManager* test             = nullptr;
+    PipelineCacheDevice*  _device          = nullptr;
+};
+
+struct PipelineCacheSettings
+{
+    uint32_t BudgetKB          = 32 * 1024; // VkPipelineCache data kept in memory, colder blocks are saved and unloaded
+    uint32_t MinIdleFrames     = 60;        // blocks used more recently stay loaded even over the budget
+    bool     RecordPipelines   = true;      // new pipelines are recorded for the startup precompile of the next run
+    uint32_t PrecompileThreads = 2;         // workers compiling the recorded pipelines at startup, 0 leaves them to first use
+    bool     UseLibraries      = true;      // new graphics pipelines are fast linked from cached parts, optimized on a worker
+};
+
+struct PipelineCacheStats
+{
+    uint32_t Blocks               = 0;
+    uint32_t ResidentBlocks       = 0;
+    uint32_t ResidentKB           = 0;
+    uint32_t PeakResidentKB       = 0;
+    uint32_t Evictions            = 0;     // since startup
+    uint32_t Reloads              = 0;     // blocks read back from disk, the first use after startup included
+    uint32_t RecordedPipelines    = 0;
+    uint32_t PrecompileQueued     = 0;
+    uint32_t PrecompiledPipelines = 0;
+    uint32_t PrecompileSkipped    = 0;     // records whose shaders or set layouts this run does not have
+    uint32_t PrecompileWaits      = 0;     // binds that waited for a pipeline still compiling
+    float    PrecompileMs         = 0.0f;  // from the startup until the last recorded pipeline compiled
+    uint32_t InvalidatedPipelines = 0;     // built from a shader that was hot reloaded
+    uint32_t RebuiltPipelines     = 0;     // rebuilt in the background and swapped in for an invalidated one
+    bool     LibrariesSupported   = false; // VK_EXT_graphics_pipeline_library with fast linking
+    uint32_t LibraryParts         = 0;     // vertex input, pre-rasterization, fragment shader and output parts created
+    uint32_t FastLinkedPipelines  = 0;
+    uint32_t OptimizedPipelines   = 0;     // optimized links swapped in for a fast linked pipeline
+    float    LastFastLinkMs       = 0.0f;  // the missing parts and the link of the last new pipeline
 };
 
 class PplCacheBlockManager
 {
 public:
-    PplCacheBlockManager();
+    // cachePath is the database, relative to the executable unless it is absolute
+    explicit PplCacheBlockManager(std::unique_ptr<PipelineCacheDevice> device,
+                                  std::filesystem::path                cachePath = PIPELINE_CACHE_PATH / PIPELINE_CACHE_FILE_NAME);
     ~PplCacheBlockManager();
-    void deinit() {}
+    void deinit();
 
-    void Tick() {}
+    // called once per frame, unloads the least recently used blocks while the resident ones exceed the budget
+    void Tick(uint64_t frame);
 
-    void           tryToUnloadBlock() {}
+    void           tryToUnloadBlock();
     void           loadAllBlockFromDisk();
-    PplCacheBlock* getOrCreateBlock(PipelineKey key);
+    // newPipeline is false for a key the block held already
+    PplCacheBlock* getOrCreateBlock(PipelineKey key, bool& newPipeline);
+    // for a compile queued with the block getOrCreateBlock returned, looked up again when the worker runs it. A block
+    // that went out in between leaves the pipeline to be created without a cache
+    void           createPipeline(BlockKey blockKey, bool newPipeline, const std::function<VkPipeline(VkPipelineCache)>& createFunc);
+
+    PipelineCacheSettings& getSettings()
+    {
+        return _settings;
+    }
+
+    PipelineCacheStats& getStats()
+    {
+        return _stats;
+    }
 
 private:
     friend class PplCacheBlock;
     void saveHeaderInfo();
+    // reloads an unloaded block and stamps it, false if its data could not be read back
+    bool makeResident(PplCacheBlock* block);
 
     inline std::filesystem::path getRootInfoPath() const
     {
@@ -109,14 +181,23 @@ private:
         void                  initFromLoadRes(BufferStream& res);
     } _HeaderInfo;
 
-    CacheLRU                                                     _lru;
+    std::unique_ptr<PipelineCacheDevice>                         _device;
+    std::filesystem::path                                        _cachePath;
+    PipelineCacheLRU                                             _lru;
     std::unordered_map<BlockKey, std::unique_ptr<PplCacheBlock>> _blockMap;
     std::unordered_map<PipelineKey, BlockKey>                    _pipelineToBlockMap;
-    std::mutex                                                   _lock;
+    std::mutex                                                   _lock; // the maps, the workers look their blocks up
     uint32_t                                                     _nextBlockKey = 0;
+    uint64_t                                                     _currentFrame = 0;
+    PipelineCacheSettings                                        _settings;
+    PipelineCacheStats                                           _stats;
 };
 
 using ShaderID = uint32_t;
+class PipelineCompileQueue;
+class PipelineLibraryState;
+struct PipelineRecord;
+enum class PipelineLibraryPart : uint32_t;
 class ComputePipelineState
 {
 public:
@@ -165,6 +246,7 @@ struct RenderTargetState
     VkFormat              depthAttachmentFormat   = VK_FORMAT_UNDEFINED;
     VkFormat              stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
     VkSampleCountFlagBits sampleCount              = VK_SAMPLE_COUNT_1_BIT;
+    bool                  shadingRateAttachment    = false;
 
     PipelineKey getPipelineKey() const;
 };
@@ -178,6 +260,7 @@ public:
     std::array<VkDescriptorSetLayout, static_cast<size_t>(DescriptorEnum::eCount)> setLayouts = {VK_NULL_HANDLE};
     VkPushConstantRange pushConstantRange = {};
     bool                hasPushConstant   = false;
+    bool                descriptorBuffer  = false; // pipelines on this layout need the descriptor buffer flag
 };
 
 class PipelineLayoutDesc
@@ -187,6 +270,8 @@ public:
     PipelineLayoutDesc& setDescriptorSet(DescriptorEnum setSlot, DescriptorSetBindings& descriptorSet);
     PipelineLayoutDesc& setMaterialDescriptorSet(DescriptorSetBindings& descriptorSet);
     PipelineLayoutDesc& setPushConstantRange(const VkPushConstantRange& range);
+    // set before the descriptor sets, their layouts then come with the descriptor buffer flag
+    PipelineLayoutDesc& setDescriptorBuffer(bool descriptorBuffer);
 
     template <typename T>
     PipelineLayoutDesc& setPushConstant(VkShaderStageFlags stage = VK_SHADER_STAGE_ALL)
@@ -216,10 +301,16 @@ public:
         return _pushConstantRange;
     }
 
+    bool isDescriptorBuffer() const
+    {
+        return _descriptorBuffer;
+    }
+
 private:
     std::array<VkDescriptorSetLayout, static_cast<size_t>(DescriptorEnum::eCount)> _setLayouts = {VK_NULL_HANDLE};
     VkPushConstantRange _pushConstantRange = {};
     bool                _hasPushConstantRange = false;
+    bool                _descriptorBuffer     = false;
 };
 
 class PipelineLayoutCache
@@ -229,10 +320,11 @@ public:
     PipelineLayout* getOrCreatePipelineLayout(const PipelineLayoutDesc& desc);
 
 private:
-    VkDescriptorSetLayout getEmptyDescriptorSetLayout();
+    VkDescriptorSetLayout getEmptyDescriptorSetLayout(bool descriptorBuffer);
 
     std::unordered_map<PipelineKey, std::unique_ptr<PipelineLayout>> _pipelineLayoutMap;
-    VkDescriptorSetLayout _emptyDescriptorSetLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout _emptyDescriptorSetLayout       = VK_NULL_HANDLE;
+    VkDescriptorSetLayout _emptyBufferDescriptorSetLayout = VK_NULL_HANDLE; // a layout may not mix both kinds of sets
 };
 
 class GraphicsPipelineStateInitializer
@@ -246,6 +338,7 @@ public:
     VkPushConstantRange     pushConstantRange     = {};
     bool                    hasPushConstantRange  = false;
 
+    // a fragment module of ~0U builds a depth only pipeline
     GraphicsPipelineStateInitializer& setShader(ShaderID vertexModuleID, ShaderID fragModuleID);
     GraphicsPipelineStateInitializer& setMeshShader(ShaderID meshModuleID, ShaderID fragModuleID, ShaderID taskModuleID = ~0U);
     GraphicsPipelineStateInitializer& setMaterialDescriptorSet(DescriptorSetBindings& descriptorSet);
@@ -308,12 +401,95 @@ public:
     PipelineLayout* getOrCreatePipelineLayout(const PipelineLayoutDesc& desc);
     VkPipeline getOrCreateRTPipeline(RTPipelineState& rtState);
     VkPipeline getOrCreateMeshPipeline(PSOState& psoState, RenderPass* renderPass, ShaderID mShaderID, ShaderID fShaderID, ShaderID tShaderID = ~0U);
+    void       beginFrame(uint64_t frame);
+
+    // queues the pipelines recorded by earlier runs on worker threads, called once the passes loaded their shaders
+    void precompileRecordedPipelines();
+    // created, or precompiled and collected. Pipelines still compiling are not waited for
+    bool isPipelineReady(PipelineKey key);
+    bool isPipelineCompiling(PipelineKey key);
+    // blocks until a compiling pipeline finished, VK_NULL_HANDLE for keys that were never created or queued
+    VkPipeline waitForPipeline(PipelineKey key);
+    // blocks until no queued or running compile job still holds a module of the shader
+    void waitShaderPipelines(ShaderID shaderID);
+    // the pipelines built from the shader turn stale: they keep drawing while their next bind rebuilds them on a worker
+    void invalidateShaderPipelines(ShaderID shaderID);
+
+    PipelineCacheSettings& getSettings()
+    {
+        return _cacheBlockManager->getSettings();
+    }
+
+    PipelineCacheStats& getStats()
+    {
+        return _cacheBlockManager->getStats();
+    }
 
 private:
+    struct ShaderStage
+    {
+        VkShaderStageFlagBits                       stage;
+        VkShaderModule                              module;
+        std::string                                 entryPoint;
+        std::shared_ptr<const ShaderSpecialization> specialization; // kept alive by the compile jobs holding the stage
+
+        const VkSpecializationInfo* getSpecializationInfo() const
+        {
+            return specialization ? &specialization->info : nullptr;
+        }
+    };
+
+    // false if a module of the set is not loaded
+    static bool collectShaderStages(const GraphicsShaderSet& shaderSet, std::vector<ShaderStage>& stages);
+    static void setupGraphicsPipelineCreator(nvvk::GraphicsPipelineCreator& creator, const GraphicsPipelineStateInitializer& initializer,
+                                             const std::vector<ShaderStage>& stages);
+    static VkComputePipelineCreateInfo getComputePipelineCreateInfo(const ComputePipelineStateInitializer& initializer, const ShaderStage& stage);
+
+    // the set layouts of the record come from the live ones with the same content, or are created for the layout alone
+    PipelineLayout* getOrCreateRecordedPipelineLayout(const PipelineRecord& record);
+    bool            queueRecordedPipeline(const PipelineRecord& record);
+    void            recordPipeline(const PipelineRecord& record);
+    void            loadPipelineRecords();
+    void            savePipelineRecords();
+    // moves the precompiled and rebuilt pipelines into the pipeline map
+    void collectPrecompiledPipelines();
+
+    // compile jobs for the queue, they copy everything they read
+    std::function<VkPipeline()> getGraphicsCompileFunc(PipelineKey key, const GraphicsPipelineStateInitializer& initializer,
+                                                       const std::vector<ShaderStage>& stages);
+    std::function<VkPipeline()> getComputeCompileFunc(PipelineKey key, const ComputePipelineStateInitializer& initializer, const ShaderStage& stage);
+    void                        queuePipeline(PipelineKey key, std::function<VkPipeline()>&& compile);
+    // the invalidated pipeline to draw with until its rebuild is collected, VK_NULL_HANDLE if the key is not stale
+    VkPipeline getStalePipeline(PipelineKey key);
+    void       addShaderPipeline(ShaderID shaderID, PipelineKey key);
+
+    void       queryLibrarySupport();
+    VkPipeline getOrCreateLibraryPart(PipelineKey partKey, PipelineLibraryPart part, const PipelineLibraryState& state,
+                                      const std::vector<ShaderStage>& stages);
+    // fast links the parts of the initializer and queues its optimized link. VK_NULL_HANDLE if a part failed, the
+    // pipeline is then created whole
+    VkPipeline linkGraphicsPipeline(PipelineKey key, const GraphicsPipelineStateInitializer& initializer, const std::vector<ShaderStage>& stages);
+    std::function<VkPipeline()> getOptimizedLinkFunc(PipelineKey key, const GraphicsPipelineStateInitializer& initializer,
+                                                     const std::vector<VkPipeline>& libraries);
+
     std::unique_ptr<PplCacheBlockManager>    _cacheBlockManager = nullptr;
     nvvk::GraphicsPipelineCreator            _gfxPipelineCreator;
     PipelineLayoutCache                      _pipelineLayoutCache;
     std::unordered_map<uint64_t, VkPipeline> _pipelineMap;
+
+    std::unique_ptr<PipelineCompileQueue>              _compileQueue;
+    std::unordered_map<uint64_t, std::vector<uint8_t>> _pipelineRecords; // serialized, by the hash of their bytes
+    std::chrono::steady_clock::time_point              _precompileStart;
+    bool                                               _precompiling = false;
+
+    std::unordered_map<ShaderID, std::unordered_set<PipelineKey>> _shaderPipelines; // the keys built from each shader
+    std::unordered_map<PipelineKey, VkPipeline>                   _stalePipelines;
+
+    bool                                                          _librariesSupported = false;
+    std::unordered_map<PipelineKey, VkPipeline>                   _libraryParts;       // by their part key
+    std::unordered_map<ShaderID, std::unordered_set<PipelineKey>> _shaderLibraryParts; // the parts compiled from each shader
+    // drawn like stale pipelines until their optimized link is collected
+    std::unordered_set<PipelineKey> _fastLinkedPipelines;
 };
 
 } // namespace Play
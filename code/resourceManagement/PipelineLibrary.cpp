@@ -0,0 +1,294 @@
+#include "PipelineLibrary.h"
+#include <algorithm>
+#include <nvutils/hash_operations.hpp>
+#include "core/runtime/VulkanRuntime.h"
+
+namespace
+{
+using namespace Play;
+
+// the same flags and dynamic states setupGraphicsPipelineCreator gives the whole pipeline, every part has to agree on them
+VkPipelineCreateFlags2 getPipelineFlags2(const GraphicsPipelineStateInitializer& initializer)
+{
+    VkPipelineCreateFlags2 flags2 = initializer.psoState.flags2;
+    if (initializer.renderTargetState.shadingRateAttachment)
+    {
+        flags2 |= VK_PIPELINE_CREATE_2_RENDERING_FRAGMENT_SHADING_RATE_ATTACHMENT_BIT_KHR;
+    }
+    if (initializer.pipelineLayout && initializer.pipelineLayout->descriptorBuffer)
+    {
+        flags2 |= VK_PIPELINE_CREATE_2_DESCRIPTOR_BUFFER_BIT_EXT;
+    }
+    return flags2;
+}
+
+std::vector<VkDynamicState> getDynamicStates(const GraphicsPipelineStateInitializer& initializer)
+{
+    std::vector<VkDynamicState> dynamicStates = initializer.psoState.dynamicStates;
+    if (initializer.renderTargetState.shadingRateAttachment)
+    {
+        dynamicStates.push_back(VK_DYNAMIC_STATE_FRAGMENT_SHADING_RATE_KHR);
+    }
+    return dynamicStates;
+}
+
+PipelineKey getPartSeed(const GraphicsPipelineStateInitializer& initializer, PipelineLibraryPart part)
+{
+    PipelineKey key = 0;
+    nvutils::hashCombine(key, static_cast<uint32_t>(part));
+    nvutils::hashCombine(key, getPipelineFlags2(initializer));
+    for (const VkDynamicState dynamicState : getDynamicStates(initializer))
+    {
+        nvutils::hashCombine(key, dynamicState);
+    }
+    return key;
+}
+
+void hashMultisampleState(PipelineKey& key, const VkPipelineMultisampleStateCreateInfo& multisampleState)
+{
+    nvutils::hashCombine(key, multisampleState.rasterizationSamples);
+    nvutils::hashCombine(key, multisampleState.sampleShadingEnable);
+    nvutils::hashCombine(key, multisampleState.minSampleShading);
+    nvutils::hashCombine(key, multisampleState.alphaToCoverageEnable);
+    nvutils::hashCombine(key, multisampleState.alphaToOneEnable);
+}
+
+PipelineKey getVertexInputKey(const GraphicsPipelineStateInitializer& initializer)
+{
+    const PSOState& psoState = initializer.psoState;
+    PipelineKey     key      = getPartSeed(initializer, PipelineLibraryPart::eVertexInput);
+    nvutils::hashCombine(key, psoState.inputAssemblyState.topology);
+    nvutils::hashCombine(key, psoState.inputAssemblyState.primitiveRestartEnable);
+    return key;
+}
+
+PipelineKey getPreRasterizationKey(const GraphicsPipelineStateInitializer& initializer)
+{
+    const PSOState& psoState = initializer.psoState;
+    PipelineKey     key      = getPartSeed(initializer, PipelineLibraryPart::ePreRasterization);
+    nvutils::hashCombine(key, initializer.shaderSet.vertexModuleID);
+    nvutils::hashCombine(key, initializer.shaderSet.taskModuleID);
+    nvutils::hashCombine(key, initializer.shaderSet.meshModuleID);
+    nvutils::hashCombine(key, initializer.pipelineLayout ? initializer.pipelineLayout->hash : 0);
+    nvutils::hashCombine(key, psoState.rasterizationState.depthClampEnable);
+    nvutils::hashCombine(key, psoState.rasterizationState.rasterizerDiscardEnable);
+    nvutils::hashCombine(key, psoState.rasterizationState.polygonMode);
+    nvutils::hashCombine(key, psoState.rasterizationState.cullMode);
+    nvutils::hashCombine(key, psoState.rasterizationState.frontFace);
+    nvutils::hashCombine(key, psoState.rasterizationState.depthBiasEnable);
+    nvutils::hashCombine(key, psoState.rasterizationState.lineWidth);
+    return key;
+}
+
+PipelineKey getFragmentShaderKey(const GraphicsPipelineStateInitializer& initializer)
+{
+    const PSOState& psoState = initializer.psoState;
+    PipelineKey     key      = getPartSeed(initializer, PipelineLibraryPart::eFragmentShader);
+    nvutils::hashCombine(key, initializer.shaderSet.fragModuleID);
+    nvutils::hashCombine(key, initializer.pipelineLayout ? initializer.pipelineLayout->hash : 0);
+    hashMultisampleState(key, psoState.multisampleState);
+    nvutils::hashCombine(key, psoState.depthStencilState.depthTestEnable);
+    nvutils::hashCombine(key, psoState.depthStencilState.depthWriteEnable);
+    nvutils::hashCombine(key, psoState.depthStencilState.depthCompareOp);
+    nvutils::hashCombine(key, psoState.depthStencilState.depthBoundsTestEnable);
+    nvutils::hashCombine(key, psoState.depthStencilState.stencilTestEnable);
+    for (const VkStencilOpState& stencil : {psoState.depthStencilState.front, psoState.depthStencilState.back})
+    {
+        nvutils::hashCombine(key, stencil.failOp);
+        nvutils::hashCombine(key, stencil.passOp);
+        nvutils::hashCombine(key, stencil.depthFailOp);
+        nvutils::hashCombine(key, stencil.compareOp);
+    }
+    return key;
+}
+
+PipelineKey getFragmentOutputKey(const GraphicsPipelineStateInitializer& initializer)
+{
+    const PSOState& psoState = initializer.psoState;
+    PipelineKey     key      = getPartSeed(initializer, PipelineLibraryPart::eFragmentOutput);
+    hashMultisampleState(key, psoState.multisampleState);
+    nvutils::hashCombine(key, psoState.colorBlendState.logicOpEnable);
+    nvutils::hashCombine(key, psoState.colorBlendState.logicOp);
+    for (const auto& enable : psoState.colorBlendEnables)
+    {
+        nvutils::hashCombine(key, enable);
+    }
+    for (const auto& mask : psoState.colorWriteMasks)
+    {
+        nvutils::hashCombine(key, mask);
+    }
+    for (const auto& eq : psoState.colorBlendEquations)
+    {
+        nvutils::hashCombine(key, eq.srcColorBlendFactor);
+        nvutils::hashCombine(key, eq.dstColorBlendFactor);
+        nvutils::hashCombine(key, eq.colorBlendOp);
+        nvutils::hashCombine(key, eq.srcAlphaBlendFactor);
+        nvutils::hashCombine(key, eq.dstAlphaBlendFactor);
+        nvutils::hashCombine(key, eq.alphaBlendOp);
+    }
+    nvutils::hashCombine(key, initializer.renderTargetState.getPipelineKey());
+    return key;
+}
+
+VkGraphicsPipelineLibraryFlagsEXT getLibraryFlags(PipelineLibraryPart part)
+{
+    switch (part)
+    {
+        case PipelineLibraryPart::eVertexInput:
+            return VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT;
+        case PipelineLibraryPart::ePreRasterization:
+            return VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT;
+        case PipelineLibraryPart::eFragmentShader:
+            return VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT;
+        default:
+            return VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT;
+    }
+}
+} // namespace
+
+namespace Play
+{
+
+PipelineLibraryKeys getPipelineLibraryKeys(const GraphicsPipelineStateInitializer& initializer)
+{
+    PipelineLibraryKeys keys;
+    auto                setPart = [&keys](PipelineLibraryPart part, PipelineKey key)
+    {
+        keys.parts[static_cast<uint32_t>(part)]  = key;
+        keys.partMask                           |= 1u << static_cast<uint32_t>(part);
+    };
+    // mesh shaders fetch their own vertices
+    if (!initializer.shaderSet.isMeshPipeline())
+    {
+        setPart(PipelineLibraryPart::eVertexInput, getVertexInputKey(initializer));
+    }
+    setPart(PipelineLibraryPart::ePreRasterization, getPreRasterizationKey(initializer));
+    setPart(PipelineLibraryPart::eFragmentShader, getFragmentShaderKey(initializer));
+    setPart(PipelineLibraryPart::eFragmentOutput, getFragmentOutputKey(initializer));
+    return keys;
+}
+
+bool canUsePipelineLibraries(const GraphicsPipelineStateInitializer& initializer)
+{
+    const std::vector<VkDynamicState>& dynamicStates = initializer.psoState.dynamicStates;
+    // a dynamic discard may still be turned off when the pipeline is bound
+    if (std::find(dynamicStates.begin(), dynamicStates.end(), VK_DYNAMIC_STATE_RASTERIZER_DISCARD_ENABLE) != dynamicStates.end()) return true;
+    return !initializer.psoState.rasterizationState.rasterizerDiscardEnable;
+}
+
+VkShaderStageFlags getPipelineLibraryStages(PipelineLibraryPart part)
+{
+    switch (part)
+    {
+        case PipelineLibraryPart::ePreRasterization:
+            return VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT;
+        case PipelineLibraryPart::eFragmentShader:
+            return VK_SHADER_STAGE_FRAGMENT_BIT;
+        default:
+            return 0;
+    }
+}
+
+PipelineLibraryState::PipelineLibraryState(const GraphicsPipelineStateInitializer& initializer)
+{
+    const PSOState&          psoState          = initializer.psoState;
+    const RenderTargetState& renderTargetState = initializer.renderTargetState;
+    _layout                                    = initializer.pipelineLayout ? initializer.pipelineLayout->vkHandle : VK_NULL_HANDLE;
+    _flags2                                    = getPipelineFlags2(initializer);
+    _colorFormats                              = renderTargetState.colorFormats;
+    _dynamicStates                             = getDynamicStates(initializer);
+
+    _renderingInfo.colorAttachmentCount    = static_cast<uint32_t>(_colorFormats.size());
+    _renderingInfo.pColorAttachmentFormats = _colorFormats.data();
+    _renderingInfo.depthAttachmentFormat   = renderTargetState.depthAttachmentFormat;
+    _renderingInfo.stencilAttachmentFormat = renderTargetState.stencilAttachmentFormat;
+
+    // the passes read their vertices from buffers, there are no bindings to describe
+    _inputAssemblyState.topology               = psoState.inputAssemblyState.topology;
+    _inputAssemblyState.primitiveRestartEnable = psoState.inputAssemblyState.primitiveRestartEnable;
+
+    // viewports and scissors are dynamic with their count
+    _viewportState.viewportCount = 0;
+    _viewportState.scissorCount  = 0;
+
+    // copied without their extension chains, the fields the pipeline key hashes are the ones that count
+    _rasterizationState           = psoState.rasterizationState;
+    _rasterizationState.pNext     = nullptr;
+    _multisampleState             = psoState.multisampleState;
+    _multisampleState.pNext       = nullptr;
+    _multisampleState.pSampleMask = nullptr;
+    _depthStencilState            = psoState.depthStencilState;
+    _depthStencilState.pNext      = nullptr;
+
+    _blendAttachments.resize(_colorFormats.size());
+    for (size_t index = 0; index < _blendAttachments.size(); ++index)
+    {
+        VkPipelineColorBlendAttachmentState& attachment = _blendAttachments[index];
+        if (index < psoState.colorBlendEnables.size())
+        {
+            attachment.blendEnable = psoState.colorBlendEnables[index];
+        }
+        attachment.colorWriteMask = index < psoState.colorWriteMasks.size() ? psoState.colorWriteMasks[index]
+                                                                             : VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                                                                   VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        if (index < psoState.colorBlendEquations.size())
+        {
+            const VkColorBlendEquationEXT& eq = psoState.colorBlendEquations[index];
+            attachment.srcColorBlendFactor    = eq.srcColorBlendFactor;
+            attachment.dstColorBlendFactor    = eq.dstColorBlendFactor;
+            attachment.colorBlendOp           = eq.colorBlendOp;
+            attachment.srcAlphaBlendFactor    = eq.srcAlphaBlendFactor;
+            attachment.dstAlphaBlendFactor    = eq.dstAlphaBlendFactor;
+            attachment.alphaBlendOp           = eq.alphaBlendOp;
+        }
+    }
+    _colorBlendState.logicOpEnable   = psoState.colorBlendState.logicOpEnable;
+    _colorBlendState.logicOp         = psoState.colorBlendState.logicOp;
+    _colorBlendState.attachmentCount = static_cast<uint32_t>(_blendAttachments.size());
+    _colorBlendState.pAttachments    = _blendAttachments.data();
+
+    _dynamicState.dynamicStateCount = static_cast<uint32_t>(_dynamicStates.size());
+    _dynamicState.pDynamicStates    = _dynamicStates.data();
+}
+
+VkResult PipelineLibraryState::createPart(VkPipelineCache cache, PipelineLibraryPart part,
+                                          const std::vector<VkPipelineShaderStageCreateInfo>& stages, VkPipeline* library) const
+{
+    // parts keep what an optimized link needs to compile them again
+    VkPipelineCreateFlags2CreateInfoKHR flagsInfo{VK_STRUCTURE_TYPE_PIPELINE_CREATE_FLAGS_2_CREATE_INFO_KHR, &_renderingInfo};
+    flagsInfo.flags = _flags2 | VK_PIPELINE_CREATE_2_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_2_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+    VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo{VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT, &flagsInfo};
+    libraryInfo.flags = getLibraryFlags(part);
+
+    // the states outside the subset of the part are ignored
+    VkGraphicsPipelineCreateInfo createInfo{VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO, &libraryInfo};
+    createInfo.stageCount          = static_cast<uint32_t>(stages.size());
+    createInfo.pStages             = stages.empty() ? nullptr : stages.data();
+    createInfo.pVertexInputState   = &_vertexInputState;
+    createInfo.pInputAssemblyState = &_inputAssemblyState;
+    createInfo.pViewportState      = &_viewportState;
+    createInfo.pRasterizationState = &_rasterizationState;
+    createInfo.pMultisampleState   = &_multisampleState;
+    createInfo.pDepthStencilState  = &_depthStencilState;
+    createInfo.pColorBlendState    = &_colorBlendState;
+    createInfo.pDynamicState       = &_dynamicState;
+    createInfo.layout              = _layout;
+    createInfo.basePipelineIndex   = -1;
+    return vkCreateGraphicsPipelines(vkDriver->getDevice(), cache, 1, &createInfo, nullptr, library);
+}
+
+VkResult PipelineLibraryState::link(VkPipelineCache cache, const std::vector<VkPipeline>& libraries, bool optimized, VkPipeline* pipeline) const
+{
+    VkPipelineCreateFlags2CreateInfoKHR flagsInfo{VK_STRUCTURE_TYPE_PIPELINE_CREATE_FLAGS_2_CREATE_INFO_KHR};
+    flagsInfo.flags = _flags2 | (optimized ? VK_PIPELINE_CREATE_2_LINK_TIME_OPTIMIZATION_BIT_EXT : 0);
+    VkPipelineLibraryCreateInfoKHR linkInfo{VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR, &flagsInfo};
+    linkInfo.libraryCount = static_cast<uint32_t>(libraries.size());
+    linkInfo.pLibraries   = libraries.data();
+
+    VkGraphicsPipelineCreateInfo createInfo{VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO, &linkInfo};
+    createInfo.layout            = _layout;
+    createInfo.basePipelineIndex = -1;
+    return vkCreateGraphicsPipelines(vkDriver->getDevice(), cache, 1, &createInfo, nullptr, pipeline);
+}
+
+} // namespace Play
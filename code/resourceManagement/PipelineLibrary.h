@@ -0,0 +1,75 @@
+#ifndef PIPELINE_LIBRARY_H
+#define PIPELINE_LIBRARY_H
+#include "PipelineCacheManager.h"
+namespace Play
+{
+// the state subsets of VK_EXT_graphics_pipeline_library, each is compiled into a library of its own
+enum class PipelineLibraryPart : uint32_t
+{
+    eVertexInput = 0,
+    ePreRasterization,
+    eFragmentShader,
+    eFragmentOutput,
+    eCount
+};
+
+constexpr uint32_t kPipelineLibraryPartCount = static_cast<uint32_t>(PipelineLibraryPart::eCount);
+
+// a part is keyed by the initializer fields its subset reads, so pipelines differing in their blend state share the
+// shaders and pipelines differing in a shader share the output interface
+struct PipelineLibraryKeys
+{
+    std::array<PipelineKey, kPipelineLibraryPartCount> parts    = {};
+    uint32_t                                           partMask = 0; // mesh pipelines have no vertex input part
+
+    bool hasPart(PipelineLibraryPart part) const
+    {
+        return partMask & (1u << static_cast<uint32_t>(part));
+    }
+
+    PipelineKey getPartKey(PipelineLibraryPart part) const
+    {
+        return parts[static_cast<uint32_t>(part)];
+    }
+};
+
+PipelineLibraryKeys getPipelineLibraryKeys(const GraphicsPipelineStateInitializer& initializer);
+// pipelines discarding their primitives have no fragment parts, they are created whole
+bool                canUsePipelineLibraries(const GraphicsPipelineStateInitializer& initializer);
+VkShaderStageFlags  getPipelineLibraryStages(PipelineLibraryPart part);
+
+// the create infos of one initializer, its parts and the pipelines linked from them are created from the same state.
+// Points into itself, so it is built where it is used
+class PipelineLibraryState
+{
+public:
+    explicit PipelineLibraryState(const GraphicsPipelineStateInitializer& initializer);
+    PipelineLibraryState(const PipelineLibraryState&)            = delete;
+    PipelineLibraryState& operator=(const PipelineLibraryState&) = delete;
+
+    // stages are the shaders of the part, the interface parts have none
+    VkResult createPart(VkPipelineCache cache, PipelineLibraryPart part, const std::vector<VkPipelineShaderStageCreateInfo>& stages,
+                        VkPipeline* library) const;
+    // a fast link only combines the parts, an optimized one compiles them again as a whole
+    VkResult link(VkPipelineCache cache, const std::vector<VkPipeline>& libraries, bool optimized, VkPipeline* pipeline) const;
+
+private:
+    VkPipelineLayout                                 _layout = VK_NULL_HANDLE;
+    VkPipelineCreateFlags2                           _flags2 = 0;
+    std::vector<VkFormat>                            _colorFormats;
+    std::vector<VkDynamicState>                      _dynamicStates;
+    std::vector<VkPipelineColorBlendAttachmentState> _blendAttachments;
+    VkPipelineRenderingCreateInfo                    _renderingInfo{VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO};
+    VkPipelineVertexInputStateCreateInfo             _vertexInputState{VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+    VkPipelineInputAssemblyStateCreateInfo           _inputAssemblyState{VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
+    VkPipelineViewportStateCreateInfo                _viewportState{VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO};
+    VkPipelineRasterizationStateCreateInfo           _rasterizationState{VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO};
+    VkPipelineMultisampleStateCreateInfo             _multisampleState{VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO};
+    VkPipelineDepthStencilStateCreateInfo            _depthStencilState{VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO};
+    VkPipelineColorBlendStateCreateInfo              _colorBlendState{VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO};
+    VkPipelineDynamicStateCreateInfo                 _dynamicState{VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO};
+};
+
+} // namespace Play
+
+#endif // PIPELINE_LIBRARY_H
@@ -0,0 +1,315 @@
+#include "PipelinePrecompiler.h"
+#include "core/runtime/VulkanRuntime.h"
+#include <algorithm>
+namespace Play
+{
+namespace
+{
+template <typename T>
+void writeVector(BufferStream& stream, const std::vector<T>& values)
+{
+    stream.write(static_cast<uint32_t>(values.size()));
+    stream.write(values);
+}
+
+template <typename T>
+bool readVector(BufferStream& stream, std::vector<T>& values)
+{
+    uint32_t count = 0;
+    return stream.read(count) && stream.read(values, count);
+}
+
+void writeString(BufferStream& stream, const std::string& value)
+{
+    stream.write(static_cast<uint32_t>(value.size()));
+    stream.write(value.data(), value.size());
+}
+
+bool readString(BufferStream& stream, std::string& value)
+{
+    uint32_t length = 0;
+    if (!stream.read(length)) return false;
+    value.resize(length);
+    return stream.read(value.data(), length);
+}
+
+std::string getShaderName(ShaderID shaderID)
+{
+    if (shaderID == ~0U) return {};
+    const ShaderModule* shaderModule = ShaderManager::Instance().getShaderById(shaderID);
+    return shaderModule ? shaderModule->_name : std::string();
+}
+} // namespace
+
+bool PipelineRecord::fromInitializer(const GraphicsPipelineStateInitializer& initializer)
+{
+    const GraphicsShaderSet& shaderSet = initializer.shaderSet;
+    type                               = PipelineRecordType::eGraphics;
+    shaderNames = {getShaderName(shaderSet.vertexModuleID), getShaderName(shaderSet.fragModuleID), getShaderName(shaderSet.taskModuleID),
+                   getShaderName(shaderSet.meshModuleID)};
+    const std::array<ShaderID, 4> shaderIDs = {shaderSet.vertexModuleID, shaderSet.fragModuleID, shaderSet.taskModuleID, shaderSet.meshModuleID};
+    for (size_t i = 0; i < shaderIDs.size(); ++i)
+    {
+        if (shaderIDs[i] != ~0U && shaderNames[i].empty()) return false;
+    }
+    psoState          = initializer.psoState;
+    renderTargetState = initializer.renderTargetState;
+    return initializer.pipelineLayout && setLayoutFrom(*initializer.pipelineLayout);
+}
+
+bool PipelineRecord::fromInitializer(const ComputePipelineStateInitializer& initializer)
+{
+    type        = PipelineRecordType::eCompute;
+    shaderNames = {getShaderName(initializer.computeModuleID), {}, {}, {}};
+    return !shaderNames[0].empty() && initializer.pipelineLayout && setLayoutFrom(*initializer.pipelineLayout);
+}
+
+bool PipelineRecord::setLayoutFrom(const PipelineLayout& layout)
+{
+    DescriptorSetCache* descriptorCache = vkDriver->getDescriptorSetCache();
+    for (uint32_t slot = 0; slot < layout.setCount; ++slot)
+    {
+        PipelineSetLayoutRecord& setLayout = setLayouts[slot];
+        setLayout.used                     = layout.setLayouts[slot] != VK_NULL_HANDLE;
+        if (!setLayout.used) continue;
+        const SetLayoutContent* content = descriptorCache->getSetLayoutContent(layout.setLayouts[slot]);
+        if (!content) return false;
+        setLayout.flags    = content->flags;
+        setLayout.bindings = content->bindings;
+    }
+    pushConstantRange    = layout.pushConstantRange;
+    hasPushConstantRange = layout.hasPushConstant;
+    descriptorBuffer     = layout.descriptorBuffer;
+    return true;
+}
+
+void PipelineRecord::write(BufferStream& stream) const
+{
+    stream.write(type);
+    for (const std::string& shaderName : shaderNames)
+    {
+        writeString(stream, shaderName);
+    }
+
+    // exactly the fields PSOState::getPipelineKey hashes
+    stream.write(psoState.rasterizationState.depthClampEnable);
+    stream.write(psoState.rasterizationState.rasterizerDiscardEnable);
+    stream.write(psoState.rasterizationState.polygonMode);
+    stream.write(psoState.rasterizationState.cullMode);
+    stream.write(psoState.rasterizationState.frontFace);
+    stream.write(psoState.rasterizationState.depthBiasEnable);
+    stream.write(psoState.rasterizationState.lineWidth);
+    stream.write(psoState.multisampleState.rasterizationSamples);
+    stream.write(psoState.multisampleState.sampleShadingEnable);
+    stream.write(psoState.multisampleState.minSampleShading);
+    stream.write(psoState.multisampleState.alphaToCoverageEnable);
+    stream.write(psoState.multisampleState.alphaToOneEnable);
+    stream.write(psoState.depthStencilState.depthTestEnable);
+    stream.write(psoState.depthStencilState.depthWriteEnable);
+    stream.write(psoState.depthStencilState.depthCompareOp);
+    stream.write(psoState.depthStencilState.depthBoundsTestEnable);
+    stream.write(psoState.depthStencilState.stencilTestEnable);
+    stream.write(psoState.depthStencilState.front);
+    stream.write(psoState.depthStencilState.back);
+    stream.write(psoState.colorBlendState.logicOpEnable);
+    stream.write(psoState.colorBlendState.logicOp);
+    writeVector(stream, psoState.colorBlendEnables);
+    writeVector(stream, psoState.colorWriteMasks);
+    writeVector(stream, psoState.colorBlendEquations);
+    stream.write(psoState.inputAssemblyState.topology);
+    stream.write(psoState.inputAssemblyState.primitiveRestartEnable);
+    writeVector(stream, psoState.dynamicStates);
+    stream.write(psoState.flags2);
+
+    writeVector(stream, renderTargetState.colorFormats);
+    stream.write(renderTargetState.depthAttachmentFormat);
+    stream.write(renderTargetState.stencilAttachmentFormat);
+    stream.write(renderTargetState.sampleCount);
+    stream.write(renderTargetState.shadingRateAttachment);
+
+    for (const PipelineSetLayoutRecord& setLayout : setLayouts)
+    {
+        stream.write(setLayout.used);
+        if (!setLayout.used) continue;
+        stream.write(setLayout.flags);
+        stream.write(static_cast<uint32_t>(setLayout.bindings.size()));
+        for (const VkDescriptorSetLayoutBinding& binding : setLayout.bindings)
+        {
+            stream.write(binding.binding);
+            stream.write(binding.descriptorType);
+            stream.write(binding.descriptorCount);
+            stream.write(binding.stageFlags);
+        }
+    }
+    stream.write(pushConstantRange);
+    stream.write(hasPushConstantRange);
+    stream.write(descriptorBuffer);
+}
+
+bool PipelineRecord::read(BufferStream& stream)
+{
+    bool valid = stream.read(type);
+    for (std::string& shaderName : shaderNames)
+    {
+        valid = valid && readString(stream, shaderName);
+    }
+
+    valid = valid && stream.read(psoState.rasterizationState.depthClampEnable);
+    valid = valid && stream.read(psoState.rasterizationState.rasterizerDiscardEnable);
+    valid = valid && stream.read(psoState.rasterizationState.polygonMode);
+    valid = valid && stream.read(psoState.rasterizationState.cullMode);
+    valid = valid && stream.read(psoState.rasterizationState.frontFace);
+    valid = valid && stream.read(psoState.rasterizationState.depthBiasEnable);
+    valid = valid && stream.read(psoState.rasterizationState.lineWidth);
+    valid = valid && stream.read(psoState.multisampleState.rasterizationSamples);
+    valid = valid && stream.read(psoState.multisampleState.sampleShadingEnable);
+    valid = valid && stream.read(psoState.multisampleState.minSampleShading);
+    valid = valid && stream.read(psoState.multisampleState.alphaToCoverageEnable);
+    valid = valid && stream.read(psoState.multisampleState.alphaToOneEnable);
+    valid = valid && stream.read(psoState.depthStencilState.depthTestEnable);
+    valid = valid && stream.read(psoState.depthStencilState.depthWriteEnable);
+    valid = valid && stream.read(psoState.depthStencilState.depthCompareOp);
+    valid = valid && stream.read(psoState.depthStencilState.depthBoundsTestEnable);
+    valid = valid && stream.read(psoState.depthStencilState.stencilTestEnable);
+    valid = valid && stream.read(psoState.depthStencilState.front);
+    valid = valid && stream.read(psoState.depthStencilState.back);
+    valid = valid && stream.read(psoState.colorBlendState.logicOpEnable);
+    valid = valid && stream.read(psoState.colorBlendState.logicOp);
+    valid = valid && readVector(stream, psoState.colorBlendEnables);
+    valid = valid && readVector(stream, psoState.colorWriteMasks);
+    valid = valid && readVector(stream, psoState.colorBlendEquations);
+    valid = valid && stream.read(psoState.inputAssemblyState.topology);
+    valid = valid && stream.read(psoState.inputAssemblyState.primitiveRestartEnable);
+    valid = valid && readVector(stream, psoState.dynamicStates);
+    valid = valid && stream.read(psoState.flags2);
+    psoState.dirtyFlag = true;
+
+    valid = valid && readVector(stream, renderTargetState.colorFormats);
+    valid = valid && stream.read(renderTargetState.depthAttachmentFormat);
+    valid = valid && stream.read(renderTargetState.stencilAttachmentFormat);
+    valid = valid && stream.read(renderTargetState.sampleCount);
+    valid = valid && stream.read(renderTargetState.shadingRateAttachment);
+
+    for (PipelineSetLayoutRecord& setLayout : setLayouts)
+    {
+        valid = valid && stream.read(setLayout.used);
+        if (!valid || !setLayout.used) continue;
+        uint32_t bindingCount = 0;
+        valid                 = stream.read(setLayout.flags) && stream.read(bindingCount);
+        setLayout.bindings.assign(valid ? bindingCount : 0, VkDescriptorSetLayoutBinding{});
+        for (VkDescriptorSetLayoutBinding& binding : setLayout.bindings)
+        {
+            valid = valid && stream.read(binding.binding) && stream.read(binding.descriptorType) && stream.read(binding.descriptorCount) &&
+                    stream.read(binding.stageFlags);
+        }
+    }
+    valid = valid && stream.read(pushConstantRange);
+    valid = valid && stream.read(hasPushConstantRange);
+    valid = valid && stream.read(descriptorBuffer);
+    return valid && (type == PipelineRecordType::eGraphics || type == PipelineRecordType::eCompute);
+}
+
+PipelineCompileQueue::PipelineCompileQueue(uint32_t threadCount)
+{
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        _workers.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+PipelineCompileQueue::~PipelineCompileQueue()
+{
+    stop();
+}
+
+void PipelineCompileQueue::stop()
+{
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        _stopping = true;
+        for (const auto& [key, compile] : _jobs)
+        {
+            _pending.erase(key);
+        }
+        _jobs.clear();
+    }
+    _jobQueued.notify_all();
+    for (std::thread& worker : _workers)
+    {
+        worker.join();
+    }
+    _workers.clear();
+    _jobFinished.notify_all();
+}
+
+void PipelineCompileQueue::submit(PipelineKey key, CompileFunc&& compile)
+{
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        if (_stopping || !_pending.insert(key).second) return;
+        _jobs.emplace_back(key, std::move(compile));
+    }
+    _jobQueued.notify_one();
+}
+
+bool PipelineCompileQueue::isPending(PipelineKey key) const
+{
+    std::unique_lock<std::mutex> lock(_lock);
+    return _pending.contains(key);
+}
+
+bool PipelineCompileQueue::isIdle() const
+{
+    std::unique_lock<std::mutex> lock(_lock);
+    return _pending.empty();
+}
+
+void PipelineCompileQueue::wait(PipelineKey key)
+{
+    std::unique_lock<std::mutex> lock(_lock);
+    auto queued = std::find_if(_jobs.begin(), _jobs.end(), [key](const auto& job) { return job.first == key; });
+    if (queued != _jobs.end())
+    {
+        CompileFunc compile = std::move(queued->second);
+        _jobs.erase(queued);
+        lock.unlock();
+        finish(key, compile());
+        return;
+    }
+    _jobFinished.wait(lock, [this, key]() { return !_pending.contains(key); });
+}
+
+void PipelineCompileQueue::collect(std::vector<std::pair<PipelineKey, VkPipeline>>& finished)
+{
+    std::unique_lock<std::mutex> lock(_lock);
+    finished.insert(finished.end(), _finished.begin(), _finished.end());
+    _finished.clear();
+}
+
+void PipelineCompileQueue::finish(PipelineKey key, VkPipeline pipeline)
+{
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        _finished.emplace_back(key, pipeline);
+        _pending.erase(key);
+    }
+    _jobFinished.notify_all();
+}
+
+void PipelineCompileQueue::workerLoop()
+{
+    while (true)
+    {
+        std::pair<PipelineKey, CompileFunc> job;
+        {
+            std::unique_lock<std::mutex> lock(_lock);
+            _jobQueued.wait(lock, [this]() { return _stopping || !_jobs.empty(); });
+            if (_jobs.empty()) return;
+            job = std::move(_jobs.front());
+            _jobs.pop_front();
+        }
+        finish(job.first, job.second());
+    }
+}
+
+} // namespace Play
@@ -0,0 +1,85 @@
+#ifndef PIPELINE_PRECOMPILER_H
+#define PIPELINE_PRECOMPILER_H
+#include "PipelineCacheManager.h"
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <unordered_set>
+namespace Play
+{
+const std::string PIPELINE_RECORDS_FILE_NAME = "pipelineRecords.bin";
+
+enum class PipelineRecordType : uint32_t
+{
+    eGraphics = 0,
+    eCompute
+};
+
+struct PipelineSetLayoutRecord
+{
+    bool                                      used  = false;
+    VkDescriptorSetLayoutCreateFlags          flags = 0;
+    std::vector<VkDescriptorSetLayoutBinding> bindings;
+};
+
+// everything a pipeline key is built from, in a form that holds across runs: shaders by name and set layouts by their
+// bindings. Precompiling resolves it against the current run and recomputes the key
+struct PipelineRecord
+{
+    PipelineRecordType         type = PipelineRecordType::eGraphics;
+    std::array<std::string, 4> shaderNames; // vertex, fragment, task, mesh. Compute records use the first
+    PSOState                   psoState;    // the hashed fields only, the rest keeps its defaults
+    RenderTargetState          renderTargetState;
+    std::array<PipelineSetLayoutRecord, static_cast<size_t>(DescriptorEnum::eCount)> setLayouts;
+    VkPushConstantRange pushConstantRange    = {};
+    bool                hasPushConstantRange = false;
+    bool                descriptorBuffer     = false;
+
+    // false if a shader or set layout of the initializer cannot be described
+    bool fromInitializer(const GraphicsPipelineStateInitializer& initializer);
+    bool fromInitializer(const ComputePipelineStateInitializer& initializer);
+
+    void write(BufferStream& stream) const;
+    bool read(BufferStream& stream);
+
+private:
+    bool setLayoutFrom(const PipelineLayout& layout);
+};
+
+// worker threads compiling pipelines against their cache blocks. Finished pipelines wait in the queue until the render
+// thread collects them
+class PipelineCompileQueue
+{
+public:
+    using CompileFunc = std::function<VkPipeline()>;
+
+    explicit PipelineCompileQueue(uint32_t threadCount);
+    ~PipelineCompileQueue();
+    // queued jobs are dropped, running ones finish
+    void stop();
+
+    void submit(PipelineKey key, CompileFunc&& compile);
+    // queued or compiling, finished pipelines are not
+    bool isPending(PipelineKey key) const;
+    bool isIdle() const;
+    // a job still queued runs on the calling thread instead of waiting for its turn
+    void wait(PipelineKey key);
+    void collect(std::vector<std::pair<PipelineKey, VkPipeline>>& finished);
+
+private:
+    void workerLoop();
+    void finish(PipelineKey key, VkPipeline pipeline);
+
+    mutable std::mutex                              _lock;
+    std::condition_variable                         _jobQueued;
+    std::condition_variable                         _jobFinished;
+    std::deque<std::pair<PipelineKey, CompileFunc>> _jobs;
+    std::unordered_set<PipelineKey>                 _pending;
+    std::vector<std::pair<PipelineKey, VkPipeline>> _finished;
+    std::vector<std::thread>                        _workers;
+    bool                                            _stopping = false;
+};
+
+} // namespace Play
+
+#endif // PIPELINE_PRECOMPILER_H
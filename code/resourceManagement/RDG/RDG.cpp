@@ -161,6 +161,68 @@ PassNode* BlackBoard::getPass(std::string name)
     return _passMap[name];
 }
 
+PipelineLayout* RenderContext::resolvePipelineLayout(const PendingState& pendingState, DescriptorSetBindings* materialDescriptorSet,
+                                                     const VkPushConstantRange* pushConstantRange)
+{
+    DescriptorSetCache* descriptorCache  = vkDriver->getDescriptorSetCache();
+    const bool          descriptorBuffer = descriptorCache->useDescriptorBuffer();
+    CommonDescriptorSet globalSet        = descriptorCache->getEngineDescriptorSet();
+    CommonDescriptorSet sceneSet         = descriptorCache->getSceneDescriptorSet();
+    CommonDescriptorSet frameSet         = descriptorCache->getFrameDescriptorSet();
+
+    PipelineLayoutDesc layoutDesc;
+    layoutDesc.setDescriptorBuffer(descriptorBuffer);
+    layoutDesc.setDescriptorSetLayout(DescriptorEnum::eGlobalDescriptorSet, descriptorBuffer ? globalSet.bufferLayout : globalSet.layout);
+    layoutDesc.setDescriptorSetLayout(DescriptorEnum::eSceneDescriptorSet, descriptorBuffer ? sceneSet.bufferLayout : sceneSet.layout);
+    layoutDesc.setDescriptorSetLayout(DescriptorEnum::eFrameDescriptorSet, descriptorBuffer ? frameSet.bufferLayout : frameSet.layout);
+    if (pendingState._passDescriptorSetLayout != VK_NULL_HANDLE)
+    {
+        layoutDesc.setDescriptorSetLayout(DescriptorEnum::ePerPassDescriptorSet, pendingState._passDescriptorSetLayout);
+    }
+    if (materialDescriptorSet)
+    {
+        layoutDesc.setMaterialDescriptorSet(*materialDescriptorSet);
+    }
+    if (pushConstantRange)
+    {
+        layoutDesc.setPushConstantRange(*pushConstantRange);
+    }
+    return vkDriver->getPipelineCacheManager()->getOrCreatePipelineLayout(layoutDesc);
+}
+
+void RenderContext::resolveRenderTargetState(const PendingGfxState& pendingState, GraphicsPipelineStateInitializer& initializer)
+{
+    auto* dynamicRenderPass = dynamic_cast<DynamicRenderPass*>(pendingState._renderPass);
+    if (dynamicRenderPass)
+    {
+        initializer.renderTargetState.colorFormats            = dynamicRenderPass->getColorAttachmentFormats();
+        initializer.renderTargetState.depthAttachmentFormat   = dynamicRenderPass->getDepthAttachmentFormat();
+        initializer.renderTargetState.stencilAttachmentFormat = dynamicRenderPass->getStencilAttachmentFormat();
+        initializer.renderTargetState.shadingRateAttachment   = dynamicRenderPass->hasShadingRateAttachment();
+    }
+}
+
+bool RenderContext::isPipelineReady(GraphicsPipelineStateInitializer& initializer)
+{
+    if (!_pendingGfxState || !_pendingGfxState->_renderPass) return false;
+    resolveRenderTargetState(*_pendingGfxState, initializer);
+    initializer.pipelineLayout = resolvePipelineLayout(*_pendingGfxState, initializer.materialDescriptorSet,
+                                                       initializer.hasPushConstantRange ? &initializer.pushConstantRange : nullptr);
+    PipelineCacheManager* pipelineCache = vkDriver->getPipelineCacheManager();
+    const PipelineKey     key           = initializer.getPipelineKey();
+    // neither created nor queued, bindPipeline creates it right away
+    return pipelineCache->isPipelineReady(key) || !pipelineCache->isPipelineCompiling(key);
+}
+
+bool RenderContext::isPipelineReady(ComputePipelineStateInitializer& initializer)
+{
+    initializer.pipelineLayout = resolvePipelineLayout(*_pendingComputeState, initializer.materialDescriptorSet,
+                                                       initializer.hasPushConstantRange ? &initializer.pushConstantRange : nullptr);
+    PipelineCacheManager* pipelineCache = vkDriver->getPipelineCacheManager();
+    const PipelineKey     key           = initializer.getPipelineKey();
+    return pipelineCache->isPipelineReady(key) || !pipelineCache->isPipelineCompiling(key);
+}
+
 void RenderContext::bindPipeline(GraphicsPipelineStateInitializer& initializer)
 {
     if (!_pendingGfxState || !_pendingGfxState->_renderPass)
@@ -169,46 +231,29 @@ void RenderContext::bindPipeline(GraphicsPipelineStateInitializer& initializer)
         return;
     }
 
-    DescriptorSetCache* descriptorCache = vkDriver->getDescriptorSetCache();
-    CommonDescriptorSet globalSet       = descriptorCache->getEngineDescriptorSet();
-    CommonDescriptorSet sceneSet        = descriptorCache->getSceneDescriptorSet();
-    CommonDescriptorSet frameSet        = descriptorCache->getFrameDescriptorSet();
+    DescriptorSetCache* descriptorCache  = vkDriver->getDescriptorSetCache();
+    const bool          descriptorBuffer = descriptorCache->useDescriptorBuffer();
+    CommonDescriptorSet globalSet        = descriptorCache->getEngineDescriptorSet();
+    CommonDescriptorSet sceneSet         = descriptorCache->getSceneDescriptorSet();
+    CommonDescriptorSet frameSet         = descriptorCache->getFrameDescriptorSet();
 
     VkDescriptorSet passSet = _pendingGfxState->_passDescriptorSet;
 
-    VkDescriptorSet materialSet = VK_NULL_HANDLE;
-    if (initializer.materialDescriptorSet)
-    {
-        materialSet = initializer.materialDescriptorSet->getOrAcquireDescriptorSet(DescriptorEnum::eDrawObjectDescriptorSet);
-    }
-
-    PipelineLayoutDesc layoutDesc;
-    layoutDesc.setDescriptorSetLayout(DescriptorEnum::eGlobalDescriptorSet, globalSet.layout);
-    layoutDesc.setDescriptorSetLayout(DescriptorEnum::eSceneDescriptorSet, sceneSet.layout);
-    layoutDesc.setDescriptorSetLayout(DescriptorEnum::eFrameDescriptorSet, frameSet.layout);
-    if (_pendingGfxState->_passDescriptorSetLayout != VK_NULL_HANDLE)
-    {
-        layoutDesc.setDescriptorSetLayout(DescriptorEnum::ePerPassDescriptorSet, _pendingGfxState->_passDescriptorSetLayout);
-    }
-    if (initializer.materialDescriptorSet)
-    {
-        layoutDesc.setMaterialDescriptorSet(*initializer.materialDescriptorSet);
-    }
-    if (initializer.hasPushConstantRange)
+    VkDescriptorSet             materialSet = VK_NULL_HANDLE;
+    std::optional<VkDeviceSize> materialOffset;
+    if (initializer.materialDescriptorSet && descriptorBuffer)
     {
-        layoutDesc.setPushConstantRange(initializer.pushConstantRange);
+        materialOffset = initializer.materialDescriptorSet->acquireDescriptorBufferOffset();
     }
-
-    auto* dynamicRenderPass = dynamic_cast<DynamicRenderPass*>(_pendingGfxState->_renderPass);
-    if (dynamicRenderPass)
+    else if (initializer.materialDescriptorSet)
     {
-        initializer.renderTargetState.colorFormats             = dynamicRenderPass->getColorAttachmentFormats();
-        initializer.renderTargetState.depthAttachmentFormat    = dynamicRenderPass->getDepthAttachmentFormat();
-        initializer.renderTargetState.stencilAttachmentFormat  = dynamicRenderPass->getStencilAttachmentFormat();
+        materialSet = initializer.materialDescriptorSet->getOrAcquireDescriptorSet(DescriptorEnum::eDrawObjectDescriptorSet);
     }
 
-    initializer.pipelineLayout = vkDriver->getPipelineCacheManager()->getOrCreatePipelineLayout(layoutDesc);
-    VkPipeline pipeline       = vkDriver->getPipelineCacheManager()->getOrCreateGraphicsPipeline(initializer);
+    resolveRenderTargetState(*_pendingGfxState, initializer);
+    initializer.pipelineLayout = resolvePipelineLayout(*_pendingGfxState, initializer.materialDescriptorSet,
+                                                       initializer.hasPushConstantRange ? &initializer.pushConstantRange : nullptr);
+    VkPipeline pipeline        = vkDriver->getPipelineCacheManager()->getOrCreateGraphicsPipeline(initializer);
     if (pipeline == VK_NULL_HANDLE)
     {
         LOGE("Graphics pipeline creation failed");
@@ -216,8 +261,21 @@ void RenderContext::bindPipeline(GraphicsPipelineStateInitializer& initializer)
     }
 
     vkCmdBindPipeline(_currCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    if (initializer.renderTargetState.shadingRateAttachment)
+    {
+        // the pipeline rate stays at 1x1, the shading rate attachment replaces it
+        const VkExtent2D                         fragmentSize   = {1, 1};
+        const VkFragmentShadingRateCombinerOpKHR combinerOps[2] = {VK_FRAGMENT_SHADING_RATE_COMBINER_OP_KEEP_KHR,
+                                                                   VK_FRAGMENT_SHADING_RATE_COMBINER_OP_REPLACE_KHR};
+        vkCmdSetFragmentShadingRateKHR(_currCmdBuffer, &fragmentSize, combinerOps);
+    }
     _boundPipelineLayout    = initializer.pipelineLayout;
     _boundPipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    if (descriptorBuffer)
+    {
+        bindDescriptorBufferSets(VK_PIPELINE_BIND_POINT_GRAPHICS, *_pendingGfxState, materialOffset);
+        return;
+    }
 
     std::array<VkDescriptorSet, 3> persistentSets = {globalSet.set, sceneSet.set, frameSet.set};
     vkCmdBindDescriptorSets(_currCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, initializer.pipelineLayout->vkHandle,
@@ -238,38 +296,28 @@ void RenderContext::bindPipeline(GraphicsPipelineStateInitializer& initializer)
 
 void RenderContext::bindPipeline(ComputePipelineStateInitializer& initializer)
 {
-    DescriptorSetCache* descriptorCache = vkDriver->getDescriptorSetCache();
-    CommonDescriptorSet globalSet       = descriptorCache->getEngineDescriptorSet();
-    CommonDescriptorSet sceneSet        = descriptorCache->getSceneDescriptorSet();
-    CommonDescriptorSet frameSet        = descriptorCache->getFrameDescriptorSet();
+    DescriptorSetCache* descriptorCache  = vkDriver->getDescriptorSetCache();
+    const bool          descriptorBuffer = descriptorCache->useDescriptorBuffer();
+    CommonDescriptorSet globalSet        = descriptorCache->getEngineDescriptorSet();
+    CommonDescriptorSet sceneSet         = descriptorCache->getSceneDescriptorSet();
+    CommonDescriptorSet frameSet         = descriptorCache->getFrameDescriptorSet();
 
     VkDescriptorSet passSet = _pendingComputeState->_passDescriptorSet;
 
-    VkDescriptorSet materialSet = VK_NULL_HANDLE;
-    if (initializer.materialDescriptorSet)
-    {
-        materialSet = initializer.materialDescriptorSet->getOrAcquireDescriptorSet(DescriptorEnum::eDrawObjectDescriptorSet);
-    }
-
-    PipelineLayoutDesc layoutDesc;
-    layoutDesc.setDescriptorSetLayout(DescriptorEnum::eGlobalDescriptorSet, globalSet.layout);
-    layoutDesc.setDescriptorSetLayout(DescriptorEnum::eSceneDescriptorSet, sceneSet.layout);
-    layoutDesc.setDescriptorSetLayout(DescriptorEnum::eFrameDescriptorSet, frameSet.layout);
-    if (_pendingComputeState->_passDescriptorSetLayout != VK_NULL_HANDLE)
-    {
-        layoutDesc.setDescriptorSetLayout(DescriptorEnum::ePerPassDescriptorSet, _pendingComputeState->_passDescriptorSetLayout);
-    }
-    if (initializer.materialDescriptorSet)
+    VkDescriptorSet             materialSet = VK_NULL_HANDLE;
+    std::optional<VkDeviceSize> materialOffset;
+    if (initializer.materialDescriptorSet && descriptorBuffer)
     {
-        layoutDesc.setMaterialDescriptorSet(*initializer.materialDescriptorSet);
+        materialOffset = initializer.materialDescriptorSet->acquireDescriptorBufferOffset();
     }
-    if (initializer.hasPushConstantRange)
+    else if (initializer.materialDescriptorSet)
     {
-        layoutDesc.setPushConstantRange(initializer.pushConstantRange);
+        materialSet = initializer.materialDescriptorSet->getOrAcquireDescriptorSet(DescriptorEnum::eDrawObjectDescriptorSet);
     }
 
-    initializer.pipelineLayout = vkDriver->getPipelineCacheManager()->getOrCreatePipelineLayout(layoutDesc);
-    VkPipeline pipeline       = vkDriver->getPipelineCacheManager()->getOrCreateComputePipeline(initializer);
+    initializer.pipelineLayout = resolvePipelineLayout(*_pendingComputeState, initializer.materialDescriptorSet,
+                                                       initializer.hasPushConstantRange ? &initializer.pushConstantRange : nullptr);
+    VkPipeline pipeline        = vkDriver->getPipelineCacheManager()->getOrCreateComputePipeline(initializer);
     if (pipeline == VK_NULL_HANDLE)
     {
         LOGE("Compute pipeline creation failed");
@@ -279,6 +327,11 @@ void RenderContext::bindPipeline(ComputePipelineStateInitializer& initializer)
     vkCmdBindPipeline(_currCmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
     _boundPipelineLayout    = initializer.pipelineLayout;
     _boundPipelineBindPoint = VK_PIPELINE_BIND_POINT_COMPUTE;
+    if (descriptorBuffer)
+    {
+        bindDescriptorBufferSets(VK_PIPELINE_BIND_POINT_COMPUTE, *_pendingComputeState, materialOffset);
+        return;
+    }
 
     std::array<VkDescriptorSet, 3> persistentSets = {globalSet.set, sceneSet.set, frameSet.set};
     vkCmdBindDescriptorSets(_currCmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, initializer.pipelineLayout->vkHandle,
@@ -296,13 +349,50 @@ void RenderContext::bindPipeline(ComputePipelineStateInitializer& initializer)
                                 static_cast<uint32_t>(DescriptorEnum::eDrawObjectDescriptorSet), 1, &materialSet, 0, nullptr);
     }
 }
+void RenderContext::bindDescriptorBufferSets(VkPipelineBindPoint bindPoint, const PendingState& pendingState,
+                                             std::optional<VkDeviceSize> materialOffset)
+{
+    DescriptorSetCache*         descriptorCache  = vkDriver->getDescriptorSetCache();
+    DescriptorBufferManagerExt& descriptorBuffer = descriptorCache->getDescriptorBuffer();
+    // binding the buffer itself may stall, the sets only move offsets
+    if (_descriptorBufferCmd != _currCmdBuffer || _descriptorBufferFrame != descriptorCache->getCurrentFrame())
+    {
+        descriptorBuffer.bindBuffer(_currCmdBuffer);
+        _descriptorBufferCmd   = _currCmdBuffer;
+        _descriptorBufferFrame = descriptorCache->getCurrentFrame();
+    }
+
+    const VkPipelineLayout            layout            = _boundPipelineLayout->vkHandle;
+    const std::array<VkDeviceSize, 3> persistentOffsets = {descriptorCache->getEngineDescriptorSet().bufferOffset,
+                                                           descriptorCache->getSceneDescriptorSet().bufferOffset,
+                                                           descriptorCache->getFrameDescriptorSet().bufferOffset};
+    descriptorBuffer.bindSets(_currCmdBuffer, bindPoint, layout, static_cast<uint32_t>(DescriptorEnum::eGlobalDescriptorSet),
+                              static_cast<uint32_t>(persistentOffsets.size()), persistentOffsets.data());
+    if (pendingState._passDescriptorBufferOffset)
+    {
+        descriptorBuffer.bindSets(_currCmdBuffer, bindPoint, layout, static_cast<uint32_t>(DescriptorEnum::ePerPassDescriptorSet), 1,
+                                  &*pendingState._passDescriptorBufferOffset);
+    }
+    if (materialOffset)
+    {
+        descriptorBuffer.bindSets(_currCmdBuffer, bindPoint, layout, static_cast<uint32_t>(DescriptorEnum::eDrawObjectDescriptorSet), 1,
+                                  &*materialOffset);
+    }
+}
+
 RDGBuilder::RDGBuilder()
 {
     _dag           = std::make_unique<Dag>();
     _renderContext = std::make_shared<RenderContext>();
 }
 
-RDGBuilder::~RDGBuilder() {}
+RDGBuilder::~RDGBuilder()
+{
+    if (_statisticsPool != VK_NULL_HANDLE)
+    {
+        vkDestroyQueryPool(vkDriver->getDevice(), _statisticsPool, nullptr);
+    }
+}
 
 RenderPassBuilder RDGBuilder::createRenderPass(std::string name)
 {
@@ -328,7 +418,78 @@ RTPassBuilder RDGBuilder::createRTPass(std::string name)
     return RTPassBuilder(this, nodeRef);
 }
 
-void RDGBuilder::beforePassExecute() {}
+void RDGBuilder::beforePassExecute()
+{
+    readStatisticsQueries();
+}
+
+void RDGBuilder::createStatisticsQueries()
+{
+    _statisticsQueryCount = 0;
+    for (auto& passNode : _passes)
+    {
+        if (passNode->isCull() || passNode->type() != PassNode::Type::Render) continue;
+        auto* renderPassNode = static_cast<RenderPassNode*>(passNode);
+        if (renderPassNode->_queryStatistics)
+        {
+            renderPassNode->_statisticsQueryIndex = _statisticsQueryCount++;
+        }
+    }
+    if (_statisticsQueryCount == 0) return;
+
+    // the context enables every core feature the device supports, see main.cpp
+    VkPhysicalDeviceFeatures features{};
+    vkGetPhysicalDeviceFeatures(vkDriver->getPhysicalDevice(), &features);
+    if (!features.pipelineStatisticsQuery)
+    {
+        LOGW("Pipeline statistics queries are not supported, pass fragment invocations are not reported\n");
+        return;
+    }
+
+    VkQueryPoolCreateInfo queryInfo = {VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+    queryInfo.queryType             = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    queryInfo.queryCount            = vkDriver->getFrameCycleSize() * _statisticsQueryCount;
+    queryInfo.pipelineStatistics    = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+    if (vkCreateQueryPool(vkDriver->getDevice(), &queryInfo, nullptr, &_statisticsPool) != VK_SUCCESS)
+    {
+        LOGW("Failed to create the render graph statistics pool, pass fragment invocations are not reported\n");
+        _statisticsPool = VK_NULL_HANDLE;
+        return;
+    }
+    _statisticsRecorded.assign(queryInfo.queryCount, false);
+}
+
+void RDGBuilder::readStatisticsQueries()
+{
+    if (_statisticsPool == VK_NULL_HANDLE) return;
+    // the frame slot was fenced in prepareFrame, so the queries it recorded last time are complete
+    for (auto& passNode : _passes)
+    {
+        const uint32_t query = getStatisticsQuery(passNode);
+        if (query == ~0U || !_statisticsRecorded[query]) continue;
+        uint64_t invocations = 0;
+        VkResult result      = vkGetQueryPoolResults(vkDriver->getDevice(), _statisticsPool, query, 1, sizeof(invocations), &invocations,
+                                                     sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        if (result == VK_SUCCESS)
+        {
+            _fragmentInvocations[passNode->name()] = invocations;
+        }
+    }
+}
+
+uint32_t RDGBuilder::getStatisticsQuery(PassNode* pass) const
+{
+    if (_statisticsPool == VK_NULL_HANDLE || pass->isCull() || pass->type() != PassNode::Type::Render) return ~0U;
+    const uint32_t queryIndex = static_cast<RenderPassNode*>(pass)->_statisticsQueryIndex;
+    return queryIndex == ~0U ? ~0U : vkDriver->getFrameCycleIndex() * _statisticsQueryCount + queryIndex;
+}
+
+std::optional<uint64_t> RDGBuilder::getFragmentInvocations(const std::string& passName) const
+{
+    auto it = _fragmentInvocations.find(passName);
+    if (it == _fragmentInvocations.end()) return std::nullopt;
+    return it->second;
+}
 
 void RDGBuilder::prepareDescriptorSets(RenderContext& context, PassNode* pass)
 {
@@ -339,6 +500,16 @@ void RDGBuilder::prepareDescriptorSets(RenderContext& context, PassNode* pass)
         if (state.textureStates.front().isAttachment) continue;
         assert(state.texture->getRHI());
         TextureAccessInfo accessInfo = state.textureStates[0];
+        if (accessInfo.perMipDescriptors)
+        {
+            std::vector<VkDescriptorImageInfo> mipInfos;
+            for (VkImageView mipView : state.texture->getMipViews())
+            {
+                mipInfos.push_back({VK_NULL_HANDLE, mipView, accessInfo.layout});
+            }
+            programDescManager.setDescInfo(accessInfo.binding, mipInfos.data(), static_cast<uint32_t>(mipInfos.size()));
+            continue;
+        }
         if (accessInfo.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER && state.texture->_rhi->descriptor.sampler == VK_NULL_HANDLE)
         {
             PlayResourceManager::Instance().acquireSampler(state.texture->_rhi->descriptor.sampler);
@@ -354,27 +525,41 @@ void RDGBuilder::prepareDescriptorSets(RenderContext& context, PassNode* pass)
         programDescManager.setDescInfo(bufferInfo.binding, *state.buffer->_rhi);
     }
 
-    VkDescriptorSetLayout currPassSetLayout = programDescManager.finalizeLayout();
-    VkDescriptorSet       currPassSet       = programDescManager.getOrAcquireDescriptorSet(DescriptorEnum::ePerPassDescriptorSet);
+    VkDescriptorSetLayout       currPassSetLayout = programDescManager.finalizeLayout();
+    VkDescriptorSet             currPassSet       = VK_NULL_HANDLE;
+    std::optional<VkDeviceSize> currPassOffset;
+    if (vkDriver->getDescriptorSetCache()->useDescriptorBuffer())
+    {
+        // the pass descriptors go straight into the ring, no set is allocated or looked up
+        currPassSetLayout = programDescManager.getBufferSetLayout();
+        currPassOffset    = programDescManager.acquireDescriptorBufferOffset();
+    }
+    else
+    {
+        currPassSet = programDescManager.getOrAcquireDescriptorSet(DescriptorEnum::ePerPassDescriptorSet);
+    }
     switch (pass->type())
     {
         case PassNode::Type::Render:
         {
-            context._pendingGfxState->_passDescriptorSet       = currPassSet;
-            context._pendingGfxState->_passDescriptorSetLayout = currPassSetLayout;
+            context._pendingGfxState->_passDescriptorSet          = currPassSet;
+            context._pendingGfxState->_passDescriptorSetLayout    = currPassSetLayout;
+            context._pendingGfxState->_passDescriptorBufferOffset = currPassOffset;
             break;
         }
         case PassNode::Type::Compute:
         {
-            context._pendingComputeState->_passDescriptorSet       = currPassSet;
-            context._pendingComputeState->_passDescriptorSetLayout = currPassSetLayout;
+            context._pendingComputeState->_passDescriptorSet          = currPassSet;
+            context._pendingComputeState->_passDescriptorSetLayout    = currPassSetLayout;
+            context._pendingComputeState->_passDescriptorBufferOffset = currPassOffset;
             break;
         }
 
         case PassNode::Type::RayTracing:
         {
-            context._pendingRTState->_passDescriptorSet       = currPassSet;
-            context._pendingRTState->_passDescriptorSetLayout = currPassSetLayout;
+            context._pendingRTState->_passDescriptorSet          = currPassSet;
+            context._pendingRTState->_passDescriptorSetLayout    = currPassSetLayout;
+            context._pendingRTState->_passDescriptorBufferOffset = currPassOffset;
             break;
         }
         default:
@@ -437,8 +622,18 @@ void RDGBuilder::prepareRenderPass(PassNode* pass)
     RenderPassNode* renderPassNode = dynamic_cast<RenderPassNode*>(pass);
     renderPassNode->initRenderPass();
     _renderContext->_pendingGfxState->_renderPass = renderPassNode->_renderPass.get();
-    renderPassNode->_renderPass->begin(_renderContext->_currCmdBuffer,
-                                       {{0, 0}, {vkDriver->getViewportSize().width, vkDriver->getViewportSize().height}});
+
+    // the attachments decide the render area, scene passes may run below the viewport resolution
+    VkExtent2D renderArea = vkDriver->getViewportSize();
+    for (const RDGTextureState& state : renderPassNode->_textureStates)
+    {
+        if (state.textureStates[0].isAttachment && !state.textureStates[0].isShadingRateAttachment)
+        {
+            renderArea = {state.texture->_info._extent.width, state.texture->_info._extent.height};
+            break;
+        }
+    }
+    renderPassNode->_renderPass->begin(_renderContext->_currCmdBuffer, {{0, 0}, renderArea});
 }
 
 void RDGBuilder::endRenderPass(PassNode* pass)
@@ -648,7 +843,8 @@ void RDGBuilder::compile()
         {
             TextureAccessInfo& currAccessInfo = state.textureStates.front();
             if (currAccessInfo.isAttachment) continue;
-            passNode->_descBindings.addBinding(currAccessInfo.binding, 1, currAccessInfo.descriptorType,
+            const uint32_t descriptorCount = currAccessInfo.perMipDescriptors ? state.texture->_info._mipmapLevel : 1;
+            passNode->_descBindings.addBinding(currAccessInfo.binding, descriptorCount, currAccessInfo.descriptorType,
 
                                                inferShaderStageFromPipelineStage(currAccessInfo.stageMask));
         }
@@ -661,14 +857,21 @@ void RDGBuilder::compile()
 
         passNode->_descBindings.finalizeLayout();
     }
+    createStatisticsQueries();
 }
 
 void RDGBuilder::execute()
 {
     beforePassExecute();
+    _skippedPasses.clear();
     for (auto& pass : _passes)
     {
         if (pass->isCull() || !pass) continue;
+        if (pass->shouldSkip())
+        {
+            skipPass(pass);
+            continue;
+        }
         executePass(pass);
     }
     afterPassExecute();
@@ -680,6 +883,13 @@ void RDGBuilder::executePass(PassNode* pass)
     prepareResourceBarrier(*renderContext, pass);
     prepareDescriptorSets(*renderContext, pass);
 
+    // reset outside of the render pass instance, the query brackets all of it
+    const uint32_t statisticsQuery = getStatisticsQuery(pass);
+    if (statisticsQuery != ~0U)
+    {
+        vkCmdResetQueryPool(renderContext->_currCmdBuffer, _statisticsPool, statisticsQuery, 1);
+        vkCmdBeginQuery(renderContext->_currCmdBuffer, _statisticsPool, statisticsQuery, 0);
+    }
     if (pass->type() == PassNode::Type::Render)
     {
         prepareRenderPass(pass);
@@ -689,6 +899,20 @@ void RDGBuilder::executePass(PassNode* pass)
     {
         endRenderPass(pass);
     }
+    if (statisticsQuery != ~0U)
+    {
+        vkCmdEndQuery(renderContext->_currCmdBuffer, _statisticsPool, statisticsQuery);
+        _statisticsRecorded[statisticsQuery] = true;
+    }
+}
+
+// a skipped pass still issues its barriers, the frame-to-frame barriers of the other passes and the layouts tracked on
+// the images assume every pass ran, and transitions with a known old layout keep the content from the earlier frame
+void RDGBuilder::skipPass(PassNode* pass)
+{
+    auto renderContext = prepareRenderContext(pass);
+    prepareResourceBarrier(*renderContext, pass);
+    _skippedPasses.push_back(pass);
 }
 
 bool isAsyncCompute(PassNode* pass)
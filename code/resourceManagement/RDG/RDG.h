@@ -94,6 +94,8 @@ public:
     VkDescriptorSet       _sceneDescriptorSet      = VK_NULL_HANDLE;
     VkDescriptorSet       _passDescriptorSet       = VK_NULL_HANDLE;
     VkDescriptorSetLayout _passDescriptorSetLayout = VK_NULL_HANDLE;
+    // descriptor buffer backend, the pass set is written into the ring instead of _passDescriptorSet
+    std::optional<VkDeviceSize> _passDescriptorBufferOffset;
 };
 
 struct PendingGfxState : public PendingState
@@ -126,6 +128,14 @@ struct RenderContext
     ~RenderContext() {}
     void bindPipeline(GraphicsPipelineStateInitializer& initializer);
     void bindPipeline(ComputePipelineStateInitializer& initializer);
+    // false while the pipeline is still precompiling and bindPipeline would wait for it, passes may skip their draws instead
+    bool isPipelineReady(GraphicsPipelineStateInitializer& initializer);
+    bool isPipelineReady(ComputePipelineStateInitializer& initializer);
+    // the layout of the engine, scene, frame and pass sets plus the material set and push constants of the initializer
+    PipelineLayout* resolvePipelineLayout(const PendingState& pendingState, DescriptorSetBindings* materialDescriptorSet,
+                                          const VkPushConstantRange* pushConstantRange);
+    void            resolveRenderTargetState(const PendingGfxState& pendingState, GraphicsPipelineStateInitializer& initializer);
+    void bindDescriptorBufferSets(VkPipelineBindPoint bindPoint, const PendingState& pendingState, std::optional<VkDeviceSize> materialOffset);
 
     template <typename T>
     void bindPushConstant(const T& pushConstant)
@@ -151,6 +161,8 @@ struct RenderContext
     VkCommandBuffer                      _currCmdBuffer       = VK_NULL_HANDLE;
     PipelineLayout*                      _boundPipelineLayout = nullptr;
     VkPipelineBindPoint                  _boundPipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    VkCommandBuffer                      _descriptorBufferCmd    = VK_NULL_HANDLE; // the descriptor buffer is bound once per command buffer
+    uint64_t                             _descriptorBufferFrame  = ~0ULL;
     std::shared_ptr<PendingComputeState> _pendingComputeState = nullptr;
     std::shared_ptr<PendingGfxState>     _pendingGfxState     = nullptr;
     std::shared_ptr<PendingRTState>      _pendingRTState      = nullptr;
@@ -180,6 +192,14 @@ public:
     {
         return _dag.get();
     }
+    // passes whose skip condition held during the last execute, in execution order
+    const std::vector<PassNode*>& getSkippedPasses() const
+    {
+        return _skippedPasses;
+    }
+    // fragment shader invocations of a pass built with queryStatistics(), from the last completed frame that used the
+    // current frame slot. Empty before that frame completed or when the device has no pipeline statistics queries
+    std::optional<uint64_t> getFragmentInvocations(const std::string& passName) const;
 
 protected:
     friend class RDGTextureBuilder;
@@ -187,18 +207,23 @@ protected:
     // InputPassNodeRef createInputPass(std::string name);
     void           beforePassExecute();
     void           executePass(PassNode* pass);
+    void           skipPass(PassNode* pass);
     void           afterPassExecute();
     RenderContext* prepareRenderContext(PassNode* pass);
     void           prepareDescriptorSets(RenderContext& context, PassNode* pass);
     void           prepareResourceBarrier(RenderContext& context, PassNode* pass);
     void           prepareRenderPass(PassNode* pass);
     void           endRenderPass(PassNode* pass);
+    void           createStatisticsQueries();
+    void           readStatisticsQueries();
+    uint32_t       getStatisticsQuery(PassNode* pass) const;
     friend class RenderPassBuilder;
     friend class ComputePassBuilder;
     friend class RTPassBuilder;
     friend class PresentPassBuilder;
     std::unique_ptr<Dag>   _dag = nullptr;
     std::vector<PassNode*> _passes;
+    std::vector<PassNode*> _skippedPasses;
     BlackBoard             _blackBoard;
     // std::unordered_map<std::string, RDGTexture*> _textureMap;
     // std::unordered_map<std::string, RDGBuffer*>  _bufferMap;
@@ -206,6 +231,11 @@ protected:
 private:
     std::shared_ptr<RenderContext>                  _renderContext;
     std::vector<std::pair<VkSubmitInfo2, uint32_t>> _submitInfos; // pairs of submit info and queue index
+    // one pipeline statistics query per frame slot and queried render pass
+    VkQueryPool                               _statisticsPool       = VK_NULL_HANDLE;
+    uint32_t                                  _statisticsQueryCount = 0;
+    std::vector<bool>                         _statisticsRecorded;
+    std::unordered_map<std::string, uint64_t> _fragmentInvocations;
 };
 } // namespace Play::RDG
 
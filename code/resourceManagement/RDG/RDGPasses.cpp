@@ -55,7 +55,18 @@ void RenderPassNode::initRenderPass()
             imageBarrier.image                  = texture->getRHI()->image;
         }
 
-        if (accessInfo.attachSlotIdx == ATTACHMENT_DEPTH)
+        if (accessInfo.isShadingRateAttachment)
+        {
+            RenderPassAttachment shadingRateAttachment;
+            shadingRateAttachment.image         = texture->getRHI()->image;
+            shadingRateAttachment.imageView     = texture->getRHI()->descriptor.imageView;
+            shadingRateAttachment.format        = texture->getRHI()->format;
+            shadingRateAttachment.initialLayout = accessInfo.layout;
+            shadingRateAttachment.finalLayout   = accessInfo.attachFinalLayout;
+            config.shadingRateAttachment        = shadingRateAttachment;
+            config.shadingRateTexelSize         = _shadingRateTexelSize;
+        }
+        else if (accessInfo.attachSlotIdx == ATTACHMENT_DEPTH)
         {
             RenderPassAttachment depthStencilAttachment;
             depthStencilAttachment.image     = texture->getRHI()->image;
@@ -159,9 +170,39 @@ RenderPassBuilder& RenderPassBuilder::stencil(RDGTextureRef texHandle, VkAttachm
     return addTextureState(texHandle, std::move(subResources));
 }
 
+RenderPassBuilder& RenderPassBuilder::shadingRate(RDGTextureRef texHandle, VkExtent2D texelSize)
+{
+    if (!texHandle) return *this;
+    TextureSubresourceAccessInfo subResources;
+    TextureAccessInfo&           accessInfo = subResources.emplace_back();
+    accessInfo.isAttachment                 = true;
+    accessInfo.isShadingRateAttachment      = true;
+    accessInfo.accessMask                   = VK_ACCESS_2_FRAGMENT_SHADING_RATE_ATTACHMENT_READ_BIT_KHR;
+    accessInfo.loadOp                       = VK_ATTACHMENT_LOAD_OP_LOAD;
+    accessInfo.storeOp                      = VK_ATTACHMENT_STORE_OP_NONE;
+    accessInfo.layout                       = VK_IMAGE_LAYOUT_FRAGMENT_SHADING_RATE_ATTACHMENT_OPTIMAL_KHR;
+    accessInfo.attachFinalLayout            = VK_IMAGE_LAYOUT_FRAGMENT_SHADING_RATE_ATTACHMENT_OPTIMAL_KHR;
+    accessInfo.queueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    accessInfo.stageMask                    = VK_PIPELINE_STAGE_2_FRAGMENT_SHADING_RATE_ATTACHMENT_BIT_KHR;
+    _node->_shadingRateTexelSize            = texelSize;
+    return addTextureState(texHandle, std::move(subResources));
+}
+
+RenderPassBuilder& RenderPassBuilder::queryStatistics()
+{
+    _node->_queryStatistics = true;
+    return *this;
+}
+
 ComputePassBuilder& ComputePassBuilder::async(bool isAsync)
 {
     _node->setAsyncState(isAsync);
     return *this;
 }
+
+ComputePassBuilder& ComputePassBuilder::skipIf(std::function<bool()> condition)
+{
+    _node->setSkipCondition(std::move(condition));
+    return *this;
+}
 } // namespace Play::RDG
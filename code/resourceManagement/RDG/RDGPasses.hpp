@@ -72,6 +72,16 @@ public:
         if (_func) _func(this, context);
     }
 
+    void setSkipCondition(std::function<bool()> condition)
+    {
+        _skipCondition = std::move(condition);
+    }
+    // evaluated every frame right before the pass would be recorded
+    bool shouldSkip() const
+    {
+        return _skipCondition && _skipCondition();
+    }
+
     [[nodiscard]] const std::string& name() const
     {
         return _name;
@@ -115,6 +125,7 @@ public:
 protected:
     friend class RDGBuilder;
     std::function<void(PassNode* passNode, RenderContext& context)> _func;
+    std::function<bool()>                                           _skipCondition;
     std::string                                                     _name;
     DescriptorSetBindings                                           _descBindings;
     Type                                                            _type;
@@ -147,7 +158,10 @@ public:
     }
 
 private:
-    bool _needMultiThreadRecording = false;
+    bool       _needMultiThreadRecording = false;
+    VkExtent2D _shadingRateTexelSize     = {0, 0};
+    bool       _queryStatistics          = false;
+    uint32_t   _statisticsQueryIndex     = ~0U;
     friend class RenderPassBuilder;
     friend class RDGBuilder;
     std::unique_ptr<RenderPass> _renderPass = nullptr;
@@ -328,6 +342,25 @@ public:
         return addTextureState(texture, std::move(subResource));
     }
 
+    // binds every mip of the texture as one element of a storage image array, for passes that build a mip chain in
+    // a single dispatch. The mips may be read back through the same array
+    Derived& storageReadWriteMips(uint32_t binding, RDGTextureRef texture, VkPipelineStageFlagBits2 stage,
+                                  uint32_t queueFamilyIndex = VK_QUEUE_FAMILY_IGNORED)
+    {
+        TextureSubresourceAccessInfo subResource;
+        TextureAccessInfo&           accessInfo = subResource.emplace_back();
+        accessInfo.set                          = uint32_t(DescriptorEnum::ePerPassDescriptorSet);
+        accessInfo.binding                      = binding;
+        accessInfo.descriptorType               = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        accessInfo.isAttachment                 = false;
+        accessInfo.perMipDescriptors            = true;
+        accessInfo.accessMask                   = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+        accessInfo.layout                       = VK_IMAGE_LAYOUT_GENERAL;
+        accessInfo.stageMask                    = stage;
+        accessInfo.queueFamilyIndex             = queueFamilyIndex;
+        return addTextureState(texture, std::move(subResource));
+    }
+
     Derived& storageWrite(uint32_t binding, RDGBufferRef buffer, VkPipelineStageFlagBits2 stage, uint32_t queueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
                           uint32_t offset = 0, size_t size = VK_WHOLE_SIZE)
     {
@@ -418,6 +451,11 @@ public:
                                VkAttachmentStoreOp storeOp     = VK_ATTACHMENT_STORE_OP_STORE,
                                VkImageLayout       initLayout  = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
                                VkImageLayout       finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+    // every texel of the shading rate image covers texelSize pixels, a null texture leaves the pass at full rate
+    RenderPassBuilder& shadingRate(RDGTextureRef texHandle, VkExtent2D texelSize);
+    // counts the fragment shader invocations of the pass with a pipeline statistics query, see
+    // RDGBuilder::getFragmentInvocations
+    RenderPassBuilder& queryStatistics();
 };
 
 class ComputePassBuilder : public PassBuilderBase<ComputePassBuilder, ComputePassNodeRef, ComputePassBuilderTraits>
@@ -435,6 +473,9 @@ public:
     ~ComputePassBuilder() = default;
 
     ComputePassBuilder& async(bool isAsync = false);
+    // the pass keeps its barriers but records no descriptors or dispatch while condition returns true, for passes whose
+    // output is persistent and still valid from an earlier frame
+    ComputePassBuilder& skipIf(std::function<bool()> condition);
 };
 
 class RTPassBuilder : public PassBuilderBase<RTPassBuilder, RTPassNodeRef, RTPassBuilderTraits>
@@ -1,5 +1,8 @@
 #include "RDGResources.h"
 #include "Resource.h"
+#include "utils.hpp"
+#include "core/runtime/VulkanRuntime.h"
+#include <nvvk/check_error.hpp>
 
 namespace Play::RDG
 {
@@ -7,6 +10,41 @@ namespace Play::RDG
 RDGTexture::~RDGTexture()
 {
     // RefPtr 自动释放
+    destroyMipViews();
+}
+
+const std::vector<VkImageView>& RDGTexture::getMipViews()
+{
+    Texture* rhi = getRHI();
+    if (!rhi || rhi->image == _mipViewImage)
+    {
+        return _mipViews;
+    }
+
+    destroyMipViews();
+    _mipViewImage = rhi->image;
+    for (uint32_t mip = 0; mip < _info._mipmapLevel; ++mip)
+    {
+        VkImageViewCreateInfo viewInfo{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+        viewInfo.image            = rhi->image;
+        viewInfo.viewType         = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format           = _info._format;
+        viewInfo.subresourceRange = {inferImageAspectFlags(_info._format, true), mip, 1, 0, 1};
+        VkImageView view          = VK_NULL_HANDLE;
+        NVVK_CHECK(vkCreateImageView(vkDriver->getDevice(), &viewInfo, nullptr, &view));
+        _mipViews.push_back(view);
+    }
+    return _mipViews;
+}
+
+void RDGTexture::destroyMipViews()
+{
+    for (VkImageView view : _mipViews)
+    {
+        vkDestroyImageView(vkDriver->getDevice(), view, nullptr);
+    }
+    _mipViews.clear();
+    _mipViewImage = VK_NULL_HANDLE;
 }
 
 RDGBuffer::~RDGBuffer()
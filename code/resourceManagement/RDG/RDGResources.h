@@ -48,9 +48,12 @@ public:
     uint32_t         descriptorIndex = 0;
     VkDescriptorType descriptorType  = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
     // ------ attachment info ------
-    bool     isAttachment        = false;
-    bool     isResolveAttachment = false;
-    uint32_t attachSlotIdx       = ~0U;
+    bool     isAttachment            = false;
+    bool     isResolveAttachment     = false;
+    bool     isShadingRateAttachment = false;
+    uint32_t attachSlotIdx           = ~0U;
+    // storage image array with one single level view per mip, the descriptor count is the mip count
+    bool perMipDescriptors = false;
 
     VkAttachmentLoadOp  loadOp;
     VkAttachmentStoreOp storeOp;
@@ -135,9 +138,14 @@ public:
         return _externalState;
     }
 
+    // one view per mip level of the current RHI, storage images can only be bound one level at a time
+    const std::vector<VkImageView>& getMipViews();
+
 private:
     friend class RDGBuilder;
     friend class RDGTextureBuilder;
+    void destroyMipViews();
+
     uint32_t           _refCount = 0;
     RefPtr<Texture>    _rhi;
     bool               _ownsRHI = true;
@@ -146,6 +154,8 @@ private:
     // latest access info for each sub resource
     TextureSubresourceAccessInfo _subResourceAccessInfos;
     std::string                  _name;
+    std::vector<VkImageView>     _mipViews;
+    VkImage                      _mipViewImage = VK_NULL_HANDLE;
 };
 using RDGTextureRef = RDGTexture*;
 
@@ -57,6 +57,13 @@ void DynamicRenderPass::init(const RenderPassConfig& config)
         m_vkStencilAttachmentFormat          = config.stencilAttachment->format;
         m_vkRenderingInfo.pStencilAttachment = &m_vkStencilAttachment;
     }
+    if (config.shadingRateAttachment)
+    {
+        m_vkShadingRateAttachment.imageView                      = config.shadingRateAttachment->imageView;
+        m_vkShadingRateAttachment.imageLayout                    = config.shadingRateAttachment->initialLayout;
+        m_vkShadingRateAttachment.shadingRateAttachmentTexelSize = config.shadingRateTexelSize;
+        m_vkRenderingInfo.pNext                                  = &m_vkShadingRateAttachment;
+    }
     m_vkRenderingInfo.colorAttachmentCount = static_cast<uint32_t>(m_vkColorAttachments.size());
     m_vkRenderingInfo.pColorAttachments    = m_vkColorAttachments.data();
 
@@ -77,7 +84,12 @@ void DynamicRenderPass::begin(VkCommandBuffer cmd, const VkRect2D& renderArea)
         state.barrierInfo.oldLayout = texture->Layout();
         batchBarrier.appendOptionalLayoutTransition(*texture, state.barrierInfo);
 
-        if (accessInfo.attachSlotIdx != ~0U && accessInfo.attachSlotIdx < m_vkColorAttachments.size())
+        if (accessInfo.isShadingRateAttachment)
+        {
+            m_vkShadingRateAttachment.imageView   = texture->descriptor.imageView;
+            m_vkShadingRateAttachment.imageLayout = accessInfo.layout;
+        }
+        else if (accessInfo.attachSlotIdx != ~0U && accessInfo.attachSlotIdx < m_vkColorAttachments.size())
         {
             m_vkColorAttachments[accessInfo.attachSlotIdx].imageView   = texture->descriptor.imageView;
             m_vkColorAttachments[accessInfo.attachSlotIdx].imageLayout = accessInfo.layout;
@@ -39,6 +39,8 @@ struct RenderPassConfig
     std::vector<RenderPassAttachment>   colorAttachments;
     std::optional<RenderPassAttachment> depthAttachment;
     std::optional<RenderPassAttachment> stencilAttachment;
+    std::optional<RenderPassAttachment> shadingRateAttachment;
+    VkExtent2D                          shadingRateTexelSize{0, 0};
     bool                                needMultiThreadRecording;
     // Future extensions for multiview, layers, etc.
 };
@@ -142,6 +144,11 @@ public:
         return m_vkStencilAttachmentFormat;
     }
 
+    bool hasShadingRateAttachment() const
+    {
+        return m_config.shadingRateAttachment.has_value();
+    }
+
 private:
     // Internal helper: handle Layout Transition
     // isBegin = true: initialLayout -> layout
@@ -149,14 +156,15 @@ private:
     void transitionLayouts(VkCommandBuffer cmd, bool isBegin);
 
     // Cache VkRenderingInfo related structures to avoid per-frame construction
-    std::vector<VkRenderingAttachmentInfo> m_vkColorAttachments;
-    std::vector<VkFormat>                  m_vkColorAttachmentFormats;
-    VkRenderingAttachmentInfo              m_vkDepthAttachment{VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
-    VkFormat                               m_vkDepthAttachmentFormat{VK_FORMAT_UNDEFINED};
-    VkRenderingAttachmentInfo              m_vkStencilAttachment{VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
-    VkFormat                               m_vkStencilAttachmentFormat{VK_FORMAT_UNDEFINED};
-    VkRenderingInfo                        m_vkRenderingInfo{VK_STRUCTURE_TYPE_RENDERING_INFO};
-    RDG::RenderPassNode*                   m_ownerPass{nullptr};
+    std::vector<VkRenderingAttachmentInfo>          m_vkColorAttachments;
+    std::vector<VkFormat>                           m_vkColorAttachmentFormats;
+    VkRenderingAttachmentInfo                       m_vkDepthAttachment{VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
+    VkFormat                                        m_vkDepthAttachmentFormat{VK_FORMAT_UNDEFINED};
+    VkRenderingAttachmentInfo                       m_vkStencilAttachment{VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
+    VkFormat                                        m_vkStencilAttachmentFormat{VK_FORMAT_UNDEFINED};
+    VkRenderingFragmentShadingRateAttachmentInfoKHR m_vkShadingRateAttachment{VK_STRUCTURE_TYPE_RENDERING_FRAGMENT_SHADING_RATE_ATTACHMENT_INFO_KHR};
+    VkRenderingInfo                                 m_vkRenderingInfo{VK_STRUCTURE_TYPE_RENDERING_INFO};
+    RDG::RenderPassNode*                            m_ownerPass{nullptr};
 };
 
 } // namespace Play
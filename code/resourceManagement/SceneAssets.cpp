@@ -37,4 +37,37 @@ void expandAABB(AABB& bounds, const AABB& other)
     bounds.max = glm::max(bounds.max, other.max);
 }
 
+bool resolveModelInstance(const CpuModelComponent& component, const std::vector<ModelAsset>& models, ModelInstanceRange& range)
+{
+    if (!component.hasModel() || component.model.index >= models.size())
+    {
+        return false;
+    }
+
+    const ModelAsset& model = models[component.model.index];
+    if (model.generation != component.model.generation || component.firstRenderable >= model.renderables.size())
+    {
+        return false;
+    }
+
+    const uint32_t availableRenderables = static_cast<uint32_t>(model.renderables.size()) - component.firstRenderable;
+    range.firstRenderable               = component.firstRenderable;
+    range.renderableCount               = component.usesAllRenderables() ? availableRenderables : component.renderableCount;
+    if (range.renderableCount > availableRenderables)
+    {
+        range.renderableCount = availableRenderables;
+    }
+    if (range.renderableCount == 0)
+    {
+        return false;
+    }
+
+    range.localBounds = model.renderables[range.firstRenderable].modelBounds;
+    for (uint32_t renderableOffset = 1; renderableOffset < range.renderableCount; ++renderableOffset)
+    {
+        expandAABB(range.localBounds, model.renderables[range.firstRenderable + renderableOffset].modelBounds);
+    }
+    return true;
+}
+
 } // namespace Play
@@ -69,9 +69,38 @@ struct VertexStreamInfo
     uint64_t colorBufferAddress     = 0;
 };
 
+enum class LightType : uint32_t
+{
+    ePoint       = 0,
+    eSpot        = 1,
+    eDirectional = 2,
+    eArea        = 3
+};
+
+// Whether the depth prepass draws the surfaces of a material. eAuto draws the opaque ones, blended and alpha tested
+// surfaces may not cover the pixels their triangles rasterize and keep the regular depth test.
+enum class MaterialDepthPrepass : uint32_t
+{
+    eAuto     = 0,
+    eEnabled  = 1,
+    eDisabled = 2
+};
+
+// Punctual or rectangular area light, in model space as imported and in world space in the per frame light buffer.
+// The layout is mirrored by LightInfo in lighting/LightClusterLib.h.slang.
 struct LightInfo
 {
-    glm::vec3 lightPosition;
+    glm::vec3 position   = {0.0f, 0.0f, 0.0f};  // offset 0    - 12 bytes
+    float     range      = 0.0f;                // offset 12   - 4 bytes, distance where the falloff reaches zero
+    glm::vec3 direction  = {0.0f, 0.0f, -1.0f}; // offset 16   - 12 bytes, emission direction of spot/directional/area lights
+    float     spotScale  = 0.0f;                // offset 28   - 4 bytes, cone falloff = saturate(cosAngle * scale + offset)
+    glm::vec3 color      = {1.0f, 1.0f, 1.0f};  // offset 32   - 12 bytes, linear color premultiplied by intensity
+    float     spotOffset = 1.0f;                // offset 44   - 4 bytes
+    glm::vec3 tangent    = {1.0f, 0.0f, 0.0f};  // offset 48   - 12 bytes, width axis of area lights
+    uint32_t  type       = 0;                   // offset 60   - 4 bytes, LightType
+    glm::vec2 areaSize   = {0.0f, 0.0f};        // offset 64   - 8 bytes, width and height of area lights
+    glm::vec2 padding    = {0.0f, 0.0f};        // offset 72   - 8 bytes
+                                                // Total size: 80 bytes
 };
 
 struct GltfShadeMaterial
@@ -159,6 +188,8 @@ struct ModelAsset
     // Pre-expanded renderable templates built once when the model is registered.
     std::vector<ModelRenderableTemplate> renderables;
     std::vector<glm::mat4>               transforms;
+    // Lights baked into model space, placed in the world per instance every frame.
+    std::vector<LightInfo>               lights;
     AABB                                 bbox;
     uint32_t                             rootNode = INVALID_SCENE_ID;
 
@@ -219,11 +250,23 @@ struct ModelAssetPackage
     ModelGeometryPayload                     geometry;
     std::vector<MeshInfo>                    meshInfos;
     std::vector<shaderio::GltfShadeMaterial> materials;
+    std::vector<MaterialDepthPrepass>        materialDepthPrepass; // by material, eAuto for the ones past its end
     std::vector<shaderio::GltfTextureInfo>   textureInfos;
     std::vector<ModelTextureResource>        textures;
     std::vector<RefPtr<Buffer>>              ownedBuffers;
 };
 
+// the renderables a model component draws and their bounds in model space
+struct ModelInstanceRange
+{
+    uint32_t firstRenderable = 0;
+    uint32_t renderableCount = 0;
+    AABB     localBounds;
+};
+
+// false when the component has no live model or its range is empty, the range is clamped to the model's renderables
+bool resolveModelInstance(const CpuModelComponent& component, const std::vector<ModelAsset>& models, ModelInstanceRange& range);
+
 } // namespace Play
 
 #endif // SCENE_ASSETS_H
@@ -0,0 +1,560 @@
+#include "SceneBVH.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <limits>
+
+namespace Play
+{
+namespace
+{
+constexpr uint32_t kSAHBins       = 16;
+constexpr float    kTraversalCost = 1.0f; // of visiting an inner node, relative to testing one instance's bounds
+constexpr float    kIntersectCost = 1.0f;
+
+using Clock = std::chrono::steady_clock;
+
+float elapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
+
+AABB emptyBounds()
+{
+    AABB bounds;
+    bounds.min = glm::vec3(std::numeric_limits<float>::max());
+    bounds.max = glm::vec3(-std::numeric_limits<float>::max());
+    return bounds;
+}
+
+float surfaceArea(const AABB& bounds)
+{
+    const glm::vec3 extent = glm::max(bounds.max - bounds.min, glm::vec3(0.0f));
+    return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+bool isSameBounds(const AABB& lhs, const AABB& rhs)
+{
+    return lhs.min == rhs.min && lhs.max == rhs.max;
+}
+
+bool isOverlapping(const AABB& lhs, const AABB& rhs)
+{
+    return lhs.min.x <= rhs.max.x && lhs.max.x >= rhs.min.x && lhs.min.y <= rhs.max.y && lhs.max.y >= rhs.min.y && lhs.min.z <= rhs.max.z &&
+           lhs.max.z >= rhs.min.z;
+}
+
+using FrustumPlanes = std::array<glm::vec4, 6>;
+
+// rows of the clip matrix combined into the planes of the clip volume, -w <= x, y <= w and 0 <= z <= w
+FrustumPlanes getFrustumPlanes(const glm::mat4& viewProj)
+{
+    const glm::vec4 row0(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+    const glm::vec4 row1(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+    const glm::vec4 row2(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+    const glm::vec4 row3(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+    return {row3 + row0, row3 - row0, row3 + row1, row3 - row1, row2, row3 - row2};
+}
+
+// -1 when the bounds are wholly outside one plane, which is where all eight corners are outside it, 1 when they are
+// wholly inside every plane and 0 when they cross the frustum
+int classifyBounds(const FrustumPlanes& planes, const AABB& bounds)
+{
+    bool inside = true;
+    for (const glm::vec4& plane : planes)
+    {
+        const glm::vec3 farthest(plane.x >= 0.0f ? bounds.max.x : bounds.min.x, plane.y >= 0.0f ? bounds.max.y : bounds.min.y,
+                                 plane.z >= 0.0f ? bounds.max.z : bounds.min.z);
+        if (glm::dot(glm::vec3(plane), farthest) + plane.w < 0.0f)
+        {
+            return -1;
+        }
+        const glm::vec3 nearest(plane.x >= 0.0f ? bounds.min.x : bounds.max.x, plane.y >= 0.0f ? bounds.min.y : bounds.max.y,
+                                plane.z >= 0.0f ? bounds.min.z : bounds.max.z);
+        inside = inside && glm::dot(glm::vec3(plane), nearest) + plane.w >= 0.0f;
+    }
+    return inside ? 1 : 0;
+}
+
+// the distances at which the ray enters and leaves the bounds, false when it misses them or they are behind it
+bool intersectBounds(const glm::vec3& origin, const glm::vec3& inverseDirection, const AABB& bounds, float& entry, float& exit)
+{
+    const glm::vec3 t0    = (bounds.min - origin) * inverseDirection;
+    const glm::vec3 t1    = (bounds.max - origin) * inverseDirection;
+    const glm::vec3 tNear = glm::min(t0, t1);
+    const glm::vec3 tFar  = glm::max(t0, t1);
+    entry                 = std::max(std::max(tNear.x, tNear.y), tNear.z);
+    exit                  = std::min(std::min(tFar.x, tFar.y), tFar.z);
+    return exit >= std::max(entry, 0.0f);
+}
+
+// the distance an instance is hit at, the far side of bounds around the origin
+bool getInstanceDistance(const glm::vec3& origin, const glm::vec3& inverseDirection, const AABB& bounds, float maxDistance, float& distance)
+{
+    float entry = 0.0f;
+    float exit  = 0.0f;
+    if (!intersectBounds(origin, inverseDirection, bounds, entry, exit))
+    {
+        return false;
+    }
+    distance = entry >= 0.0f ? entry : exit;
+    return distance <= maxDistance;
+}
+
+uint32_t getCentroidBin(float centroid, float binMin, float binScale)
+{
+    return std::min(static_cast<uint32_t>((centroid - binMin) * binScale), kSAHBins - 1);
+}
+} // namespace
+
+void SceneBVH::clear()
+{
+    _instances.clear();
+    _order.clear();
+    _instanceLeaf.clear();
+    _nodes.clear();
+    _dirtyLeaves.clear();
+    _leafDirty.clear();
+    _weightedArea = 0.0;
+    _localBounds.clear();
+    _nodeInstances.clear();
+    _movedNodes.clear();
+    _componentRevision = ~0ULL;
+    _stats             = {};
+}
+
+void SceneBVH::build(std::vector<SceneBVHInstance> instances)
+{
+    _instances = std::move(instances);
+    buildNodes();
+}
+
+void SceneBVH::buildNodes()
+{
+    const Clock::time_point start = Clock::now();
+    const uint32_t          count = static_cast<uint32_t>(_instances.size());
+
+    _nodes.clear();
+    _dirtyLeaves.clear();
+    _order.resize(count);
+    _instanceLeaf.assign(count, INVALID_SCENE_ID);
+
+    // splitting moves these rather than indices into the instances, every pass over a run reads it in order
+    struct BuildItem
+    {
+        AABB      bounds;
+        glm::vec3 centroid;
+        uint32_t  instance = 0;
+    };
+    struct Bin
+    {
+        AABB     bounds = emptyBounds();
+        uint32_t count  = 0;
+    };
+
+    std::vector<BuildItem> items(count);
+    for (uint32_t instance = 0; instance < count; ++instance)
+    {
+        const AABB& bounds = _instances[instance].bounds;
+        items[instance]    = {bounds, (bounds.min + bounds.max) * 0.5f, instance};
+    }
+
+    // a pending node holds its run of items in first and count until it is split or made a leaf
+    std::vector<uint32_t> pending;
+    if (count > 0)
+    {
+        _nodes.reserve(count);
+        _nodes.push_back({emptyBounds(), 0, count, INVALID_SCENE_ID});
+        pending.push_back(0);
+    }
+    while (!pending.empty())
+    {
+        const uint32_t nodeIndex = pending.back();
+        const uint32_t first     = _nodes[nodeIndex].first;
+        const uint32_t nodeCount = _nodes[nodeIndex].count;
+        pending.pop_back();
+
+        AABB bounds         = emptyBounds();
+        AABB centroidBounds = emptyBounds();
+        for (uint32_t entry = first; entry < first + nodeCount; ++entry)
+        {
+            expandAABB(bounds, items[entry].bounds);
+            centroidBounds.min = glm::min(centroidBounds.min, items[entry].centroid);
+            centroidBounds.max = glm::max(centroidBounds.max, items[entry].centroid);
+        }
+        _nodes[nodeIndex].bounds = bounds;
+
+        if (nodeCount <= kMaxLeafInstances)
+        {
+            for (uint32_t entry = first; entry < first + nodeCount; ++entry)
+            {
+                _order[entry]                        = items[entry].instance;
+                _instanceLeaf[items[entry].instance] = nodeIndex;
+            }
+            continue;
+        }
+
+        // the centroids binned along all three axes in one pass, the plane with the least area weighted count splits
+        const glm::vec3                          extent = centroidBounds.max - centroidBounds.min;
+        std::array<std::array<Bin, kSAHBins>, 3> bins;
+        glm::vec3                                binScale(0.0f);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            binScale[axis] = extent[axis] > 0.0f ? kSAHBins / extent[axis] : 0.0f;
+        }
+        for (uint32_t entry = first; entry < first + nodeCount; ++entry)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                Bin& bin = bins[axis][getCentroidBin(items[entry].centroid[axis], centroidBounds.min[axis], binScale[axis])];
+                expandAABB(bin.bounds, items[entry].bounds);
+                ++bin.count;
+            }
+        }
+
+        float    bestCost = std::numeric_limits<float>::max();
+        int      bestAxis = -1;
+        uint32_t bestBin  = 0;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (extent[axis] <= 0.0f)
+            {
+                continue;
+            }
+
+            std::array<float, kSAHBins - 1>    leftCost;
+            std::array<uint32_t, kSAHBins - 1> leftCount;
+            AABB                               left    = emptyBounds();
+            uint32_t                           leftSum = 0;
+            for (uint32_t plane = 0; plane < kSAHBins - 1; ++plane)
+            {
+                expandAABB(left, bins[axis][plane].bounds);
+                leftSum += bins[axis][plane].count;
+                leftCount[plane] = leftSum;
+                leftCost[plane]  = leftSum > 0 ? surfaceArea(left) * leftSum : 0.0f;
+            }
+            AABB     right    = emptyBounds();
+            uint32_t rightSum = 0;
+            for (uint32_t plane = kSAHBins - 1; plane > 0; --plane)
+            {
+                expandAABB(right, bins[axis][plane].bounds);
+                rightSum += bins[axis][plane].count;
+                const float cost = leftCost[plane - 1] + (rightSum > 0 ? surfaceArea(right) * rightSum : 0.0f);
+                if (leftCount[plane - 1] > 0 && rightSum > 0 && cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin  = plane;
+                }
+            }
+        }
+
+        // centroids on one point cannot be told apart by a plane, those runs are halved
+        uint32_t middle = first + nodeCount / 2;
+        if (bestAxis >= 0)
+        {
+            const float binMin = centroidBounds.min[bestAxis];
+            auto        split  = std::partition(items.begin() + first, items.begin() + first + nodeCount, [&](const BuildItem& item)
+                                                { return getCentroidBin(item.centroid[bestAxis], binMin, binScale[bestAxis]) < bestBin; });
+            middle             = static_cast<uint32_t>(split - items.begin());
+        }
+
+        const uint32_t leftChild = static_cast<uint32_t>(_nodes.size());
+        _nodes[nodeIndex].first  = leftChild;
+        _nodes[nodeIndex].count  = 0;
+        _nodes.push_back({emptyBounds(), first, middle - first, nodeIndex});
+        _nodes.push_back({emptyBounds(), middle, first + nodeCount - middle, nodeIndex});
+        pending.push_back(leftChild + 1);
+        pending.push_back(leftChild);
+    }
+
+    _leafDirty.assign(_nodes.size(), 0);
+    _weightedArea = 0.0;
+    for (const Node& node : _nodes)
+    {
+        _weightedArea += getNodeWeight(node) * surfaceArea(node.bounds);
+    }
+
+    _stats.instances   = count;
+    _stats.nodes       = static_cast<uint32_t>(_nodes.size());
+    _stats.cost        = getCost();
+    _stats.builtCost   = _stats.cost;
+    _stats.lastBuildMs = elapsedMs(start);
+    ++_stats.builds;
+}
+
+void SceneBVH::setInstanceBounds(uint32_t instance, const AABB& bounds)
+{
+    _instances[instance].bounds = bounds;
+    const uint32_t leaf         = _instanceLeaf[instance];
+    if (!_leafDirty[leaf])
+    {
+        _leafDirty[leaf] = 1;
+        _dirtyLeaves.push_back(leaf);
+    }
+}
+
+void SceneBVH::refit()
+{
+    if (_dirtyLeaves.empty())
+    {
+        return;
+    }
+
+    const Clock::time_point start = Clock::now();
+    if (_dirtyLeaves.size() * 8 > _nodes.size())
+    {
+        // children come after their parents, one pass from the back refits everything
+        _weightedArea = 0.0;
+        for (uint32_t nodeIndex = static_cast<uint32_t>(_nodes.size()); nodeIndex-- > 0;)
+        {
+            updateNodeBounds(nodeIndex);
+            _weightedArea += getNodeWeight(_nodes[nodeIndex]) * surfaceArea(_nodes[nodeIndex].bounds);
+        }
+    }
+    else
+    {
+        // up from each moved leaf until a node keeps its bounds, the ones above it keep theirs too
+        for (uint32_t leaf : _dirtyLeaves)
+        {
+            for (uint32_t nodeIndex = leaf; nodeIndex != INVALID_SCENE_ID; nodeIndex = _nodes[nodeIndex].parent)
+            {
+                const AABB previous = _nodes[nodeIndex].bounds;
+                updateNodeBounds(nodeIndex);
+                if (isSameBounds(previous, _nodes[nodeIndex].bounds))
+                {
+                    break;
+                }
+                _weightedArea += getNodeWeight(_nodes[nodeIndex]) * (surfaceArea(_nodes[nodeIndex].bounds) - surfaceArea(previous));
+            }
+        }
+    }
+    for (uint32_t leaf : _dirtyLeaves)
+    {
+        _leafDirty[leaf] = 0;
+    }
+    _dirtyLeaves.clear();
+
+    _stats.cost        = getCost();
+    _stats.lastRefitMs = elapsedMs(start);
+    ++_stats.refits;
+}
+
+void SceneBVH::update(CpuScene& scene, const std::vector<ModelAsset>& models, float rebuildCostRatio)
+{
+    const std::vector<CpuSceneNode>& nodes = scene.getNodes();
+    if (scene.getComponentRevision() != _componentRevision)
+    {
+        _componentRevision = scene.getComponentRevision();
+        _localBounds.clear();
+        _nodeInstances.assign(nodes.size(), INVALID_SCENE_ID);
+
+        std::vector<SceneBVHInstance> instances;
+        for (const CpuModelComponent& component : scene.view<CpuModelComponent>())
+        {
+            const CpuSceneNode* node = scene.getNode(component.ownerNode);
+            ModelInstanceRange  range;
+            if (!node || !resolveModelInstance(component, models, range))
+            {
+                continue;
+            }
+            _nodeInstances[component.ownerNode.index] = static_cast<uint32_t>(instances.size());
+            instances.push_back({component.ownerNode, transformAABB(range.localBounds, node->worldTransform)});
+            _localBounds.push_back(range.localBounds);
+        }
+        // every bounds was just taken from the world transforms, the moved nodes add nothing
+        scene.takeMovedNodes(_movedNodes);
+        build(std::move(instances));
+        return;
+    }
+
+    scene.takeMovedNodes(_movedNodes);
+    for (uint32_t nodeIndex : _movedNodes)
+    {
+        const uint32_t instance = nodeIndex < _nodeInstances.size() ? _nodeInstances[nodeIndex] : INVALID_SCENE_ID;
+        if (instance != INVALID_SCENE_ID)
+        {
+            setInstanceBounds(instance, transformAABB(_localBounds[instance], nodes[nodeIndex].worldTransform));
+        }
+    }
+    refit();
+
+    if (getCost() > rebuildCostRatio * _stats.builtCost)
+    {
+        buildNodes();
+    }
+}
+
+void SceneBVH::queryFrustum(const glm::mat4& viewProj, std::vector<uint32_t>& instances) const
+{
+    if (_nodes.empty())
+    {
+        return;
+    }
+
+    const FrustumPlanes   planes = getFrustumPlanes(viewProj);
+    std::vector<uint32_t> stack  = {0};
+    while (!stack.empty())
+    {
+        const uint32_t nodeIndex = stack.back();
+        const Node&    node      = _nodes[nodeIndex];
+        stack.pop_back();
+
+        const int classification = classifyBounds(planes, node.bounds);
+        if (classification < 0)
+        {
+            continue;
+        }
+        if (classification > 0)
+        {
+            appendSubtree(nodeIndex, instances);
+        }
+        else if (node.count > 0)
+        {
+            for (uint32_t entry = node.first; entry < node.first + node.count; ++entry)
+            {
+                if (classifyBounds(planes, _instances[_order[entry]].bounds) >= 0)
+                {
+                    instances.push_back(_order[entry]);
+                }
+            }
+        }
+        else
+        {
+            stack.push_back(node.first + 1);
+            stack.push_back(node.first);
+        }
+    }
+}
+
+void SceneBVH::queryAABB(const AABB& bounds, std::vector<uint32_t>& instances) const
+{
+    if (_nodes.empty())
+    {
+        return;
+    }
+
+    std::vector<uint32_t> stack = {0};
+    while (!stack.empty())
+    {
+        const Node& node = _nodes[stack.back()];
+        stack.pop_back();
+
+        if (!isOverlapping(node.bounds, bounds))
+        {
+            continue;
+        }
+        if (node.count > 0)
+        {
+            for (uint32_t entry = node.first; entry < node.first + node.count; ++entry)
+            {
+                if (isOverlapping(_instances[_order[entry]].bounds, bounds))
+                {
+                    instances.push_back(_order[entry]);
+                }
+            }
+        }
+        else
+        {
+            stack.push_back(node.first + 1);
+            stack.push_back(node.first);
+        }
+    }
+}
+
+SceneBVHHit SceneBVH::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+                              const std::function<bool(uint32_t instance)>& accept) const
+{
+    SceneBVHHit hit;
+    hit.distance = maxDistance;
+    if (_nodes.empty())
+    {
+        return hit;
+    }
+
+    const glm::vec3       inverseDirection = 1.0f / direction;
+    std::vector<uint32_t> stack            = {0};
+    while (!stack.empty())
+    {
+        const Node& node  = _nodes[stack.back()];
+        float       entry = 0.0f;
+        float       exit  = 0.0f;
+        stack.pop_back();
+
+        // the far side of an instance is never nearer than where its node is entered
+        if (!intersectBounds(origin, inverseDirection, node.bounds, entry, exit) || std::max(entry, 0.0f) > hit.distance)
+        {
+            continue;
+        }
+        if (node.count > 0)
+        {
+            for (uint32_t entryIndex = node.first; entryIndex < node.first + node.count; ++entryIndex)
+            {
+                float distance = 0.0f;
+                if (getInstanceDistance(origin, inverseDirection, _instances[_order[entryIndex]].bounds, hit.distance, distance) &&
+                    (hit.instance == INVALID_SCENE_ID || distance < hit.distance) && (!accept || accept(_order[entryIndex])))
+                {
+                    hit.instance = _order[entryIndex];
+                    hit.distance = distance;
+                }
+            }
+            continue;
+        }
+
+        // the nearer child is popped first and its hits prune the farther one
+        float leftEntry  = 0.0f;
+        float rightEntry = 0.0f;
+        intersectBounds(origin, inverseDirection, _nodes[node.first].bounds, leftEntry, exit);
+        intersectBounds(origin, inverseDirection, _nodes[node.first + 1].bounds, rightEntry, exit);
+        const bool leftFirst = leftEntry <= rightEntry;
+        stack.push_back(leftFirst ? node.first + 1 : node.first);
+        stack.push_back(leftFirst ? node.first : node.first + 1);
+    }
+    return hit;
+}
+
+float SceneBVH::getCost() const
+{
+    const float rootArea = _nodes.empty() ? 0.0f : surfaceArea(_nodes[0].bounds);
+    return rootArea > 0.0f ? static_cast<float>(_weightedArea / rootArea) : 0.0f;
+}
+
+void SceneBVH::updateNodeBounds(uint32_t nodeIndex)
+{
+    Node& node = _nodes[nodeIndex];
+    if (node.count > 0)
+    {
+        node.bounds = _instances[_order[node.first]].bounds;
+        for (uint32_t entry = node.first + 1; entry < node.first + node.count; ++entry)
+        {
+            expandAABB(node.bounds, _instances[_order[entry]].bounds);
+        }
+        return;
+    }
+    node.bounds = _nodes[node.first].bounds;
+    expandAABB(node.bounds, _nodes[node.first + 1].bounds);
+}
+
+double SceneBVH::getNodeWeight(const Node& node) const
+{
+    return node.count > 0 ? node.count * kIntersectCost : kTraversalCost;
+}
+
+void SceneBVH::appendSubtree(uint32_t nodeIndex, std::vector<uint32_t>& instances) const
+{
+    std::vector<uint32_t> stack = {nodeIndex};
+    while (!stack.empty())
+    {
+        const Node& node = _nodes[stack.back()];
+        stack.pop_back();
+        if (node.count > 0)
+        {
+            instances.insert(instances.end(), _order.begin() + node.first, _order.begin() + node.first + node.count);
+            continue;
+        }
+        stack.push_back(node.first + 1);
+        stack.push_back(node.first);
+    }
+}
+
+} // namespace Play
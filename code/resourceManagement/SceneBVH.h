@@ -0,0 +1,103 @@
+#ifndef SCENE_BVH_H
+#define SCENE_BVH_H
+#include "SceneAssets.h"
+#include <functional>
+namespace Play
+{
+
+struct SceneBVHInstance
+{
+    CpuSceneNodeID node;
+    AABB           bounds; // in world space
+};
+
+struct SceneBVHHit
+{
+    uint32_t instance = INVALID_SCENE_ID;
+    float    distance = 0.0f; // along the ray direction, in its units
+};
+
+struct SceneBVHStats
+{
+    uint32_t instances   = 0;
+    uint32_t nodes       = 0;
+    float    cost        = 0.0f; // SAH cost of the tree as it is now
+    float    builtCost   = 0.0f; // and right after its last build
+    uint32_t builds      = 0;
+    uint32_t refits      = 0;
+    float    lastBuildMs = 0.0f;
+    float    lastRefitMs = 0.0f;
+};
+
+// a bounding volume hierarchy over instance bounds, built top down with binned SAH splits. Moved instances are refit
+// in place, which keeps the topology and lets the tree degrade, so update() rebuilds it once its SAH cost has grown past
+// a ratio of its cost when built. Queries append instance indices, which stay stable until the next build
+class SceneBVH
+{
+public:
+    void clear();
+    void build(std::vector<SceneBVHInstance> instances);
+    // the new bounds reach the nodes above the instance with the next refit
+    void setInstanceBounds(uint32_t instance, const AABB& bounds);
+    void refit();
+
+    // keeps the tree over the model instances of the scene: components added, removed or loaded build it again, nodes
+    // whose world transform changed are refit. Takes the moved nodes of the scene, after its world transforms are updated
+    void update(CpuScene& scene, const std::vector<ModelAsset>& models, float rebuildCostRatio);
+
+    // the instances whose bounds are not wholly outside one of the frustum planes, the test the GBuffer culls with
+    void        queryFrustum(const glm::mat4& viewProj, std::vector<uint32_t>& instances) const;
+    void        queryAABB(const AABB& bounds, std::vector<uint32_t>& instances) const;
+    // the nearest instance whose bounds the ray hits and that accept takes, when given. Bounds around the origin count at
+    // their far side, so the smaller instances inside them are picked first
+    SceneBVHHit raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+                        const std::function<bool(uint32_t instance)>& accept = {}) const;
+
+    float getCost() const;
+
+    const std::vector<SceneBVHInstance>& getInstances() const
+    {
+        return _instances;
+    }
+
+    const SceneBVHStats& getStats() const
+    {
+        return _stats;
+    }
+
+private:
+    static constexpr uint32_t kMaxLeafInstances = 4;
+
+    struct Node
+    {
+        AABB     bounds;
+        uint32_t first  = 0; // the left child of an inner node, whose right child follows it. A leaf's first entry of _order
+        uint32_t count  = 0; // instances of a leaf, 0 for an inner node
+        uint32_t parent = INVALID_SCENE_ID;
+    };
+
+    void   buildNodes();
+    void   updateNodeBounds(uint32_t nodeIndex);
+    double getNodeWeight(const Node& node) const;
+    void   appendSubtree(uint32_t nodeIndex, std::vector<uint32_t>& instances) const;
+
+    std::vector<SceneBVHInstance> _instances;
+    std::vector<uint32_t>         _order;        // instance indices, each leaf owns a run of them
+    std::vector<uint32_t>         _instanceLeaf; // by instance
+    std::vector<Node>             _nodes;        // the root first
+    std::vector<uint32_t>         _dirtyLeaves;
+    std::vector<uint8_t>          _leafDirty;    // by node
+    double                        _weightedArea = 0.0; // the SAH cost before dividing by the root's area
+
+    // the scene the tree was last updated from
+    std::vector<AABB>     _localBounds;   // by instance, in model space
+    std::vector<uint32_t> _nodeInstances; // instance by scene node index
+    std::vector<uint32_t> _movedNodes;
+    uint64_t              _componentRevision = ~0ULL;
+
+    SceneBVHStats _stats;
+};
+
+} // namespace Play
+
+#endif // SCENE_BVH_H
@@ -2,6 +2,11 @@
 #include "Resource.h"
 #include "core/runtime/VulkanRuntime.h"
 #include "DescriptorManager.h"
+#include "utils.hpp"
+#include <algorithm>
+#include <chrono>
+#include <nvutils/file_operations.hpp>
+#include <nvutils/logger.hpp>
 
 namespace Play
 {
@@ -21,6 +26,12 @@ std::unique_ptr<GpuScene> createGpuScene(GpuSceneType type)
             return std::make_unique<RasterGpuScene>();
     }
 }
+
+std::filesystem::path resolveSnapshotPath(const std::string& path)
+{
+    const std::filesystem::path snapshotPath = nvutils::pathFromUtf8(path);
+    return snapshotPath.is_absolute() ? snapshotPath : getBaseFilePath() / snapshotPath;
+}
 } // namespace
 
 SceneManager::SceneManager(GpuSceneType gpuSceneType) : _gpuScene(createGpuScene(gpuSceneType))
@@ -37,6 +48,14 @@ SceneManager::SceneManager(GpuSceneType gpuSceneType) : _gpuScene(createGpuScene
                                         VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT); // s_SceneTextures[]
 
     vkDriver->getDescriptorSetCache()->initSceneDescriptorSets(_sceneDescriptorBindings);
+    vkDriver->getEditorRegistry().registerWritable<SceneGraphSettings>("Scene Graph", _settings);
+    vkDriver->getEditorRegistry().registerReadOnly<SceneGraphStats>("Scene Graph Stats", _stats);
+    if (_gpuScene)
+    {
+        TextureStreamer& textureStreamer = _gpuScene->getTextureStreamer();
+        vkDriver->getEditorRegistry().registerWritable<TextureStreamingSettings>("Texture Streaming", textureStreamer.getSettings());
+        vkDriver->getEditorRegistry().registerReadOnly<TextureStreamingStats>("Texture Streaming Stats", textureStreamer.getStats());
+    }
 }
 
 void SceneManager::addSkyBoxTexture(const RefPtr<Texture>& texture)
@@ -84,7 +103,7 @@ void SceneManager::updateDescriptorSet()
     skyWrite.pImageInfo = skyImageInfos.data();
     if (!_sceneSkyTexture.empty()) writes.push_back(skyWrite);
 
-    vkUpdateDescriptorSets(vkDriver->getDevice(), writes.size(), writes.data(), 0, nullptr);
+    vkDriver->getDescriptorSetCache()->updateCommonDescriptorSets(writes.data(), static_cast<uint32_t>(writes.size()));
 }
 
 void SceneManager::update()
@@ -96,7 +115,9 @@ void SceneManager::update()
         });
 
     std::lock_guard<std::mutex> lock(_cpuSceneMutex);
+    updateSnapshots();
     _cpuScene.updateWorldTransforms();
+    _stats.ModelComponents = static_cast<uint32_t>(_cpuScene.view<CpuModelComponent>().size());
 
     const size_t previousSceneTextureCount = _gpuScene ? _gpuScene->getSceneTextures().size() : 0;
 
@@ -140,12 +161,117 @@ void SceneManager::update()
         _gpuScene->updateTransforms(_cpuScene);
     }
 
-    if (_gpuScene && _gpuScene->getSceneTextures().size() != previousSceneTextureCount)
+    // after the completions, a model registered this frame is in the tree before the passes read it
+    if (_gpuScene)
+    {
+        _sceneBVH.update(_cpuScene, _gpuScene->getModels(), std::max(_settings.BVHRebuildCostRatio, 1.0f));
+    }
+    const SceneBVHStats& bvhStats = _sceneBVH.getStats();
+    _stats.BVHInstances = bvhStats.instances;
+    _stats.BVHNodes     = bvhStats.nodes;
+    _stats.BVHCost      = bvhStats.cost;
+    _stats.BVHBuiltCost = bvhStats.builtCost;
+    _stats.BVHBuilds    = bvhStats.builds;
+    _stats.BVHRefits    = bvhStats.refits;
+    _stats.BVHBuildMs   = bvhStats.lastBuildMs;
+    _stats.BVHRefitMs   = bvhStats.lastRefitMs;
+
+    // after the completions, the textures of a model registered this frame start streaming at once
+    const bool sceneTexturesReplaced = _gpuScene && _gpuScene->updateTextureStreaming();
+    if (sceneTexturesReplaced || (_gpuScene && _gpuScene->getSceneTextures().size() != previousSceneTextureCount))
     {
         updateDescriptorSet();
     }
 }
 
+CpuSceneNodeID SceneManager::pickNode(const glm::vec3& origin, const glm::vec3& direction, float maxDistance)
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point start = Clock::now();
+
+    std::lock_guard<std::mutex> lock(_cpuSceneMutex);
+    // hidden nodes keep their place in the tree, a pick passes through them
+    auto isVisible = [&](uint32_t instance)
+    {
+        const CpuSceneNode* node = _cpuScene.getNode(_sceneBVH.getInstances()[instance].node);
+        return node && node->worldVisible;
+    };
+    const SceneBVHHit hit = _sceneBVH.raycast(origin, direction, maxDistance, isVisible);
+    _lastPick.node = hit.instance != INVALID_SCENE_ID ? _sceneBVH.getInstances()[hit.instance].node : CpuSceneNodeID{};
+    ++_lastPick.serial;
+    _stats.PickMs = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+    return _lastPick.node;
+}
+
+void SceneManager::updateSnapshots()
+{
+    using Clock = std::chrono::steady_clock;
+    auto elapsedMs = [](Clock::time_point start) { return std::chrono::duration<float, std::milli>(Clock::now() - start).count(); };
+
+    if (_pendingSave.valid() && _pendingSave.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+        const SceneSnapshotResult result = _pendingSave.get();
+        if (result.succeeded)
+        {
+            _stats.SnapshotNodes      = result.nodes;
+            _stats.SnapshotComponents = result.components;
+            _stats.SnapshotMB         = static_cast<float>(result.bytes) / (1024.0f * 1024.0f);
+            _stats.SnapshotWriteMs    = result.ms;
+            LOGI("Scene snapshot saved, %u nodes and %u components in %.3f ms\n", result.nodes, result.components, result.ms);
+        }
+    }
+    _stats.SnapshotSaving = _pendingSave.valid();
+
+    if (_settings.SaveSnapshot)
+    {
+        _settings.SaveSnapshot = false;
+        if (_pendingSave.valid())
+        {
+            LOGW("Scene snapshot still being saved, the request is dropped\n");
+        }
+        else
+        {
+            // the copy is the only part holding the lock, encoding and the file are left to the background thread
+            const Clock::time_point     start    = Clock::now();
+            SceneSnapshot               snapshot = captureSceneSnapshot(_cpuScene);
+            const std::filesystem::path path     = resolveSnapshotPath(_settings.SnapshotPath);
+            _stats.SnapshotCaptureMs = elapsedMs(start);
+            _stats.SnapshotSaving    = true;
+            _pendingSave = std::async(std::launch::async, [snapshot = std::move(snapshot), path]() { return writeSceneSnapshot(snapshot, path); });
+        }
+    }
+
+    if (_settings.LoadSnapshot)
+    {
+        _settings.LoadSnapshot = false;
+        const SceneSnapshotResult result = loadSceneSnapshot(_cpuScene, resolveSnapshotPath(_settings.SnapshotPath));
+        if (!result.succeeded)
+        {
+            return;
+        }
+        _stats.SnapshotNodes      = result.nodes;
+        _stats.SnapshotComponents = result.components;
+        _stats.SnapshotMB         = static_cast<float>(result.bytes) / (1024.0f * 1024.0f);
+        _stats.SnapshotLoadMs     = result.ms;
+        LOGI("Scene snapshot loaded, %u nodes and %u components in %.3f ms\n", result.nodes, result.components, result.ms);
+
+        // the models of the previous scene stay registered, the loaded components request theirs again
+        editAssetLoadingServer(
+            [&](AssetLoadingServer& loadingServer)
+            {
+                for (CpuModelComponent& component : _cpuScene.view<CpuModelComponent>())
+                {
+                    if (!component.sourcePath.empty())
+                    {
+                        const std::string        sourcePath    = component.sourcePath;
+                        const ModelLoadingConfig loadingConfig = component.loadingConfig;
+                        component.requestLoadFromFile(_cpuScene, loadingServer, sourcePath, loadingConfig);
+                    }
+                }
+            });
+    }
+}
+
 SceneManager::~SceneManager() = default;
 
 } // namespace Play
@@ -5,16 +5,58 @@
 #include "nvvk/descriptors.hpp"
 #include "PlayScene.h"
 #include "CpuScene.h"
+#include "SceneBVH.h"
+#include "SceneSnapshot.h"
 #include "core/RefCounted.h"
+#include <future>
 namespace Play
 {
 class RenderSession;
 class Texture;
+
+struct SceneGraphSettings
+{
+    std::string SnapshotPath        = "content/scenes/scene.pscene"; // relative to the base directory
+    bool        SaveSnapshot        = false; // one-shot, captured on the next update and written on a background thread
+    bool        LoadSnapshot        = false; // one-shot, replaces the scene and requests its models again
+    bool        BVHCulling          = true;  // the GBuffer culls through the BVH, a scan over every model component otherwise
+    float       BVHRebuildCostRatio = 1.5f;  // refit trees are rebuilt once their SAH cost grows past this times their built cost
+};
+
+struct SceneGraphStats
+{
+    uint32_t ModelComponents    = 0;
+    bool     SnapshotSaving     = false;
+    uint32_t SnapshotNodes      = 0;    // of the last snapshot saved or loaded
+    uint32_t SnapshotComponents = 0;
+    float    SnapshotMB         = 0.0f;
+    float    SnapshotCaptureMs  = 0.0f; // on the update thread, holding the scene lock
+    float    SnapshotWriteMs    = 0.0f; // encoding and writing on the background thread
+    float    SnapshotLoadMs     = 0.0f;
+    uint32_t BVHInstances       = 0;
+    uint32_t BVHNodes           = 0;
+    float    BVHCost            = 0.0f;
+    float    BVHBuiltCost       = 0.0f;
+    uint32_t BVHBuilds          = 0;
+    uint32_t BVHRefits          = 0;
+    float    BVHBuildMs         = 0.0f; // of the last build
+    float    BVHRefitMs         = 0.0f; // of the last refit
+    float    PickMs             = 0.0f;
+};
+
+// the node the last pick hit, invalid when it hit none. The serial counts the picks so the editor sees each once
+struct SceneNodePick
+{
+    CpuSceneNodeID node;
+    uint64_t       serial = 0;
+};
+
 class SceneManager
 {
 public:
     static constexpr uint32_t SceneTextureBinding      = 3;
     static constexpr uint32_t SceneTexturePoolCapacity = 1024;
+    static_assert(SceneTexturePoolCapacity <= TextureStreamer::kFeedbackSlots, "every scene texture slot needs its feedback");
 
     SceneManager(GpuSceneType gpuSceneType = GpuSceneType::eRaster);
     GpuScene* getGpuScene()
@@ -75,6 +117,26 @@ public:
     {
         return *static_cast<const RasterGpuScene*>(_gpuScene.get());
     }
+    SceneGraphSettings& getSettings()
+    {
+        return _settings;
+    }
+    SceneGraphStats& getStats()
+    {
+        return _stats;
+    }
+    // the model instances of the scene graph, read with the scene lock held like the graph itself
+    const SceneBVH& getSceneBVH() const
+    {
+        return _sceneBVH;
+    }
+    // the node of the nearest visible model instance whose bounds the ray hits
+    CpuSceneNodeID pickNode(const glm::vec3& origin, const glm::vec3& direction, float maxDistance);
+    // with the scene lock held, from readSceneGraph
+    const SceneNodePick& getLastPick() const
+    {
+        return _lastPick;
+    }
     void addSkyBoxTexture(const RefPtr<Texture>& texture);
     void updateDescriptorSet();
     void update();
@@ -83,6 +145,9 @@ public:
 
 protected:
 private:
+    // with the scene lock held: collects a finished save, starts a requested one and loads a requested snapshot
+    void updateSnapshots();
+
     nvvk::DescriptorBindings     _sceneDescriptorBindings;
     std::vector<RefPtr<Texture>> _sceneSkyTexture;
 
@@ -90,7 +155,12 @@ private:
     mutable std::mutex _cpuSceneMutex;
     AssetLoadingServer _assetLoadingServer;
     std::mutex         _assetLoadingServerMutex;
-    std::unique_ptr<GpuScene> _gpuScene;
+    std::unique_ptr<GpuScene>        _gpuScene;
+    SceneGraphSettings               _settings;
+    SceneGraphStats                  _stats;
+    std::future<SceneSnapshotResult> _pendingSave; // the save on the background thread, waited for on destruction
+    SceneBVH                         _sceneBVH;
+    SceneNodePick                    _lastPick;
 };
 
 } // namespace Play
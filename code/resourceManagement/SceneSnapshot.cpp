@@ -0,0 +1,798 @@
+#include "SceneSnapshot.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <unordered_map>
+#include <nvutils/file_mapping.hpp>
+#include <nvutils/file_operations.hpp>
+#include <nvutils/logger.hpp>
+#include <rttr/type>
+
+namespace Play
+{
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+float elapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
+
+constexpr uint32_t kSnapshotMagic    = 0x4E435350; // "PSCN"
+constexpr uint64_t kSectionAlignment = 16;
+constexpr uint32_t kNodeVisibleFlag  = 1;
+
+enum class SnapshotSectionKind : uint32_t
+{
+    eStrings = 1, // count + 1 uint32 offsets into the characters that follow them
+    eNodes,       // count SnapshotNodeRecords
+    eComponents,  // one type: SnapshotComponentHeader, its properties, then count records of recordSize bytes
+};
+
+// how a reflected value is stored, strings and enum values go to the string table by name
+enum class SnapshotValueKind : uint32_t
+{
+    eBool,
+    eInt32,
+    eUint32,
+    eInt64,
+    eUint64,
+    eFloat,
+    eDouble,
+    eString,
+    eEnum,
+    eVec2,
+    eVec3,
+    eVec4,
+    eCount
+};
+
+struct SnapshotHeader
+{
+    uint32_t magic        = kSnapshotMagic;
+    uint32_t version      = SCENE_SNAPSHOT_FORMAT_VERSION;
+    uint32_t sectionCount = 0;
+    uint32_t reserved     = 0;
+};
+
+struct SnapshotSection
+{
+    SnapshotSectionKind kind   = SnapshotSectionKind::eStrings;
+    uint32_t            count  = 0;
+    uint64_t            offset = 0; // from the start of the file, a multiple of kSectionAlignment
+    uint64_t            size   = 0;
+};
+
+struct SnapshotNodeRecord
+{
+    uint32_t  parent; // record index, INVALID_SCENE_ID for the root
+    uint32_t  name;   // string index
+    uint32_t  type;
+    uint32_t  flags;
+    glm::vec3 translation;
+    glm::vec3 rotation;
+    glm::vec3 scale;
+    glm::mat4 localTransform; // kept as set, a decomposed matrix does not always compose back to the same bits
+};
+static_assert(sizeof(SnapshotNodeRecord) == 116 && std::is_trivially_copyable_v<SnapshotNodeRecord>);
+
+struct SnapshotComponentHeader
+{
+    uint32_t typeName      = 0; // string index of the reflected type name
+    uint32_t propertyCount = 0;
+    uint32_t recordSize    = 0; // the owner's node record index, then the values at their property offsets
+    uint32_t reserved      = 0;
+};
+
+struct SnapshotPropertyRecord
+{
+    uint32_t          name   = 0; // string index, nested properties are joined by dots
+    SnapshotValueKind kind   = SnapshotValueKind::eBool;
+    uint32_t          offset = 0; // in the record
+};
+
+// a leaf of a component's reflected properties, nested classes are entered along path
+struct SnapshotProperty
+{
+    std::string                 name;
+    std::vector<rttr::property> path;
+    SnapshotValueKind           kind = SnapshotValueKind::eBool;
+};
+
+struct SnapshotComponentType
+{
+    rttr::type type;
+    void (*capture)(const CpuScene& scene, const std::vector<uint32_t>& snapshotIndices, SceneSnapshotComponentGroup& group) = nullptr;
+    void (*reserve)(CpuScene& scene, uint32_t count)                                                                     = nullptr;
+    CpuSceneComponent* (*add)(CpuScene& scene, CpuSceneNodeID nodeID)                                                    = nullptr;
+};
+
+template <typename T>
+SnapshotComponentType makeSnapshotComponentType()
+{
+    SnapshotComponentType componentType{rttr::type::get<T>()};
+    componentType.capture = [](const CpuScene& scene, const std::vector<uint32_t>& snapshotIndices, SceneSnapshotComponentGroup& group)
+    {
+        for (const T& component : scene.view<T>())
+        {
+            const uint32_t ownerIndex = component.ownerNode.index;
+            if (ownerIndex >= snapshotIndices.size() || snapshotIndices[ownerIndex] == INVALID_SCENE_ID)
+            {
+                continue;
+            }
+            group.owners.push_back(snapshotIndices[ownerIndex]);
+            group.components.push_back(std::make_unique<T>(component));
+        }
+    };
+    componentType.reserve = [](CpuScene& scene, uint32_t count) { scene.reserveComponents<T>(count); };
+    componentType.add     = [](CpuScene& scene, CpuSceneNodeID nodeID) -> CpuSceneComponent* { return scene.addComponent<T>(nodeID); };
+    return componentType;
+}
+
+// the component types a snapshot keeps, a type is saved through the properties registered in RuntimeReflection.cpp
+const std::vector<SnapshotComponentType>& getSnapshotComponentTypes()
+{
+    static const std::vector<SnapshotComponentType> types = {makeSnapshotComponentType<CpuModelComponent>()};
+    return types;
+}
+
+const SnapshotComponentType* findSnapshotComponentType(std::string_view typeName)
+{
+    for (const SnapshotComponentType& componentType : getSnapshotComponentTypes())
+    {
+        if (componentType.type.get_name() == rttr::string_view(typeName.data(), typeName.size()))
+        {
+            return &componentType;
+        }
+    }
+    return nullptr;
+}
+
+uint64_t alignSection(uint64_t offset)
+{
+    return (offset + kSectionAlignment - 1) & ~(kSectionAlignment - 1);
+}
+
+uint32_t getValueSize(SnapshotValueKind kind)
+{
+    switch (kind)
+    {
+        case SnapshotValueKind::eBool:
+            return 1;
+        case SnapshotValueKind::eInt64:
+        case SnapshotValueKind::eUint64:
+        case SnapshotValueKind::eDouble:
+        case SnapshotValueKind::eVec2:
+            return 8;
+        case SnapshotValueKind::eVec3:
+            return 12;
+        case SnapshotValueKind::eVec4:
+            return 16;
+        default:
+            return 4;
+    }
+}
+
+bool getValueKind(const rttr::type& type, SnapshotValueKind& kind)
+{
+    static const std::pair<rttr::type, SnapshotValueKind> kinds[] = {
+        {rttr::type::get<bool>(), SnapshotValueKind::eBool},
+        {rttr::type::get<int32_t>(), SnapshotValueKind::eInt32},
+        {rttr::type::get<uint32_t>(), SnapshotValueKind::eUint32},
+        {rttr::type::get<int64_t>(), SnapshotValueKind::eInt64},
+        {rttr::type::get<uint64_t>(), SnapshotValueKind::eUint64},
+        {rttr::type::get<float>(), SnapshotValueKind::eFloat},
+        {rttr::type::get<double>(), SnapshotValueKind::eDouble},
+        {rttr::type::get<std::string>(), SnapshotValueKind::eString},
+        {rttr::type::get<glm::vec2>(), SnapshotValueKind::eVec2},
+        {rttr::type::get<glm::vec3>(), SnapshotValueKind::eVec3},
+        {rttr::type::get<glm::vec4>(), SnapshotValueKind::eVec4},
+    };
+    if (type.is_enumeration())
+    {
+        kind = SnapshotValueKind::eEnum;
+        return true;
+    }
+    for (const auto& [valueType, valueKind] : kinds)
+    {
+        if (valueType == type)
+        {
+            kind = valueKind;
+            return true;
+        }
+    }
+    return false;
+}
+
+// writable properties of the types above, nested classes flattened. Properties of other types are not saved
+void collectSnapshotProperties(const rttr::type& type, const std::string& prefix, std::vector<rttr::property>& path,
+                               std::vector<SnapshotProperty>& properties)
+{
+    for (const rttr::property& property : type.get_properties())
+    {
+        if (property.is_readonly()) continue;
+
+        const rttr::type  propertyType = property.get_type();
+        const std::string name         = prefix + property.get_name().to_string();
+        SnapshotValueKind kind         = SnapshotValueKind::eBool;
+        path.push_back(property);
+        if (getValueKind(propertyType, kind))
+        {
+            properties.push_back({name, path, kind});
+        }
+        else if (propertyType.is_class())
+        {
+            collectSnapshotProperties(propertyType, name + ".", path, properties);
+        }
+        path.pop_back();
+    }
+}
+
+std::vector<SnapshotProperty> getSnapshotProperties(const rttr::type& type)
+{
+    std::vector<SnapshotProperty> properties;
+    std::vector<rttr::property>   path;
+    collectSnapshotProperties(type, "", path, properties);
+    return properties;
+}
+
+rttr::variant getPropertyValue(const rttr::instance& instance, const std::vector<rttr::property>& path)
+{
+    rttr::variant value = path[0].get_value(instance);
+    for (size_t depth = 1; depth < path.size() && value.is_valid(); ++depth)
+    {
+        value = path[depth].get_value(value);
+    }
+    return value;
+}
+
+// a nested value is read out, changed and set back as a whole
+bool setPropertyValue(const rttr::instance& instance, const std::vector<rttr::property>& path, size_t depth, const rttr::variant& value)
+{
+    if (depth + 1 == path.size())
+    {
+        return path[depth].set_value(instance, value);
+    }
+    rttr::variant nested = path[depth].get_value(instance);
+    return nested.is_valid() && setPropertyValue(nested, path, depth + 1, value) && path[depth].set_value(instance, nested);
+}
+
+template <typename T>
+void storeValue(uint8_t* destination, const T& value)
+{
+    std::memcpy(destination, &value, sizeof(T));
+}
+
+template <typename T>
+T loadValue(const uint8_t* source)
+{
+    T value;
+    std::memcpy(&value, source, sizeof(T));
+    return value;
+}
+
+class SnapshotStringTable
+{
+public:
+    uint32_t add(const std::string& value)
+    {
+        const auto [entry, inserted] = _indices.try_emplace(value, static_cast<uint32_t>(_strings.size()));
+        if (inserted)
+        {
+            _strings.push_back(&entry->first);
+        }
+        return entry->second;
+    }
+
+    uint32_t size() const
+    {
+        return static_cast<uint32_t>(_strings.size());
+    }
+
+    void reserve(size_t count)
+    {
+        _indices.reserve(count);
+        _strings.reserve(count);
+    }
+
+    std::vector<uint8_t> encode() const
+    {
+        std::vector<uint32_t> offsets = {0};
+        for (const std::string* value : _strings)
+        {
+            offsets.push_back(offsets.back() + static_cast<uint32_t>(value->size()));
+        }
+
+        std::vector<uint8_t> data(offsets.size() * sizeof(uint32_t) + offsets.back());
+        std::memcpy(data.data(), offsets.data(), offsets.size() * sizeof(uint32_t));
+        uint8_t* characters = data.data() + offsets.size() * sizeof(uint32_t);
+        for (size_t index = 0; index < _strings.size(); ++index)
+        {
+            std::memcpy(characters + offsets[index], _strings[index]->data(), _strings[index]->size());
+        }
+        return data;
+    }
+
+private:
+    std::unordered_map<std::string, uint32_t> _indices;
+    std::vector<const std::string*>           _strings; // the keys of _indices in index order
+};
+
+// the string section of a mapped file, read in place
+class SnapshotStrings
+{
+public:
+    bool read(const uint8_t* data, uint64_t size, uint32_t count)
+    {
+        const uint64_t offsetBytes = (uint64_t(count) + 1) * sizeof(uint32_t);
+        if (size < offsetBytes) return false;
+
+        _offsets    = reinterpret_cast<const uint32_t*>(data);
+        _characters = reinterpret_cast<const char*>(data + offsetBytes);
+        _count      = count;
+        for (uint32_t index = 0; index < count; ++index)
+        {
+            if (_offsets[index] > _offsets[index + 1]) return false;
+        }
+        return _offsets[0] == 0 && _offsets[count] <= size - offsetBytes;
+    }
+
+    bool get(uint32_t index, std::string_view& value) const
+    {
+        if (index >= _count) return false;
+        value = std::string_view(_characters + _offsets[index], _offsets[index + 1] - _offsets[index]);
+        return true;
+    }
+
+private:
+    const uint32_t* _offsets    = nullptr;
+    const char*     _characters = nullptr;
+    uint32_t        _count      = 0;
+};
+
+void writeValue(uint8_t* destination, SnapshotValueKind kind, const rttr::variant& value, SnapshotStringTable& strings)
+{
+    switch (kind)
+    {
+        case SnapshotValueKind::eBool:
+            storeValue<uint8_t>(destination, value.get_value<bool>() ? 1 : 0);
+            break;
+        case SnapshotValueKind::eInt32:
+            storeValue(destination, value.get_value<int32_t>());
+            break;
+        case SnapshotValueKind::eUint32:
+            storeValue(destination, value.get_value<uint32_t>());
+            break;
+        case SnapshotValueKind::eInt64:
+            storeValue(destination, value.get_value<int64_t>());
+            break;
+        case SnapshotValueKind::eUint64:
+            storeValue(destination, value.get_value<uint64_t>());
+            break;
+        case SnapshotValueKind::eFloat:
+            storeValue(destination, value.get_value<float>());
+            break;
+        case SnapshotValueKind::eDouble:
+            storeValue(destination, value.get_value<double>());
+            break;
+        case SnapshotValueKind::eString:
+            storeValue(destination, strings.add(value.get_value<std::string>()));
+            break;
+        case SnapshotValueKind::eEnum:
+            storeValue(destination, strings.add(value.get_type().get_enumeration().value_to_name(value).to_string()));
+            break;
+        case SnapshotValueKind::eVec2:
+            storeValue(destination, value.get_value<glm::vec2>());
+            break;
+        case SnapshotValueKind::eVec3:
+            storeValue(destination, value.get_value<glm::vec3>());
+            break;
+        case SnapshotValueKind::eVec4:
+            storeValue(destination, value.get_value<glm::vec4>());
+            break;
+        default:
+            break;
+    }
+}
+
+// an invalid variant for a string index out of range or an enum value the type no longer has
+rttr::variant readValue(const uint8_t* source, SnapshotValueKind kind, const rttr::type& type, const SnapshotStrings& strings)
+{
+    std::string_view text;
+    switch (kind)
+    {
+        case SnapshotValueKind::eBool:
+            return loadValue<uint8_t>(source) != 0;
+        case SnapshotValueKind::eInt32:
+            return loadValue<int32_t>(source);
+        case SnapshotValueKind::eUint32:
+            return loadValue<uint32_t>(source);
+        case SnapshotValueKind::eInt64:
+            return loadValue<int64_t>(source);
+        case SnapshotValueKind::eUint64:
+            return loadValue<uint64_t>(source);
+        case SnapshotValueKind::eFloat:
+            return loadValue<float>(source);
+        case SnapshotValueKind::eDouble:
+            return loadValue<double>(source);
+        case SnapshotValueKind::eString:
+            return strings.get(loadValue<uint32_t>(source), text) ? rttr::variant(std::string(text)) : rttr::variant();
+        case SnapshotValueKind::eEnum:
+            if (!strings.get(loadValue<uint32_t>(source), text)) return rttr::variant();
+            return type.get_enumeration().name_to_value(rttr::string_view(text.data(), text.size()));
+        case SnapshotValueKind::eVec2:
+            return loadValue<glm::vec2>(source);
+        case SnapshotValueKind::eVec3:
+            return loadValue<glm::vec3>(source);
+        case SnapshotValueKind::eVec4:
+            return loadValue<glm::vec4>(source);
+        default:
+            return rttr::variant();
+    }
+}
+
+std::vector<uint8_t> encodeComponentGroup(const SceneSnapshotComponentGroup& group, SnapshotStringTable& strings)
+{
+    const std::vector<SnapshotProperty> properties = getSnapshotProperties(rttr::type::get_by_name(group.typeName));
+
+    SnapshotComponentHeader             header;
+    std::vector<SnapshotPropertyRecord> propertyRecords;
+    header.typeName   = strings.add(group.typeName);
+    header.recordSize = sizeof(uint32_t);
+    for (const SnapshotProperty& property : properties)
+    {
+        propertyRecords.push_back({strings.add(property.name), property.kind, header.recordSize});
+        header.recordSize += getValueSize(property.kind);
+    }
+    header.propertyCount = static_cast<uint32_t>(propertyRecords.size());
+
+    const size_t         tableSize = sizeof(header) + propertyRecords.size() * sizeof(SnapshotPropertyRecord);
+    std::vector<uint8_t> data(tableSize + group.components.size() * header.recordSize);
+    std::memcpy(data.data(), &header, sizeof(header));
+    std::memcpy(data.data() + sizeof(header), propertyRecords.data(), propertyRecords.size() * sizeof(SnapshotPropertyRecord));
+    for (size_t index = 0; index < group.components.size(); ++index)
+    {
+        uint8_t*             record = data.data() + tableSize + index * header.recordSize;
+        const rttr::instance instance(*group.components[index]);
+        storeValue(record, group.owners[index]);
+        for (size_t propertyIndex = 0; propertyIndex < properties.size(); ++propertyIndex)
+        {
+            const rttr::variant value = getPropertyValue(instance, properties[propertyIndex].path);
+            if (value.is_valid())
+            {
+                writeValue(record + propertyRecords[propertyIndex].offset, properties[propertyIndex].kind, value, strings);
+            }
+        }
+    }
+    return data;
+}
+
+// checks the table and the record layout, so decoding never reads out of the section
+bool validateComponentSection(const uint8_t* data, const SnapshotSection& section, uint32_t nodeCount)
+{
+    SnapshotComponentHeader header;
+    if (section.size < sizeof(header)) return false;
+    std::memcpy(&header, data, sizeof(header));
+
+    const uint64_t tableSize = sizeof(header) + uint64_t(header.propertyCount) * sizeof(SnapshotPropertyRecord);
+    if (header.recordSize < sizeof(uint32_t) || tableSize > section.size || section.size - tableSize != uint64_t(section.count) * header.recordSize)
+    {
+        return false;
+    }
+    const SnapshotPropertyRecord* properties = reinterpret_cast<const SnapshotPropertyRecord*>(data + sizeof(header));
+    for (uint32_t index = 0; index < header.propertyCount; ++index)
+    {
+        const SnapshotPropertyRecord& property = properties[index];
+        if (property.kind >= SnapshotValueKind::eCount || property.offset < sizeof(uint32_t) ||
+            uint64_t(property.offset) + getValueSize(property.kind) > header.recordSize)
+        {
+            return false;
+        }
+    }
+    for (uint32_t index = 0; index < section.count; ++index)
+    {
+        if (loadValue<uint32_t>(data + tableSize + uint64_t(index) * header.recordSize) >= nodeCount) return false;
+    }
+    return true;
+}
+
+uint32_t decodeComponentSection(CpuScene& scene, const uint8_t* data, const SnapshotSection& section, const SnapshotStrings& strings)
+{
+    SnapshotComponentHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    std::string_view typeName;
+    strings.get(header.typeName, typeName);
+    const SnapshotComponentType* componentType = findSnapshotComponentType(typeName);
+    if (!componentType)
+    {
+        LOGW("Scene snapshot components of unknown type %.*s are skipped\n", static_cast<int>(typeName.size()), typeName.data());
+        return 0;
+    }
+
+    // saved properties the type no longer has, or has with another type, are skipped
+    const std::vector<SnapshotProperty> properties = getSnapshotProperties(componentType->type);
+    const SnapshotPropertyRecord*       records    = reinterpret_cast<const SnapshotPropertyRecord*>(data + sizeof(header));
+    std::vector<std::pair<const SnapshotPropertyRecord*, const SnapshotProperty*>> matches;
+    for (uint32_t index = 0; index < header.propertyCount; ++index)
+    {
+        std::string_view name;
+        strings.get(records[index].name, name);
+        for (const SnapshotProperty& property : properties)
+        {
+            if (property.name == name && property.kind == records[index].kind)
+            {
+                matches.emplace_back(&records[index], &property);
+                break;
+            }
+        }
+    }
+
+    componentType->reserve(scene, section.count);
+    const uint8_t* componentRecords = data + sizeof(header) + uint64_t(header.propertyCount) * sizeof(SnapshotPropertyRecord);
+    for (uint32_t index = 0; index < section.count; ++index)
+    {
+        const uint8_t*     record    = componentRecords + uint64_t(index) * header.recordSize;
+        CpuSceneComponent* component = componentType->add(scene, {loadValue<uint32_t>(record), 1});
+        if (!component) continue;
+
+        const rttr::instance instance(*component);
+        for (const auto& [propertyRecord, property] : matches)
+        {
+            const rttr::variant value = readValue(record + propertyRecord->offset, property->kind, property->path.back().get_type(), strings);
+            if (value.is_valid())
+            {
+                setPropertyValue(instance, property->path, 0, value);
+            }
+        }
+    }
+    return section.count;
+}
+} // namespace
+
+SceneSnapshot captureSceneSnapshot(const CpuScene& scene)
+{
+    const std::vector<CpuSceneNode>& nodes = scene.getNodes();
+
+    SceneSnapshot               snapshot;
+    std::vector<uint32_t>       snapshotIndices(nodes.size(), INVALID_SCENE_ID);
+    std::vector<CpuSceneNodeID> stack = {scene.rootNode()};
+    snapshot.nodes.reserve(nodes.size());
+    // children are pushed in list order and so visited last first
+    while (!stack.empty())
+    {
+        const CpuSceneNodeID nodeID = stack.back();
+        const CpuSceneNode*  node   = scene.getNode(nodeID);
+        stack.pop_back();
+        if (!node)
+        {
+            continue;
+        }
+
+        snapshotIndices[nodeID.index] = static_cast<uint32_t>(snapshot.nodes.size());
+        SceneSnapshotNode& entry      = snapshot.nodes.emplace_back();
+        entry.parent                  = node->parent.isValid() ? snapshotIndices[node->parent.index] : INVALID_SCENE_ID;
+        entry.type                    = node->type;
+        entry.visible                 = node->visible;
+        entry.local                   = node->local;
+        entry.localTransform          = node->localTransform;
+        entry.name                    = node->name;
+        for (CpuSceneNodeID childID = node->firstChild; scene.isValid(childID); childID = nodes[childID.index].nextSibling)
+        {
+            stack.push_back(childID);
+        }
+    }
+
+    for (const SnapshotComponentType& componentType : getSnapshotComponentTypes())
+    {
+        SceneSnapshotComponentGroup& group = snapshot.componentGroups.emplace_back();
+        group.typeName                     = componentType.type.get_name().to_string();
+        componentType.capture(scene, snapshotIndices, group);
+    }
+    return snapshot;
+}
+
+std::vector<uint8_t> encodeSceneSnapshot(const SceneSnapshot& snapshot)
+{
+    SnapshotStringTable             strings;
+    std::vector<SnapshotNodeRecord> nodeRecords(snapshot.nodes.size());
+    strings.reserve(snapshot.nodes.size());
+    for (size_t index = 0; index < snapshot.nodes.size(); ++index)
+    {
+        const SceneSnapshotNode& node   = snapshot.nodes[index];
+        SnapshotNodeRecord&      record = nodeRecords[index];
+        record.parent                   = node.parent;
+        record.name                     = strings.add(node.name);
+        record.type                     = static_cast<uint32_t>(node.type);
+        record.flags                    = node.visible ? kNodeVisibleFlag : 0;
+        record.translation              = node.local.translation;
+        record.rotation                 = node.local.rotation;
+        record.scale                    = node.local.scale;
+        record.localTransform           = node.localTransform;
+    }
+
+    struct PendingSection
+    {
+        SnapshotSectionKind kind;
+        uint32_t            count;
+        const void*         data;
+        uint64_t            size;
+    };
+    std::vector<PendingSection>       pending = {{SnapshotSectionKind::eNodes, static_cast<uint32_t>(nodeRecords.size()), nodeRecords.data(),
+                                                  nodeRecords.size() * sizeof(SnapshotNodeRecord)}};
+    std::vector<std::vector<uint8_t>> componentData;
+    componentData.reserve(snapshot.componentGroups.size());
+    for (const SceneSnapshotComponentGroup& group : snapshot.componentGroups)
+    {
+        if (group.components.empty()) continue;
+        const std::vector<uint8_t>& data = componentData.emplace_back(encodeComponentGroup(group, strings));
+        pending.push_back({SnapshotSectionKind::eComponents, static_cast<uint32_t>(group.components.size()), data.data(), data.size()});
+    }
+    // last, every other section has added its strings by now
+    const std::vector<uint8_t> stringData = strings.encode();
+    pending.push_back({SnapshotSectionKind::eStrings, strings.size(), stringData.data(), stringData.size()});
+
+    SnapshotHeader               header;
+    std::vector<SnapshotSection> sections;
+    uint64_t                     offset = alignSection(sizeof(header) + pending.size() * sizeof(SnapshotSection));
+    header.sectionCount                 = static_cast<uint32_t>(pending.size());
+    for (const PendingSection& section : pending)
+    {
+        sections.push_back({section.kind, section.count, offset, section.size});
+        offset = alignSection(offset + section.size);
+    }
+
+    std::vector<uint8_t> bytes(offset);
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    std::memcpy(bytes.data() + sizeof(header), sections.data(), sections.size() * sizeof(SnapshotSection));
+    for (size_t index = 0; index < pending.size(); ++index)
+    {
+        if (pending[index].size == 0) continue;
+        std::memcpy(bytes.data() + sections[index].offset, pending[index].data, pending[index].size);
+    }
+    return bytes;
+}
+
+SceneSnapshotResult writeSceneSnapshot(const SceneSnapshot& snapshot, const std::filesystem::path& path)
+{
+    const Clock::time_point    start = Clock::now();
+    const std::vector<uint8_t> bytes = encodeSceneSnapshot(snapshot);
+
+    SceneSnapshotResult result;
+    std::error_code     ec;
+    if (path.has_parent_path())
+    {
+        std::filesystem::create_directories(path.parent_path(), ec);
+    }
+    // a reader never sees a half written snapshot
+    std::filesystem::path tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open() || !file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size())))
+        {
+            LOGE("Failed to write scene snapshot: %s\n", nvutils::utf8FromPath(tempPath).c_str());
+            return result;
+        }
+    }
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec)
+    {
+        LOGE("Failed to replace scene snapshot: %s\n", nvutils::utf8FromPath(path).c_str());
+        std::filesystem::remove(tempPath, ec);
+        return result;
+    }
+
+    result.succeeded = true;
+    result.nodes     = static_cast<uint32_t>(snapshot.nodes.size());
+    for (const SceneSnapshotComponentGroup& group : snapshot.componentGroups)
+    {
+        result.components += static_cast<uint32_t>(group.components.size());
+    }
+    result.bytes = bytes.size();
+    result.ms    = elapsedMs(start);
+    return result;
+}
+
+SceneSnapshotResult loadSceneSnapshot(CpuScene& scene, const std::filesystem::path& path)
+{
+    const Clock::time_point  start = Clock::now();
+    SceneSnapshotResult      result;
+    nvutils::FileReadMapping mapping;
+    if (!mapping.open(path))
+    {
+        LOGE("Failed to map scene snapshot: %s\n", nvutils::utf8FromPath(path).c_str());
+        return result;
+    }
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(mapping.data());
+    const uint64_t size  = mapping.size();
+    SnapshotHeader header;
+    if (size >= sizeof(header))
+    {
+        std::memcpy(&header, bytes, sizeof(header));
+    }
+    if (size < sizeof(header) || header.magic != kSnapshotMagic || header.version != SCENE_SNAPSHOT_FORMAT_VERSION ||
+        sizeof(header) + uint64_t(header.sectionCount) * sizeof(SnapshotSection) > size)
+    {
+        LOGE("Scene snapshot %s is not a version %u snapshot\n", nvutils::utf8FromPath(path).c_str(), SCENE_SNAPSHOT_FORMAT_VERSION);
+        return result;
+    }
+
+    const SnapshotSection*              sections      = reinterpret_cast<const SnapshotSection*>(bytes + sizeof(header));
+    const SnapshotSection*              nodeSection   = nullptr;
+    const SnapshotSection*              stringSection = nullptr;
+    bool                                valid         = true;
+    std::vector<const SnapshotSection*> componentSections;
+    for (uint32_t index = 0; index < header.sectionCount && valid; ++index)
+    {
+        const SnapshotSection& section = sections[index];
+        valid = section.offset % kSectionAlignment == 0 && section.offset <= size && section.size <= size - section.offset;
+        if (section.kind == SnapshotSectionKind::eNodes)
+        {
+            nodeSection = &section;
+        }
+        else if (section.kind == SnapshotSectionKind::eStrings)
+        {
+            stringSection = &section;
+        }
+        else if (section.kind == SnapshotSectionKind::eComponents)
+        {
+            componentSections.push_back(&section);
+        }
+    }
+
+    SnapshotStrings strings;
+    valid = valid && nodeSection && stringSection && nodeSection->count > 0 &&
+            nodeSection->size == uint64_t(nodeSection->count) * sizeof(SnapshotNodeRecord) &&
+            strings.read(bytes + stringSection->offset, stringSection->size, stringSection->count);
+
+    // parents come first, so every link points backwards
+    const SnapshotNodeRecord* nodeRecords = valid ? reinterpret_cast<const SnapshotNodeRecord*>(bytes + nodeSection->offset) : nullptr;
+    std::string_view          name;
+    for (uint32_t index = 0; valid && index < nodeSection->count; ++index)
+    {
+        valid = (index == 0 || nodeRecords[index].parent < index) && strings.get(nodeRecords[index].name, name);
+    }
+    for (size_t index = 0; valid && index < componentSections.size(); ++index)
+    {
+        valid = validateComponentSection(bytes + componentSections[index]->offset, *componentSections[index], nodeSection->count);
+    }
+    if (!valid)
+    {
+        LOGE("Scene snapshot %s is truncated or corrupt\n", nvutils::utf8FromPath(path).c_str());
+        return result;
+    }
+
+    std::vector<CpuSceneNode> nodes;
+    nodes.reserve(nodeSection->count);
+    for (uint32_t index = 0; index < nodeSection->count; ++index)
+    {
+        const SnapshotNodeRecord& record = nodeRecords[index];
+        CpuSceneNode&             node   = nodes.emplace_back();
+        strings.get(record.name, name);
+        node.name              = name;
+        node.type              = static_cast<CpuSceneNodeType>(record.type);
+        node.parent.index      = record.parent;
+        node.visible           = (record.flags & kNodeVisibleFlag) != 0;
+        node.local.translation = record.translation;
+        node.local.rotation    = record.rotation;
+        node.local.scale       = record.scale;
+        node.localTransform    = record.localTransform;
+    }
+    scene.replaceNodes(std::move(nodes));
+
+    for (const SnapshotSection* section : componentSections)
+    {
+        result.components += decodeComponentSection(scene, bytes + section->offset, *section, strings);
+    }
+    result.succeeded = true;
+    result.nodes     = nodeSection->count;
+    result.bytes     = size;
+    result.ms        = elapsedMs(start);
+    return result;
+}
+
+} // namespace Play
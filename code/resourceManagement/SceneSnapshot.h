@@ -0,0 +1,59 @@
+#ifndef SCENE_SNAPSHOT_H
+#define SCENE_SNAPSHOT_H
+#include "CpuScene.h"
+#include <filesystem>
+#include <memory>
+namespace Play
+{
+// bump when a section layout changes, files of an older version are refused
+const uint32_t SCENE_SNAPSHOT_FORMAT_VERSION = 1;
+
+struct SceneSnapshotNode
+{
+    uint32_t              parent         = INVALID_SCENE_ID; // snapshot index, parents come before their children
+    CpuSceneNodeType      type           = CpuSceneNodeType::eNode3D;
+    bool                  visible        = true;
+    CpuSceneNodeTransform local;
+    glm::mat4             localTransform = glm::mat4(1.0f);
+    std::string           name;
+};
+
+// copies of the components of one type, saved through their reflected properties
+struct SceneSnapshotComponentGroup
+{
+    std::string                                     typeName;
+    std::vector<uint32_t>                           owners; // snapshot indices of the nodes
+    std::vector<std::unique_ptr<CpuSceneComponent>> components;
+};
+
+// the part of a scene a file keeps, copied out so encoding and writing need neither the scene nor its lock. Nodes are
+// in depth first order from the root with siblings last first, loading prepends each child and so restores the order
+struct SceneSnapshot
+{
+    std::vector<SceneSnapshotNode>           nodes;
+    std::vector<SceneSnapshotComponentGroup> componentGroups;
+};
+
+struct SceneSnapshotResult
+{
+    bool     succeeded  = false;
+    uint32_t nodes      = 0;
+    uint32_t components = 0;
+    uint64_t bytes      = 0;
+    float    ms         = 0.0f;
+};
+
+// copies the live nodes and the components of the snapshot component types, for the thread holding the scene
+SceneSnapshot captureSceneSnapshot(const CpuScene& scene);
+// the whole file: header, section table and the string, node and component sections at 16 byte aligned offsets. Node
+// records and component records have a fixed size each, so a mapped file is read in place
+std::vector<uint8_t> encodeSceneSnapshot(const SceneSnapshot& snapshot);
+// encodes the snapshot and writes it beside the target before renaming it over, safe on any thread
+SceneSnapshotResult writeSceneSnapshot(const SceneSnapshot& snapshot, const std::filesystem::path& path);
+// replaces the scene with the one in the file, which is validated before the scene is touched. Components come back
+// with their saved properties and without their runtime state, models have to be requested again
+SceneSnapshotResult loadSceneSnapshot(CpuScene& scene, const std::filesystem::path& path);
+
+} // namespace Play
+
+#endif // SCENE_SNAPSHOT_H
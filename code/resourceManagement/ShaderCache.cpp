@@ -0,0 +1,366 @@
+#include "ShaderCache.h"
+#include <fstream>
+#include <regex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <nvutils/hash_operations.hpp>
+#include <nvutils/logger.hpp>
+
+namespace
+{
+std::filesystem::path tryResolvePath(const std::filesystem::path& path)
+{
+    if (path.empty())
+    {
+        return {};
+    }
+
+    std::error_code ec;
+    if (std::filesystem::exists(path, ec) && !ec)
+    {
+        return Play::normalizeShaderPath(path);
+    }
+
+    return {};
+}
+
+void writeString(Play::BufferStream& stream, const std::string& value)
+{
+    stream.write(static_cast<uint32_t>(value.size()));
+    stream.write(value.data(), value.size());
+}
+
+bool readString(Play::BufferStream& stream, std::string& value)
+{
+    uint32_t length = 0;
+    if (!stream.read(length)) return false;
+    value.resize(length);
+    return stream.read(value.data(), length);
+}
+
+bool readFile(const std::filesystem::path& path, std::vector<uint8_t>& data)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    const std::streamsize size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    data.resize(static_cast<size_t>(size));
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()), size));
+}
+} // namespace
+
+namespace Play
+{
+
+std::filesystem::path normalizeShaderPath(const std::filesystem::path& path)
+{
+    std::error_code ec;
+    const auto      absolutePath = std::filesystem::absolute(path, ec);
+    return (ec ? path : absolutePath).lexically_normal();
+}
+
+std::filesystem::path resolveShaderPath(const std::filesystem::path& requestedPath, const std::vector<std::filesystem::path>& searchPaths,
+                                        const std::filesystem::path* localDirectory, bool allowRecursiveFilenameFallback)
+{
+    if (requestedPath.empty())
+    {
+        return {};
+    }
+
+    if (localDirectory != nullptr)
+    {
+        if (auto resolvedPath = tryResolvePath(*localDirectory / requestedPath); !resolvedPath.empty())
+        {
+            return resolvedPath;
+        }
+    }
+
+    if (auto resolvedPath = tryResolvePath(requestedPath); !resolvedPath.empty())
+    {
+        return resolvedPath;
+    }
+
+    for (const auto& searchPath : searchPaths)
+    {
+        if (auto resolvedPath = tryResolvePath(searchPath / requestedPath); !resolvedPath.empty())
+        {
+            return resolvedPath;
+        }
+    }
+
+    if (!allowRecursiveFilenameFallback || requestedPath.has_parent_path())
+    {
+        return {};
+    }
+
+    const std::filesystem::path targetFilename = requestedPath.filename();
+    for (const auto& searchPath : searchPaths)
+    {
+        std::error_code ec;
+        for (std::filesystem::recursive_directory_iterator it(searchPath, ec), end; !ec && it != end; it.increment(ec))
+        {
+            if (!it->is_regular_file())
+            {
+                continue;
+            }
+
+            if (it->path().filename() == targetFilename)
+            {
+                return normalizeShaderPath(it->path());
+            }
+        }
+    }
+
+    return {};
+}
+
+void ShaderCacheManifest::write(BufferStream& stream) const
+{
+    stream.write(SHADER_CACHE_FORMAT_VERSION);
+    stream.write(contentKey);
+    stream.write(static_cast<uint32_t>(dependencies.size()));
+    for (const ShaderDependency& dependency : dependencies)
+    {
+        writeString(stream, dependency.path);
+        stream.write(dependency.writeTime);
+        stream.write(dependency.size);
+        stream.write(dependency.contentHash);
+    }
+}
+
+bool ShaderCacheManifest::read(BufferStream& stream)
+{
+    uint32_t version = 0;
+    uint32_t count   = 0;
+    if (!stream.read(version) || version != SHADER_CACHE_FORMAT_VERSION || !stream.read(contentKey) || !stream.read(count))
+    {
+        return false;
+    }
+    dependencies.resize(count);
+    for (ShaderDependency& dependency : dependencies)
+    {
+        if (!readString(stream, dependency.path) || !stream.read(dependency.writeTime) || !stream.read(dependency.size) ||
+            !stream.read(dependency.contentHash))
+        {
+            return false;
+        }
+    }
+    return !dependencies.empty();
+}
+
+ShaderCache::ShaderCache(std::filesystem::path root, std::string compilerVersion)
+    : _root(std::move(root)), _compilerVersion(std::move(compilerVersion))
+{
+    std::error_code ec;
+    std::filesystem::create_directories(_root, ec);
+}
+
+void ShaderCache::setSearchPaths(const std::vector<std::filesystem::path>& searchPaths)
+{
+    _searchPaths = searchPaths;
+}
+
+uint64_t ShaderCache::getRequestKey(const ShaderLoadRequest& request, const std::filesystem::path& resolvedPath) const
+{
+    uint64_t key = 0;
+    nvutils::hashCombine(key, resolvedPath.generic_string());
+    nvutils::hashCombine(key, request.entry);
+    nvutils::hashCombine(key, static_cast<uint32_t>(request.stage));
+    nvutils::hashCombine(key, static_cast<uint32_t>(request.type));
+    for (const auto& [name, value] : request.defines)
+    {
+        nvutils::hashCombine(key, name);
+        nvutils::hashCombine(key, value);
+    }
+    nvutils::hashCombine(key, _compilerVersion);
+    return key;
+}
+
+bool ShaderCache::validate(uint64_t requestKey, ShaderCacheManifest& manifest, bool& refreshed) const
+{
+    refreshed = false;
+    std::vector<uint8_t> data;
+    if (!readFile(getManifestPath(requestKey), data))
+    {
+        return false;
+    }
+    BufferStream stream(std::move(data));
+    if (!manifest.read(stream))
+    {
+        return false;
+    }
+
+    for (ShaderDependency& dependency : manifest.dependencies)
+    {
+        ShaderDependency current;
+        if (!describeFile(dependency.path, current, nullptr))
+        {
+            return false;
+        }
+        if (current.writeTime == dependency.writeTime && current.size == dependency.size)
+        {
+            continue;
+        }
+        // touched, maybe only saved again. The contents decide
+        std::string contents;
+        if (!describeFile(dependency.path, current, &contents) || current.contentHash != dependency.contentHash)
+        {
+            return false;
+        }
+        dependency.writeTime = current.writeTime;
+        dependency.size      = current.size;
+        refreshed            = true;
+    }
+    return manifest.contentKey == getContentKey(requestKey, manifest.dependencies);
+}
+
+bool ShaderCache::scanDependencies(uint64_t requestKey, const std::filesystem::path& resolvedPath, ShaderCacheManifest& manifest) const
+{
+    static const std::regex includeRegex(R"(#include\s*["<](.*)[">])");
+
+    manifest.dependencies.clear();
+    std::set<std::filesystem::path>    visited;
+    std::vector<std::filesystem::path> toProcess{resolvedPath};
+    while (!toProcess.empty())
+    {
+        const std::filesystem::path curFile = toProcess.back();
+        toProcess.pop_back();
+        if (!visited.insert(curFile).second) continue;
+
+        ShaderDependency dependency;
+        std::string      contents;
+        if (!describeFile(curFile, dependency, &contents))
+        {
+            // the main source vanished. A missing include is the compiler's to report
+            if (curFile == resolvedPath) return false;
+            continue;
+        }
+        manifest.dependencies.push_back(dependency);
+
+        const std::filesystem::path currentDirectory = curFile.parent_path();
+        std::istringstream          lines(contents);
+        std::string                 line;
+        while (std::getline(lines, line))
+        {
+            std::smatch match;
+            if (!std::regex_search(line, match, includeRegex)) continue;
+            const std::string incFile = match[1].str();
+            if (incFile.empty()) continue;
+
+            std::filesystem::path incRealPath = resolveShaderPath(incFile, _searchPaths, &currentDirectory, false);
+            if (!incRealPath.empty())
+            {
+                toProcess.push_back(incRealPath);
+            }
+        }
+    }
+    manifest.contentKey = getContentKey(requestKey, manifest.dependencies);
+    return true;
+}
+
+bool ShaderCache::loadSpirv(uint64_t contentKey, std::vector<uint32_t>& spirv) const
+{
+    std::vector<uint8_t> data;
+    if (!readFile(getSpirvPath(contentKey), data) || data.empty() || data.size() % sizeof(uint32_t) != 0)
+    {
+        return false;
+    }
+    spirv.resize(data.size() / sizeof(uint32_t));
+    std::memcpy(spirv.data(), data.data(), data.size());
+    return true;
+}
+
+void ShaderCache::storeSpirv(uint64_t contentKey, const std::vector<uint32_t>& spirv) const
+{
+    if (!writeFile(getSpirvPath(contentKey), spirv.data(), spirv.size() * sizeof(uint32_t)))
+    {
+        LOGW("Failed to store SPIR-V %016llx in the shader cache\n", static_cast<unsigned long long>(contentKey));
+    }
+}
+
+void ShaderCache::storeManifest(uint64_t requestKey, const ShaderCacheManifest& manifest) const
+{
+    BufferStream stream;
+    manifest.write(stream);
+    if (!writeFile(getManifestPath(requestKey), stream.getRawData().data(), stream.getRawData().size()))
+    {
+        LOGW("Failed to store shader manifest %016llx\n", static_cast<unsigned long long>(requestKey));
+    }
+}
+
+std::filesystem::path ShaderCache::getSpirvPath(uint64_t contentKey) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.spv", static_cast<unsigned long long>(contentKey));
+    return _root / name;
+}
+
+std::filesystem::path ShaderCache::getManifestPath(uint64_t requestKey) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.dep", static_cast<unsigned long long>(requestKey));
+    return _root / name;
+}
+
+uint64_t ShaderCache::getContentKey(uint64_t requestKey, const std::vector<ShaderDependency>& dependencies)
+{
+    uint64_t key = requestKey;
+    for (const ShaderDependency& dependency : dependencies)
+    {
+        nvutils::hashCombine(key, dependency.contentHash);
+    }
+    return key;
+}
+
+bool ShaderCache::describeFile(const std::filesystem::path& path, ShaderDependency& dependency, std::string* contents)
+{
+    std::error_code ec;
+    const auto      writeTime = std::filesystem::last_write_time(path, ec);
+    if (ec) return false;
+    const auto size = std::filesystem::file_size(path, ec);
+    if (ec) return false;
+
+    dependency.path      = path.string();
+    dependency.writeTime = static_cast<int64_t>(writeTime.time_since_epoch().count());
+    dependency.size      = static_cast<uint64_t>(size);
+    if (contents == nullptr)
+    {
+        return true;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    contents->assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    dependency.contentHash = std::hash<std::string>{}(*contents);
+    return true;
+}
+
+bool ShaderCache::writeFile(const std::filesystem::path& path, const void* data, size_t size)
+{
+    std::ostringstream tempName;
+    tempName << path.filename().string() << "." << std::this_thread::get_id() << ".tmp";
+    const std::filesystem::path tempPath = path.parent_path() / tempName.str();
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open() || !file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size)))
+        {
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec)
+    {
+        // the other writer won, its file has the same contents
+        std::filesystem::remove(tempPath, ec);
+        return std::filesystem::exists(path, ec);
+    }
+    return true;
+}
+
+} // namespace Play
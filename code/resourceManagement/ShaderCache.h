@@ -0,0 +1,87 @@
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+#include "ShaderManager.hpp"
+#include "core/DataWriter.h"
+namespace Play
+{
+// bump when the compiler options change, entries built with the old ones are not reused
+const uint32_t SHADER_CACHE_FORMAT_VERSION = 1;
+
+std::filesystem::path normalizeShaderPath(const std::filesystem::path& path);
+// the source a request or an #include names: next to the including file, as given, then under the search paths
+std::filesystem::path resolveShaderPath(const std::filesystem::path& requestedPath, const std::vector<std::filesystem::path>& searchPaths,
+                                        const std::filesystem::path* localDirectory, bool allowRecursiveFilenameFallback);
+
+// compilers of one thread for one set of defines, neither compiler is safe to share between threads
+struct ShaderCompilerContext
+{
+    nvslang::SlangCompiler slangCompiler;
+    nvvkglsl::GlslCompiler glslCompiler;
+    ShaderDefines          defines; // the slang macro options point into these strings
+};
+
+// a source file a cache entry was built from, as it was at the time
+struct ShaderDependency
+{
+    std::string path;
+    int64_t     writeTime   = 0;
+    uint64_t    size        = 0;
+    uint64_t    contentHash = 0;
+};
+
+struct ShaderCacheManifest
+{
+    uint64_t                      contentKey = 0;
+    std::vector<ShaderDependency> dependencies; // the main source first, then its includes as they resolved
+
+    void write(BufferStream& stream) const;
+    bool read(BufferStream& stream);
+};
+
+// SPIR-V under spv/ named by a hash of everything it was built from: sources, resolved includes, entry point, stage,
+// defines and compiler version. A manifest per request remembers the sources, so a warm start checks their stats
+// instead of parsing them again
+class ShaderCache
+{
+public:
+    ShaderCache(std::filesystem::path root, std::string compilerVersion);
+    void setSearchPaths(const std::vector<std::filesystem::path>& searchPaths);
+
+    const std::filesystem::path& getRoot() const
+    {
+        return _root;
+    }
+
+    const std::string& getCompilerVersion() const
+    {
+        return _compilerVersion;
+    }
+
+    // everything but the sources, names the manifest
+    uint64_t getRequestKey(const ShaderLoadRequest& request, const std::filesystem::path& resolvedPath) const;
+    // false if there is no manifest or a source changed. Sources whose stats moved are hashed again, refreshed is set when
+    // they turned out unchanged and the manifest wants to be stored again
+    bool validate(uint64_t requestKey, ShaderCacheManifest& manifest, bool& refreshed) const;
+    // follows the includes of the source once and hashes every file on the way
+    bool scanDependencies(uint64_t requestKey, const std::filesystem::path& resolvedPath, ShaderCacheManifest& manifest) const;
+
+    bool loadSpirv(uint64_t contentKey, std::vector<uint32_t>& spirv) const;
+    void storeSpirv(uint64_t contentKey, const std::vector<uint32_t>& spirv) const;
+    void storeManifest(uint64_t requestKey, const ShaderCacheManifest& manifest) const;
+
+private:
+    std::filesystem::path getSpirvPath(uint64_t contentKey) const;
+    std::filesystem::path getManifestPath(uint64_t requestKey) const;
+    static uint64_t       getContentKey(uint64_t requestKey, const std::vector<ShaderDependency>& dependencies);
+    static bool           describeFile(const std::filesystem::path& path, ShaderDependency& dependency, std::string* contents);
+    // written beside the target and renamed over it, workers storing the same entry do not see each other half done
+    static bool           writeFile(const std::filesystem::path& path, const void* data, size_t size);
+
+    std::filesystem::path              _root;
+    std::string                        _compilerVersion;
+    std::vector<std::filesystem::path> _searchPaths;
+};
+
+} // namespace Play
+
+#endif // SHADER_CACHE_H
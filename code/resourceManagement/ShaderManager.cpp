@@ -1,95 +1,21 @@
 #include "ShaderManager.hpp"
-#include <regex>
+#include "ShaderCache.h"
+#include "ShaderWatcher.h"
+#include "ShaderPermutation.h"
+#include "PipelineCacheManager.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <set>
+#include <thread>
+#include <unordered_set>
+#include <nvutils/hash_operations.hpp>
 #include "utils.hpp"
 #include "core/runtime/VulkanRuntime.h"
 #include "nvvk/check_error.hpp"
 #include "nvvk/debug_util.hpp"
 #include "nvaftermath/aftermath.hpp"
 
-namespace
-{
-std::filesystem::path normalizePath(const std::filesystem::path& path)
-{
-    std::error_code ec;
-    const auto      absolutePath = std::filesystem::absolute(path, ec);
-    return (ec ? path : absolutePath).lexically_normal();
-}
-
-std::filesystem::path tryResolvePath(const std::filesystem::path& path)
-{
-    if (path.empty())
-    {
-        return {};
-    }
-
-    std::error_code ec;
-    if (std::filesystem::exists(path, ec) && !ec)
-    {
-        return normalizePath(path);
-    }
-
-    return {};
-}
-
-std::filesystem::path resolveShaderPath(const std::filesystem::path&              requestedPath,
-                                        const std::vector<std::filesystem::path>& searchPaths,
-                                        const std::filesystem::path*              localDirectory,
-                                        bool                                      allowRecursiveFilenameFallback)
-{
-    if (requestedPath.empty())
-    {
-        return {};
-    }
-
-    if (localDirectory != nullptr)
-    {
-        if (auto resolvedPath = tryResolvePath(*localDirectory / requestedPath); !resolvedPath.empty())
-        {
-            return resolvedPath;
-        }
-    }
-
-    if (auto resolvedPath = tryResolvePath(requestedPath); !resolvedPath.empty())
-    {
-        return resolvedPath;
-    }
-
-    for (const auto& searchPath : searchPaths)
-    {
-        if (auto resolvedPath = tryResolvePath(searchPath / requestedPath); !resolvedPath.empty())
-        {
-            return resolvedPath;
-        }
-    }
-
-    if (!allowRecursiveFilenameFallback || requestedPath.has_parent_path())
-    {
-        return {};
-    }
-
-    const std::filesystem::path targetFilename = requestedPath.filename();
-    for (const auto& searchPath : searchPaths)
-    {
-        std::error_code ec;
-        for (std::filesystem::recursive_directory_iterator it(searchPath, ec), end; !ec && it != end; it.increment(ec))
-        {
-            if (!it->is_regular_file())
-            {
-                continue;
-            }
-
-            if (it->path().filename() == targetFilename)
-            {
-                return normalizePath(it->path());
-            }
-        }
-    }
-
-    return {};
-}
-} // namespace
-
 namespace Play
 {
 
@@ -120,6 +46,9 @@ void ShaderPool::free(uint32_t id)
     _objs[id]->_poolId              = -1;
 }
 
+ShaderManager::ShaderManager()  = default;
+ShaderManager::~ShaderManager() = default;
+
 void ShaderManager::init()
 {
     _shaderPool.init(MaxShaderModules, &PlayResourceManager::Instance());
@@ -131,7 +60,7 @@ void ShaderManager::init()
 
     auto appendSearchPath = [this](const std::filesystem::path& path)
     {
-        std::filesystem::path normalizedPath = normalizePath(path);
+        std::filesystem::path normalizedPath = normalizeShaderPath(path);
         if (!std::filesystem::exists(normalizedPath))
         {
             return;
@@ -159,7 +88,7 @@ void ShaderManager::init()
         {
             if (entry.is_directory())
             {
-                newShaderDirectories.insert(normalizePath(entry.path()));
+                newShaderDirectories.insert(normalizeShaderPath(entry.path()));
             }
         }
 
@@ -172,38 +101,41 @@ void ShaderManager::init()
     appendSearchPath(projectBasePath / "External/nvpro_core2/nvshaders");
     appendSearchPath(projectBasePath / "External/nvpro_core2");
     appendSearchPath(projectBasePath / "code/resourceManagement");
-    _glslCCompiler.addSearchPaths(_searchPaths);
-    _glslCCompiler.defaultOptions();
-    _glslCCompiler.defaultTarget();
-    _glslCCompiler.options().SetGenerateDebugInfo();
-    _glslCCompiler.options().SetOptimizationLevel(shaderc_optimization_level_performance);
-    _glslCCompiler.options().AddMacroDefinition("GLSL");
-    _slangCompiler.defaultOptions();
-    _slangCompiler.defaultTarget();
-    _slangCompiler.addSearchPaths(_searchPaths);
-    _slangCompiler.addOption({slang::CompilerOptionName::DebugInformation, {slang::CompilerOptionValueKind::Int, SLANG_DEBUG_INFO_LEVEL_MAXIMAL}});
 
-#if defined(AFTERMATH_AVAILABLE)
-    // This aftermath callback is used to report the shader hash (Spirv) to the Aftermath library.
-    _slangCompiler.setCompileCallback(
-        [&](const std::filesystem::path& sourceFile, const uint32_t* spirvCode, size_t spirvSize)
-        {
-            std::span<const uint32_t> data(spirvCode, spirvSize / sizeof(uint32_t));
-            AftermathCrashTracker::getInstance().addShaderBinary(data);
-        });
-#endif
+    unsigned int spvVersion  = 0;
+    unsigned int spvRevision = 0;
+    shaderc_get_spv_version(&spvVersion, &spvRevision);
+    const std::string compilerVersion = std::string("slang ") + spGetBuildTagString() + ", shaderc spv " + std::to_string(spvVersion) + "." +
+                                        std::to_string(spvRevision) + ", cache " + std::to_string(SHADER_CACHE_FORMAT_VERSION);
+    _cache = std::make_unique<ShaderCache>(getBaseFilePath() / "spv", compilerVersion);
+    _cache->setSearchPaths(_searchPaths);
+    _compilerContexts.clear();
     registBuiltInShader();
 }
 
 void ShaderManager::registBuiltInShader()
 {
-    loadShaderFromFile(BuiltinShaders::BUILTIN_FULL_SCREEN_QUAD_VERT_SHADER_NAME, "newShaders/deferRenderer/common/builtin_full_screen.vert.slang",
-                       ShaderStage::eVertex, ShaderType::eSLANG, "main");
-    loadShaderFromFile(BuiltinShaders::BUILTIN_DEFAULT_GBUFFER_VERT_SHADER_NAME, "newShaders/deferRenderer/gbuffer/DefaultGbuffer.vert.slang",
-                       ShaderStage::eVertex, ShaderType::eSLANG, "main");
-    loadShaderFromFile(BuiltinShaders::BUILTIN_DEFAULT_GBUFFER_FRAG_SHADER_NAME, "newShaders/deferRenderer/gbuffer/DefaultGbuffer.frag.slang",
-                       ShaderStage::eFragment, ShaderType::eSLANG, "main");
-    loadShaderFromFile("volumeGenRay", "volumeRender/volumeGenRay.comp", ShaderStage::eCompute, ShaderType::eGLSL, "main");
+    loadShadersFromFiles({
+        {BuiltinShaders::BUILTIN_FULL_SCREEN_QUAD_VERT_SHADER_NAME, "newShaders/deferRenderer/common/builtin_full_screen.vert.slang",
+         ShaderStage::eVertex, ShaderType::eSLANG, "main"},
+        {BuiltinShaders::BUILTIN_DEFAULT_GBUFFER_VERT_SHADER_NAME, "newShaders/deferRenderer/gbuffer/DefaultGbuffer.vert.slang",
+         ShaderStage::eVertex, ShaderType::eSLANG, "main"},
+        {BuiltinShaders::BUILTIN_DEFAULT_GBUFFER_FRAG_SHADER_NAME, "newShaders/deferRenderer/gbuffer/DefaultGbuffer.frag.slang",
+         ShaderStage::eFragment, ShaderType::eSLANG, "main"},
+        {"volumeGenRay", "volumeRender/volumeGenRay.comp", ShaderStage::eCompute, ShaderType::eGLSL, "main"},
+    });
+
+    const std::vector<std::string> gbufferKeywords = {
+        BuiltinShaders::GBUFFER_KEYWORD_METALLIC_ROUGHNESS_TEXTURE, BuiltinShaders::GBUFFER_KEYWORD_SPECULAR_TEXTURE,
+        BuiltinShaders::GBUFFER_KEYWORD_OCCLUSION_TEXTURE, BuiltinShaders::GBUFFER_KEYWORD_EMISSIVE, BuiltinShaders::GBUFFER_KEYWORD_NORMAL_TEXTURE};
+    ShaderPermutationDesc gbufferPermutation;
+    gbufferPermutation.request = {BuiltinShaders::BUILTIN_DEFAULT_GBUFFER_FRAG_SHADER_NAME,
+                                  "newShaders/deferRenderer/gbuffer/DefaultGbuffer.frag.slang", ShaderStage::eFragment, ShaderType::eSLANG, "main"};
+    for (uint32_t constantId = 0; constantId < gbufferKeywords.size(); ++constantId)
+    {
+        gbufferPermutation.keywords.push_back({gbufferKeywords[constantId], {"0", "1"}, ShaderKeywordMode::eSpecialization, constantId});
+    }
+    registerPermutation(gbufferPermutation);
 }
 
 VkDescriptorType spvToDescriptorType(SpvReflectDescriptorType type)
@@ -274,7 +206,7 @@ void ShaderManager::addSearchPath(const std::filesystem::path& path)
         normalizedPath = std::filesystem::path(getBaseFilePath()) / normalizedPath;
     }
 
-    normalizedPath = normalizePath(normalizedPath);
+    normalizedPath = normalizeShaderPath(normalizedPath);
     if (!std::filesystem::exists(normalizedPath))
     {
         return;
@@ -289,8 +221,12 @@ void ShaderManager::addSearchPath(const std::filesystem::path& path)
     }
 
     _searchPaths.push_back(normalizedPath);
-    _glslCCompiler.addSearchPaths({normalizedPath});
-    _slangCompiler.addSearchPaths({normalizedPath});
+    _cache->setSearchPaths(_searchPaths);
+    for (auto& [definesKey, context] : _compilerContexts)
+    {
+        context->glslCompiler.addSearchPaths({normalizedPath});
+        context->slangCompiler.addSearchPaths({normalizedPath});
+    }
 }
 
 shaderc_shader_kind getShaderKind(ShaderStage stage)
@@ -355,224 +291,579 @@ VkShaderStageFlagBits getVkShaderKind(ShaderStage stage)
     }
 }
 
-bool ShaderManager::checkShaderUpdate(std::filesystem::path shaderPath, std::filesystem::path spvPath)
+std::unique_ptr<ShaderCompilerContext> ShaderManager::createCompilerContext(const ShaderDefines& defines) const
 {
-    if (!std::filesystem::exists(spvPath))
+    auto context     = std::make_unique<ShaderCompilerContext>();
+    context->defines = defines;
+
+    nvvkglsl::GlslCompiler& glslCompiler = context->glslCompiler;
+    glslCompiler.addSearchPaths(_searchPaths);
+    glslCompiler.defaultOptions();
+    glslCompiler.defaultTarget();
+    glslCompiler.options().SetGenerateDebugInfo();
+    glslCompiler.options().SetOptimizationLevel(shaderc_optimization_level_performance);
+    glslCompiler.options().AddMacroDefinition("GLSL");
+
+    nvslang::SlangCompiler& slangCompiler = context->slangCompiler;
+    slangCompiler.defaultOptions();
+    slangCompiler.defaultTarget();
+    slangCompiler.addSearchPaths(_searchPaths);
+    slangCompiler.addOption({slang::CompilerOptionName::DebugInformation, {slang::CompilerOptionValueKind::Int, SLANG_DEBUG_INFO_LEVEL_MAXIMAL}});
+    for (const auto& [name, value] : context->defines)
     {
-        return false;
+        glslCompiler.options().AddMacroDefinition(name, value);
+        slangCompiler.addOption(
+            {slang::CompilerOptionName::MacroDefine, {slang::CompilerOptionValueKind::String, 0, 0, name.c_str(), value.c_str()}});
     }
-    auto spvTime = std::filesystem::last_write_time(spvPath);
 
-    std::set<std::filesystem::path>    allFiles;
-    std::vector<std::filesystem::path> toProcess;
+#if defined(AFTERMATH_AVAILABLE)
+    // This aftermath callback is used to report the shader hash (Spirv) to the Aftermath library.
+    slangCompiler.setCompileCallback(
+        [](const std::filesystem::path& sourceFile, const uint32_t* spirvCode, size_t spirvSize)
+        {
+            // batch loads compile on several threads
+            static std::mutex           aftermathLock;
+            std::lock_guard<std::mutex> lock(aftermathLock);
+            std::span<const uint32_t>   data(spirvCode, spirvSize / sizeof(uint32_t));
+            AftermathCrashTracker::getInstance().addShaderBinary(data);
+        });
+#endif
+    return context;
+}
+
+ShaderCompilerContext& ShaderManager::getCompilerContext(CompilerContexts& contexts, const ShaderDefines& defines) const
+{
+    uint64_t definesKey = 0;
+    for (const auto& [name, value] : defines)
+    {
+        nvutils::hashCombine(definesKey, name);
+        nvutils::hashCombine(definesKey, value);
+    }
+    auto& context = contexts[definesKey];
+    if (!context)
+    {
+        context = createCompilerContext(defines);
+    }
+    return *context;
+}
 
-    // 在_searchPaths下查找shaderPath实际存在的路径
-    std::filesystem::path shaderRealPath = resolveShaderPath(shaderPath, _searchPaths, nullptr, !shaderPath.has_parent_path());
-    if (shaderRealPath.empty() || !std::filesystem::exists(shaderRealPath))
+ShaderManager::BuildResult ShaderManager::buildShader(const ShaderCache& cache, CompilerContexts& contexts, const ShaderLoadRequest& request,
+                                                      const std::filesystem::path& resolvedPath) const
+{
+    BuildResult         result;
+    ShaderCacheManifest manifest;
+    bool                refreshed  = false;
+    const uint64_t      requestKey = cache.getRequestKey(request, resolvedPath);
+    auto                finish     = [&result, &manifest]()
     {
-        // 主shader文件没找到
-        return false;
+        result.contentKey = manifest.contentKey;
+        result.succeeded  = true;
+        for (const ShaderDependency& dependency : manifest.dependencies)
+        {
+            result.dependencies.push_back(dependency.path);
+        }
+        return std::move(result);
+    };
+    if (cache.validate(requestKey, manifest, refreshed) && cache.loadSpirv(manifest.contentKey, result.spirv))
+    {
+        if (refreshed)
+        {
+            cache.storeManifest(requestKey, manifest);
+        }
+        result.cached = true;
+        return finish();
     }
-    toProcess.push_back(shaderRealPath);
 
-    while (!toProcess.empty())
+    if (!cache.scanDependencies(requestKey, resolvedPath, manifest))
+    {
+        LOGE("Shader source not readable: %s\n", resolvedPath.string().c_str());
+        return result;
+    }
+    // an edit that was undone, or a copy of sources built before under another name
+    if (cache.loadSpirv(manifest.contentKey, result.spirv))
     {
-        auto curFile = toProcess.back();
-        toProcess.pop_back();
+        cache.storeManifest(requestKey, manifest);
+        result.contentHit = true;
+        return finish();
+    }
 
-        if (allFiles.count(curFile)) continue;
-        allFiles.insert(curFile);
+    ShaderCompilerContext& context = getCompilerContext(contexts, request.defines);
+    if (request.type == ShaderType::eSLANG)
+    {
+        if (!context.slangCompiler.compileFile(resolvedPath))
+        {
+            LOGE("Compilation of %s failed: %s\n", request.name.c_str(), context.slangCompiler.getLastDiagnosticMessage().c_str());
+            return result;
+        }
+        const std::string& warningMessages = context.slangCompiler.getLastDiagnosticMessage();
+        if (!warningMessages.empty())
+        {
+            LOGW("Compilation of %s succeeded with warnings: %s\n", request.name.c_str(), warningMessages.c_str());
+        }
+        result.spirv.resize(context.slangCompiler.getSpirvSize() / sizeof(uint32_t));
+        std::memcpy(result.spirv.data(), context.slangCompiler.getSpirv(), result.spirv.size() * sizeof(uint32_t));
+    }
+    else if (request.type == ShaderType::eGLSL)
+    {
+        auto compileResult = context.glslCompiler.compileFile(resolvedPath, getShaderKind(request.stage));
+        if (compileResult.GetNumErrors())
+        {
+            LOGE("%s", compileResult.GetErrorMessage().c_str());
+            return result;
+        }
+        result.spirv.resize(context.glslCompiler.getSpirvSize(compileResult) / sizeof(uint32_t));
+        std::memcpy(result.spirv.data(), context.glslCompiler.getSpirv(compileResult), result.spirv.size() * sizeof(uint32_t));
+    }
+    else
+    {
+        // TODO HLSL
+        return result;
+    }
 
-        if (!std::filesystem::exists(curFile)) continue;
+    cache.storeSpirv(manifest.contentKey, result.spirv);
+    cache.storeManifest(requestKey, manifest);
+    return finish();
+}
 
-        auto fileTime = std::filesystem::last_write_time(curFile);
-        if (fileTime > spvTime)
+void ShaderManager::buildShaders(const ShaderCache& cache, const std::vector<ShaderLoadRequest>& requests,
+                                 const std::vector<std::filesystem::path>& resolvedPaths, std::vector<BuildResult>& results)
+{
+    results.assign(requests.size(), {});
+    const uint32_t threadCount = std::min(_settings.CompileThreads, static_cast<uint32_t>(requests.size()));
+    if (threadCount <= 1)
+    {
+        for (size_t i = 0; i < requests.size(); ++i)
         {
-            return false;
+            results[i] = buildShader(cache, _compilerContexts, requests[i], resolvedPaths[i]);
         }
+        return;
+    }
 
-        std::ifstream fin(curFile);
-        std::string   line;
-        std::regex    includeRegex(R"(#include\s*["<](.*)[">])");
-        while (std::getline(fin, line))
-        {
-            std::smatch match;
-            if (std::regex_search(line, match, includeRegex))
+    std::atomic<size_t>      nextRequest = 0;
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        workers.emplace_back(
+            [&]()
             {
-                std::string incFile = match[1].str();
-                if (incFile.empty()) continue;
-
-                // 在_searchPaths下查找头文件实际存在的路径
-                std::filesystem::path currentDirectory = curFile.parent_path();
-                std::filesystem::path incRealPath      = resolveShaderPath(incFile, _searchPaths, &currentDirectory, false);
-                if (!incRealPath.empty() && std::filesystem::exists(incRealPath))
+                // created by the first compile, a warm cache never needs one
+                CompilerContexts contexts;
+                for (size_t request = nextRequest++; request < requests.size(); request = nextRequest++)
                 {
-                    toProcess.push_back(incRealPath);
+                    results[request] = buildShader(cache, contexts, requests[request], resolvedPaths[request]);
                 }
-            }
-        }
+            });
+    }
+    for (std::thread& worker : workers)
+    {
+        worker.join();
     }
-    return true;
 }
 
-uint32_t ShaderManager::loadShaderFromFile(std::string name, const std::filesystem::path& filePath, ShaderStage stage, ShaderType type,
-                                           std::string entry)
+uint32_t ShaderManager::createModule(const ShaderLoadRequest& request, const std::filesystem::path& resolvedPath, BuildResult& result)
 {
-    const std::filesystem::path resolvedFilePath = resolveShaderPath(filePath, _searchPaths, nullptr, !filePath.has_parent_path());
-    if (resolvedFilePath.empty())
+    ShaderModule* module = _shaderPool.alloc();
+    module->_spvCode     = std::move(result.spirv);
+    module->_type        = request.type;
+    module->_name        = request.name;
+    module->_entryPoint  = request.entry;
+    module->_stage       = request.stage;
+    module->_contentKey  = result.contentKey;
+    module->_specialization.reset();
+    module->_baseId = ~0U;
+
+    VkShaderModuleCreateInfo createInfo{VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+    createInfo.codeSize = module->_spvCode.size() * sizeof(uint32_t);
+    createInfo.pCode    = module->_spvCode.data();
+    NVVK_CHECK(vkCreateShaderModule(vkDriver->getDevice(), &createInfo, nullptr, &module->_shaderModule));
+    _nameIdMap[request.name] = module->_poolId;
+
+    if (_watcher)
     {
-        LOGE("Shader source not found: %s\n", filePath.string().c_str());
-        return ~0U;
+        _watcher->watch(getDependencyDirectories(result.dependencies));
     }
+    std::lock_guard<std::mutex> lock(_reloadLock);
+    _shaderSources[module->_poolId] = {request, resolvedPath, std::move(result.dependencies)};
+    return module->_poolId;
+}
 
-    if (type == ShaderType::eSLANG)
+uint32_t ShaderManager::createSpecializedModule(const std::string& name, uint32_t baseId, std::shared_ptr<const ShaderSpecialization> specialization)
+{
+    if (auto res = _nameIdMap.find(name); res != _nameIdMap.end())
+    {
+        return res->second;
+    }
+    const ShaderModule* base   = _shaderPool.get(baseId);
+    ShaderModule*       module = _shaderPool.alloc();
+    module->_shaderModule      = base->_shaderModule;
+    module->_spvCode           = base->_spvCode;
+    module->_type              = base->_type;
+    module->_name              = name;
+    module->_entryPoint        = base->_entryPoint;
+    module->_stage             = base->_stage;
+    module->_contentKey        = base->_contentKey;
+    module->_specialization    = std::move(specialization);
+    module->_baseId            = baseId;
+    _nameIdMap[name]           = module->_poolId;
+    _specializedModules[baseId].push_back(module->_poolId);
+    ++_stats.SpecializedVariants;
+    return module->_poolId;
+}
+
+const ShaderPermutation* ShaderManager::registerPermutation(const ShaderPermutationDesc& desc)
+{
+    if (auto res = _permutations.find(desc.request.name); res != _permutations.end())
     {
-        if (_nameIdMap.find(name) != _nameIdMap.end())
+        return res->second.get();
+    }
+    auto permutation = std::make_unique<ShaderPermutation>(desc);
+    if (!permutation->isValid())
+    {
+        return nullptr;
+    }
+    const ShaderPermutation* registered = permutation.get();
+    _permutations[desc.request.name]    = std::move(permutation);
+    _stats.Permutations                 = static_cast<uint32_t>(_permutations.size());
+    return registered;
+}
+
+const ShaderPermutation* ShaderManager::getPermutation(const std::string& name) const
+{
+    auto res = _permutations.find(name);
+    return res != _permutations.end() ? res->second.get() : nullptr;
+}
+
+uint32_t ShaderManager::getOrLoadVariant(const std::string& permutationName, ShaderVariantKey key)
+{
+    return loadVariants(permutationName, {key})[0];
+}
+
+std::vector<uint32_t> ShaderManager::loadVariants(const std::string& permutationName, const std::vector<ShaderVariantKey>& keys)
+{
+    std::vector<uint32_t>    ids(keys.size(), ~0U);
+    const ShaderPermutation* permutation = getPermutation(permutationName);
+    if (!permutation)
+    {
+        LOGE("Shader permutation %s is not registered\n", permutationName.c_str());
+        return ids;
+    }
+
+    // the define variants compile as one batch, the ones loaded already are found by name
+    std::vector<ShaderLoadRequest> requests;
+    for (ShaderVariantKey key : keys)
+    {
+        requests.push_back(permutation->getDefineRequest(key));
+    }
+    const size_t                shaders   = _nameIdMap.size();
+    const std::vector<uint32_t> moduleIds = loadShadersFromFiles(requests);
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        if (moduleIds[i] == ~0U || !permutation->hasSpecialization())
         {
-            return _nameIdMap[name];
+            ids[i] = moduleIds[i];
+            continue;
         }
-        std::filesystem::path spvPath     = getBaseFilePath() / "spv";
-        std::filesystem::path spvFileName = name + ".spv";
-        std::filesystem::path fullSpvPath = spvPath / spvFileName;
+        ids[i] = createSpecializedModule(permutation->getVariantName(keys[i]), moduleIds[i], permutation->createSpecialization(keys[i]));
+    }
+    _stats.Variants += static_cast<uint32_t>(_nameIdMap.size() - shaders);
+    _stats.Shaders   = static_cast<uint32_t>(_nameIdMap.size());
+    return ids;
+}
+
+uint32_t ShaderManager::loadVariantByName(const std::string& variantName)
+{
+    const size_t separator = variantName.rfind('#');
+    if (separator == std::string::npos) return ~0U;
 
-        if (std::filesystem::exists(fullSpvPath) && checkShaderUpdate(resolvedFilePath, fullSpvPath))
+    const ShaderPermutation* permutation = getPermutation(variantName.substr(0, separator));
+    ShaderVariantKey         key         = 0;
+    if (!permutation || !permutation->parseVariantName(variantName, key)) return ~0U;
+    return getOrLoadVariant(permutation->getName(), key);
+}
+
+uint32_t ShaderManager::loadShaderFromFile(std::string name, const std::filesystem::path& filePath, ShaderStage stage, ShaderType type,
+                                           std::string entry, const ShaderDefines& defines)
+{
+    return loadShadersFromFiles({ShaderLoadRequest{std::move(name), filePath, stage, type, std::move(entry), defines}})[0];
+}
+
+std::vector<uint32_t> ShaderManager::loadShadersFromFiles(const std::vector<ShaderLoadRequest>& requests)
+{
+    const auto                         loadStart = std::chrono::steady_clock::now();
+    std::vector<uint32_t>              ids(requests.size(), ~0U);
+    std::vector<ShaderLoadRequest>     pending;
+    std::vector<std::filesystem::path> resolvedPaths;
+    std::vector<size_t>                pendingIndices;
+    std::unordered_set<std::string>    pendingNames;
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        const ShaderLoadRequest& request = requests[i];
+        if (auto res = _nameIdMap.find(request.name); res != _nameIdMap.end())
         {
-            // Load pre-compiled SPV file
-            std::ifstream file(fullSpvPath, std::ios::binary | std::ios::ate);
-            if (file.is_open())
-            {
-                std::streamsize size = file.tellg();
-                file.seekg(0, std::ios::beg);
+            ids[i] = res->second;
+            continue;
+        }
+        if (!pendingNames.insert(request.name).second)
+        {
+            continue;
+        }
+        std::filesystem::path resolvedPath = resolveShaderPath(request.filePath, _searchPaths, nullptr, !request.filePath.has_parent_path());
+        if (resolvedPath.empty())
+        {
+            LOGE("Shader source not found: %s\n", request.filePath.string().c_str());
+            ++_stats.Failures;
+            continue;
+        }
+        pending.push_back(request);
+        resolvedPaths.push_back(std::move(resolvedPath));
+        pendingIndices.push_back(i);
+    }
 
-                const size_t          wordCount = static_cast<size_t>(size) / sizeof(uint32_t);
-                std::vector<uint32_t> buffer(wordCount);
-                if (file.read(reinterpret_cast<char*>(buffer.data()), wordCount * sizeof(uint32_t)))
-                {
-                    ShaderModule* module = _shaderPool.alloc();
-                    module->_spvCode     = std::move(buffer);
-                    module->_type        = ShaderType::eSLANG;
-                    module->_name        = name;
-                    module->_entryPoint  = entry;
-
-                    VkShaderModuleCreateInfo createInfo{VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
-                    createInfo.codeSize = module->_spvCode.size() * sizeof(uint32_t);
-                    createInfo.pCode    = module->_spvCode.data();
-
-                    NVVK_CHECK(vkCreateShaderModule(vkDriver->getDevice(), &createInfo, nullptr, &module->_shaderModule));
-                    _nameIdMap[name] = module->_poolId;
-                    return module->_poolId;
-                }
-            }
+    std::vector<BuildResult> results;
+    buildShaders(*_cache, pending, resolvedPaths, results);
+    for (size_t i = 0; i < pending.size(); ++i)
+    {
+        BuildResult& result = results[i];
+        if (!result.succeeded)
+        {
+            ++_stats.Failures;
+            continue;
         }
-        ShaderModule* module = _shaderPool.alloc();
-        auto          result = _slangCompiler.compileFile(resolvedFilePath);
-        if (!result)
+        _stats.CacheHits   += result.cached ? 1 : 0;
+        _stats.ContentHits += result.contentHit ? 1 : 0;
+        _stats.Compiled    += result.cached || result.contentHit ? 0 : 1;
+        ids[pendingIndices[i]] = createModule(pending[i], resolvedPaths[i], result);
+    }
+
+    // a name requested twice in the batch shares the module of its first request
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        if (ids[i] == ~0U)
         {
-            const std::string& errorMessages = _slangCompiler.getLastDiagnosticMessage();
-            _shaderPool.free(module->_poolId);
-            LOGE("Compilation failed: %s\n", errorMessages.c_str());
-            return -1;
+            ids[i] = getShaderIdByName(requests[i].name);
         }
-        const std::string& warningMessages = _slangCompiler.getLastDiagnosticMessage();
-        if (!warningMessages.empty())
+    }
+    _stats.Shaders  = static_cast<uint32_t>(_nameIdMap.size());
+    _stats.LoadMs  += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+    return ids;
+}
+
+void ShaderManager::beginFrame()
+{
+    if (_settings.HotReload != (_watcher != nullptr))
+    {
+        if (_settings.HotReload)
         {
-            LOGW("Compilation succeeded with warnings: %s\n", warningMessages.c_str());
+            startWatching();
         }
-        module->_type               = ShaderType::eSLANG;
-        module->_name               = name;
-        const size_t spirvByteSize  = _slangCompiler.getSpirvSize();
-        const size_t spirvWordCount = spirvByteSize / sizeof(uint32_t);
-        module->_spvCode.resize(spirvWordCount);
-        module->_entryPoint = entry;
-        std::memcpy(module->_spvCode.data(), _slangCompiler.getSpirv(), spirvWordCount * sizeof(uint32_t));
-        VkShaderModuleCreateInfo createInfo{VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
-        createInfo.codeSize = module->_spvCode.size() * sizeof(uint32_t);
-        createInfo.pCode    = module->_spvCode.data();
-        NVVK_CHECK(vkCreateShaderModule(vkDriver->getDevice(), &createInfo, nullptr, &module->_shaderModule));
-        _nameIdMap[name] = module->_poolId;
-        std::ofstream spvFile(fullSpvPath, std::ios::binary);
-        if (spvFile.is_open())
+        else
         {
-            spvFile.write(reinterpret_cast<const char*>(createInfo.pCode), createInfo.codeSize);
-            spvFile.close();
+            _watcher.reset();
         }
-        return module->_poolId;
     }
-    else
+    if (_watcher)
     {
-        if (type == ShaderType::eGLSL)
+        applyReloadedShaders();
+    }
+
+    if (_settings.RunStartupBenchmark)
+    {
+        _settings.RunStartupBenchmark = false;
+        runStartupBenchmark();
+    }
+}
+
+void ShaderManager::startWatching()
+{
+    _watcher =
+        std::make_unique<ShaderWatcher>([this](const std::set<std::filesystem::path>& changedFiles) { rebuildChangedShaders(changedFiles); });
+    _watcher->watch(_searchPaths);
+    std::lock_guard<std::mutex> lock(_reloadLock);
+    for (const auto& [id, source] : _shaderSources)
+    {
+        _watcher->watch(getDependencyDirectories(source.dependencies));
+    }
+}
+
+std::vector<std::filesystem::path> ShaderManager::getDependencyDirectories(const std::vector<std::string>& dependencies)
+{
+    std::vector<std::filesystem::path> directories;
+    for (const std::string& dependency : dependencies)
+    {
+        directories.push_back(std::filesystem::path(dependency).parent_path());
+    }
+    return directories;
+}
+
+void ShaderManager::rebuildChangedShaders(const std::set<std::filesystem::path>& changedFiles)
+{
+    std::unordered_set<std::string> changedPaths;
+    for (const std::filesystem::path& file : changedFiles)
+    {
+        changedPaths.insert(normalizeShaderPath(file).string());
+    }
+
+    std::vector<std::pair<uint32_t, ShaderSource>> affected;
+    {
+        std::lock_guard<std::mutex> lock(_reloadLock);
+        for (const auto& [id, source] : _shaderSources)
         {
-            std::filesystem::path spvPath     = getBaseFilePath() / "spv";
-            std::filesystem::path spvFileName = name + ".spv";
-            std::filesystem::path fullSpvPath = spvPath / spvFileName;
-            if (_nameIdMap.find(name) != _nameIdMap.end())
+            auto changed = [&changedPaths](const std::string& dependency) { return changedPaths.contains(dependency); };
+            if (std::any_of(source.dependencies.begin(), source.dependencies.end(), changed))
             {
-                return _nameIdMap[name];
-            }
-            if (std::filesystem::exists(fullSpvPath) && checkShaderUpdate(resolvedFilePath, fullSpvPath))
-            {
-                // Load pre-compiled SPV file
-                std::ifstream file(fullSpvPath, std::ios::binary | std::ios::ate);
-                if (file.is_open())
-                {
-                    std::streamsize size = file.tellg();
-                    file.seekg(0, std::ios::beg);
-
-                    const size_t          wordCount = static_cast<size_t>(size) / sizeof(uint32_t);
-                    std::vector<uint32_t> buffer(wordCount);
-                    if (file.read(reinterpret_cast<char*>(buffer.data()), wordCount * sizeof(uint32_t)))
-                    {
-                        ShaderModule* module = _shaderPool.alloc();
-                        module->_spvCode     = std::move(buffer);
-
-                        module->_type       = ShaderType::eGLSL;
-                        module->_name       = name;
-                        module->_entryPoint = entry;
-
-                        VkShaderModuleCreateInfo createInfo{VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
-                        createInfo.codeSize = module->_spvCode.size() * sizeof(uint32_t);
-                        createInfo.pCode    = module->_spvCode.data();
-
-                        NVVK_CHECK(vkCreateShaderModule(vkDriver->getDevice(), &createInfo, nullptr, &module->_shaderModule));
-                        _nameIdMap[name] = module->_poolId;
-                        return module->_poolId;
-                    }
-                }
+                affected.emplace_back(id, source);
             }
-            ShaderModule* module = _shaderPool.alloc();
-            auto          result = _glslCCompiler.compileFile(resolvedFilePath, getShaderKind(stage));
-            if (result.GetNumErrors())
+        }
+    }
+    if (affected.empty()) return;
+
+    // the render thread keeps drawing with the current modules meanwhile
+    const auto                  rebuildStart = std::chrono::steady_clock::now();
+    std::vector<ReloadedShader> reloaded;
+    for (const auto& [id, source] : affected)
+    {
+        reloaded.push_back({id, buildShader(*_cache, _reloadContexts, source.request, source.resolvedPath)});
+    }
+    const float rebuildMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - rebuildStart).count();
+    LOGI("Rebuilt %zu shaders after %zu changed files in %.1f ms\n", reloaded.size(), changedFiles.size(), rebuildMs);
+
+    std::lock_guard<std::mutex> lock(_reloadLock);
+    for (ReloadedShader& shader : reloaded)
+    {
+        _reloadedShaders.push_back(std::move(shader));
+    }
+    _reloadMs = rebuildMs;
+}
+
+void ShaderManager::applyReloadedShaders()
+{
+    std::vector<ReloadedShader> reloaded;
+    {
+        std::lock_guard<std::mutex> lock(_reloadLock);
+        if (_reloadedShaders.empty()) return;
+        reloaded.swap(_reloadedShaders);
+        _stats.LastReloadMs = _reloadMs;
+    }
+
+    PipelineCacheManager* pipelineCache = vkDriver->getPipelineCacheManager();
+    for (ReloadedShader& shader : reloaded)
+    {
+        ShaderModule* module = _shaderPool.get(shader.id);
+        if (!shader.result.succeeded)
+        {
+            ++_stats.HotReloadFailures;
+            continue;
+        }
+        if (!module) continue;
+
+        // an edit may have added includes
+        _watcher->watch(getDependencyDirectories(shader.result.dependencies));
+        {
+            std::lock_guard<std::mutex> lock(_reloadLock);
+            _shaderSources[shader.id].dependencies = shader.result.dependencies;
+        }
+        // saved without a change the compiler sees
+        if (shader.result.contentKey == module->_contentKey) continue;
+
+        VkShaderModuleCreateInfo createInfo{VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+        createInfo.codeSize           = shader.result.spirv.size() * sizeof(uint32_t);
+        createInfo.pCode              = shader.result.spirv.data();
+        VkShaderModule reloadedModule = VK_NULL_HANDLE;
+        NVVK_CHECK(vkCreateShaderModule(vkDriver->getDevice(), &createInfo, nullptr, &reloadedModule));
+
+        // the jobs copied the module handle, none of them may still be compiling once it is retired. The variants share it
+        pipelineCache->waitShaderPipelines(shader.id);
+        auto variants = _specializedModules.find(shader.id);
+        if (variants != _specializedModules.end())
+        {
+            for (uint32_t variantId : variants->second)
             {
-                _shaderPool.free(module->_poolId);
-                LOGE(result.GetErrorMessage().c_str());
-                return -1;
+                pipelineCache->waitShaderPipelines(variantId);
             }
-            const size_t spirvByteSize  = _glslCCompiler.getSpirvSize(result);
-            const size_t spirvWordCount = spirvByteSize / sizeof(uint32_t);
-            module->_spvCode.resize(spirvWordCount);
-            std::memcpy(module->_spvCode.data(), _glslCCompiler.getSpirv(result), spirvWordCount * sizeof(uint32_t));
-            module->_type                       = ShaderType::eGLSL;
-            module->_name                       = name;
-            module->_entryPoint                 = entry;
-            VkShaderModuleCreateInfo createInfo = _glslCCompiler.makeShaderModuleCreateInfo(result, 0);
-            NVVK_CHECK(vkCreateShaderModule(vkDriver->getDevice(), &createInfo, nullptr, &module->_shaderModule));
-            _nameIdMap[name] = module->_poolId;
-            // Save the compiled SPV code to disk
-
-            std::ofstream spvFile(fullSpvPath, std::ios::binary);
-            if (spvFile.is_open())
+        }
+
+        // between frames, so every pipeline built from here on sees the new module and code together
+        const VkShaderModule retiredModule = std::exchange(module->_shaderModule, reloadedModule);
+        module->_spvCode                   = std::move(shader.result.spirv);
+        module->_contentKey                = shader.result.contentKey;
+        vkDriver->deferDestroy([retiredModule]() { vkDestroyShaderModule(vkDriver->getDevice(), retiredModule, nullptr); });
+        pipelineCache->invalidateShaderPipelines(shader.id);
+        // the specialized variants run the same code with their own constants
+        if (variants != _specializedModules.end())
+        {
+            for (uint32_t variantId : variants->second)
             {
-                spvFile.write(reinterpret_cast<const char*>(module->_spvCode.data()), module->_spvCode.size() * sizeof(uint32_t));
-                spvFile.close();
+                ShaderModule* variant  = _shaderPool.get(variantId);
+                variant->_shaderModule = module->_shaderModule;
+                variant->_spvCode      = module->_spvCode;
+                variant->_contentKey   = module->_contentKey;
+                pipelineCache->invalidateShaderPipelines(variantId);
             }
-            return module->_poolId;
         }
-        else if (type == ShaderType::eHLSL)
+        ++_stats.HotReloads;
+        LOGI("Hot reloaded shader %s\n", module->_name.c_str());
+    }
+}
+
+void ShaderManager::runStartupBenchmark()
+{
+    // stage by the last extension before .slang, or by the extension of a GLSL source. Headers have none of these
+    static const std::unordered_map<std::string, ShaderStage> stageExtensions = {{".vert", ShaderStage::eVertex},
+                                                                                 {".frag", ShaderStage::eFragment},
+                                                                                 {".comp", ShaderStage::eCompute},
+                                                                                 {".rgen", ShaderStage::eRayGen},
+                                                                                 {".rahit", ShaderStage::eRayAnyHit},
+                                                                                 {".rchit", ShaderStage::eRayClosestHit},
+                                                                                 {".rmiss", ShaderStage::eRayMiss},
+                                                                                 {".rint", ShaderStage::eRayIntersection},
+                                                                                 {".rcall", ShaderStage::eRayCallable},
+                                                                                 {".task", ShaderStage::eRayTask},
+                                                                                 {".mesh", ShaderStage::eRayMesh}};
+
+    std::vector<ShaderLoadRequest>     requests;
+    std::vector<std::filesystem::path> resolvedPaths;
+    std::error_code                    ec;
+    for (std::filesystem::recursive_directory_iterator it(getBaseFilePath() / "shaders", ec), end; !ec && it != end; it.increment(ec))
+    {
+        if (!it->is_regular_file()) continue;
+        std::filesystem::path stagePath = it->path();
+        ShaderType            type      = ShaderType::eGLSL;
+        if (stagePath.extension() == ".slang")
         {
-            // TODO
+            type      = ShaderType::eSLANG;
+            stagePath = stagePath.stem();
         }
+        auto stage = stageExtensions.find(stagePath.extension().string());
+        if (stage == stageExtensions.end()) continue;
+        requests.push_back(ShaderLoadRequest{stagePath.stem().string(), it->path(), stage->second, type});
+        resolvedPaths.push_back(normalizeShaderPath(it->path()));
     }
-    return ~0U;
+
+    // an empty cache of its own, the one the runtime loads from stays untouched
+    const std::filesystem::path benchmarkRoot = _cache->getRoot() / "benchmark";
+    std::filesystem::remove_all(benchmarkRoot, ec);
+    ShaderCache cache(benchmarkRoot, _cache->getCompilerVersion());
+    cache.setSearchPaths(_searchPaths);
+
+    std::vector<BuildResult> results;
+    const auto               coldStart = std::chrono::steady_clock::now();
+    buildShaders(cache, requests, resolvedPaths, results);
+    const auto warmStart = std::chrono::steady_clock::now();
+    buildShaders(cache, requests, resolvedPaths, results);
+    const auto warmEnd = std::chrono::steady_clock::now();
+
+    uint32_t warmHits = 0;
+    for (const BuildResult& result : results)
+    {
+        warmHits += result.cached ? 1 : 0;
+    }
+    _stats.BenchmarkShaders  = static_cast<uint32_t>(requests.size());
+    _stats.BenchmarkColdMs   = std::chrono::duration<float, std::milli>(warmStart - coldStart).count();
+    _stats.BenchmarkWarmMs   = std::chrono::duration<float, std::milli>(warmEnd - warmStart).count();
+    _stats.BenchmarkWarmHits = warmHits;
+    LOGI("Shader startup over %u sources on %u threads: %.1f ms cold, %.1f ms warm with %u cache hits\n", _stats.BenchmarkShaders,
+         _settings.CompileThreads, _stats.BenchmarkColdMs, _stats.BenchmarkWarmMs, warmHits);
+    std::filesystem::remove_all(benchmarkRoot, ec);
 }
 void                ShaderManager::eraseShaderByName(std::string name) {}
 void                ShaderManager::eraseShaderById(uint32_t id) {}
@@ -597,17 +888,26 @@ uint32_t ShaderManager::getShaderIdByName(std::string name)
 }
 void ShaderManager::deInit()
 {
+    _watcher.reset();
     for (auto& [name, id] : _nameIdMap)
     {
         ShaderModule* module = _shaderPool.get(id);
         if (module)
         {
-            vkDestroyShaderModule(vkDriver->getDevice(), module->_shaderModule, nullptr);
+            // specialized variants borrow the module of their define variant
+            if (module->_baseId == ~0U) vkDestroyShaderModule(vkDriver->getDevice(), module->_shaderModule, nullptr);
             _shaderPool.free(id);
         }
     }
     _nameIdMap.clear();
+    _specializedModules.clear();
+    _permutations.clear();
     _shaderPool.deinit();
+    _compilerContexts.clear();
+    _reloadContexts.clear();
+    _shaderSources.clear();
+    _reloadedShaders.clear();
+    _cache.reset();
 }
 
 ShaderManager& ShaderManager::Instance()
@@ -5,6 +5,9 @@
 #include "nvutils/file_mapping.hpp"
 #include "PlayAllocator.h"
 #include "spirv_reflect.h"
+#include <memory>
+#include <mutex>
+#include <set>
 
 namespace Play
 {
@@ -13,6 +16,13 @@ namespace BuiltinShaders
 inline const std::string BUILTIN_FULL_SCREEN_QUAD_VERT_SHADER_NAME = "builtin_full_screen_quad_vert";
 inline const std::string BUILTIN_DEFAULT_GBUFFER_VERT_SHADER_NAME  = "builtin_default_gbuffer_vert";
 inline const std::string BUILTIN_DEFAULT_GBUFFER_FRAG_SHADER_NAME  = "builtin_default_gbuffer_frag";
+// specialization keywords of the default gbuffer fragment shader, in constant id order. Its permutation carries the
+// shader's name
+inline const std::string GBUFFER_KEYWORD_METALLIC_ROUGHNESS_TEXTURE = "kMetallicRoughnessTexture";
+inline const std::string GBUFFER_KEYWORD_SPECULAR_TEXTURE           = "kSpecularTexture";
+inline const std::string GBUFFER_KEYWORD_OCCLUSION_TEXTURE          = "kOcclusionTexture";
+inline const std::string GBUFFER_KEYWORD_EMISSIVE                   = "kEmissive";
+inline const std::string GBUFFER_KEYWORD_NORMAL_TEXTURE             = "kNormalTexture";
 } // namespace BuiltinShaders
 const uint32_t MaxShaderModules = 1024;
 enum class ShaderStage : uint32_t
@@ -39,9 +49,61 @@ enum class ShaderType
     eCount
 };
 
+using ShaderDefines    = std::vector<std::pair<std::string, std::string>>; // name, value
+using ShaderVariantKey = uint64_t;
+
+struct ShaderLoadRequest
+{
+    std::string           name;
+    std::filesystem::path filePath;
+    ShaderStage           stage   = ShaderStage::eCompute;
+    ShaderType            type    = ShaderType::eSLANG;
+    std::string           entry   = "main";
+    ShaderDefines         defines = {};
+};
+
+struct ShaderCacheSettings
+{
+    uint32_t CompileThreads      = 4;     // workers of a batch load, 0 compiles on the calling thread
+    bool     RunStartupBenchmark = false; // one-shot, builds every shader under shaders/ into an empty cache and again from it
+    bool     HotReload           = true;  // rebuilds the shaders whose sources are written while running
+};
+
+struct ShaderCacheStats
+{
+    uint32_t Shaders             = 0;
+    uint32_t CacheHits           = 0;    // validated through the dependency manifest alone
+    uint32_t ContentHits         = 0;    // manifest stale, but the changed sources hashed to SPIR-V built before
+    uint32_t Compiled            = 0;
+    uint32_t Failures            = 0;
+    float    LoadMs              = 0.0f; // spent in loads since startup, module creation included
+    uint32_t BenchmarkShaders    = 0;
+    float    BenchmarkColdMs     = 0.0f;
+    float    BenchmarkWarmMs     = 0.0f;
+    uint32_t BenchmarkWarmHits   = 0;    // of the warm pass, every shader that compiled cold should be one
+    uint32_t HotReloads          = 0;    // modules swapped since startup
+    uint32_t HotReloadFailures   = 0;    // edits that did not compile, the previous module stays
+    float    LastReloadMs        = 0.0f; // compiling the last edit on the watcher thread
+    uint32_t Permutations        = 0;
+    uint32_t Variants            = 0;    // loaded through a permutation, define and specialized ones
+    uint32_t SpecializedVariants = 0;    // sharing the module of their define variant
+};
+
 VkDescriptorType      spvToDescriptorType(SpvReflectDescriptorType type);
 VkPipelineStageFlags2 spvToVkStageFlags(SpvReflectShaderStageFlagBits flags);
 
+// the constants of one specialized variant, info points into the vectors and the struct is shared, never copied
+struct ShaderSpecialization
+{
+    ShaderSpecialization(std::vector<VkSpecializationMapEntry> entries, std::vector<uint32_t> data);
+    ShaderSpecialization(const ShaderSpecialization&)            = delete;
+    ShaderSpecialization& operator=(const ShaderSpecialization&) = delete;
+
+    std::vector<VkSpecializationMapEntry> entries;
+    std::vector<uint32_t>                 data;
+    VkSpecializationInfo                  info = {};
+};
+
 class RenderSession;
 struct ShaderModule
 {
@@ -53,6 +115,11 @@ struct ShaderModule
     std::vector<uint32_t> _spvCode;
     std::string           _name;
     std::string           _entryPoint;
+    ShaderStage           _stage      = ShaderStage::eCompute;
+    uint64_t              _contentKey = 0; // names the cached SPIR-V, equal for equal sources and compile inputs
+    // a specialized variant shares the VkShaderModule of the module at _baseId and owns none
+    std::shared_ptr<const ShaderSpecialization> _specialization;
+    uint32_t                                    _baseId = ~0U;
 };
 
 class ShaderPool : public BasePool<ShaderModule>
@@ -70,18 +137,29 @@ public:
     }
 };
 
+class ShaderCache;
+class ShaderWatcher;
+class ShaderPermutation;
+struct ShaderPermutationDesc;
+struct ShaderCompilerContext;
 class ShaderManager
 {
 public:
     static ShaderManager& Instance();
-    ShaderManager() = default;
+    ShaderManager();
+    ~ShaderManager();
     void init();
+    // swaps in the shaders rebuilt since the last frame and runs the one-shot startup benchmark when it was requested
+    void beginFrame();
 
     void registBuiltInShader();
     void addSearchPath(const std::filesystem::path& path);
 
     uint32_t loadShaderFromFile(std::string name, const std::filesystem::path& filePath, ShaderStage stage, ShaderType type = ShaderType::eSLANG,
-                                std::string entry = "main");
+                                std::string entry = "main", const ShaderDefines& defines = {});
+    // validates and compiles the requests on CompileThreads workers, then creates their modules in order. Ids are ~0U for
+    // the requests that failed
+    std::vector<uint32_t> loadShadersFromFiles(const std::vector<ShaderLoadRequest>& requests);
     void     eraseShaderByName(std::string name);
     void     eraseShaderById(uint32_t id);
     void     eraseShaderByModule(const ShaderModule& module);
@@ -89,17 +167,86 @@ public:
     const ShaderModule* getShaderByName(std::string name);
     uint32_t            getShaderIdByName(std::string name);
 
+    // declares the keywords of a shader, its variants load on first use. A name registered again keeps its keywords
+    const ShaderPermutation* registerPermutation(const ShaderPermutationDesc& desc);
+    const ShaderPermutation* getPermutation(const std::string& name) const;
+    // define keywords compile a module of their own, the variants differing in specialization keywords share it and get
+    // an id each, so their constants reach the pipeline keys. ~0U when the variant failed
+    uint32_t              getOrLoadVariant(const std::string& permutationName, ShaderVariantKey key);
+    std::vector<uint32_t> loadVariants(const std::string& permutationName, const std::vector<ShaderVariantKey>& keys);
+    // a name from ShaderPermutation::getVariantName, recorded pipelines load their variants through it
+    uint32_t              loadVariantByName(const std::string& variantName);
+
     void deInit();
 
-protected:
-    bool checkShaderUpdate(std::filesystem::path shaderPath, std::filesystem::path spvPath);
+    ShaderCacheSettings& getSettings()
+    {
+        return _settings;
+    }
+
+    ShaderCacheStats& getStats()
+    {
+        return _stats;
+    }
 
 private:
+    struct BuildResult
+    {
+        std::vector<uint32_t>    spirv;
+        uint64_t                 contentKey = 0;
+        bool                     cached     = false;
+        bool                     contentHit = false;
+        bool                     succeeded  = false;
+        std::vector<std::string> dependencies;
+    };
+    // what a loaded module was built from, a write to any of its dependencies rebuilds it
+    struct ShaderSource
+    {
+        ShaderLoadRequest        request;
+        std::filesystem::path    resolvedPath;
+        std::vector<std::string> dependencies;
+    };
+    struct ReloadedShader
+    {
+        uint32_t    id = ~0U;
+        BuildResult result;
+    };
+    using CompilerContexts = std::unordered_map<uint64_t, std::unique_ptr<ShaderCompilerContext>>;
+
+    std::unique_ptr<ShaderCompilerContext> createCompilerContext(const ShaderDefines& defines) const;
+    ShaderCompilerContext&                 getCompilerContext(CompilerContexts& contexts, const ShaderDefines& defines) const;
+    // thread safe as long as every thread brings its own contexts
+    BuildResult buildShader(const ShaderCache& cache, CompilerContexts& contexts, const ShaderLoadRequest& request,
+                            const std::filesystem::path& resolvedPath) const;
+    void        buildShaders(const ShaderCache& cache, const std::vector<ShaderLoadRequest>& requests,
+                             const std::vector<std::filesystem::path>& resolvedPaths, std::vector<BuildResult>& results);
+    uint32_t    createModule(const ShaderLoadRequest& request, const std::filesystem::path& resolvedPath, BuildResult& result);
+    uint32_t    createSpecializedModule(const std::string& name, uint32_t baseId, std::shared_ptr<const ShaderSpecialization> specialization);
+    void        runStartupBenchmark();
+
+    void startWatching();
+    // runs on the watcher thread, builds the modules depending on the files and leaves them to beginFrame
+    void rebuildChangedShaders(const std::set<std::filesystem::path>& changedFiles);
+    void applyReloadedShaders();
+    static std::vector<std::filesystem::path> getDependencyDirectories(const std::vector<std::string>& dependencies);
+
     ShaderPool                                _shaderPool;
-    nvslang::SlangCompiler                    _slangCompiler;
-    nvvkglsl::GlslCompiler                    _glslCCompiler;
+    std::unique_ptr<ShaderCache>              _cache;
+    CompilerContexts                          _compilerContexts; // the calling thread's, by defines
     std::unordered_map<std::string, uint32_t> _nameIdMap;
     std::vector<std::filesystem::path>        _searchPaths;
+    ShaderCacheSettings                       _settings;
+    ShaderCacheStats                          _stats;
+
+    std::unordered_map<std::string, std::unique_ptr<ShaderPermutation>> _permutations;
+    std::unordered_map<uint32_t, std::vector<uint32_t>>                 _specializedModules; // by the module they share
+
+    std::unique_ptr<ShaderWatcher>             _watcher;
+    CompilerContexts                           _reloadContexts; // the watcher thread's
+    std::mutex                                 _reloadLock;     // guards the sources and the rebuilt shaders
+    std::unordered_map<uint32_t, ShaderSource> _shaderSources;
+    std::vector<ReloadedShader>                _reloadedShaders;
+    float                                      _reloadMs = 0.0f;
 };
 
 } // namespace Play
@@ -0,0 +1,165 @@
+#include "ShaderPermutation.h"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstdio>
+#include <nvutils/logger.hpp>
+
+namespace Play
+{
+namespace
+{
+std::string toHex(ShaderVariantKey key)
+{
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%llx", static_cast<unsigned long long>(key));
+    return buffer;
+}
+} // namespace
+
+ShaderSpecialization::ShaderSpecialization(std::vector<VkSpecializationMapEntry> entries, std::vector<uint32_t> data)
+    : entries(std::move(entries)), data(std::move(data))
+{
+    info.mapEntryCount = static_cast<uint32_t>(this->entries.size());
+    info.pMapEntries   = this->entries.data();
+    info.dataSize      = this->data.size() * sizeof(uint32_t);
+    info.pData         = this->data.data();
+}
+
+ShaderPermutation::ShaderPermutation(ShaderPermutationDesc desc) : _desc(std::move(desc))
+{
+    uint32_t shift = 0;
+    for (const ShaderKeyword& keyword : _desc.keywords)
+    {
+        const uint32_t valueCount = static_cast<uint32_t>(std::max<size_t>(keyword.values.size(), 1));
+        const uint32_t bits       = std::max(1u, static_cast<uint32_t>(std::bit_width(valueCount - 1)));
+        if (keyword.values.empty() || shift + bits > 64)
+        {
+            LOGE("Shader permutation %s: keyword %s has no values or does not fit the variant key\n", getName().c_str(),
+                 keyword.name.c_str());
+            _valid = false;
+        }
+        _shifts.push_back(shift);
+        _bits.push_back(bits);
+        if (keyword.mode == ShaderKeywordMode::eSpecialization && _valid)
+        {
+            _specializationMask |= ((1ULL << bits) - 1) << shift;
+        }
+        shift += bits;
+    }
+}
+
+int32_t ShaderPermutation::findKeyword(const std::string& keyword) const
+{
+    for (size_t index = 0; index < _desc.keywords.size(); ++index)
+    {
+        if (_desc.keywords[index].name == keyword)
+        {
+            return static_cast<int32_t>(index);
+        }
+    }
+    return -1;
+}
+
+uint32_t ShaderPermutation::getValueIndex(ShaderVariantKey key, size_t keyword) const
+{
+    if (!_valid) return 0;
+    const ShaderVariantKey mask = (1ULL << _bits[keyword]) - 1;
+    return static_cast<uint32_t>((key >> _shifts[keyword]) & mask);
+}
+
+ShaderVariantKey ShaderPermutation::setKeyword(ShaderVariantKey key, const std::string& keyword, uint32_t valueIndex) const
+{
+    const int32_t index = findKeyword(keyword);
+    if (index < 0 || !_valid || valueIndex >= _desc.keywords[index].values.size())
+    {
+        LOGW("Shader permutation %s has no keyword %s with value %u\n", getName().c_str(), keyword.c_str(), valueIndex);
+        return key;
+    }
+    const ShaderVariantKey mask = ((1ULL << _bits[index]) - 1) << _shifts[index];
+    return (key & ~mask) | (static_cast<ShaderVariantKey>(valueIndex) << _shifts[index]);
+}
+
+ShaderVariantKey ShaderPermutation::setKeywordValue(ShaderVariantKey key, const std::string& keyword, const std::string& value) const
+{
+    const int32_t index = findKeyword(keyword);
+    if (index < 0)
+    {
+        LOGW("Shader permutation %s has no keyword %s\n", getName().c_str(), keyword.c_str());
+        return key;
+    }
+    const std::vector<std::string>& values = _desc.keywords[index].values;
+    const auto                      found  = std::find(values.begin(), values.end(), value);
+    return setKeyword(key, keyword, static_cast<uint32_t>(found - values.begin()));
+}
+
+uint32_t ShaderPermutation::getKeyword(ShaderVariantKey key, const std::string& keyword) const
+{
+    const int32_t index = findKeyword(keyword);
+    return index < 0 || !_valid ? 0 : getValueIndex(key, index);
+}
+
+ShaderVariantKey ShaderPermutation::getDefineKey(ShaderVariantKey key) const
+{
+    return key & ~_specializationMask;
+}
+
+std::string ShaderPermutation::getVariantName(ShaderVariantKey key) const
+{
+    return getName() + "#" + toHex(key);
+}
+
+std::string ShaderPermutation::getModuleName(ShaderVariantKey key) const
+{
+    // the shared module must not take the name of the variant with all specialization keywords at their first value
+    return hasSpecialization() ? getName() + "#d" + toHex(getDefineKey(key)) : getVariantName(key);
+}
+
+ShaderLoadRequest ShaderPermutation::getDefineRequest(ShaderVariantKey key) const
+{
+    ShaderLoadRequest request = _desc.request;
+    request.name              = getModuleName(key);
+    for (size_t index = 0; index < _desc.keywords.size(); ++index)
+    {
+        const ShaderKeyword& keyword = _desc.keywords[index];
+        if (keyword.mode == ShaderKeywordMode::eDefine)
+        {
+            request.defines.emplace_back(keyword.name, keyword.values[getValueIndex(key, index)]);
+        }
+    }
+    return request;
+}
+
+std::shared_ptr<const ShaderSpecialization> ShaderPermutation::createSpecialization(ShaderVariantKey key) const
+{
+    if (!hasSpecialization()) return nullptr;
+
+    std::vector<VkSpecializationMapEntry> entries;
+    std::vector<uint32_t>                 data;
+    for (size_t index = 0; index < _desc.keywords.size(); ++index)
+    {
+        const ShaderKeyword& keyword = _desc.keywords[index];
+        if (keyword.mode != ShaderKeywordMode::eSpecialization) continue;
+        entries.push_back({keyword.constantId, static_cast<uint32_t>(data.size() * sizeof(uint32_t)), sizeof(uint32_t)});
+        data.push_back(getValueIndex(key, index));
+    }
+    return std::make_shared<const ShaderSpecialization>(std::move(entries), std::move(data));
+}
+
+bool ShaderPermutation::parseVariantName(const std::string& variantName, ShaderVariantKey& key) const
+{
+    const std::string prefix = getName() + "#";
+    if (!_valid || !variantName.starts_with(prefix)) return false;
+
+    const char* first  = variantName.data() + prefix.size();
+    const char* last   = variantName.data() + variantName.size();
+    const auto  parsed = std::from_chars(first, last, key, 16);
+    if (first == last || parsed.ec != std::errc() || parsed.ptr != last) return false;
+    for (size_t index = 0; index < _desc.keywords.size(); ++index)
+    {
+        if (getValueIndex(key, index) >= _desc.keywords[index].values.size()) return false;
+    }
+    return getVariantName(key) == variantName;
+}
+
+} // namespace Play
@@ -0,0 +1,85 @@
+#ifndef SHADER_PERMUTATION_H
+#define SHADER_PERMUTATION_H
+#include "ShaderManager.hpp"
+namespace Play
+{
+enum class ShaderKeywordMode
+{
+    eDefine = 0,     // compiled into a module of its own, the variant is cached like any other define set
+    eSpecialization, // a specialization constant of one shared module, the driver strips the dead paths at pipeline creation
+};
+
+// a boolean keyword has the values 0 and 1, an enum keyword names its values. A define keyword is set to the value, a
+// specialization keyword to the index of the value
+struct ShaderKeyword
+{
+    std::string              name;
+    std::vector<std::string> values     = {"0", "1"};
+    ShaderKeywordMode        mode       = ShaderKeywordMode::eDefine;
+    uint32_t                 constantId = 0; // [vk::constant_id] of a specialization keyword
+};
+
+struct ShaderPermutationDesc
+{
+    ShaderLoadRequest          request; // the name and defines every variant starts from
+    std::vector<ShaderKeyword> keywords;
+};
+
+// the value indices of the keywords packed in declaration order, each in the bits its value count needs. Key 0 selects
+// the first value of every keyword
+class ShaderPermutation
+{
+public:
+    explicit ShaderPermutation(ShaderPermutationDesc desc);
+
+    // false if the keywords do not fit the key
+    bool isValid() const
+    {
+        return _valid;
+    }
+
+    const std::string& getName() const
+    {
+        return _desc.request.name;
+    }
+
+    const ShaderPermutationDesc& getDesc() const
+    {
+        return _desc;
+    }
+
+    bool hasSpecialization() const
+    {
+        return _specializationMask != 0;
+    }
+
+    // keywords the permutation does not declare and values past a keyword's last leave the key as it is
+    ShaderVariantKey setKeyword(ShaderVariantKey key, const std::string& keyword, uint32_t valueIndex) const;
+    ShaderVariantKey setKeywordValue(ShaderVariantKey key, const std::string& keyword, const std::string& value) const;
+    uint32_t         getKeyword(ShaderVariantKey key, const std::string& keyword) const;
+    // only the define keywords, the variants differing in specialization keywords share its module
+    ShaderVariantKey getDefineKey(ShaderVariantKey key) const;
+
+    std::string getVariantName(ShaderVariantKey key) const;
+    // the name of the module the variant is compiled into, the variant itself when there are no specialization keywords
+    std::string getModuleName(ShaderVariantKey key) const;
+    ShaderLoadRequest getDefineRequest(ShaderVariantKey key) const;
+    // null without specialization keywords
+    std::shared_ptr<const ShaderSpecialization> createSpecialization(ShaderVariantKey key) const;
+    // the variant a name from getVariantName selects, false for names of other shaders
+    bool parseVariantName(const std::string& variantName, ShaderVariantKey& key) const;
+
+private:
+    int32_t  findKeyword(const std::string& keyword) const;
+    uint32_t getValueIndex(ShaderVariantKey key, size_t keyword) const;
+
+    ShaderPermutationDesc _desc;
+    std::vector<uint32_t> _shifts;
+    std::vector<uint32_t> _bits;
+    ShaderVariantKey      _specializationMask = 0;
+    bool                  _valid              = true;
+};
+
+} // namespace Play
+
+#endif // SHADER_PERMUTATION_H
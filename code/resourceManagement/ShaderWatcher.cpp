@@ -0,0 +1,168 @@
+#include "ShaderWatcher.h"
+#include <chrono>
+#include <nvutils/logger.hpp>
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace Play
+{
+
+ShaderWatcher::ShaderWatcher(ChangedFunc&& onChanged) : _onChanged(std::move(onChanged))
+{
+    _thread = std::thread(&ShaderWatcher::watchLoop, this);
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+    stop();
+}
+
+void ShaderWatcher::stop()
+{
+    _stopping = true;
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+}
+
+void ShaderWatcher::watch(const std::vector<std::filesystem::path>& directories)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    for (const std::filesystem::path& directory : directories)
+    {
+        if (!directory.empty() && _directories.insert(directory).second)
+        {
+            _newDirectories.push_back(directory);
+        }
+    }
+}
+
+std::vector<std::filesystem::path> ShaderWatcher::takeNewDirectories()
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return std::exchange(_newDirectories, {});
+}
+
+void ShaderWatcher::snapshotDirectory(const std::filesystem::path& directory, std::unordered_map<std::string, int64_t>& writeTimes)
+{
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+    {
+        std::error_code fileEc;
+        if (!it->is_regular_file(fileEc)) continue;
+        const auto writeTime = it->last_write_time(fileEc);
+        if (fileEc) continue;
+        writeTimes[it->path().string()] = static_cast<int64_t>(writeTime.time_since_epoch().count());
+    }
+}
+
+void ShaderWatcher::watchLoop()
+{
+#if defined(__linux__)
+    if (inotifyLoop()) return;
+    LOGW("inotify is not available, shader sources are polled for changes\n");
+#endif
+    pollLoop();
+}
+
+void ShaderWatcher::flushChanges(std::set<std::filesystem::path>& changedFiles, std::chrono::steady_clock::time_point lastChange)
+{
+    if (changedFiles.empty() || std::chrono::steady_clock::now() - lastChange < std::chrono::milliseconds(kSettleMs)) return;
+    _onChanged(changedFiles);
+    changedFiles.clear();
+}
+
+bool ShaderWatcher::inotifyLoop()
+{
+#if defined(__linux__)
+    const int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    std::set<std::filesystem::path>                changedFiles;
+    std::chrono::steady_clock::time_point          lastChange = std::chrono::steady_clock::now();
+    std::unordered_map<int, std::filesystem::path> watchedDirectories;
+    alignas(inotify_event) char                    buffer[4096];
+    while (!_stopping)
+    {
+        for (const std::filesystem::path& directory : takeNewDirectories())
+        {
+            // written in place, or saved through a temporary file renamed over the source
+            const int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+            if (wd >= 0)
+            {
+                watchedDirectories[wd] = directory;
+            }
+        }
+
+        pollfd pollInfo = {fd, POLLIN, 0};
+        if (poll(&pollInfo, 1, static_cast<int>(kSettleMs)) > 0)
+        {
+            ssize_t length = 0;
+            while ((length = read(fd, buffer, sizeof(buffer))) > 0)
+            {
+                for (const char* cursor = buffer; cursor < buffer + length;)
+                {
+                    const inotify_event* event     = reinterpret_cast<const inotify_event*>(cursor);
+                    auto                 directory = watchedDirectories.find(event->wd);
+                    if (event->len > 0 && (event->mask & IN_ISDIR) == 0 && directory != watchedDirectories.end())
+                    {
+                        changedFiles.insert(directory->second / event->name);
+                    }
+                    cursor += sizeof(inotify_event) + event->len;
+                }
+                lastChange = std::chrono::steady_clock::now();
+            }
+        }
+        flushChanges(changedFiles, lastChange);
+    }
+    close(fd);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void ShaderWatcher::pollLoop()
+{
+    std::set<std::filesystem::path>          changedFiles;
+    std::chrono::steady_clock::time_point    lastChange = std::chrono::steady_clock::now();
+    std::vector<std::filesystem::path>       polledDirectories;
+    std::unordered_map<std::string, int64_t> writeTimes;
+    while (!_stopping)
+    {
+        for (std::filesystem::path& directory : takeNewDirectories())
+        {
+            snapshotDirectory(directory, writeTimes);
+            polledDirectories.push_back(std::move(directory));
+        }
+        for (uint32_t waited = 0; waited < kPollMs && !_stopping; waited += kSettleMs)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(kSettleMs));
+        }
+
+        std::unordered_map<std::string, int64_t> currentWriteTimes;
+        for (const std::filesystem::path& directory : polledDirectories)
+        {
+            snapshotDirectory(directory, currentWriteTimes);
+        }
+        for (const auto& [file, writeTime] : currentWriteTimes)
+        {
+            auto previous = writeTimes.find(file);
+            if (previous == writeTimes.end() || previous->second != writeTime)
+            {
+                changedFiles.insert(file);
+                lastChange = std::chrono::steady_clock::now() - std::chrono::milliseconds(kSettleMs);
+            }
+        }
+        writeTimes = std::move(currentWriteTimes);
+        flushChanges(changedFiles, lastChange);
+    }
+}
+
+} // namespace Play
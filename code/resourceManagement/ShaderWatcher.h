@@ -0,0 +1,56 @@
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <utility>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+namespace Play
+{
+// watches directories, not recursively, on a thread of its own and reports the files written in them. inotify on
+// Linux, elsewhere or when inotify is not available the directories are polled. Writes closer together than kSettleMs are reported as one change, an
+// editor saving through a temporary file then rebuilds once
+class ShaderWatcher
+{
+public:
+    using ChangedFunc = std::function<void(const std::set<std::filesystem::path>& changedFiles)>;
+
+    static constexpr uint32_t kSettleMs = 100;
+    static constexpr uint32_t kPollMs   = 500;
+
+    // onChanged runs on the watcher thread
+    explicit ShaderWatcher(ChangedFunc&& onChanged);
+    ~ShaderWatcher();
+    void stop();
+
+    // thread safe, directories watched already are skipped
+    void watch(const std::vector<std::filesystem::path>& directories);
+
+private:
+    void watchLoop();
+    // false when inotify is not available, nothing was watched then
+    bool inotifyLoop();
+    void pollLoop();
+    // reports the changed files once no write came for kSettleMs
+    void flushChanges(std::set<std::filesystem::path>& changedFiles, std::chrono::steady_clock::time_point lastChange);
+    // the directories added since the last call
+    std::vector<std::filesystem::path> takeNewDirectories();
+    // modification times of the regular files in a directory, the polling fallback compares two of them
+    static void snapshotDirectory(const std::filesystem::path& directory, std::unordered_map<std::string, int64_t>& writeTimes);
+
+    ChangedFunc                        _onChanged;
+    std::mutex                         _lock;
+    std::set<std::filesystem::path>    _directories;
+    std::vector<std::filesystem::path> _newDirectories;
+    std::atomic<bool>                  _stopping = false;
+    std::thread                        _thread;
+};
+
+} // namespace Play
+
+#endif // SHADER_WATCHER_H
@@ -0,0 +1,243 @@
+#include "TextureResidency.h"
+#include <algorithm>
+
+namespace Play
+{
+
+namespace
+{
+// past the coarsest mip of any texture
+constexpr uint32_t kMaxBias = 32;
+} // namespace
+
+void TextureResidencyManager::clear()
+{
+    _textures.clear();
+    _order.clear();
+    _visible.clear();
+    _frame         = 0;
+    _decodeReserve = 0;
+    _bias          = 0;
+    _pendingLoads  = 0;
+}
+
+uint32_t TextureResidencyManager::addTexture(uint32_t width, uint32_t height, uint32_t mipCount, uint32_t bytesPerTexel, uint64_t sourceBytes)
+{
+    Entry entry;
+    entry.width         = std::max(width, 1u);
+    entry.height        = std::max(height, 1u);
+    entry.mipCount      = std::max(mipCount, 1u);
+    entry.bytesPerTexel = bytesPerTexel;
+    while (entry.tailMip + 1 < entry.mipCount &&
+           std::max(entry.width >> entry.tailMip, entry.height >> entry.tailMip) > kTailExtent)
+    {
+        ++entry.tailMip;
+    }
+    entry.wantedMip   = entry.tailMip;
+    entry.targetMip   = entry.tailMip;
+    entry.decodeBytes = sourceBytes + 2 * static_cast<uint64_t>(entry.width) * entry.height * entry.bytesPerTexel;
+    _decodeReserve    = std::max(_decodeReserve, entry.decodeBytes);
+
+    _textures.push_back(entry);
+    return static_cast<uint32_t>(_textures.size() - 1);
+}
+
+void TextureResidencyManager::requestMip(uint32_t texture, uint32_t mip)
+{
+    Entry& entry       = _textures[texture];
+    entry.requestedMip = std::min(entry.requestedMip, mip);
+}
+
+uint64_t TextureResidencyManager::getChainBytes(const Entry& entry, uint32_t mip) const
+{
+    uint64_t bytes = 0;
+    for (uint32_t level = mip; level < entry.mipCount; ++level)
+    {
+        bytes += static_cast<uint64_t>(std::max(entry.width >> level, 1u)) * std::max(entry.height >> level, 1u) * entry.bytesPerTexel;
+    }
+    return bytes;
+}
+
+uint64_t TextureResidencyManager::getChainBytes(uint32_t texture, uint32_t mip) const
+{
+    return getChainBytes(_textures[texture], mip);
+}
+
+uint64_t TextureResidencyManager::getCommittedBytes(const Entry& entry) const
+{
+    // a load in flight is finer than what is resident and replaces it
+    const uint64_t decodeBytes = entry.pendingMip != kNotResident ? entry.decodeBytes : 0;
+    return getChainBytes(entry, std::min(entry.residentMip, entry.pendingMip)) + decodeBytes;
+}
+
+uint64_t TextureResidencyManager::getCommittedBytes() const
+{
+    uint64_t bytes = 0;
+    for (const Entry& entry : _textures)
+    {
+        bytes += getCommittedBytes(entry);
+    }
+    return bytes;
+}
+
+uint64_t TextureResidencyManager::getWantedBytes() const
+{
+    uint64_t bytes = 0;
+    for (const Entry& entry : _textures)
+    {
+        bytes += getChainBytes(entry, entry.wantedMip);
+    }
+    return bytes;
+}
+
+void TextureResidencyManager::update(uint64_t budgetBytes, uint32_t maxPendingLoads, std::vector<TextureResidencyChange>& changes)
+{
+    changes.clear();
+    ++_frame;
+
+    // a finer request is taken at once, a coarser one once the finer was not asked for again within the visible frames.
+    // The pixels sampling a texture vary from frame to frame, its mip does not follow them back and forth
+    for (Entry& entry : _textures)
+    {
+        if (entry.requestedMip != kNotResident)
+        {
+            const uint32_t mip = std::min(entry.requestedMip, entry.tailMip);
+            if (mip <= entry.wantedMip || _frame - entry.wantedFrame >= kVisibleFrames)
+            {
+                entry.wantedMip   = mip;
+                entry.wantedFrame = _frame;
+            }
+            entry.lastRequested = _frame;
+            entry.requestedMip  = kNotResident;
+        }
+        else if (!isVisible(entry))
+        {
+            entry.wantedMip = entry.tailMip;
+        }
+    }
+
+    // the least bias that fits the visible textures beside the tails of the others. Failed textures keep what they have
+    const uint64_t planBytes  = budgetBytes > _decodeReserve ? budgetBytes - _decodeReserve : 0;
+    uint64_t       fixedBytes = 0;
+    _visible.clear();
+    for (uint32_t index = 0; index < _textures.size(); ++index)
+    {
+        Entry& entry = _textures[index];
+        if (!entry.failed && isVisible(entry))
+        {
+            _visible.push_back(index);
+            continue;
+        }
+        entry.targetMip = entry.failed ? entry.residentMip : entry.tailMip;
+        fixedBytes += getChainBytes(entry, entry.targetMip);
+    }
+    uint64_t targetBytes = fixedBytes;
+    for (_bias = 0; _bias < kMaxBias; ++_bias)
+    {
+        targetBytes = fixedBytes;
+        for (uint32_t index : _visible)
+        {
+            Entry& entry    = _textures[index];
+            entry.targetMip = std::min(entry.wantedMip + _bias, entry.tailMip);
+            targetBytes += getChainBytes(entry, entry.targetMip);
+        }
+        if (targetBytes <= planBytes)
+        {
+            break;
+        }
+    }
+
+    _order.resize(_textures.size());
+    for (uint32_t index = 0; index < _order.size(); ++index)
+    {
+        _order[index] = index;
+    }
+    std::sort(_order.begin(), _order.end(),
+              [&](uint32_t lhs, uint32_t rhs)
+              {
+                  if (_textures[lhs].lastRequested != _textures[rhs].lastRequested)
+                  {
+                      return _textures[lhs].lastRequested > _textures[rhs].lastRequested;
+                  }
+                  return lhs < rhs;
+              });
+
+    // what is left of the budget keeps finer mips already resident, the ones asked for last first. Loads in flight
+    // cannot be evicted and always keep theirs
+    uint64_t spareBytes = planBytes > targetBytes ? planBytes - targetBytes : 0;
+    for (uint32_t index : _order)
+    {
+        Entry&         entry = _textures[index];
+        const uint32_t mip   = std::min(entry.residentMip, entry.pendingMip);
+        if (entry.failed || mip >= entry.targetMip)
+        {
+            continue;
+        }
+
+        const uint64_t extraBytes = getChainBytes(entry, mip) - getChainBytes(entry, entry.targetMip);
+        if (extraBytes <= spareBytes || entry.pendingMip != kNotResident)
+        {
+            spareBytes -= std::min(extraBytes, spareBytes);
+            entry.targetMip = mip;
+        }
+    }
+
+    for (uint32_t index : _order)
+    {
+        Entry& entry = _textures[index];
+        if (!entry.failed && entry.residentMip < entry.targetMip)
+        {
+            entry.residentMip = entry.targetMip;
+            changes.push_back({index, entry.targetMip, true});
+        }
+    }
+
+    // tails first, whatever the budget, then the finer mips in the order the textures were asked for
+    uint64_t committedBytes = getCommittedBytes();
+    for (const bool tails : {true, false})
+    {
+        for (uint32_t index : _order)
+        {
+            Entry& entry = _textures[index];
+            if (_pendingLoads >= maxPendingLoads)
+            {
+                return;
+            }
+            if (entry.failed || entry.pendingMip != kNotResident || (entry.residentMip == kNotResident) != tails ||
+                (!tails && entry.targetMip >= entry.residentMip))
+            {
+                continue;
+            }
+
+            const uint32_t mip       = tails ? entry.tailMip : entry.targetMip;
+            const uint64_t loadBytes = getChainBytes(entry, mip) - getChainBytes(entry, entry.residentMip) + entry.decodeBytes;
+            if (!tails && committedBytes + loadBytes > budgetBytes)
+            {
+                continue;
+            }
+
+            entry.pendingMip = mip;
+            committedBytes += loadBytes;
+            ++_pendingLoads;
+            changes.push_back({index, mip, false});
+        }
+    }
+}
+
+void TextureResidencyManager::completeLoad(uint32_t texture)
+{
+    Entry& entry      = _textures[texture];
+    entry.residentMip = entry.pendingMip;
+    entry.pendingMip  = kNotResident;
+    --_pendingLoads;
+}
+
+void TextureResidencyManager::failLoad(uint32_t texture)
+{
+    Entry& entry     = _textures[texture];
+    entry.pendingMip = kNotResident;
+    entry.failed     = true;
+    --_pendingLoads;
+}
+
+} // namespace Play
@@ -0,0 +1,136 @@
+#ifndef TEXTURE_RESIDENCY_H
+#define TEXTURE_RESIDENCY_H
+#include <cstdint>
+#include <vector>
+namespace Play
+{
+
+// the mips of a streamed texture are resident from its resident mip down to the last one, every change replaces the
+// whole chain
+struct TextureResidencyChange
+{
+    uint32_t texture = 0;
+    uint32_t mip     = 0;     // the finest mip resident once the change is applied
+    bool     evict   = false; // applied at once from the resident mips, a load streams in from the source and completes later
+};
+
+// decides which mips of which textures are resident under a memory budget, from the mips the renderer asks for. Every
+// texture keeps its tail, the mips up to kTailExtent texels, resident whatever the budget. Textures asked for within
+// kVisibleFrames get the mip they ask for, all of them coarser by the same bias when that does not fit. What is left of
+// the budget keeps the finer mips of the others in the order they were last asked for, the rest is evicted down to
+// what is wanted. A load decodes the whole source image whatever its mip, that working set counts as committed until
+// the load completes and the largest one is kept free of the targets, so a load always fits once the others are done.
+// Nothing here touches the GPU, the streamer applies the changes
+class TextureResidencyManager
+{
+public:
+    static constexpr uint32_t kNotResident   = ~0U;
+    static constexpr uint32_t kTailExtent    = 64;
+    static constexpr uint32_t kVisibleFrames = 30;
+
+    void     clear();
+    // sourceBytes is the encoded file a load holds while it decodes
+    uint32_t addTexture(uint32_t width, uint32_t height, uint32_t mipCount, uint32_t bytesPerTexel, uint64_t sourceBytes = 0);
+    // the feedback of a frame, the finest mip any pixel sampling the texture asked for. Coarser than the tail asks for it
+    void     requestMip(uint32_t texture, uint32_t mip);
+    // plans this frame's changes, evictions first. Loads stay pending until they complete or fail, no more than
+    // maxPendingLoads at a time
+    void     update(uint64_t budgetBytes, uint32_t maxPendingLoads, std::vector<TextureResidencyChange>& changes);
+    void     completeLoad(uint32_t texture);
+    // the texture keeps what it has and is never loaded again
+    void     failLoad(uint32_t texture);
+
+    uint32_t getResidentMip(uint32_t texture) const
+    {
+        return _textures[texture].residentMip;
+    }
+
+    uint32_t getTargetMip(uint32_t texture) const
+    {
+        return _textures[texture].targetMip;
+    }
+
+    uint32_t getTailMip(uint32_t texture) const
+    {
+        return _textures[texture].tailMip;
+    }
+
+    uint32_t getMipCount(uint32_t texture) const
+    {
+        return _textures[texture].mipCount;
+    }
+
+    // of the chain from the mip down, 0 for kNotResident
+    uint64_t getChainBytes(uint32_t texture, uint32_t mip) const;
+    // what a load of the texture holds while it decodes
+    uint64_t getDecodeBytes(uint32_t texture) const
+    {
+        return _textures[texture].decodeBytes;
+    }
+
+    // the largest decode of any texture, the targets are planned within the budget less it
+    uint64_t getDecodeReserve() const
+    {
+        return _decodeReserve;
+    }
+
+    // resident, and the targets and decodes of the pending loads
+    uint64_t getCommittedBytes() const;
+    // if every texture had what it wants
+    uint64_t getWantedBytes() const;
+
+    // the coarsening the textures asked for got on the last update to fit the budget
+    uint32_t getBias() const
+    {
+        return _bias;
+    }
+
+    uint32_t getPendingLoads() const
+    {
+        return _pendingLoads;
+    }
+
+    uint32_t size() const
+    {
+        return static_cast<uint32_t>(_textures.size());
+    }
+
+private:
+    struct Entry
+    {
+        uint32_t width         = 0;
+        uint32_t height        = 0;
+        uint32_t mipCount      = 0;
+        uint32_t bytesPerTexel = 0;
+        uint64_t decodeBytes   = 0; // the source file and twice the full resolution image
+        uint32_t tailMip       = 0;
+        uint32_t residentMip   = kNotResident;
+        uint32_t pendingMip    = kNotResident;
+        uint32_t requestedMip  = kNotResident; // this frame's feedback
+        uint32_t wantedMip     = 0;            // the finest asked for lately, the tail until feedback arrives
+        uint32_t targetMip     = 0;            // given by the last update
+        uint64_t wantedFrame   = 0;            // when the wanted mip was last asked for
+        uint64_t lastRequested = 0;            // frame, 0 when never
+        bool     failed        = false;
+    };
+
+    bool isVisible(const Entry& entry) const
+    {
+        return entry.lastRequested != 0 && _frame - entry.lastRequested < kVisibleFrames;
+    }
+
+    uint64_t getChainBytes(const Entry& entry, uint32_t mip) const;
+    uint64_t getCommittedBytes(const Entry& entry) const;
+
+    std::vector<Entry>    _textures;
+    std::vector<uint32_t> _order;   // by priority, reused every update
+    std::vector<uint32_t> _visible; // reused every update
+    uint64_t              _frame         = 0;
+    uint64_t              _decodeReserve = 0;
+    uint32_t              _bias          = 0;
+    uint32_t              _pendingLoads  = 0;
+};
+
+} // namespace Play
+
+#endif // TEXTURE_RESIDENCY_H
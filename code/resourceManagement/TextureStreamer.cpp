@@ -0,0 +1,599 @@
+#include "TextureStreamer.h"
+#include "PlayAllocator.h"
+#include "core/runtime/VulkanRuntime.h"
+#include "utils.hpp"
+#include "stb_image.h"
+#include "nvvk/mipmaps.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace Play
+{
+
+namespace
+{
+
+constexpr float kBytesPerMB = 1024.0f * 1024.0f;
+
+float srgbToLinear(uint8_t value)
+{
+    static const std::vector<float> table = []()
+    {
+        std::vector<float> values(256);
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            const float c = float(i) / 255.0f;
+            values[i]     = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return values;
+    }();
+    return table[value];
+}
+
+uint8_t linearToSrgb(float value)
+{
+    const float c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    return static_cast<uint8_t>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+}
+
+// sized the way the GPU sizes the next mip, every texel the average of the 2x2 it covers. sRGB colour is averaged linear
+template <typename T>
+void halveImage(const T* texels, uint32_t& width, uint32_t& height, uint32_t channels, bool srgb, std::vector<T>& half)
+{
+    const uint32_t halfWidth  = std::max(width / 2, 1u);
+    const uint32_t halfHeight = std::max(height / 2, 1u);
+    half.resize(size_t(halfWidth) * halfHeight * channels);
+    for (uint32_t y = 0; y < halfHeight; ++y)
+    {
+        const size_t row0 = size_t(std::min(y * 2, height - 1)) * width;
+        const size_t row1 = size_t(std::min(y * 2 + 1, height - 1)) * width;
+        for (uint32_t x = 0; x < halfWidth; ++x)
+        {
+            const size_t texel[4] = {row0 + std::min(x * 2, width - 1), row0 + std::min(x * 2 + 1, width - 1),
+                                     row1 + std::min(x * 2, width - 1), row1 + std::min(x * 2 + 1, width - 1)};
+            T*           dst      = &half[(size_t(y) * halfWidth + x) * channels];
+            for (uint32_t c = 0; c < channels; ++c)
+            {
+                if constexpr (std::is_floating_point_v<T>)
+                {
+                    dst[c] = (texels[texel[0] * channels + c] + texels[texel[1] * channels + c] + texels[texel[2] * channels + c] +
+                              texels[texel[3] * channels + c]) * 0.25f;
+                }
+                else if (srgb && c < 3)
+                {
+                    float sum = 0.0f;
+                    for (uint32_t i = 0; i < 4; ++i)
+                    {
+                        sum += srgbToLinear(static_cast<uint8_t>(texels[texel[i] * channels + c]));
+                    }
+                    dst[c] = static_cast<T>(linearToSrgb(sum * 0.25f));
+                }
+                else
+                {
+                    uint32_t sum = 2;
+                    for (uint32_t i = 0; i < 4; ++i)
+                    {
+                        sum += texels[texel[i] * channels + c];
+                    }
+                    dst[c] = static_cast<T>(sum / 4);
+                }
+            }
+        }
+    }
+    width  = halfWidth;
+    height = halfHeight;
+}
+
+// the first halving reads the decoded image in place, the working set stays within twice the full resolution image the
+// residency manager counts for the load
+template <typename T>
+void downsampleToMip(const T* data, int width, int height, uint32_t channels, uint32_t mip, bool srgb, std::vector<uint8_t>& pixels,
+                     uint32_t& mipWidth, uint32_t& mipHeight)
+{
+    mipWidth  = static_cast<uint32_t>(width);
+    mipHeight = static_cast<uint32_t>(height);
+    std::vector<T> texels, half;
+    for (uint32_t level = 0; level < mip; ++level)
+    {
+        halveImage(level == 0 ? data : texels.data(), mipWidth, mipHeight, channels, srgb, half);
+        texels.swap(half);
+    }
+    const T* mipData = mip == 0 ? data : texels.data();
+    pixels.resize(size_t(mipWidth) * mipHeight * channels * sizeof(T));
+    memcpy(pixels.data(), mipData, pixels.size());
+}
+
+} // namespace
+
+void TextureStreamer::clear()
+{
+    // the futures of the loads in flight wait for their decodes
+    _streams.clear();
+    _residency.clear();
+    _changes.clear();
+    _queued.clear();
+    for (std::vector<Replacement>& records : _cycleRecords)
+    {
+        records.clear();
+    }
+    for (std::vector<RefPtr<Buffer>>& staging : _cycleStaging)
+    {
+        staging.clear();
+    }
+    std::fill(_cycleRecorded.begin(), _cycleRecorded.end(), 0);
+    for (std::vector<uint32_t>& boundMips : _cycleBoundMips)
+    {
+        boundMips.clear();
+    }
+    _stats.StreamedTextures = 0;
+    _stats.LoadsInFlight    = 0;
+    _stats.FeedbackTextures = 0;
+    _stats.Bias             = 0;
+    _stats.ResidentMB       = 0.0f;
+    _stats.WantedMB         = 0.0f;
+}
+
+RefPtr<Texture> TextureStreamer::addTexture(uint32_t sceneTexture, const std::filesystem::path& sourcePath, uint32_t mipLevels, bool isSrgb,
+                                            TexturePlaceholder placeholder)
+{
+    if (sceneTexture >= kFeedbackSlots)
+    {
+        return {};
+    }
+
+    const std::string path  = nvutils::utf8FromPath(sourcePath);
+    int               width = 0, height = 0, comp = 0;
+    if (!stbi_info(path.c_str(), &width, &height, &comp) || width <= 0 || height <= 0)
+    {
+        LOGW("Failed to get info for %s\n", path.c_str());
+        return {};
+    }
+
+    // the formats the texture would load whole in
+    Stream   stream;
+    uint32_t bytesPerTexel = 0;
+    if (stbi_is_hdr(path.c_str()))
+    {
+        stream.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+        bytesPerTexel = sizeof(float) * 4;
+    }
+    else if (stbi_is_16_bit(path.c_str()))
+    {
+        stream.format = comp == 1 ? VK_FORMAT_R16_UNORM : VK_FORMAT_R16G16B16A16_UNORM;
+        bytesPerTexel = comp == 1 ? 2 : 8;
+    }
+    else
+    {
+        stream.format = comp == 1 ? VK_FORMAT_R8_UNORM : isSrgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+        bytesPerTexel = comp == 1 ? 1 : 4;
+    }
+
+    const VkExtent2D extent  = {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+    const uint32_t   maxMips = nvvk::mipLevels(extent);
+    stream.sceneTexture      = sceneTexture;
+    stream.sourcePath        = sourcePath;
+    stream.width             = extent.width;
+    stream.height            = extent.height;
+    stream.mipCount          = mipLevels == 0 || mipLevels > maxMips ? maxMips : mipLevels;
+    // every load holds the file while it decodes
+    std::error_code ec;
+    const uintmax_t fileBytes = std::filesystem::file_size(sourcePath, ec);
+    _residency.addTexture(stream.width, stream.height, stream.mipCount, bytesPerTexel, ec ? 0 : fileBytes);
+    _streams.push_back(std::move(stream));
+    return getPlaceholder(placeholder);
+}
+
+bool TextureStreamer::update(std::vector<RefPtr<Texture>>& sceneTextures)
+{
+    if (_streams.empty())
+    {
+        return false;
+    }
+
+    using Clock                   = std::chrono::steady_clock;
+    const Clock::time_point start = Clock::now();
+
+    if (!_feedbackBuffer)
+    {
+        createFeedbackBuffers();
+    }
+    const uint32_t frameCycle = vkDriver->getFrameCycleIndex();
+    const bool     replaced   = swapReplacements(frameCycle, sceneTextures);
+    readFeedback(frameCycle);
+
+    for (uint32_t texture = 0; texture < _streams.size(); ++texture)
+    {
+        Stream& stream = _streams[texture];
+        if (!stream.load.valid() || stream.load.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            continue;
+        }
+
+        Replacement load;
+        load.texture      = texture;
+        load.mip          = stream.loadingMip;
+        load.decoded      = stream.load.get();
+        stream.loadingMip = TextureResidencyManager::kNotResident;
+        _queued.push_back(std::move(load));
+    }
+
+    const uint64_t budgetBytes = uint64_t(_settings.BudgetMB) * 1024 * 1024;
+    _residency.update(budgetBytes, std::max(_settings.MaxLoadsInFlight, 1u), _changes);
+    for (const TextureResidencyChange& change : _changes)
+    {
+        Stream& stream = _streams[change.texture];
+        if (change.evict)
+        {
+            // the resident image is bound until the copy was fenced, the copy reads the mips it still has
+            Replacement eviction;
+            eviction.texture     = change.texture;
+            eviction.mip         = change.mip;
+            eviction.evict       = true;
+            eviction.resident    = sceneTextures[stream.sceneTexture];
+            eviction.residentMip = stream.boundMip;
+            _queued.push_back(std::move(eviction));
+            ++_stats.Evicted;
+        }
+        else
+        {
+            stream.loadingMip = change.mip;
+            stream.load       = std::async(std::launch::async, &TextureStreamer::decodeMip, stream.sourcePath, stream.format, change.mip);
+        }
+    }
+
+    // the feedback this frame writes is read against the mips it samples
+    std::vector<uint32_t>& boundMips = _cycleBoundMips[frameCycle];
+    boundMips.resize(_streams.size());
+    for (uint32_t texture = 0; texture < _streams.size(); ++texture)
+    {
+        boundMips[texture] = _streams[texture].boundMip;
+    }
+
+    _stats.StreamedTextures = _residency.size();
+    _stats.LoadsInFlight    = _residency.getPendingLoads();
+    _stats.Bias             = _residency.getBias();
+    _stats.ResidentMB       = static_cast<float>(_residency.getCommittedBytes()) / kBytesPerMB;
+    _stats.WantedMB         = static_cast<float>(_residency.getWantedBytes()) / kBytesPerMB;
+    _stats.UpdateMs         = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+    return replaced;
+}
+
+bool TextureStreamer::swapReplacements(uint32_t frameCycle, std::vector<RefPtr<Texture>>& sceneTextures)
+{
+    // the frame cycle was fenced in prepareFrame, the uploads and copies its last frame recorded are complete. The scene
+    // set is update after bind, the replaced images are destroyed once the frames still sampling them are complete
+    bool replaced = false;
+    for (Replacement& record : _cycleRecords[frameCycle])
+    {
+        Stream& stream = _streams[record.texture];
+        if (!record.evict)
+        {
+            _residency.completeLoad(record.texture);
+            ++_stats.StreamedIn;
+        }
+        sceneTextures[stream.sceneTexture] = std::move(record.replacement);
+        stream.boundMip                    = record.mip;
+        replaced                           = true;
+    }
+    _cycleRecords[frameCycle].clear();
+    _cycleStaging[frameCycle].clear();
+    return replaced;
+}
+
+void TextureStreamer::cmdStreamTextures(VkCommandBuffer cmd)
+{
+    if (_queued.empty())
+    {
+        return;
+    }
+
+    const uint32_t frameCycle = vkDriver->getFrameCycleIndex();
+    for (Replacement& record : _queued)
+    {
+        const Stream& stream = _streams[record.texture];
+        if (record.evict)
+        {
+            record.replacement = cmdEvictTexture(cmd, stream, *record.resident, record.residentMip, record.mip);
+            record.resident    = {};
+        }
+        else
+        {
+            // a file changed since it was registered no longer fits the chain
+            const bool fits = !record.decoded.pixels.empty() && record.decoded.width == std::max(stream.width >> record.mip, 1u) &&
+                              record.decoded.height == std::max(stream.height >> record.mip, 1u);
+            RefPtr<Buffer> staging;
+            record.replacement = fits ? cmdCreateTexture(cmd, stream, record.decoded, record.mip, staging) : RefPtr<Texture>();
+            record.decoded     = {};
+            if (!record.replacement)
+            {
+                LOGW("Failed to stream mip %u of %s\n", record.mip, nvutils::utf8FromPath(stream.sourcePath).c_str());
+                _residency.failLoad(record.texture);
+                ++_stats.FailedLoads;
+                continue;
+            }
+            _cycleStaging[frameCycle].push_back(std::move(staging));
+        }
+        _cycleRecords[frameCycle].push_back(std::move(record));
+    }
+    _queued.clear();
+}
+
+void TextureStreamer::cmdResolveFeedback(VkCommandBuffer cmd)
+{
+    if (!_feedbackBuffer)
+    {
+        return;
+    }
+
+    const uint32_t     frameCycle = vkDriver->getFrameCycleIndex();
+    const VkDeviceSize bytes      = sizeof(uint32_t) * kFeedbackSlots;
+
+    VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    barrier.srcAccessMask   = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask   = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+    VkBufferCopy region = {0, bytes * frameCycle, bytes};
+    vkCmdCopyBuffer(cmd, _feedbackBuffer->buffer, _feedbackReadback->buffer, 1, &region);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+    vkCmdFillBuffer(cmd, _feedbackBuffer->buffer, 0, bytes, ~0U);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier,
+                         0, NULL, 0, NULL);
+    _cycleRecorded[frameCycle] = 1;
+}
+
+TextureStreamer::DecodedMip TextureStreamer::decodeMip(std::filesystem::path sourcePath, VkFormat format, uint32_t mip)
+{
+    DecodedMip        decoded;
+    const std::string fileContents = nvutils::loadFile(sourcePath);
+    if (fileContents.empty() || fileContents.size() > std::numeric_limits<int>::max())
+    {
+        return decoded;
+    }
+
+    const stbi_uc* fileData = reinterpret_cast<const stbi_uc*>(fileContents.data());
+    const int      fileSize = static_cast<int>(fileContents.size());
+    int            width = 0, height = 0, comp = 0;
+    switch (format)
+    {
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+        {
+            float* data = stbi_loadf_from_memory(fileData, fileSize, &width, &height, &comp, 4);
+            if (data)
+            {
+                downsampleToMip(data, width, height, 4, mip, false, decoded.pixels, decoded.width, decoded.height);
+            }
+            stbi_image_free(data);
+            break;
+        }
+        case VK_FORMAT_R16_UNORM:
+        case VK_FORMAT_R16G16B16A16_UNORM:
+        {
+            const uint32_t channels = format == VK_FORMAT_R16_UNORM ? 1 : 4;
+            stbi_us*       data     = stbi_load_16_from_memory(fileData, fileSize, &width, &height, &comp, channels);
+            if (data)
+            {
+                downsampleToMip(data, width, height, channels, mip, false, decoded.pixels, decoded.width, decoded.height);
+            }
+            stbi_image_free(data);
+            break;
+        }
+        default:
+        {
+            const uint32_t channels = format == VK_FORMAT_R8_UNORM ? 1 : 4;
+            stbi_uc*       data     = stbi_load_from_memory(fileData, fileSize, &width, &height, &comp, channels);
+            if (data)
+            {
+                downsampleToMip(data, width, height, channels, mip, format == VK_FORMAT_R8G8B8A8_SRGB, decoded.pixels, decoded.width,
+                                decoded.height);
+            }
+            stbi_image_free(data);
+            break;
+        }
+    }
+    return decoded;
+}
+
+void TextureStreamer::readFeedback(uint32_t frameCycle)
+{
+    if (!_cycleRecorded[frameCycle])
+    {
+        return;
+    }
+    _cycleRecorded[frameCycle] = 0;
+
+    // the frame cycle was fenced in prepareFrame, the copy recorded by its last frame is complete. Textures registered
+    // since that frame have no feedback in it
+    const uint32_t*              lods      = reinterpret_cast<const uint32_t*>(_feedbackReadback->mapping) + frameCycle * kFeedbackSlots;
+    const std::vector<uint32_t>& boundMips = _cycleBoundMips[frameCycle];
+    uint32_t                     sampled   = 0;
+    for (uint32_t texture = 0; texture < boundMips.size(); ++texture)
+    {
+        const uint32_t lod = lods[_streams[texture].sceneTexture];
+        if (lod == ~0U)
+        {
+            continue;
+        }
+        ++sampled;
+
+        // the lod a placeholder was sampled at says nothing of the texture, only that it is visible
+        if (boundMips[texture] == TextureResidencyManager::kNotResident)
+        {
+            _residency.requestMip(texture, _residency.getTailMip(texture));
+            continue;
+        }
+        const int32_t mip = int32_t(boundMips[texture]) + int32_t(lod) - int32_t(kFeedbackLodOffset) + _settings.MipBias;
+        _residency.requestMip(texture, static_cast<uint32_t>(std::clamp(mip, 0, int32_t(_streams[texture].mipCount) - 1)));
+    }
+    _stats.FeedbackTextures = sampled;
+}
+
+void TextureStreamer::createFeedbackBuffers()
+{
+    const uint32_t     frameCycleSize = vkDriver->getFrameCycleSize();
+    const VkDeviceSize bytes          = sizeof(uint32_t) * kFeedbackSlots;
+    _feedbackBuffer   = RefPtr<Buffer>(new Buffer("TextureFeedback",
+                                                  VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_SRC_BIT |
+                                                      VK_BUFFER_USAGE_2_TRANSFER_DST_BIT | VK_BUFFER_USAGE_2_SHADER_DEVICE_ADDRESS_BIT,
+                                                  bytes, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+    _feedbackReadback = RefPtr<Buffer>(new Buffer("TextureFeedbackReadback", VK_BUFFER_USAGE_2_TRANSFER_DST_BIT, bytes * frameCycleSize,
+                                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+    _cycleBoundMips.assign(frameCycleSize, {});
+    _cycleRecorded.assign(frameCycleSize, 0);
+    _cycleRecords.assign(frameCycleSize, {});
+    _cycleStaging.assign(frameCycleSize, {});
+
+    VkCommandBuffer cmd = PlayResourceManager::Instance().getTempCommandBuffer();
+    vkCmdFillBuffer(cmd, _feedbackBuffer->buffer, 0, bytes, ~0U);
+    PlayResourceManager::Instance().submitAndWaitTempCmdBuffer(cmd);
+}
+
+RefPtr<Texture> TextureStreamer::getPlaceholder(TexturePlaceholder placeholder)
+{
+    RefPtr<Texture>& texture = _placeholders[static_cast<uint32_t>(placeholder)];
+    if (texture)
+    {
+        return texture;
+    }
+
+    static constexpr uint8_t kTexels[][4] = {{255, 255, 255, 255}, {128, 128, 255, 255}, {0, 0, 0, 255}};
+    texture                               = RefPtr<Texture>(new Texture(1, 1, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT));
+    texture->DebugName()                  = "TexturePlaceholder";
+
+    VkCommandBuffer cmd = PlayResourceManager::Instance().getTempCommandBuffer();
+    PlayResourceManager::Instance().appendImage(*texture, sizeof(kTexels[0]), kTexels[static_cast<uint32_t>(placeholder)],
+                                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    PlayResourceManager::Instance().cmdUploadAppended(cmd);
+    PlayResourceManager::Instance().submitAndWaitTempCmdBuffer(cmd);
+    PlayResourceManager::Instance().releaseStaging(true);
+    PlayResourceManager::Instance().acquireSampler(texture->descriptor.sampler);
+    texture->Layout() = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    return texture;
+}
+
+RefPtr<Texture> TextureStreamer::cmdCreateTexture(VkCommandBuffer cmd, const Stream& stream, const DecodedMip& decoded, uint32_t mip,
+                                                  RefPtr<Buffer>& staging)
+{
+    const uint32_t  levels = stream.mipCount - mip;
+    RefPtr<Texture> texture(new Texture(decoded.width, decoded.height, stream.format, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_UNDEFINED, levels));
+    if (!texture->isValid())
+    {
+        return {};
+    }
+    texture->DebugName() = nvutils::utf8FromPath(stream.sourcePath);
+
+    // the shared staging uploader is released whole after every blocking submit, the frame keeps its own
+    staging = RefPtr<Buffer>(new Buffer("TextureStreamingStaging", VK_BUFFER_USAGE_2_TRANSFER_SRC_BIT, decoded.pixels.size(),
+                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+    if (!staging->mapping)
+    {
+        return {};
+    }
+    memcpy(staging->mapping, decoded.pixels.data(), decoded.pixels.size());
+
+    VkImageMemoryBarrier2 barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+    barrier.image            = texture->image;
+    barrier.oldLayout        = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout        = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcStageMask     = VK_PIPELINE_STAGE_2_NONE;
+    barrier.srcAccessMask    = VK_ACCESS_2_NONE;
+    barrier.dstStageMask     = VK_PIPELINE_STAGE_2_COPY_BIT;
+    barrier.dstAccessMask    = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, levels, 0, 1};
+    VkDependencyInfo info{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    info.imageMemoryBarrierCount = 1;
+    info.pImageMemoryBarriers    = &barrier;
+    vkCmdPipelineBarrier2(cmd, &info);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent      = {decoded.width, decoded.height, 1};
+    vkCmdCopyBufferToImage(cmd, staging->buffer, texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    // the layout the mip generation starts from and returns the chain to
+    barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcStageMask  = VK_PIPELINE_STAGE_2_COPY_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barrier.dstStageMask  = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_SHADER_READ_BIT;
+    vkCmdPipelineBarrier2(cmd, &info);
+    nvvk::cmdGenerateMipmaps(cmd, texture->image, {decoded.width, decoded.height}, levels, 1, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    PlayResourceManager::Instance().acquireSampler(texture->descriptor.sampler);
+    texture->Layout() = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    return texture;
+}
+
+RefPtr<Texture> TextureStreamer::cmdEvictTexture(VkCommandBuffer cmd, const Stream& stream, const Texture& resident, uint32_t residentMip,
+                                                 uint32_t mip)
+{
+    const uint32_t  levels    = stream.mipCount - mip;
+    const uint32_t  firstCopy = mip - residentMip; // of the resident image
+    const uint32_t  width     = std::max(stream.width >> mip, 1u);
+    const uint32_t  height    = std::max(stream.height >> mip, 1u);
+    RefPtr<Texture> texture(new Texture(width, height, stream.format, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_UNDEFINED, levels));
+    texture->DebugName() = nvutils::utf8FromPath(stream.sourcePath);
+
+    // the resident image stays bound until the copy was fenced, the frames before may still sample it
+    VkImageMemoryBarrier2 barriers[2] = {{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2}, {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2}};
+    barriers[0].image                 = resident.image;
+    barriers[0].oldLayout             = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[0].newLayout             = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barriers[0].srcStageMask          = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    barriers[0].srcAccessMask         = VK_ACCESS_2_MEMORY_WRITE_BIT;
+    barriers[0].dstStageMask          = VK_PIPELINE_STAGE_2_COPY_BIT;
+    barriers[0].dstAccessMask         = VK_ACCESS_2_TRANSFER_READ_BIT;
+    barriers[0].subresourceRange      = {VK_IMAGE_ASPECT_COLOR_BIT, firstCopy, levels, 0, 1};
+    barriers[1].image                 = texture->image;
+    barriers[1].oldLayout             = VK_IMAGE_LAYOUT_UNDEFINED;
+    barriers[1].newLayout             = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[1].srcStageMask          = VK_PIPELINE_STAGE_2_NONE;
+    barriers[1].srcAccessMask         = VK_ACCESS_2_NONE;
+    barriers[1].dstStageMask          = VK_PIPELINE_STAGE_2_COPY_BIT;
+    barriers[1].dstAccessMask         = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barriers[1].subresourceRange      = {VK_IMAGE_ASPECT_COLOR_BIT, 0, levels, 0, 1};
+    VkDependencyInfo info{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    info.imageMemoryBarrierCount = 2;
+    info.pImageMemoryBarriers    = barriers;
+    vkCmdPipelineBarrier2(cmd, &info);
+
+    std::vector<VkImageCopy> regions(levels);
+    for (uint32_t level = 0; level < levels; ++level)
+    {
+        regions[level].srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, firstCopy + level, 0, 1};
+        regions[level].dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+        regions[level].extent         = {std::max(width >> level, 1u), std::max(height >> level, 1u), 1};
+    }
+    vkCmdCopyImage(cmd, resident.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levels,
+                   regions.data());
+
+    // both go back to sampling, the resident image until the scene texture is replaced
+    barriers[0].oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barriers[0].newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[0].srcStageMask  = VK_PIPELINE_STAGE_2_COPY_BIT;
+    barriers[0].srcAccessMask = VK_ACCESS_2_NONE;
+    barriers[0].dstStageMask  = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    barriers[0].dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
+    barriers[1].oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[1].newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[1].srcStageMask  = VK_PIPELINE_STAGE_2_COPY_BIT;
+    barriers[1].srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barriers[1].dstStageMask  = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    barriers[1].dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
+    vkCmdPipelineBarrier2(cmd, &info);
+
+    PlayResourceManager::Instance().acquireSampler(texture->descriptor.sampler);
+    texture->Layout() = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    return texture;
+}
+
+} // namespace Play
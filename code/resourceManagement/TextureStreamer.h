@@ -0,0 +1,152 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+#include "Resource.h"
+#include "TextureResidency.h"
+#include <filesystem>
+#include <future>
+namespace Play
+{
+
+struct TextureStreamingSettings
+{
+    bool     Streaming        = true; // off, the scene textures registered afterwards load whole
+    uint32_t BudgetMB         = 512;  // for the streamed textures, resident and loading
+    uint32_t MaxLoadsInFlight = 4;    // decoded on background threads
+    int32_t  MipBias          = 0;    // added to the mips the feedback asks for, positive streams coarser
+};
+
+struct TextureStreamingStats
+{
+    uint32_t StreamedTextures = 0;
+    uint32_t LoadsInFlight    = 0;
+    uint32_t FeedbackTextures = 0;    // sampled by the frame whose feedback was read last
+    uint32_t Bias             = 0;    // mips the visible textures stream coarser than asked to fit the budget
+    float    ResidentMB       = 0.0f; // and loading, with the decodes of the loads in flight
+    float    WantedMB         = 0.0f; // if every texture had the mips its feedback asks for
+    uint32_t StreamedIn       = 0;
+    uint32_t Evicted          = 0;
+    uint32_t FailedLoads      = 0;
+    float    UpdateMs         = 0.0f; // the uploads and copies are recorded with the frame
+};
+
+// what a streamed scene texture shows until its tail is resident
+enum class TexturePlaceholder : uint32_t
+{
+    eWhite,
+    eFlatNormal,
+    eBlack
+};
+
+// streams the mips of scene textures from their image files. A texture starts on a 1x1 placeholder, loads its tail and
+// then the mips the GBuffer asks for through the feedback buffer, the finest lod any 4x4 pixel block sampled it at. A
+// load decodes the whole file on a background thread and downsamples it to the mip, the GPU generates the coarser ones.
+// The decode is counted against the budget until the load completes. An eviction copies the coarser mips of the
+// resident image to a smaller one. Both are recorded into the frame and replace
+// the scene texture once the frame was fenced, the residency manager decides which happen
+class TextureStreamer
+{
+public:
+    static constexpr uint32_t kFeedbackSlots     = 1024; // one per scene texture the descriptor array holds
+    static constexpr uint32_t kFeedbackLodOffset = 16;   // the shaders store the lod plus it, clamped to [0, 31]
+
+    void clear();
+
+    // registers the file for streaming into the scene texture and returns the placeholder to bind to it until the tail
+    // is resident. Null when stb cannot read the file, nothing is registered then
+    RefPtr<Texture> addTexture(uint32_t sceneTexture, const std::filesystem::path& sourcePath, uint32_t mipLevels, bool isSrgb,
+                               TexturePlaceholder placeholder);
+
+    // once per frame after the frame cycle was fenced: swaps in the textures its last frame uploaded, reads its feedback,
+    // queues the finished loads and the evictions and starts the planned loads. True when a scene texture was replaced
+    bool update(std::vector<RefPtr<Texture>>& sceneTextures);
+
+    // after the GBuffer draws: copies the feedback to the frame cycle's readback and resets it
+    void cmdResolveFeedback(VkCommandBuffer cmd);
+
+    // records the uploads and copies update queued, the scene textures keep the old images until the frame was fenced
+    void cmdStreamTextures(VkCommandBuffer cmd);
+
+    // the GBuffer folds the lods it samples into it, 0 while nothing streams
+    uint64_t getFeedbackAddress() const
+    {
+        return _feedbackBuffer ? _feedbackBuffer->address : 0;
+    }
+
+    TextureStreamingSettings& getSettings()
+    {
+        return _settings;
+    }
+
+    TextureStreamingStats& getStats()
+    {
+        return _stats;
+    }
+
+private:
+    // a background decode of the chain from a mip down
+    struct DecodedMip
+    {
+        uint32_t             width  = 0;
+        uint32_t             height = 0;
+        std::vector<uint8_t> pixels;
+    };
+
+    struct Stream
+    {
+        uint32_t                sceneTexture = 0;
+        std::filesystem::path   sourcePath;
+        VkFormat                format       = VK_FORMAT_UNDEFINED;
+        uint32_t                width        = 0;
+        uint32_t                height       = 0;
+        uint32_t                mipCount     = 0;
+        uint32_t                boundMip     = TextureResidencyManager::kNotResident; // of the scene texture, the placeholder's
+        uint32_t                loadingMip   = TextureResidencyManager::kNotResident;
+        std::future<DecodedMip> load;
+    };
+
+    // a finished load or an eviction, queued by update, recorded by cmdStreamTextures and swapped in by the update after
+    // its frame cycle was fenced
+    struct Replacement
+    {
+        uint32_t        texture     = 0; // of the residency manager
+        uint32_t        mip         = 0;
+        bool            evict       = false;
+        DecodedMip      decoded;         // of a load, released once recorded
+        RefPtr<Texture> resident;        // the image an eviction copies from
+        uint32_t        residentMip = 0; // its finest mip
+        RefPtr<Texture> replacement;     // once recorded
+    };
+
+    // on a background thread, no pixels when the file cannot be decoded
+    static DecodedMip decodeMip(std::filesystem::path sourcePath, VkFormat format, uint32_t mip);
+
+    void            readFeedback(uint32_t frameCycle);
+    bool            swapReplacements(uint32_t frameCycle, std::vector<RefPtr<Texture>>& sceneTextures);
+    void            createFeedbackBuffers();
+    RefPtr<Texture> getPlaceholder(TexturePlaceholder placeholder);
+    // records the upload of a decoded chain into a new texture, through a staging buffer held until the frame was fenced
+    RefPtr<Texture> cmdCreateTexture(VkCommandBuffer cmd, const Stream& stream, const DecodedMip& decoded, uint32_t mip, RefPtr<Buffer>& staging);
+    // records the copy of the resident chain, from residentMip down, from a coarser mip into a new texture
+    RefPtr<Texture> cmdEvictTexture(VkCommandBuffer cmd, const Stream& stream, const Texture& resident, uint32_t residentMip, uint32_t mip);
+
+    TextureStreamingSettings _settings;
+    TextureStreamingStats    _stats;
+
+    TextureResidencyManager             _residency;
+    std::vector<Stream>                 _streams; // by residency manager texture
+    std::vector<TextureResidencyChange> _changes; // reused every update
+    RefPtr<Texture>                     _placeholders[3];
+
+    RefPtr<Buffer>                     _feedbackBuffer;   // the lod per scene texture slot, ~0 when not sampled
+    RefPtr<Buffer>                     _feedbackReadback; // a copy of it per frame cycle
+    std::vector<std::vector<uint32_t>> _cycleBoundMips;   // by frame cycle and stream, the mips its frame sampled
+    std::vector<uint8_t>               _cycleRecorded;    // by frame cycle, its frame copied feedback
+
+    std::vector<Replacement>                 _queued;       // for this frame to record
+    std::vector<std::vector<Replacement>>    _cycleRecords; // by frame cycle, the replacements its last frame recorded
+    std::vector<std::vector<RefPtr<Buffer>>> _cycleStaging; // by frame cycle, the uploads its last frame read from
+};
+
+} // namespace Play
+
+#endif // TEXTURE_STREAMER_H
@@ -22,9 +22,13 @@ struct CameraData
     float4x4 invViewMatrix;
     float4x4 invProjMatrix;
     float4x4 invViewProjMatrix;
+    // projection and viewProj carry the temporal jitter, these two do not and describe where the surfaces really are
+    float4x4 unjitteredViewProjMatrix;
+    float4x4 prevViewProjMatrix;
     float3   cameraPosition;
     float2   viewPortSize;
     float    WorldTime;
+    float2   jitter; // render target pixels
 };
 
 #endif // HDEVICE_H
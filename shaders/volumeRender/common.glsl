@@ -83,6 +83,9 @@ struct VolumeUniform
     vec3  CameraPos;
     vec3  BBoxMin;
     vec3  BBoxMax;
+    vec3  BrickScale;
+    uvec3 BrickCount;
+    uint  SkipEmptySpace;
 };
 
 struct AABB
@@ -0,0 +1,45 @@
+#ifndef __EMPTY_SPACE_H__
+#define __EMPTY_SPACE_H__
+// brick grid empty space skipping, include after volumeUniform and the brickMajorants buffer are declared
+
+const uint kMaxBrickSkips = 64;
+
+vec3 GetTexcoordDirection(vec3 direction, AABB aabb)
+{
+    const vec3 raw = direction / (aabb.Max - aabb.Min);
+    return vec3(-raw.x, raw.z, raw.y);
+}
+
+float GetBrickMajorant(ivec3 brick)
+{
+    const ivec3 brickCount = ivec3(volumeUniform.BrickCount);
+    return brickMajorants[(brick.z * brickCount.y + brick.y) * brickCount.x + brick.x];
+}
+
+// advances t over bricks whose majorant is zero, in whole steps so the sample positions stay the same as without
+// skipping and the estimate is unchanged. The texture space ray shares the parameter t with the world space ray
+float SkipEmptyBricks(vec3 texOrigin, vec3 texDirection, float t, float maxT, float stepSize)
+{
+    if (volumeUniform.SkipEmptySpace == 0)
+    {
+        return t;
+    }
+    const vec3 gridOrigin    = texOrigin * volumeUniform.BrickScale;
+    const vec3 gridDirection = texDirection * volumeUniform.BrickScale;
+    const vec3 safeDirection = mix(gridDirection, vec3(FLT_EPSILON), lessThan(abs(gridDirection), vec3(FLT_EPSILON)));
+    for (uint skip = 0; skip < kMaxBrickSkips && t <= maxT; ++skip)
+    {
+        const ivec3 brick = clamp(ivec3(floor(gridOrigin + t * gridDirection)), ivec3(0), ivec3(volumeUniform.BrickCount) - 1);
+        if (GetBrickMajorant(brick) > 0.0)
+        {
+            break;
+        }
+        const vec3  boundary = vec3(brick) + step(vec3(0.0), safeDirection);
+        const vec3  axisExit = (boundary - gridOrigin) / safeDirection;
+        const float exitT    = min(axisExit.x, min(axisExit.y, axisExit.z));
+        t += max(ceil((exitT - t) / stepSize), 1.0) * stepSize;
+    }
+    return t;
+}
+
+#endif // __EMPTY_SPACE_H__
@@ -0,0 +1,202 @@
+#include "PlayGroundTests.h"
+#include "DescriptorBufferAllocator.h"
+#include "DescriptorSetLRU.h"
+#include <map>
+#include <nvutils/logger.hpp>
+
+namespace Play::Tests
+{
+
+namespace
+{
+struct FakeDescriptorPools
+{
+    std::map<VkDescriptorPool, uint32_t> liveSets; // by pool
+    uint32_t                             maxSets    = 0;
+    uint64_t                             nextHandle = 1;
+    uint32_t                             resets     = 0;
+    bool                                 misused    = false; // a pool overflowed or freed a set it did not hold
+
+    uint32_t totalLiveSets() const
+    {
+        uint32_t total = 0;
+        for (const auto& [pool, count] : liveSets)
+        {
+            total += count;
+        }
+        return total;
+    }
+};
+
+// counts the sets of every pool instead of creating any
+class FakeDescriptorPoolAllocator : public DescriptorPoolAllocator
+{
+public:
+    explicit FakeDescriptorPoolAllocator(FakeDescriptorPools& pools) : _pools(pools) {}
+
+    VkDescriptorPool createPool(uint32_t maxSets) override
+    {
+        VkDescriptorPool pool = makeFakeHandle<VkDescriptorPool>(_pools.nextHandle++);
+        _pools.liveSets[pool] = 0;
+        _pools.maxSets        = maxSets;
+        return pool;
+    }
+
+    void destroyPool(VkDescriptorPool pool) override
+    {
+        const bool destroyed = _pools.liveSets.erase(pool) != 0;
+        _pools.misused       = _pools.misused || !destroyed;
+    }
+
+    void resetPool(VkDescriptorPool pool) override
+    {
+        _pools.liveSets[pool] = 0;
+        ++_pools.resets;
+    }
+
+    VkDescriptorSet allocateSet(VkDescriptorPool pool, VkDescriptorSetLayout layout) override
+    {
+        uint32_t& count = _pools.liveSets[pool];
+        ++count;
+        _pools.misused = _pools.misused || count > _pools.maxSets;
+        return makeFakeHandle<VkDescriptorSet>(_pools.nextHandle++);
+    }
+
+    void freeSet(VkDescriptorPool pool, VkDescriptorSet set) override
+    {
+        uint32_t& count = _pools.liveSets[pool];
+        _pools.misused  = _pools.misused || count == 0;
+        count           = count > 0 ? count - 1 : 0;
+    }
+
+private:
+    FakeDescriptorPools& _pools;
+};
+} // namespace
+
+// drives the cache against a fake allocator: hits, pool recycling, the cap, sets still in flight and pool ownership
+bool descriptorSetLRUSelfTest()
+{
+    TestCases test;
+
+    constexpr uint32_t  kFramesInFlight = 2;
+    constexpr uint32_t  kNoStaleness    = 1000;
+    constexpr uint32_t  kNoCap          = 1000;
+    FakeDescriptorPools fakePools;
+    {
+        DescriptorSetLRU cache(std::make_unique<FakeDescriptorPoolAllocator>(fakePools));
+        auto             request = [&cache](uint64_t bindingsHash, uint64_t frame)
+        {
+            VkDescriptorSet set = cache.find(bindingsHash, frame);
+            return set != VK_NULL_HANDLE ? set : cache.allocate(bindingsHash, frame, VK_NULL_HANDLE);
+        };
+        auto consistent = [&cache, &fakePools]()
+        {
+            const DescriptorSetLRUStats& stats = cache.getStats();
+            return !fakePools.misused && fakePools.totalLiveSets() == stats.liveSets && fakePools.liveSets.size() == stats.pools;
+        };
+
+        // 40 sets fill one pool and part of a second
+        for (uint64_t hash = 0; hash < 40; ++hash)
+        {
+            request(hash, 0);
+        }
+        const VkDescriptorSet firstSet = cache.find(0, 1);
+        cache.evict(2, kFramesInFlight, 8, kNoCap);
+        test.expect(cache.getStats().misses == 40 && cache.getStats().hits == 1 && firstSet != VK_NULL_HANDLE);
+        test.expect(cache.getStats().liveSets == 40 && cache.getStats().pools == 2 && fakePools.resets == 0 && consistent());
+
+        // only the sets of the second pool stay in use, the first pool goes stale and is reset whole
+        for (uint64_t frame = 1; frame <= 12; ++frame)
+        {
+            for (uint64_t hash = 32; hash < 40; ++hash)
+            {
+                request(hash, frame);
+            }
+        }
+        cache.evict(12, kFramesInFlight, 8, kNoCap);
+        test.expect(cache.getStats().liveSets == 8 && cache.getStats().recycledSets == 32 && fakePools.resets == 1 && consistent());
+        test.expect(cache.find(5, 12) == VK_NULL_HANDLE && cache.find(35, 12) != VK_NULL_HANDLE);
+
+        // the reset pool takes the next sets before another pool is created
+        for (uint64_t hash = 100; hash < 132; ++hash)
+        {
+            request(hash, 13);
+        }
+        cache.evict(13, kFramesInFlight, kNoStaleness, kNoCap);
+        test.expect(cache.getStats().liveSets == 40 && cache.getStats().pools == 2 && consistent());
+
+        // over the cap the least recently used sets go first, sets a frame in flight may read stay
+        cache.evict(14, kFramesInFlight, kNoStaleness, 10);
+        test.expect(cache.getStats().liveSets == 32 && cache.getStats().evictedSets == 8 && consistent());
+        test.expect(cache.find(39, 14) == VK_NULL_HANDLE && cache.find(131, 14) != VK_NULL_HANDLE);
+
+        cache.evict(20, kFramesInFlight, kNoStaleness, 10);
+        test.expect(cache.getStats().liveSets == 10 && cache.find(131, 20) != VK_NULL_HANDLE && consistent());
+
+        // a fully stale cache keeps a single empty pool
+        cache.evict(40, kFramesInFlight, 8, kNoCap);
+        test.expect(cache.getStats().liveSets == 0 && cache.getStats().pools == 1 && consistent());
+    }
+    test.expect(fakePools.liveSets.empty() && !fakePools.misused);
+
+    LOGI("Descriptor set cache: %u of %u cases failed\n", test.failures, test.cases);
+    return test.passed();
+}
+
+// drives both allocators without a device: alignment, frames in flight, wrapping, exhaustion and merging of freed ranges
+bool descriptorBufferAllocatorSelfTest()
+{
+    TestCases test;
+
+    constexpr uint32_t      kFramesInFlight = 2;
+    DescriptorRingAllocator ring;
+    ring.init(256);
+
+    // offsets are aligned, the padding counts as used
+    ring.beginFrame(0, kFramesInFlight);
+    const std::optional<VkDeviceSize> first  = ring.allocate(100, 64);
+    const std::optional<VkDeviceSize> second = ring.allocate(10, 64);
+    test.expect(first == 0 && second == 128 && ring.getStats().usedBytes == 138);
+
+    // frame 0 is still in flight, so nothing wraps onto it
+    ring.beginFrame(1, kFramesInFlight);
+    test.expect(ring.allocate(100, 16) == 144);
+    test.expect(!ring.allocate(50, 16) && ring.getStats().failedAllocations == 1);
+
+    // frame 0 completed, the next allocation wraps to the start and gives up the tail
+    ring.beginFrame(2, kFramesInFlight);
+    test.expect(ring.getStats().usedBytes == 106);
+    test.expect(ring.allocate(50, 16) == 0 && ring.getStats().usedBytes == 168);
+    test.expect(!ring.allocate(100, 16));
+
+    ring.beginFrame(3, kFramesInFlight);
+    test.expect(ring.allocate(100, 16) == 64);
+
+    // frames without allocations retire like the others
+    ring.beginFrame(4, kFramesInFlight);
+    ring.beginFrame(5, kFramesInFlight);
+    test.expect(ring.getStats().usedBytes == 0 && ring.getStats().peakUsedBytes == 244);
+    test.expect(!ring.allocate(300, 16) && ring.allocate(256, 16) == 0);
+
+    DescriptorOffsetAllocator regions;
+    regions.init(1024);
+    const std::optional<VkDeviceSize> regionA = regions.allocate(100, 64);
+    const std::optional<VkDeviceSize> regionB = regions.allocate(200, 256);
+    const std::optional<VkDeviceSize> regionC = regions.allocate(100, 4);
+    // the small region fills the gap the aligned one left
+    test.expect(regionA == 0 && regionB == 256 && regionC == 100 && regions.getFreeRangeCount() == 2);
+
+    regions.free(*regionB);
+    test.expect(regions.getFreeRangeCount() == 1 && regions.getUsedBytes() == 200);
+    regions.free(*regionA);
+    test.expect(regions.getFreeRangeCount() == 2);
+    regions.free(*regionC);
+    test.expect(regions.getFreeRangeCount() == 1 && regions.getUsedBytes() == 0);
+    test.expect(regions.allocate(1024, 64) == 0 && !regions.allocate(1, 1));
+
+    LOGI("Descriptor buffer allocators: %u of %u cases failed\n", test.failures, test.cases);
+    return test.passed();
+}
+
+} // namespace Play::Tests
@@ -0,0 +1,145 @@
+#include "PlayGroundTests.h"
+#include "Material.h"
+#include "MaterialParameterBuffer.h"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <nvutils/logger.hpp>
+
+namespace Play
+{
+// declares the parameters reflection would and gathers a buffer of its own, neither needs a device
+struct MaterialTestAccess
+{
+    static void declareStorageBlock(Material& material, const MaterialDescriptorDeclaration& block)
+    {
+        material._descriptorDeclarations[block.name] = block;
+    }
+
+    static void declareParameter(Material& material, const MaterialParameterDeclaration& declaration)
+    {
+        material._parameterDeclarations[declaration.name] = declaration;
+        material._paramMap[declaration.name]              = rttr::variant();
+    }
+
+    static void compileParameterLayout(Material& material)
+    {
+        material.compileParameterLayout();
+    }
+
+    static void gather(MaterialParameterBuffer& buffer)
+    {
+        buffer.gather();
+    }
+};
+} // namespace Play
+
+namespace Play::Tests
+{
+
+namespace
+{
+constexpr uint32_t kMaterialInstances  = 1024;
+constexpr uint32_t kMaterialParameters = 16;
+constexpr uint32_t kMaterialFrames     = 8;
+constexpr uint32_t kMaterialSets       = 100000; // per frame
+} // namespace
+
+// sets the parameters of many instances by name and the same ones through handles, both gathered into buffers of their
+// own, and checks that both ways left the same bytes in every block
+bool materialParameterBenchmark()
+{
+    using Clock = std::chrono::steady_clock;
+    auto elapsedMs = [](Clock::time_point start) { return std::chrono::duration<float, std::milli>(Clock::now() - start).count(); };
+
+    // one storage block of float and uint scalars, as reflection would declare it
+    Material material("MaterialParameterBenchmark");
+    MaterialTestAccess::declareStorageBlock(material, {"params", 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_ALL});
+    std::vector<std::string> names;
+    for (uint32_t index = 0; index < kMaterialParameters; ++index)
+    {
+        MaterialParameterDeclaration declaration;
+        declaration.name           = "params.value" + std::to_string(index);
+        declaration.kind           = MaterialParameterKind::eScalar;
+        declaration.descriptorName = "params";
+        declaration.byteOffset     = index * 4;
+        declaration.byteSize       = 4;
+        declaration.scalarType     = index % 2 ? MaterialScalarType::eUint : MaterialScalarType::eFloat;
+        declaration.scalarBytes    = 4;
+        MaterialTestAccess::declareParameter(material, declaration);
+        names.push_back(declaration.name);
+    }
+    MaterialTestAccess::compileParameterLayout(material);
+
+    MaterialParameterBuffer                        namedBuffer;
+    MaterialParameterBuffer                        handleBuffer;
+    std::vector<std::unique_ptr<MaterialInstance>> namedInstances;
+    std::vector<std::unique_ptr<MaterialInstance>> handleInstances;
+    for (uint32_t index = 0; index < kMaterialInstances; ++index)
+    {
+        namedInstances.push_back(std::make_unique<MaterialInstance>(&material, &namedBuffer));
+        handleInstances.push_back(std::make_unique<MaterialInstance>(&material, &handleBuffer));
+    }
+    MaterialTestAccess::gather(namedBuffer);
+    MaterialTestAccess::gather(handleBuffer);
+
+    std::vector<MaterialParameterHandle> handles;
+    for (const std::string& name : names)
+    {
+        handles.push_back(material.findParameter(name));
+    }
+
+    Clock::time_point start = Clock::now();
+    for (uint32_t frame = 0; frame < kMaterialFrames; ++frame)
+    {
+        for (uint32_t index = 0; index < kMaterialSets; ++index)
+        {
+            const uint32_t    parameter = index % kMaterialParameters;
+            const uint32_t    value     = frame * kMaterialSets + index;
+            MaterialInstance& instance  = *namedInstances[(index / kMaterialParameters) % kMaterialInstances];
+            if (parameter % 2)
+            {
+                instance.setParam(names[parameter], value);
+            }
+            else
+            {
+                instance.setParam(names[parameter], static_cast<float>(value));
+            }
+        }
+        MaterialTestAccess::gather(namedBuffer);
+    }
+    const float namedMs = elapsedMs(start) / kMaterialFrames;
+
+    start = Clock::now();
+    for (uint32_t frame = 0; frame < kMaterialFrames; ++frame)
+    {
+        for (uint32_t index = 0; index < kMaterialSets; ++index)
+        {
+            const uint32_t    parameter = index % kMaterialParameters;
+            const uint32_t    value     = frame * kMaterialSets + index;
+            MaterialInstance& instance  = *handleInstances[(index / kMaterialParameters) % kMaterialInstances];
+            if (parameter % 2)
+            {
+                instance.setParam(handles[parameter], value);
+            }
+            else
+            {
+                instance.setParam(handles[parameter], static_cast<float>(value));
+            }
+        }
+        MaterialTestAccess::gather(handleBuffer);
+    }
+    const float handleMs = elapsedMs(start) / kMaterialFrames;
+
+    bool matched = std::all_of(handles.begin(), handles.end(), [](const MaterialParameterHandle& handle) { return handle.isValid(); });
+    for (uint32_t index = 0; index < kMaterialInstances && matched; ++index)
+    {
+        matched = namedInstances[index]->getParameterBlock() == handleInstances[index]->getParameterBlock();
+    }
+
+    LOGI("Material parameters, %u sets a frame: %.3f ms by name, %.3f ms through handles, blocks %s\n", kMaterialSets, namedMs, handleMs,
+         matched ? "match" : "differ");
+    return matched;
+}
+
+} // namespace Play::Tests
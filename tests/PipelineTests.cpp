@@ -0,0 +1,472 @@
+#include "PlayGroundTests.h"
+#include "PipelineCacheLRU.h"
+#include "PipelineCacheManager.h"
+#include "PipelineLibrary.h"
+#include "ShaderPermutation.h"
+#include "core/DataWriter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <nvutils/logger.hpp>
+
+namespace Play::Tests
+{
+
+namespace
+{
+constexpr const char* kStorageBenchmarkPath     = "storageBenchmark.db";
+constexpr uint32_t    kStorageBenchmarkBlobs    = 10000;
+constexpr uint32_t    kStorageBenchmarkBlobSize = 256;
+
+constexpr uint64_t kFakePipelineBytes = 4096; // cache data every new pipeline adds to its block
+
+struct FakePipelineCaches
+{
+    std::map<VkPipelineCache, std::vector<uint8_t>> live; // the data of every cache alive
+    uint64_t                                        nextHandle = 1;
+    uint32_t                                        deviceID   = 1;
+    bool                                            misused    = false; // a cache was used or destroyed that was not alive
+};
+
+// keeps the data of every cache in memory instead of creating any
+class FakePipelineCacheDevice : public PipelineCacheDevice
+{
+public:
+    explicit FakePipelineCacheDevice(FakePipelineCaches& caches) : _caches(caches) {}
+
+    void getIdentity(uint32_t& deviceID, uint32_t& vendorID, uint8_t* pipelineCacheUUID) override
+    {
+        deviceID = _caches.deviceID;
+        vendorID = 0x10de;
+        std::memset(pipelineCacheUUID, 0x5a, VK_UUID_SIZE);
+    }
+
+    VkPipelineCache createCache(const void* initialData, size_t initialSize) override
+    {
+        const VkPipelineCache cache = makeFakeHandle<VkPipelineCache>(_caches.nextHandle++);
+        const uint8_t*        bytes = static_cast<const uint8_t*>(initialData);
+        _caches.live[cache].assign(bytes, bytes + initialSize);
+        return cache;
+    }
+
+    void getCacheData(VkPipelineCache cache, size_t* size, void* data) override
+    {
+        auto found      = _caches.live.find(cache);
+        _caches.misused = _caches.misused || found == _caches.live.end();
+        if (found == _caches.live.end())
+        {
+            *size = 0;
+            return;
+        }
+        if (data)
+        {
+            std::memcpy(data, found->second.data(), std::min(*size, found->second.size()));
+        }
+        *size = found->second.size();
+    }
+
+    void destroyCache(VkPipelineCache cache) override
+    {
+        _caches.misused = _caches.misused || _caches.live.erase(cache) == 0;
+    }
+
+private:
+    FakePipelineCaches& _caches;
+};
+} // namespace
+
+// drives PplCacheBlockManager against fake caches and a scratch database: the budget after every frame, blocks reloading
+// with their keys, data and state, blocks with compiles pending staying resident, and the keys surviving a restart
+bool pipelineCacheLRUSelfTest()
+{
+    TestCases test;
+    auto never = [](BlockKey) { return true; };
+
+    // least recently used first, a touch moves the block to the back
+    PipelineCacheLRU lru;
+    lru.touch(1, 1);
+    lru.setResidentBytes(1, 100);
+    lru.touch(2, 2);
+    lru.setResidentBytes(2, 100);
+    lru.touch(3, 3);
+    lru.setResidentBytes(3, 100);
+    test.expect(lru.getResidentBytes() == 300 && lru.collectEvictions(200, 10, 0, never) == std::vector<BlockKey>{1});
+    lru.touch(1, 4);
+    test.expect(lru.collectEvictions(100, 10, 0, never) == std::vector<BlockKey>{2, 3});
+
+    // recently used blocks and refused blocks stay even over the budget
+    test.expect(lru.collectEvictions(0, 4, 2, never) == std::vector<BlockKey>{2});
+    test.expect(lru.collectEvictions(0, 10, 0, [](BlockKey key) { return key != 3; }) == std::vector<BlockKey>{2, 1});
+    lru.remove(2);
+    test.expect(lru.getResidentBytes() == 200 && lru.getResidentBlocks() == 2 && !lru.isResident(2));
+
+    constexpr uint32_t kBudgetKB      = 256;
+    constexpr uint32_t kMinIdleFrames = 1;
+    constexpr uint64_t kFilledKeys    = 3000; // fill 100 blocks, far more than the budget holds
+    constexpr uint64_t kBuildingKeys  = 10;   // then part of one more
+
+    const std::filesystem::path cacheDirectory = std::filesystem::temp_directory_path() / "pipelineCacheLRUSelfTest";
+    const std::filesystem::path cachePath      = cacheDirectory / PIPELINE_CACHE_FILE_NAME;
+    std::error_code             ec;
+    std::filesystem::remove_all(cacheDirectory, ec);
+    DataWriter  writer;
+    DataWriter* previousWriter = sqliteWriter;
+    sqliteWriter               = &writer;
+
+    FakePipelineCaches           caches;
+    std::map<uint64_t, BlockKey> keyBlocks;
+    // a new pipeline appends its bytes, one already in the block leaves the data as it is
+    auto compile = [&caches, &keyBlocks](PplCacheBlockManager& manager, uint64_t key)
+    {
+        bool           newPipeline = false;
+        PplCacheBlock* block       = manager.getOrCreateBlock(key, newPipeline);
+        keyBlocks.emplace(key, block->_blockKey);
+        manager.createPipeline(block->_blockKey, newPipeline,
+                               [&](VkPipelineCache cache)
+                               {
+                                   auto found     = caches.live.find(cache);
+                                   caches.misused = caches.misused || found == caches.live.end();
+                                   if (found != caches.live.end() && newPipeline)
+                                   {
+                                       found->second.resize(found->second.size() + kFakePipelineBytes, static_cast<uint8_t>(key));
+                                   }
+                                   return VkPipeline(VK_NULL_HANDLE);
+                               });
+        return block;
+    };
+    // the pipelines of a block in the order they were added, each of them left its key in the data
+    auto holdsKeys = [&caches](const PplCacheBlock* block, uint64_t firstKey, uint64_t count)
+    {
+        auto found = caches.live.find(block->_vkHandle);
+        bool held  = found != caches.live.end() && found->second.size() == count * kFakePipelineBytes && block->_pipelineKeys.size() == count;
+        for (uint64_t index = 0; held && index < count; ++index)
+        {
+            held = block->_pipelineKeys[index] == firstKey + index &&
+                   found->second[index * kFakePipelineBytes] == static_cast<uint8_t>(firstKey + index);
+        }
+        return held;
+    };
+
+    uint64_t frame = 0;
+    {
+        PplCacheBlockManager manager(std::make_unique<FakePipelineCacheDevice>(caches), cachePath);
+        manager.getSettings().BudgetKB      = kBudgetKB;
+        manager.getSettings().MinIdleFrames = kMinIdleFrames;
+        const PipelineCacheStats& stats     = manager.getStats();
+
+        bool budgetHeld = true;
+        for (uint64_t key = 0; key < kFilledKeys + kBuildingKeys; ++frame)
+        {
+            manager.Tick(frame);
+            budgetHeld = budgetHeld && stats.ResidentKB <= kBudgetKB;
+            for (uint32_t i = 0; i < 40 && key < kFilledKeys + kBuildingKeys; ++i, ++key)
+            {
+                compile(manager, key);
+            }
+        }
+        manager.Tick(frame++);
+        test.expect(budgetHeld && stats.ResidentKB <= kBudgetKB && stats.Blocks == 101 && stats.Evictions > 90 && stats.Reloads == 0);
+        test.expect(!caches.misused && caches.live.size() == stats.ResidentBlocks);
+
+        // the first block went out long ago, it comes back finalized with the keys and the data it was saved with
+        const uint32_t reloadsBefore = stats.Reloads;
+        bool           newPipeline   = true;
+        PplCacheBlock* reloaded      = manager.getOrCreateBlock(0, newPipeline);
+        test.expect(!newPipeline && reloaded->_blockKey == keyBlocks[0] && reloaded->isFinalized() && stats.Reloads == reloadsBefore + 1);
+        test.expect(holdsKeys(reloaded, 0, MAX_BLOCK_PIPELINE_COUNT));
+
+        // its compile is still pending, so a budget of zero unloads every block but that one
+        manager.getSettings().BudgetKB      = 0;
+        manager.getSettings().MinIdleFrames = 0;
+        manager.Tick(frame++);
+        test.expect(caches.live.size() == 1 && caches.live.contains(reloaded->_vkHandle) && stats.ResidentBlocks == 1);
+        manager.createPipeline(reloaded->_blockKey, false, [](VkPipelineCache) { return VkPipeline(VK_NULL_HANDLE); });
+        manager.Tick(frame++);
+        test.expect(caches.live.empty() && stats.ResidentBlocks == 0 && !caches.misused);
+
+        // the block being filled went out too, it comes back still building and takes the next key
+        const PplCacheBlock* building = compile(manager, kFilledKeys + kBuildingKeys);
+        test.expect(building->_blockKey == keyBlocks[kFilledKeys] && building->isBuilding() && stats.Blocks == 101);
+        test.expect(holdsKeys(building, kFilledKeys, kBuildingKeys + 1));
+    }
+    test.expect(caches.live.empty() && !caches.misused);
+
+    // after a restart every key is found in the block it was added to, a new one goes into the block being filled
+    {
+        PplCacheBlockManager manager(std::make_unique<FakePipelineCacheDevice>(caches), cachePath);
+        manager.Tick(frame++);
+        bool foundAll = true;
+        for (uint64_t key : {uint64_t(0), uint64_t(1234), kFilledKeys - 1, kFilledKeys + kBuildingKeys})
+        {
+            bool           newPipeline = true;
+            PplCacheBlock* block       = manager.getOrCreateBlock(key, newPipeline);
+            foundAll                   = foundAll && !newPipeline && block->_blockKey == keyBlocks[key];
+            manager.createPipeline(block->_blockKey, newPipeline, [](VkPipelineCache) { return VkPipeline(VK_NULL_HANDLE); });
+        }
+        test.expect(foundAll && manager.getStats().Reloads == 4);
+        const PplCacheBlock* block = compile(manager, kFilledKeys * 2);
+        test.expect(block->_blockKey == keyBlocks[kFilledKeys] && block->_pipelineKeys.size() == kBuildingKeys + 2);
+    }
+
+    // the blocks of another device are dropped with the whole database
+    caches.deviceID = 2;
+    {
+        PplCacheBlockManager manager(std::make_unique<FakePipelineCacheDevice>(caches), cachePath);
+        bool                 newPipeline = false;
+        PplCacheBlock*       block       = manager.getOrCreateBlock(0, newPipeline);
+        manager.createPipeline(block->_blockKey, newPipeline, [](VkPipelineCache) { return VkPipeline(VK_NULL_HANDLE); });
+        manager.Tick(frame++);
+        test.expect(newPipeline && manager.getStats().Blocks == 1);
+    }
+    test.expect(caches.live.empty() && !caches.misused);
+
+    writer.close();
+    sqliteWriter = previousWriter;
+    std::filesystem::remove_all(cacheDirectory, ec);
+
+    LOGI("Pipeline cache LRU: %u of %u cases failed\n", test.failures, test.cases);
+    return test.passed();
+}
+
+// changes one field of an initializer at a time and checks that exactly the parts reading it get a new key
+bool pipelineLibrarySelfTest()
+{
+    TestCases test;
+    // the parts whose key differs between the two initializers
+    auto changedParts = [](const GraphicsPipelineStateInitializer& a, const GraphicsPipelineStateInitializer& b)
+    {
+        const PipelineLibraryKeys keysA = getPipelineLibraryKeys(a);
+        const PipelineLibraryKeys keysB = getPipelineLibraryKeys(b);
+        uint32_t                  mask  = keysA.partMask ^ keysB.partMask;
+        for (uint32_t index = 0; index < kPipelineLibraryPartCount; ++index)
+        {
+            mask |= keysA.parts[index] != keysB.parts[index] ? 1u << index : 0u;
+        }
+        return mask;
+    };
+    constexpr uint32_t kVertexInput      = 1u << static_cast<uint32_t>(PipelineLibraryPart::eVertexInput);
+    constexpr uint32_t kPreRasterization = 1u << static_cast<uint32_t>(PipelineLibraryPart::ePreRasterization);
+    constexpr uint32_t kFragmentShader   = 1u << static_cast<uint32_t>(PipelineLibraryPart::eFragmentShader);
+    constexpr uint32_t kFragmentOutput   = 1u << static_cast<uint32_t>(PipelineLibraryPart::eFragmentOutput);
+
+    PipelineLayout layout;
+    layout.hash = 0x1234;
+    GraphicsPipelineStateInitializer base;
+    base.setShader(1, 2);
+    base.pipelineLayout                          = &layout;
+    base.renderTargetState.colorFormats          = {VK_FORMAT_R8G8B8A8_UNORM};
+    base.renderTargetState.depthAttachmentFormat = VK_FORMAT_D32_SFLOAT;
+
+    // the same state gives the same keys, and the parts never share one
+    const PipelineLibraryKeys        baseKeys = getPipelineLibraryKeys(base);
+    GraphicsPipelineStateInitializer same     = base;
+    test.expect(changedParts(base, same) == 0);
+    test.expect(baseKeys.partMask == (kVertexInput | kPreRasterization | kFragmentShader | kFragmentOutput));
+    bool distinct = true;
+    for (uint32_t a = 0; a < kPipelineLibraryPartCount; ++a)
+    {
+        for (uint32_t b = a + 1; b < kPipelineLibraryPartCount; ++b)
+        {
+            distinct &= baseKeys.parts[a] != baseKeys.parts[b];
+        }
+    }
+    test.expect(distinct);
+
+    // every field reaches the parts whose subset reads it and no other
+    auto expectChange = [&](uint32_t parts, const std::function<void(GraphicsPipelineStateInitializer&)>& change)
+    {
+        GraphicsPipelineStateInitializer changed = base;
+        change(changed);
+        test.expect(changedParts(base, changed) == parts);
+    };
+    expectChange(kVertexInput, [](auto& init) { init.psoState.inputAssemblyState.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST; });
+    expectChange(kPreRasterization, [](auto& init) { init.shaderSet.vertexModuleID = 3; });
+    expectChange(kPreRasterization, [](auto& init) { init.psoState.rasterizationState.cullMode = VK_CULL_MODE_FRONT_AND_BACK; });
+    expectChange(kPreRasterization, [](auto& init) { init.psoState.rasterizationState.polygonMode = VK_POLYGON_MODE_LINE; });
+    expectChange(kFragmentShader, [](auto& init) { init.shaderSet.fragModuleID = 4; });
+    expectChange(kFragmentShader, [](auto& init) { init.psoState.depthStencilState.depthCompareOp = VK_COMPARE_OP_GREATER; });
+    expectChange(kFragmentShader, [](auto& init) { init.psoState.depthStencilState.front.passOp = VK_STENCIL_OP_REPLACE; });
+    expectChange(kFragmentOutput, [](auto& init) { init.psoState.colorBlendEnables = {VK_TRUE}; });
+    expectChange(kFragmentOutput, [](auto& init) { init.psoState.colorWriteMasks = {VK_COLOR_COMPONENT_R_BIT}; });
+    expectChange(kFragmentOutput, [](auto& init) { init.renderTargetState.colorFormats = {VK_FORMAT_R16G16B16A16_SFLOAT}; });
+    expectChange(kFragmentOutput, [](auto& init) { init.renderTargetState.depthAttachmentFormat = VK_FORMAT_D24_UNORM_S8_UINT; });
+    expectChange(kFragmentShader | kFragmentOutput,
+                 [](auto& init) { init.psoState.multisampleState.rasterizationSamples = VK_SAMPLE_COUNT_4_BIT; });
+
+    // the layout is shared by the shader parts, flags and dynamic states by all of them
+    PipelineLayout otherLayout;
+    otherLayout.hash = 0x5678;
+    expectChange(kPreRasterization | kFragmentShader, [&otherLayout](auto& init) { init.pipelineLayout = &otherLayout; });
+    PipelineLayout bufferLayout   = layout;
+    bufferLayout.descriptorBuffer = true;
+    const uint32_t allParts       = kVertexInput | kPreRasterization | kFragmentShader | kFragmentOutput;
+    expectChange(allParts, [&bufferLayout](auto& init) { init.pipelineLayout = &bufferLayout; });
+    expectChange(allParts, [](auto& init) { init.psoState.dynamicStates.push_back(VK_DYNAMIC_STATE_CULL_MODE); });
+    expectChange(allParts, [](auto& init) { init.renderTargetState.shadingRateAttachment = true; });
+
+    // mesh pipelines leave the vertex input out, the fragment side stays shared with vertex pipelines
+    GraphicsPipelineStateInitializer mesh = base;
+    mesh.setMeshShader(5, 2, 6);
+    const PipelineLibraryKeys meshKeys = getPipelineLibraryKeys(mesh);
+    test.expect(!meshKeys.hasPart(PipelineLibraryPart::eVertexInput) && meshKeys.hasPart(PipelineLibraryPart::ePreRasterization));
+    test.expect(changedParts(base, mesh) == (kVertexInput | kPreRasterization));
+    test.expect(meshKeys.getPartKey(PipelineLibraryPart::eFragmentShader) == baseKeys.getPartKey(PipelineLibraryPart::eFragmentShader));
+
+    // primitives discarded before rasterization have no fragment parts to link
+    GraphicsPipelineStateInitializer discard = base;
+    discard.psoState.rasterizationState.rasterizerDiscardEnable = VK_TRUE;
+    test.expect(canUsePipelineLibraries(base) && !canUsePipelineLibraries(discard));
+    discard.psoState.dynamicStates.push_back(VK_DYNAMIC_STATE_RASTERIZER_DISCARD_ENABLE);
+    test.expect(canUsePipelineLibraries(discard));
+
+    LOGI("Pipeline library: %u of %u cases failed\n", test.failures, test.cases);
+    return test.passed();
+}
+
+// packs and unpacks keys, splits them into define and specialization parts and round trips the variant names
+bool shaderPermutationSelfTest()
+{
+    TestCases test;
+
+    ShaderPermutationDesc desc;
+    desc.request.name = "selfTest";
+    desc.keywords     = {
+        {"USE_SHADOWS"},
+        {"QUALITY", {"LOW", "MEDIUM", "HIGH"}},
+        {"kNormalMap", {"0", "1"}, ShaderKeywordMode::eSpecialization, 3},
+        {"kMode", {"a", "b", "c", "d", "e"}, ShaderKeywordMode::eSpecialization, 7},
+    };
+    const ShaderPermutation permutation(desc);
+    test.expect(permutation.isValid());
+    test.expect(permutation.hasSpecialization());
+
+    // every keyword reads back what was set, without touching the others
+    ShaderVariantKey key = 0;
+    key                  = permutation.setKeyword(key, "USE_SHADOWS", 1);
+    key                  = permutation.setKeywordValue(key, "QUALITY", "HIGH");
+    key                  = permutation.setKeyword(key, "kNormalMap", 1);
+    key                  = permutation.setKeywordValue(key, "kMode", "e");
+    test.expect(permutation.getKeyword(key, "USE_SHADOWS") == 1);
+    test.expect(permutation.getKeyword(key, "QUALITY") == 2);
+    test.expect(permutation.getKeyword(key, "kNormalMap") == 1);
+    test.expect(permutation.getKeyword(key, "kMode") == 4);
+    key = permutation.setKeyword(key, "QUALITY", 0);
+    test.expect(permutation.getKeyword(key, "QUALITY") == 0 && permutation.getKeyword(key, "kMode") == 4);
+
+    // unknown keywords and values leave the key alone
+    test.expect(permutation.setKeyword(key, "MISSING", 1) == key);
+    test.expect(permutation.setKeyword(key, "QUALITY", 3) == key);
+    test.expect(permutation.setKeywordValue(key, "QUALITY", "ULTRA") == key);
+
+    // variants differing only in specialization keywords share the module and its defines
+    const ShaderVariantKey other = permutation.setKeyword(key, "kNormalMap", 0);
+    test.expect(other != key);
+    test.expect(permutation.getDefineKey(other) == permutation.getDefineKey(key));
+    test.expect(permutation.getModuleName(other) == permutation.getModuleName(key));
+    test.expect(permutation.getVariantName(other) != permutation.getVariantName(key));
+    test.expect(permutation.getModuleName(key) != permutation.getVariantName(0));
+    const ShaderLoadRequest request = permutation.getDefineRequest(key);
+    test.expect(request.defines == ShaderDefines({{"USE_SHADOWS", "1"}, {"QUALITY", "LOW"}}));
+    test.expect(permutation.getDefineRequest(permutation.setKeyword(key, "USE_SHADOWS", 0)).name != request.name);
+
+    // the constants land at their ids in declaration order
+    const std::shared_ptr<const ShaderSpecialization> specialization = permutation.createSpecialization(key);
+    test.expect(specialization && specialization->info.mapEntryCount == 2 && specialization->info.dataSize == 8);
+    test.expect(specialization && specialization->entries[0].constantID == 3 && specialization->data[0] == 1);
+    test.expect(specialization && specialization->entries[1].constantID == 7 && specialization->entries[1].offset == 4);
+    test.expect(specialization && specialization->data[1] == 4 && specialization->info.pData == specialization->data.data());
+
+    // names round trip, names of other shaders and out of range values do not parse
+    ShaderVariantKey parsed = 0;
+    test.expect(permutation.parseVariantName(permutation.getVariantName(key), parsed) && parsed == key);
+    test.expect(!permutation.parseVariantName("selfTestOther#1", parsed));
+    test.expect(!permutation.parseVariantName(permutation.getModuleName(key), parsed));
+    test.expect(!permutation.parseVariantName(permutation.getVariantName(3ULL << 1), parsed));
+
+    // a permutation of defines alone names its modules by the variant
+    ShaderPermutationDesc defineDesc = desc;
+    defineDesc.keywords.resize(2);
+    const ShaderPermutation definePermutation(defineDesc);
+    test.expect(!definePermutation.hasSpecialization() && !definePermutation.createSpecialization(1));
+    test.expect(definePermutation.getModuleName(1) == definePermutation.getVariantName(1));
+
+    ShaderPermutationDesc emptyValues = desc;
+    emptyValues.keywords.push_back({"EMPTY", {}});
+    test.expect(!ShaderPermutation(emptyValues).isValid());
+
+    LOGI("Shader permutation: %u of %u cases failed\n", test.failures, test.cases);
+    return test.passed();
+}
+
+// writes and reads small blobs through a scratch database beside the executable, every write its own transaction and
+// then in one batch, every read copied and then in place
+bool cacheStorageBenchmark()
+{
+    using Clock = std::chrono::steady_clock;
+    auto elapsedMs = [](Clock::time_point start) { return std::chrono::duration<float, std::milli>(Clock::now() - start).count(); };
+    auto blobName  = [](uint32_t index) { return "benchmark/" + std::to_string(index); };
+
+    DataWriter                  writer;
+    const std::filesystem::path fullPath       = writer.getRootPath() / kStorageBenchmarkPath;
+    auto                        removeDatabase = [&fullPath]()
+    {
+        std::error_code ec;
+        for (const char* suffix : {"", "-wal", "-shm"})
+        {
+            std::filesystem::remove(fullPath.string() + suffix, ec);
+        }
+    };
+    removeDatabase();
+    if (!writer.open(kStorageBenchmarkPath)) return false;
+
+    const uint32_t       blobCount = kStorageBenchmarkBlobs;
+    std::vector<uint8_t> blob(kStorageBenchmarkBlobSize, 0xA5);
+    Clock::time_point    start = Clock::now();
+    for (uint32_t index = 0; index < blobCount; ++index)
+    {
+        std::memcpy(blob.data(), &index, std::min<size_t>(sizeof(index), blob.size()));
+        writer.write(blobName(index), blob.data(), blob.size());
+    }
+    const float unbatchedWriteMs = elapsedMs(start);
+
+    // the same names again, replaced in one transaction
+    start = Clock::now();
+    {
+        DataWriterBatch batch(writer);
+        for (uint32_t index = 0; index < blobCount; ++index)
+        {
+            std::memcpy(blob.data(), &index, std::min<size_t>(sizeof(index), blob.size()));
+            writer.write(blobName(index), blob.data(), blob.size());
+        }
+    }
+    const float batchedWriteMs = elapsedMs(start);
+
+    // the byte sums keep the reads from being optimized away and both paths must agree on them
+    uint64_t copySum = 0;
+    start            = Clock::now();
+    for (uint32_t index = 0; index < blobCount; ++index)
+    {
+        if (writer.read(blobName(index), blob) && !blob.empty()) copySum += blob.back() + blob.size();
+    }
+    const float copyReadMs = elapsedMs(start);
+
+    uint64_t viewSum = 0;
+    start            = Clock::now();
+    for (uint32_t index = 0; index < blobCount; ++index)
+    {
+        BlobView view = writer.readView(blobName(index));
+        if (view.valid() && view.size() > 0) viewSum += view.data()[view.size() - 1] + view.size();
+    }
+    const float viewReadMs = elapsedMs(start);
+
+    writer.close();
+    removeDatabase();
+    LOGI("Cache storage over %u blobs: writes %.1f ms unbatched, %.1f ms batched, reads %.1f ms copied, %.1f ms in place\n", blobCount,
+         unbatchedWriteMs, batchedWriteMs, copyReadMs, viewReadMs);
+    return copySum == viewSum;
+}
+
+} // namespace Play::Tests
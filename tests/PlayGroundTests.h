@@ -0,0 +1,75 @@
+#ifndef PLAYGROUND_TESTS_H
+#define PLAYGROUND_TESTS_H
+
+#include <cstdint>
+#include <type_traits>
+
+namespace Play::Tests
+{
+
+// the checks of one self test, it passed when none of them failed
+struct TestCases
+{
+    uint32_t cases    = 0;
+    uint32_t failures = 0;
+
+    void expect(bool condition)
+    {
+        ++cases;
+        failures += condition ? 0 : 1;
+    }
+
+    bool passed() const
+    {
+        return failures == 0;
+    }
+};
+
+// a vulkan handle the fakes standing in for the driver hand out, non-dispatchable handles are pointers on 64 bit
+template <typename Handle>
+Handle makeFakeHandle(uint64_t value)
+{
+    if constexpr (std::is_pointer_v<Handle>)
+    {
+        return reinterpret_cast<Handle>(static_cast<uintptr_t>(value));
+    }
+    else
+    {
+        return static_cast<Handle>(value);
+    }
+}
+
+// self tests run without a device and return whether they passed, benchmarks log their timings and return whether
+// their results matched a reference
+bool hiZPyramidSelfTest();
+bool shadingRateSelfTest();
+bool temporalReprojectionSelfTest();
+bool gaussianSortReuseSelfTest();
+bool gaussianTileReferenceSelfTest();
+bool gaussianShEvaluatorSelfTest();
+bool volumeBrickGridSelfTest();
+bool lightClusterSelfTest();
+bool atmosphereLutCacheSelfTest();
+bool lightClusterBenchmark();
+
+bool descriptorSetLRUSelfTest();
+bool descriptorBufferAllocatorSelfTest();
+
+bool pipelineCacheLRUSelfTest();
+bool pipelineLibrarySelfTest();
+bool shaderPermutationSelfTest();
+bool cacheStorageBenchmark();
+
+bool materialParameterBenchmark();
+
+bool componentStoreBenchmark();
+bool sceneSnapshotSelfTest();
+bool sceneBVHSelfTest();
+bool sceneSnapshotBenchmark();
+bool sceneBVHBenchmark();
+
+bool textureResidencySelfTest();
+
+} // namespace Play::Tests
+
+#endif // PLAYGROUND_TESTS_H
@@ -0,0 +1,901 @@
+#include "PlayGroundTests.h"
+#include "GaussianPass/GaussianShEvaluator.h"
+#include "GaussianPass/GaussianSortReuse.h"
+#include "GaussianPass/GaussianTileReference.h"
+#include "renderPasses/AtmosphereLutCache.h"
+#include "renderPasses/HiZPyramid.h"
+#include "renderPasses/LightClusterGrid.h"
+#include "renderPasses/ShadingRateClassifier.h"
+#include "renderPasses/TemporalReprojection.h"
+#include "renderPasses/VolumeBrickGrid.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <utility>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include <nvutils/logger.hpp>
+#include "newShaders/gaussian/gaussianLib.h.slang"
+
+namespace Play::Tests
+{
+
+namespace
+{
+const glm::vec2 kEmptyDepthRange = glm::vec2(1.0f, 0.0f);
+
+constexpr uint32_t kShadingRateTileSize = 16;
+
+constexpr uint32_t kReprojectionPointCount       = 1024;
+constexpr float    kReprojectionTolerancePixels  = 0.05f; // depth precision dominates the far points
+constexpr float    kReprojectionMinViewDistance  = 0.5f;
+constexpr float    kReprojectionMaxViewDistance  = 20.0f;
+constexpr float    kReprojectionMaxPointMovement = 0.25f;
+
+constexpr uint32_t kGaussianSortSplats = 512;
+
+constexpr uint32_t kGaussianTileSplats    = 300;
+constexpr uint32_t kGaussianTileDepthBits = 16;
+
+constexpr uint32_t kGaussianShDirections  = 256;
+constexpr float    kGaussianShTolerance   = 1e-5f;
+constexpr uint32_t kGaussianShChunkSplats = 256;
+constexpr float    kGaussianShCacheAngle  = 1.0f;  // degrees, the default refresh threshold of the sh cache pass
+constexpr float    kGaussianShCacheError  = 0.02f; // that drift on coefficients of trained scenes, plus fp16 rounding
+
+constexpr uint32_t kVolumeBrickTestSize   = 8;
+constexpr uint16_t kVolumeBrickSpike      = 60000;
+constexpr uint32_t kVolumeOpacityTexels   = 16;
+constexpr uint32_t kVolumeMajorantSamples = 4096; // filtered lookups per brick range
+
+constexpr uint32_t kAtmosphereStillFrames  = 16;
+constexpr uint32_t kAtmosphereMediumFloats = 28; // BottomRadius through GroundAlbedo
+constexpr uint32_t kAtmosphereSkyFloats    = 30; // plus sun_dir
+
+constexpr uint32_t kLightClusterIterations = 8;
+constexpr uint32_t kLightClusterTestLights = 400;
+
+ShadingRateTile makeTile(uint32_t width, uint32_t height, float motionPixels, const std::function<float(uint32_t, uint32_t)>& luminance)
+{
+    ShadingRateTile tile;
+    tile.width  = width;
+    tile.height = height;
+    tile.luminance.resize(width * height);
+    tile.motionPixels.assign(width * height, motionPixels);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            tile.luminance[y * width + x] = luminance(x, y);
+        }
+    }
+    return tile;
+}
+
+// the projection the camera gives the renderer, y pointing down in clip space
+glm::mat4 makeCameraProjection(float aspect, float nearDepth, float farDepth)
+{
+    glm::mat4 proj = glm::perspectiveRH_ZO(glm::radians(60.0f), aspect, nearDepth, farDepth);
+    proj[1][1] *= -1.0f;
+    return proj;
+}
+
+struct LightClusterTiming
+{
+    float    assignMs                = 0.0f; // average over the iterations
+    float    averageLightsPerCluster = 0.0f;
+    uint32_t overflowClusters        = 0;
+};
+
+// scatters lights through the view frustum, a spread above 1 widens it so some lie off screen, before the near or past
+// the far plane. Exponential depth like the slices, so every slice receives a similar share of the lights
+std::vector<LightClusterSphere> scatterClusterLights(const LightClusterGridDesc& desc, const glm::mat4& invProj, uint32_t lightCount, float spread,
+                                                     uint32_t seed)
+{
+    std::mt19937                          random(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<LightClusterSphere>       lights(lightCount);
+    for (LightClusterSphere& light : lights)
+    {
+        const glm::vec2 ndc       = (glm::vec2(unit(random), unit(random)) * 2.0f - 1.0f) * spread;
+        const float     depth     = desc.nearDepth * std::pow(desc.farDepth / desc.nearDepth, 0.5f + (unit(random) - 0.5f) * spread);
+        const glm::vec4 nearPoint = invProj * glm::vec4(ndc, 0.0f, 1.0f);
+        const glm::vec3 direction = glm::vec3(nearPoint) / nearPoint.w;
+        light.center              = direction / -direction.z * depth;
+        light.radius              = depth * (0.02f + 0.08f * unit(random));
+    }
+    return lights;
+}
+
+// times assignLightsToClusters for lightCount lights of a fixed seed
+LightClusterTiming timeLightClusterAssignment(const LightClusterGridDesc& desc, const glm::mat4& proj, uint32_t lightCount)
+{
+    const glm::mat4 invProj = glm::inverse(proj);
+
+    const std::vector<LightClusterSphere> lights        = scatterClusterLights(desc, invProj, lightCount, 1.0f, 0x5eed1u);
+    const std::vector<LightClusterBounds> clusterBounds = computeLightClusterBoundsGrid(desc, invProj);
+    LightClusterAssignment                assignment;
+
+    const auto assignStart = std::chrono::steady_clock::now();
+    for (uint32_t iteration = 0; iteration < kLightClusterIterations; ++iteration)
+    {
+        assignLightsToClusters(desc, clusterBounds, lights, assignment);
+    }
+    const float totalMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - assignStart).count();
+
+    LightClusterTiming timing;
+    timing.assignMs                = totalMs / float(kLightClusterIterations);
+    timing.averageLightsPerCluster = float(assignment.totalEntries) / float(std::max(desc.clusterTotal(), 1u));
+    timing.overflowClusters        = assignment.overflowClusters;
+    return timing;
+}
+// min/max over the voxels of the brick and its one voxel apron, read straight from the volume
+std::pair<uint16_t, uint16_t> bruteForceBrickRange(std::span<const uint16_t> intensity, const VolumeBrickGrid& grid, const glm::uvec3& brick)
+{
+    const glm::uvec3 extent   = grid.volumeExtent;
+    const glm::ivec3 first    = glm::ivec3(brick * grid.brickSize) - 1;
+    const glm::ivec3 last     = glm::ivec3((brick + 1u) * grid.brickSize);
+    uint16_t         minValue = UINT16_MAX;
+    uint16_t         maxValue = 0;
+    for (int32_t z = std::max(first.z, 0); z <= std::min(last.z, int32_t(extent.z) - 1); ++z)
+    {
+        for (int32_t y = std::max(first.y, 0); y <= std::min(last.y, int32_t(extent.y) - 1); ++y)
+        {
+            for (int32_t x = std::max(first.x, 0); x <= std::min(last.x, int32_t(extent.x) - 1); ++x)
+            {
+                const uint16_t value = intensity[(size_t(z) * extent.y + y) * extent.x + x];
+                minValue             = std::min(minValue, value);
+                maxValue             = std::max(maxValue, value);
+            }
+        }
+    }
+    return {minValue, maxValue};
+}
+
+// the clamped linear lookup the ray marcher samples the opacity with
+float filteredOpacity(std::span<const uint8_t> opacityLookup, uint16_t value)
+{
+    const int32_t lookupSize = int32_t(opacityLookup.size());
+    const float   texel      = float(value) / float(UINT16_MAX) * float(lookupSize) - 0.5f;
+    const float   lower      = std::floor(texel);
+    const int32_t first      = std::clamp(int32_t(lower), 0, lookupSize - 1);
+    const int32_t second     = std::clamp(int32_t(lower) + 1, 0, lookupSize - 1);
+    return glm::mix(float(opacityLookup[first]), float(opacityLookup[second]), texel - lower) / 255.0f;
+}
+// real spherical harmonic of degree l and order m with the Condon-Shortley phase, built from the associated Legendre
+// recurrence instead of the expanded polynomials the evaluator uses
+float realSphericalHarmonic(int l, int m, const glm::vec3& direction)
+{
+    const double cosTheta = std::clamp(double(direction.z), -1.0, 1.0);
+    const double phi      = std::atan2(double(direction.y), double(direction.x));
+    const int    order    = std::abs(m);
+
+    // P_order^order, then up to P_l^order
+    double legendre = 1.0;
+    for (int step = 1; step <= order; ++step)
+    {
+        legendre *= -(2.0 * step - 1.0) * std::sqrt(1.0 - cosTheta * cosTheta);
+    }
+    double previous = 0.0;
+    for (int degree = order + 1; degree <= l; ++degree)
+    {
+        const double next = ((2.0 * degree - 1.0) * cosTheta * legendre - (degree + order - 1.0) * previous) / double(degree - order);
+        previous          = legendre;
+        legendre          = next;
+    }
+
+    double factorialRatio = 1.0; // (l - order)! / (l + order)!
+    for (int factor = l - order + 1; factor <= l + order; ++factor)
+    {
+        factorialRatio /= double(factor);
+    }
+    const double normalization = std::sqrt((2.0 * l + 1.0) / (4.0 * 3.14159265358979323846) * factorialRatio);
+    if (m == 0) return float(normalization * legendre);
+    const double azimuth = m > 0 ? std::cos(order * phi) : std::sin(order * phi);
+    return float(std::sqrt(2.0) * normalization * azimuth * legendre);
+}
+
+glm::vec3 randomUnitVector(std::mt19937& random)
+{
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    return glm::normalize(glm::vec3(normal(random), normal(random), normal(random)));
+}
+} // namespace
+
+// checks the layouts of common render sizes and every texel of a pyramid over an odd sized depth buffer against the
+// depth range it covers
+bool hiZPyramidSelfTest()
+{
+    TestCases test;
+
+    const HiZPyramidLayout fullHD = computeHiZPyramidLayout({1920, 1080});
+    test.expect(fullHD.baseSize == glm::uvec2(1024, 1024) && fullHD.mipCount == 11 && fullHD.groupCount == glm::uvec2(32, 32));
+    test.expect(fullHD.uvScale == glm::vec2(0.9375f, 0.52734375f));
+    test.expect(computeHiZPyramidLayout({3840, 2160}).mipCount == kHiZMaxMipCount);
+    test.expect(computeHiZPyramidLayout({8192, 4320}).mipCount == 0);
+    test.expect(computeHiZPyramidLayout({1, 1}).baseSize == glm::uvec2(1, 1) && computeHiZPyramidLayout({1, 1}).mipCount == 1);
+
+    // odd sizes leave a partially covered texel at the end of every row and column
+    const HiZPyramidLayout layout = computeHiZPyramidLayout({37, 23});
+    std::vector<float>     depth(layout.depthSize.x * layout.depthSize.y);
+    for (uint32_t y = 0; y < layout.depthSize.y; ++y)
+    {
+        for (uint32_t x = 0; x < layout.depthSize.x; ++x)
+        {
+            depth[y * layout.depthSize.x + x] = float((x * 73 + y * 151) % 97) / 97.0f;
+        }
+    }
+
+    const HiZPyramidLevels levels = buildHiZPyramid(depth, layout);
+    test.expect(layout.mipCount == 6 && levels.size() == layout.mipCount);
+    for (uint32_t mip = 0; mip < levels.size(); ++mip)
+    {
+        // every texel has to hold exactly the range of the depth texels below it
+        const glm::uvec2 size      = hiZMipSize(layout, mip);
+        const uint32_t   footprint = 2u << mip;
+        bool             exact     = true;
+        for (uint32_t y = 0; y < size.y; ++y)
+        {
+            for (uint32_t x = 0; x < size.x; ++x)
+            {
+                glm::vec2 expected = kEmptyDepthRange;
+                for (uint32_t depthY = y * footprint; depthY < std::min((y + 1) * footprint, layout.depthSize.y); ++depthY)
+                {
+                    for (uint32_t depthX = x * footprint; depthX < std::min((x + 1) * footprint, layout.depthSize.x); ++depthX)
+                    {
+                        const float value = depth[depthY * layout.depthSize.x + depthX];
+                        expected          = glm::vec2(std::min(expected.x, value), std::max(expected.y, value));
+                    }
+                }
+                exact = exact && levels[mip][y * size.x + x] == expected;
+            }
+        }
+        test.expect(exact);
+    }
+
+    const auto [minDepth, maxDepth] = std::minmax_element(depth.begin(), depth.end());
+    test.expect(!levels.empty() && levels.back().front() == glm::vec2(*minDepth, *maxDepth));
+
+    LOGI("HiZ pyramid: %u of %u cases failed\n", test.failures, test.cases);
+    return test.passed();
+}
+
+// classifies fixed recorded tiles with the default thresholds and checks the rate selection and encoding
+bool shadingRateSelfTest()
+{
+    TestCases test;
+
+    const ShadingRateThresholds thresholds;
+    // the rates a desktop gpu usually reports, no 1x4 or 4x1
+    const uint32_t commonMask = shadingRateMaskBit({1, 1}) | shadingRateMaskBit({1, 2}) | shadingRateMaskBit({2, 1}) | shadingRateMaskBit({2, 2}) |
+                                shadingRateMaskBit({2, 4}) | shadingRateMaskBit({4, 2}) | shadingRateMaskBit({4, 4});
+
+    const uint32_t        size             = kShadingRateTileSize;
+    const ShadingRateTile flat             = makeTile(size, size, 0.0f, [](uint32_t, uint32_t) { return 0.5f; });
+    const ShadingRateTile checker          = makeTile(size, size, 0.0f, [](uint32_t x, uint32_t y) { return (x + y) % 2 == 0 ? 0.0f : 4.0f; });
+    const ShadingRateTile columns          = makeTile(size, size, 0.0f, [](uint32_t x, uint32_t) { return x % 2 == 0 ? 0.0f : 2.0f; });
+    const ShadingRateTile fineDetail       = makeTile(size, size, 0.0f, [](uint32_t x, uint32_t y) { return (x + y) % 2 == 0 ? 0.5f : 0.6f; });
+    const ShadingRateTile movingFineDetail = makeTile(size, size, 16.0f, [](uint32_t x, uint32_t y) { return (x + y) % 2 == 0 ? 0.5f : 0.6f; });
+    const ShadingRateTile singlePixel      = makeTile(1, 1, 0.0f, [](uint32_t, uint32_t) { return 3.0f; });
+
+    test.expect(classifyShadingRateTile(flat, thresholds) == glm::uvec2(4, 4));
+    test.expect(classifyShadingRateTile(checker, thresholds) == glm::uvec2(1, 1));
+    // columns only change along x, so only y may be shaded coarsely
+    test.expect(classifyShadingRateTile(columns, thresholds) == glm::uvec2(1, 4));
+    test.expect(selectSupportedShadingRate(classifyShadingRateTile(columns, thresholds), kShadingRateAllRatesMask) == glm::uvec2(1, 4));
+    test.expect(selectSupportedShadingRate(classifyShadingRateTile(columns, thresholds), commonMask) == glm::uvec2(1, 2));
+    // detail that is sharp at rest blurs out under fast motion
+    test.expect(classifyShadingRateTile(fineDetail, thresholds) == glm::uvec2(1, 1));
+    test.expect(classifyShadingRateTile(movingFineDetail, thresholds) == glm::uvec2(2, 2));
+    test.expect(classifyShadingRateTile(singlePixel, thresholds) == glm::uvec2(4, 4));
+
+    ShadingRateThresholds halfRateOnly = thresholds;
+    halfRateOnly.maxRate               = 2;
+    test.expect(classifyShadingRateTile(flat, halfRateOnly) == glm::uvec2(2, 2));
+    test.expect(selectSupportedShadingRate({4, 4}, shadingRateMaskBit({1, 1}) | shadingRateMaskBit({2, 2})) == glm::uvec2(2, 2));
+    test.expect(selectSupportedShadingRate({4, 4}, 0) == glm::uvec2(1, 1));
+
+    test.expect(encodeShadingRate({1, 1}) == 0);
+    test.expect(encodeShadingRate({2, 4}) == 6);
+    test.expect(encodeShadingRate({4, 4}) == 10);
+
+    LOGI("Shading rate classifier: %u of %u cases failed\n", test.failures, test.cases);
+    return test.passed();
+}
+
+// checks the jitter sequence and the reprojection math against directly projected points of a fixed seed scene seen
+// from two camera poses, at the render scales the upscaler offers
+bool temporalReprojectionSelfTest()
+{
+    bool passed = true;
+    for (float renderScale : {0.5f, 0.67f, 0.75f, 1.0f})
+    {
+        const glm::mat4  proj         = makeCameraProjection(16.0f / 9.0f, 0.1f, 1000.0f);
+        const glm::uvec2 renderExtent = computeRenderExtent({1920, 1080}, renderScale);
+
+        const uint32_t phaseCount      = temporalJitterPhaseCount(renderScale);
+        glm::vec2      jitterMean      = glm::vec2(0.0f);
+        float          jitterMaxOffset = 0.0f;
+        for (uint32_t frame = 0; frame < phaseCount; ++frame)
+        {
+            const glm::vec2 jitter = temporalJitterOffset(frame, phaseCount);
+            jitterMaxOffset        = std::max(jitterMaxOffset, std::max(std::abs(jitter.x), std::abs(jitter.y)));
+            jitterMean += jitter;
+        }
+        jitterMean /= float(phaseCount);
+
+        // a scene seen from a camera that moved and turned since the previous frame
+        const glm::vec3 up           = glm::vec3(0.0f, 1.0f, 0.0f);
+        const glm::mat4 view         = glm::lookAt(glm::vec3(0.0f, 1.0f, 5.0f), glm::vec3(0.0f), up);
+        const glm::mat4 prevView     = glm::lookAt(glm::vec3(0.3f, 1.1f, 5.4f), glm::vec3(0.1f, 0.0f, 0.0f), up);
+        const glm::mat4 invView      = glm::inverse(view);
+        const glm::mat4 viewProj     = proj * view;
+        const glm::mat4 prevViewProj = proj * prevView;
+        const glm::mat4 invViewProj  = glm::inverse(viewProj);
+        const glm::vec2 pixelCount   = glm::vec2(renderExtent);
+
+        float                                 jitterError       = 0.0f;
+        float                                 reprojectionError = 0.0f;
+        float                                 velocityError     = 0.0f;
+        std::mt19937                          random(0x7a11u);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        for (uint32_t pointIndex = 0; pointIndex < kReprojectionPointCount; ++pointIndex)
+        {
+            const glm::vec2 ndc      = glm::vec2(unit(random), unit(random)) * 1.8f - 0.9f;
+            const float     distance = glm::mix(kReprojectionMinViewDistance, kReprojectionMaxViewDistance, unit(random));
+            const glm::vec4 viewPos  = glm::vec4(ndc.x * distance / proj[0][0], ndc.y * distance / proj[1][1], -distance, 1.0f);
+            const glm::vec3 worldPos = glm::vec3(invView * viewPos);
+            const glm::vec4 clip     = viewProj * glm::vec4(worldPos, 1.0f);
+            const glm::vec2 uv       = projectToScreenUv(worldPos, viewProj);
+
+            // the jittered projection moves every point by exactly the jitter, whatever its depth
+            const glm::vec2 jitter     = temporalJitterOffset(pointIndex, phaseCount);
+            const glm::vec2 jitteredUv = projectToScreenUv(worldPos, jitterProjection(proj, jitter, renderExtent) * view);
+            jitterError                = std::max(jitterError, glm::length((jitteredUv - uv) * pixelCount - jitter));
+
+            // depth reprojection has to land where the previous camera saw the point
+            const glm::vec2 reprojectedUv  = reprojectScreenUv(uv, clip.z / clip.w, invViewProj, prevViewProj);
+            const glm::vec2 expectedPrevUv = projectToScreenUv(worldPos, prevViewProj);
+            reprojectionError              = std::max(reprojectionError, glm::length((reprojectedUv - expectedPrevUv) * pixelCount));
+
+            // a static point's gbuffer velocity has to agree with the depth reprojection, a moving one with its old position
+            const glm::vec3 movement     = (glm::vec3(unit(random), unit(random), unit(random)) * 2.0f - 1.0f) * kReprojectionMaxPointMovement;
+            const glm::vec2 staticError  = computeScreenVelocity(worldPos, worldPos, viewProj, prevViewProj) - (uv - reprojectedUv);
+            const glm::vec2 movingPrevUv = uv - computeScreenVelocity(worldPos, worldPos - movement, viewProj, prevViewProj);
+            const glm::vec2 movingError  = movingPrevUv - projectToScreenUv(worldPos - movement, prevViewProj);
+            velocityError                = std::max(velocityError, glm::length(staticError * pixelCount));
+            velocityError                = std::max(velocityError, glm::length(movingError * pixelCount));
+        }
+
+        const float meanTolerance = 1.0f / float(phaseCount);
+        const bool  scalePassed   = jitterMaxOffset < 0.5f && std::abs(jitterMean.x) <= meanTolerance && std::abs(jitterMean.y) <= meanTolerance &&
+                                 jitterError <= kReprojectionTolerancePixels && reprojectionError <= kReprojectionTolerancePixels &&
+                                 velocityError <= kReprojectionTolerancePixels;
+        LOGI("Temporal reprojection at %.2f render scale, %u jitter phases: jitter %.4f px, reprojection %.4f px, velocity %.4f px\n",
+             renderScale, phaseCount, jitterError, reprojectionError, velocityError);
+        passed = passed && scalePassed;
+    }
+    return passed;
+}
+
+// replays a camera that turns once and then holds still with thresholds that never force a full sort: the refine of the
+// still frames has to repair the stale order into the fully sorted one. A different splat count has to force a full sort
+bool gaussianSortReuseSelfTest()
+{
+    TestCases test;
+
+    std::mt19937                          random(7);
+    std::uniform_real_distribution<float> coordinate(-10.0f, 10.0f);
+    std::vector<glm::vec3>                positions(kGaussianSortSplats);
+    for (glm::vec3& position : positions)
+    {
+        position = glm::vec3(coordinate(random), coordinate(random), coordinate(random));
+    }
+
+    GaussianSortSettings settings;
+    settings.ViewAngleThreshold       = 90.0f;
+    settings.ViewTranslationThreshold = 100.0f;
+    settings.MaxSortAge               = ~0u;
+    settings.RefinePassCount          = 8;
+
+    // odd-even transposition sorts any order of n keys within n passes
+    const glm::vec3        up(0.0f, 1.0f, 0.0f);
+    const uint32_t         stillFrames = kGaussianSortSplats / settings.RefinePassCount + 1;
+    std::vector<glm::mat4> path        = {glm::lookAt(glm::vec3(0.0f, 0.0f, 30.0f), glm::vec3(0.0f), up)};
+    path.insert(path.end(), stillFrames, glm::lookAt(glm::vec3(6.0f, 2.0f, 29.0f), glm::vec3(0.0f), up));
+
+    const GaussianSortSimulationReport report = simulateGaussianSortReuse(positions, path, settings);
+    test.expect(report.frames.size() == path.size() && report.fullSortCount == 1);
+    test.expect(report.frames.front().fullSort && report.frames.front().adjacentInversionRatio == 0.0f);
+    bool reused = true;
+    for (size_t frame = 1; frame < report.frames.size(); ++frame)
+    {
+        reused = reused && !report.frames[frame].fullSort && report.frames[frame].sortAge == frame;
+    }
+    test.expect(reused);
+    // the turn leaves the first order stale, so the first reused frame is not sorted yet
+    test.expect(report.frames.size() > 1 && report.frames[1].meanRankDisplacement > 0.0f);
+    test.expect(report.frames.back().adjacentInversionRatio == 0.0f && report.frames.back().meanRankDisplacement == 0.0f);
+
+    GaussianSortReuseTracker tracker;
+    test.expect(tracker.update(path.back(), kGaussianSortSplats, settings));
+    test.expect(!tracker.update(path.back(), kGaussianSortSplats, settings) && tracker.getSortAge() == 1);
+    test.expect(tracker.update(path.back(), kGaussianSortSplats + 1, settings) && tracker.getSortAge() == 0);
+
+    LOGI("Gaussian sort reuse: first reused frame %.5f rank displacement, %.5f after %u still frames, %u of %u cases failed\n",
+         report.frames.size() > 1 ? report.frames[1].meanRankDisplacement : 0.0f, report.frames.back().meanRankDisplacement, stillFrames,
+         test.failures, test.cases);
+    return test.passed();
+}
+
+// checks every brick of an odd sized volume against its brute force range including the apron, that streaming the
+// slices in batches builds the same grid as one pass, and that the majorants bound the filtered opacity lookup
+bool volumeBrickGridSelfTest()
+{
+    TestCases test;
+
+    const glm::uvec3                        extent(21, 13, 19);
+    const size_t                            voxelCount = size_t(extent.x) * extent.y * extent.z;
+    std::mt19937                            random(0xb1c4u);
+    std::uniform_int_distribution<uint32_t> value(0, UINT16_MAX);
+    std::vector<uint16_t>                   intensity(voxelCount);
+    for (uint16_t& voxel : intensity)
+    {
+        voxel = uint16_t(value(random));
+    }
+
+    const VolumeBrickGrid grid = buildVolumeBrickGrid(intensity, extent, kVolumeBrickTestSize);
+    test.expect(grid.brickCount == glm::uvec3(3, 2, 3) && grid.minIntensity.size() == 18);
+    bool exact = true;
+    for (uint32_t z = 0; z < grid.brickCount.z; ++z)
+    {
+        for (uint32_t y = 0; y < grid.brickCount.y; ++y)
+        {
+            for (uint32_t x = 0; x < grid.brickCount.x; ++x)
+            {
+                const auto [minValue, maxValue] = bruteForceBrickRange(intensity, grid, {x, y, z});
+                const uint32_t brick            = grid.brickIndex(x, y, z);
+                exact = exact && grid.minIntensity[brick] == minValue && grid.maxIntensity[brick] == maxValue;
+            }
+        }
+    }
+    test.expect(exact);
+
+    // the last voxel of a brick lies in the apron of the next brick and the first voxel in the apron of the previous one
+    std::vector<uint16_t> spike(voxelCount, 0);
+    spike[(size_t(3) * extent.y + kVolumeBrickTestSize) * extent.x + kVolumeBrickTestSize - 1] = kVolumeBrickSpike;
+    const VolumeBrickGrid spikeGrid = buildVolumeBrickGrid(spike, extent, kVolumeBrickTestSize);
+    bool                  apron     = true;
+    for (uint32_t z = 0; z < spikeGrid.brickCount.z; ++z)
+    {
+        for (uint32_t y = 0; y < spikeGrid.brickCount.y; ++y)
+        {
+            for (uint32_t x = 0; x < spikeGrid.brickCount.x; ++x)
+            {
+                const bool reached = x <= 1 && y <= 1 && z == 0;
+                apron              = apron && spikeGrid.maxIntensity[spikeGrid.brickIndex(x, y, z)] == (reached ? kVolumeBrickSpike : 0);
+            }
+        }
+    }
+    test.expect(apron);
+
+    // batches that end inside a brick and inside an apron, the last one shorter
+    const size_t sliceVoxels = size_t(extent.x) * extent.y;
+    for (uint32_t batchSlices : {1u, 3u, 8u, 9u})
+    {
+        VolumeBrickGrid streamed = createVolumeBrickGrid(extent, kVolumeBrickTestSize);
+        for (uint32_t firstSlice = 0; firstSlice < extent.z; firstSlice += batchSlices)
+        {
+            const uint32_t sliceCount = std::min(batchSlices, extent.z - firstSlice);
+            accumulateVolumeBrickSlices(streamed, std::span(intensity).subspan(firstSlice * sliceVoxels, sliceCount * sliceVoxels), firstSlice);
+        }
+        test.expect(streamed.minIntensity == grid.minIntensity && streamed.maxIntensity == grid.maxIntensity);
+    }
+
+    // one opaque texel: a value between its center and the one below still blends it in, a value on the center
+    // below does not. A plain nearest texel lookup would miss the first
+    std::vector<uint8_t> opacityLookup(kVolumeOpacityTexels, 0);
+    opacityLookup[5] = 200;
+    auto texelValue  = [](float texel) { return uint16_t((texel + 0.5f) / float(kVolumeOpacityTexels) * float(UINT16_MAX)); };
+
+    VolumeBrickGrid widened = createVolumeBrickGrid({4 * kVolumeBrickTestSize, kVolumeBrickTestSize, kVolumeBrickTestSize}, kVolumeBrickTestSize);
+    widened.minIntensity    = {texelValue(4.2f), texelValue(2.9f), texelValue(5.8f), UINT16_MAX};
+    widened.maxIntensity    = {texelValue(4.4f), texelValue(3.0f), texelValue(5.8f), 0};
+    const std::vector<float> widenedMajorants = buildVolumeMajorantGrid(widened, opacityLookup);
+    test.expect(widenedMajorants == std::vector<float>{200.0f / 255.0f, 0.0f, 200.0f / 255.0f, 0.0f});
+
+    // every filtered lookup inside a brick's range stays below its majorant, and an empty majorant means none is opaque
+    for (uint8_t& opacity : opacityLookup)
+    {
+        opacity = value(random) % 3 == 0 ? uint8_t(value(random) % 256) : 0;
+    }
+    const std::vector<float> majorants = buildVolumeMajorantGrid(grid, opacityLookup);
+    bool                     bounded   = true;
+    for (size_t brick = 0; brick < majorants.size(); ++brick)
+    {
+        const uint32_t minValue = grid.minIntensity[brick];
+        const uint32_t maxValue = grid.maxIntensity[brick];
+        for (uint32_t sample = 0; sample <= kVolumeMajorantSamples; ++sample)
+        {
+            const uint16_t sampleValue = uint16_t(minValue + (maxValue - minValue) * sample / kVolumeMajorantSamples);
+            const float    opacity     = filteredOpacity(opacityLookup, sampleValue);
+            bounded                    = bounded && opacity <= majorants[brick] + 1e-6f && (majorants[brick] > 0.0f || opacity == 0.0f);
+        }
+    }
+    test.expect(bounded);
+
+    LOGI("Volume brick grid: %.2f empty bricks, %u of %u cases failed\n", computeEmptyBrickRatio(majorants), test.failures, test.cases);
+    return test.passed();
+}
+
+// bins lights of a few views, some crossing the near plane, off screen or behind the eye, and compares every cluster's
+// list with the lights whose sphere overlaps the cluster box, tested brute force against every cluster
+bool lightClusterSelfTest()
+{
+    TestCases test;
+
+    struct ClusterView
+    {
+        LightClusterGridDesc desc;
+        float                fovDegrees = 60.0f;
+        float                aspect     = 16.0f / 9.0f;
+        bool                 flipY      = false; // like the camera projection, the tile rows run against view space y
+    };
+    std::vector<ClusterView> views(4);
+    views[0].flipY             = true;
+    views[1].desc.clusterCount = {8, 8, 16};
+    views[1].aspect            = 1.0f;
+    views[1].fovDegrees        = 90.0f;
+    views[2].desc.clusterCount = {20, 6, 12};
+    views[2].desc.nearDepth    = 0.5f;
+    views[2].desc.farDepth     = 50.0f;
+    views[2].aspect            = 21.0f / 9.0f;
+    views[2].fovDegrees        = 40.0f;
+    // a small list overflows, the counts keep every overlapping light
+    views[3].desc.maxLightsPerCluster = 4;
+
+    uint32_t entries = 0;
+    for (const ClusterView& view : views)
+    {
+        const LightClusterGridDesc& desc    = view.desc;
+        glm::mat4                   proj    = glm::perspectiveRH_ZO(glm::radians(view.fovDegrees), view.aspect, desc.nearDepth, desc.farDepth);
+        proj[1][1] *= view.flipY ? -1.0f : 1.0f;
+        const glm::mat4 invProj = glm::inverse(proj);
+
+        std::vector<LightClusterSphere> lights = scatterClusterLights(desc, invProj, kLightClusterTestLights, 1.3f, 0xc157u);
+        lights.push_back({glm::vec3(0.0f, 0.0f, 0.0f), desc.nearDepth * 2.0f});                // around the eye
+        lights.push_back({glm::vec3(0.5f, -0.2f, desc.nearDepth * 4.0f), desc.nearDepth * 2.0f}); // behind the eye
+        lights.push_back({glm::vec3(0.0f, 0.0f, -desc.farDepth * 0.5f), desc.farDepth});         // covers every cluster
+
+        const std::vector<LightClusterBounds> clusterBounds = computeLightClusterBoundsGrid(desc, invProj);
+        LightClusterAssignment                assignment;
+        assignLightsToClusters(desc, clusterBounds, lights, assignment);
+
+        bool     matches    = assignment.counts.size() == desc.clusterTotal();
+        uint32_t overflowed = 0;
+        for (uint32_t cluster = 0; matches && cluster < desc.clusterTotal(); ++cluster)
+        {
+            std::vector<uint32_t> expected;
+            for (uint32_t light = 0; light < lights.size(); ++light)
+            {
+                if (sphereIntersectsClusterBounds(lights[light], clusterBounds[cluster])) expected.push_back(light);
+            }
+            const uint32_t stored = std::min(uint32_t(expected.size()), desc.maxLightsPerCluster);
+            const auto     listed = assignment.lightIndices.begin() + size_t(cluster) * desc.maxLightsPerCluster;
+            matches               = assignment.counts[cluster] == expected.size() && std::equal(expected.begin(), expected.begin() + stored, listed);
+            overflowed += expected.size() > desc.maxLightsPerCluster ? 1 : 0;
+        }
+        test.expect(matches);
+        test.expect(assignment.overflowClusters == overflowed && (desc.maxLightsPerCluster > 4 || overflowed > 0));
+        entries += uint32_t(assignment.totalEntries);
+    }
+
+    LOGI("Light cluster grid: %u entries over %zu views, %u of %u cases failed\n", entries, views.size(), test.failures, test.cases);
+    return test.passed();
+}
+
+// bins random splats of an odd sized viewport, several reaching past its border, and checks the entries against every
+// tile the radius square of every splat overlaps, their keys and their order, then that blending runs front to back
+bool gaussianTileReferenceSelfTest()
+{
+    TestCases test;
+
+    const glm::uvec2                        extent(93, 61);
+    const glm::uvec2                        tileCount = (extent + kGaussianTileSize - 1u) / kGaussianTileSize;
+    std::mt19937                            random(0x711eu);
+    std::uniform_real_distribution<float>   unit(0.0f, 1.0f);
+    std::vector<GaussianTileReferenceSplat> splats(kGaussianTileSplats);
+    for (uint32_t splatIndex = 0; splatIndex < kGaussianTileSplats; ++splatIndex)
+    {
+        // a 2d covariance from random axis scales and rotation, the radius from its larger eigen value like the projection
+        const float     angle      = unit(random) * 3.14159265f;
+        const glm::vec2 sigma      = glm::vec2(0.5f + 8.0f * unit(random), 0.5f + 8.0f * unit(random));
+        const float     cosAngle   = std::cos(angle);
+        const float     sinAngle   = std::sin(angle);
+        const glm::vec3 covariance = glm::vec3(cosAngle * cosAngle * sigma.x * sigma.x + sinAngle * sinAngle * sigma.y * sigma.y,
+                                               cosAngle * sinAngle * (sigma.x * sigma.x - sigma.y * sigma.y),
+                                               sinAngle * sinAngle * sigma.x * sigma.x + cosAngle * cosAngle * sigma.y * sigma.y);
+        const float     det        = covariance.x * covariance.z - covariance.y * covariance.y;
+
+        GaussianTileReferenceSplat& splat = splats[splatIndex];
+        splat.splatIndex                  = splatIndex * 3 + 1;
+        splat.center                      = glm::vec2(unit(random), unit(random)) * glm::vec2(extent);
+        splat.depth                       = unit(random);
+        splat.radius                      = std::ceil(sqrt8 * std::max(sigma.x, sigma.y));
+        splat.conic                       = glm::vec3(covariance.z / det, -covariance.y / det, covariance.x / det);
+        splat.color                       = glm::vec4(unit(random), unit(random), unit(random), 0.2f + 0.8f * unit(random));
+    }
+    // listed against the splat index order, which the binning has to restore on equal keys
+    std::reverse(splats.begin(), splats.end());
+    splats[0].depth = splats[1].depth;
+
+    const std::vector<GaussianTileEntry>       entries   = binGaussianTiles(splats, extent.x, extent.y, kGaussianTileDepthBits);
+    const uint32_t                             depthMask = (1u << kGaussianTileDepthBits) - 1u;
+    std::vector<std::pair<uint32_t, uint32_t>> binned;
+    bool                                       keysMatch = true;
+    for (const GaussianTileEntry& entry : entries)
+    {
+        binned.emplace_back(entry.key >> kGaussianTileDepthBits, entry.splat);
+        keysMatch = keysMatch && entry.splat < splats.size() && (entry.key & depthMask) == uint32_t(splats[entry.splat].depth * float(depthMask));
+    }
+    test.expect(keysMatch);
+
+    std::vector<std::pair<uint32_t, uint32_t>> overlapping;
+    for (uint32_t tile = 0; tile < tileCount.x * tileCount.y; ++tile)
+    {
+        const glm::vec2 tileMin = glm::vec2(float(tile % tileCount.x), float(tile / tileCount.x)) * float(kGaussianTileSize);
+        const glm::vec2 tileMax = tileMin + float(kGaussianTileSize);
+        for (uint32_t splat = 0; splat < splats.size(); ++splat)
+        {
+            const glm::vec2 low  = splats[splat].center - splats[splat].radius;
+            const glm::vec2 high = splats[splat].center + splats[splat].radius;
+            if (tileMin.x <= high.x && tileMax.x > low.x && tileMin.y <= high.y && tileMax.y > low.y) overlapping.emplace_back(tile, splat);
+        }
+    }
+    std::vector<std::pair<uint32_t, uint32_t>> sortedBinned = binned;
+    std::sort(sortedBinned.begin(), sortedBinned.end());
+    test.expect(sortedBinned == overlapping);
+
+    bool ordered = true;
+    for (size_t entry = 1; entry < entries.size(); ++entry)
+    {
+        const GaussianTileEntry& previous = entries[entry - 1];
+        const GaussianTileEntry& current  = entries[entry];
+        ordered = ordered && (previous.key < current.key ||
+                              (previous.key == current.key && splats[previous.splat].splatIndex < splats[current.splat].splatIndex));
+    }
+    test.expect(ordered);
+
+    // a nearly opaque red splat in front of a green one hides it, swapping their depths shows the green one
+    GaussianTileReferenceSplat front;
+    front.center = glm::vec2(8.0f);
+    front.radius = 8.0f;
+    front.conic  = glm::vec3(0.1f, 0.0f, 0.1f);
+    front.depth  = 0.25f;
+    front.color  = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+    GaussianTileReferenceSplat back = front;
+    back.splatIndex                 = 1;
+    back.depth                      = 0.75f;
+    back.color                      = glm::vec4(0.0f, 1.0f, 0.0f, 1.0f);
+    std::vector<glm::vec4> pixels;
+    rasterizeGaussianTilesReference(std::vector<GaussianTileReferenceSplat>{back, front}, 16, 16, kGaussianTileDepthBits, pixels);
+    const glm::vec4 frontFirst = pixels[8 * 16 + 8];
+    std::swap(front.depth, back.depth);
+    rasterizeGaussianTilesReference(std::vector<GaussianTileReferenceSplat>{back, front}, 16, 16, kGaussianTileDepthBits, pixels);
+    const glm::vec4 backFirst = pixels[8 * 16 + 8];
+    test.expect(frontFirst.r > 0.9f && frontFirst.g < 0.1f && backFirst.g > 0.9f && backFirst.r < 0.1f);
+    test.expect(std::abs(frontFirst.a - backFirst.a) < 1e-6f && frontFirst.a <= 1.0f);
+
+    // overlapping splats saturate a pixel, the blend stops before the transmittance falls under the cutoff
+    rasterizeGaussianTilesReference(splats, extent.x, extent.y, kGaussianTileDepthBits, pixels);
+    bool covered = pixels.size() == size_t(extent.x) * extent.y;
+    for (const glm::vec4& pixel : pixels)
+    {
+        covered = covered && pixel.a >= 0.0f && 1.0f - pixel.a >= kGaussianTileTransmittanceCutoff;
+    }
+    test.expect(covered);
+    test.expect(compareGaussianImages(pixels, pixels, 0.0f).mismatchedPixels == 0);
+
+    LOGI("Gaussian tile reference: %zu tile entries of %u splats, %u of %u cases failed\n", entries.size(), kGaussianTileSplats, test.failures,
+         test.cases);
+    return test.passed();
+}
+
+// checks the sh evaluator against spherical harmonics built from the Legendre recurrence for every degree, then that
+// colors cached from a camera whose direction to the chunk drifted less than the refresh threshold stay close to a
+// fresh evaluation, stored in fp16 like the cache
+bool gaussianShEvaluatorSelfTest()
+{
+    TestCases test;
+
+    test.expect(getGaussianShDegree(0) == 0 && getGaussianShDegree(9) == 1 && getGaussianShDegree(24) == 2 && getGaussianShDegree(45) == 3);
+
+    std::mt19937                          random(0x5ba5u);
+    std::uniform_real_distribution<float> coefficient(-0.3f, 0.3f);
+    float                                 maxError = 0.0f;
+    for (uint32_t shDegree = 1; shDegree <= 3; ++shDegree)
+    {
+        const uint32_t     perChannel = (shDegree + 1) * (shDegree + 1) - 1;
+        const uint32_t     shStride   = perChannel * 3;
+        std::vector<float> shRest(size_t(shStride) * 2);
+        for (float& value : shRest)
+        {
+            value = coefficient(random);
+        }
+        for (uint32_t sample = 0; sample < kGaussianShDirections; ++sample)
+        {
+            const uint32_t  splatIndex = sample % 2;
+            const glm::vec3 direction  = randomUnitVector(random);
+            glm::vec3       expected(0.0f);
+            for (int l = 1; l <= int(shDegree); ++l)
+            {
+                for (int m = -l; m <= l; ++m)
+                {
+                    // channel-major, the rest coefficients start at degree 1
+                    const uint32_t  index = uint32_t(l * l + l + m - 1);
+                    const float*    base  = shRest.data() + size_t(splatIndex) * shStride;
+                    const glm::vec3 sh    = glm::vec3(base[index], base[perChannel + index], base[perChannel * 2 + index]);
+                    expected += realSphericalHarmonic(l, m, direction) * sh;
+                }
+            }
+            const glm::vec3 delta = glm::abs(evaluateGaussianShRadiance(shRest, shStride, splatIndex, direction) - expected);
+            maxError              = std::max(maxError, std::max(delta.x, std::max(delta.y, delta.z)));
+        }
+    }
+    test.expect(maxError <= kGaussianShTolerance);
+
+    // one chunk of degree 3 splats around its center, seen from a camera that moved until the direction to the chunk
+    // center turned by the angle. The cache keeps the fp16 colors of the first camera position
+    const uint32_t         shStride = 45;
+    std::vector<float>     shRest(size_t(shStride) * kGaussianShChunkSplats);
+    std::vector<glm::vec3> positions(kGaussianShChunkSplats);
+    for (float& value : shRest)
+    {
+        value = coefficient(random);
+    }
+    for (glm::vec3& position : positions)
+    {
+        position = randomUnitVector(random) * std::cbrt(std::uniform_real_distribution<float>(0.0f, 1.0f)(random));
+    }
+    const glm::vec3 cachedCamera(0.0f, 0.0f, 10.0f);
+    auto            cacheError = [&](float driftDegrees)
+    {
+        const float     drift  = glm::radians(driftDegrees);
+        const glm::vec3 camera = glm::vec3(std::sin(drift), 0.0f, std::cos(drift)) * glm::length(cachedCamera);
+        float           error  = 0.0f;
+        for (uint32_t splat = 0; splat < kGaussianShChunkSplats; ++splat)
+        {
+            const glm::vec3 cached = evaluateGaussianShRadiance(shRest, shStride, splat, glm::normalize(positions[splat] - cachedCamera));
+            const glm::vec2 storedRG = glm::unpackHalf2x16(glm::packHalf2x16(glm::vec2(cached)));
+            const glm::vec3 stored   = glm::vec3(storedRG, glm::unpackHalf2x16(glm::packHalf2x16(glm::vec2(cached.z))).x);
+            const glm::vec3 fresh = evaluateGaussianShRadiance(shRest, shStride, splat, glm::normalize(positions[splat] - camera));
+            const glm::vec3 delta = glm::abs(stored - fresh);
+            error                 = std::max(error, std::max(delta.x, std::max(delta.y, delta.z)));
+        }
+        return error;
+    };
+    const float unmovedError   = cacheError(0.0f);
+    const float thresholdError = cacheError(kGaussianShCacheAngle);
+    const float staleError     = cacheError(kGaussianShCacheAngle * 10.0f);
+    test.expect(unmovedError <= 1e-3f && thresholdError <= kGaussianShCacheError && staleError > kGaussianShCacheError);
+
+    LOGI("Gaussian sh evaluator: max %.2e from the reference harmonics; cache error %.5f unmoved, %.5f at %.1f degrees, %.5f at %.1f degrees, "
+         "%u of %u cases failed\n",
+         maxError, unmovedError, thresholdError, kGaussianShCacheAngle, staleError, kGaussianShCacheAngle * 10.0f, test.failures, test.cases);
+    return test.passed();
+}
+
+// replays frames through the lut tracker and counts the dispatches the sky pass would record: none while nothing
+// changes after the first frame, only the sky-view lut for the sun and the altitude, all of them for the medium
+bool atmosphereLutCacheSelfTest()
+{
+    TestCases test;
+
+    struct LutDispatches
+    {
+        uint32_t transmittance   = 0;
+        uint32_t multiScattering = 0;
+        uint32_t skyView         = 0;
+    };
+    AtmosphereLutTracker  tracker;
+    AtmosphereLutSettings settings;
+    auto                  runFrames = [&](const AtmosphereParameters& atmosphere, float viewHeight, uint32_t frameCount)
+    {
+        LutDispatches dispatches;
+        for (uint32_t frame = 0; frame < frameCount; ++frame)
+        {
+            tracker.update(atmosphere, viewHeight, settings);
+            dispatches.transmittance += tracker.bakeAtmosphereLuts() ? 1 : 0;
+            dispatches.multiScattering += tracker.bakeAtmosphereLuts() ? 1 : 0;
+            dispatches.skyView += tracker.bakeSkyViewLut() ? 1 : 0;
+        }
+        return dispatches;
+    };
+
+    AtmosphereParameters atmosphere;
+    const float          groundHeight = atmosphere.BottomRadius + 0.002f;
+    LutDispatches        first        = runFrames(atmosphere, groundHeight, 1);
+    test.expect(first.transmittance == 1 && first.multiScattering == 1 && first.skyView == 1);
+    LutDispatches still = runFrames(atmosphere, groundHeight, kAtmosphereStillFrames);
+    test.expect(still.transmittance == 0 && still.multiScattering == 0 && still.skyView == 0);
+    // a fresh copy with the same values is the same atmosphere
+    const AtmosphereParameters copy = atmosphere;
+    still                           = runFrames(copy, groundHeight, kAtmosphereStillFrames);
+    test.expect(still.transmittance == 0 && still.multiScattering == 0 && still.skyView == 0);
+
+    atmosphere.sun_dir.y += 0.01f;
+    LutDispatches sun = runFrames(atmosphere, groundHeight, kAtmosphereStillFrames);
+    test.expect(sun.transmittance == 0 && sun.multiScattering == 0 && sun.skyView == 1);
+    atmosphere.MiePhaseG = 0.7f;
+    LutDispatches medium = runFrames(atmosphere, groundHeight, kAtmosphereStillFrames);
+    test.expect(medium.transmittance == 1 && medium.multiScattering == 1 && medium.skyView == 1);
+
+    // the reference altitude is the one of the last bake, so small steps add up until they pass the tolerance. Ten
+    // meters keep the steps well above the float spacing at planet radius
+    settings.SkyViewAltitudeTolerance = 0.01f;
+
+    const float   step  = settings.SkyViewAltitudeTolerance * 0.4f;
+    LutDispatches climb = runFrames(atmosphere, groundHeight + step, 1);
+    climb.skyView += runFrames(atmosphere, groundHeight + step * 2.0f, 1).skyView;
+    test.expect(climb.transmittance == 0 && climb.skyView == 0);
+    climb = runFrames(atmosphere, groundHeight + step * 3.0f, kAtmosphereStillFrames);
+    test.expect(climb.transmittance == 0 && climb.multiScattering == 0 && climb.skyView == 1);
+
+    // every float of the struct has to reach the hash of the luts that read it, and only that one
+    bool coveredMedium = true;
+    bool coveredSky    = true;
+    bool ignoredRest   = true;
+    for (uint32_t index = 0; index < sizeof(AtmosphereParameters) / sizeof(float); ++index)
+    {
+        AtmosphereParameters changed = atmosphere;
+        reinterpret_cast<float*>(&changed)[index] += 0.5f;
+        const bool mediumChanged = hashAtmosphereMedium(changed) != hashAtmosphereMedium(atmosphere);
+        const bool skyChanged    = hashAtmosphereSkyView(changed, 0) != hashAtmosphereSkyView(atmosphere, 0);
+        if (index < kAtmosphereMediumFloats)
+        {
+            coveredMedium = coveredMedium && mediumChanged;
+        }
+        else if (index < kAtmosphereSkyFloats)
+        {
+            coveredSky = coveredSky && !mediumChanged && skyChanged;
+        }
+        else
+        {
+            ignoredRest = ignoredRest && !mediumChanged && !skyChanged;
+        }
+    }
+    test.expect(coveredMedium && coveredSky && ignoredRest);
+
+    // medium luts loaded from disk only leave the sky-view lut to bake
+    AtmosphereLutTracker loaded;
+    loaded.markMediumBaked(hashAtmosphereMedium(atmosphere));
+    loaded.update(atmosphere, groundHeight, settings);
+    test.expect(!loaded.bakeAtmosphereLuts() && loaded.bakeSkyViewLut());
+
+    settings.CacheLuts           = false;
+    const LutDispatches uncached = runFrames(atmosphere, groundHeight, kAtmosphereStillFrames);
+    test.expect(uncached.transmittance == kAtmosphereStillFrames && uncached.multiScattering == kAtmosphereStillFrames &&
+                uncached.skyView == kAtmosphereStillFrames);
+
+    LOGI("Atmosphere lut cache: %u still frames, %u dispatches after the first frame, %u of %u cases failed\n", kAtmosphereStillFrames,
+         still.transmittance + still.multiScattering + still.skyView, test.failures, test.cases);
+    return test.passed();
+}
+
+// times the cpu cluster assignment of 1k and 10k lights in the default grid
+bool lightClusterBenchmark()
+{
+    const LightClusterGridDesc desc;
+    const glm::mat4            proj      = makeCameraProjection(16.0f / 9.0f, desc.nearDepth, desc.farDepth);
+    const LightClusterTiming   timing1k  = timeLightClusterAssignment(desc, proj, 1000);
+    const LightClusterTiming   timing10k = timeLightClusterAssignment(desc, proj, 10000);
+    LOGI("Light cluster assignment (%ux%ux%u clusters): 1k lights %.3f ms, %.2f per cluster; 10k lights %.3f ms, %.2f per cluster, %u of %u "
+         "clusters over %u lights\n",
+         desc.clusterCount.x, desc.clusterCount.y, desc.clusterCount.z, timing1k.assignMs, timing1k.averageLightsPerCluster, timing10k.assignMs,
+         timing10k.averageLightsPerCluster, timing10k.overflowClusters, desc.clusterTotal(), desc.maxLightsPerCluster);
+    return timing1k.averageLightsPerCluster > 0.0f && timing10k.averageLightsPerCluster >= timing1k.averageLightsPerCluster;
+}
+
+} // namespace Play::Tests
@@ -0,0 +1,457 @@
+#include "PlayGroundTests.h"
+#include "CpuScene.h"
+#include "SceneBVH.h"
+#include "SceneSnapshot.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <glm/gtc/matrix_transform.hpp>
+#include <nvutils/file_mapping.hpp>
+#include <nvutils/logger.hpp>
+
+namespace Play::Tests
+{
+
+namespace
+{
+constexpr uint32_t kBenchmarkComponents = 1000000;
+constexpr uint32_t kSnapshotNodes       = 1000000;
+constexpr uint32_t kSnapshotTestNodes   = 1000;
+constexpr uint32_t kSnapshotChildren    = 8;
+constexpr uint32_t kSnapshotModelStride = 16; // every 16th node carries a model component
+constexpr uint32_t kTestBVHInstances    = 2000;
+constexpr uint32_t kMinBVHInstances     = 10000;
+constexpr uint32_t kMaxBVHInstances     = 1000000;
+
+using Clock = std::chrono::steady_clock;
+
+float elapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
+
+class BenchmarkComponent : public CpuSceneComponent
+{
+public:
+    BenchmarkComponent() = default;
+    explicit BenchmarkComponent(uint32_t value) : value(value) {}
+
+    uint32_t value = 0;
+};
+
+// the linear references the tree queries are checked against, the same tests SceneBVH runs per node
+bool isOverlapping(const AABB& lhs, const AABB& rhs)
+{
+    return lhs.min.x <= rhs.max.x && lhs.max.x >= rhs.min.x && lhs.min.y <= rhs.max.y && lhs.max.y >= rhs.min.y && lhs.min.z <= rhs.max.z &&
+           lhs.max.z >= rhs.min.z;
+}
+
+using FrustumPlanes = std::array<glm::vec4, 6>;
+
+// rows of the clip matrix combined into the planes of the clip volume, -w <= x, y <= w and 0 <= z <= w
+FrustumPlanes getFrustumPlanes(const glm::mat4& viewProj)
+{
+    const glm::vec4 row0(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+    const glm::vec4 row1(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+    const glm::vec4 row2(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+    const glm::vec4 row3(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+    return {row3 + row0, row3 - row0, row3 + row1, row3 - row1, row2, row3 - row2};
+}
+
+// -1 when the bounds are wholly outside one plane, which is where all eight corners are outside it, 1 when they are
+// wholly inside every plane and 0 when they cross the frustum
+int classifyBounds(const FrustumPlanes& planes, const AABB& bounds)
+{
+    bool inside = true;
+    for (const glm::vec4& plane : planes)
+    {
+        const glm::vec3 farthest(plane.x >= 0.0f ? bounds.max.x : bounds.min.x, plane.y >= 0.0f ? bounds.max.y : bounds.min.y,
+                                 plane.z >= 0.0f ? bounds.max.z : bounds.min.z);
+        if (glm::dot(glm::vec3(plane), farthest) + plane.w < 0.0f)
+        {
+            return -1;
+        }
+        const glm::vec3 nearest(plane.x >= 0.0f ? bounds.min.x : bounds.max.x, plane.y >= 0.0f ? bounds.min.y : bounds.max.y,
+                                plane.z >= 0.0f ? bounds.min.z : bounds.max.z);
+        inside = inside && glm::dot(glm::vec3(plane), nearest) + plane.w >= 0.0f;
+    }
+    return inside ? 1 : 0;
+}
+
+// the distances at which the ray enters and leaves the bounds, false when it misses them or they are behind it
+bool intersectBounds(const glm::vec3& origin, const glm::vec3& inverseDirection, const AABB& bounds, float& entry, float& exit)
+{
+    const glm::vec3 t0    = (bounds.min - origin) * inverseDirection;
+    const glm::vec3 t1    = (bounds.max - origin) * inverseDirection;
+    const glm::vec3 tNear = glm::min(t0, t1);
+    const glm::vec3 tFar  = glm::max(t0, t1);
+    entry                 = std::max(std::max(tNear.x, tNear.y), tNear.z);
+    exit                  = std::min(std::min(tFar.x, tFar.y), tFar.z);
+    return exit >= std::max(entry, 0.0f);
+}
+
+// the distance an instance is hit at, the far side of bounds around the origin
+bool getInstanceDistance(const glm::vec3& origin, const glm::vec3& inverseDirection, const AABB& bounds, float maxDistance, float& distance)
+{
+    float entry = 0.0f;
+    float exit  = 0.0f;
+    if (!intersectBounds(origin, inverseDirection, bounds, entry, exit))
+    {
+        return false;
+    }
+    distance = entry >= 0.0f ? entry : exit;
+    return distance <= maxDistance;
+}
+
+struct SceneBVHTiming
+{
+    uint32_t instances        = 0;
+    uint32_t nodes            = 0;
+    float    buildMs          = 0.0f;
+    float    refitMs          = 0.0f;  // every instance moved
+    float    partialRefitMs   = 0.0f;  // one instance in a hundred moved
+    float    frustumMs        = 0.0f;  // per query
+    float    linearFrustumMs  = 0.0f;  // the same frustum tested against every instance
+    float    rayMs            = 0.0f;  // per ray
+    float    aabbMs           = 0.0f;  // per query
+    uint32_t frustumInstances = 0;     // returned by one frustum query on average
+    bool     matched          = false; // every query returned what a linear scan over the instances returns
+};
+
+// builds a tree over instanceCount boxes scattered in a cube, refits and queries it, and checks the queries against
+// linear scans
+SceneBVHTiming timeSceneBVH(uint32_t instanceCount)
+{
+    constexpr uint32_t kFrustumQueries  = 16;
+    constexpr uint32_t kRays            = 1024;
+    constexpr uint32_t kBoundsQueries   = 1024;
+    constexpr uint32_t kCheckedQueries  = 32; // of the rays and bounds queries, checked against linear scans
+    constexpr uint32_t kPartialInterval = 100;
+
+    SceneBVHTiming timing;
+    timing.instances = instanceCount;
+
+    // boxes of 1 to 4 units in a cube holding about one per thousand cubic units
+    std::mt19937                          random(1234);
+    const float                           worldSize = std::cbrt(static_cast<float>(instanceCount)) * 10.0f;
+    std::uniform_real_distribution<float> position(0.0f, worldSize);
+    std::uniform_real_distribution<float> size(1.0f, 4.0f);
+    std::uniform_real_distribution<float> offset(-2.0f, 2.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    auto                                  randomBounds = [&](float extent)
+    {
+        AABB bounds;
+        bounds.min = glm::vec3(position(random), position(random), position(random));
+        bounds.max = bounds.min + glm::vec3(extent > 0.0f ? extent : size(random));
+        return bounds;
+    };
+
+    std::vector<SceneBVHInstance> instances(instanceCount);
+    for (uint32_t instance = 0; instance < instanceCount; ++instance)
+    {
+        instances[instance].node   = {instance, 1};
+        instances[instance].bounds = randomBounds(0.0f);
+    }
+
+    SceneBVH          bvh;
+    Clock::time_point start = Clock::now();
+    bvh.build(instances);
+    timing.buildMs = elapsedMs(start);
+    timing.nodes   = bvh.getStats().nodes;
+
+    auto moveInstance = [&](uint32_t instance)
+    {
+        const glm::vec3 delta(offset(random), offset(random), offset(random));
+        instances[instance].bounds.min += delta;
+        instances[instance].bounds.max += delta;
+    };
+    for (uint32_t instance = 0; instance < instanceCount; ++instance)
+    {
+        moveInstance(instance);
+    }
+    start = Clock::now();
+    for (uint32_t instance = 0; instance < instanceCount; ++instance)
+    {
+        bvh.setInstanceBounds(instance, instances[instance].bounds);
+    }
+    bvh.refit();
+    timing.refitMs = elapsedMs(start);
+
+    for (uint32_t instance = 0; instance < instanceCount; instance += kPartialInterval)
+    {
+        moveInstance(instance);
+    }
+    start = Clock::now();
+    for (uint32_t instance = 0; instance < instanceCount; instance += kPartialInterval)
+    {
+        bvh.setInstanceBounds(instance, instances[instance].bounds);
+    }
+    bvh.refit();
+    timing.partialRefitMs = elapsedMs(start);
+
+    bool                  matched = true;
+    std::vector<uint32_t> found;
+    std::vector<uint32_t> expected;
+
+    // cameras inside the cube looking along random directions, seeing a fifth of it in depth
+    float    frustumMs    = 0.0f;
+    float    linearMs     = 0.0f;
+    uint64_t frustumFound = 0;
+    for (uint32_t query = 0; query < kFrustumQueries; ++query)
+    {
+        const glm::vec3     eye(position(random), position(random), position(random));
+        const glm::vec3     forward    = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 1e-3f));
+        const glm::vec3     up         = std::abs(forward.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        const glm::mat4     projection = glm::perspectiveRH_ZO(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, worldSize * 0.2f);
+        const glm::mat4     viewProj   = projection * glm::lookAt(eye, eye + forward, up);
+        const FrustumPlanes planes     = getFrustumPlanes(viewProj);
+
+        found.clear();
+        start = Clock::now();
+        bvh.queryFrustum(viewProj, found);
+        frustumMs += elapsedMs(start);
+        frustumFound += found.size();
+
+        expected.clear();
+        start = Clock::now();
+        for (uint32_t instance = 0; instance < instanceCount; ++instance)
+        {
+            if (classifyBounds(planes, instances[instance].bounds) >= 0)
+            {
+                expected.push_back(instance);
+            }
+        }
+        linearMs += elapsedMs(start);
+
+        std::sort(found.begin(), found.end());
+        matched = matched && found == expected;
+    }
+    timing.frustumMs        = frustumMs / kFrustumQueries;
+    timing.linearFrustumMs  = linearMs / kFrustumQueries;
+    timing.frustumInstances = static_cast<uint32_t>(frustumFound / kFrustumQueries);
+
+    float rayMs = 0.0f;
+    for (uint32_t ray = 0; ray < kRays; ++ray)
+    {
+        const glm::vec3 origin(position(random), position(random), position(random));
+        const glm::vec3 direction = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 1e-3f));
+        start                     = Clock::now();
+        const SceneBVHHit hit     = bvh.raycast(origin, direction, worldSize);
+        rayMs += elapsedMs(start);
+
+        if (ray < kCheckedQueries)
+        {
+            SceneBVHHit     nearest;
+            const glm::vec3 inverseDirection = 1.0f / direction;
+            nearest.distance                 = worldSize;
+            for (uint32_t instance = 0; instance < instanceCount; ++instance)
+            {
+                float distance = 0.0f;
+                if (getInstanceDistance(origin, inverseDirection, instances[instance].bounds, nearest.distance, distance) &&
+                    (nearest.instance == INVALID_SCENE_ID || distance < nearest.distance))
+                {
+                    nearest.instance = instance;
+                    nearest.distance = distance;
+                }
+            }
+            // two instances may be hit at the same distance, either one is right
+            matched = matched && (hit.instance == INVALID_SCENE_ID) == (nearest.instance == INVALID_SCENE_ID) && hit.distance == nearest.distance;
+        }
+    }
+    timing.rayMs = rayMs / kRays;
+
+    float boundsMs = 0.0f;
+    for (uint32_t query = 0; query < kBoundsQueries; ++query)
+    {
+        const AABB bounds = randomBounds(worldSize * 0.05f);
+        found.clear();
+        start = Clock::now();
+        bvh.queryAABB(bounds, found);
+        boundsMs += elapsedMs(start);
+
+        if (query < kCheckedQueries)
+        {
+            expected.clear();
+            for (uint32_t instance = 0; instance < instanceCount; ++instance)
+            {
+                if (isOverlapping(instances[instance].bounds, bounds))
+                {
+                    expected.push_back(instance);
+                }
+            }
+            std::sort(found.begin(), found.end());
+            matched = matched && found == expected;
+        }
+    }
+    timing.aabbMs  = boundsMs / kBoundsQueries;
+    timing.matched = matched;
+    return timing;
+}
+struct SceneSnapshotRun
+{
+    SceneSnapshotResult saved;
+    SceneSnapshotResult loaded;
+    float               captureMs      = 0.0f;
+    bool                roundTrip      = false; // saving the loaded scene again gave the same file
+    bool                modelsRestored = false; // every loaded model component holds the values it was saved with
+};
+
+// saves a synthetic scene of nodeCount nodes, loads it back and saves the loaded scene again. The file is deleted
+// afterwards
+SceneSnapshotRun runSceneSnapshot(uint32_t nodeCount, const char* fileName)
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / fileName;
+    SceneSnapshotRun            run;
+    SceneSnapshot               snapshot;
+    {
+        // a wide tree of translated nodes, every 16th with a model component that was never loaded
+        CpuScene                    source;
+        std::vector<CpuSceneNodeID> nodeIDs = {source.rootNode()};
+        nodeIDs.reserve(nodeCount);
+        for (uint32_t index = 1; index < nodeCount; ++index)
+        {
+            const CpuSceneNodeID nodeID = source.create3DNode("Node" + std::to_string(index), nodeIDs[(index - 1) / kSnapshotChildren]);
+            source.setLocalTranslation(nodeID, glm::vec3(float(index % 97), float(index % 89), float(index % 83)));
+            if (index % kSnapshotModelStride == 0)
+            {
+                CpuModelComponent* component         = source.addComponent<CpuModelComponent>(nodeID);
+                component->sourcePath                = "content/models/synthetic" + std::to_string(index % 32) + ".gltf";
+                component->loadingConfig.format      = ModelFileFormat::eGltf;
+                component->loadingConfig.globalScale = 0.5f + float(index % 4);
+            }
+            nodeIDs.push_back(nodeID);
+        }
+
+        const Clock::time_point start = Clock::now();
+        snapshot                      = captureSceneSnapshot(source);
+        run.captureMs                 = elapsedMs(start);
+    }
+
+    run.saved = writeSceneSnapshot(snapshot, path);
+    snapshot  = {};
+    if (!run.saved.succeeded) return run;
+
+    CpuScene loadedScene;
+    run.loaded = loadSceneSnapshot(loadedScene, path);
+
+    nvutils::FileReadMapping   mapping;
+    const std::vector<uint8_t> reencoded = encodeSceneSnapshot(captureSceneSnapshot(loadedScene));
+    run.roundTrip                        = run.loaded.succeeded && run.loaded.nodes == nodeCount && mapping.open(path) &&
+                                           mapping.size() == reencoded.size() && std::memcmp(mapping.data(), reencoded.data(), reencoded.size()) == 0;
+    mapping.close();
+
+    run.modelsRestored = run.loaded.succeeded;
+    for (const CpuModelComponent& component : loadedScene.view<CpuModelComponent>())
+    {
+        const float scale  = component.loadingConfig.globalScale;
+        run.modelsRestored = run.modelsRestored && component.sourcePath.rfind("content/models/synthetic", 0) == 0 &&
+                             component.loadingConfig.format == ModelFileFormat::eGltf && scale == std::floor(scale) + 0.5f && scale < 4.0f;
+    }
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    return run;
+}
+} // namespace
+
+// creates components of a small type in a store of its own, iterates them through a view and removes them again
+bool componentStoreBenchmark()
+{
+    const uint32_t                   count = kBenchmarkComponents;
+    ComponentStore                   store;
+    std::vector<CpuSceneComponentID> componentIDs;
+    componentIDs.reserve(count);
+
+    Clock::time_point start = Clock::now();
+    for (uint32_t index = 0; index < count; ++index)
+    {
+        componentIDs.push_back(store.create<BenchmarkComponent>({index, 1}, index));
+    }
+    const float createMs = elapsedMs(start);
+
+    start          = Clock::now();
+    uint64_t total = 0;
+    for (const BenchmarkComponent& component : store.view<BenchmarkComponent>())
+    {
+        total += component.value;
+    }
+    const float iterateMs = elapsedMs(start);
+
+    // every other component first, so most removals move the last one into the gap
+    start = Clock::now();
+    for (uint32_t parity = 0; parity < 2; ++parity)
+    {
+        for (uint32_t index = parity; index < count; index += 2)
+        {
+            store.remove(componentIDs[index]);
+        }
+    }
+    const float removeMs = elapsedMs(start);
+    const bool  matched  = total == static_cast<uint64_t>(count) * (count - 1) / 2 && store.view<BenchmarkComponent>().size() == 0;
+    LOGI("Component store, %u components: create %.3f ms, iterate %.3f ms, remove %.3f ms, %s\n", count, createMs, iterateMs, removeMs,
+         matched ? "matched" : "mismatched");
+    return matched;
+}
+
+// saves and loads a scene holding only its root and one of a thousand nodes: the node and component counts have to
+// survive, the loaded components have to hold their values and saving the loaded scene has to give the same file
+bool sceneSnapshotSelfTest()
+{
+    TestCases test;
+    for (uint32_t nodeCount : {1u, kSnapshotTestNodes})
+    {
+        const SceneSnapshotRun run = runSceneSnapshot(nodeCount, "snapshot_self_test.pscene");
+        test.expect(run.saved.succeeded && run.loaded.succeeded);
+        test.expect(run.loaded.nodes == nodeCount && run.loaded.components == (nodeCount - 1) / kSnapshotModelStride);
+        test.expect(run.roundTrip && run.modelsRestored);
+    }
+    LOGI("Scene snapshot: %u of %u cases failed\n", test.failures, test.cases);
+    return test.passed();
+}
+
+// times saving and loading a scene of a million nodes, a model component on every 16th
+bool sceneSnapshotBenchmark()
+{
+    const SceneSnapshotRun run = runSceneSnapshot(kSnapshotNodes, "snapshot_benchmark.pscene");
+    LOGI("Scene snapshot, %u nodes, %u components, %.1f MB: capture %.3f ms, write %.3f ms, load %.3f ms, round trip %s\n", run.loaded.nodes,
+         run.loaded.components, static_cast<float>(run.saved.bytes) / (1024.0f * 1024.0f), run.captureMs, run.saved.ms, run.loaded.ms,
+         run.roundTrip && run.modelsRestored ? "matched" : "mismatched");
+    return run.roundTrip && run.modelsRestored;
+}
+
+// builds, refits and queries a single instance tree, one of a few leaves and one of a few thousand instances, every
+// query has to return what the linear scan over the instances returns
+bool sceneBVHSelfTest()
+{
+    TestCases test;
+    for (uint32_t instances : {1u, 37u, kTestBVHInstances})
+    {
+        const SceneBVHTiming timing = timeSceneBVH(instances);
+        test.expect(timing.matched);
+        test.expect(timing.nodes > 0 && timing.nodes < instances * 2);
+    }
+    LOGI("Scene BVH: %u of %u cases failed\n", test.failures, test.cases);
+    return test.passed();
+}
+
+// builds, refits and queries trees of 10k instances and up by tens
+bool sceneBVHBenchmark()
+{
+    bool matched = true;
+    for (uint32_t instances = kMinBVHInstances; instances <= kMaxBVHInstances; instances *= 10)
+    {
+        const SceneBVHTiming timing = timeSceneBVH(instances);
+        LOGI("Scene BVH, %u instances, %u nodes: build %.3f ms, refit %.3f ms, partial refit %.3f ms, frustum %.3f ms against %.3f ms "
+             "linear (%u found), ray %.4f ms, bounds %.4f ms, %s\n",
+             timing.instances, timing.nodes, timing.buildMs, timing.refitMs, timing.partialRefitMs, timing.frustumMs, timing.linearFrustumMs,
+             timing.frustumInstances, timing.rayMs, timing.aabbMs, timing.matched ? "matched" : "mismatched");
+        matched = matched && timing.matched;
+    }
+    return matched;
+}
+
+} // namespace Play::Tests
@@ -0,0 +1,250 @@
+#include "PlayGroundTests.h"
+#include "TextureResidency.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <nvutils/logger.hpp>
+
+namespace Play::Tests
+{
+
+namespace
+{
+constexpr uint32_t kResidencyTextures = 4096;
+
+struct ResidencyTestResult
+{
+    uint32_t textures     = 0;
+    uint32_t frames       = 0;
+    float    budgetMB     = 0.0f;
+    float    peakMB       = 0.0f;  // resident and loading
+    uint32_t loads        = 0;
+    uint32_t evictions    = 0;
+    uint32_t settleFrames = 0;     // the longest any camera position took until no change was planned
+    float    ms           = 0.0f;
+    bool     withinBudget = false;
+    bool     settled      = false; // every texture ended at the mip the policy gives it, and stayed there
+};
+
+// drives a manager over textureCount simulated textures through camera positions whose feedback misses a quarter of the
+// visible textures every frame, completing loads a few frames after they are planned. Checks the budget on every frame
+// and that every position settles to the policy's mips without further changes
+ResidencyTestResult runResidencyTest(uint32_t textureCount)
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point start = Clock::now();
+
+    constexpr uint32_t kLoadLatency  = 3; // frames from planning a load to its completion
+    constexpr uint32_t kMaxLoads     = 16;
+    constexpr uint32_t kStableFrames = TextureResidencyManager::kVisibleFrames * 3;
+    constexpr uint32_t kMaxFrames    = 4096; // at one camera position
+
+    // square and 2:1 textures of 256 to 4096 texels with full chains, one in four of them single channel
+    std::mt19937            random(7);
+    TextureResidencyManager manager;
+    std::vector<uint32_t>   baseMips(textureCount);
+    for (uint32_t texture = 0; texture < textureCount; ++texture)
+    {
+        const uint32_t width    = 1u << (8 + random() % 5);
+        const uint32_t height   = random() % 4 == 0 ? width / 2 : width;
+        uint32_t       mipCount = 1;
+        while (width >> mipCount)
+        {
+            ++mipCount;
+        }
+        manager.addTexture(width, height, mipCount, random() % 4 == 0 ? 1 : 4);
+        baseMips[texture] = random() % 4;
+    }
+
+    struct CameraPosition
+    {
+        uint32_t first     = 0;
+        uint32_t count     = 0;
+        int32_t  mipOffset = 0; // on the base mips of the textures in view
+    };
+    const uint32_t       window      = std::max(textureCount / 8, 1u);
+    const CameraPosition positions[] = {
+        {0, window, 0},
+        {window / 2, window, 0},                                 // half the textures stay in view
+        {textureCount / 2, textureCount - textureCount / 2, -2}, // more and finer than the budget holds
+        {0, window, 0},                                          // back where the camera started
+    };
+    auto getWantedMip = [&](const CameraPosition& position, uint32_t texture)
+    {
+        const int32_t mip = static_cast<int32_t>(baseMips[texture]) + position.mipOffset;
+        return std::min(static_cast<uint32_t>(std::max(mip, 0)), manager.getTailMip(texture));
+    };
+
+    // the tails and half as much again as the first position wants
+    uint64_t tailBytes   = 0;
+    uint64_t wantedBytes = 0;
+    for (uint32_t texture = 0; texture < textureCount; ++texture)
+    {
+        tailBytes += manager.getChainBytes(texture, manager.getTailMip(texture));
+    }
+    for (uint32_t texture = positions[0].first; texture < positions[0].first + positions[0].count && texture < textureCount; ++texture)
+    {
+        const uint32_t tailMip = manager.getTailMip(texture);
+        wantedBytes += manager.getChainBytes(texture, getWantedMip(positions[0], texture)) - manager.getChainBytes(texture, tailMip);
+    }
+    const uint64_t budgetBytes = tailBytes + wantedBytes + wantedBytes / 2;
+
+    ResidencyTestResult result;
+    result.textures     = textureCount;
+    result.budgetMB     = static_cast<float>(budgetBytes) / (1024.0f * 1024.0f);
+    result.withinBudget = true;
+    result.settled      = true;
+
+    std::vector<std::pair<uint32_t, uint32_t>> loadsInFlight; // completion frame and texture
+    std::vector<TextureResidencyChange>        changes;
+    uint64_t                                   peakBytes = 0;
+    for (const CameraPosition& position : positions)
+    {
+        const uint32_t last        = std::min(position.first + position.count, textureCount);
+        uint32_t       frames      = 0;
+        uint32_t       quietFrames = 0;
+        uint32_t       lastChange  = 0;
+        while (quietFrames < kStableFrames && frames < kMaxFrames)
+        {
+            ++frames;
+            ++result.frames;
+            for (size_t index = 0; index < loadsInFlight.size();)
+            {
+                if (loadsInFlight[index].first > result.frames)
+                {
+                    ++index;
+                    continue;
+                }
+                manager.completeLoad(loadsInFlight[index].second);
+                loadsInFlight[index] = loadsInFlight.back();
+                loadsInFlight.pop_back();
+            }
+
+            // the sampled pixels miss a quarter of the textures, and see one in eight a mip coarser than it is wanted
+            for (uint32_t texture = position.first; texture < last; ++texture)
+            {
+                if (random() % 4 == 0) continue;
+                manager.requestMip(texture, getWantedMip(position, texture) + (random() % 8 == 0 ? 1 : 0));
+            }
+
+            manager.update(budgetBytes, kMaxLoads, changes);
+            for (const TextureResidencyChange& change : changes)
+            {
+                if (change.evict)
+                {
+                    ++result.evictions;
+                    continue;
+                }
+                ++result.loads;
+                loadsInFlight.push_back({result.frames + kLoadLatency, change.texture});
+            }
+
+            const uint64_t committedBytes = manager.getCommittedBytes();
+            peakBytes = std::max(peakBytes, committedBytes);
+            result.withinBudget &= committedBytes <= budgetBytes;
+            if (changes.empty() && loadsInFlight.empty())
+            {
+                ++quietFrames;
+            }
+            else
+            {
+                quietFrames = 0;
+                lastChange  = frames;
+            }
+        }
+        result.settleFrames = std::max(result.settleFrames, lastChange);
+        result.settled &= quietFrames >= kStableFrames;
+
+        // every tail is resident, the textures in view have at least the mips the bias leaves them
+        const uint32_t bias = manager.getBias();
+        for (uint32_t texture = 0; texture < textureCount; ++texture)
+        {
+            const bool     inView   = texture >= position.first && texture < last;
+            const uint32_t tailMip  = manager.getTailMip(texture);
+            const uint32_t expected = inView ? std::min(getWantedMip(position, texture) + bias, tailMip) : tailMip;
+            result.settled &= manager.getResidentMip(texture) <= expected;
+        }
+
+        // and the bias is the least that fits beside the decode reserve
+        if (bias > 0)
+        {
+            uint64_t finerBytes = 0;
+            for (uint32_t texture = 0; texture < textureCount; ++texture)
+            {
+                const bool     inView  = texture >= position.first && texture < last;
+                const uint32_t tailMip = manager.getTailMip(texture);
+                const uint32_t mip     = inView ? std::min(getWantedMip(position, texture) + bias - 1, tailMip) : tailMip;
+                finerBytes += manager.getChainBytes(texture, mip);
+            }
+            result.settled &= finerBytes > budgetBytes - manager.getDecodeReserve();
+        }
+    }
+
+    result.peakMB = static_cast<float>(peakBytes) / (1024.0f * 1024.0f);
+    result.ms     = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+    return result;
+}
+
+// one texture whose finest chain fits the budget but not beside the decode of its source image. The decode counts as
+// committed while the load is in flight and the texture settles a mip coarser, with room for the decode it settles finest
+bool runDecodeBudgetTest(TestCases& test)
+{
+    constexpr uint32_t kSize      = 1024;
+    constexpr uint64_t kFileBytes = 1024 * 1024;
+    constexpr uint32_t kFrames    = 16;
+
+    for (const bool roomForDecode : {false, true})
+    {
+        TextureResidencyManager manager;
+        manager.addTexture(kSize, kSize, 11, 4, kFileBytes);
+        const uint64_t decodeBytes = manager.getDecodeBytes(0);
+        const uint64_t budgetBytes = manager.getChainBytes(0, 0) + (roomForDecode ? decodeBytes : decodeBytes - 1);
+        test.expect(decodeBytes == kFileBytes + 2ull * kSize * kSize * 4); // the file and twice the image
+
+        std::vector<TextureResidencyChange> changes;
+        bool                                pending    = false;
+        uint32_t                            pendingMip = 0;
+        for (uint32_t frame = 0; frame < kFrames; ++frame)
+        {
+            if (pending)
+            {
+                manager.completeLoad(0);
+                pending = false;
+            }
+            manager.requestMip(0, 0);
+            manager.update(budgetBytes, 4, changes);
+            for (const TextureResidencyChange& change : changes)
+            {
+                if (!change.evict)
+                {
+                    pending    = true;
+                    pendingMip = change.mip;
+                }
+            }
+            if (pending)
+            {
+                test.expect(manager.getCommittedBytes() == manager.getChainBytes(0, pendingMip) + decodeBytes);
+            }
+            test.expect(manager.getCommittedBytes() <= budgetBytes);
+        }
+        test.expect(manager.getResidentMip(0) == (roomForDecode ? 0u : 1u));
+    }
+    return test.passed();
+}
+
+} // namespace
+
+bool textureResidencySelfTest()
+{
+    TestCases                 test;
+    const ResidencyTestResult result = runResidencyTest(kResidencyTextures);
+    const bool                passed = runDecodeBudgetTest(test) && result.withinBudget && result.settled;
+    LOGI("Texture residency decode budget: %u of %u cases failed\n", test.failures, test.cases);
+    LOGI("Texture residency, %u textures over %u frames: peak %.1f MB of %.1f MB, %u loads, %u evictions, settled within %u frames, "
+         "%.3f ms, %s\n",
+         result.textures, result.frames, result.peakMB, result.budgetMB, result.loads, result.evictions, result.settleFrames, result.ms,
+         passed ? "passed" : "failed");
+    return passed;
+}
+
+} // namespace Play::Tests
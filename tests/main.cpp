@@ -0,0 +1,77 @@
+#include "PlayGroundTests.h"
+#include <cstring>
+#include <nvutils/logger.hpp>
+
+namespace
+{
+struct TestEntry
+{
+    const char* name;
+    bool (*run)();
+    bool benchmark;
+};
+
+const TestEntry kTests[] = {
+    {"HiZPyramid", Play::Tests::hiZPyramidSelfTest, false},
+    {"ShadingRate", Play::Tests::shadingRateSelfTest, false},
+    {"TemporalReprojection", Play::Tests::temporalReprojectionSelfTest, false},
+    {"GaussianSortReuse", Play::Tests::gaussianSortReuseSelfTest, false},
+    {"GaussianTileReference", Play::Tests::gaussianTileReferenceSelfTest, false},
+    {"GaussianShEvaluator", Play::Tests::gaussianShEvaluatorSelfTest, false},
+    {"VolumeBrickGrid", Play::Tests::volumeBrickGridSelfTest, false},
+    {"LightCluster", Play::Tests::lightClusterSelfTest, false},
+    {"AtmosphereLutCache", Play::Tests::atmosphereLutCacheSelfTest, false},
+    {"DescriptorSetLRU", Play::Tests::descriptorSetLRUSelfTest, false},
+    {"DescriptorBufferAllocator", Play::Tests::descriptorBufferAllocatorSelfTest, false},
+    {"PipelineCacheLRU", Play::Tests::pipelineCacheLRUSelfTest, false},
+    {"PipelineLibrary", Play::Tests::pipelineLibrarySelfTest, false},
+    {"ShaderPermutation", Play::Tests::shaderPermutationSelfTest, false},
+    {"TextureResidency", Play::Tests::textureResidencySelfTest, false},
+    {"SceneSnapshot", Play::Tests::sceneSnapshotSelfTest, false},
+    {"SceneBVH", Play::Tests::sceneBVHSelfTest, false},
+    {"LightClusterBenchmark", Play::Tests::lightClusterBenchmark, true},
+    {"CacheStorageBenchmark", Play::Tests::cacheStorageBenchmark, true},
+    {"MaterialParameterBenchmark", Play::Tests::materialParameterBenchmark, true},
+    {"ComponentStoreBenchmark", Play::Tests::componentStoreBenchmark, true},
+    {"SceneSnapshotBenchmark", Play::Tests::sceneSnapshotBenchmark, true},
+    {"SceneBVHBenchmark", Play::Tests::sceneBVHBenchmark, true},
+};
+} // namespace
+
+// without arguments runs every self test, --benchmarks runs every benchmark, otherwise the tests named. Fails when one
+// of them failed or a name is unknown
+int main(int argc, char** argv)
+{
+    const bool benchmarks = argc == 2 && std::strcmp(argv[1], "--benchmarks") == 0;
+    const bool named      = argc > 1 && !benchmarks;
+
+    uint32_t failed = 0;
+    for (int arg = 1; named && arg < argc; ++arg)
+    {
+        bool known = false;
+        for (const TestEntry& test : kTests)
+        {
+            known = known || std::strcmp(test.name, argv[arg]) == 0;
+        }
+        if (!known)
+        {
+            LOGE("Unknown test %s\n", argv[arg]);
+            ++failed;
+        }
+    }
+
+    for (const TestEntry& test : kTests)
+    {
+        bool selected = !named && test.benchmark == benchmarks;
+        for (int arg = 1; named && arg < argc; ++arg)
+        {
+            selected = selected || std::strcmp(test.name, argv[arg]) == 0;
+        }
+        if (!selected) continue;
+
+        const bool passed = test.run();
+        LOGI("%s %s\n", test.name, passed ? "passed" : "FAILED");
+        failed += passed ? 0 : 1;
+    }
+    return failed == 0 ? 0 : 1;
+}